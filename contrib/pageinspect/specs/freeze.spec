@@ -0,0 +1,37 @@
+# Test that VACUUM and on-access pruning freeze tuples early when they
+# write the page anyway, and leave alone the tuples and pages they can't
+# freeze completely.  The table has two full pages of 58 rows each, far
+# younger than vacuum_freeze_min_age.  s1 deletes the first row through
+# its TID, so that it doesn't prune the first page itself.
+
+setup
+{
+	CREATE EXTENSION IF NOT EXISTS pageinspect;
+	CREATE TABLE frz (id int, t text) WITH (autovacuum_enabled = off);
+	INSERT INTO frz SELECT g, repeat('x', 100) FROM generate_series(1, 116) g;
+}
+
+teardown
+{
+	DROP TABLE frz;
+}
+
+session "s1"
+step "s1_delete1"	{ BEGIN; DELETE FROM frz WHERE ctid = '(0,1)'; }
+step "s1_commit"	{ COMMIT; }
+
+session "s2"
+step "s2_delete2"	{ DELETE FROM frz WHERE id = 2; }
+step "s2_select"	{ SELECT count(*) FROM frz; }
+step "s2_vacuum"	{ VACUUM frz; }
+step "s2_check"		{ SELECT blkno, count(*) FILTER (WHERE 'HEAP_XMIN_FROZEN' = ANY (combined_flags)) AS frozen, count(*) FILTER (WHERE NOT 'HEAP_XMIN_FROZEN' = ANY (combined_flags)) AS unfrozen FROM generate_series(0, 1) blkno, heap_page_items(get_raw_page('frz', blkno)), heap_tuple_infomask_flags(t_infomask, t_infomask2) WHERE lp_flags = 1 GROUP BY blkno ORDER BY blkno; }
+
+# VACUUM freezes all of the second page, which it marks all-visible, but
+# none of the first one, whose first row is being deleted.  Once that row
+# is gone, VACUUM prunes it and freezes the rest of the page.
+permutation "s1_delete1" "s2_vacuum" "s2_check" "s1_commit" "s2_vacuum" "s2_check"
+
+# Pruning the second row on access freezes the other rows of the first
+# page, except the one being deleted.  The second page isn't pruned, so
+# its rows aren't frozen.
+permutation "s2_delete2" "s1_delete1" "s2_select" "s2_check" "s1_commit"
@@ -0,0 +1,1237 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_handler.c
+ *	  Table access method routines for columnar tables.
+ *
+ * A columnar table stores the values of each column together, compressed,
+ * so that scans that need few of the columns read little of the table, and
+ * scans with selective conditions on a column can skip groups of rows whose
+ * value ranges don't match.  It is meant for append-mostly analytic data:
+ * rows can be inserted, but not updated, deleted or locked, and the table
+ * can't be indexed.  See columnar.h for the storage format.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar.h"
+#include "access/heapam.h"
+#include "access/multixact.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "commands/progress.h"
+#include "commands/vacuum.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/proc.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+/* Outcome of looking at a stripe for ANALYZE */
+#define COLUMNAR_SAMPLE_LIVE		0
+#define COLUMNAR_SAMPLE_DEAD		1
+#define COLUMNAR_SAMPLE_SKIP		2
+
+/*
+ * Rows fetched by TID are decoded a chunk group at a time; the last chunk
+ * group decoded is kept for the rest of the transaction, along with the
+ * table's stripe list, as triggers and TID scans tend to fetch nearby rows.
+ */
+typedef struct ColumnarFetchCache
+{
+	LocalTransactionId lxid;	/* transaction the cache is valid for */
+	RelFileNode node;			/* table the cache is for */
+	BlockNumber nblocks;		/* blocks in use when stripes were read */
+	List	   *stripes;		/* its stripes, sorted by first row */
+	ColumnarStripe *stripe;		/* stripe of decoded chunk group, or NULL */
+	int			chunkno;		/* decoded chunk group */
+	Datum	  **values;			/* decoded values, per column */
+	bool	  **isnull;
+	MemoryContext cxt;			/* holds all of the above */
+	MemoryContext chunkcxt;		/* holds the decoded chunk group */
+} ColumnarFetchCache;
+
+static ColumnarFetchCache fetch_cache;
+
+static const TableAmRoutine columnar_methods;
+
+static void columnar_scan_init(ColumnarScanDesc scan);
+static bool columnar_fetch_row(Relation rel, uint64 rownum, Snapshot snapshot,
+							   TupleTableSlot *slot);
+static void columnar_reset_fetch_cache(void);
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static const TupleTableSlotOps *
+columnar_slot_callbacks(Relation relation)
+{
+	return &TTSOpsVirtual;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Read the list of stripes to scan.  The rows the current transaction has
+ * inserted so far are written out first, so that the scan can see them.
+ */
+static void
+columnar_scan_init(ColumnarScanDesc scan)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelColumnarScanDesc pscan =
+	(ParallelColumnarScanDesc) scan->rs_base.rs_parallel;
+	ColumnarMetaPageData meta;
+	BlockNumber nblocks;
+
+	if (pscan == NULL)
+	{
+		columnar_flush_pending(rel);
+		columnar_read_meta(rel, &meta);
+		nblocks = meta.nblocks;
+		scan->cs_nrows = meta.next_row_number;
+	}
+	else
+	{
+		/* the leader has flushed its rows in columnar_parallelscan_initialize */
+		nblocks = pscan->nblocks;
+		scan->cs_nrows = 0;
+	}
+
+	/* Use a bulk-read strategy for large tables, as heap scans do */
+	if (scan->cs_strategy == NULL &&
+		(scan->rs_base.rs_flags & SO_ALLOW_STRAT) != 0 &&
+		!RelationUsesLocalBuffers(rel) &&
+		nblocks > NBuffers / 4)
+		scan->cs_strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	list_free_deep(scan->cs_stripes);
+	scan->cs_stripes = columnar_read_stripes(rel, nblocks, scan->cs_strategy);
+	scan->cs_stripeno = -1;
+	scan->cs_stripe = NULL;
+	scan->cs_chunkno = 0;
+	scan->cs_chunkrows = 0;
+	scan->cs_rowno = -1;
+	MemoryContextReset(scan->cs_chunkcxt);
+
+	if (scan->rs_base.rs_flags & SO_TYPE_ANALYZE)
+	{
+		list_sort(scan->cs_stripes, columnar_stripe_cmp);
+		scan->cs_nblocks = RelationGetNumberOfBlocks(rel);
+		scan->cs_sample_row = 0;
+		scan->cs_sample_end = 0;
+		scan->cs_sample_stripe = NULL;
+	}
+}
+
+static TableScanDesc
+columnar_beginscan(Relation rel, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	ColumnarScanDesc scan;
+	int			natts = RelationGetDescr(rel)->natts;
+
+	scan = (ColumnarScanDesc) palloc0(sizeof(ColumnarScanDescData));
+	scan->rs_base.rs_rd = rel;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = nkeys;
+	scan->rs_base.rs_key = key;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+
+	scan->cs_chunkcxt = AllocSetContextCreate(CurrentMemoryContext,
+											  "columnar scan chunk group",
+											  ALLOCSET_DEFAULT_SIZES);
+	scan->cs_values = palloc0(sizeof(Datum *) * natts);
+	scan->cs_isnull = palloc0(sizeof(bool *) * natts);
+
+	columnar_scan_init(scan);
+
+	return (TableScanDesc) scan;
+}
+
+static void
+columnar_endscan(TableScanDesc sscan)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	MemoryContextDelete(scan->cs_chunkcxt);
+	list_free_deep(scan->cs_stripes);
+
+	if (scan->cs_strategy != NULL)
+		FreeAccessStrategy(scan->cs_strategy);
+
+	if (scan->rs_base.rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(scan->rs_base.rs_snapshot);
+
+	pfree(scan->cs_values);
+	pfree(scan->cs_isnull);
+	pfree(scan);
+}
+
+static void
+columnar_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			scan->rs_base.rs_flags |= SO_ALLOW_STRAT;
+		else
+			scan->rs_base.rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	columnar_scan_init(scan);
+}
+
+static void
+columnar_scan_set_hints(TableScanDesc sscan, Bitmapset *attrs,
+						int nkeys, ScanKey keys)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	scan->cs_attrs = bms_copy(attrs);
+	scan->cs_nskipkeys = nkeys;
+	if (nkeys > 0)
+	{
+		scan->cs_skipkeys = palloc(sizeof(ScanKeyData) * nkeys);
+		memcpy(scan->cs_skipkeys, keys, sizeof(ScanKeyData) * nkeys);
+	}
+}
+
+/*
+ * Move to the next visible stripe in the given direction.  Returns false at
+ * the end of the scan, leaving the scan positioned past the end, so that a
+ * scan in the other direction starts with the last stripe.
+ *
+ * The chunk group is left just outside the stripe, so that the next step in
+ * the same direction reads its first chunk group, or its last one going
+ * backward.
+ */
+static bool
+columnar_next_stripe(ColumnarScanDesc scan, ScanDirection direction)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelColumnarScanDesc pscan =
+	(ParallelColumnarScanDesc) scan->rs_base.rs_parallel;
+	int			nstripes = list_length(scan->cs_stripes);
+
+	for (;;)
+	{
+		ColumnarStripe *stripe;
+		int			stripeno;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (pscan != NULL)
+			stripeno = (int) pg_atomic_fetch_add_u32(&pscan->next_stripe, 1);
+		else if (ScanDirectionIsBackward(direction))
+			stripeno = scan->cs_stripeno = Max(scan->cs_stripeno - 1, -1);
+		else
+			stripeno = scan->cs_stripeno = Min(scan->cs_stripeno + 1, nstripes);
+
+		if (stripeno < 0 || stripeno >= nstripes)
+		{
+			scan->cs_stripe = NULL;
+			return false;
+		}
+
+		stripe = (ColumnarStripe *) list_nth(scan->cs_stripes, stripeno);
+		if (!columnar_stripe_visible(&stripe->header, scan->rs_base.rs_snapshot))
+			continue;
+
+		columnar_read_chunk_directory(rel, stripe, scan->cs_nskipkeys > 0,
+									  scan->cs_strategy);
+		scan->cs_stripe = stripe;
+		if (ScanDirectionIsBackward(direction))
+			scan->cs_chunkno = (int) stripe->header.nchunks;
+		else
+			scan->cs_chunkno = -1;
+		scan->cs_chunkrows = 0;
+		return true;
+	}
+}
+
+/*
+ * Return the next row in the given direction.  Chunk groups are decoded as a
+ * whole, so going backward is just as cheap as going forward; parallel scans
+ * only go forward, though.
+ */
+static bool
+columnar_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+	bool		backward = ScanDirectionIsBackward(direction);
+	int			rowno;
+
+	Assert(!backward || scan->rs_base.rs_parallel == NULL);
+
+	rowno = backward ? scan->cs_rowno - 1 : scan->cs_rowno + 1;
+
+	while (scan->cs_stripe == NULL || rowno < 0 || rowno >= scan->cs_chunkrows)
+	{
+		ColumnarStripe *stripe = scan->cs_stripe;
+		MemoryContext oldcxt;
+
+		if (stripe == NULL ||
+			(backward ? scan->cs_chunkno <= 0 :
+			 scan->cs_chunkno + 1 >= (int) stripe->header.nchunks))
+		{
+			if (!columnar_next_stripe(scan, direction))
+			{
+				ExecClearTuple(slot);
+				return false;
+			}
+			continue;
+		}
+
+		scan->cs_chunkno += backward ? -1 : 1;
+		scan->cs_chunkrows = 0;
+		rowno = backward ? -1 : 0;
+
+		if (scan->cs_nskipkeys > 0 &&
+			!columnar_chunk_group_matches(stripe, scan->cs_chunkno,
+										  RelationGetDescr(rel),
+										  scan->cs_nskipkeys,
+										  scan->cs_skipkeys))
+			continue;
+
+		MemoryContextReset(scan->cs_chunkcxt);
+		oldcxt = MemoryContextSwitchTo(scan->cs_chunkcxt);
+		columnar_decode_chunk_group(rel, stripe, scan->cs_chunkno,
+									scan->cs_attrs,
+									scan->cs_values, scan->cs_isnull,
+									scan->cs_strategy);
+		MemoryContextSwitchTo(oldcxt);
+		scan->cs_chunkrows = columnar_chunk_group_rows(&stripe->header,
+													   scan->cs_chunkno);
+		if (backward)
+			rowno = scan->cs_chunkrows - 1;
+	}
+
+	scan->cs_rowno = rowno;
+	columnar_store_row(slot, scan->cs_stripe, scan->cs_chunkno,
+					   rowno, scan->cs_values, scan->cs_isnull);
+	pgstat_count_heap_getnext(rel);
+
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Parallel scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static Size
+columnar_parallelscan_estimate(Relation rel)
+{
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static Size
+columnar_parallelscan_initialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+	ColumnarMetaPageData meta;
+
+	columnar_flush_pending(rel);
+	columnar_read_meta(rel, &meta);
+
+	cpscan->base.phs_relid = RelationGetRelid(rel);
+	cpscan->base.phs_syncscan = false;
+	cpscan->nblocks = meta.nblocks;
+	pg_atomic_init_u32(&cpscan->next_stripe, 0);
+
+	return sizeof(ParallelColumnarScanDescData);
+}
+
+static void
+columnar_parallelscan_reinitialize(Relation rel, ParallelTableScanDesc pscan)
+{
+	ParallelColumnarScanDesc cpscan = (ParallelColumnarScanDesc) pscan;
+
+	pg_atomic_write_u32(&cpscan->next_stripe, 0);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks for columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+columnar_index_fetch_begin(Relation rel)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+	return NULL;				/* keep compiler quiet */
+}
+
+static void
+columnar_index_fetch_reset(IndexFetchTableData *scan)
+{
+	elog(ERROR, "columnar_index_fetch_reset not supported");
+}
+
+static void
+columnar_index_fetch_end(IndexFetchTableData *scan)
+{
+	elog(ERROR, "columnar_index_fetch_end not supported");
+}
+
+static bool
+columnar_index_fetch_tuple(struct IndexFetchTableData *scan,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	elog(ERROR, "columnar_index_fetch_tuple not supported");
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_reset_fetch_cache(void)
+{
+	if (fetch_cache.cxt == NULL)
+	{
+		fetch_cache.cxt = AllocSetContextCreate(TopMemoryContext,
+												"columnar fetch cache",
+												ALLOCSET_DEFAULT_SIZES);
+		fetch_cache.chunkcxt = AllocSetContextCreate(fetch_cache.cxt,
+													 "columnar fetch chunk group",
+													 ALLOCSET_DEFAULT_SIZES);
+	}
+	else
+	{
+		/* this resets chunkcxt as well */
+		MemoryContextReset(fetch_cache.cxt);
+	}
+
+	fetch_cache.lxid = InvalidLocalTransactionId;
+	fetch_cache.stripes = NIL;
+	fetch_cache.stripe = NULL;
+	fetch_cache.values = NULL;
+	fetch_cache.isnull = NULL;
+}
+
+/*
+ * Fetch row 'rownum' of a table into 'slot', if it is visible to 'snapshot'.
+ * If 'slot' is NULL, only check visibility.
+ */
+static bool
+columnar_fetch_row(Relation rel, uint64 rownum, Snapshot snapshot,
+				   TupleTableSlot *slot)
+{
+	ColumnarWriteState *pending = columnar_find_pending(rel);
+	ColumnarMetaPageData meta;
+	ColumnarStripe *stripe;
+	MemoryContext oldcxt;
+	int			chunkno;
+
+	/* Is it one of the rows we've inserted and not written out yet? */
+	if (pending != NULL &&
+		rownum >= pending->first_row &&
+		rownum < pending->first_row + pending->nrows)
+	{
+		int			rowno = rownum - pending->first_row;
+		int			natts;
+		int			i;
+
+		if (IsMVCCSnapshot(snapshot) && pending->cid >= snapshot->curcid)
+			return false;
+		if (slot == NULL)
+			return true;
+
+		natts = Min(pending->tupdesc->natts, slot->tts_tupleDescriptor->natts);
+		ExecClearTuple(slot);
+		for (i = 0; i < natts; i++)
+		{
+			slot->tts_values[i] = pending->values[i][rowno];
+			slot->tts_isnull[i] = pending->isnull[i][rowno];
+		}
+		if (natts < slot->tts_tupleDescriptor->natts)
+			slot_getmissingattrs(slot, natts, slot->tts_tupleDescriptor->natts);
+		ExecStoreVirtualTuple(slot);
+		ExecMaterializeSlot(slot);
+		columnar_row_to_tid(rownum, &slot->tts_tid);
+		slot->tts_tableOid = RelationGetRelid(rel);
+		return true;
+	}
+
+	columnar_read_meta(rel, &meta);
+	if (rownum >= meta.next_row_number)
+		return false;
+
+	if (fetch_cache.cxt == NULL ||
+		fetch_cache.lxid != MyProc->lxid ||
+		!RelFileNodeEquals(fetch_cache.node, rel->rd_node) ||
+		fetch_cache.nblocks != meta.nblocks)
+	{
+		columnar_reset_fetch_cache();
+		oldcxt = MemoryContextSwitchTo(fetch_cache.cxt);
+		fetch_cache.stripes = columnar_read_stripes(rel, meta.nblocks, NULL);
+		list_sort(fetch_cache.stripes, columnar_stripe_cmp);
+		fetch_cache.values = palloc(sizeof(Datum *) * RelationGetDescr(rel)->natts);
+		fetch_cache.isnull = palloc(sizeof(bool *) * RelationGetDescr(rel)->natts);
+		MemoryContextSwitchTo(oldcxt);
+		fetch_cache.lxid = MyProc->lxid;
+		fetch_cache.node = rel->rd_node;
+		fetch_cache.nblocks = meta.nblocks;
+	}
+
+	stripe = columnar_find_stripe(fetch_cache.stripes, rownum);
+	if (stripe == NULL || !columnar_stripe_visible(&stripe->header, snapshot))
+		return false;
+	if (slot == NULL)
+		return true;
+
+	chunkno = (rownum - stripe->header.first_row) / COLUMNAR_CHUNK_ROWS;
+	if (fetch_cache.stripe != stripe || fetch_cache.chunkno != chunkno)
+	{
+		fetch_cache.stripe = NULL;
+		MemoryContextReset(fetch_cache.chunkcxt);
+
+		oldcxt = MemoryContextSwitchTo(fetch_cache.cxt);
+		columnar_read_chunk_directory(rel, stripe, false, NULL);
+		MemoryContextSwitchTo(fetch_cache.chunkcxt);
+		columnar_decode_chunk_group(rel, stripe, chunkno, NULL,
+									fetch_cache.values, fetch_cache.isnull,
+									NULL);
+		MemoryContextSwitchTo(oldcxt);
+
+		fetch_cache.stripe = stripe;
+		fetch_cache.chunkno = chunkno;
+	}
+
+	columnar_store_row(slot, stripe, chunkno,
+					   (rownum - stripe->header.first_row) % COLUMNAR_CHUNK_ROWS,
+					   fetch_cache.values, fetch_cache.isnull);
+	ExecMaterializeSlot(slot);
+	slot->tts_tableOid = RelationGetRelid(rel);
+
+	return true;
+}
+
+static bool
+columnar_fetch_row_version(Relation rel, ItemPointer tid, Snapshot snapshot,
+						   TupleTableSlot *slot)
+{
+	return columnar_fetch_row(rel, columnar_tid_to_row(tid), snapshot, slot);
+}
+
+static bool
+columnar_tuple_tid_valid(TableScanDesc sscan, ItemPointer tid)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	return ItemPointerIsValid(tid) &&
+		ItemPointerGetOffsetNumber(tid) <= COLUMNAR_ROWS_PER_TID_BLOCK &&
+		columnar_tid_to_row(tid) < scan->cs_nrows;
+}
+
+static void
+columnar_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	/* Rows are never updated, so every row is its own latest version */
+}
+
+static bool
+columnar_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	return columnar_fetch_row(rel, columnar_tid_to_row(&slot->tts_tid),
+							  snapshot, NULL);
+}
+
+static TransactionId
+columnar_compute_xid_horizon_for_tuples(Relation rel,
+										ItemPointerData *tids,
+										int nitems)
+{
+	/* There are no indexes, so this should never be called */
+	return InvalidTransactionId;
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples for columnar AM.
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+columnar_tuple_insert(Relation rel, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	columnar_insert_row(rel, slot, cid);
+	pgstat_count_heap_insert(rel, 1);
+}
+
+static void
+columnar_tuple_insert_speculative(Relation rel, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("INSERT ... ON CONFLICT is not supported on columnar tables")));
+}
+
+static void
+columnar_tuple_complete_speculative(Relation rel, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	elog(ERROR, "columnar_tuple_complete_speculative not supported");
+}
+
+static void
+columnar_multi_insert(Relation rel, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	int			i;
+
+	for (i = 0; i < ntuples; i++)
+		columnar_insert_row(rel, slots[i], cid);
+	pgstat_count_heap_insert(rel, ntuples);
+}
+
+/*
+ * Write out the rows of a bulk load right away.  The target may be a new
+ * relation that is about to have its storage swapped with another one, and
+ * then dropped, such as in a table rewrite, and at commit it would be too
+ * late.
+ */
+static void
+columnar_finish_bulk_insert(Relation rel, int options)
+{
+	columnar_flush_pending(rel);
+}
+
+static TM_Result
+columnar_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("DELETE is not supported on columnar tables")));
+	return TM_Invisible;		/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
+					  CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+					  bool wait, TM_FailureData *tmfd,
+					  LockTupleMode *lockmode,
+					  TU_IndexUpdate *update_indexes)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("UPDATE is not supported on columnar tables")));
+	return TM_Invisible;		/* keep compiler quiet */
+}
+
+static TM_Result
+columnar_tuple_lock(Relation rel, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("row-level locks are not supported on columnar tables")));
+	return TM_Invisible;		/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks for columnar AM.
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_relation_set_new_filenode(Relation rel,
+								   const RelFileNode *newrnode,
+								   char persistence,
+								   TransactionId *freezeXid,
+								   MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/* Rows inserted into the old contents go away with them */
+	columnar_discard_pending(rel);
+
+	/* See heapam_relation_set_new_filenode */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrnode, persistence);
+
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrnode, INIT_FORKNUM, 0);
+		smgrimmedsync(srel, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+columnar_relation_nontransactional_truncate(Relation rel)
+{
+	columnar_discard_pending(rel);
+
+	/* The relfilenode stays the same, so the fetch cache can't tell */
+	if (fetch_cache.cxt != NULL)
+		columnar_reset_fetch_cache();
+
+	RelationTruncate(rel, 0);
+}
+
+static void
+columnar_relation_copy_data(Relation rel, const RelFileNode *newrnode)
+{
+	SMgrRelation dstrel;
+
+	/* Make sure the rows we've inserted are part of what's copied */
+	columnar_flush_pending(rel);
+
+	dstrel = smgropen(*newrnode, rel->rd_backend);
+	RelationOpenSmgr(rel);
+
+	/*
+	 * As in heapam_relation_copy_data, flush the source's pages out of shared
+	 * buffers, then copy the files.
+	 */
+	FlushRelationBuffers(rel);
+
+	RelationCreateStorage(*newrnode, rel->rd_rel->relpersistence);
+
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(rel->rd_smgr, forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+
+			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrnode, forkNum, 0);
+			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * VACUUM FULL: copy the rows of committed transactions into new stripes.
+ * Rows of transactions older than OldestXmin are frozen on the way.
+ */
+static void
+columnar_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	TupleDesc	tupdesc = RelationGetDescr(OldTable);
+	int			natts = tupdesc->natts;
+	ColumnarMetaPageData meta;
+	List	   *stripes;
+	ListCell   *lc;
+	ColumnarWriteState *frozen;
+	TupleTableSlot *slot;
+	MemoryContext chunkcxt;
+	Datum	  **values;
+	bool	  **isnull;
+
+	if (OldIndex != NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("indexes are not supported on columnar tables")));
+
+	*num_tuples = 0;
+	*tups_vacuumed = 0;
+	*tups_recently_dead = 0;
+
+	columnar_flush_pending(OldTable);
+	columnar_read_meta(OldTable, &meta);
+	stripes = columnar_read_stripes(OldTable, meta.nblocks, NULL);
+
+	slot = MakeSingleTupleTableSlot(tupdesc, &TTSOpsVirtual);
+	values = palloc(sizeof(Datum *) * natts);
+	isnull = palloc(sizeof(bool *) * natts);
+	chunkcxt = AllocSetContextCreate(CurrentMemoryContext,
+									 "columnar rewrite chunk group",
+									 ALLOCSET_DEFAULT_SIZES);
+	frozen = columnar_begin_write(NewTable, FrozenTransactionId,
+								  FirstCommandId);
+
+	foreach(lc, stripes)
+	{
+		ColumnarStripe *stripe = (ColumnarStripe *) lfirst(lc);
+		TransactionId xmin = stripe->header.xmin;
+		ColumnarWriteState *state;
+		uint32		chunkno;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (xmin == FrozenTransactionId)
+			state = frozen;
+		else if (!TransactionIdIsNormal(xmin))
+		{
+			*tups_vacuumed += stripe->header.nrows;
+			continue;
+		}
+		else if (TransactionIdIsCurrentTransactionId(xmin) ||
+				 TransactionIdIsInProgress(xmin))
+			state = columnar_begin_write(NewTable, xmin, stripe->header.cid);
+		else if (!TransactionIdDidCommit(xmin))
+		{
+			*tups_vacuumed += stripe->header.nrows;
+			continue;
+		}
+		else if (TransactionIdPrecedes(xmin, OldestXmin))
+			state = frozen;
+		else
+			state = columnar_begin_write(NewTable, xmin, stripe->header.cid);
+
+		columnar_read_chunk_directory(OldTable, stripe, false, NULL);
+		for (chunkno = 0; chunkno < stripe->header.nchunks; chunkno++)
+		{
+			MemoryContext oldcxt;
+			int			nrows = columnar_chunk_group_rows(&stripe->header,
+														  chunkno);
+			int			rowno;
+
+			MemoryContextReset(chunkcxt);
+			oldcxt = MemoryContextSwitchTo(chunkcxt);
+			columnar_decode_chunk_group(OldTable, stripe, chunkno, NULL,
+										values, isnull, NULL);
+			MemoryContextSwitchTo(oldcxt);
+
+			for (rowno = 0; rowno < nrows; rowno++)
+			{
+				columnar_store_row(slot, stripe, chunkno, rowno, values, isnull);
+				slot_getallattrs(slot);
+				columnar_append_row(NewTable, state,
+									slot->tts_values, slot->tts_isnull);
+			}
+		}
+		*num_tuples += stripe->header.nrows;
+
+		if (state != frozen)
+		{
+			columnar_flush_write(NewTable, state);
+			columnar_end_write(state);
+		}
+	}
+
+	columnar_flush_write(NewTable, frozen);
+	columnar_end_write(frozen);
+
+	MemoryContextDelete(chunkcxt);
+	ExecDropSingleTupleTableSlot(slot);
+}
+
+/*
+ * VACUUM.  Stripes are never removed, but those of transactions that no
+ * snapshot can consider running anymore are frozen, or marked as dead if the
+ * transaction aborted, so that relfrozenxid can advance.
+ */
+static void
+columnar_vacuum_rel(Relation rel, VacuumParams *params,
+					BufferAccessStrategy bstrategy)
+{
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	TransactionId xidFullScanLimit;
+	MultiXactId MultiXactCutoff;
+	MultiXactId mxactFullScanLimit;
+	TransactionId new_frozen_xid;
+	ColumnarMetaPageData meta;
+	List	   *stripes;
+	ListCell   *lc;
+	double		live_rows = 0;
+	double		dead_rows = 0;
+	int			elevel;
+
+	if (params->options & VACOPT_VERBOSE)
+		elevel = INFO;
+	else
+		elevel = DEBUG2;
+
+	pgstat_progress_start_command(PROGRESS_COMMAND_VACUUM,
+								  RelationGetRelid(rel));
+
+	vacuum_set_xid_limits(rel,
+						  params->freeze_min_age,
+						  params->freeze_table_age,
+						  params->multixact_freeze_min_age,
+						  params->multixact_freeze_table_age,
+						  &OldestXmin, &FreezeLimit, &xidFullScanLimit,
+						  &MultiXactCutoff, &mxactFullScanLimit);
+
+	columnar_read_meta(rel, &meta);
+	stripes = columnar_read_stripes(rel, meta.nblocks, bstrategy);
+
+	new_frozen_xid = OldestXmin;
+	foreach(lc, stripes)
+	{
+		ColumnarStripe *stripe = (ColumnarStripe *) lfirst(lc);
+		TransactionId xmin = stripe->header.xmin;
+
+		vacuum_delay_point();
+
+		if (xmin == FrozenTransactionId)
+			live_rows += stripe->header.nrows;
+		else if (!TransactionIdIsNormal(xmin))
+			dead_rows += stripe->header.nrows;
+		else if (!TransactionIdPrecedes(xmin, OldestXmin))
+		{
+			live_rows += stripe->header.nrows;
+			if (TransactionIdPrecedes(xmin, new_frozen_xid))
+				new_frozen_xid = xmin;
+		}
+		else if (TransactionIdDidCommit(xmin))
+		{
+			columnar_set_stripe_xmin(rel, stripe->start, FrozenTransactionId);
+			live_rows += stripe->header.nrows;
+		}
+		else
+		{
+			columnar_set_stripe_xmin(rel, stripe->start, InvalidTransactionId);
+			dead_rows += stripe->header.nrows;
+		}
+	}
+
+	vac_update_relstats(rel,
+						RelationGetNumberOfBlocks(rel),
+						live_rows,
+						0,
+						false,
+						new_frozen_xid,
+						MultiXactCutoff,
+						false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel),
+						 rel->rd_rel->relisshared,
+						 live_rows,
+						 dead_rows);
+	pgstat_progress_end_command();
+
+	ereport(elevel,
+			(errmsg("\"%s\": found %.0f live rows and %.0f rows of aborted transactions in %d stripes",
+					RelationGetRelationName(rel),
+					live_rows, dead_rows, list_length(stripes))));
+}
+
+/*
+ * ANALYZE samples blocks, which don't mean anything for a columnar table.
+ * Instead, the range of row numbers is divided evenly over the blocks, and
+ * sampling a block returns the rows in its part of the range.
+ */
+static bool
+columnar_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+
+	if (scan->cs_nblocks == 0)
+		return false;
+
+	scan->cs_sample_row = (uint64) ((double) scan->cs_nrows * blockno /
+									scan->cs_nblocks);
+	scan->cs_sample_end = (uint64) ((double) scan->cs_nrows * (blockno + 1) /
+									scan->cs_nblocks);
+
+	return true;
+}
+
+static bool
+columnar_scan_analyze_next_tuple(TableScanDesc sscan, TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	ColumnarScanDesc scan = (ColumnarScanDesc) sscan;
+	Relation	rel = scan->rs_base.rs_rd;
+
+	while (scan->cs_sample_row < scan->cs_sample_end)
+	{
+		uint64		rownum = scan->cs_sample_row++;
+		ColumnarStripe *stripe;
+		int			chunkno;
+
+		stripe = columnar_find_stripe(scan->cs_stripes, rownum);
+		if (stripe == NULL)
+			continue;			/* row number was never used */
+
+		if (stripe != scan->cs_sample_stripe)
+		{
+			TransactionId xmin = stripe->header.xmin;
+
+			/* Count rows as HeapTupleSatisfiesVacuum would */
+			if (xmin == FrozenTransactionId)
+				scan->cs_sample_status = COLUMNAR_SAMPLE_LIVE;
+			else if (!TransactionIdIsNormal(xmin))
+				scan->cs_sample_status = COLUMNAR_SAMPLE_DEAD;
+			else if (TransactionIdIsCurrentTransactionId(xmin))
+				scan->cs_sample_status = COLUMNAR_SAMPLE_LIVE;
+			else if (TransactionIdIsInProgress(xmin))
+				scan->cs_sample_status = COLUMNAR_SAMPLE_SKIP;
+			else if (TransactionIdDidCommit(xmin))
+				scan->cs_sample_status = COLUMNAR_SAMPLE_LIVE;
+			else
+				scan->cs_sample_status = COLUMNAR_SAMPLE_DEAD;
+			scan->cs_sample_stripe = stripe;
+		}
+
+		if (scan->cs_sample_status == COLUMNAR_SAMPLE_DEAD)
+		{
+			*deadrows += 1;
+			continue;
+		}
+		if (scan->cs_sample_status == COLUMNAR_SAMPLE_SKIP)
+			continue;
+
+		chunkno = (rownum - stripe->header.first_row) / COLUMNAR_CHUNK_ROWS;
+		if (scan->cs_stripe != stripe || scan->cs_chunkno != chunkno)
+		{
+			MemoryContext oldcxt;
+
+			scan->cs_stripe = NULL;
+			columnar_read_chunk_directory(rel, stripe, false,
+										  scan->cs_strategy);
+			MemoryContextReset(scan->cs_chunkcxt);
+			oldcxt = MemoryContextSwitchTo(scan->cs_chunkcxt);
+			columnar_decode_chunk_group(rel, stripe, chunkno, NULL,
+										scan->cs_values, scan->cs_isnull,
+										scan->cs_strategy);
+			MemoryContextSwitchTo(oldcxt);
+			scan->cs_stripe = stripe;
+			scan->cs_chunkno = chunkno;
+		}
+
+		columnar_store_row(slot, stripe, chunkno,
+						   (rownum - stripe->header.first_row) % COLUMNAR_CHUNK_ROWS,
+						   scan->cs_values, scan->cs_isnull);
+		*liverows += 1;
+		return true;
+	}
+
+	ExecClearTuple(slot);
+	return false;
+}
+
+static double
+columnar_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+	return 0;					/* keep compiler quiet */
+}
+
+static void
+columnar_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("indexes are not supported on columnar tables")));
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Values are stored detoasted and compressed with the other values of their
+ * column, so there's no need for a TOAST table.
+ */
+static bool
+columnar_relation_needs_toast_table(Relation rel)
+{
+	return false;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static void
+columnar_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	ColumnarMetaPageData meta;
+	ColumnarWriteState *pending = columnar_find_pending(rel);
+
+	columnar_read_meta(rel, &meta);
+
+	*pages = RelationGetNumberOfBlocks(rel);
+	*tuples = (double) meta.nrows;
+	if (pending != NULL)
+		*tuples += pending->nrows;
+	*allvisfrac = 0;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks for the columnar AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+columnar_scan_sample_next_block(TableScanDesc scan,
+								SampleScanState *scanstate)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("TABLESAMPLE is not supported on columnar tables")));
+	return false;				/* keep compiler quiet */
+}
+
+static bool
+columnar_scan_sample_next_tuple(TableScanDesc scan,
+								SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	elog(ERROR, "columnar_scan_sample_next_tuple not supported");
+	return false;				/* keep compiler quiet */
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the columnar table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine columnar_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = columnar_slot_callbacks,
+
+	.scan_begin = columnar_beginscan,
+	.scan_end = columnar_endscan,
+	.scan_rescan = columnar_rescan,
+	.scan_getnextslot = columnar_getnextslot,
+	.scan_set_hints = columnar_scan_set_hints,
+
+	.parallelscan_estimate = columnar_parallelscan_estimate,
+	.parallelscan_initialize = columnar_parallelscan_initialize,
+	.parallelscan_reinitialize = columnar_parallelscan_reinitialize,
+
+	.index_fetch_begin = columnar_index_fetch_begin,
+	.index_fetch_reset = columnar_index_fetch_reset,
+	.index_fetch_end = columnar_index_fetch_end,
+	.index_fetch_tuple = columnar_index_fetch_tuple,
+
+	.tuple_insert = columnar_tuple_insert,
+	.tuple_insert_speculative = columnar_tuple_insert_speculative,
+	.tuple_complete_speculative = columnar_tuple_complete_speculative,
+	.multi_insert = columnar_multi_insert,
+	.tuple_delete = columnar_tuple_delete,
+	.tuple_update = columnar_tuple_update,
+	.tuple_lock = columnar_tuple_lock,
+	.finish_bulk_insert = columnar_finish_bulk_insert,
+
+	.tuple_fetch_row_version = columnar_fetch_row_version,
+	.tuple_get_latest_tid = columnar_get_latest_tid,
+	.tuple_tid_valid = columnar_tuple_tid_valid,
+	.tuple_satisfies_snapshot = columnar_tuple_satisfies_snapshot,
+	.compute_xid_horizon_for_tuples = columnar_compute_xid_horizon_for_tuples,
+
+	.relation_set_new_filenode = columnar_relation_set_new_filenode,
+	.relation_nontransactional_truncate = columnar_relation_nontransactional_truncate,
+	.relation_copy_data = columnar_relation_copy_data,
+	.relation_copy_for_cluster = columnar_relation_copy_for_cluster,
+	.relation_vacuum = columnar_vacuum_rel,
+	.scan_analyze_next_block = columnar_scan_analyze_next_block,
+	.scan_analyze_next_tuple = columnar_scan_analyze_next_tuple,
+	.index_build_range_scan = columnar_index_build_range_scan,
+	.index_validate_scan = columnar_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = columnar_relation_needs_toast_table,
+
+	.relation_estimate_size = columnar_estimate_rel_size,
+
+	.scan_sample_next_block = columnar_scan_sample_next_block,
+	.scan_sample_next_tuple = columnar_scan_sample_next_tuple
+};
+
+Datum
+columnar_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&columnar_methods);
+}
@@ -0,0 +1,303 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_read.c
+ *	  Decoding the stripes of the columnar table access method.
+ *
+ * Readers process a stripe one chunk group at a time.  Only the columns
+ * that are needed are decoded, and a chunk group can be skipped entirely if
+ * the minimum and maximum values of its chunks show that none of its rows
+ * can satisfy the scan keys.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_read.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar.h"
+#include "access/stratnum.h"
+#include "access/tupmacs.h"
+#include "common/pg_lzcompress.h"
+#include "utils/datum.h"
+#include "utils/rel.h"
+
+/* Flag bits in the first byte of a chunk, see columnar_write.c */
+#define COLUMNAR_CHUNK_HAS_NULLS	0x01
+
+static void decode_chunk(Relation rel, ColumnarStripe *stripe,
+						 ColumnarChunk *chunk, Form_pg_attribute att,
+						 int nrows, Datum *values, bool *isnull,
+						 BufferAccessStrategy strategy);
+
+
+/*
+ * Could any row of a chunk group satisfy all of the given scan keys?
+ *
+ * The keys are of the form "column op constant", with a btree operator of
+ * the column's type.  The stripe's chunk directory must have been read with
+ * the minimum and maximum values.
+ */
+bool
+columnar_chunk_group_matches(ColumnarStripe *stripe, int chunkno,
+							 TupleDesc tupdesc, int nkeys, ScanKey keys)
+{
+	ColumnarStripeHeader *header = &stripe->header;
+	int			i;
+
+	for (i = 0; i < nkeys; i++)
+	{
+		ScanKey		key = &keys[i];
+		Form_pg_attribute att = TupleDescAttr(tupdesc, key->sk_attno - 1);
+		ColumnarChunk *chunk;
+		char	   *ptr;
+		Datum		min;
+		Datum		max;
+		bool		isnull;
+		Datum		bound;
+		bool		match;
+
+		/* Columns added after the stripe was written are not stored */
+		if (key->sk_attno > header->natts)
+			continue;
+
+		chunk = &stripe->chunks[ColumnarChunkIndex(header, chunkno, key->sk_attno)];
+
+		/* All NULLs; the operator is strict */
+		if (chunk->size == 0)
+			return false;
+
+		if (chunk->minmax_offset == 0 || stripe->minmax == NULL)
+			continue;
+
+		ptr = stripe->minmax + (chunk->minmax_offset - header->minmax_start);
+		min = datumRestore(&ptr, &isnull);
+		max = datumRestore(&ptr, &isnull);
+
+		switch (key->sk_strategy)
+		{
+			case BTLessStrategyNumber:
+			case BTLessEqualStrategyNumber:
+				bound = min;
+				break;
+			case BTGreaterEqualStrategyNumber:
+			case BTGreaterStrategyNumber:
+				bound = max;
+				break;
+			default:
+				elog(ERROR, "unexpected strategy number %d",
+					 key->sk_strategy);
+				bound = (Datum) 0;	/* keep compiler quiet */
+				break;
+		}
+
+		match = DatumGetBool(FunctionCall2Coll(&key->sk_func,
+											   key->sk_collation,
+											   bound, key->sk_argument));
+
+		if (!att->attbyval)
+		{
+			pfree(DatumGetPointer(min));
+			pfree(DatumGetPointer(max));
+		}
+
+		if (!match)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Decode the values of one column of a chunk group.
+ */
+static void
+decode_chunk(Relation rel, ColumnarStripe *stripe, ColumnarChunk *chunk,
+			 Form_pg_attribute att, int nrows, Datum *values, bool *isnull,
+			 BufferAccessStrategy strategy)
+{
+	char	   *raw;
+	bits8	   *bitmap = NULL;
+	uint32		off;
+	int			i;
+
+	if (chunk->size == 0)
+	{
+		memset(isnull, true, sizeof(bool) * nrows);
+		return;
+	}
+
+	raw = palloc(chunk->size);
+	columnar_read_bytes(rel, stripe->start, chunk->offset, raw, chunk->size,
+						strategy);
+	if (chunk->rawsize > chunk->size)
+	{
+		char	   *compressed = raw;
+
+		raw = palloc(chunk->rawsize);
+		if (pglz_decompress(compressed, chunk->size, raw, chunk->rawsize,
+							true) != chunk->rawsize)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("compressed data in columnar table \"%s\" is corrupted",
+							RelationGetRelationName(rel))));
+		pfree(compressed);
+	}
+
+	off = 1;
+	if (raw[0] & COLUMNAR_CHUNK_HAS_NULLS)
+	{
+		bitmap = (bits8 *) (raw + off);
+		off += (nrows + 7) / 8;
+	}
+	off = MAXALIGN(off);
+
+	for (i = 0; i < nrows; i++)
+	{
+		if (bitmap != NULL && att_isnull(i, bitmap))
+		{
+			values[i] = (Datum) 0;
+			isnull[i] = true;
+			continue;
+		}
+
+		if (att->attlen == -1)
+			off = att_align_pointer(off, att->attalign, -1, raw + off);
+		else
+			off = att_align_nominal(off, att->attalign);
+
+		values[i] = fetchatt(att, raw + off);
+		isnull[i] = false;
+		off = att_addlength_pointer(off, att->attlen, raw + off);
+	}
+
+	if (off > chunk->rawsize)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("invalid chunk in columnar table \"%s\"",
+						RelationGetRelationName(rel))));
+}
+
+/*
+ * Decode the chunk group 'chunkno' of a stripe, for the columns in 'attrs',
+ * or all columns if 'attrs' is NULL.  The values and null flags of column N
+ * are returned in values[N - 1] and isnull[N - 1], which are set to NULL for
+ * columns not decoded.  Everything is allocated in CurrentMemoryContext, and
+ * pass-by-reference values point into the decoded chunks.
+ *
+ * The stripe's chunk directory must have been read.
+ */
+void
+columnar_decode_chunk_group(Relation rel, ColumnarStripe *stripe, int chunkno,
+							Bitmapset *attrs, Datum **values, bool **isnull,
+							BufferAccessStrategy strategy)
+{
+	ColumnarStripeHeader *header = &stripe->header;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			nrows = columnar_chunk_group_rows(header, chunkno);
+	int			attno;
+
+	for (attno = 1; attno <= tupdesc->natts; attno++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attno - 1);
+
+		values[attno - 1] = NULL;
+		isnull[attno - 1] = NULL;
+
+		if (attno > header->natts || att->attisdropped ||
+			(attrs != NULL && !bms_is_member(attno, attrs)))
+			continue;
+
+		values[attno - 1] = palloc(sizeof(Datum) * nrows);
+		isnull[attno - 1] = palloc(sizeof(bool) * nrows);
+		decode_chunk(rel, stripe,
+					 &stripe->chunks[ColumnarChunkIndex(header, chunkno, attno)],
+					 att, nrows, values[attno - 1], isnull[attno - 1],
+					 strategy);
+	}
+}
+
+/*
+ * Store row 'rowno' of a decoded chunk group in a virtual slot.  Columns that
+ * were not decoded are returned as NULL, except that columns added after the
+ * stripe was written get their default values.
+ */
+void
+columnar_store_row(TupleTableSlot *slot, ColumnarStripe *stripe, int chunkno,
+				   int rowno, Datum **values, bool **isnull)
+{
+	int			natts = slot->tts_tupleDescriptor->natts;
+	int			stored = Min(natts, (int) stripe->header.natts);
+	int			i;
+
+	ExecClearTuple(slot);
+
+	for (i = 0; i < stored; i++)
+	{
+		if (values[i] == NULL)
+		{
+			slot->tts_values[i] = (Datum) 0;
+			slot->tts_isnull[i] = true;
+		}
+		else
+		{
+			slot->tts_values[i] = values[i][rowno];
+			slot->tts_isnull[i] = isnull[i][rowno];
+		}
+	}
+	if (stored < natts)
+		slot_getmissingattrs(slot, stored, natts);
+
+	ExecStoreVirtualTuple(slot);
+
+	columnar_row_to_tid(stripe->header.first_row +
+						(uint64) chunkno * COLUMNAR_CHUNK_ROWS + rowno,
+						&slot->tts_tid);
+}
+
+/*
+ * Find the stripe holding row 'rownum' in a list of stripes sorted by
+ * columnar_stripe_cmp, or return NULL if there is none.
+ */
+ColumnarStripe *
+columnar_find_stripe(List *stripes, uint64 rownum)
+{
+	int			lo = 0;
+	int			hi = list_length(stripes) - 1;
+
+	while (lo <= hi)
+	{
+		int			mid = lo + (hi - lo) / 2;
+		ColumnarStripe *stripe = (ColumnarStripe *) list_nth(stripes, mid);
+
+		if (rownum < stripe->header.first_row)
+			hi = mid - 1;
+		else if (rownum >= stripe->header.first_row + stripe->header.nrows)
+			lo = mid + 1;
+		else
+			return stripe;
+	}
+
+	return NULL;
+}
+
+/*
+ * list_sort comparator ordering stripes by their first row number.
+ */
+int
+columnar_stripe_cmp(const ListCell *a, const ListCell *b)
+{
+	ColumnarStripe *sa = (ColumnarStripe *) lfirst(a);
+	ColumnarStripe *sb = (ColumnarStripe *) lfirst(b);
+
+	if (sa->header.first_row < sb->header.first_row)
+		return -1;
+	if (sa->header.first_row > sb->header.first_row)
+		return 1;
+	return 0;
+}
@@ -0,0 +1,419 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_storage.c
+ *	  Page-level storage of the columnar table access method.
+ *
+ * The metapage and the stripes are WAL-logged with generic WAL records.
+ * Writers serialize on the exclusive lock of the metapage: reserving row
+ * numbers and appending a stripe both happen while holding it.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_storage.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar.h"
+#include "access/generic_xlog.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "storage/bufmgr.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/snapmgr.h"
+
+static Buffer columnar_lock_meta(Relation rel);
+static void columnar_init_metapage(Page page);
+
+
+/*
+ * Initialize a metapage of an empty table.
+ */
+static void
+columnar_init_metapage(Page page)
+{
+	ColumnarMetaPage meta;
+
+	PageInit(page, BLCKSZ, 0);
+
+	meta = ColumnarPageGetMeta(page);
+	memset(meta, 0, sizeof(ColumnarMetaPageData));
+	meta->magic = COLUMNAR_MAGIC;
+	meta->version = COLUMNAR_VERSION;
+	meta->nblocks = 1;
+	meta->nstripes = 0;
+	meta->next_row_number = 0;
+	meta->nrows = 0;
+
+	/*
+	 * Set pd_lower just past the end of the metadata.  This is essential,
+	 * because without doing so, metadata will be lost if xlog.c compresses
+	 * the page.
+	 */
+	((PageHeader) page)->pd_lower =
+		((char *) meta + sizeof(ColumnarMetaPageData)) - (char *) page;
+}
+
+/*
+ * Return the metapage of the table, exclusively locked.  The metapage is
+ * created when the table is first written to.
+ */
+static Buffer
+columnar_lock_meta(Relation rel)
+{
+	Buffer		buffer;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+	{
+		LockRelationForExtension(rel, ExclusiveLock);
+
+		if (RelationGetNumberOfBlocks(rel) == 0)
+		{
+			GenericXLogState *state;
+
+			buffer = ReadBuffer(rel, P_NEW);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+			Assert(BufferGetBlockNumber(buffer) == COLUMNAR_METAPAGE_BLKNO);
+
+			state = GenericXLogStart(rel);
+			page = GenericXLogRegisterBuffer(state, buffer,
+											 GENERIC_XLOG_FULL_IMAGE);
+			columnar_init_metapage(page);
+			GenericXLogFinish(state);
+
+			UnlockRelationForExtension(rel, ExclusiveLock);
+			return buffer;
+		}
+
+		UnlockRelationForExtension(rel, ExclusiveLock);
+	}
+
+	buffer = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	page = BufferGetPage(buffer);
+	if (ColumnarPageGetMeta(page)->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("table \"%s\" is not a columnar table",
+						RelationGetRelationName(rel))));
+
+	return buffer;
+}
+
+/*
+ * Read the metapage into *meta.  A table that has never been written to has
+ * no metapage; then we return the contents of an empty one.
+ */
+void
+columnar_read_meta(Relation rel, ColumnarMetaPageData *meta)
+{
+	Buffer		buffer;
+	Page		page;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+	{
+		memset(meta, 0, sizeof(ColumnarMetaPageData));
+		meta->magic = COLUMNAR_MAGIC;
+		meta->version = COLUMNAR_VERSION;
+		meta->nblocks = 1;
+		return;
+	}
+
+	buffer = ReadBuffer(rel, COLUMNAR_METAPAGE_BLKNO);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+	memcpy(meta, ColumnarPageGetMeta(page), sizeof(ColumnarMetaPageData));
+	UnlockReleaseBuffer(buffer);
+
+	if (meta->magic != COLUMNAR_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("table \"%s\" is not a columnar table",
+						RelationGetRelationName(rel))));
+	if (meta->version != COLUMNAR_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("columnar table \"%s\" has wrong version %u, expected %u",
+						RelationGetRelationName(rel),
+						meta->version, COLUMNAR_VERSION)));
+}
+
+/*
+ * Reserve 'nrows' row numbers, and return the first one.
+ *
+ * Row numbers are handed out in increasing order, so if nobody else has
+ * reserved any since the caller's last reservation, the new range follows
+ * that one directly.
+ */
+uint64
+columnar_reserve_rows(Relation rel, uint32 nrows)
+{
+	Buffer		metabuf;
+	GenericXLogState *state;
+	ColumnarMetaPage meta;
+	uint64		first;
+
+	metabuf = columnar_lock_meta(rel);
+
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, metabuf, 0));
+	first = meta->next_row_number;
+	meta->next_row_number += nrows;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(metabuf);
+
+	return first;
+}
+
+/*
+ * Append a stripe to the table.  'data' is the stripe's byte stream, with a
+ * complete header.
+ */
+void
+columnar_write_stripe(Relation rel, char *data)
+{
+	ColumnarStripeHeader *header = (ColumnarStripeHeader *) data;
+	Buffer		metabuf;
+	GenericXLogState *state;
+	ColumnarMetaPage meta;
+	BlockNumber start;
+	BlockNumber nblocks;
+	uint32		i;
+
+	metabuf = columnar_lock_meta(rel);
+	meta = ColumnarPageGetMeta(BufferGetPage(metabuf));
+	start = meta->nblocks;
+
+	/*
+	 * Write out the data pages, in groups of as many as fit in one generic
+	 * WAL record.  Blocks beyond what the metapage says is in use may exist
+	 * if we crashed while writing a stripe; just overwrite them.
+	 */
+	nblocks = RelationGetNumberOfBlocks(rel);
+	for (i = 0; i < header->nblocks; i += MAX_GENERIC_XLOG_PAGES)
+	{
+		Buffer		buffers[MAX_GENERIC_XLOG_PAGES];
+		int			nbuffers = 0;
+		uint32		j;
+
+		state = GenericXLogStart(rel);
+		for (j = i; j < header->nblocks && nbuffers < MAX_GENERIC_XLOG_PAGES; j++)
+		{
+			BlockNumber blkno = start + j;
+			Buffer		buffer;
+			Page		page;
+			uint32		offset = j * COLUMNAR_PAGE_DATA_SIZE;
+			uint32		len = Min(header->size - offset, COLUMNAR_PAGE_DATA_SIZE);
+
+			if (blkno < nblocks)
+				buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno,
+											RBM_ZERO_AND_LOCK, NULL);
+			else
+			{
+				LockRelationForExtension(rel, ExclusiveLock);
+				buffer = ReadBuffer(rel, P_NEW);
+				LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+				UnlockRelationForExtension(rel, ExclusiveLock);
+				if (BufferGetBlockNumber(buffer) != blkno)
+					elog(ERROR, "unexpected block %u while extending columnar table \"%s\", expected %u",
+						 BufferGetBlockNumber(buffer),
+						 RelationGetRelationName(rel), blkno);
+				nblocks++;
+			}
+
+			page = GenericXLogRegisterBuffer(state, buffer,
+											 GENERIC_XLOG_FULL_IMAGE);
+			PageInit(page, BLCKSZ, 0);
+			memcpy((char *) page + COLUMNAR_PAGE_DATA_OFFSET, data + offset, len);
+			((PageHeader) page)->pd_lower = COLUMNAR_PAGE_DATA_OFFSET + len;
+
+			buffers[nbuffers++] = buffer;
+		}
+		GenericXLogFinish(state);
+
+		while (nbuffers > 0)
+			UnlockReleaseBuffer(buffers[--nbuffers]);
+	}
+
+	/* Now that the stripe is complete, make it part of the table */
+	state = GenericXLogStart(rel);
+	meta = ColumnarPageGetMeta(GenericXLogRegisterBuffer(state, metabuf, 0));
+	meta->nblocks = start + header->nblocks;
+	meta->nstripes++;
+	meta->nrows += header->nrows;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(metabuf);
+}
+
+/*
+ * Read 'len' bytes at 'offset' of the byte stream of the stripe starting at
+ * block 'start'.
+ */
+void
+columnar_read_bytes(Relation rel, BlockNumber start, uint32 offset,
+					char *dest, uint32 len, BufferAccessStrategy strategy)
+{
+	while (len > 0)
+	{
+		BlockNumber blkno = start + offset / COLUMNAR_PAGE_DATA_SIZE;
+		uint32		pageoff = offset % COLUMNAR_PAGE_DATA_SIZE;
+		uint32		n = Min(len, COLUMNAR_PAGE_DATA_SIZE - pageoff);
+		Buffer		buffer;
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									strategy);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		memcpy(dest,
+			   (char *) BufferGetPage(buffer) + COLUMNAR_PAGE_DATA_OFFSET + pageoff,
+			   n);
+		UnlockReleaseBuffer(buffer);
+
+		dest += n;
+		offset += n;
+		len -= n;
+	}
+}
+
+/*
+ * Return a list of the stripes in the first 'nblocks' blocks of the table,
+ * with their headers.
+ */
+List *
+columnar_read_stripes(Relation rel, BlockNumber nblocks,
+					  BufferAccessStrategy strategy)
+{
+	List	   *stripes = NIL;
+	BlockNumber blkno = COLUMNAR_METAPAGE_BLKNO + 1;
+
+	while (blkno < nblocks)
+	{
+		ColumnarStripe *stripe = palloc0(sizeof(ColumnarStripe));
+
+		stripe->start = blkno;
+		columnar_read_bytes(rel, blkno, 0, (char *) &stripe->header,
+							sizeof(ColumnarStripeHeader), strategy);
+		if (stripe->header.magic != COLUMNAR_MAGIC ||
+			stripe->header.nblocks == 0)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid stripe at block %u of columnar table \"%s\"",
+							blkno, RelationGetRelationName(rel))));
+
+		stripes = lappend(stripes, stripe);
+		blkno += stripe->header.nblocks;
+	}
+
+	return stripes;
+}
+
+/*
+ * Read the chunk directory of a stripe, and if 'minmax' is true, the minimum
+ * and maximum values of the chunks as well.
+ */
+void
+columnar_read_chunk_directory(Relation rel, ColumnarStripe *stripe,
+							  bool minmax, BufferAccessStrategy strategy)
+{
+	ColumnarStripeHeader *header = &stripe->header;
+
+	if (stripe->chunks == NULL)
+	{
+		Size		len = sizeof(ColumnarChunk) * header->nchunks * header->natts;
+
+		stripe->chunks = palloc(len);
+		columnar_read_bytes(rel, stripe->start, COLUMNAR_CHUNK_DIR_OFFSET,
+							(char *) stripe->chunks, len, strategy);
+	}
+
+	if (minmax && stripe->minmax == NULL &&
+		header->data_start > header->minmax_start)
+	{
+		Size		len = header->data_start - header->minmax_start;
+
+		stripe->minmax = palloc(len);
+		columnar_read_bytes(rel, stripe->start, header->minmax_start,
+							stripe->minmax, len, strategy);
+	}
+}
+
+/*
+ * Change the inserting transaction recorded for the stripe starting at block
+ * 'start'.  Used by VACUUM, to freeze stripes or to mark aborted ones as such.
+ */
+void
+columnar_set_stripe_xmin(Relation rel, BlockNumber start, TransactionId xmin)
+{
+	Buffer		buffer;
+	GenericXLogState *state;
+	Page		page;
+	ColumnarStripeHeader *header;
+
+	buffer = ReadBuffer(rel, start);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	state = GenericXLogStart(rel);
+	page = GenericXLogRegisterBuffer(state, buffer, 0);
+	header = (ColumnarStripeHeader *) ((char *) page + COLUMNAR_PAGE_DATA_OFFSET);
+	Assert(header->magic == COLUMNAR_MAGIC);
+	header->xmin = xmin;
+	GenericXLogFinish(state);
+
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Are the rows of a stripe visible to the given snapshot?
+ *
+ * All rows of a stripe were inserted by the same command, so this is like
+ * checking the visibility of a heap tuple that has never been deleted.
+ */
+bool
+columnar_stripe_visible(ColumnarStripeHeader *header, Snapshot snapshot)
+{
+	TransactionId xmin = header->xmin;
+
+	if (xmin == FrozenTransactionId)
+		return true;
+	if (!TransactionIdIsNormal(xmin))
+		return false;			/* inserting transaction aborted */
+
+	switch (snapshot->snapshot_type)
+	{
+		case SNAPSHOT_ANY:
+			return true;
+
+		case SNAPSHOT_MVCC:
+			if (TransactionIdIsCurrentTransactionId(xmin))
+				return header->cid < snapshot->curcid;
+			if (XidInMVCCSnapshot(xmin, snapshot))
+				return false;
+			return TransactionIdDidCommit(xmin);
+
+		case SNAPSHOT_HISTORIC_MVCC:
+			elog(ERROR, "columnar tables cannot be used in logical decoding");
+			return false;		/* keep compiler quiet */
+
+		default:
+
+			/*
+			 * SnapshotSelf, SnapshotDirty and the like see the effects of all
+			 * commands of the current transaction, and of all committed
+			 * transactions.
+			 */
+			if (TransactionIdIsCurrentTransactionId(xmin))
+				return true;
+			if (TransactionIdIsInProgress(xmin))
+				return false;
+			return TransactionIdDidCommit(xmin);
+	}
+}
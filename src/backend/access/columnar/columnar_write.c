@@ -0,0 +1,663 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar_write.c
+ *	  Collecting rows of the columnar table access method into stripes.
+ *
+ * Rows inserted into a columnar table are collected in memory, in a write
+ * state per table, until a stripe's worth of them has been gathered, or until
+ * something needs to see them on disk: the end of the command that inserted
+ * them (noticed when the next command inserts into the table, or scans it),
+ * or the commit of the transaction.  Rows of an aborted subtransaction that
+ * are still in memory are simply thrown away.
+ *
+ * Each row gets its row number, and hence its TID, when it is inserted.
+ * Row numbers are reserved from the metapage in ranges that grow as more
+ * rows are inserted, so that bulk loads don't have to lock the metapage for
+ * every row.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/columnar/columnar_write.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/columnar.h"
+#include "access/detoast.h"
+#include "access/relation.h"
+#include "access/tupmacs.h"
+#include "access/xact.h"
+#include "common/pg_lzcompress.h"
+#include "lib/stringinfo.h"
+#include "utils/datum.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/typcache.h"
+
+/* Flag bits in the first byte of a chunk */
+#define COLUMNAR_CHUNK_HAS_NULLS	0x01
+
+/* Write states of the current transaction, allocated in TopTransactionContext */
+static List *pending_writes = NIL;
+static bool callbacks_registered = false;
+
+static void columnar_xact_callback(XactEvent event, void *arg);
+static void columnar_subxact_callback(SubXactEvent event,
+									  SubTransactionId mySubid,
+									  SubTransactionId parentSubid,
+									  void *arg);
+static void columnar_flush_all_pending(void);
+static void columnar_remove_pending(ColumnarWriteState *state);
+static void append_zeros(StringInfo buf, int len);
+static void encode_chunk(StringInfo buf, Form_pg_attribute att,
+						 Datum *values, bool *isnull, int nrows);
+static void encode_stripe(ColumnarWriteState *state, StringInfo stripe);
+
+
+/*
+ * Create a write state for rows inserted into 'rel' by command 'cid' of
+ * transaction 'xid'.  It is allocated in a new child of CurrentMemoryContext.
+ */
+ColumnarWriteState *
+columnar_begin_write(Relation rel, TransactionId xid, CommandId cid)
+{
+	MemoryContext cxt;
+	MemoryContext oldcxt;
+	ColumnarWriteState *state;
+	int			natts = RelationGetDescr(rel)->natts;
+	int			i;
+
+	cxt = AllocSetContextCreate(CurrentMemoryContext,
+								"columnar write state",
+								ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(cxt);
+
+	state = palloc0(sizeof(ColumnarWriteState));
+	state->relid = RelationGetRelid(rel);
+	state->relnode = rel->rd_node;
+	state->tupdesc = CreateTupleDescCopy(RelationGetDescr(rel));
+	state->xid = xid;
+	state->cid = cid;
+	state->subxid = GetCurrentSubTransactionId();
+	state->capacity = 64;
+	state->values = palloc(sizeof(Datum *) * natts);
+	state->isnull = palloc(sizeof(bool *) * natts);
+	for (i = 0; i < natts; i++)
+	{
+		state->values[i] = palloc(sizeof(Datum) * state->capacity);
+		state->isnull[i] = palloc(sizeof(bool) * state->capacity);
+	}
+	state->cxt = cxt;
+	state->rowcxt = AllocSetContextCreate(cxt,
+										  "columnar write rows",
+										  ALLOCSET_DEFAULT_SIZES);
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return state;
+}
+
+/*
+ * Add a row to a write state, and return its row number.  The values are
+ * copied.
+ */
+uint64
+columnar_append_row(Relation rel, ColumnarWriteState *state,
+					Datum *values, bool *isnull)
+{
+	TupleDesc	tupdesc = state->tupdesc;
+	MemoryContext oldcxt;
+	int			i;
+
+	if (state->nrows >= COLUMNAR_STRIPE_ROWS ||
+		MemoryContextMemAllocated(state->rowcxt, true) >= COLUMNAR_STRIPE_MAX_BYTES)
+		columnar_flush_write(rel, state);
+
+	/* Reserve more row numbers if we have used up the ones we have */
+	if (state->nrows == state->nreserved)
+	{
+		uint32		n = Min(Max(16, state->nrows),
+							COLUMNAR_STRIPE_ROWS - state->nrows);
+		uint64		first = columnar_reserve_rows(rel, n);
+
+		if (first == state->first_row + state->nreserved)
+			state->nreserved += n;
+		else
+		{
+			/* Someone else got in between; start a new stripe */
+			columnar_flush_write(rel, state);
+			state->first_row = first;
+			state->nreserved = n;
+		}
+	}
+
+	if (state->nrows == state->capacity)
+	{
+		state->capacity = Min(state->capacity * 2, COLUMNAR_STRIPE_ROWS);
+		for (i = 0; i < tupdesc->natts; i++)
+		{
+			state->values[i] = repalloc(state->values[i],
+										sizeof(Datum) * state->capacity);
+			state->isnull[i] = repalloc(state->isnull[i],
+										sizeof(bool) * state->capacity);
+		}
+	}
+
+	oldcxt = MemoryContextSwitchTo(state->rowcxt);
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+		Datum		value = values[i];
+
+		state->isnull[i][state->nrows] = isnull[i] || att->attisdropped;
+		if (state->isnull[i][state->nrows])
+		{
+			state->values[i][state->nrows] = (Datum) 0;
+			continue;
+		}
+
+		/* Store varlenas plain, so that the chunk compression can work */
+		if (att->attlen == -1 && VARATT_IS_EXTENDED(DatumGetPointer(value)))
+			value = PointerGetDatum(detoast_attr((struct varlena *) DatumGetPointer(value)));
+		else if (!att->attbyval)
+			value = datumCopy(value, att->attbyval, att->attlen);
+
+		state->values[i][state->nrows] = value;
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	return state->first_row + state->nrows++;
+}
+
+/*
+ * Write out the rows collected in a write state as a new stripe.  Row numbers
+ * reserved but not used yet remain reserved for subsequent rows.
+ */
+void
+columnar_flush_write(Relation rel, ColumnarWriteState *state)
+{
+	StringInfoData stripe;
+	MemoryContext tmpcxt;
+	MemoryContext oldcxt;
+
+	if (state->nrows == 0)
+		return;
+
+	tmpcxt = AllocSetContextCreate(CurrentMemoryContext,
+								   "columnar stripe encoding",
+								   ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(tmpcxt);
+
+	initStringInfo(&stripe);
+	encode_stripe(state, &stripe);
+	columnar_write_stripe(rel, stripe.data);
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(tmpcxt);
+
+	state->first_row += state->nrows;
+	state->nreserved -= state->nrows;
+	state->nrows = 0;
+	MemoryContextReset(state->rowcxt);
+}
+
+/*
+ * Release a write state.  Rows not flushed yet are lost.
+ */
+void
+columnar_end_write(ColumnarWriteState *state)
+{
+	MemoryContextDelete(state->cxt);
+}
+
+/*
+ * Pad a buffer with zero bytes.
+ */
+static void
+append_zeros(StringInfo buf, int len)
+{
+	if (len <= 0)
+		return;
+	enlargeStringInfo(buf, len);
+	memset(buf->data + buf->len, 0, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+/*
+ * Encode the values of one column of a chunk group: a flag byte, a null
+ * bitmap if there are NULLs, and then the non-null values laid out as in a
+ * heap tuple, starting at a MAXALIGN'd offset.
+ */
+static void
+encode_chunk(StringInfo buf, Form_pg_attribute att,
+			 Datum *values, bool *isnull, int nrows)
+{
+	bool		hasnulls = false;
+	int			start = buf->len;
+	int			i;
+
+	for (i = 0; i < nrows; i++)
+		if (isnull[i])
+			hasnulls = true;
+
+	appendStringInfoChar(buf, hasnulls ? COLUMNAR_CHUNK_HAS_NULLS : 0);
+	if (hasnulls)
+	{
+		int			bitmaplen = (nrows + 7) / 8;
+		bits8	   *bitmap;
+
+		append_zeros(buf, bitmaplen);
+		bitmap = (bits8 *) (buf->data + buf->len - bitmaplen);
+		for (i = 0; i < nrows; i++)
+			if (!isnull[i])
+				bitmap[i / 8] |= 1 << (i % 8);
+	}
+	append_zeros(buf, MAXALIGN(buf->len - start) - (buf->len - start));
+
+	for (i = 0; i < nrows; i++)
+	{
+		Datum		value = values[i];
+		int			off = buf->len - start;
+
+		if (isnull[i])
+			continue;
+
+		if (att->attbyval)
+		{
+			Datum		tmp;
+
+			append_zeros(buf, att_align_nominal(off, att->attalign) - off);
+			store_att_byval(&tmp, value, att->attlen);
+			appendBinaryStringInfo(buf, (char *) &tmp, att->attlen);
+		}
+		else if (att->attlen == -1)
+		{
+			Pointer		val = DatumGetPointer(value);
+
+			if (VARATT_IS_SHORT(val))
+				appendBinaryStringInfo(buf, val, VARSIZE_SHORT(val));
+			else if (VARATT_CAN_MAKE_SHORT(val))
+			{
+				/* convert to short varlena, as heap_fill_tuple does */
+				char		hdr;
+
+				SET_VARSIZE_1B(&hdr, VARATT_CONVERTED_SHORT_SIZE(val));
+				appendStringInfoChar(buf, hdr);
+				appendBinaryStringInfo(buf, VARDATA(val),
+									   VARSIZE(val) - VARHDRSZ);
+			}
+			else
+			{
+				append_zeros(buf, att_align_nominal(off, att->attalign) - off);
+				appendBinaryStringInfo(buf, val, VARSIZE(val));
+			}
+		}
+		else if (att->attlen == -2)
+		{
+			/* cstring ... never needs alignment */
+			Assert(att->attalign == TYPALIGN_CHAR);
+			appendBinaryStringInfo(buf, DatumGetCString(value),
+								   strlen(DatumGetCString(value)) + 1);
+		}
+		else
+		{
+			/* fixed-length pass-by-reference */
+			append_zeros(buf, att_align_nominal(off, att->attalign) - off);
+			appendBinaryStringInfo(buf, DatumGetPointer(value), att->attlen);
+		}
+	}
+}
+
+/*
+ * Build the byte stream of a stripe holding the rows of a write state.
+ */
+static void
+encode_stripe(ColumnarWriteState *state, StringInfo stripe)
+{
+	TupleDesc	tupdesc = state->tupdesc;
+	int			natts = tupdesc->natts;
+	uint32		nchunks = (state->nrows + COLUMNAR_CHUNK_ROWS - 1) / COLUMNAR_CHUNK_ROWS;
+	ColumnarStripeHeader header;
+	ColumnarChunk *chunks;
+	StringInfoData minmax;
+	StringInfoData data;
+	StringInfoData raw;
+	char	   *compressed;
+	int32		compressed_size;
+	TypeCacheEntry **typentries;
+	uint32		chunkno;
+	int			attno;
+
+	chunks = palloc0(sizeof(ColumnarChunk) * nchunks * natts);
+	typentries = palloc0(sizeof(TypeCacheEntry *) * natts);
+	for (attno = 1; attno <= natts; attno++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, attno - 1);
+
+		if (!att->attisdropped)
+			typentries[attno - 1] = lookup_type_cache(att->atttypid,
+													  TYPECACHE_CMP_PROC_FINFO);
+	}
+
+	initStringInfo(&minmax);
+	initStringInfo(&data);
+	initStringInfo(&raw);
+	compressed_size = PGLZ_MAX_OUTPUT(BLCKSZ);
+	compressed = palloc(compressed_size);
+
+	for (chunkno = 0; chunkno < nchunks; chunkno++)
+	{
+		int			first = chunkno * COLUMNAR_CHUNK_ROWS;
+		int			nrows = Min(state->nrows - first, COLUMNAR_CHUNK_ROWS);
+
+		for (attno = 1; attno <= natts; attno++)
+		{
+			Form_pg_attribute att = TupleDescAttr(tupdesc, attno - 1);
+			ColumnarChunk *chunk = &chunks[chunkno * natts + attno - 1];
+			Datum	   *values = state->values[attno - 1] + first;
+			bool	   *isnull = state->isnull[attno - 1] + first;
+			TypeCacheEntry *typentry = typentries[attno - 1];
+			int			minidx = -1;
+			int			maxidx = -1;
+			int			i;
+			int32		clen;
+
+			/* Find the minimum and maximum, if the type has an ordering */
+			for (i = 0; i < nrows; i++)
+			{
+				if (isnull[i])
+					continue;
+				if (minidx < 0)
+				{
+					minidx = maxidx = i;
+					continue;
+				}
+				if (typentry == NULL || !OidIsValid(typentry->cmp_proc))
+					break;
+				if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+													att->attcollation,
+													values[i],
+													values[minidx])) < 0)
+					minidx = i;
+				else if (DatumGetInt32(FunctionCall2Coll(&typentry->cmp_proc_finfo,
+														 att->attcollation,
+														 values[i],
+														 values[maxidx])) > 0)
+					maxidx = i;
+			}
+
+			/* A chunk of all NULLs takes no space */
+			if (minidx < 0)
+				continue;
+
+			if (typentry != NULL && OidIsValid(typentry->cmp_proc))
+			{
+				Size		len;
+				char	   *ptr;
+
+				len = datumEstimateSpace(values[minidx], false,
+										 att->attbyval, att->attlen) +
+					datumEstimateSpace(values[maxidx], false,
+									   att->attbyval, att->attlen);
+				chunk->minmax_offset = minmax.len + 1;	/* 0 means none */
+				enlargeStringInfo(&minmax, len);
+				ptr = minmax.data + minmax.len;
+				datumSerialize(values[minidx], false, att->attbyval,
+							   att->attlen, &ptr);
+				datumSerialize(values[maxidx], false, att->attbyval,
+							   att->attlen, &ptr);
+				minmax.len = ptr - minmax.data;
+			}
+
+			resetStringInfo(&raw);
+			encode_chunk(&raw, att, values, isnull, nrows);
+
+			chunk->offset = data.len;
+			chunk->rawsize = raw.len;
+			if (PGLZ_MAX_OUTPUT(raw.len) > compressed_size)
+			{
+				compressed_size = PGLZ_MAX_OUTPUT(raw.len);
+				compressed = repalloc(compressed, compressed_size);
+			}
+			clen = pglz_compress(raw.data, raw.len, compressed,
+								 PGLZ_strategy_default);
+			if (clen >= 0 && clen < raw.len)
+			{
+				chunk->size = clen;
+				appendBinaryStringInfo(&data, compressed, clen);
+			}
+			else
+			{
+				chunk->size = raw.len;
+				appendBinaryStringInfo(&data, raw.data, raw.len);
+			}
+		}
+	}
+
+	/* Now assemble the stripe, and make the offsets absolute */
+	memset(&header, 0, sizeof(header));
+	header.magic = COLUMNAR_MAGIC;
+	header.xmin = state->xid;
+	header.cid = state->cid;
+	header.nrows = state->nrows;
+	header.first_row = state->first_row;
+	header.nchunks = nchunks;
+	header.natts = natts;
+	header.minmax_start = COLUMNAR_CHUNK_DIR_OFFSET +
+		sizeof(ColumnarChunk) * nchunks * natts;
+	header.data_start = header.minmax_start + minmax.len;
+	header.size = header.data_start + data.len;
+	header.nblocks = (header.size + COLUMNAR_PAGE_DATA_SIZE - 1) / COLUMNAR_PAGE_DATA_SIZE;
+
+	for (chunkno = 0; chunkno < nchunks * natts; chunkno++)
+	{
+		chunks[chunkno].offset += header.data_start;
+		if (chunks[chunkno].minmax_offset != 0)
+			chunks[chunkno].minmax_offset += header.minmax_start - 1;
+	}
+
+	appendBinaryStringInfo(stripe, (char *) &header, sizeof(header));
+	append_zeros(stripe, COLUMNAR_CHUNK_DIR_OFFSET - sizeof(header));
+	appendBinaryStringInfo(stripe, (char *) chunks,
+						   sizeof(ColumnarChunk) * nchunks * natts);
+	appendBinaryStringInfo(stripe, minmax.data, minmax.len);
+	appendBinaryStringInfo(stripe, data.data, data.len);
+	Assert(stripe->len == header.size);
+}
+
+/*
+ * Insert a row into a columnar table, on behalf of the current transaction.
+ * The row's TID is stored in slot->tts_tid.
+ */
+void
+columnar_insert_row(Relation rel, TupleTableSlot *slot, CommandId cid)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	ColumnarWriteState *state = columnar_find_pending(rel);
+	uint64		rownum;
+
+	if (!callbacks_registered)
+	{
+		RegisterXactCallback(columnar_xact_callback, NULL);
+		RegisterSubXactCallback(columnar_subxact_callback, NULL);
+		callbacks_registered = true;
+	}
+
+	/*
+	 * A stripe holds the rows of one command of one subtransaction, in one
+	 * version of the table's row type.
+	 */
+	if (state != NULL &&
+		(state->xid != xid || state->cid != cid ||
+		 state->tupdesc->natts != RelationGetDescr(rel)->natts))
+	{
+		columnar_flush_write(rel, state);
+		columnar_remove_pending(state);
+		state = NULL;
+	}
+
+	if (state == NULL)
+	{
+		MemoryContext oldcxt = MemoryContextSwitchTo(TopTransactionContext);
+
+		state = columnar_begin_write(rel, xid, cid);
+		pending_writes = lappend(pending_writes, state);
+		MemoryContextSwitchTo(oldcxt);
+	}
+
+	slot_getallattrs(slot);
+	rownum = columnar_append_row(rel, state, slot->tts_values, slot->tts_isnull);
+
+	columnar_row_to_tid(rownum, &slot->tts_tid);
+	slot->tts_tableOid = RelationGetRelid(rel);
+}
+
+/*
+ * Return the write state holding rows inserted into 'rel' by the current
+ * transaction, or NULL if there is none.
+ */
+ColumnarWriteState *
+columnar_find_pending(Relation rel)
+{
+	ListCell   *lc;
+
+	foreach(lc, pending_writes)
+	{
+		ColumnarWriteState *state = (ColumnarWriteState *) lfirst(lc);
+
+		if (state->relid == RelationGetRelid(rel))
+			return state;
+	}
+
+	return NULL;
+}
+
+/*
+ * Forget about a write state of the current transaction and release it.
+ */
+static void
+columnar_remove_pending(ColumnarWriteState *state)
+{
+	pending_writes = list_delete_ptr(pending_writes, state);
+	columnar_end_write(state);
+}
+
+/*
+ * Write out the rows the current transaction has inserted into 'rel', so
+ * that they can be seen by a scan.
+ */
+void
+columnar_flush_pending(Relation rel)
+{
+	ColumnarWriteState *state = columnar_find_pending(rel);
+
+	if (state == NULL)
+		return;
+
+	columnar_flush_write(rel, state);
+	columnar_remove_pending(state);
+}
+
+/*
+ * Throw away the rows the current transaction has inserted into 'rel' and
+ * not written out yet.  Used when the table's contents are being replaced.
+ */
+void
+columnar_discard_pending(Relation rel)
+{
+	ColumnarWriteState *state = columnar_find_pending(rel);
+
+	if (state != NULL)
+		columnar_remove_pending(state);
+}
+
+/*
+ * Write out all rows inserted by the current transaction.
+ */
+static void
+columnar_flush_all_pending(void)
+{
+	while (pending_writes != NIL)
+	{
+		ColumnarWriteState *state = (ColumnarWriteState *) linitial(pending_writes);
+		Relation	rel;
+
+		/*
+		 * The table may have been dropped, or its contents replaced, after
+		 * the rows were inserted; then they are gone with it.
+		 */
+		rel = try_relation_open(state->relid, RowExclusiveLock);
+		if (rel != NULL)
+		{
+			if (RelFileNodeEquals(rel->rd_node, state->relnode))
+				columnar_flush_write(rel, state);
+			relation_close(rel, NoLock);
+		}
+
+		columnar_remove_pending(state);
+	}
+}
+
+static void
+columnar_xact_callback(XactEvent event, void *arg)
+{
+	switch (event)
+	{
+		case XACT_EVENT_PRE_COMMIT:
+		case XACT_EVENT_PARALLEL_PRE_COMMIT:
+		case XACT_EVENT_PRE_PREPARE:
+			columnar_flush_all_pending();
+			break;
+
+		case XACT_EVENT_COMMIT:
+		case XACT_EVENT_PARALLEL_COMMIT:
+		case XACT_EVENT_ABORT:
+		case XACT_EVENT_PARALLEL_ABORT:
+		case XACT_EVENT_PREPARE:
+			/* the states went away with TopTransactionContext */
+			pending_writes = NIL;
+			break;
+	}
+}
+
+static void
+columnar_subxact_callback(SubXactEvent event, SubTransactionId mySubid,
+						  SubTransactionId parentSubid, void *arg)
+{
+	ListCell   *lc;
+
+	switch (event)
+	{
+		case SUBXACT_EVENT_COMMIT_SUB:
+			foreach(lc, pending_writes)
+			{
+				ColumnarWriteState *state = (ColumnarWriteState *) lfirst(lc);
+
+				if (state->subxid == mySubid)
+					state->subxid = parentSubid;
+			}
+			break;
+
+		case SUBXACT_EVENT_ABORT_SUB:
+			foreach(lc, pending_writes)
+			{
+				ColumnarWriteState *state = (ColumnarWriteState *) lfirst(lc);
+
+				if (state->subxid == mySubid)
+				{
+					pending_writes = foreach_delete_current(pending_writes, lc);
+					columnar_end_write(state);
+				}
+			}
+			break;
+
+		default:
+			break;
+	}
+}
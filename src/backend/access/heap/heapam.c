@@ -1646,6 +1646,51 @@ heap_hot_search_buffer(ItemPointer tid, Relation relation, Buffer buffer,
 	return false;
 }
 
+/*
+ *	heap_hot_chain_is_warm	- has the HOT chain of a tuple had a WARM update?
+ *
+ * heapTuple is a member of a HOT chain on the buffer's page, as returned by
+ * heap_hot_search_buffer.  If the chain has had a WARM update, index entries
+ * pointing to its root don't necessarily match all of its members, so index
+ * scans must recheck their keys against the tuple (see README.HOT).
+ *
+ * Since tuples are marked from the WARM update onwards, we only need to look
+ * at this tuple and the ones after it.  The caller must hold pin and (at
+ * least) share lock on the buffer.
+ */
+bool
+heap_hot_chain_is_warm(Buffer buffer, HeapTuple heapTuple)
+{
+	Page		dp = (Page) BufferGetPage(buffer);
+	HeapTupleHeader htup = heapTuple->t_data;
+	int			nchecked = 0;
+
+	while (!HeapTupleHeaderIsWarm(htup))
+	{
+		TransactionId prev_xmax;
+		OffsetNumber offnum;
+		ItemId		lp;
+
+		if (!HeapTupleHeaderIsHotUpdated(htup) ||
+			++nchecked > MaxHeapTuplesPerPage)
+			return false;
+
+		prev_xmax = HeapTupleHeaderGetUpdateXid(htup);
+		offnum = ItemPointerGetOffsetNumber(&htup->t_ctid);
+		if (offnum < FirstOffsetNumber || offnum > PageGetMaxOffsetNumber(dp))
+			return false;
+		lp = PageGetItemId(dp, offnum);
+		if (!ItemIdIsNormal(lp))
+			return false;
+
+		htup = (HeapTupleHeader) PageGetItem(dp, lp);
+		if (!TransactionIdEquals(prev_xmax, HeapTupleHeaderGetXmin(htup)))
+			return false;
+	}
+
+	return true;
+}
+
 /*
  *	heap_get_latest_tid -  get the latest tid of a specified tuple
  *
@@ -1810,6 +1855,10 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->reserved_rel = NULL;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->already_extended_by = 0;
 	return bistate;
 }
 
@@ -1821,6 +1870,7 @@ FreeBulkInsertState(BulkInsertState bistate)
 {
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
+	BulkInsertStateReleaseReserved(bistate);
 	FreeAccessStrategy(bistate->strategy);
 	pfree(bistate);
 }
@@ -1834,6 +1884,10 @@ ReleaseBulkInsertStatePin(BulkInsertState bistate)
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	bistate->current_buf = InvalidBuffer;
+
+	/* we may go on with another relation, so give up the reserved pages */
+	BulkInsertStateReleaseReserved(bistate);
+	bistate->already_extended_by = 0;
 }
 
 
@@ -2044,15 +2098,23 @@ heap_prepare_insert(Relation relation, HeapTuple tup, TransactionId xid,
 					CommandId cid, int options)
 {
 	/*
-	 * To allow parallel inserts, we need to ensure that they are safe to be
-	 * performed in workers. We have the infrastructure to allow parallel
-	 * inserts in general except for the cases where inserts generate a new
-	 * CommandId (eg. inserts into a table having a foreign key column).
+	 * Parallel workers may insert tuples, as long as the inserts don't need
+	 * a new CommandId (eg. inserts into a table having a foreign key column).
+	 * The planner makes sure of that, and the leader assigns the XID and
+	 * marks the command ID as used before the workers are started.  So a
+	 * worker must be inserting under exactly the XID and command ID it
+	 * shares with the leader, and that command ID must already be marked as
+	 * used, since there is no way to tell the leader about it afterwards.
 	 */
 	if (IsParallelWorker())
-		ereport(ERROR,
-				(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
-				 errmsg("cannot insert tuples in a parallel worker")));
+	{
+		if (cid != GetCurrentCommandId(false))
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_TRANSACTION_STATE),
+					 errmsg("cannot insert tuples in a parallel worker")));
+		Assert(IsCurrentCommandIdUsed());
+		Assert(TransactionIdEquals(xid, GetCurrentTransactionIdIfAny()));
+	}
 
 	tup->t_data->t_infomask &= ~(HEAP_XACT_MASK);
 	tup->t_data->t_infomask2 &= ~(HEAP2_XACT_MASK);
@@ -2892,13 +2954,15 @@ simple_heap_delete(Relation relation, ItemPointer tid)
 TM_Result
 heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 			CommandId cid, Snapshot crosscheck, bool wait,
-			TM_FailureData *tmfd, LockTupleMode *lockmode)
+			TM_FailureData *tmfd, LockTupleMode *lockmode,
+			TU_IndexUpdate *update_indexes)
 {
 	TM_Result	result;
 	TransactionId xid = GetCurrentTransactionId();
 	Bitmapset  *hot_attrs;
 	Bitmapset  *key_attrs;
 	Bitmapset  *id_attrs;
+	Bitmapset  *warm_block_attrs = NULL;
 	Bitmapset  *interesting_attrs;
 	Bitmapset  *modified_attrs;
 	ItemId		lp;
@@ -2920,6 +2984,9 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	bool		iscombo;
 	bool		use_hot_update = false;
 	bool		hot_attrs_checked = false;
+	bool		warm_allowed;
+	bool		use_warm_update = false;
+	OffsetNumber root_offnum = InvalidOffsetNumber;
 	bool		key_intact;
 	bool		all_visible_cleared = false;
 	bool		all_visible_cleared_new = false;
@@ -2965,6 +3032,21 @@ heap_update(Relation relation, ItemPointer otid, HeapTuple newtup,
 	id_attrs = RelationGetIndexAttrBitmap(relation,
 										  INDEX_ATTR_BITMAP_IDENTITY_KEY);
 
+	/*
+	 * If the caller can insert index entries for a WARM update, we'll also
+	 * need the columns of indexes that rule it out.  Catalogs are scanned in
+	 * too many places that can't deal with WARM chains; see README.HOT.
+	 */
+	warm_allowed = update_indexes != NULL && !IsCatalogRelation(relation);
+	if (warm_allowed)
+		warm_block_attrs = RelationGetIndexAttrBitmap(relation,
+													  INDEX_ATTR_BITMAP_WARM_BLOCKING);
+
+	if (update_indexes != NULL)
+	{
+		update_indexes->required = false;
+		update_indexes->modified_attrs = NULL;
+	}
 
 	block = ItemPointerGetBlockNumber(otid);
 	buffer = ReadBuffer(relation, block);
@@ -3288,6 +3370,7 @@ l2:
 		bms_free(hot_attrs);
 		bms_free(key_attrs);
 		bms_free(id_attrs);
+		bms_free(warm_block_attrs);
 		bms_free(modified_attrs);
 		bms_free(interesting_attrs);
 		return result;
@@ -3598,6 +3681,34 @@ l2:
 		 */
 		if (hot_attrs_checked && !bms_overlap(modified_attrs, hot_attrs))
 			use_hot_update = true;
+		else if (hot_attrs_checked && warm_allowed &&
+				 !HeapTupleIsWarm(&oldtup) &&
+				 !bms_overlap(modified_attrs, warm_block_attrs))
+		{
+			/*
+			 * Only indexes that can recheck their entries against the heap
+			 * see modified columns, so we can still do a WARM update: like a
+			 * HOT update, but the caller inserts new entries into those
+			 * indexes, pointing to the root of the HOT chain.  Only one is
+			 * allowed per HOT chain, so that the indexes never get two
+			 * entries with the same key for a chain.
+			 */
+			if (HeapTupleIsHeapOnly(&oldtup))
+			{
+				OffsetNumber root_offsets[MaxHeapTuplesPerPage];
+
+				heap_get_root_tuples(page, root_offsets);
+				root_offnum = root_offsets[ItemPointerGetOffsetNumber(otid) - 1];
+			}
+			else
+				root_offnum = ItemPointerGetOffsetNumber(otid);
+
+			if (OffsetNumberIsValid(root_offnum))
+			{
+				use_hot_update = true;
+				use_warm_update = true;
+			}
+		}
 	}
 	else
 	{
@@ -3640,6 +3751,18 @@ l2:
 		HeapTupleSetHeapOnly(heaptup);
 		/* Mark the caller's copy too, in case different from heaptup */
 		HeapTupleSetHeapOnly(newtup);
+
+		/*
+		 * After a WARM update, every tuple in the rest of the chain is marked
+		 * as such.  So is the old tuple, so that we don't do another one if
+		 * this one aborts.
+		 */
+		if (use_warm_update || HeapTupleIsWarm(&oldtup))
+		{
+			HeapTupleSetWarm(&oldtup);
+			HeapTupleSetWarm(heaptup);
+			HeapTupleSetWarm(newtup);
+		}
 	}
 	else
 	{
@@ -3743,7 +3866,18 @@ l2:
 	if (have_tuple_lock)
 		UnlockTupleTuplock(relation, &(oldtup.t_self), *lockmode);
 
-	pgstat_count_heap_update(relation, use_hot_update);
+	pgstat_count_heap_update(relation, use_hot_update && !use_warm_update);
+
+	if (update_indexes != NULL)
+	{
+		update_indexes->required = !use_hot_update || use_warm_update;
+		if (use_warm_update)
+		{
+			update_indexes->modified_attrs = bms_intersect(modified_attrs,
+														   hot_attrs);
+			ItemPointerSet(&update_indexes->root_tid, block, root_offnum);
+		}
+	}
 
 	/*
 	 * If heaptup is a private copy, release it.  Don't forget to copy t_self
@@ -3761,6 +3895,7 @@ l2:
 	bms_free(hot_attrs);
 	bms_free(key_attrs);
 	bms_free(id_attrs);
+	bms_free(warm_block_attrs);
 	bms_free(modified_attrs);
 	bms_free(interesting_attrs);
 
@@ -3891,7 +4026,7 @@ simple_heap_update(Relation relation, ItemPointer otid, HeapTuple tup)
 	result = heap_update(relation, otid, tup,
 						 GetCurrentCommandId(true), InvalidSnapshot,
 						 true /* wait for commit */ ,
-						 &tmfd, &lockmode);
+						 &tmfd, &lockmode, NULL);
 	switch (result)
 	{
 		case TM_SelfModified:
@@ -6104,6 +6239,13 @@ FreezeMultiXactId(MultiXactId multi, uint16 t_infomask,
  *
  * Caller is responsible for setting the offset field, if appropriate.
  *
+ * *relfrozenxid_out and *relminmxid_out are lowered, if needed, to the oldest
+ * XID and MultiXactId that will remain in the tuple after these operations.
+ * By starting them at the oldest values that can appear in new tuples and
+ * passing them for every remaining tuple of a table, VACUUM finds values it
+ * can set relfrozenxid and relminmxid to, which are often much newer than
+ * the cutoffs.
+ *
  * It is assumed that the caller has checked the tuple with
  * HeapTupleSatisfiesVacuum() and determined that it is not HEAPTUPLE_DEAD
  * (else we should be removing the tuple, not freezing it).
@@ -6126,7 +6268,9 @@ bool
 heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 						  TransactionId relfrozenxid, TransactionId relminmxid,
 						  TransactionId cutoff_xid, TransactionId cutoff_multi,
-						  xl_heap_freeze_tuple *frz, bool *totally_frozen_p)
+						  xl_heap_freeze_tuple *frz, bool *totally_frozen_p,
+						  TransactionId *relfrozenxid_out,
+						  MultiXactId *relminmxid_out)
 {
 	bool		changed = false;
 	bool		xmax_already_frozen = false;
@@ -6170,6 +6314,8 @@ heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 			frz->t_infomask |= HEAP_XMIN_FROZEN;
 			changed = true;
 		}
+		else if (TransactionIdPrecedes(xid, *relfrozenxid_out))
+			*relfrozenxid_out = xid;
 	}
 
 	/*
@@ -6208,6 +6354,9 @@ heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 			if (flags & FRM_MARK_COMMITTED)
 				frz->t_infomask |= HEAP_XMAX_COMMITTED;
 			changed = true;
+
+			if (TransactionIdPrecedes(newxmax, *relfrozenxid_out))
+				*relfrozenxid_out = newxmax;
 		}
 		else if (flags & FRM_RETURN_IS_MULTI)
 		{
@@ -6230,6 +6379,21 @@ heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 
 			changed = true;
 		}
+
+		/*
+		 * If a multi remains, FreezeMultiXactId made sure that none of its
+		 * members is older than cutoff_xid.  We don't bother to look for the
+		 * oldest one.
+		 */
+		if (!freeze_xmax && !(flags & FRM_RETURN_IS_XID))
+		{
+			MultiXactId multi = (flags & FRM_RETURN_IS_MULTI) ? newxmax : xid;
+
+			if (MultiXactIdPrecedes(multi, *relminmxid_out))
+				*relminmxid_out = multi;
+			if (TransactionIdPrecedes(cutoff_xid, *relfrozenxid_out))
+				*relfrozenxid_out = cutoff_xid;
+		}
 	}
 	else if (TransactionIdIsNormal(xid))
 	{
@@ -6256,7 +6420,11 @@ heap_prepare_freeze_tuple(HeapTupleHeader tuple,
 			freeze_xmax = true;
 		}
 		else
+		{
 			freeze_xmax = false;
+			if (TransactionIdPrecedes(xid, *relfrozenxid_out))
+				*relfrozenxid_out = xid;
+		}
 	}
 	else if ((tuple->t_infomask & HEAP_XMAX_INVALID) ||
 			 !TransactionIdIsValid(HeapTupleHeaderGetRawXmax(tuple)))
@@ -6380,11 +6548,14 @@ heap_freeze_tuple(HeapTupleHeader tuple,
 	xl_heap_freeze_tuple frz;
 	bool		do_freeze;
 	bool		tuple_totally_frozen;
+	TransactionId relfrozenxid_out = cutoff_xid;
+	MultiXactId relminmxid_out = cutoff_multi;
 
 	do_freeze = heap_prepare_freeze_tuple(tuple,
 										  relfrozenxid, relminmxid,
 										  cutoff_xid, cutoff_multi,
-										  &frz, &tuple_totally_frozen);
+										  &frz, &tuple_totally_frozen,
+										  &relfrozenxid_out, &relminmxid_out);
 
 	/*
 	 * Note that because this is not a WAL-logged operation, we don't need to
@@ -7384,6 +7555,8 @@ log_heap_update(Relation reln, Buffer oldbuf,
 		xlrec.flags |= XLH_UPDATE_PREFIX_FROM_OLD;
 	if (suffixlen > 0)
 		xlrec.flags |= XLH_UPDATE_SUFFIX_FROM_OLD;
+	if (HeapTupleIsWarm(oldtup))
+		xlrec.flags |= XLH_UPDATE_WARM;
 	if (need_tuple_data)
 	{
 		xlrec.flags |= XLH_UPDATE_CONTAINS_NEW_TUPLE;
@@ -8444,6 +8617,8 @@ heap_xlog_update(XLogReaderState *record, bool hot_update)
 			HeapTupleHeaderSetHotUpdated(htup);
 		else
 			HeapTupleHeaderClearHotUpdated(htup);
+		if (xlrec->flags & XLH_UPDATE_WARM)
+			HeapTupleHeaderSetWarm(htup);
 		fix_infomask_from_infobits(xlrec->old_infobits_set, &htup->t_infomask,
 								   &htup->t_infomask2);
 		HeapTupleHeaderSetXmax(htup, xlrec->old_xmax);
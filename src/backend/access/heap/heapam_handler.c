@@ -148,6 +148,8 @@ heapam_index_fetch_tuple(struct IndexFetchTableData *scan,
 											all_dead,
 											!*call_again);
 	bslot->base.tupdata.t_self = *tid;
+	scan->recheck_key = got_heap_tuple &&
+		heap_hot_chain_is_warm(hscan->xs_cbuf, &bslot->base.tupdata);
 	LockBuffer(hscan->xs_cbuf, BUFFER_LOCK_UNLOCK);
 
 	if (got_heap_tuple)
@@ -314,7 +316,7 @@ static TM_Result
 heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 					CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 					bool wait, TM_FailureData *tmfd,
-					LockTupleMode *lockmode, bool *update_indexes)
+					LockTupleMode *lockmode, TU_IndexUpdate *update_indexes)
 {
 	bool		shouldFree = true;
 	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
@@ -324,19 +326,16 @@ heapam_tuple_update(Relation relation, ItemPointer otid, TupleTableSlot *slot,
 	slot->tts_tableOid = RelationGetRelid(relation);
 	tuple->t_tableOid = slot->tts_tableOid;
 
-	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
-						 tmfd, lockmode);
-	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
-
 	/*
-	 * Decide whether new index entries are needed for the tuple
+	 * heap_update decides which index entries are needed for the tuple: none
+	 * for a HOT update, some for a WARM one.
 	 *
 	 * Note: heap_update returns the tid (location) of the new tuple in the
 	 * t_self field.
-	 *
-	 * If it's a HOT update, we mustn't insert new index entries.
 	 */
-	*update_indexes = result == TM_Ok && !HeapTupleIsHeapOnly(tuple);
+	result = heap_update(relation, otid, tuple, cid, crosscheck, wait,
+						 tmfd, lockmode, update_indexes);
+	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
 
 	if (shouldFree)
 		pfree(tuple);
@@ -606,7 +605,7 @@ heapam_relation_set_new_filenode(Relation rel,
 			   rel->rd_rel->relkind == RELKIND_MATVIEW ||
 			   rel->rd_rel->relkind == RELKIND_TOASTVALUE);
 		smgrcreate(srel, INIT_FORKNUM, false);
-		log_smgrcreate(newrnode, INIT_FORKNUM);
+		log_smgrcreate(newrnode, INIT_FORKNUM, 0);
 		smgrimmedsync(srel, INIT_FORKNUM);
 	}
 
@@ -663,7 +662,7 @@ heapam_relation_copy_data(Relation rel, const RelFileNode *newrnode)
 			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
 				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
 				 forkNum == INIT_FORKNUM))
-				log_smgrcreate(newrnode, forkNum);
+				log_smgrcreate(newrnode, forkNum, 0);
 			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
 								rel->rd_rel->relpersistence);
 		}
@@ -2148,7 +2147,18 @@ heapam_scan_bitmap_next_block(TableScanDesc scan,
 			ItemPointerSet(&tid, page, offnum);
 			if (heap_hot_search_buffer(&tid, scan->rs_rd, buffer, snapshot,
 									   &heapTuple, NULL, true))
+			{
 				hscan->rs_vistuples[ntup++] = ItemPointerGetOffsetNumber(&tid);
+
+				/*
+				 * The index entry may have a different key than the tuple,
+				 * if the chain has had a WARM update.  Make the caller
+				 * recheck the quals, like for a lossy page.
+				 */
+				if (!tbmres->recheck &&
+					heap_hot_chain_is_warm(buffer, &heapTuple))
+					tbmres->recheck = true;
+			}
 		}
 	}
 	else
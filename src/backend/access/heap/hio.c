@@ -188,87 +188,193 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 }
 
 /*
- * Extend a relation by multiple blocks to avoid future contention on the
- * relation extension lock.  Our goal is to pre-extend the relation by an
- * amount which ramps up as the degree of contention ramps up, but limiting
- * the result to some sane overall value.
+ * Maximum number of blocks a bulk insert reserves for itself with one
+ * extension, see RelationAddBlocks.
  */
-static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+#define MAX_BULK_EXTEND_BLOCKS	64
+
+/*
+ * Take the next block of the range that a bulk insert reserved for itself
+ * when it last extended the relation, or InvalidBlockNumber if there's none.
+ */
+static BlockNumber
+BulkInsertStateNextFree(BulkInsertState bistate)
 {
-	BlockNumber blockNum,
-				firstBlock = InvalidBlockNumber;
-	int			extraBlocks;
-	int			lockWaiters;
+	BlockNumber blkno;
 
-	/* Use the length of the lock wait queue to judge how much to extend. */
-	lockWaiters = RelationExtensionLockWaiterCount(relation);
-	if (lockWaiters <= 0)
-		return;
+	if (!bistate || bistate->next_free == InvalidBlockNumber)
+		return InvalidBlockNumber;
+
+	blkno = bistate->next_free;
+	if (blkno == bistate->last_free)
+		bistate->next_free = bistate->last_free = InvalidBlockNumber;
+	else
+		bistate->next_free++;
+
+	return blkno;
+}
+
+/*
+ * Give the pages that a bulk insert reserved for itself, but didn't use, to
+ * the FSM, so that other inserts can fill them.  Called when the bulk insert
+ * is done with the relation, and before it reserves more pages.
+ */
+void
+BulkInsertStateReleaseReserved(BulkInsertState bistate)
+{
+	Relation	relation = bistate->reserved_rel;
+	Size		freespace = BLCKSZ - SizeOfPageHeaderData;
+
+	if (bistate->next_free != InvalidBlockNumber)
+	{
+		for (BlockNumber blkno = bistate->next_free;
+			 blkno <= bistate->last_free; blkno++)
+			RecordPageWithFreeSpace(relation, blkno, freespace);
+
+		FreeSpaceMapVacuumRange(relation, bistate->next_free,
+								bistate->last_free + 1);
+	}
+
+	bistate->reserved_rel = NULL;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+}
+
+/*
+ * Extend a relation, returning the first new page initialized, pinned and
+ * exclusive-locked.
+ *
+ * If needLock, caller must hold the relation extension lock.  We release it
+ * as soon as the relation has been extended, rather than when the new pages
+ * have been handed out, so that the lock is held only for the bookkeeping.
+ *
+ * To avoid future contention on the extension lock, we add more than one
+ * block at a time when others are waiting for it, or when doing a bulk
+ * insert.  Only the first block goes through the buffer manager; the rest
+ * are added with a single smgrzeroextend() call, which is much cheaper than
+ * writing out a page of zeroes for each of them.  The pages for the lock
+ * waiters are entered into the FSM, and the pages a bulk insert will need
+ * soon are reserved for it in the BulkInsertState instead, so that it fills
+ * them without competing with others.  Reserved pages that end up unused
+ * are entered into the FSM when the bulk insert is done with the relation,
+ * see BulkInsertStateReleaseReserved.
+ */
+static Buffer
+RelationAddBlocks(Relation relation, BulkInsertState bistate,
+				  bool use_fsm, bool needLock)
+{
+	Buffer		buffer;
+	Page		page;
+	BlockNumber firstBlock;
+	int			bulkBlocks = 0;
+	int			fsmBlocks = 0;
 
 	/*
-	 * It might seem like multiplying the number of lock waiters by as much as
-	 * 20 is too aggressive, but benchmarking revealed that smaller numbers
-	 * were insufficient.  512 is just an arbitrary cap to prevent
-	 * pathological results.
+	 * Use the length of the lock wait queue to judge how much to extend for
+	 * others.  It might seem like multiplying the number of lock waiters by
+	 * as much as 20 is too aggressive, but benchmarking revealed that smaller
+	 * numbers were insufficient.  512 is just an arbitrary cap to prevent
+	 * pathological results.  This only makes sense if we're using the FSM.
 	 */
-	extraBlocks = Min(512, lockWaiters * 20);
-
-	do
+	if (needLock && use_fsm)
 	{
-		Buffer		buffer;
-		Page		page;
-		Size		freespace;
+		int			lockWaiters = RelationExtensionLockWaiterCount(relation);
 
-		/*
-		 * Extend by one page.  This should generally match the main-line
-		 * extension code in RelationGetBufferForTuple, except that we hold
-		 * the relation extension lock throughout, and we don't immediately
-		 * initialize the page (see below).
-		 */
-		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-		page = BufferGetPage(buffer);
+		if (lockWaiters > 0)
+			fsmBlocks = Min(512, lockWaiters * 20);
+	}
 
-		if (!PageIsNew(page))
-			elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-				 BufferGetBlockNumber(buffer),
-				 RelationGetRelationName(relation));
+	/*
+	 * A bulk insert is likely to go on for a while, so reserve about as many
+	 * blocks as it has used so far, up to a limit.
+	 */
+	if (bistate)
+		bulkBlocks = Min(MAX_BULK_EXTEND_BLOCKS - 1,
+						 bistate->already_extended_by);
 
-		/*
-		 * Add the page to the FSM without initializing. If we were to
-		 * initialize here, the page would potentially get flushed out to disk
-		 * before we add any useful content. There's no guarantee that that'd
-		 * happen before a potential crash, so we need to deal with
-		 * uninitialized pages anyway, thus avoid the potential for
-		 * unnecessary writes.
-		 */
+	/*
+	 * Extend by one page for our own request.
+	 *
+	 * XXX This does an lseek - rather expensive - but at the moment it is the
+	 * only way to accurately determine how many blocks are in a relation.  Is
+	 * it worth keeping an accurate file length in shared memory someplace,
+	 * rather than relying on the kernel to do it for us?
+	 */
+	buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
+	firstBlock = BufferGetBlockNumber(buffer);
+
+	/*
+	 * We need to initialize the empty new page.  Double-check that it really
+	 * is empty (this should never happen, but if it does we don't want to
+	 * risk wiping out valid data).
+	 */
+	page = BufferGetPage(buffer);
+
+	if (!PageIsNew(page))
+		elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
+			 firstBlock, RelationGetRelationName(relation));
+
+	PageInit(page, BufferGetPageSize(buffer), 0);
+	MarkBufferDirty(buffer);
 
-		/* we'll need this info below */
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
+	/*
+	 * Add the other pages without initializing them.  If we were to
+	 * initialize here, the pages would potentially get flushed out to disk
+	 * before we add any useful content.  There's no guarantee that that'd
+	 * happen before a potential crash, so we need to deal with uninitialized
+	 * pages anyway, thus avoid the potential for unnecessary writes.
+	 */
+	if (bulkBlocks + fsmBlocks > 0)
+	{
+		RelationOpenSmgr(relation);
+		smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock + 1,
+					   bulkBlocks + fsmBlocks, false);
+	}
 
-		UnlockReleaseBuffer(buffer);
+	/*
+	 * Release the file-extension lock; it's now OK for someone else to extend
+	 * the relation some more.
+	 */
+	if (needLock)
+		UnlockRelationForExtension(relation, ExclusiveLock);
 
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
+	if (bistate)
+	{
+		bistate->already_extended_by += 1 + bulkBlocks;
+		if (bulkBlocks > 0)
+		{
+			/* a tuple too big for the reserved pages may leave some over */
+			BulkInsertStateReleaseReserved(bistate);
+			bistate->reserved_rel = relation;
+			bistate->next_free = firstBlock + 1;
+			bistate->last_free = firstBlock + bulkBlocks;
+		}
+	}
+
+	if (fsmBlocks > 0)
+	{
+		BlockNumber fsmFirstBlock = firstBlock + 1 + bulkBlocks;
+		Size		freespace = BufferGetPageSize(buffer) - SizeOfPageHeaderData;
 
 		/*
 		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
+		 * chance of making these pages visible to other concurrently
+		 * inserting backends, and we want that to happen without delay.
 		 */
-		RecordPageWithFreeSpace(relation, blockNum, freespace);
+		for (int i = 0; i < fsmBlocks; i++)
+			RecordPageWithFreeSpace(relation, fsmFirstBlock + i, freespace);
+
+		/*
+		 * Updating the upper levels of the free space map is too expensive to
+		 * do for every block, but it's worth doing once at the end to make
+		 * sure that subsequent insertion activity sees all of those nifty
+		 * free pages we just inserted.
+		 */
+		FreeSpaceMapVacuumRange(relation, fsmFirstBlock,
+								fsmFirstBlock + fsmBlocks);
 	}
-	while (--extraBlocks > 0);
 
-	/*
-	 * Updating the upper levels of the free space map is too expensive to do
-	 * for every block, but it's worth doing once at the end to make sure that
-	 * subsequent insertion activity sees all of those nifty free pages we
-	 * just inserted.
-	 */
-	FreeSpaceMapVacuumRange(relation, firstBlock, blockNum + 1);
+	return buffer;
 }
 
 /*
@@ -340,6 +446,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 				saveFreeSpace = 0;
 	BlockNumber targetBlock,
 				otherBlock;
+	bool		use_reserved;
 	bool		needLock;
 
 	len = MAXALIGN(len);		/* be conservative */
@@ -389,6 +496,14 @@ RelationGetBufferForTuple(Relation relation, Size len,
 	else
 		targetBlock = RelationGetTargetBlock(relation);
 
+	/*
+	 * Then the pages a bulk insert has reserved for itself, unless the tuple
+	 * is too big for any existing page anyway.
+	 */
+	use_reserved = (len + saveFreeSpace <= MaxHeapTupleSize);
+	if (targetBlock == InvalidBlockNumber && use_reserved)
+		targetBlock = BulkInsertStateNextFree(bistate);
+
 	if (targetBlock == InvalidBlockNumber && use_fsm)
 	{
 		/*
@@ -533,6 +648,15 @@ loop:
 			ReleaseBuffer(buffer);
 		}
 
+		/* Try the next reserved page, if any */
+		if (use_reserved && bistate && bistate->next_free != InvalidBlockNumber)
+		{
+			if (use_fsm)
+				RecordPageWithFreeSpace(relation, targetBlock, pageFreeSpace);
+			targetBlock = BulkInsertStateNextFree(bistate);
+			continue;
+		}
+
 		/* Without FSM, always fall out of the loop and extend */
 		if (!use_fsm)
 			break;
@@ -558,10 +682,10 @@ loop:
 	needLock = !RELATION_IS_LOCAL(relation);
 
 	/*
-	 * If we need the lock but are not able to acquire it immediately, we'll
-	 * consider extending the relation by multiple blocks at a time to manage
-	 * contention on the relation extension lock.  However, this only makes
-	 * sense if we're using the FSM; otherwise, there's no point.
+	 * If we need the lock but are not able to acquire it immediately, some
+	 * other backend may have extended the relation for us while we waited.
+	 * However, this only makes sense if we're using the FSM; otherwise,
+	 * there's no point.
 	 */
 	if (needLock)
 	{
@@ -587,45 +711,13 @@ loop:
 				UnlockRelationForExtension(relation, ExclusiveLock);
 				goto loop;
 			}
-
-			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
 		}
 	}
 
-	/*
-	 * In addition to whatever extension we performed above, we always add at
-	 * least one block to satisfy our own request.
-	 *
-	 * XXX This does an lseek - rather expensive - but at the moment it is the
-	 * only way to accurately determine how many blocks are in a relation.  Is
-	 * it worth keeping an accurate file length in shared memory someplace,
-	 * rather than relying on the kernel to do it for us?
-	 */
-	buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
-
-	/*
-	 * We need to initialize the empty new page.  Double-check that it really
-	 * is empty (this should never happen, but if it does we don't want to
-	 * risk wiping out valid data).
-	 */
+	/* Extend, releasing the extension lock, and get our new page */
+	buffer = RelationAddBlocks(relation, bistate, use_fsm, needLock);
 	page = BufferGetPage(buffer);
 
-	if (!PageIsNew(page))
-		elog(ERROR, "page %u of relation \"%s\" should be empty but is not",
-			 BufferGetBlockNumber(buffer),
-			 RelationGetRelationName(relation));
-
-	PageInit(page, BufferGetPageSize(buffer), 0);
-	MarkBufferDirty(buffer);
-
-	/*
-	 * Release the file-extension lock; it's now OK for someone else to extend
-	 * the relation some more.
-	 */
-	if (needLock)
-		UnlockRelationForExtension(relation, ExclusiveLock);
-
 	/*
 	 * Lock the other buffer. It's guaranteed to be of a lower page number
 	 * than the new page. To conform with the deadlock prevent rules, we ought
@@ -17,6 +17,7 @@
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
+#include "access/multixact.h"
 #include "access/transam.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
@@ -69,6 +70,8 @@ static void heap_prune_record_redirect(PruneState *prstate,
 									   OffsetNumber offnum, OffsetNumber rdoffnum);
 static void heap_prune_record_dead(PruneState *prstate, OffsetNumber offnum);
 static void heap_prune_record_unused(PruneState *prstate, OffsetNumber offnum);
+static void heap_page_prune_freeze(Relation relation, Buffer buffer,
+								   TransactionId cutoff_xid);
 
 
 /*
@@ -184,11 +187,19 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 		{
 			TransactionId ignore = InvalidTransactionId;	/* return value not
 															 * needed */
+			TransactionId freeze_xid;
 
-			/* OK to prune */
-			(void) heap_page_prune(relation, buffer, vistest,
-								   limited_xmin, limited_ts,
-								   true, &ignore, NULL);
+			/*
+			 * Get the freeze horizon before pruning, so that everything it
+			 * lets us freeze was also visible to everyone when pruning ran.
+			 */
+			freeze_xid = GlobalVisTestNonRemovableHorizon(vistest);
+
+			/* OK to prune, and freeze what we can while we're at it */
+			if (heap_page_prune(relation, buffer, vistest,
+								limited_xmin, limited_ts,
+								true, &ignore, NULL) > 0)
+				heap_page_prune_freeze(relation, buffer, freeze_xid);
 		}
 
 		/* And release buffer lock */
@@ -196,6 +207,105 @@ heap_page_prune_opt(Relation relation, Buffer buffer)
 	}
 }
 
+/*
+ * Opportunistically freeze tuples on a page that heap_page_prune_opt just
+ * pruned.
+ *
+ * The page has been dirtied and WAL-logged by pruning already, so freezing
+ * the tuples that are visible to everyone now costs only a small WAL record,
+ * rather than another full-page image and write when VACUUM gets to them.
+ * To keep this cheap and simple we only freeze tuples whose xmin is hinted
+ * committed and older than cutoff_xid and that have no xmax; everything
+ * else, including MultiXactIds, is left for VACUUM.  We don't touch the
+ * visibility map here either, VACUUM will set the page all-frozen if it is.
+ *
+ * Caller must hold a buffer cleanup lock.
+ */
+static void
+heap_page_prune_freeze(Relation relation, Buffer buffer,
+					   TransactionId cutoff_xid)
+{
+	Page		page = BufferGetPage(buffer);
+	xl_heap_freeze_tuple frozen[MaxHeapTuplesPerPage];
+	int			nfrozen = 0;
+	TransactionId latest_xmin = InvalidTransactionId;
+	TransactionId dummy_relfrozenxid = InvalidTransactionId;
+	MultiXactId dummy_relminmxid = InvalidMultiXactId;
+	OffsetNumber offnum,
+				maxoff;
+
+	if (!TransactionIdIsNormal(cutoff_xid))
+		return;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		TransactionId xmin;
+		bool		totally_frozen;
+
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, itemid);
+		if (!HeapTupleHeaderXminCommitted(htup) ||
+			HeapTupleHeaderXminFrozen(htup) ||
+			!(htup->t_infomask & HEAP_XMAX_INVALID) ||
+			(htup->t_infomask & (HEAP_XMAX_IS_MULTI | HEAP_MOVED)))
+			continue;
+
+		xmin = HeapTupleHeaderGetRawXmin(htup);
+		if (!TransactionIdIsNormal(xmin) ||
+			!TransactionIdPrecedes(xmin, cutoff_xid))
+			continue;
+
+		if (heap_prepare_freeze_tuple(htup,
+									  relation->rd_rel->relfrozenxid,
+									  relation->rd_rel->relminmxid,
+									  cutoff_xid,
+									  relation->rd_rel->relminmxid,
+									  &frozen[nfrozen], &totally_frozen,
+									  &dummy_relfrozenxid,
+									  &dummy_relminmxid))
+		{
+			frozen[nfrozen++].offset = offnum;
+			if (TransactionIdFollows(xmin, latest_xmin))
+				latest_xmin = xmin;
+		}
+	}
+
+	if (nfrozen == 0)
+		return;
+
+	START_CRIT_SECTION();
+
+	MarkBufferDirty(buffer);
+
+	for (int i = 0; i < nfrozen; i++)
+	{
+		ItemId		itemid = PageGetItemId(page, frozen[i].offset);
+
+		heap_execute_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+								  &frozen[i]);
+	}
+
+	if (RelationNeedsWAL(relation))
+	{
+		XLogRecPtr	recptr;
+
+		/* standbys must not see as frozen what some snapshot can't see */
+		TransactionIdAdvance(latest_xmin);
+		recptr = log_heap_freeze(relation, buffer, latest_xmin,
+								 frozen, nfrozen);
+		PageSetLSN(page, recptr);
+	}
+
+	END_CRIT_SECTION();
+}
+
 
 /*
  * Prune and repair fragmentation in the specified page.
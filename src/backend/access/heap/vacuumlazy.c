@@ -313,6 +313,9 @@ typedef struct LVRelStats
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* Oldest XID and MultiXactId remaining in the pages we scanned */
+	TransactionId NewRelfrozenXid;
+	MultiXactId NewRelminMxid;
 
 	/* Used for error callback */
 	char	   *indname;
@@ -499,6 +502,14 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	vacrelstats->pages_removed = 0;
 	vacrelstats->lock_waiter_detected = false;
 
+	/*
+	 * Tuples inserted, updated or locked from now on can't have XIDs older
+	 * than OldestXmin, nor MultiXactIds older than the oldest one any
+	 * backend may still use.
+	 */
+	vacrelstats->NewRelfrozenXid = OldestXmin;
+	vacrelstats->NewRelminMxid = GetOldestMultiXactId();
+
 	/* Open all indexes of the relation */
 	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
 	vacrelstats->useindex = (nindexes > 0 &&
@@ -578,6 +589,10 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	 *
 	 * Also, don't change relfrozenxid/relminmxid if we skipped any pages,
 	 * since then we don't know for certain that all tuples have a newer xmin.
+	 * Otherwise, set them to the oldest XID and MultiXactId we left in the
+	 * table, rather than just to the cutoffs: a table whose old XIDs were
+	 * all frozen long ago then won't need an anti-wraparound VACUUM any time
+	 * soon.
 	 */
 	new_rel_pages = vacrelstats->rel_pages;
 	new_live_tuples = vacrelstats->new_live_tuples;
@@ -586,8 +601,12 @@ heap_vacuum_rel(Relation onerel, VacuumParams *params,
 	if (new_rel_allvisible > new_rel_pages)
 		new_rel_allvisible = new_rel_pages;
 
-	new_frozen_xid = scanned_all_unfrozen ? FreezeLimit : InvalidTransactionId;
-	new_min_multi = scanned_all_unfrozen ? MultiXactCutoff : InvalidMultiXactId;
+	Assert(!TransactionIdPrecedes(vacrelstats->NewRelfrozenXid, FreezeLimit));
+	Assert(!MultiXactIdPrecedes(vacrelstats->NewRelminMxid, MultiXactCutoff));
+	new_frozen_xid = scanned_all_unfrozen ?
+		vacrelstats->NewRelfrozenXid : InvalidTransactionId;
+	new_min_multi = scanned_all_unfrozen ?
+		vacrelstats->NewRelminMxid : InvalidMultiXactId;
 
 	vac_update_relstats(onerel,
 						new_rel_pages,
@@ -775,6 +794,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	BlockNumber next_unskippable_block;
 	bool		skipping_blocks;
 	xl_heap_freeze_tuple *frozen;
+	xl_heap_freeze_tuple *oppfrozen;
 	StringInfoData buf;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
@@ -850,6 +870,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 
 	dead_tuples = vacrelstats->dead_tuples;
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+	oppfrozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
@@ -940,12 +961,17 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 					hastup;
 		int			prev_dead_count;
 		int			nfrozen;
+		int			npruned;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
 		bool		all_visible;
 		bool		all_frozen = true;	/* provided all_visible is also true */
 		bool		has_dead_tuples;
+		bool		has_multi;
 		TransactionId visibility_cutoff_xid = InvalidTransactionId;
+		TransactionId freeze_conflict_xid;
+		TransactionId page_relfrozenxid;
+		MultiXactId page_relminmxid;
 
 		/* see note above about forcing scanning of last page */
 #define FORCE_CHECK_PAGE() \
@@ -1125,6 +1151,17 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			LockBuffer(buf, BUFFER_LOCK_SHARE);
 			if (!lazy_check_needs_freeze(buf, &hastup, vacrelstats))
 			{
+				/*
+				 * We didn't look for the oldest XID and MultiXactId on the
+				 * page, only made sure that none is older than the cutoffs.
+				 */
+				if (TransactionIdPrecedes(FreezeLimit,
+										  vacrelstats->NewRelfrozenXid))
+					vacrelstats->NewRelfrozenXid = FreezeLimit;
+				if (MultiXactIdPrecedes(MultiXactCutoff,
+										vacrelstats->NewRelminMxid))
+					vacrelstats->NewRelminMxid = MultiXactCutoff;
+
 				UnlockReleaseBuffer(buf);
 				vacrelstats->scanned_pages++;
 				vacrelstats->pinskipped_pages++;
@@ -1236,10 +1273,18 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 *
 		 * We count tuples removed by the pruning step as removed by VACUUM.
 		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, vistest, false,
-										 InvalidTransactionId, 0,
-										 &vacrelstats->latestRemovedXid,
-										 &vacrelstats->offnum);
+		npruned = heap_page_prune(onerel, buf, vistest, false,
+								  InvalidTransactionId, 0,
+								  &vacrelstats->latestRemovedXid,
+								  &vacrelstats->offnum);
+		tups_vacuumed += npruned;
+
+		/*
+		 * Remember where the relfrozenxid/relminmxid trackers stood before
+		 * this page, in case the page is frozen opportunistically below.
+		 */
+		page_relfrozenxid = vacrelstats->NewRelfrozenXid;
+		page_relminmxid = vacrelstats->NewRelminMxid;
 
 		/*
 		 * Now scan the page to collect vacuumable items and check for tuples
@@ -1247,6 +1292,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 */
 		all_visible = true;
 		has_dead_tuples = false;
+		has_multi = false;
 		nfrozen = 0;
 		hastup = false;
 		prev_dead_count = dead_tuples->num_tuples;
@@ -1382,6 +1428,16 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 							break;
 						}
 
+						/*
+						 * Index-only scans can't recheck the entries of WARM
+						 * chains, so their pages stay off the visibility map.
+						 */
+						if (HeapTupleHeaderIsWarm(tuple.t_data))
+						{
+							all_visible = false;
+							break;
+						}
+
 						/*
 						 * The inserter definitely committed. But is it old
 						 * enough that everyone sees it as committed?
@@ -1452,6 +1508,10 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 				num_tuples += 1;
 				hastup = true;
 
+				if ((tuple.t_data->t_infomask & HEAP_XMAX_IS_MULTI) &&
+					!(tuple.t_data->t_infomask & HEAP_XMAX_INVALID))
+					has_multi = true;
+
 				/*
 				 * Each non-removable tuple must be checked to see if it needs
 				 * freezing.  Note we already have exclusive buffer lock.
@@ -1460,7 +1520,9 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 											  relfrozenxid, relminmxid,
 											  FreezeLimit, MultiXactCutoff,
 											  &frozen[nfrozen],
-											  &tuple_totally_frozen))
+											  &tuple_totally_frozen,
+											  &vacrelstats->NewRelfrozenXid,
+											  &vacrelstats->NewRelminMxid))
 					frozen[nfrozen++].offset = offnum;
 
 				if (!tuple_totally_frozen)
@@ -1474,6 +1536,76 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 		 */
 		vacrelstats->offnum = InvalidOffsetNumber;
 
+		/*
+		 * If every tuple on the page is visible to everyone but some are not
+		 * old enough to be frozen by FreezeLimit, consider freezing them all
+		 * anyway.  We only do that when we are going to dirty and WAL-log the
+		 * page regardless, because pruning removed something, because some
+		 * tuples need freezing, or because the page is about to be marked
+		 * all-visible.  The extra WAL is then small compared to the full-page
+		 * image and the write that an aggressive VACUUM would otherwise need
+		 * later, and the page can be marked all-frozen right away.  It is
+		 * only worth it if the whole page becomes frozen, so the plans are
+		 * built separately and thrown away otherwise.  Pages with
+		 * MultiXactIds are left alone, as freezing those may need new ones.
+		 */
+		freeze_conflict_xid = FreezeLimit;
+		if (all_visible && !all_frozen && !has_multi &&
+			(npruned > 0 || nfrozen > 0 || !PageIsAllVisible(page)))
+		{
+			TransactionId opp_relfrozenxid = page_relfrozenxid;
+			MultiXactId opp_relminmxid = page_relminmxid;
+			int			noppfrozen = 0;
+			bool		opp_all_frozen = true;
+
+			for (offnum = FirstOffsetNumber;
+				 offnum <= maxoff && opp_all_frozen;
+				 offnum = OffsetNumberNext(offnum))
+			{
+				ItemId		itemid = PageGetItemId(page, offnum);
+				bool		tuple_totally_frozen;
+
+				if (!ItemIdIsNormal(itemid))
+					continue;
+
+				if (heap_prepare_freeze_tuple((HeapTupleHeader) PageGetItem(page, itemid),
+											  relfrozenxid, relminmxid,
+											  OldestXmin, MultiXactCutoff,
+											  &oppfrozen[noppfrozen],
+											  &tuple_totally_frozen,
+											  &opp_relfrozenxid,
+											  &opp_relminmxid))
+					oppfrozen[noppfrozen++].offset = offnum;
+
+				if (!tuple_totally_frozen)
+					opp_all_frozen = false;
+			}
+
+			if (opp_all_frozen)
+			{
+				memcpy(frozen, oppfrozen,
+					   sizeof(xl_heap_freeze_tuple) * noppfrozen);
+				nfrozen = noppfrozen;
+				all_frozen = true;
+				vacrelstats->NewRelfrozenXid = opp_relfrozenxid;
+				vacrelstats->NewRelminMxid = opp_relminmxid;
+
+				/*
+				 * A standby must not see tuples frozen that are still
+				 * invisible to some of its snapshots.  The page being
+				 * all-visible, no xmin on it follows visibility_cutoff_xid.
+				 */
+				if (TransactionIdIsNormal(visibility_cutoff_xid))
+				{
+					TransactionId xid = visibility_cutoff_xid;
+
+					TransactionIdAdvance(xid);
+					if (TransactionIdFollows(xid, freeze_conflict_xid))
+						freeze_conflict_xid = xid;
+				}
+			}
+		}
+
 		/*
 		 * If we froze any tuples, mark the buffer dirty, and write a WAL
 		 * record recording the changes.  We must log the changes to be
@@ -1502,7 +1634,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 			{
 				XLogRecPtr	recptr;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+				recptr = log_heap_freeze(onerel, buf, freeze_conflict_xid,
 										 frozen, nfrozen);
 				PageSetLSN(page, recptr);
 			}
@@ -1672,6 +1804,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	vacrelstats->blkno = InvalidBlockNumber;
 
 	pfree(frozen);
+	pfree(oppfrozen);
 
 	/* save stats for use later */
 	vacrelstats->tuples_deleted = tups_vacuumed;
@@ -3044,7 +3177,8 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 					TransactionId xmin;
 
 					/* Check comments in lazy_scan_heap. */
-					if (!HeapTupleHeaderXminCommitted(tuple.t_data))
+					if (!HeapTupleHeaderXminCommitted(tuple.t_data) ||
+						HeapTupleHeaderIsWarm(tuple.t_data))
 					{
 						all_visible = false;
 						*all_frozen = false;
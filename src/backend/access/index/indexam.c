@@ -45,12 +45,15 @@
 
 #include "access/amapi.h"
 #include "access/heapam.h"
+#include "access/itup.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
 #include "access/tableam.h"
 #include "access/transam.h"
 #include "access/xlog.h"
+#include "catalog/catalog.h"
 #include "catalog/index.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_amproc.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
@@ -59,6 +62,7 @@
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
 #include "storage/predicate.h"
+#include "utils/datum.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
 #include "utils/syscache.h"
@@ -104,6 +108,8 @@ do { \
 			 CppAsString(pname), RelationGetRelationName(scan->indexRelation)); \
 } while(0)
 
+static void index_setup_warm_recheck(IndexScanDesc scan);
+static bool index_warm_key_matches(IndexScanDesc scan, TupleTableSlot *slot);
 static IndexScanDesc index_beginscan_internal(Relation indexRelation,
 											  int nkeys, int norderbys, Snapshot snapshot,
 											  ParallelIndexScanDesc pscan, bool temp_snap);
@@ -215,6 +221,7 @@ index_beginscan(Relation heapRelation,
 	 */
 	scan->heapRelation = heapRelation;
 	scan->xs_snapshot = snapshot;
+	index_setup_warm_recheck(scan);
 
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heapRelation);
@@ -497,6 +504,7 @@ index_beginscan_parallel(Relation heaprel, Relation indexrel, int nkeys,
 	 */
 	scan->heapRelation = heaprel;
 	scan->xs_snapshot = snapshot;
+	index_setup_warm_recheck(scan);
 
 	/* prepare to fetch index matches from table */
 	scan->xs_heapfetch = table_index_fetch_begin(heaprel);
@@ -575,6 +583,7 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	bool		all_dead = false;
 	bool		found;
 
+	scan->xs_heapfetch->recheck_key = false;
 	found = table_index_fetch_tuple(scan->xs_heapfetch, &scan->xs_heaptid,
 									scan->xs_snapshot, slot,
 									&scan->xs_heap_continue, &all_dead);
@@ -582,6 +591,15 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	if (found)
 		pgstat_count_heap_fetch(scan->indexRelation);
 
+	/*
+	 * If the tuple is in a HOT chain that has had a WARM update, the entry
+	 * we followed may be for another member of the chain.  That member is
+	 * returned through its own entry, so just skip the tuple.
+	 */
+	if (found && scan->xs_recheck_warm && scan->xs_heapfetch->recheck_key &&
+		!index_warm_key_matches(scan, slot))
+		return false;
+
 	/*
 	 * If we scanned a whole HOT chain and found only dead tuples, tell index
 	 * AM to kill its entry for that TID (this will take effect in the next
@@ -595,6 +613,65 @@ index_fetch_heap(IndexScanDesc scan, TupleTableSlot *slot)
 	return found;
 }
 
+/*
+ * index_setup_warm_recheck - prepare to recheck entries for WARM chains
+ *
+ * Heap tables can have WARM chains, and then the scan must check that the
+ * tuple it found matches the key of the index entry it followed, for the
+ * indexes that take WARM updates (see README.HOT).  We need the index tuple
+ * from the AM for that.
+ */
+static void
+index_setup_warm_recheck(IndexScanDesc scan)
+{
+	Relation	heapRelation = scan->heapRelation;
+
+	if (heapRelation->rd_rel->relam == HEAP_TABLE_AM_OID &&
+		!IsCatalogRelation(heapRelation) &&
+		RelationIndexIsWarmCapable(heapRelation, scan->indexRelation))
+	{
+		scan->xs_recheck_warm = true;
+		scan->xs_want_itup = true;
+	}
+}
+
+/*
+ * index_warm_key_matches - does the tuple match the scan's index tuple?
+ *
+ * Values are compared by their binary image, so that an entry only matches
+ * the tuple version it was made for, even if the operator class considers
+ * the values of other versions equal.
+ */
+static bool
+index_warm_key_matches(IndexScanDesc scan, TupleTableSlot *slot)
+{
+	Form_pg_index index = scan->indexRelation->rd_index;
+	TupleDesc	itupdesc = scan->xs_itupdesc;
+	int			i;
+
+	Assert(scan->xs_itup != NULL);
+
+	for (i = 0; i < index->indnatts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(itupdesc, i);
+		Datum		idatum;
+		Datum		hdatum;
+		bool		inull;
+		bool		hnull;
+
+		idatum = index_getattr(scan->xs_itup, i + 1, itupdesc, &inull);
+		hdatum = slot_getattr(slot, index->indkey.values[i], &hnull);
+
+		if (inull != hnull)
+			return false;
+		if (!inull &&
+			!datum_image_eq(idatum, hdatum, att->attbyval, att->attlen))
+			return false;
+	}
+
+	return true;
+}
+
 /* ----------------
  *		index_getnext_slot - get the next tuple from a scan
  *
@@ -29,6 +29,8 @@ smgr_desc(StringInfo buf, XLogReaderState *record)
 		char	   *path = relpathperm(xlrec->rnode, xlrec->forkNum);
 
 		appendStringInfoString(buf, path);
+		if (xlrec->flags & SMGR_CREATE_COMPRESSED)
+			appendStringInfoString(buf, " compressed");
 		pfree(path);
 	}
 	else if (info == XLOG_SMGR_TRUNCATE)
@@ -0,0 +1,84 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheapdesc.c
+ *	  rmgr descriptor routines for access/undoheap/undoheap_xlog.c
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/rmgrdesc/undoheapdesc.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/undoheap_xlog.h"
+
+void
+undoheap_desc(StringInfo buf, XLogReaderState *record)
+{
+	char	   *rec = XLogRecGetData(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	info &= XLOG_UNDOHEAP_OPMASK;
+	if (info == XLOG_UNDOHEAP_META || info == XLOG_UNDOHEAP_DISCARD)
+	{
+		xl_undoheap_meta *xlrec = (xl_undoheap_meta *) rec;
+
+		appendStringInfo(buf, "latestRemovedXid %u", xlrec->latestRemovedXid);
+		if (xlrec->flags & XLU_INIT_PAGE)
+			appendStringInfo(buf, ", init type %u next %u",
+							 xlrec->init_type, xlrec->init_next);
+		if (xlrec->flags & XLU_LINK_PAGE)
+			appendStringInfo(buf, ", link next %u", xlrec->link_next);
+	}
+	else
+	{
+		xl_undoheap_modify *xlrec = (xl_undoheap_modify *) rec;
+
+		appendStringInfo(buf, "nops %u, undo off %u, latestRemovedXid %u",
+						 xlrec->nops, xlrec->undo_offnum,
+						 xlrec->latestRemovedXid);
+	}
+}
+
+const char *
+undoheap_identify(uint8 info)
+{
+	const char *id = NULL;
+
+	switch (info & ~XLR_INFO_MASK)
+	{
+		case XLOG_UNDOHEAP_INSERT:
+			id = "INSERT";
+			break;
+		case XLOG_UNDOHEAP_INSERT | XLOG_UNDOHEAP_INIT_PAGE:
+			id = "INSERT+INIT";
+			break;
+		case XLOG_UNDOHEAP_UPDATE:
+			id = "UPDATE";
+			break;
+		case XLOG_UNDOHEAP_DELETE:
+			id = "DELETE";
+			break;
+		case XLOG_UNDOHEAP_LOCK:
+			id = "LOCK";
+			break;
+		case XLOG_UNDOHEAP_ROLLBACK:
+			id = "ROLLBACK";
+			break;
+		case XLOG_UNDOHEAP_CLEAN:
+			id = "CLEAN";
+			break;
+		case XLOG_UNDOHEAP_META:
+			id = "META";
+			break;
+		case XLOG_UNDOHEAP_DISCARD:
+			id = "DISCARD";
+			break;
+	}
+
+	return id;
+}
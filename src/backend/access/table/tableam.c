@@ -346,7 +346,7 @@ void
 simple_table_tuple_update(Relation rel, ItemPointer otid,
 						  TupleTableSlot *slot,
 						  Snapshot snapshot,
-						  bool *update_indexes)
+						  TU_IndexUpdate *update_indexes)
 {
 	TM_Result	result;
 	TM_FailureData tmfd;
@@ -221,6 +221,7 @@ typedef struct SerializedTransactionState
 	FullTransactionId topFullTransactionId;
 	FullTransactionId currentFullTransactionId;
 	CommandId	currentCommandId;
+	bool		currentCommandIdUsed;
 	int			nParallelCurrentXids;
 	TransactionId parallelCurrentXids[FLEXIBLE_ARRAY_MEMBER];
 } SerializedTransactionState;
@@ -765,16 +766,29 @@ GetCurrentCommandId(bool used)
 	{
 		/*
 		 * Forbid setting currentCommandIdUsed in a parallel worker, because
-		 * we have no provision for communicating this back to the leader.  We
-		 * could relax this restriction when currentCommandIdUsed was already
-		 * true at the start of the parallel operation.
+		 * we have no provision for communicating this back to the leader.
+		 * That's no problem if it was already true at the start of the
+		 * parallel operation, as it is when workers perform an INSERT.
 		 */
-		Assert(!IsParallelWorker());
+		Assert(!IsParallelWorker() || currentCommandIdUsed);
 		currentCommandIdUsed = true;
 	}
 	return currentCommandId;
 }
 
+/*
+ *	IsCurrentCommandIdUsed
+ *
+ * Has the current command ID been marked as used by GetCurrentCommandId(true)?
+ * In a parallel worker, this reports the leader's state at the start of the
+ * parallel operation.
+ */
+bool
+IsCurrentCommandIdUsed(void)
+{
+	return currentCommandIdUsed;
+}
+
 /*
  *	SetParallelStartTimestamps
  *
@@ -5249,6 +5263,7 @@ SerializeTransactionState(Size maxsize, char *start_address)
 	result->currentFullTransactionId =
 		CurrentTransactionState->fullTransactionId;
 	result->currentCommandId = currentCommandId;
+	result->currentCommandIdUsed = currentCommandIdUsed;
 
 	/*
 	 * If we're running in a parallel worker and launching a parallel worker
@@ -5317,6 +5332,7 @@ StartParallelWorkerTransaction(char *tstatespace)
 	CurrentTransactionState->fullTransactionId =
 		tstate->currentFullTransactionId;
 	currentCommandId = tstate->currentCommandId;
+	currentCommandIdUsed = tstate->currentCommandIdUsed;
 	nParallelCurrentXids = tstate->nParallelCurrentXids;
 	ParallelCurrentXids = &tstate->parallelCurrentXids[0];
 
@@ -0,0 +1,440 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheap_vacuum.c
+ *	  VACUUM for the undo heap table access method.
+ *
+ * Updates in place leave nothing behind, and undo discard prunes most
+ * deleted tuples, so VACUUM has less to do than in heap: it discards as much
+ * of the undo log as it can, prunes and freezes each data page, and removes
+ * the index entries of dead line pointers, after which they can be reused.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/undoheap/undoheap_vacuum.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/multixact.h"
+#include "access/transam.h"
+#include "access/undoheap.h"
+#include "access/undoheap_xlog.h"
+#include "access/xact.h"
+#include "commands/progress.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/freespace.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/memutils.h"
+#include "utils/pg_rusage.h"
+#include "utils/rel.h"
+
+/* TIDs of dead line pointers, in TID order */
+typedef struct UndoHeapVacState
+{
+	ItemPointerData *dead_tids;
+	int			num_dead_tids;
+	int			max_dead_tids;
+} UndoHeapVacState;
+
+static void undoheap_vacuum_page(Relation rel, Buffer buffer,
+								 TransactionId FreezeLimit,
+								 TransactionId *frozen_xid,
+								 UndoHeapVacState *vacstate,
+								 double *live_tuples);
+static void undoheap_vacuum_indexes(Relation rel, Relation *Irel,
+									int nindexes,
+									IndexBulkDeleteResult **stats,
+									UndoHeapVacState *vacstate,
+									double num_tuples, int elevel,
+									BufferAccessStrategy bstrategy);
+static bool undoheap_tid_reaped(ItemPointer itemptr, void *state);
+static int	undoheap_cmp_itemptr(const void *left, const void *right);
+
+
+/*
+ * VACUUM one undo heap relation.
+ */
+void
+undoheap_vacuum_rel(Relation rel, VacuumParams *params,
+					BufferAccessStrategy bstrategy)
+{
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	TransactionId xidFullScanLimit;
+	MultiXactId MultiXactCutoff;
+	MultiXactId mxactFullScanLimit;
+	TransactionId new_frozen_xid;
+	TransactionId oldest_undo_xid;
+	Relation   *Irel;
+	int			nindexes;
+	IndexBulkDeleteResult **stats;
+	UndoHeapVacState vacstate;
+	BlockNumber ndiscarded;
+	BlockNumber nblocks;
+	BlockNumber blkno;
+	double		live_tuples = 0;
+	double		tups_removed = 0;
+	long		maxtuples;
+	int			elevel;
+	int			i;
+	PGRUsage	ru0;
+
+	if (params->options & VACOPT_VERBOSE)
+		elevel = INFO;
+	else
+		elevel = DEBUG2;
+
+	pg_rusage_init(&ru0);
+
+	pgstat_progress_start_command(PROGRESS_COMMAND_VACUUM,
+								  RelationGetRelid(rel));
+
+	vacuum_set_xid_limits(rel,
+						  params->freeze_min_age,
+						  params->freeze_table_age,
+						  params->multixact_freeze_min_age,
+						  params->multixact_freeze_table_age,
+						  &OldestXmin, &FreezeLimit, &xidFullScanLimit,
+						  &MultiXactCutoff, &mxactFullScanLimit);
+
+	/*
+	 * Discarding first means pruning has already removed what it could when
+	 * we look at the pages.
+	 */
+	ndiscarded = undoheap_discard(rel, true, &oldest_undo_xid);
+
+	vac_open_indexes(rel, RowExclusiveLock, &nindexes, &Irel);
+	stats = (IndexBulkDeleteResult **)
+		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
+
+	/* Same limit on memory for dead TIDs as in heap */
+	maxtuples = (maintenance_work_mem * 1024L) / sizeof(ItemPointerData);
+	maxtuples = Min(maxtuples, INT_MAX);
+	maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+	maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+	vacstate.max_dead_tids = (int) maxtuples;
+	vacstate.num_dead_tids = 0;
+	vacstate.dead_tids = (ItemPointerData *)
+		palloc(maxtuples * sizeof(ItemPointerData));
+
+	new_frozen_xid = FreezeLimit;
+	if (TransactionIdIsValid(oldest_undo_xid) &&
+		TransactionIdPrecedes(oldest_undo_xid, new_frozen_xid))
+		new_frozen_xid = oldest_undo_xid;
+
+	nblocks = RelationGetNumberOfBlocks(rel);
+	pgstat_progress_update_param(PROGRESS_VACUUM_TOTAL_HEAP_BLKS, nblocks);
+
+	for (blkno = UNDOHEAP_METAPAGE_BLKNO + 1; blkno < nblocks; blkno++)
+	{
+		Buffer		buffer;
+		Page		page;
+
+		vacuum_delay_point();
+
+		/* Make room for the TIDs of another page, if need be */
+		if (nindexes > 0 &&
+			vacstate.max_dead_tids - vacstate.num_dead_tids < MaxHeapTuplesPerPage &&
+			vacstate.num_dead_tids > 0)
+		{
+			tups_removed += vacstate.num_dead_tids;
+			undoheap_vacuum_indexes(rel, Irel, nindexes, stats, &vacstate,
+									live_tuples, elevel, bstrategy);
+		}
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									bstrategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		if (UndoHeapPageIsData(page) && !PageIsNew(page))
+			undoheap_vacuum_page(rel, buffer, FreezeLimit, &new_frozen_xid,
+								 nindexes > 0 ? &vacstate : NULL,
+								 &live_tuples);
+
+		UnlockReleaseBuffer(buffer);
+
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+									 blkno + 1);
+	}
+
+	if (vacstate.num_dead_tids > 0)
+	{
+		tups_removed += vacstate.num_dead_tids;
+		undoheap_vacuum_indexes(rel, Irel, nindexes, stats, &vacstate,
+								live_tuples, elevel, bstrategy);
+	}
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
+	for (i = 0; i < nindexes; i++)
+	{
+		IndexVacuumInfo ivinfo;
+
+		ivinfo.index = Irel[i];
+		ivinfo.analyze_only = false;
+		ivinfo.report_progress = false;
+		ivinfo.estimated_count = false;
+		ivinfo.message_level = elevel;
+		ivinfo.num_heap_tuples = live_tuples;
+		ivinfo.strategy = bstrategy;
+
+		stats[i] = index_vacuum_cleanup(&ivinfo, stats[i]);
+
+		if (stats[i] != NULL && !stats[i]->estimated_count)
+			vac_update_relstats(Irel[i],
+								stats[i]->num_pages,
+								stats[i]->num_index_tuples,
+								0,
+								false,
+								InvalidTransactionId,
+								InvalidMultiXactId,
+								false);
+		if (stats[i] != NULL)
+			pfree(stats[i]);
+	}
+
+	FreeSpaceMapVacuum(rel);
+
+	vac_close_indexes(nindexes, Irel, NoLock);
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_FINAL_CLEANUP);
+
+	vac_update_relstats(rel,
+						nblocks,
+						live_tuples,
+						0,
+						nindexes > 0,
+						new_frozen_xid,
+						MultiXactCutoff,
+						false);
+
+	pgstat_report_vacuum(RelationGetRelid(rel),
+						 rel->rd_rel->relisshared,
+						 live_tuples,
+						 0);
+	pgstat_progress_end_command();
+
+	ereport(elevel,
+			(errmsg("\"%s\": discarded %u undo pages, removed %.0f row versions, found %.0f live rows in %u pages",
+					RelationGetRelationName(rel),
+					ndiscarded, tups_removed, live_tuples, nblocks),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+
+	pfree(vacstate.dead_tids);
+}
+
+/*
+ * Prune one data page, freeze the tuples inserted before FreezeLimit, and
+ * clear row locks of transactions that are gone.  Remembers the dead line
+ * pointers in 'vacstate', or makes them unused right away if it's NULL
+ * because there are no indexes, and lowers *frozen_xid to the
+ * oldest transaction left on the page.
+ */
+static void
+undoheap_vacuum_page(Relation rel, Buffer buffer, TransactionId FreezeLimit,
+					 TransactionId *frozen_xid, UndoHeapVacState *vacstate,
+					 double *live_tuples)
+{
+	Page		page = BufferGetPage(buffer);
+	BlockNumber blkno = BufferGetBlockNumber(buffer);
+	OffsetNumber maxoff;
+	OffsetNumber offnum;
+	StringInfoData ops;
+	int			nops = 0;
+
+	/*
+	 * Pruning only looks at pages with deletions, so roll back aborted
+	 * changes on the others here.
+	 */
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		if (ItemIdIsNormal(PageGetItemId(page, offnum)))
+			undoheap_rollback_aborted(rel, buffer, offnum);
+	}
+	undoheap_page_prune(rel, buffer);
+
+	initStringInfo(&ops);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		ItemId		lp = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		HeapTupleHeaderData hdr;
+		TransactionId xmin;
+		TransactionId xmax;
+		bool		changed = false;
+
+		/* Without indexes, nothing points to dead line pointers anymore */
+		if (ItemIdIsDead(lp))
+		{
+			if (vacstate != NULL)
+				ItemPointerSet(&vacstate->dead_tids[vacstate->num_dead_tids++],
+							   blkno, offnum);
+			else
+			{
+				undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_UNUSED, NULL, 0);
+				nops++;
+			}
+			continue;
+		}
+		if (!ItemIdIsNormal(lp))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+		memcpy(&hdr, htup, SizeofHeapTupleHeader);
+		xmin = HeapTupleHeaderGetRawXmin(&hdr);
+		xmax = HeapTupleHeaderGetRawXmax(&hdr);
+
+		if (!UndoHeapTupleIsDeleted(&hdr))
+			*live_tuples += 1;
+
+		/* Aborted changes are rolled back, so an old xmin has committed */
+		if (TransactionIdIsNormal(xmin) &&
+			TransactionIdPrecedes(xmin, FreezeLimit))
+		{
+			HeapTupleHeaderSetXmin(&hdr, FrozenTransactionId);
+			hdr.t_infomask |= HEAP_XMIN_COMMITTED;
+			changed = true;
+		}
+
+		if (UndoHeapTupleIsLocked(&hdr) &&
+			!TransactionIdIsCurrentTransactionId(xmax) &&
+			!TransactionIdIsInProgress(xmax))
+		{
+			HeapTupleHeaderSetXmax(&hdr, InvalidTransactionId);
+			hdr.t_infomask &= ~HEAP_XMAX_BITS;
+			changed = true;
+		}
+
+		if (changed)
+		{
+			undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_HEADER,
+							(char *) &hdr, SizeofHeapTupleHeader);
+			nops++;
+		}
+
+		xmin = HeapTupleHeaderGetRawXmin(&hdr);
+		xmax = HeapTupleHeaderGetRawXmax(&hdr);
+		if (TransactionIdIsNormal(xmin) &&
+			TransactionIdPrecedes(xmin, *frozen_xid))
+			*frozen_xid = xmin;
+		if (TransactionIdIsNormal(xmax) &&
+			TransactionIdPrecedes(xmax, *frozen_xid))
+			*frozen_xid = xmax;
+	}
+
+	if (nops > 0)
+		undoheap_apply_ops(rel, XLOG_UNDOHEAP_CLEAN, buffer, &ops, nops,
+						   InvalidTransactionId, InvalidBuffer, NULL, 0);
+	pfree(ops.data);
+
+	RecordPageWithFreeSpace(rel, blkno, PageGetHeapFreeSpace(page));
+}
+
+/*
+ * Remove the index entries of the dead line pointers in 'vacstate', then
+ * mark the line pointers unused.
+ */
+static void
+undoheap_vacuum_indexes(Relation rel, Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **stats,
+						UndoHeapVacState *vacstate, double num_tuples,
+						int elevel, BufferAccessStrategy bstrategy)
+{
+	int			i;
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
+	for (i = 0; i < nindexes; i++)
+	{
+		IndexVacuumInfo ivinfo;
+
+		ivinfo.index = Irel[i];
+		ivinfo.analyze_only = false;
+		ivinfo.report_progress = false;
+		ivinfo.estimated_count = true;
+		ivinfo.message_level = elevel;
+		ivinfo.num_heap_tuples = num_tuples;
+		ivinfo.strategy = bstrategy;
+
+		stats[i] = index_bulk_delete(&ivinfo, stats[i],
+									 undoheap_tid_reaped, (void *) vacstate);
+	}
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
+	i = 0;
+	while (i < vacstate->num_dead_tids)
+	{
+		BlockNumber blkno = ItemPointerGetBlockNumber(&vacstate->dead_tids[i]);
+		Buffer		buffer;
+		Page		page;
+		StringInfoData ops;
+		int			nops = 0;
+
+		vacuum_delay_point();
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+									bstrategy);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		initStringInfo(&ops);
+		for (; i < vacstate->num_dead_tids &&
+			 ItemPointerGetBlockNumber(&vacstate->dead_tids[i]) == blkno; i++)
+		{
+			OffsetNumber offnum = ItemPointerGetOffsetNumber(&vacstate->dead_tids[i]);
+
+			/* Only VACUUM makes dead line pointers unused */
+			Assert(ItemIdIsDead(PageGetItemId(page, offnum)));
+			undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_UNUSED, NULL, 0);
+			nops++;
+		}
+
+		/*
+		 * The tuples were removed by pruning, which logged the conflict
+		 * horizon already.
+		 */
+		undoheap_apply_ops(rel, XLOG_UNDOHEAP_CLEAN, buffer, &ops, nops,
+						   InvalidTransactionId, InvalidBuffer, NULL, 0);
+		pfree(ops.data);
+
+		RecordPageWithFreeSpace(rel, blkno, PageGetHeapFreeSpace(page));
+		UnlockReleaseBuffer(buffer);
+	}
+
+	vacstate->num_dead_tids = 0;
+}
+
+/*
+ * Is the TID one of the dead line pointers?  Callback for index_bulk_delete.
+ */
+static bool
+undoheap_tid_reaped(ItemPointer itemptr, void *state)
+{
+	UndoHeapVacState *vacstate = (UndoHeapVacState *) state;
+
+	return bsearch((void *) itemptr,
+				   (void *) vacstate->dead_tids,
+				   vacstate->num_dead_tids,
+				   sizeof(ItemPointerData),
+				   undoheap_cmp_itemptr) != NULL;
+}
+
+static int
+undoheap_cmp_itemptr(const void *left, const void *right)
+{
+	return ItemPointerCompare((ItemPointer) left, (ItemPointer) right);
+}
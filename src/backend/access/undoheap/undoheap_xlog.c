@@ -0,0 +1,222 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheap_xlog.c
+ *	  WAL replay logic for the undo heap table access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/undoheap/undoheap_xlog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/bufmask.h"
+#include "access/undoheap.h"
+#include "access/undoheap_xlog.h"
+#include "access/xlogutils.h"
+#include "storage/standby.h"
+
+/*
+ * Replay a record that changes line pointers of a data page, and maybe adds
+ * an undo record.
+ */
+static void
+undoheap_xlog_modify(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_undoheap_modify *xlrec = (xl_undoheap_modify *) XLogRecGetData(record);
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+	Buffer		buffer;
+	XLogRedoAction action;
+
+	if (InHotStandby && TransactionIdIsValid(xlrec->latestRemovedXid))
+	{
+		RelFileNode rnode;
+
+		XLogRecGetBlockTag(record, 0, &rnode, NULL, NULL);
+		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid, rnode);
+	}
+
+	if (info & XLOG_UNDOHEAP_INIT_PAGE)
+	{
+		buffer = XLogInitBufferForRedo(record, 0);
+		undoheap_init_page(BufferGetPage(buffer), UNDOHEAP_PAGE_DATA,
+						   InvalidBlockNumber);
+		action = BLK_NEEDS_REDO;
+	}
+	else
+		action = XLogReadBufferForRedo(record, 0, &buffer);
+
+	if (action == BLK_NEEDS_REDO)
+	{
+		Page		page = BufferGetPage(buffer);
+		Size		len;
+		char	   *ops = XLogRecGetBlockData(record, 0, &len);
+
+		undoheap_page_apply_ops(page, ops, len);
+		if ((info & XLOG_UNDOHEAP_OPMASK) == XLOG_UNDOHEAP_DELETE)
+			PageSetPrunable(page, XLogRecGetXid(record));
+
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+	}
+	if (BufferIsValid(buffer))
+		UnlockReleaseBuffer(buffer);
+
+	if (XLogRecHasBlockRef(record, 1))
+	{
+		if (XLogReadBufferForRedo(record, 1, &buffer) == BLK_NEEDS_REDO)
+		{
+			Page		page = BufferGetPage(buffer);
+			Size		len;
+			char	   *rec = XLogRecGetBlockData(record, 1, &len);
+
+			if (PageAddItem(page, (Item) rec, len, xlrec->undo_offnum,
+							false, false) != xlrec->undo_offnum)
+				elog(PANIC, "failed to add undo record");
+
+			PageSetLSN(page, lsn);
+			MarkBufferDirty(buffer);
+		}
+		if (BufferIsValid(buffer))
+			UnlockReleaseBuffer(buffer);
+	}
+}
+
+/*
+ * Replay a metapage change, with the pages it initializes or links.
+ */
+static void
+undoheap_xlog_meta(XLogReaderState *record)
+{
+	XLogRecPtr	lsn = record->EndRecPtr;
+	xl_undoheap_meta *xlrec = (xl_undoheap_meta *) XLogRecGetData(record);
+	Buffer		buffer;
+	Page		page;
+	Size		len;
+	char	   *meta;
+
+	if (InHotStandby && TransactionIdIsValid(xlrec->latestRemovedXid))
+	{
+		RelFileNode rnode;
+
+		XLogRecGetBlockTag(record, 0, &rnode, NULL, NULL);
+		ResolveRecoveryConflictWithSnapshot(xlrec->latestRemovedXid, rnode);
+	}
+
+	buffer = XLogInitBufferForRedo(record, 0);
+	page = BufferGetPage(buffer);
+	meta = XLogRecGetBlockData(record, 0, &len);
+	Assert(len == sizeof(UndoHeapMetaPageData));
+	undoheap_init_page(page, UNDOHEAP_PAGE_META, InvalidBlockNumber);
+	memcpy(UndoHeapPageGetMeta(page), meta, sizeof(UndoHeapMetaPageData));
+	((PageHeader) page)->pd_lower =
+		((char *) UndoHeapPageGetMeta(page) + sizeof(UndoHeapMetaPageData)) -
+		(char *) page;
+	PageSetLSN(page, lsn);
+	MarkBufferDirty(buffer);
+	UnlockReleaseBuffer(buffer);
+
+	if (xlrec->flags & XLU_INIT_PAGE)
+	{
+		buffer = XLogInitBufferForRedo(record, 1);
+		page = BufferGetPage(buffer);
+		undoheap_init_page(page, xlrec->init_type, xlrec->init_next);
+		PageSetLSN(page, lsn);
+		MarkBufferDirty(buffer);
+		UnlockReleaseBuffer(buffer);
+	}
+
+	if (xlrec->flags & XLU_LINK_PAGE)
+	{
+		if (XLogReadBufferForRedo(record, 2, &buffer) == BLK_NEEDS_REDO)
+		{
+			page = BufferGetPage(buffer);
+			UndoHeapPageGetOpaque(page)->next = xlrec->link_next;
+			PageSetLSN(page, lsn);
+			MarkBufferDirty(buffer);
+		}
+		if (BufferIsValid(buffer))
+			UnlockReleaseBuffer(buffer);
+	}
+}
+
+void
+undoheap_redo(XLogReaderState *record)
+{
+	uint8		info = XLogRecGetInfo(record) & ~XLR_INFO_MASK;
+
+	switch (info & XLOG_UNDOHEAP_OPMASK)
+	{
+		case XLOG_UNDOHEAP_INSERT:
+		case XLOG_UNDOHEAP_UPDATE:
+		case XLOG_UNDOHEAP_DELETE:
+		case XLOG_UNDOHEAP_LOCK:
+		case XLOG_UNDOHEAP_ROLLBACK:
+		case XLOG_UNDOHEAP_CLEAN:
+			undoheap_xlog_modify(record);
+			break;
+		case XLOG_UNDOHEAP_META:
+		case XLOG_UNDOHEAP_DISCARD:
+			undoheap_xlog_meta(record);
+			break;
+		default:
+			elog(PANIC, "undoheap_redo: unknown op code %u", info);
+	}
+}
+
+/*
+ * Mask an undo heap page before performing consistency checks on it.
+ */
+void
+undoheap_mask(char *pagedata, BlockNumber blkno)
+{
+	Page		page = (Page) pagedata;
+	OffsetNumber off;
+
+	mask_page_lsn_and_checksum(page);
+
+	mask_page_hint_bits(page);
+	mask_unused_space(page);
+
+	if (PageIsNew(page) || UndoHeapPageGetOpaque(page)->type != UNDOHEAP_PAGE_DATA)
+		return;
+
+	for (off = 1; off <= PageGetMaxOffsetNumber(page); off++)
+	{
+		ItemId		iid = PageGetItemId(page, off);
+		char	   *page_item;
+
+		page_item = (char *) (page + ItemIdGetOffset(iid));
+
+		/*
+		 * Hint bits are set without WAL, unless the tuple has been frozen by
+		 * a logged change, see heap_mask().
+		 */
+		if (ItemIdIsNormal(iid))
+		{
+			HeapTupleHeader page_htup = (HeapTupleHeader) page_item;
+
+			if (TransactionIdIsNormal(HeapTupleHeaderGetRawXmin(page_htup)))
+				page_htup->t_infomask &= ~HEAP_XMIN_COMMITTED;
+		}
+
+		/*
+		 * Ignore any padding bytes after the tuple, when the length of the
+		 * item is not MAXALIGNed.
+		 */
+		if (ItemIdHasStorage(iid))
+		{
+			int			len = ItemIdGetLength(iid);
+			int			padlen = MAXALIGN(len) - len;
+
+			if (padlen > 0)
+				memset(page_item + len, MASK_MARKER, padlen);
+		}
+	}
+}
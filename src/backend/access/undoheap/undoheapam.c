@@ -0,0 +1,1636 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheapam.c
+ *	  Tuple visibility and modification for the undo heap table access
+ *	  method.
+ *
+ * A data page holds only the latest version of each tuple, which is updated
+ * in place whenever no indexed column changes and the new version fits on
+ * the page.  Each change first writes the tuple's previous state to the undo
+ * log, and readers that mustn't see the change reconstruct the version they
+ * need from there.  Changes of aborted transactions are rolled back lazily:
+ * by the next backend wanting to modify the tuple, by pruning, and at the
+ * latest when undo discard reaches their undo records.
+ *
+ * Tuples are always copied out of the page while holding the buffer lock,
+ * since an in-place update can overwrite them as soon as it's released.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/undoheap/undoheapam.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/heaptoast.h"
+#include "access/transam.h"
+#include "access/undoheap.h"
+#include "access/undoheap_xlog.h"
+#include "access/xact.h"
+#include "access/xloginsert.h"
+#include "miscadmin.h"
+#include "nodes/bitmapset.h"
+#include "pgstat.h"
+#include "storage/freespace.h"
+#include "storage/lmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/datum.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+static bool undoheap_op_visible(TransactionId xid, CommandId cid,
+								bool deletion, bool known_committed,
+								Snapshot snapshot);
+static HeapTuple undoheap_copy_tuple(HeapTupleHeader htup, Size len);
+static UndoRecord undoheap_make_undo(TransactionId xid, ItemPointer tid,
+									 uint8 type, char *image, Size imagelen,
+									 Size *reclen);
+static void undoheap_page_apply_op(Page page, OffsetNumber offnum, uint16 op,
+								   char *data, Size len);
+static OffsetNumber undoheap_page_next_offset(Page page);
+static bool undoheap_page_fits(Page page, OffsetNumber offnum, Size len);
+static void undoheap_insert_tuple(Relation rel, HeapTuple tup,
+								  bool write_undo);
+static TM_Result undoheap_check_modify(Relation rel, Buffer buffer,
+									   ItemPointer tid, CommandId cid,
+									   Snapshot snapshot, Snapshot crosscheck,
+									   LockWaitPolicy wait_policy,
+									   XLTW_Oper oper, bool *have_tuple_lock,
+									   TM_FailureData *tmfd);
+static void undoheap_set_lock(Relation rel, Buffer buffer,
+							  OffsetNumber offnum, TransactionId xid);
+static void undoheap_set_deleted(Relation rel, Buffer buffer,
+								 OffsetNumber offnum, TransactionId xid,
+								 CommandId cid, ItemPointer newtid,
+								 bool *extended);
+static bool undoheap_index_attrs_changed(Relation rel, Bitmapset *attrs,
+										 HeapTuple oldtup, HeapTuple newtup);
+
+
+/* ----------------------------------------------------------------
+ *						 visibility
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Is the change made by 'xid' with command 'cid' visible to 'snapshot'?
+ * 'deletion' tells whether the change is a deletion, which matters for some
+ * snapshot types.  'known_committed' is set if a hint bit says 'xid'
+ * committed.
+ */
+static bool
+undoheap_op_visible(TransactionId xid, CommandId cid, bool deletion,
+					bool known_committed, Snapshot snapshot)
+{
+	/* Frozen, or done during bootstrap */
+	if (!TransactionIdIsNormal(xid))
+		return true;
+
+	switch (snapshot->snapshot_type)
+	{
+		case SNAPSHOT_MVCC:
+			if (TransactionIdIsCurrentTransactionId(xid))
+				return cid < snapshot->curcid;
+			if (XidInMVCCSnapshot(xid, snapshot))
+				return false;
+			return known_committed || TransactionIdDidCommit(xid);
+
+		case SNAPSHOT_SELF:
+			if (known_committed || TransactionIdIsCurrentTransactionId(xid))
+				return true;
+			if (TransactionIdIsInProgress(xid))
+				return false;
+			return TransactionIdDidCommit(xid);
+
+		case SNAPSHOT_DIRTY:
+			if (known_committed || TransactionIdIsCurrentTransactionId(xid))
+				return true;
+			if (TransactionIdIsInProgress(xid))
+			{
+				/*
+				 * Like in heap, a tuple that is being deleted is still
+				 * visible, and we tell the caller who to wait for.  Going on
+				 * to the previous change gets us there.
+				 */
+				if (deletion)
+				{
+					snapshot->xmax = xid;
+					return false;
+				}
+				snapshot->xmin = xid;
+				return true;
+			}
+			return TransactionIdDidCommit(xid);
+
+		case SNAPSHOT_NON_VACUUMABLE:
+			if (TransactionIdIsCurrentTransactionId(xid) ||
+				TransactionIdIsInProgress(xid))
+				return !deletion;
+			if (known_committed || TransactionIdDidCommit(xid))
+				return !deletion ||
+					GlobalVisTestIsRemovableXid(snapshot->vistest, xid);
+			return false;
+
+		default:
+			elog(ERROR, "unsupported snapshot type %d for undo heap",
+				 (int) snapshot->snapshot_type);
+			return false;		/* keep compiler quiet */
+	}
+}
+
+/*
+ * Return a palloc'd copy of the tuple at 'offnum' in the version visible to
+ * 'snapshot', or NULL if no version is.  The caller must hold a lock on the
+ * buffer.
+ *
+ * The tuple on the page is visible if its last change is.  Otherwise, the
+ * undo records are followed back to the first state whose last change is.
+ */
+HeapTuple
+undoheap_get_version(Relation rel, Buffer buffer, OffsetNumber offnum,
+					 Snapshot snapshot)
+{
+	Page		page = BufferGetPage(buffer);
+	BlockNumber blkno = BufferGetBlockNumber(buffer);
+	ItemId		lp;
+	HeapTupleHeader htup;
+	HeapTuple	tuple;
+	bool		first = true;
+
+	if (offnum < FirstOffsetNumber || offnum > PageGetMaxOffsetNumber(page))
+		return NULL;
+	lp = PageGetItemId(page, offnum);
+	if (!ItemIdIsNormal(lp))
+		return NULL;
+	htup = (HeapTupleHeader) PageGetItem(page, lp);
+
+	tuple = undoheap_copy_tuple(htup, ItemIdGetLength(lp));
+	ItemPointerSet(&tuple->t_self, blkno, offnum);
+	tuple->t_tableOid = RelationGetRelid(rel);
+
+	if (snapshot->snapshot_type == SNAPSHOT_ANY)
+		return tuple;
+	if (snapshot->snapshot_type == SNAPSHOT_DIRTY)
+		snapshot->xmin = snapshot->xmax = InvalidTransactionId;
+
+	for (;;)
+	{
+		HeapTupleHeader tup = tuple->t_data;
+		bool		deleted = UndoHeapTupleIsDeleted(tup);
+		TransactionId xid = UndoHeapTupleGetLastXid(tup);
+		bool		known_committed;
+		ItemPointerData undoptr;
+		UndoRecord	rec;
+		Size		reclen;
+
+		known_committed = !deleted &&
+			(tup->t_infomask & HEAP_XMIN_COMMITTED) != 0;
+
+		if (undoheap_op_visible(xid, HeapTupleHeaderGetRawCommandId(tup),
+								deleted, known_committed, snapshot))
+		{
+			/*
+			 * Remember that the tuple's inserter committed, to save clog
+			 * lookups the next time.
+			 */
+			if (first && !deleted && !known_committed &&
+				TransactionIdIsNormal(xid) &&
+				snapshot->snapshot_type == SNAPSHOT_MVCC &&
+				!TransactionIdIsCurrentTransactionId(xid))
+				HeapTupleSetHintBits(htup, buffer, HEAP_XMIN_COMMITTED, xid);
+
+			if (deleted)
+			{
+				heap_freetuple(tuple);
+				return NULL;
+			}
+			return tuple;
+		}
+
+		if (IsMVCCSnapshot(snapshot) && TransactionIdIsNormal(xid) &&
+			!TransactionIdIsCurrentTransactionId(xid))
+			CheckForSerializableConflictOut(rel, xid, snapshot);
+
+		undoptr = tup->t_ctid;
+		if (!ItemPointerIsValid(&undoptr))
+		{
+			/*
+			 * Tuples copied by CLUSTER have no undo.  A deletion it kept
+			 * changed nothing but xmax.
+			 */
+			if (deleted)
+			{
+				HeapTupleHeaderSetXmax(tup, InvalidTransactionId);
+				tup->t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+				first = false;
+				continue;
+			}
+			heap_freetuple(tuple);
+			return NULL;
+		}
+
+		rec = undoheap_read_undo(rel, &undoptr, &reclen);
+		if (!TransactionIdEquals(rec->ur_xid, xid) ||
+			rec->ur_blkno != blkno || rec->ur_offnum != offnum)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("undo record (%u,%u) of relation \"%s\" does not belong to tuple (%u,%u)",
+							ItemPointerGetBlockNumber(&undoptr),
+							ItemPointerGetOffsetNumber(&undoptr),
+							RelationGetRelationName(rel), blkno, offnum)));
+
+		switch (rec->ur_type)
+		{
+			case UNDO_INSERT:
+				pfree(rec);
+				heap_freetuple(tuple);
+				return NULL;
+
+			case UNDO_UPDATE:
+				{
+					HeapTuple	old;
+
+					old = undoheap_copy_tuple((HeapTupleHeader) UndoRecordGetImage(rec),
+											  reclen - SizeOfUndoRecord);
+					old->t_self = tuple->t_self;
+					old->t_tableOid = tuple->t_tableOid;
+					heap_freetuple(tuple);
+					tuple = old;
+				}
+				break;
+
+			case UNDO_DELETE:
+			case UNDO_MOVE:
+				memcpy(tuple->t_data, UndoRecordGetImage(rec),
+					   SizeofHeapTupleHeader);
+				break;
+
+			default:
+				elog(ERROR, "unrecognized undo record type %u", rec->ur_type);
+		}
+
+		pfree(rec);
+		first = false;
+	}
+}
+
+/*
+ * Copy a tuple into a palloc'd HeapTuple, in one chunk.
+ */
+static HeapTuple
+undoheap_copy_tuple(HeapTupleHeader htup, Size len)
+{
+	HeapTuple	tuple;
+
+	tuple = (HeapTuple) palloc(HEAPTUPLESIZE + len);
+	tuple->t_len = len;
+	ItemPointerSetInvalid(&tuple->t_self);
+	tuple->t_tableOid = InvalidOid;
+	tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+	memcpy(tuple->t_data, htup, len);
+
+	return tuple;
+}
+
+/*
+ * Did 'xid' abort, or crash?  Our own transaction's changes count as not
+ * aborted, even those of aborted subtransactions, which are still being
+ * rolled back.
+ */
+bool
+undoheap_xid_aborted(TransactionId xid)
+{
+	if (!TransactionIdIsNormal(xid) ||
+		TransactionIdIsCurrentTransactionId(xid))
+		return false;
+
+	/* Checking clog first saves the procarray lookup for most tuples */
+	if (TransactionIdDidCommit(xid))
+		return false;
+	if (TransactionIdIsInProgress(xid))
+		return false;
+
+	/* It may have committed just after the first check */
+	return !TransactionIdDidCommit(xid);
+}
+
+/*
+ * If the last change of the tuple at 'offnum' was made by an aborted
+ * transaction, undo it, and go on with the change before as long as that
+ * was aborted too.  The caller must hold 'buffer' exclusively locked.
+ */
+void
+undoheap_rollback_aborted(Relation rel, Buffer buffer, OffsetNumber offnum)
+{
+	Page		page = BufferGetPage(buffer);
+	BlockNumber blkno = BufferGetBlockNumber(buffer);
+
+	for (;;)
+	{
+		ItemId		lp;
+		HeapTupleHeader htup;
+		TransactionId xid;
+		ItemPointerData undoptr;
+		UndoRecord	rec;
+		Size		reclen;
+		StringInfoData ops;
+
+		if (offnum > PageGetMaxOffsetNumber(page))
+			return;
+		lp = PageGetItemId(page, offnum);
+		if (!ItemIdIsNormal(lp))
+			return;
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+		if (!UndoHeapTupleIsDeleted(htup) &&
+			(htup->t_infomask & HEAP_XMIN_COMMITTED) != 0)
+			return;
+		xid = UndoHeapTupleGetLastXid(htup);
+		if (!undoheap_xid_aborted(xid))
+			return;
+
+		undoptr = htup->t_ctid;
+		if (!ItemPointerIsValid(&undoptr) && UndoHeapTupleIsDeleted(htup))
+		{
+			HeapTupleHeaderData hdr;
+
+			/* A deletion kept by CLUSTER, see undoheap_get_version() */
+			memcpy(&hdr, htup, SizeofHeapTupleHeader);
+			HeapTupleHeaderSetXmax(&hdr, InvalidTransactionId);
+			hdr.t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+
+			initStringInfo(&ops);
+			undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_HEADER,
+							(char *) &hdr, SizeofHeapTupleHeader);
+			undoheap_apply_ops(rel, XLOG_UNDOHEAP_ROLLBACK, buffer, &ops, 1,
+							   InvalidTransactionId, InvalidBuffer, NULL, 0);
+			pfree(ops.data);
+			continue;
+		}
+		if (!ItemPointerIsValid(&undoptr))
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("tuple (%u,%u) of relation \"%s\" was changed by aborted transaction %u, but has no undo record",
+							blkno, offnum, RelationGetRelationName(rel),
+							xid)));
+
+		rec = undoheap_read_undo(rel, &undoptr, &reclen);
+		if (!TransactionIdEquals(rec->ur_xid, xid) ||
+			rec->ur_blkno != blkno || rec->ur_offnum != offnum)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("undo record (%u,%u) of relation \"%s\" does not belong to tuple (%u,%u)",
+							ItemPointerGetBlockNumber(&undoptr),
+							ItemPointerGetOffsetNumber(&undoptr),
+							RelationGetRelationName(rel), blkno, offnum)));
+
+		initStringInfo(&ops);
+		switch (rec->ur_type)
+		{
+			case UNDO_INSERT:
+				undoheap_add_op(&ops, offnum, undoheap_dead_op(rel), NULL, 0);
+				break;
+			case UNDO_UPDATE:
+				undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_TUPLE,
+								UndoRecordGetImage(rec),
+								reclen - SizeOfUndoRecord);
+				break;
+			case UNDO_DELETE:
+			case UNDO_MOVE:
+				undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_HEADER,
+								UndoRecordGetImage(rec),
+								SizeofHeapTupleHeader);
+				break;
+			default:
+				elog(ERROR, "unrecognized undo record type %u", rec->ur_type);
+		}
+
+		undoheap_apply_ops(rel, XLOG_UNDOHEAP_ROLLBACK, buffer, &ops, 1,
+						   InvalidTransactionId, InvalidBuffer, NULL, 0);
+
+		pfree(ops.data);
+		pfree(rec);
+	}
+}
+
+
+/* ----------------------------------------------------------------
+ *						 page operations
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * How to get rid of a tuple nobody can see anymore.  Without indexes,
+ * nothing can point to the line pointer, and it can be reused right away.
+ * Indexes can't be added meanwhile, because that takes a lock that conflicts
+ * with the ones held when tuples are removed.
+ */
+uint16
+undoheap_dead_op(Relation rel)
+{
+	return RelationGetForm(rel)->relhasindex ?
+		UNDOHEAP_OP_SET_DEAD : UNDOHEAP_OP_SET_UNUSED;
+}
+
+/*
+ * Append an operation on the line pointer at 'offnum' to 'ops'.
+ */
+void
+undoheap_add_op(StringInfo ops, OffsetNumber offnum, uint16 op,
+				char *data, uint32 len)
+{
+	xl_undoheap_op xlop;
+
+	xlop.offnum = offnum;
+	xlop.op = op;
+	xlop.len = len;
+	appendBinaryStringInfo(ops, (char *) &xlop, sizeof(xl_undoheap_op));
+	if (len > 0)
+		appendBinaryStringInfo(ops, data, len);
+}
+
+/*
+ * Apply one operation to a data page.  This must give the same result in do
+ * and redo, so that later records find the tuples where they expect them.
+ */
+static void
+undoheap_page_apply_op(Page page, OffsetNumber offnum, uint16 op,
+					   char *data, Size len)
+{
+	PageHeader	phdr = (PageHeader) page;
+	ItemId		lp;
+
+	switch (op)
+	{
+		case UNDOHEAP_OP_SET_TUPLE:
+			if (offnum <= PageGetMaxOffsetNumber(page))
+			{
+				lp = PageGetItemId(page, offnum);
+				if (ItemIdHasStorage(lp) &&
+					MAXALIGN(ItemIdGetLength(lp)) == MAXALIGN(len))
+				{
+					memcpy(PageGetItem(page, lp), data, len);
+					ItemIdSetNormal(lp, ItemIdGetOffset(lp), len);
+					break;
+				}
+				ItemIdSetUnused(lp);
+			}
+			if (phdr->pd_upper - phdr->pd_lower <
+				MAXALIGN(len) + sizeof(ItemIdData))
+				PageRepairFragmentation(page);
+			if (PageAddItemExtended(page, (Item) data, len, offnum,
+									PAI_OVERWRITE | PAI_IS_HEAP) != offnum)
+				elog(PANIC, "failed to add tuple to undo heap page");
+			break;
+
+		case UNDOHEAP_OP_SET_HEADER:
+			lp = PageGetItemId(page, offnum);
+			memcpy(PageGetItem(page, lp), data, SizeofHeapTupleHeader);
+			break;
+
+		case UNDOHEAP_OP_SET_DEAD:
+			ItemIdSetDead(PageGetItemId(page, offnum));
+			break;
+
+		case UNDOHEAP_OP_SET_UNUSED:
+			ItemIdSetUnused(PageGetItemId(page, offnum));
+			break;
+
+		default:
+			elog(PANIC, "unrecognized undo heap page operation %u", op);
+	}
+}
+
+/*
+ * Apply a series of operations built with undoheap_add_op() to a data page.
+ * The page is compacted if any line pointer lost its storage.
+ */
+void
+undoheap_page_apply_ops(Page page, char *ops, Size len)
+{
+	char	   *ptr = ops;
+	char	   *end = ops + len;
+	bool		compact = false;
+
+	while (ptr < end)
+	{
+		xl_undoheap_op xlop;
+
+		memcpy(&xlop, ptr, sizeof(xl_undoheap_op));
+		ptr += sizeof(xl_undoheap_op);
+
+		undoheap_page_apply_op(page, xlop.offnum, xlop.op, ptr, xlop.len);
+		if (xlop.op == UNDOHEAP_OP_SET_DEAD ||
+			xlop.op == UNDOHEAP_OP_SET_UNUSED)
+			compact = true;
+		ptr += xlop.len;
+	}
+
+	if (compact)
+		PageRepairFragmentation(page);
+}
+
+/*
+ * Apply 'ops' to the data page in 'buffer', add the undo record 'rec' to
+ * 'undobuf' if that's valid, and WAL-log it all as one record.  The caller
+ * must hold both buffers exclusively locked.  Returns the undo record's
+ * offset.
+ */
+OffsetNumber
+undoheap_apply_ops(Relation rel, uint8 info, Buffer buffer,
+				   StringInfo ops, int nops, TransactionId latestRemovedXid,
+				   Buffer undobuf, UndoRecord rec, Size reclen)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber undo_offnum = InvalidOffsetNumber;
+
+	START_CRIT_SECTION();
+
+	if (info & XLOG_UNDOHEAP_INIT_PAGE)
+		undoheap_init_page(page, UNDOHEAP_PAGE_DATA, InvalidBlockNumber);
+	undoheap_page_apply_ops(page, ops->data, ops->len);
+	MarkBufferDirty(buffer);
+
+	if (BufferIsValid(undobuf))
+	{
+		undo_offnum = PageAddItem(BufferGetPage(undobuf), (Item) rec, reclen,
+								  InvalidOffsetNumber, false, false);
+		if (undo_offnum == InvalidOffsetNumber)
+			elog(PANIC, "failed to add undo record");
+		MarkBufferDirty(undobuf);
+	}
+
+	if (RelationNeedsWAL(rel))
+	{
+		xl_undoheap_modify xlrec;
+		XLogRecPtr	recptr;
+		int			flags = REGBUF_STANDARD;
+
+		if (info & XLOG_UNDOHEAP_INIT_PAGE)
+			flags |= REGBUF_WILL_INIT;
+
+		xlrec.latestRemovedXid = latestRemovedXid;
+		xlrec.undo_offnum = undo_offnum;
+		xlrec.nops = nops;
+
+		XLogBeginInsert();
+		XLogRegisterData((char *) &xlrec, SizeOfUndoHeapModify);
+		XLogRegisterBuffer(0, buffer, flags);
+		XLogRegisterBufData(0, ops->data, ops->len);
+		if (BufferIsValid(undobuf))
+		{
+			XLogRegisterBuffer(1, undobuf, REGBUF_STANDARD);
+			XLogRegisterBufData(1, (char *) rec, reclen);
+		}
+
+		recptr = XLogInsert(RM_UNDOHEAP_ID, info);
+
+		PageSetLSN(page, recptr);
+		if (BufferIsValid(undobuf))
+			PageSetLSN(BufferGetPage(undobuf), recptr);
+	}
+
+	END_CRIT_SECTION();
+
+	return undo_offnum;
+}
+
+/*
+ * Build an undo record, palloc'd.
+ */
+static UndoRecord
+undoheap_make_undo(TransactionId xid, ItemPointer tid, uint8 type,
+				   char *image, Size imagelen, Size *reclen)
+{
+	UndoRecord	rec;
+
+	*reclen = SizeOfUndoRecord + imagelen;
+	rec = (UndoRecord) palloc0(*reclen);
+	rec->ur_xid = xid;
+	rec->ur_blkno = ItemPointerGetBlockNumber(tid);
+	rec->ur_offnum = ItemPointerGetOffsetNumber(tid);
+	rec->ur_type = type;
+	ItemPointerSetInvalid(&rec->ur_newtid);
+	if (imagelen > 0)
+		memcpy(UndoRecordGetImage(rec), image, imagelen);
+
+	return rec;
+}
+
+/*
+ * The undo pointer a record about to be added to 'undobuf' will get.
+ */
+static inline void
+undoheap_next_undoptr(Buffer undobuf, ItemPointer undoptr)
+{
+	ItemPointerSet(undoptr, BufferGetBlockNumber(undobuf),
+				   OffsetNumberNext(PageGetMaxOffsetNumber(BufferGetPage(undobuf))));
+}
+
+/*
+ * The line pointer a new tuple goes to: the first unused one, else a new one.
+ * The caller has checked that the page has room.
+ */
+static OffsetNumber
+undoheap_page_next_offset(Page page)
+{
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	OffsetNumber offnum;
+
+	if (PageHasFreeLinePointers(page))
+	{
+		for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+		{
+			ItemId		lp = PageGetItemId(page, offnum);
+
+			if (!ItemIdIsUsed(lp) && !ItemIdHasStorage(lp))
+				return offnum;
+		}
+		PageClearHasFreeLinePointers(page);
+	}
+
+	Assert(maxoff < MaxHeapTuplesPerPage);
+	return OffsetNumberNext(maxoff);
+}
+
+/*
+ * Would a tuple of 'len' bytes fit at 'offnum' in place of the current one,
+ * compacting the page if need be?
+ */
+static bool
+undoheap_page_fits(Page page, OffsetNumber offnum, Size len)
+{
+	PageHeader	phdr = (PageHeader) page;
+	ItemId		lp = PageGetItemId(page, offnum);
+	OffsetNumber maxoff = PageGetMaxOffsetNumber(page);
+	OffsetNumber i;
+	Size		used = 0;
+
+	if (MAXALIGN(len) <= MAXALIGN(ItemIdGetLength(lp)) ||
+		MAXALIGN(len) <= phdr->pd_upper - phdr->pd_lower)
+		return true;
+
+	for (i = FirstOffsetNumber; i <= maxoff; i++)
+	{
+		lp = PageGetItemId(page, i);
+		if (i != offnum && ItemIdHasStorage(lp))
+			used += MAXALIGN(ItemIdGetLength(lp));
+	}
+
+	return used + MAXALIGN(len) <= phdr->pd_special - phdr->pd_lower;
+}
+
+/*
+ * Remove tuples whose deletion is visible to everyone, and roll back changes
+ * of aborted transactions, on a data page.  The caller must hold 'buffer'
+ * exclusively locked.
+ *
+ * Deletions set pd_prune_xid, so that pages without any are left alone.
+ */
+void
+undoheap_page_prune(Relation rel, Buffer buffer)
+{
+	Page		page = BufferGetPage(buffer);
+	TransactionId prune_xid = ((PageHeader) page)->pd_prune_xid;
+	TransactionId new_prune_xid = InvalidTransactionId;
+	TransactionId latestRemovedXid = InvalidTransactionId;
+	GlobalVisState *vistest;
+	OffsetNumber maxoff;
+	OffsetNumber offnum;
+	StringInfoData ops;
+	int			nops = 0;
+
+	if (!TransactionIdIsValid(prune_xid) || PageIsNew(page))
+		return;
+
+	vistest = GlobalVisTestFor(rel);
+	initStringInfo(&ops);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		ItemId		lp = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		TransactionId xmax;
+
+		if (!ItemIdIsNormal(lp))
+			continue;
+
+		undoheap_rollback_aborted(rel, buffer, offnum);
+		if (!ItemIdIsNormal(lp))
+			continue;
+
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+		if (!UndoHeapTupleIsDeleted(htup))
+			continue;
+
+		/* Aborted deletions have been rolled back above */
+		xmax = HeapTupleHeaderGetRawXmax(htup);
+		if (GlobalVisTestIsRemovableXid(vistest, xmax) &&
+			TransactionIdDidCommit(xmax))
+		{
+			undoheap_add_op(&ops, offnum, undoheap_dead_op(rel), NULL, 0);
+			nops++;
+			if (TransactionIdFollows(xmax, latestRemovedXid))
+				latestRemovedXid = xmax;
+		}
+		else if (!TransactionIdIsValid(new_prune_xid) ||
+				 TransactionIdPrecedes(xmax, new_prune_xid))
+			new_prune_xid = xmax;
+	}
+
+	if (nops > 0)
+	{
+		((PageHeader) page)->pd_prune_xid = new_prune_xid;
+		undoheap_apply_ops(rel, XLOG_UNDOHEAP_CLEAN, buffer, &ops, nops,
+						   latestRemovedXid, InvalidBuffer, NULL, 0);
+	}
+	else if (new_prune_xid != prune_xid)
+	{
+		/* Just a hint, like in heap */
+		((PageHeader) page)->pd_prune_xid = new_prune_xid;
+		MarkBufferDirtyHint(buffer, true);
+	}
+
+	pfree(ops.data);
+}
+
+/*
+ * Return an exclusively locked data page with room for a tuple of 'len'
+ * bytes, plus the free space fillfactor reserves.  Like in heap, we try the
+ * page we last inserted into, then the free space map, then extend; pages
+ * that are almost full are pruned before giving up on them.
+ */
+Buffer
+undoheap_get_buffer_for_tuple(Relation rel, Size len)
+{
+	Size		saveFreeSpace;
+	Size		targetFreeSpace;
+	BlockNumber targetBlock;
+	Buffer		buffer;
+
+	if (len > UndoHeapMaxTupleSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too big: size %zu, maximum size %zu",
+						len, (Size) UndoHeapMaxTupleSize)));
+
+	saveFreeSpace = RelationGetTargetPageFreeSpace(rel,
+												   HEAP_DEFAULT_FILLFACTOR);
+	targetFreeSpace = MAXALIGN(len) + saveFreeSpace;
+	if (targetFreeSpace > UndoHeapMaxTupleSize)
+		targetFreeSpace = MAXALIGN(len);
+
+	targetBlock = RelationGetTargetBlock(rel);
+	if (targetBlock == InvalidBlockNumber)
+	{
+		if (RelationGetNumberOfBlocks(rel) == 0)
+			undoheap_create_metapage(rel);
+		targetBlock = GetPageWithFreeSpace(rel, targetFreeSpace);
+	}
+
+	while (targetBlock != InvalidBlockNumber)
+	{
+		Page		page;
+		Size		pageFreeSpace = 0;
+
+		buffer = ReadBuffer(rel, targetBlock);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+
+		/* The page may have been reused as an undo page since */
+		if (targetBlock != UNDOHEAP_METAPAGE_BLKNO && UndoHeapPageIsData(page))
+		{
+			if (PageIsNew(page))
+			{
+				undoheap_init_page(page, UNDOHEAP_PAGE_DATA,
+								   InvalidBlockNumber);
+				MarkBufferDirty(buffer);
+			}
+
+			pageFreeSpace = PageGetHeapFreeSpace(page);
+			if (pageFreeSpace < targetFreeSpace)
+			{
+				undoheap_page_prune(rel, buffer);
+				pageFreeSpace = PageGetHeapFreeSpace(page);
+			}
+			if (pageFreeSpace >= targetFreeSpace)
+			{
+				RelationSetTargetBlock(rel, targetBlock);
+				return buffer;
+			}
+		}
+
+		UnlockReleaseBuffer(buffer);
+		targetBlock = RecordAndGetPageWithFreeSpace(rel, targetBlock,
+													pageFreeSpace,
+													targetFreeSpace);
+	}
+
+	buffer = undoheap_new_page(rel, UNDOHEAP_PAGE_DATA);
+	RelationSetTargetBlock(rel, BufferGetBlockNumber(buffer));
+
+	return buffer;
+}
+
+
+/* ----------------------------------------------------------------
+ *						 insertion
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Set up the header of a tuple about to be inserted.
+ */
+static void
+undoheap_prepare_header(HeapTuple tup, TransactionId xid, CommandId cid)
+{
+	tup->t_data->t_infomask &= ~HEAP_XACT_MASK;
+	tup->t_data->t_infomask2 &= ~HEAP2_XACT_MASK;
+	HeapTupleHeaderSetXmin(tup->t_data, xid);
+	HeapTupleHeaderSetCmin(tup->t_data, cid);
+	HeapTupleHeaderSetXmax(tup->t_data, InvalidTransactionId);
+}
+
+/*
+ * Put an already toasted tuple on a data page, with an undo record unless
+ * 'write_undo' is false.  Sets tup->t_self.
+ */
+static void
+undoheap_insert_tuple(Relation rel, HeapTuple tup, bool write_undo)
+{
+	Buffer		buffer;
+	Buffer		undobuf = InvalidBuffer;
+	Page		page;
+	OffsetNumber offnum;
+	uint8		info = XLOG_UNDOHEAP_INSERT;
+	UndoRecord	rec = NULL;
+	Size		reclen = 0;
+	bool		extended = false;
+	StringInfoData ops;
+
+	buffer = undoheap_get_buffer_for_tuple(rel, tup->t_len);
+	page = BufferGetPage(buffer);
+	offnum = undoheap_page_next_offset(page);
+	ItemPointerSet(&tup->t_self, BufferGetBlockNumber(buffer), offnum);
+
+	if (write_undo)
+	{
+		undobuf = undoheap_reserve_undo(rel, SizeOfUndoRecord, &extended);
+		rec = undoheap_make_undo(HeapTupleHeaderGetRawXmin(tup->t_data),
+								 &tup->t_self, UNDO_INSERT, NULL, 0, &reclen);
+		undoheap_next_undoptr(undobuf, &tup->t_data->t_ctid);
+	}
+	else
+		ItemPointerSetInvalid(&tup->t_data->t_ctid);
+
+	if (PageGetMaxOffsetNumber(page) == InvalidOffsetNumber)
+		info |= XLOG_UNDOHEAP_INIT_PAGE;
+
+	initStringInfo(&ops);
+	undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_TUPLE,
+					(char *) tup->t_data, tup->t_len);
+	undoheap_apply_ops(rel, info, buffer, &ops, 1, InvalidTransactionId,
+					   undobuf, rec, reclen);
+
+	UnlockReleaseBuffer(buffer);
+	if (BufferIsValid(undobuf))
+		UnlockReleaseBuffer(undobuf);
+
+	pfree(ops.data);
+	if (rec)
+		pfree(rec);
+
+	if (extended)
+		undoheap_discard(rel, false, NULL);
+}
+
+/*
+ * Insert a tuple for the current transaction.  Sets tup->t_self.
+ */
+void
+undoheap_insert(Relation rel, HeapTuple tup, CommandId cid, int options)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	HeapTuple	heaptup;
+
+	undoheap_prepare_header(tup, xid, cid);
+	tup->t_tableOid = RelationGetRelid(rel);
+
+	if (HeapTupleHasExternal(tup) || tup->t_len > TOAST_TUPLE_THRESHOLD)
+		heaptup = heap_toast_insert_or_update(rel, tup, NULL, options);
+	else
+		heaptup = tup;
+
+	CheckForSerializableConflictIn(rel, NULL, InvalidBlockNumber);
+
+	undoheap_insert_tuple(rel, heaptup, true);
+
+	pgstat_count_heap_insert(rel, 1);
+
+	if (heaptup != tup)
+	{
+		tup->t_self = heaptup->t_self;
+		heap_freetuple(heaptup);
+	}
+}
+
+/*
+ * Insert a tuple whose header the caller has set up, without undo.  This is
+ * for filling a new relation file that is only visible once the transaction
+ * commits, like in CLUSTER.
+ */
+void
+undoheap_insert_raw(Relation rel, HeapTuple tup)
+{
+	HeapTuple	heaptup;
+
+	if (HeapTupleHasExternal(tup) || tup->t_len > TOAST_TUPLE_THRESHOLD)
+		heaptup = heap_toast_insert_or_update(rel, tup, NULL,
+											  HEAP_INSERT_SKIP_FSM);
+	else
+		heaptup = tup;
+
+	undoheap_insert_tuple(rel, heaptup, false);
+
+	if (heaptup != tup)
+		heap_freetuple(heaptup);
+}
+
+
+/* ----------------------------------------------------------------
+ *						 modification
+ * ----------------------------------------------------------------
+ */
+
+/*
+ * Check whether the current transaction may modify or lock the tuple at
+ * 'tid', waiting for other transactions as 'wait_policy' says.  Called and
+ * returns with 'buffer' exclusively locked.  On TM_Ok, nobody else can
+ * change the tuple until the lock is released.  Changes of aborted
+ * transactions are rolled back first.
+ *
+ * If 'snapshot' is an MVCC snapshot, the caller found the tuple with it, and
+ * a change it can't see makes the result TM_Updated, like in heap; unless the
+ * current transaction holds the row lock, in which case the caller has
+ * already seen the latest version when taking it.
+ *
+ * *have_tuple_lock is set if we took the heavyweight tuple lock that
+ * establishes who goes next among waiters; the caller releases it.
+ */
+static TM_Result
+undoheap_check_modify(Relation rel, Buffer buffer, ItemPointer tid,
+					  CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+					  LockWaitPolicy wait_policy, XLTW_Oper oper,
+					  bool *have_tuple_lock, TM_FailureData *tmfd)
+{
+	Page		page = BufferGetPage(buffer);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	TransactionId xid;
+
+	for (;;)
+	{
+		ItemId		lp;
+		HeapTupleHeader htup;
+		TransactionId xmax;
+		TransactionId wait_xid;
+		bool		deleted;
+
+		if (offnum > PageGetMaxOffsetNumber(page) ||
+			!ItemIdIsNormal(PageGetItemId(page, offnum)))
+		{
+			tmfd->ctid = *tid;
+			tmfd->xmax = InvalidTransactionId;
+			tmfd->cmax = InvalidCommandId;
+			return TM_Deleted;
+		}
+
+		undoheap_rollback_aborted(rel, buffer, offnum);
+
+		lp = PageGetItemId(page, offnum);
+		if (!ItemIdIsNormal(lp))
+			continue;
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+		deleted = UndoHeapTupleIsDeleted(htup);
+		xid = UndoHeapTupleGetLastXid(htup);
+		xmax = HeapTupleHeaderGetRawXmax(htup);
+
+		tmfd->ctid = *tid;
+		tmfd->xmax = xid;
+		tmfd->cmax = InvalidCommandId;
+
+		if (UndoHeapTupleIsLocked(htup) &&
+			!TransactionIdIsCurrentTransactionId(xmax) &&
+			TransactionIdIsInProgress(xmax))
+			wait_xid = xmax;
+		else if (TransactionIdIsCurrentTransactionId(xid))
+		{
+			if (HeapTupleHeaderGetRawCommandId(htup) >= cid)
+			{
+				tmfd->cmax = HeapTupleHeaderGetRawCommandId(htup);
+				return TM_SelfModified;
+			}
+			if (deleted)
+				return TM_Invisible;
+			break;
+		}
+		else if (TransactionIdIsNormal(xid) && TransactionIdIsInProgress(xid))
+			wait_xid = xid;
+		else
+		{
+			/* Aborted just now?  Then go roll it back. */
+			if (TransactionIdIsNormal(xid) && !TransactionIdDidCommit(xid))
+				continue;
+
+			if (deleted)
+			{
+				if (htup->t_infomask & UNDOHEAP_XMAX_MOVED)
+				{
+					ItemPointerData undoptr = htup->t_ctid;
+					UndoRecord	rec;
+					Size		reclen;
+
+					rec = undoheap_read_undo(rel, &undoptr, &reclen);
+					tmfd->ctid = rec->ur_newtid;
+					pfree(rec);
+					return TM_Updated;
+				}
+				return TM_Deleted;
+			}
+
+			if (snapshot != NULL && IsMVCCSnapshot(snapshot) &&
+				!(UndoHeapTupleIsLocked(htup) &&
+				  TransactionIdIsCurrentTransactionId(xmax)) &&
+				!undoheap_op_visible(xid, InvalidCommandId, false,
+									 (htup->t_infomask & HEAP_XMIN_COMMITTED) != 0,
+									 snapshot))
+				return TM_Updated;
+			break;
+		}
+
+		/* Wait for the transaction that is in our way, then look again */
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		if (!*have_tuple_lock)
+		{
+			switch (wait_policy)
+			{
+				case LockWaitBlock:
+					LockTuple(rel, tid, ExclusiveLock);
+					break;
+				case LockWaitSkip:
+					if (!ConditionalLockTuple(rel, tid, ExclusiveLock))
+					{
+						LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+						return TM_WouldBlock;
+					}
+					break;
+				case LockWaitError:
+					if (!ConditionalLockTuple(rel, tid, ExclusiveLock))
+						ereport(ERROR,
+								(errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+								 errmsg("could not obtain lock on row in relation \"%s\"",
+										RelationGetRelationName(rel))));
+					break;
+			}
+			*have_tuple_lock = true;
+		}
+
+		switch (wait_policy)
+		{
+			case LockWaitBlock:
+				XactLockTableWait(wait_xid, rel, tid, oper);
+				break;
+			case LockWaitSkip:
+				if (!ConditionalXactLockTableWait(wait_xid))
+				{
+					LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+					return TM_WouldBlock;
+				}
+				break;
+			case LockWaitError:
+				if (!ConditionalXactLockTableWait(wait_xid))
+					ereport(ERROR,
+							(errcode(ERRCODE_LOCK_NOT_AVAILABLE),
+							 errmsg("could not obtain lock on row in relation \"%s\"",
+									RelationGetRelationName(rel))));
+				break;
+		}
+
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	}
+
+	if (crosscheck != InvalidSnapshot)
+	{
+		HeapTuple	version;
+
+		version = undoheap_get_version(rel, buffer, offnum, crosscheck);
+		if (version == NULL)
+			return TM_Updated;
+		heap_freetuple(version);
+	}
+
+	return TM_Ok;
+}
+
+/*
+ * Set a row lock of 'xid' on the tuple at 'offnum', unless it has one.
+ * Row locks don't write undo: they only matter while 'xid' is running.
+ */
+static void
+undoheap_set_lock(Relation rel, Buffer buffer, OffsetNumber offnum,
+				  TransactionId xid)
+{
+	Page		page = BufferGetPage(buffer);
+	HeapTupleHeader htup;
+	HeapTupleHeaderData hdr;
+	StringInfoData ops;
+
+	htup = (HeapTupleHeader) PageGetItem(page, PageGetItemId(page, offnum));
+	if (UndoHeapTupleIsLocked(htup) &&
+		TransactionIdEquals(HeapTupleHeaderGetRawXmax(htup), xid))
+		return;
+
+	memcpy(&hdr, htup, SizeofHeapTupleHeader);
+	hdr.t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+	hdr.t_infomask |= UNDOHEAP_XMAX_LOCK_ONLY | HEAP_XMAX_EXCL_LOCK;
+	HeapTupleHeaderSetXmax(&hdr, xid);
+
+	initStringInfo(&ops);
+	undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_HEADER, (char *) &hdr,
+					SizeofHeapTupleHeader);
+	undoheap_apply_ops(rel, XLOG_UNDOHEAP_LOCK, buffer, &ops, 1,
+					   InvalidTransactionId, InvalidBuffer, NULL, 0);
+	pfree(ops.data);
+}
+
+/*
+ * Mark the tuple at 'offnum' deleted by 'xid', or moved to 'newtid' if that
+ * isn't NULL, writing an undo record with its previous header.
+ */
+static void
+undoheap_set_deleted(Relation rel, Buffer buffer, OffsetNumber offnum,
+					 TransactionId xid, CommandId cid, ItemPointer newtid,
+					 bool *extended)
+{
+	Page		page = BufferGetPage(buffer);
+	HeapTupleHeader htup;
+	HeapTupleHeaderData hdr;
+	ItemPointerData tid;
+	Buffer		undobuf;
+	UndoRecord	rec;
+	Size		reclen;
+	StringInfoData ops;
+
+	ItemPointerSet(&tid, BufferGetBlockNumber(buffer), offnum);
+	htup = (HeapTupleHeader) PageGetItem(page, PageGetItemId(page, offnum));
+
+	undobuf = undoheap_reserve_undo(rel, SizeOfUndoRecord + SizeofHeapTupleHeader,
+									extended);
+	rec = undoheap_make_undo(xid, &tid, newtid ? UNDO_MOVE : UNDO_DELETE,
+							 (char *) htup, SizeofHeapTupleHeader, &reclen);
+	if (newtid)
+		rec->ur_newtid = *newtid;
+
+	memcpy(&hdr, htup, SizeofHeapTupleHeader);
+	hdr.t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+	if (newtid)
+		hdr.t_infomask |= UNDOHEAP_XMAX_MOVED;
+	HeapTupleHeaderSetXmax(&hdr, xid);
+	HeapTupleHeaderSetCmax(&hdr, cid, false);
+	undoheap_next_undoptr(undobuf, &hdr.t_ctid);
+
+	/* A hint for pruning, which needn't be WAL-logged */
+	PageSetPrunable(page, xid);
+
+	initStringInfo(&ops);
+	undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_HEADER, (char *) &hdr,
+					SizeofHeapTupleHeader);
+	undoheap_apply_ops(rel, XLOG_UNDOHEAP_DELETE, buffer, &ops, 1,
+					   InvalidTransactionId, undobuf, rec, reclen);
+
+	UnlockReleaseBuffer(undobuf);
+	pfree(ops.data);
+	pfree(rec);
+}
+
+/*
+ * Delete the tuple at 'tid'.  See table_tuple_delete().
+ */
+TM_Result
+undoheap_delete(Relation rel, ItemPointer tid, CommandId cid,
+				Snapshot snapshot, Snapshot crosscheck, bool wait,
+				TM_FailureData *tmfd)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	Buffer		buffer;
+	Page		page;
+	TM_Result	result;
+	bool		have_tuple_lock = false;
+	bool		extended = false;
+	HeapTuple	oldtup = NULL;
+	ItemId		lp;
+
+	buffer = ReadBuffer(rel, blkno);
+	page = BufferGetPage(buffer);
+
+	CheckForSerializableConflictIn(rel, tid, blkno);
+
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	result = undoheap_check_modify(rel, buffer, tid, cid, snapshot, crosscheck,
+								   wait ? LockWaitBlock : LockWaitSkip,
+								   XLTW_Delete, &have_tuple_lock, tmfd);
+	if (result != TM_Ok)
+	{
+		UnlockReleaseBuffer(buffer);
+		if (have_tuple_lock)
+			UnlockTuple(rel, tid, ExclusiveLock);
+		return result;
+	}
+
+	/* Keep a copy for deleting its toasted values afterwards */
+	lp = PageGetItemId(page, offnum);
+	if (HeapTupleHeaderHasExternal((HeapTupleHeader) PageGetItem(page, lp)))
+	{
+		oldtup = undoheap_copy_tuple((HeapTupleHeader) PageGetItem(page, lp),
+									 ItemIdGetLength(lp));
+		oldtup->t_self = *tid;
+		oldtup->t_tableOid = RelationGetRelid(rel);
+	}
+
+	undoheap_set_deleted(rel, buffer, offnum, xid, cid, NULL, &extended);
+
+	UnlockReleaseBuffer(buffer);
+
+	if (oldtup)
+	{
+		heap_toast_delete(rel, oldtup, false);
+		heap_freetuple(oldtup);
+	}
+
+	if (have_tuple_lock)
+		UnlockTuple(rel, tid, ExclusiveLock);
+
+	pgstat_count_heap_delete(rel);
+
+	if (extended)
+		undoheap_discard(rel, false, NULL);
+
+	return TM_Ok;
+}
+
+/*
+ * Did any column in 'attrs' change between 'oldtup' and 'newtup'?  Values
+ * are compared binary, so this may report changes that aren't.
+ */
+static bool
+undoheap_index_attrs_changed(Relation rel, Bitmapset *attrs,
+							 HeapTuple oldtup, HeapTuple newtup)
+{
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	int			attnum = -1;
+
+	while ((attnum = bms_next_member(attrs, attnum)) >= 0)
+	{
+		AttrNumber	attno = attnum + FirstLowInvalidHeapAttributeNumber;
+		Form_pg_attribute att;
+		Datum		value1;
+		Datum		value2;
+		bool		isnull1;
+		bool		isnull2;
+
+		/* A whole-row reference in an index expression or predicate */
+		if (attno == InvalidAttrNumber)
+			return true;
+		/* System columns don't change */
+		if (attno < 0)
+			continue;
+
+		value1 = heap_getattr(oldtup, attno, tupdesc, &isnull1);
+		value2 = heap_getattr(newtup, attno, tupdesc, &isnull2);
+		if (isnull1 != isnull2)
+			return true;
+		if (isnull1)
+			continue;
+
+		att = TupleDescAttr(tupdesc, attno - 1);
+		if (!datumIsEqual(value1, value2, att->attbyval, att->attlen))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * Update the tuple at 'otid'.  See table_tuple_update().
+ *
+ * The new version replaces the old one in place if no indexed column
+ * changed and it fits on the page; the old version goes to the undo log,
+ * and the indexes need no new entries.  Otherwise the new version is
+ * inserted like a new tuple and the old one is marked as moved, and
+ * *update_indexes is set.
+ */
+TM_Result
+undoheap_update(Relation rel, ItemPointer otid, HeapTuple newtup,
+				CommandId cid, Snapshot snapshot, Snapshot crosscheck,
+				bool wait, TM_FailureData *tmfd, bool *update_indexes)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	BlockNumber blkno = ItemPointerGetBlockNumber(otid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(otid);
+	Bitmapset  *interesting_attrs;
+	Buffer		buffer;
+	Page		page;
+	ItemId		lp;
+	HeapTupleData oldtup;
+	HeapTuple	heaptup;
+	TM_Result	result;
+	bool		have_tuple_lock = false;
+	bool		extended = false;
+	bool		in_place;
+
+	*update_indexes = false;
+	interesting_attrs = RelationGetIndexAttrBitmap(rel, INDEX_ATTR_BITMAP_ALL);
+
+	buffer = ReadBuffer(rel, blkno);
+	page = BufferGetPage(buffer);
+
+	CheckForSerializableConflictIn(rel, otid, blkno);
+
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+	result = undoheap_check_modify(rel, buffer, otid, cid, snapshot, crosscheck,
+								   wait ? LockWaitBlock : LockWaitSkip,
+								   XLTW_Update, &have_tuple_lock, tmfd);
+	if (result != TM_Ok)
+	{
+		UnlockReleaseBuffer(buffer);
+		if (have_tuple_lock)
+			UnlockTuple(rel, otid, ExclusiveLock);
+		bms_free(interesting_attrs);
+		return result;
+	}
+
+	undoheap_prepare_header(newtup, xid, cid);
+	newtup->t_tableOid = RelationGetRelid(rel);
+
+	lp = PageGetItemId(page, offnum);
+	oldtup.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+	oldtup.t_len = ItemIdGetLength(lp);
+	oldtup.t_self = *otid;
+	oldtup.t_tableOid = RelationGetRelid(rel);
+
+	in_place = !undoheap_index_attrs_changed(rel, interesting_attrs, &oldtup,
+											 newtup);
+
+	if (HeapTupleHasExternal(&oldtup) || HeapTupleHasExternal(newtup) ||
+		newtup->t_len > TOAST_TUPLE_THRESHOLD)
+	{
+		HeapTuple	oldcopy;
+
+		/*
+		 * Toasting can take a while, and mustn't happen while holding the
+		 * buffer lock.  Lock the row meanwhile.
+		 */
+		oldcopy = undoheap_copy_tuple(oldtup.t_data, oldtup.t_len);
+		oldcopy->t_self = *otid;
+		oldcopy->t_tableOid = RelationGetRelid(rel);
+		undoheap_set_lock(rel, buffer, offnum, xid);
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		heaptup = heap_toast_insert_or_update(rel, newtup, oldcopy, 0);
+		heap_freetuple(oldcopy);
+
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		lp = PageGetItemId(page, offnum);
+		oldtup.t_data = (HeapTupleHeader) PageGetItem(page, lp);
+		oldtup.t_len = ItemIdGetLength(lp);
+	}
+	else
+		heaptup = newtup;
+
+	if (heaptup->t_len > UndoHeapMaxTupleSize)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("row is too big: size %zu, maximum size %zu",
+						(Size) heaptup->t_len, (Size) UndoHeapMaxTupleSize)));
+
+	in_place = in_place && oldtup.t_len <= UndoHeapMaxInPlaceSize &&
+		undoheap_page_fits(page, offnum, heaptup->t_len);
+
+	if (in_place)
+	{
+		Buffer		undobuf;
+		UndoRecord	rec;
+		Size		reclen;
+		Size		newlen;
+		char	   *newdata;
+		StringInfoData ops;
+
+		undobuf = undoheap_reserve_undo(rel, SizeOfUndoRecord + oldtup.t_len,
+										&extended);
+		rec = undoheap_make_undo(xid, otid, UNDO_UPDATE,
+								 (char *) oldtup.t_data, oldtup.t_len,
+								 &reclen);
+		undoheap_next_undoptr(undobuf, &heaptup->t_data->t_ctid);
+
+		/*
+		 * A shrinking tuple keeps its space, padded with zeroes past the
+		 * attributes, so that rolling back the update always finds room for
+		 * the old version.
+		 */
+		newlen = Max(heaptup->t_len, oldtup.t_len);
+		newdata = palloc0(newlen);
+		memcpy(newdata, heaptup->t_data, heaptup->t_len);
+
+		initStringInfo(&ops);
+		undoheap_add_op(&ops, offnum, UNDOHEAP_OP_SET_TUPLE, newdata, newlen);
+		undoheap_apply_ops(rel, XLOG_UNDOHEAP_UPDATE, buffer, &ops, 1,
+						   InvalidTransactionId, undobuf, rec, reclen);
+
+		UnlockReleaseBuffer(undobuf);
+		UnlockReleaseBuffer(buffer);
+		pfree(ops.data);
+		pfree(newdata);
+		pfree(rec);
+
+		heaptup->t_self = *otid;
+	}
+	else
+	{
+		/*
+		 * Insert the new version elsewhere while holding the row lock, then
+		 * mark the old one as moved.
+		 */
+		undoheap_set_lock(rel, buffer, offnum, xid);
+		LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+
+		undoheap_insert_tuple(rel, heaptup, true);
+
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		undoheap_set_deleted(rel, buffer, offnum, xid, cid, &heaptup->t_self,
+							 &extended);
+		UnlockReleaseBuffer(buffer);
+
+		*update_indexes = true;
+	}
+
+	if (have_tuple_lock)
+		UnlockTuple(rel, otid, ExclusiveLock);
+
+	pgstat_count_heap_update(rel, in_place);
+
+	newtup->t_self = heaptup->t_self;
+	if (heaptup != newtup)
+		heap_freetuple(heaptup);
+	bms_free(interesting_attrs);
+
+	if (extended)
+		undoheap_discard(rel, false, NULL);
+
+	return TM_Ok;
+}
+
+/*
+ * Lock the tuple at 'tid'.  See table_tuple_lock().
+ *
+ * All lock modes take the same exclusive row lock.  On success, *tuple is
+ * set to a palloc'd copy of the latest version.
+ */
+TM_Result
+undoheap_lock_tuple(Relation rel, ItemPointer tid, Snapshot snapshot,
+					CommandId cid, LockWaitPolicy wait_policy, uint8 flags,
+					HeapTuple *tuple, TM_FailureData *tmfd)
+{
+	TransactionId xid = GetCurrentTransactionId();
+	ItemPointerData ctid = *tid;
+
+	*tuple = NULL;
+	tmfd->traversed = false;
+
+	for (;;)
+	{
+		BlockNumber blkno = ItemPointerGetBlockNumber(&ctid);
+		OffsetNumber offnum = ItemPointerGetOffsetNumber(&ctid);
+		Buffer		buffer;
+		Page		page;
+		ItemId		lp;
+		TM_Result	result;
+		bool		have_tuple_lock = false;
+
+		buffer = ReadBuffer(rel, blkno);
+		page = BufferGetPage(buffer);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+		result = undoheap_check_modify(rel, buffer, &ctid, cid, NULL,
+									   InvalidSnapshot, wait_policy,
+									   XLTW_Lock, &have_tuple_lock, tmfd);
+
+		if (result == TM_Ok && snapshot != NULL && IsMVCCSnapshot(snapshot))
+		{
+			HeapTupleHeader htup;
+			TransactionId last_xid;
+
+			/*
+			 * A change the snapshot can't see makes this fail, unless we're
+			 * asked for the latest version.
+			 */
+			lp = PageGetItemId(page, offnum);
+			htup = (HeapTupleHeader) PageGetItem(page, lp);
+			last_xid = UndoHeapTupleGetLastXid(htup);
+			if (!undoheap_op_visible(last_xid,
+									 HeapTupleHeaderGetRawCommandId(htup),
+									 false, false, snapshot))
+			{
+				if (flags & TUPLE_LOCK_FLAG_FIND_LAST_VERSION)
+					tmfd->traversed = true;
+				else if (!TransactionIdIsCurrentTransactionId(last_xid))
+				{
+					tmfd->ctid = ctid;
+					tmfd->xmax = last_xid;
+					result = TM_Updated;
+				}
+			}
+		}
+
+		if (result == TM_Ok)
+		{
+			undoheap_set_lock(rel, buffer, offnum, xid);
+
+			lp = PageGetItemId(page, offnum);
+			*tuple = undoheap_copy_tuple((HeapTupleHeader) PageGetItem(page, lp),
+										 ItemIdGetLength(lp));
+			(*tuple)->t_self = ctid;
+			(*tuple)->t_tableOid = RelationGetRelid(rel);
+		}
+
+		UnlockReleaseBuffer(buffer);
+		if (have_tuple_lock)
+			UnlockTuple(rel, &ctid, ExclusiveLock);
+
+		/* Follow a move to the new version, if asked to */
+		if (result == TM_Updated &&
+			(flags & TUPLE_LOCK_FLAG_FIND_LAST_VERSION) &&
+			!ItemPointerEquals(&tmfd->ctid, &ctid))
+		{
+			ctid = tmfd->ctid;
+			tmfd->traversed = true;
+			continue;
+		}
+
+		return result;
+	}
+}
+
+/*
+ * Remove a tuple the current transaction has inserted, for a speculative
+ * insertion that didn't work out.
+ */
+void
+undoheap_kill_tuple(Relation rel, ItemPointer tid)
+{
+	Buffer		buffer;
+	Page		page;
+	ItemId		lp;
+	HeapTuple	oldtup = NULL;
+	StringInfoData ops;
+
+	buffer = ReadBuffer(rel, ItemPointerGetBlockNumber(tid));
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buffer);
+	lp = PageGetItemId(page, ItemPointerGetOffsetNumber(tid));
+	Assert(ItemIdIsNormal(lp));
+
+	if (HeapTupleHeaderHasExternal((HeapTupleHeader) PageGetItem(page, lp)))
+	{
+		oldtup = undoheap_copy_tuple((HeapTupleHeader) PageGetItem(page, lp),
+									 ItemIdGetLength(lp));
+		oldtup->t_self = *tid;
+		oldtup->t_tableOid = RelationGetRelid(rel);
+	}
+
+	initStringInfo(&ops);
+	undoheap_add_op(&ops, ItemPointerGetOffsetNumber(tid),
+					undoheap_dead_op(rel), NULL, 0);
+	undoheap_apply_ops(rel, XLOG_UNDOHEAP_ROLLBACK, buffer, &ops, 1,
+					   InvalidTransactionId, InvalidBuffer, NULL, 0);
+	pfree(ops.data);
+
+	UnlockReleaseBuffer(buffer);
+
+	if (oldtup)
+	{
+		heap_toast_delete(rel, oldtup, true);
+		heap_freetuple(oldtup);
+	}
+}
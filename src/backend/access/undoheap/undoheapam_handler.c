@@ -0,0 +1,1896 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheapam_handler.c
+ *	  Table access method routines for undo heap tables.
+ *
+ * An undo heap table keeps one version of each row on its data pages and
+ * updates rows in place when no indexed column changes, writing the previous
+ * state to an undo log kept in the same relation.  Readers rebuild older
+ * versions from the undo log.  Updated rows don't leave dead versions
+ * behind, so tables with frequent updates don't bloat, and need far less
+ * VACUUM work.  See src/backend/access/undoheap/README.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/undoheap/undoheapam_handler.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/genam.h"
+#include "access/heapam.h"
+#include "access/heaptoast.h"
+#include "access/multixact.h"
+#include "access/tableam.h"
+#include "access/transam.h"
+#include "access/tsmapi.h"
+#include "access/undoheap.h"
+#include "access/valid.h"
+#include "access/xact.h"
+#include "catalog/index.h"
+#include "catalog/pg_am_d.h"
+#include "catalog/storage.h"
+#include "catalog/storage_xlog.h"
+#include "commands/progress.h"
+#include "executor/executor.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/bufmgr.h"
+#include "storage/predicate.h"
+#include "storage/procarray.h"
+#include "storage/smgr.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/tuplesort.h"
+
+/* For planner estimates, see undoheap_estimate_rel_size() */
+#define UNDOHEAP_OVERHEAD_BYTES_PER_TUPLE \
+	(MAXALIGN(SizeofHeapTupleHeader) + sizeof(ItemIdData))
+#define UNDOHEAP_USABLE_BYTES_PER_PAGE \
+	(BLCKSZ - SizeOfPageHeaderData - MAXALIGN(sizeof(UndoHeapPageOpaqueData)))
+
+static const TableAmRoutine undoheap_methods;
+
+static void undoheap_scan_page(UndoHeapScanDesc scan, BlockNumber blkno,
+							   Snapshot snapshot);
+static bool undoheap_recently_updated(Relation rel, HeapTupleHeader htup,
+									  GlobalVisState *vistest);
+static HeapTuple undoheap_getnext(UndoHeapScanDesc scan,
+								  ScanDirection direction);
+static BlockNumber undoheap_scan_get_blocks_done(UndoHeapScanDesc scan);
+
+
+/* ------------------------------------------------------------------------
+ * Slot related callbacks for undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Tuples are always copies, there is no buffer to keep pinned.
+ */
+static const TupleTableSlotOps *
+undoheap_slot_callbacks(Relation relation)
+{
+	return &TTSOpsHeapTuple;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Sequential scan callbacks for undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Copy the tuples of data page 'blkno' visible to 'snapshot' that pass the
+ * scan keys into rs_tuples, in offset order, and make it the current page.
+ *
+ * With a SnapshotNonVacuumable, as used by index builds, this also notes
+ * whether a tuple has an older version some running transaction may see.
+ */
+static void
+undoheap_scan_page(UndoHeapScanDesc scan, BlockNumber blkno,
+				   Snapshot snapshot)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	TupleDesc	tupdesc = RelationGetDescr(rel);
+	Buffer		buffer;
+	Page		page;
+	OffsetNumber maxoff;
+	OffsetNumber offnum;
+	MemoryContext oldcxt;
+
+	MemoryContextReset(scan->rs_pagecxt);
+	scan->rs_cblock = blkno;
+	scan->rs_ntuples = 0;
+	scan->rs_ndead = 0;
+	scan->rs_maxoff = InvalidOffsetNumber;
+
+	/* The metapage holds no tuples */
+	if (blkno == UNDOHEAP_METAPAGE_BLKNO)
+		return;
+
+	buffer = ReadBufferExtended(rel, MAIN_FORKNUM, blkno, RBM_NORMAL,
+								scan->rs_strategy);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (PageIsNew(page) || !UndoHeapPageIsData(page))
+	{
+		UnlockReleaseBuffer(buffer);
+		return;
+	}
+
+	oldcxt = MemoryContextSwitchTo(scan->rs_pagecxt);
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	scan->rs_maxoff = maxoff;
+	for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+	{
+		ItemId		lp = PageGetItemId(page, offnum);
+		HeapTupleHeader htup;
+		HeapTuple	tuple;
+
+		if (ItemIdIsDead(lp))
+			scan->rs_ndead++;
+		if (!ItemIdIsNormal(lp))
+			continue;
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+
+		tuple = undoheap_get_version(rel, buffer, offnum, snapshot);
+		if (tuple == NULL)
+		{
+			if (UndoHeapTupleIsDeleted(htup))
+				scan->rs_ndead++;
+			continue;
+		}
+
+		if (scan->rs_base.rs_nkeys > 0)
+		{
+			bool		valid;
+
+			HeapKeyTest(tuple, tupdesc, scan->rs_base.rs_nkeys,
+						scan->rs_base.rs_key, valid);
+			if (!valid)
+				continue;
+		}
+
+		if (snapshot->snapshot_type == SNAPSHOT_NON_VACUUMABLE &&
+			!scan->rs_recently_updated &&
+			undoheap_recently_updated(rel, htup, snapshot->vistest))
+			scan->rs_recently_updated = true;
+
+		scan->rs_alive[scan->rs_ntuples] = !UndoHeapTupleIsDeleted(htup);
+		scan->rs_tuples[scan->rs_ntuples++] = tuple;
+	}
+
+	MemoryContextSwitchTo(oldcxt);
+	UnlockReleaseBuffer(buffer);
+}
+
+/*
+ * Might a transaction that is still running see a version of the tuple with
+ * different column values than the one on the page?  An index built from the
+ * page version would be wrong for it.
+ */
+static bool
+undoheap_recently_updated(Relation rel, HeapTupleHeader htup,
+						  GlobalVisState *vistest)
+{
+	HeapTupleHeaderData hdr;
+
+	memcpy(&hdr, htup, SizeofHeapTupleHeader);
+	for (;;)
+	{
+		TransactionId xid = UndoHeapTupleGetLastXid(&hdr);
+		ItemPointerData undoptr = hdr.t_ctid;
+		UndoRecord	rec;
+		Size		reclen;
+		uint8		type;
+
+		if (!TransactionIdIsNormal(xid) ||
+			GlobalVisTestIsRemovableXid(vistest, xid) ||
+			!ItemPointerIsValid(&undoptr))
+			return false;
+
+		rec = undoheap_read_undo(rel, &undoptr, &reclen);
+		type = rec->ur_type;
+		if (type == UNDO_DELETE || type == UNDO_MOVE)
+			memcpy(&hdr, UndoRecordGetImage(rec), SizeofHeapTupleHeader);
+		pfree(rec);
+
+		if (type == UNDO_UPDATE)
+			return true;
+		if (type == UNDO_INSERT)
+			return false;
+	}
+}
+
+static TableScanDesc
+undoheap_beginscan(Relation relation, Snapshot snapshot,
+				   int nkeys, ScanKey key,
+				   ParallelTableScanDesc parallel_scan,
+				   uint32 flags)
+{
+	UndoHeapScanDesc scan;
+
+	/* Like in heap, hold a reference to the relation as long as we scan it */
+	RelationIncrementReferenceCount(relation);
+
+	scan = (UndoHeapScanDesc) palloc0(sizeof(UndoHeapScanDescData));
+	scan->rs_base.rs_rd = relation;
+	scan->rs_base.rs_snapshot = snapshot;
+	scan->rs_base.rs_nkeys = nkeys;
+	scan->rs_base.rs_flags = flags;
+	scan->rs_base.rs_parallel = parallel_scan;
+	scan->rs_pagecxt = AllocSetContextCreate(CurrentMemoryContext,
+											 "undo heap scan page",
+											 ALLOCSET_DEFAULT_SIZES);
+
+	if (parallel_scan != NULL)
+		scan->rs_parallelworkerdata = palloc(sizeof(ParallelBlockTableScanWorkerData));
+
+	if (nkeys > 0)
+	{
+		scan->rs_base.rs_key = (ScanKey) palloc(sizeof(ScanKeyData) * nkeys);
+		memcpy(scan->rs_base.rs_key, key, sizeof(ScanKeyData) * nkeys);
+	}
+
+	if (scan->rs_base.rs_flags & (SO_TYPE_SEQSCAN | SO_TYPE_SAMPLESCAN))
+		PredicateLockRelation(relation, snapshot);
+
+	if (parallel_scan != NULL)
+		scan->rs_nblocks = ((ParallelBlockTableScanDesc) parallel_scan)->phs_nblocks;
+	else
+		scan->rs_nblocks = RelationGetNumberOfBlocks(relation);
+	scan->rs_startblock = 0;
+	scan->rs_numblocks = InvalidBlockNumber;
+	scan->rs_cblock = InvalidBlockNumber;
+
+	if (flags & SO_ALLOW_STRAT &&
+		scan->rs_nblocks > NBuffers / 4 &&
+		!RelationUsesLocalBuffers(relation))
+		scan->rs_strategy = GetAccessStrategy(BAS_BULKREAD);
+
+	return (TableScanDesc) scan;
+}
+
+static void
+undoheap_endscan(TableScanDesc sscan)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	RelationDecrementReferenceCount(sscan->rs_rd);
+
+	if (scan->rs_strategy != NULL)
+		FreeAccessStrategy(scan->rs_strategy);
+	if (sscan->rs_flags & SO_TEMP_SNAPSHOT)
+		UnregisterSnapshot(sscan->rs_snapshot);
+
+	MemoryContextDelete(scan->rs_pagecxt);
+	if (scan->rs_parallelworkerdata != NULL)
+		pfree(scan->rs_parallelworkerdata);
+	if (sscan->rs_key)
+		pfree(sscan->rs_key);
+	pfree(scan);
+}
+
+static void
+undoheap_rescan(TableScanDesc sscan, ScanKey key, bool set_params,
+				bool allow_strat, bool allow_sync, bool allow_pagemode)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	if (set_params)
+	{
+		if (allow_strat)
+			sscan->rs_flags |= SO_ALLOW_STRAT;
+		else
+			sscan->rs_flags &= ~SO_ALLOW_STRAT;
+	}
+
+	if (key != NULL && sscan->rs_nkeys > 0)
+		memcpy(sscan->rs_key, key, sscan->rs_nkeys * sizeof(ScanKeyData));
+
+	/* The relation may have grown since the scan started */
+	if (sscan->rs_parallel != NULL)
+		scan->rs_nblocks = ((ParallelBlockTableScanDesc) sscan->rs_parallel)->phs_nblocks;
+	else
+		scan->rs_nblocks = RelationGetNumberOfBlocks(sscan->rs_rd);
+
+	MemoryContextReset(scan->rs_pagecxt);
+	scan->rs_inited = false;
+	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_ntuples = 0;
+	scan->rs_cindex = 0;
+}
+
+/*
+ * Restrict the scan to 'numBlks' blocks starting at 'startBlk', for building
+ * an index on part of the table.
+ */
+static void
+undoheap_setscanlimits(UndoHeapScanDesc scan, BlockNumber startBlk,
+					   BlockNumber numBlks)
+{
+	Assert(!scan->rs_inited);
+	scan->rs_startblock = startBlk;
+	scan->rs_numblocks = numBlks;
+}
+
+/*
+ * Load the next page of the scan in 'direction'.  Returns false at the end of
+ * the scan, after which a scan in the other direction starts over from the
+ * other end.
+ */
+static bool
+undoheap_scan_next_page(UndoHeapScanDesc scan, ScanDirection direction)
+{
+	Relation	rel = scan->rs_base.rs_rd;
+	ParallelBlockTableScanDesc pbscan =
+	(ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+	BlockNumber endblock;
+	BlockNumber blkno;
+
+	endblock = scan->rs_nblocks;
+	if (scan->rs_numblocks != InvalidBlockNumber &&
+		scan->rs_startblock + scan->rs_numblocks < endblock)
+		endblock = scan->rs_startblock + scan->rs_numblocks;
+
+	if (pbscan != NULL)
+	{
+		/* Parallel scans only go forward */
+		if (!scan->rs_inited)
+			table_block_parallelscan_startblock_init(rel,
+													 scan->rs_parallelworkerdata,
+													 pbscan);
+		blkno = table_block_parallelscan_nextpage(rel,
+												  scan->rs_parallelworkerdata,
+												  pbscan);
+	}
+	else if (!scan->rs_inited)
+	{
+		if (scan->rs_startblock >= endblock)
+			blkno = InvalidBlockNumber;
+		else if (ScanDirectionIsBackward(direction))
+			blkno = endblock - 1;
+		else
+			blkno = scan->rs_startblock;
+	}
+	else if (ScanDirectionIsBackward(direction))
+	{
+		if (scan->rs_cblock <= scan->rs_startblock)
+			blkno = InvalidBlockNumber;
+		else
+			blkno = scan->rs_cblock - 1;
+	}
+	else
+	{
+		if (scan->rs_cblock + 1 >= endblock)
+			blkno = InvalidBlockNumber;
+		else
+			blkno = scan->rs_cblock + 1;
+	}
+
+	if (!BlockNumberIsValid(blkno))
+	{
+		MemoryContextReset(scan->rs_pagecxt);
+		scan->rs_inited = false;
+		scan->rs_cblock = InvalidBlockNumber;
+		scan->rs_ntuples = 0;
+		return false;
+	}
+
+	scan->rs_inited = true;
+	undoheap_scan_page(scan, blkno, scan->rs_base.rs_snapshot);
+	scan->rs_cindex = ScanDirectionIsBackward(direction) ? scan->rs_ntuples : -1;
+
+	return true;
+}
+
+/*
+ * Return the next tuple of the scan, valid until the next page is loaded.
+ */
+static HeapTuple
+undoheap_getnext(UndoHeapScanDesc scan, ScanDirection direction)
+{
+	for (;;)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (scan->rs_inited)
+		{
+			if (ScanDirectionIsBackward(direction))
+			{
+				if (scan->rs_cindex > 0)
+					return scan->rs_tuples[--scan->rs_cindex];
+			}
+			else if (scan->rs_cindex + 1 < scan->rs_ntuples)
+				return scan->rs_tuples[++scan->rs_cindex];
+		}
+
+		if (!undoheap_scan_next_page(scan, direction))
+			return NULL;
+	}
+}
+
+static bool
+undoheap_getnextslot(TableScanDesc sscan, ScanDirection direction,
+					 TupleTableSlot *slot)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+	HeapTuple	tuple;
+
+	/* The executor never asks for NoMovementScanDirection here */
+	tuple = undoheap_getnext(scan, direction);
+	if (tuple == NULL)
+	{
+		ExecClearTuple(slot);
+		return false;
+	}
+
+	pgstat_count_heap_getnext(sscan->rs_rd);
+	ExecStoreHeapTuple(tuple, slot, false);
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Index scan callbacks for undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+static IndexFetchTableData *
+undoheap_index_fetch_begin(Relation rel)
+{
+	IndexFetchUndoHeapData *uscan = palloc0(sizeof(IndexFetchUndoHeapData));
+
+	uscan->xs_base.rel = rel;
+	uscan->xs_cbuf = InvalidBuffer;
+
+	return &uscan->xs_base;
+}
+
+static void
+undoheap_index_fetch_reset(IndexFetchTableData *scan)
+{
+	IndexFetchUndoHeapData *uscan = (IndexFetchUndoHeapData *) scan;
+
+	if (BufferIsValid(uscan->xs_cbuf))
+	{
+		ReleaseBuffer(uscan->xs_cbuf);
+		uscan->xs_cbuf = InvalidBuffer;
+	}
+}
+
+static void
+undoheap_index_fetch_end(IndexFetchTableData *scan)
+{
+	IndexFetchUndoHeapData *uscan = (IndexFetchUndoHeapData *) scan;
+
+	undoheap_index_fetch_reset(scan);
+
+	pfree(uscan);
+}
+
+/*
+ * Index entries point to the tuple's only line pointer, so there is never
+ * more than one match, and *call_again is always left false.  The entry is
+ * dead once the line pointer is.
+ */
+static bool
+undoheap_index_fetch_tuple(struct IndexFetchTableData *scan,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot,
+						   bool *call_again, bool *all_dead)
+{
+	IndexFetchUndoHeapData *uscan = (IndexFetchUndoHeapData *) scan;
+	Relation	rel = uscan->xs_base.rel;
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(tid);
+	Page		page;
+	HeapTuple	tuple;
+
+	*call_again = false;
+	if (all_dead)
+		*all_dead = false;
+
+	uscan->xs_cbuf = ReleaseAndReadBuffer(uscan->xs_cbuf, rel, blkno);
+	LockBuffer(uscan->xs_cbuf, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(uscan->xs_cbuf);
+
+	if (!UndoHeapPageIsData(page) || PageIsNew(page))
+	{
+		LockBuffer(uscan->xs_cbuf, BUFFER_LOCK_UNLOCK);
+		if (all_dead)
+			*all_dead = true;
+		return false;
+	}
+
+	if (all_dead &&
+		(offnum > PageGetMaxOffsetNumber(page) ||
+		 !ItemIdIsNormal(PageGetItemId(page, offnum))))
+		*all_dead = true;
+
+	tuple = undoheap_get_version(rel, uscan->xs_cbuf, offnum, snapshot);
+	if (tuple != NULL && IsMVCCSnapshot(snapshot))
+		PredicateLockTID(rel, tid, snapshot,
+						 HeapTupleHeaderGetRawXmin(tuple->t_data));
+
+	LockBuffer(uscan->xs_cbuf, BUFFER_LOCK_UNLOCK);
+
+	if (tuple == NULL)
+		return false;
+
+	pgstat_count_heap_fetch(rel);
+	ExecStoreHeapTuple(tuple, slot, true);
+	slot->tts_tableOid = RelationGetRelid(rel);
+	return true;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Callbacks for non-modifying operations on individual tuples for undo heap
+ * AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Copy the version of the tuple at 'tid' visible to 'snapshot' into a new
+ * HeapTuple, or return NULL.
+ */
+static HeapTuple
+undoheap_fetch(Relation rel, ItemPointer tid, Snapshot snapshot)
+{
+	Buffer		buffer;
+	Page		page;
+	HeapTuple	tuple = NULL;
+
+	if (ItemPointerGetBlockNumber(tid) >= RelationGetNumberOfBlocks(rel))
+		return NULL;
+
+	buffer = ReadBuffer(rel, ItemPointerGetBlockNumber(tid));
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (ItemPointerGetBlockNumber(tid) != UNDOHEAP_METAPAGE_BLKNO &&
+		UndoHeapPageIsData(page))
+		tuple = undoheap_get_version(rel, buffer,
+									 ItemPointerGetOffsetNumber(tid),
+									 snapshot);
+
+	UnlockReleaseBuffer(buffer);
+
+	return tuple;
+}
+
+static bool
+undoheap_fetch_row_version(Relation relation,
+						   ItemPointer tid,
+						   Snapshot snapshot,
+						   TupleTableSlot *slot)
+{
+	HeapTuple	tuple;
+
+	tuple = undoheap_fetch(relation, tid, snapshot);
+	if (tuple == NULL)
+		return false;
+
+	if (IsMVCCSnapshot(snapshot))
+		PredicateLockTID(relation, tid, snapshot,
+						 HeapTupleHeaderGetRawXmin(tuple->t_data));
+
+	pgstat_count_heap_fetch(relation);
+	ExecStoreHeapTuple(tuple, slot, true);
+	slot->tts_tableOid = RelationGetRelid(relation);
+	return true;
+}
+
+static bool
+undoheap_tuple_tid_valid(TableScanDesc sscan, ItemPointer tid)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	return ItemPointerIsValid(tid) &&
+		ItemPointerGetBlockNumber(tid) < scan->rs_nblocks;
+}
+
+/*
+ * Follow moves of the row at *tid to its latest version, as long as the
+ * moving transaction didn't abort.
+ */
+static void
+undoheap_get_latest_tid(TableScanDesc sscan, ItemPointer tid)
+{
+	Relation	rel = sscan->rs_rd;
+	ItemPointerData ctid = *tid;
+
+	for (;;)
+	{
+		Buffer		buffer;
+		Page		page;
+		ItemId		lp;
+		HeapTupleHeader htup;
+		ItemPointerData undoptr;
+		UndoRecord	rec = NULL;
+		Size		reclen;
+
+		if (ItemPointerGetBlockNumber(&ctid) >= RelationGetNumberOfBlocks(rel))
+			return;
+
+		buffer = ReadBuffer(rel, ItemPointerGetBlockNumber(&ctid));
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+
+		if (!UndoHeapPageIsData(page) || PageIsNew(page) ||
+			ItemPointerGetOffsetNumber(&ctid) > PageGetMaxOffsetNumber(page))
+		{
+			UnlockReleaseBuffer(buffer);
+			return;
+		}
+		lp = PageGetItemId(page, ItemPointerGetOffsetNumber(&ctid));
+		if (!ItemIdIsNormal(lp))
+		{
+			UnlockReleaseBuffer(buffer);
+			return;
+		}
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+
+		/* Visible versions of the row are the caller's answer */
+		*tid = ctid;
+
+		undoptr = htup->t_ctid;
+		if (UndoHeapTupleIsDeleted(htup) &&
+			(htup->t_infomask & UNDOHEAP_XMAX_MOVED) != 0 &&
+			ItemPointerIsValid(&undoptr) &&
+			!undoheap_xid_aborted(HeapTupleHeaderGetRawXmax(htup)))
+			rec = undoheap_read_undo(rel, &undoptr, &reclen);
+
+		UnlockReleaseBuffer(buffer);
+
+		if (rec == NULL || rec->ur_type != UNDO_MOVE)
+			return;
+		ctid = rec->ur_newtid;
+		pfree(rec);
+	}
+}
+
+/*
+ * Re-fetching is the only way to know, as older versions may be visible when
+ * the version in the slot isn't.
+ */
+static bool
+undoheap_tuple_satisfies_snapshot(Relation rel, TupleTableSlot *slot,
+								  Snapshot snapshot)
+{
+	HeapTuple	tuple;
+
+	tuple = undoheap_fetch(rel, &slot->tts_tid, snapshot);
+	if (tuple == NULL)
+		return false;
+
+	heap_freetuple(tuple);
+	return true;
+}
+
+/*
+ * Index entries are only deleted once the line pointer they point to is
+ * dead, and making it dead logged a conflict horizon of its own.
+ */
+static TransactionId
+undoheap_compute_xid_horizon_for_tuples(Relation rel,
+										ItemPointerData *tids,
+										int nitems)
+{
+	return InvalidTransactionId;
+}
+
+
+/* ----------------------------------------------------------------------------
+ *  Functions for manipulations of physical tuples for undo heap AM.
+ * ----------------------------------------------------------------------------
+ */
+
+static void
+undoheap_tuple_insert(Relation relation, TupleTableSlot *slot, CommandId cid,
+					  int options, BulkInsertState bistate)
+{
+	bool		shouldFree = true;
+	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+
+	slot->tts_tableOid = RelationGetRelid(relation);
+	tuple->t_tableOid = slot->tts_tableOid;
+
+	undoheap_insert(relation, tuple, cid, options);
+	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
+
+	if (shouldFree)
+		pfree(tuple);
+}
+
+/*
+ * Tuples aren't marked speculative: a waiter waits for the whole inserting
+ * transaction instead of the speculative token, which is correct, only
+ * slower in a conflict.
+ */
+static void
+undoheap_tuple_insert_speculative(Relation relation, TupleTableSlot *slot,
+								  CommandId cid, int options,
+								  BulkInsertState bistate, uint32 specToken)
+{
+	undoheap_tuple_insert(relation, slot, cid, options, bistate);
+}
+
+static void
+undoheap_tuple_complete_speculative(Relation relation, TupleTableSlot *slot,
+									uint32 specToken, bool succeeded)
+{
+	if (!succeeded)
+		undoheap_kill_tuple(relation, &slot->tts_tid);
+}
+
+static void
+undoheap_multi_insert(Relation relation, TupleTableSlot **slots, int ntuples,
+					  CommandId cid, int options, BulkInsertState bistate)
+{
+	int			i;
+
+	for (i = 0; i < ntuples; i++)
+		undoheap_tuple_insert(relation, slots[i], cid, options, bistate);
+}
+
+static TM_Result
+undoheap_tuple_delete(Relation relation, ItemPointer tid, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, bool changingPart)
+{
+	return undoheap_delete(relation, tid, cid, snapshot, crosscheck, wait,
+						   tmfd);
+}
+
+static TM_Result
+undoheap_tuple_update(Relation relation, ItemPointer otid,
+					  TupleTableSlot *slot, CommandId cid,
+					  Snapshot snapshot, Snapshot crosscheck, bool wait,
+					  TM_FailureData *tmfd, LockTupleMode *lockmode,
+					  TU_IndexUpdate *update_indexes)
+{
+	bool		shouldFree = true;
+	HeapTuple	tuple = ExecFetchSlotHeapTuple(slot, true, &shouldFree);
+	TM_Result	result;
+
+	slot->tts_tableOid = RelationGetRelid(relation);
+	tuple->t_tableOid = slot->tts_tableOid;
+
+	/* All row locks are exclusive */
+	*lockmode = LockTupleExclusive;
+
+	result = undoheap_update(relation, otid, tuple, cid, snapshot, crosscheck,
+							 wait, tmfd, &update_indexes->required);
+	update_indexes->modified_attrs = NULL;
+	ItemPointerCopy(&tuple->t_self, &slot->tts_tid);
+
+	if (shouldFree)
+		pfree(tuple);
+
+	return result;
+}
+
+static TM_Result
+undoheap_tuple_lock(Relation relation, ItemPointer tid, Snapshot snapshot,
+					TupleTableSlot *slot, CommandId cid, LockTupleMode mode,
+					LockWaitPolicy wait_policy, uint8 flags,
+					TM_FailureData *tmfd)
+{
+	HeapTuple	tuple;
+	TM_Result	result;
+
+	result = undoheap_lock_tuple(relation, tid, snapshot, cid, wait_policy,
+								 flags, &tuple, tmfd);
+
+	if (result == TM_Ok)
+	{
+		*tid = tuple->t_self;
+		ExecStoreHeapTuple(tuple, slot, true);
+		slot->tts_tableOid = RelationGetRelid(relation);
+	}
+
+	return result;
+}
+
+static void
+undoheap_finish_bulk_insert(Relation relation, int options)
+{
+	/* Every insert is WAL-logged, there's nothing to sync */
+}
+
+
+/* ------------------------------------------------------------------------
+ * DDL related callbacks for undo heap AM.
+ * ------------------------------------------------------------------------
+ */
+
+static void
+undoheap_relation_set_new_filenode(Relation rel,
+								   const RelFileNode *newrnode,
+								   char persistence,
+								   TransactionId *freezeXid,
+								   MultiXactId *minmulti)
+{
+	SMgrRelation srel;
+
+	/* See heapam_relation_set_new_filenode */
+	*freezeXid = RecentXmin;
+	*minmulti = GetOldestMultiXactId();
+
+	srel = RelationCreateStorage(*newrnode, persistence);
+
+	/* The metapage is created by the first insert */
+	if (persistence == RELPERSISTENCE_UNLOGGED)
+	{
+		Assert(rel->rd_rel->relkind == RELKIND_RELATION ||
+			   rel->rd_rel->relkind == RELKIND_MATVIEW);
+		smgrcreate(srel, INIT_FORKNUM, false);
+		log_smgrcreate(newrnode, INIT_FORKNUM, 0);
+		smgrimmedsync(srel, INIT_FORKNUM);
+	}
+
+	smgrclose(srel);
+}
+
+static void
+undoheap_relation_nontransactional_truncate(Relation rel)
+{
+	RelationTruncate(rel, 0);
+}
+
+static void
+undoheap_relation_copy_data(Relation rel, const RelFileNode *newrnode)
+{
+	SMgrRelation dstrel;
+
+	dstrel = smgropen(*newrnode, rel->rd_backend);
+	RelationOpenSmgr(rel);
+
+	/*
+	 * As in heapam_relation_copy_data, flush the source's pages out of shared
+	 * buffers, then copy the files.
+	 */
+	FlushRelationBuffers(rel);
+
+	RelationCreateStorage(*newrnode, rel->rd_rel->relpersistence);
+
+	RelationCopyStorage(rel->rd_smgr, dstrel, MAIN_FORKNUM,
+						rel->rd_rel->relpersistence);
+
+	for (ForkNumber forkNum = MAIN_FORKNUM + 1;
+		 forkNum <= MAX_FORKNUM; forkNum++)
+	{
+		if (smgrexists(rel->rd_smgr, forkNum))
+		{
+			smgrcreate(dstrel, forkNum, false);
+
+			if (rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT ||
+				(rel->rd_rel->relpersistence == RELPERSISTENCE_UNLOGGED &&
+				 forkNum == INIT_FORKNUM))
+				log_smgrcreate(newrnode, forkNum, 0);
+			RelationCopyStorage(rel->rd_smgr, dstrel, forkNum,
+								rel->rd_rel->relpersistence);
+		}
+	}
+
+	RelationDropStorage(rel);
+	smgrclose(dstrel);
+}
+
+/*
+ * Form a tuple for the new table of CLUSTER from a version of the old one,
+ * keeping its transaction fields, and insert it.
+ */
+static void
+undoheap_reform_and_insert(HeapTuple tuple, Relation OldTable,
+						   Relation NewTable, Datum *values, bool *isnull)
+{
+	TupleDesc	oldTupDesc = RelationGetDescr(OldTable);
+	TupleDesc	newTupDesc = RelationGetDescr(NewTable);
+	HeapTuple	copiedTuple;
+	int			i;
+
+	heap_deform_tuple(tuple, oldTupDesc, values, isnull);
+
+	/* Be sure to null out any dropped columns */
+	for (i = 0; i < newTupDesc->natts; i++)
+	{
+		if (TupleDescAttr(newTupDesc, i)->attisdropped)
+			isnull[i] = true;
+	}
+
+	copiedTuple = heap_form_tuple(newTupDesc, values, isnull);
+
+	copiedTuple->t_data->t_choice = tuple->t_data->t_choice;
+	copiedTuple->t_data->t_infomask &= ~HEAP_XACT_MASK;
+	copiedTuple->t_data->t_infomask |=
+		tuple->t_data->t_infomask & HEAP_XACT_MASK;
+	ItemPointerSetInvalid(&copiedTuple->t_data->t_ctid);
+
+	undoheap_insert_raw(NewTable, copiedTuple);
+
+	heap_freetuple(copiedTuple);
+}
+
+/*
+ * CLUSTER and VACUUM FULL copy the newest version of each row that isn't
+ * dead to everyone, without undo.  A deletion that isn't visible to everyone
+ * yet is kept, and running transactions that can't see it still see the row,
+ * but they can't see older contents of an updated row anymore.  Both commands
+ * take an AccessExclusiveLock, so no transaction that could have looked at
+ * the table is still running except ones that started before and haven't
+ * touched it; those with repeatable read snapshots can get the wrong version
+ * of updated rows, as noted in the documentation.
+ */
+static void
+undoheap_relation_copy_for_cluster(Relation OldTable, Relation NewTable,
+								   Relation OldIndex, bool use_sort,
+								   TransactionId OldestXmin,
+								   TransactionId *xid_cutoff,
+								   MultiXactId *multi_cutoff,
+								   double *num_tuples,
+								   double *tups_vacuumed,
+								   double *tups_recently_dead)
+{
+	TupleDesc	oldTupDesc = RelationGetDescr(OldTable);
+	Tuplesortstate *tuplesort;
+	TableScanDesc tableScan = NULL;
+	IndexScanDesc indexScan = NULL;
+	TupleTableSlot *slot;
+	SnapshotData NonVacuumableSnapshot;
+	Datum	   *values;
+	bool	   *isnull;
+
+	values = (Datum *) palloc(oldTupDesc->natts * sizeof(Datum));
+	isnull = (bool *) palloc(oldTupDesc->natts * sizeof(bool));
+
+	if (use_sort)
+		tuplesort = tuplesort_begin_cluster(oldTupDesc, OldIndex,
+											maintenance_work_mem,
+											NULL, false);
+	else
+		tuplesort = NULL;
+
+	InitNonVacuumableSnapshot(NonVacuumableSnapshot,
+							  GlobalVisTestFor(OldTable));
+
+	/*
+	 * Both kinds of scans just give us the TIDs in the right order, with
+	 * SnapshotAny; the version to copy is determined below.
+	 */
+	slot = table_slot_create(OldTable, NULL);
+	if (OldIndex != NULL && !use_sort)
+	{
+		const int	ci_index[] = {
+			PROGRESS_CLUSTER_PHASE,
+			PROGRESS_CLUSTER_INDEX_RELID
+		};
+		int64		ci_val[2];
+
+		ci_val[0] = PROGRESS_CLUSTER_PHASE_INDEX_SCAN_HEAP;
+		ci_val[1] = RelationGetRelid(OldIndex);
+		pgstat_progress_update_multi_param(2, ci_index, ci_val);
+
+		indexScan = index_beginscan(OldTable, OldIndex, SnapshotAny, 0, 0);
+		index_rescan(indexScan, NULL, 0, NULL, 0);
+	}
+	else
+	{
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_SEQ_SCAN_HEAP);
+
+		tableScan = table_beginscan(OldTable, SnapshotAny, 0, (ScanKey) NULL);
+		pgstat_progress_update_param(PROGRESS_CLUSTER_TOTAL_HEAP_BLKS,
+									 ((UndoHeapScanDesc) tableScan)->rs_nblocks);
+	}
+
+	for (;;)
+	{
+		ItemPointerData tid;
+		Buffer		buffer;
+		Page		page;
+		ItemId		lp;
+		HeapTupleHeader htup;
+		HeapTuple	tuple;
+		bool		recently_dead = false;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (indexScan != NULL)
+		{
+			if (!index_getnext_slot(indexScan, ForwardScanDirection, slot))
+				break;
+
+			/* Since we used no scan keys, should never need to recheck */
+			if (indexScan->xs_recheck)
+				elog(ERROR, "CLUSTER does not support lossy index conditions");
+		}
+		else
+		{
+			if (!table_scan_getnextslot(tableScan, ForwardScanDirection, slot))
+				break;
+
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_BLKS_SCANNED,
+										 ((UndoHeapScanDesc) tableScan)->rs_cblock + 1);
+		}
+		tid = slot->tts_tid;
+
+		buffer = ReadBuffer(OldTable, ItemPointerGetBlockNumber(&tid));
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+		lp = PageGetItemId(page, ItemPointerGetOffsetNumber(&tid));
+		htup = (HeapTupleHeader) PageGetItem(page, lp);
+
+		tuple = undoheap_get_version(OldTable, buffer,
+									 ItemPointerGetOffsetNumber(&tid),
+									 &NonVacuumableSnapshot);
+
+		/*
+		 * That's the version before a deletion that isn't visible to
+		 * everyone yet; keep the deletion.
+		 */
+		if (tuple != NULL && UndoHeapTupleIsDeleted(htup) &&
+			!undoheap_xid_aborted(HeapTupleHeaderGetRawXmax(htup)))
+		{
+			HeapTupleHeaderSetXmax(tuple->t_data,
+								   HeapTupleHeaderGetRawXmax(htup));
+			HeapTupleHeaderSetCmax(tuple->t_data,
+								   HeapTupleHeaderGetRawCommandId(htup), false);
+			tuple->t_data->t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+			recently_dead = true;
+		}
+
+		UnlockReleaseBuffer(buffer);
+
+		if (tuple == NULL)
+		{
+			*tups_vacuumed += 1;
+			continue;
+		}
+
+		if (recently_dead)
+			*tups_recently_dead += 1;
+		else
+		{
+			/* Row locks don't survive the rewrite */
+			HeapTupleHeaderSetXmax(tuple->t_data, InvalidTransactionId);
+			tuple->t_data->t_infomask &= ~(HEAP_XMAX_BITS | UNDOHEAP_XMAX_MOVED);
+		}
+
+		if (TransactionIdIsNormal(HeapTupleHeaderGetRawXmin(tuple->t_data)) &&
+			TransactionIdPrecedes(HeapTupleHeaderGetRawXmin(tuple->t_data),
+								  *xid_cutoff))
+			HeapTupleHeaderSetXmin(tuple->t_data, FrozenTransactionId);
+
+		*num_tuples += 1;
+		if (tuplesort != NULL)
+		{
+			tuplesort_putheaptuple(tuplesort, tuple);
+
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+										 *num_tuples);
+		}
+		else
+		{
+			const int	ct_index[] = {
+				PROGRESS_CLUSTER_HEAP_TUPLES_SCANNED,
+				PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN
+			};
+			int64		ct_val[2];
+
+			undoheap_reform_and_insert(tuple, OldTable, NewTable,
+									   values, isnull);
+
+			ct_val[0] = *num_tuples;
+			ct_val[1] = *num_tuples;
+			pgstat_progress_update_multi_param(2, ct_index, ct_val);
+		}
+
+		heap_freetuple(tuple);
+	}
+
+	if (indexScan != NULL)
+		index_endscan(indexScan);
+	if (tableScan != NULL)
+		table_endscan(tableScan);
+	ExecDropSingleTupleTableSlot(slot);
+
+	if (tuplesort != NULL)
+	{
+		double		n_tuples = 0;
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_SORT_TUPLES);
+
+		tuplesort_performsort(tuplesort);
+
+		pgstat_progress_update_param(PROGRESS_CLUSTER_PHASE,
+									 PROGRESS_CLUSTER_PHASE_WRITE_NEW_HEAP);
+
+		for (;;)
+		{
+			HeapTuple	tuple;
+
+			CHECK_FOR_INTERRUPTS();
+
+			tuple = tuplesort_getheaptuple(tuplesort, true);
+			if (tuple == NULL)
+				break;
+
+			n_tuples += 1;
+			undoheap_reform_and_insert(tuple, OldTable, NewTable,
+									   values, isnull);
+
+			pgstat_progress_update_param(PROGRESS_CLUSTER_HEAP_TUPLES_WRITTEN,
+										 n_tuples);
+		}
+
+		tuplesort_end(tuplesort);
+	}
+
+	pfree(values);
+	pfree(isnull);
+}
+
+static bool
+undoheap_scan_analyze_next_block(TableScanDesc sscan, BlockNumber blockno,
+								 BufferAccessStrategy bstrategy)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	/* Rows being inserted or deleted count as they are now, like in heap */
+	scan->rs_strategy = bstrategy;
+	undoheap_scan_page(scan, blockno, SnapshotSelf);
+	scan->rs_strategy = NULL;
+	scan->rs_cindex = -1;
+
+	return true;
+}
+
+static bool
+undoheap_scan_analyze_next_tuple(TableScanDesc sscan,
+								 TransactionId OldestXmin,
+								 double *liverows, double *deadrows,
+								 TupleTableSlot *slot)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	if (++scan->rs_cindex < scan->rs_ntuples)
+	{
+		ExecStoreHeapTuple(scan->rs_tuples[scan->rs_cindex], slot, false);
+		*liverows += 1;
+		return true;
+	}
+
+	*deadrows += scan->rs_ndead;
+	scan->rs_ndead = 0;
+	ExecClearTuple(slot);
+	return false;
+}
+
+/*
+ * Index builds that aren't concurrent index the version of each tuple that is
+ * not dead to everyone, and count tuples that are being deleted as not alive.
+ * Unlike heap, there's only one version per TID to index; if a running
+ * transaction may still see an older version with different column values,
+ * the index is marked as not usable by transactions as old as that, the same
+ * way heap does it for broken HOT chains.
+ */
+static double
+undoheap_index_build_range_scan(Relation tableRelation,
+								Relation indexRelation,
+								IndexInfo *indexInfo,
+								bool allow_sync,
+								bool anyvisible,
+								bool progress,
+								BlockNumber start_blockno,
+								BlockNumber numblocks,
+								IndexBuildCallback callback,
+								void *callback_state,
+								TableScanDesc scan)
+{
+	UndoHeapScanDesc uscan;
+	HeapTuple	tuple;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	double		reltuples;
+	ExprState  *predicate;
+	TupleTableSlot *slot;
+	EState	   *estate;
+	ExprContext *econtext;
+	Snapshot	snapshot;
+	SnapshotData NonVacuumableSnapshot;
+	bool		need_unregister_snapshot = false;
+	BlockNumber previous_blkno = InvalidBlockNumber;
+
+	/*
+	 * sanity checks
+	 */
+	Assert(OidIsValid(indexRelation->rd_rel->relam));
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = table_slot_create(tableRelation, NULL);
+
+	/* Arrange for econtext's scan tuple to be the tuple under test */
+	econtext->ecxt_scantuple = slot;
+
+	/* Set up execution state for predicate, if any. */
+	predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+	InitNonVacuumableSnapshot(NonVacuumableSnapshot,
+							  GlobalVisTestFor(tableRelation));
+
+	if (!scan)
+	{
+		/*
+		 * A concurrent build indexes what an MVCC snapshot sees, the
+		 * validation scan adds the rest.
+		 */
+		if (indexInfo->ii_Concurrent)
+		{
+			snapshot = RegisterSnapshot(GetTransactionSnapshot());
+			need_unregister_snapshot = true;
+		}
+		else
+			snapshot = &NonVacuumableSnapshot;
+
+		scan = table_beginscan_strat(tableRelation, /* relation */
+									 snapshot,	/* snapshot */
+									 0, /* number of keys */
+									 NULL,	/* scan key */
+									 true,	/* buffer access strategy OK */
+									 allow_sync);	/* syncscan OK? */
+	}
+	else
+	{
+		/*
+		 * Parallel index build.  The leader sets up parallel scans with
+		 * SnapshotAny when it would have used SnapshotNonVacuumable itself.
+		 */
+		Assert(!IsBootstrapProcessingMode());
+		Assert(allow_sync);
+		if (scan->rs_snapshot->snapshot_type == SNAPSHOT_ANY)
+			scan->rs_snapshot = &NonVacuumableSnapshot;
+		snapshot = scan->rs_snapshot;
+	}
+
+	uscan = (UndoHeapScanDesc) scan;
+
+	/* Publish number of blocks to scan */
+	if (progress)
+	{
+		BlockNumber nblocks;
+
+		if (uscan->rs_base.rs_parallel != NULL)
+		{
+			ParallelBlockTableScanDesc pbscan;
+
+			pbscan = (ParallelBlockTableScanDesc) uscan->rs_base.rs_parallel;
+			nblocks = pbscan->phs_nblocks;
+		}
+		else
+			nblocks = uscan->rs_nblocks;
+
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+									 nblocks);
+	}
+
+	/* set our scan endpoints */
+	if (!allow_sync)
+		undoheap_setscanlimits(uscan, start_blockno, numblocks);
+	else
+	{
+		/* syncscan can only be requested on whole relation */
+		Assert(start_blockno == 0);
+		Assert(numblocks == InvalidBlockNumber);
+	}
+
+	reltuples = 0;
+
+	/*
+	 * Scan all tuples in the base relation.
+	 */
+	while ((tuple = undoheap_getnext(uscan, ForwardScanDirection)) != NULL)
+	{
+		/* Report scan progress, if asked to. */
+		if (progress)
+		{
+			BlockNumber blocks_done = undoheap_scan_get_blocks_done(uscan);
+
+			if (blocks_done != previous_blkno)
+			{
+				pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+											 blocks_done);
+				previous_blkno = blocks_done;
+			}
+		}
+
+		reltuples += 1;
+
+		MemoryContextReset(econtext->ecxt_per_tuple_memory);
+
+		/* Set up for predicate or expression evaluation */
+		ExecStoreHeapTuple(tuple, slot, false);
+
+		/*
+		 * In a partial index, discard tuples that don't satisfy the
+		 * predicate.
+		 */
+		if (predicate != NULL)
+		{
+			if (!ExecQual(predicate, econtext))
+				continue;
+		}
+
+		/*
+		 * For the current heap tuple, extract all the attributes we use in
+		 * this index, and note which are null.  This also performs evaluation
+		 * of any expressions needed.
+		 */
+		FormIndexDatum(indexInfo,
+					   slot,
+					   estate,
+					   values,
+					   isnull);
+
+		/* Call the AM's callback routine to process the tuple */
+		callback(indexRelation, &tuple->t_self, values, isnull,
+				 uscan->rs_alive[uscan->rs_cindex], callback_state);
+	}
+
+	/* Report scan progress one last time. */
+	if (progress)
+	{
+		BlockNumber blks_done;
+
+		if (uscan->rs_base.rs_parallel != NULL)
+		{
+			ParallelBlockTableScanDesc pbscan;
+
+			pbscan = (ParallelBlockTableScanDesc) uscan->rs_base.rs_parallel;
+			blks_done = pbscan->phs_nblocks;
+		}
+		else
+			blks_done = uscan->rs_nblocks;
+
+		pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+									 blks_done);
+	}
+
+	if (uscan->rs_recently_updated)
+		indexInfo->ii_BrokenHotChain = true;
+
+	table_endscan(scan);
+
+	/* we can now forget our snapshot, if set and registered by us */
+	if (need_unregister_snapshot)
+		UnregisterSnapshot(snapshot);
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	FreeExecutorState(estate);
+
+	/* These may have been pointing to the now-gone estate */
+	indexInfo->ii_ExpressionsState = NIL;
+	indexInfo->ii_PredicateState = NULL;
+
+	return reltuples;
+}
+
+/*
+ * Like heapam_index_validate_scan, without the complication of heap-only
+ * tuples: each tuple is indexed under its own TID.
+ */
+static void
+undoheap_index_validate_scan(Relation tableRelation,
+							 Relation indexRelation,
+							 IndexInfo *indexInfo,
+							 Snapshot snapshot,
+							 ValidateIndexState *state)
+{
+	TableScanDesc scan;
+	UndoHeapScanDesc uscan;
+	HeapTuple	tuple;
+	Datum		values[INDEX_MAX_KEYS];
+	bool		isnull[INDEX_MAX_KEYS];
+	ExprState  *predicate;
+	TupleTableSlot *slot;
+	EState	   *estate;
+	ExprContext *econtext;
+	BlockNumber previous_blkno = InvalidBlockNumber;
+
+	/* state variables for the merge */
+	ItemPointer indexcursor = NULL;
+	ItemPointerData decoded;
+	bool		tuplesort_empty = false;
+
+	/*
+	 * sanity checks
+	 */
+	Assert(OidIsValid(indexRelation->rd_rel->relam));
+
+	/*
+	 * Need an EState for evaluation of index expressions and partial-index
+	 * predicates.  Also a slot to hold the current tuple.
+	 */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(tableRelation),
+									&TTSOpsHeapTuple);
+
+	/* Arrange for econtext's scan tuple to be the tuple under test */
+	econtext->ecxt_scantuple = slot;
+
+	/* Set up execution state for predicate, if any. */
+	predicate = ExecPrepareQual(indexInfo->ii_Predicate, estate);
+
+	/*
+	 * Prepare for scan of the base relation.  We need just those tuples
+	 * satisfying the passed-in reference snapshot, from block zero forward
+	 * to match the sorted TIDs.
+	 */
+	scan = table_beginscan_strat(tableRelation, /* relation */
+								 snapshot,	/* snapshot */
+								 0, /* number of keys */
+								 NULL,	/* scan key */
+								 true,	/* buffer access strategy OK */
+								 false);	/* syncscan not OK */
+	uscan = (UndoHeapScanDesc) scan;
+
+	pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_TOTAL,
+								 uscan->rs_nblocks);
+
+	/*
+	 * Scan all tuples matching the snapshot.
+	 */
+	while ((tuple = undoheap_getnext(uscan, ForwardScanDirection)) != NULL)
+	{
+		ItemPointer heapcursor = &tuple->t_self;
+
+		CHECK_FOR_INTERRUPTS();
+
+		state->htups += 1;
+
+		if ((previous_blkno == InvalidBlockNumber) ||
+			(uscan->rs_cblock != previous_blkno))
+		{
+			pgstat_progress_update_param(PROGRESS_SCAN_BLOCKS_DONE,
+										 uscan->rs_cblock);
+			previous_blkno = uscan->rs_cblock;
+		}
+
+		/*
+		 * "merge" by skipping through the index tuples until we find or pass
+		 * the current tuple.
+		 */
+		while (!tuplesort_empty &&
+			   (!indexcursor ||
+				ItemPointerCompare(indexcursor, heapcursor) < 0))
+		{
+			Datum		ts_val;
+			bool		ts_isnull;
+
+			tuplesort_empty = !tuplesort_getdatum(state->tuplesort, true,
+												  &ts_val, &ts_isnull, NULL);
+			Assert(tuplesort_empty || !ts_isnull);
+			if (!tuplesort_empty)
+			{
+				itemptr_decode(&decoded, DatumGetInt64(ts_val));
+				indexcursor = &decoded;
+
+				/* If int8 is pass-by-ref, free (encoded) TID Datum memory */
+#ifndef USE_FLOAT8_BYVAL
+				pfree(DatumGetPointer(ts_val));
+#endif
+			}
+			else
+			{
+				/* Be tidy */
+				indexcursor = NULL;
+			}
+		}
+
+		/*
+		 * If the tuplesort has overshot, then this tuple is missing from the
+		 * index, so insert it.
+		 */
+		if (tuplesort_empty ||
+			ItemPointerCompare(indexcursor, heapcursor) > 0)
+		{
+			MemoryContextReset(econtext->ecxt_per_tuple_memory);
+
+			/* Set up for predicate or expression evaluation */
+			ExecStoreHeapTuple(tuple, slot, false);
+
+			/*
+			 * In a partial index, discard tuples that don't satisfy the
+			 * predicate.
+			 */
+			if (predicate != NULL)
+			{
+				if (!ExecQual(predicate, econtext))
+					continue;
+			}
+
+			FormIndexDatum(indexInfo,
+						   slot,
+						   estate,
+						   values,
+						   isnull);
+
+			index_insert(indexRelation,
+						 values,
+						 isnull,
+						 heapcursor,
+						 tableRelation,
+						 indexInfo->ii_Unique ?
+						 UNIQUE_CHECK_YES : UNIQUE_CHECK_NO,
+						 indexInfo);
+
+			state->tups_inserted += 1;
+		}
+	}
+
+	table_endscan(scan);
+
+	ExecDropSingleTupleTableSlot(slot);
+
+	FreeExecutorState(estate);
+
+	/* These may have been pointing to the now-gone estate */
+	indexInfo->ii_ExpressionsState = NIL;
+	indexInfo->ii_PredicateState = NULL;
+}
+
+/*
+ * Return the number of blocks that have been read by this scan since
+ * starting, for progress reporting; see heapam_scan_get_blocks_done.
+ */
+static BlockNumber
+undoheap_scan_get_blocks_done(UndoHeapScanDesc scan)
+{
+	ParallelBlockTableScanDesc bpscan = NULL;
+	BlockNumber startblock;
+	BlockNumber blocks_done;
+
+	if (scan->rs_base.rs_parallel != NULL)
+	{
+		bpscan = (ParallelBlockTableScanDesc) scan->rs_base.rs_parallel;
+		startblock = bpscan->phs_startblock;
+	}
+	else
+		startblock = scan->rs_startblock;
+
+	if (scan->rs_cblock > startblock)
+		blocks_done = scan->rs_cblock - startblock;
+	else
+	{
+		BlockNumber nblocks;
+
+		nblocks = bpscan != NULL ? bpscan->phs_nblocks : scan->rs_nblocks;
+		blocks_done = nblocks - startblock + scan->rs_cblock;
+	}
+
+	return blocks_done;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Miscellaneous callbacks for the undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * Large values are stored in a regular heap toast table, see
+ * heapam_relation_needs_toast_table.
+ */
+static bool
+undoheap_relation_needs_toast_table(Relation rel)
+{
+	int32		data_length = 0;
+	bool		maxlength_unknown = false;
+	bool		has_toastable_attrs = false;
+	TupleDesc	tupdesc = rel->rd_att;
+	int32		tuple_length;
+	int			i;
+
+	for (i = 0; i < tupdesc->natts; i++)
+	{
+		Form_pg_attribute att = TupleDescAttr(tupdesc, i);
+
+		if (att->attisdropped)
+			continue;
+		data_length = att_align_nominal(data_length, att->attalign);
+		if (att->attlen > 0)
+		{
+			/* Fixed-length types are never toastable */
+			data_length += att->attlen;
+		}
+		else
+		{
+			int32		maxlen = type_maximum_size(att->atttypid,
+												   att->atttypmod);
+
+			if (maxlen < 0)
+				maxlength_unknown = true;
+			else
+				data_length += maxlen;
+			if (att->attstorage != TYPSTORAGE_PLAIN)
+				has_toastable_attrs = true;
+		}
+	}
+	if (!has_toastable_attrs)
+		return false;			/* nothing to toast? */
+	if (maxlength_unknown)
+		return true;			/* any unlimited-length attrs? */
+	tuple_length = MAXALIGN(SizeofHeapTupleHeader +
+							BITMAPLEN(tupdesc->natts)) +
+		MAXALIGN(data_length);
+	return (tuple_length > TOAST_TUPLE_THRESHOLD);
+}
+
+static Oid
+undoheap_relation_toast_am(Relation rel)
+{
+	return HEAP_TABLE_AM_OID;
+}
+
+
+/* ------------------------------------------------------------------------
+ * Planner related callbacks for the undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+/*
+ * The block count includes undo pages, so this overestimates the number of
+ * tuples of a table with a long undo log until ANALYZE sets reltuples.
+ */
+static void
+undoheap_estimate_rel_size(Relation rel, int32 *attr_widths,
+						   BlockNumber *pages, double *tuples,
+						   double *allvisfrac)
+{
+	table_block_relation_estimate_size(rel, attr_widths, pages,
+									   tuples, allvisfrac,
+									   UNDOHEAP_OVERHEAD_BYTES_PER_TUPLE,
+									   UNDOHEAP_USABLE_BYTES_PER_PAGE);
+}
+
+
+/* ------------------------------------------------------------------------
+ * Executor related callbacks for the undo heap AM
+ * ------------------------------------------------------------------------
+ */
+
+static bool
+undoheap_scan_bitmap_next_block(TableScanDesc sscan,
+								TBMIterateResult *tbmres)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+	Snapshot	snapshot = sscan->rs_snapshot;
+	int			ntup = 0;
+	int			i;
+
+	scan->rs_cindex = 0;
+	scan->rs_ntuples = 0;
+
+	/*
+	 * Ignore any claimed entries past what we think is the end of the
+	 * relation.  It may have been extended after the start of our scan (we
+	 * only hold an AccessShareLock, and it could be inserts from this
+	 * backend).
+	 */
+	if (tbmres->blockno >= scan->rs_nblocks)
+		return false;
+
+	undoheap_scan_page(scan, tbmres->blockno, snapshot);
+
+	/* With an exact bitmap, keep only the tuples it lists */
+	if (tbmres->ntuples >= 0)
+	{
+		int			curslot = 0;
+
+		for (i = 0; i < scan->rs_ntuples; i++)
+		{
+			OffsetNumber offnum = ItemPointerGetOffsetNumber(&scan->rs_tuples[i]->t_self);
+
+			while (curslot < tbmres->ntuples &&
+				   tbmres->offsets[curslot] < offnum)
+				curslot++;
+			if (curslot < tbmres->ntuples && tbmres->offsets[curslot] == offnum)
+				scan->rs_tuples[ntup++] = scan->rs_tuples[i];
+		}
+		scan->rs_ntuples = ntup;
+	}
+
+	for (i = 0; i < scan->rs_ntuples; i++)
+	{
+		HeapTuple	tuple = scan->rs_tuples[i];
+
+		PredicateLockTID(sscan->rs_rd, &tuple->t_self, snapshot,
+						 HeapTupleHeaderGetRawXmin(tuple->t_data));
+	}
+
+	return scan->rs_ntuples > 0;
+}
+
+static bool
+undoheap_scan_bitmap_next_tuple(TableScanDesc sscan,
+								TBMIterateResult *tbmres,
+								TupleTableSlot *slot)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+
+	/*
+	 * Out of range?  If so, nothing more to look at on this page
+	 */
+	if (scan->rs_cindex < 0 || scan->rs_cindex >= scan->rs_ntuples)
+		return false;
+
+	pgstat_count_heap_fetch(sscan->rs_rd);
+	ExecStoreHeapTuple(scan->rs_tuples[scan->rs_cindex], slot, false);
+	scan->rs_cindex++;
+
+	return true;
+}
+
+static bool
+undoheap_scan_sample_next_block(TableScanDesc sscan,
+								SampleScanState *scanstate)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+	TsmRoutine *tsm = scanstate->tsmroutine;
+	BlockNumber blockno;
+
+	/* return false immediately if relation is empty */
+	if (scan->rs_nblocks == 0)
+		return false;
+
+	if (tsm->NextSampleBlock)
+		blockno = tsm->NextSampleBlock(scanstate, scan->rs_nblocks);
+	else if (!scan->rs_inited)
+		blockno = 0;
+	else if (scan->rs_cblock + 1 >= scan->rs_nblocks)
+		blockno = InvalidBlockNumber;
+	else
+		blockno = scan->rs_cblock + 1;
+
+	if (!BlockNumberIsValid(blockno))
+	{
+		MemoryContextReset(scan->rs_pagecxt);
+		scan->rs_inited = false;
+		scan->rs_cblock = InvalidBlockNumber;
+		scan->rs_ntuples = 0;
+		return false;
+	}
+
+	scan->rs_inited = true;
+	undoheap_scan_page(scan, blockno, sscan->rs_snapshot);
+	scan->rs_cindex = 0;
+
+	return true;
+}
+
+static bool
+undoheap_scan_sample_next_tuple(TableScanDesc sscan,
+								SampleScanState *scanstate,
+								TupleTableSlot *slot)
+{
+	UndoHeapScanDesc scan = (UndoHeapScanDesc) sscan;
+	TsmRoutine *tsm = scanstate->tsmroutine;
+
+	for (;;)
+	{
+		OffsetNumber tupoffset;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* Ask the tablesample method which tuples to check on this page. */
+		tupoffset = tsm->NextSampleTuple(scanstate, scan->rs_cblock,
+										 scan->rs_maxoff);
+		if (!OffsetNumberIsValid(tupoffset))
+		{
+			ExecClearTuple(slot);
+			return false;
+		}
+
+		/* The tuples are in offset order, and so are the offsets asked for */
+		while (scan->rs_cindex < scan->rs_ntuples &&
+			   ItemPointerGetOffsetNumber(&scan->rs_tuples[scan->rs_cindex]->t_self) < tupoffset)
+			scan->rs_cindex++;
+
+		if (scan->rs_cindex < scan->rs_ntuples &&
+			ItemPointerGetOffsetNumber(&scan->rs_tuples[scan->rs_cindex]->t_self) == tupoffset)
+		{
+			ExecStoreHeapTuple(scan->rs_tuples[scan->rs_cindex], slot, false);
+			pgstat_count_heap_getnext(sscan->rs_rd);
+			return true;
+		}
+	}
+}
+
+
+/* ------------------------------------------------------------------------
+ * Definition of the undo heap table access method.
+ * ------------------------------------------------------------------------
+ */
+
+static const TableAmRoutine undoheap_methods = {
+	.type = T_TableAmRoutine,
+
+	.slot_callbacks = undoheap_slot_callbacks,
+
+	.scan_begin = undoheap_beginscan,
+	.scan_end = undoheap_endscan,
+	.scan_rescan = undoheap_rescan,
+	.scan_getnextslot = undoheap_getnextslot,
+
+	.parallelscan_estimate = table_block_parallelscan_estimate,
+	.parallelscan_initialize = table_block_parallelscan_initialize,
+	.parallelscan_reinitialize = table_block_parallelscan_reinitialize,
+
+	.index_fetch_begin = undoheap_index_fetch_begin,
+	.index_fetch_reset = undoheap_index_fetch_reset,
+	.index_fetch_end = undoheap_index_fetch_end,
+	.index_fetch_tuple = undoheap_index_fetch_tuple,
+
+	.tuple_insert = undoheap_tuple_insert,
+	.tuple_insert_speculative = undoheap_tuple_insert_speculative,
+	.tuple_complete_speculative = undoheap_tuple_complete_speculative,
+	.multi_insert = undoheap_multi_insert,
+	.tuple_delete = undoheap_tuple_delete,
+	.tuple_update = undoheap_tuple_update,
+	.tuple_lock = undoheap_tuple_lock,
+	.finish_bulk_insert = undoheap_finish_bulk_insert,
+
+	.tuple_fetch_row_version = undoheap_fetch_row_version,
+	.tuple_get_latest_tid = undoheap_get_latest_tid,
+	.tuple_tid_valid = undoheap_tuple_tid_valid,
+	.tuple_satisfies_snapshot = undoheap_tuple_satisfies_snapshot,
+	.compute_xid_horizon_for_tuples = undoheap_compute_xid_horizon_for_tuples,
+
+	.relation_set_new_filenode = undoheap_relation_set_new_filenode,
+	.relation_nontransactional_truncate = undoheap_relation_nontransactional_truncate,
+	.relation_copy_data = undoheap_relation_copy_data,
+	.relation_copy_for_cluster = undoheap_relation_copy_for_cluster,
+	.relation_vacuum = undoheap_vacuum_rel,
+	.scan_analyze_next_block = undoheap_scan_analyze_next_block,
+	.scan_analyze_next_tuple = undoheap_scan_analyze_next_tuple,
+	.index_build_range_scan = undoheap_index_build_range_scan,
+	.index_validate_scan = undoheap_index_validate_scan,
+
+	.relation_size = table_block_relation_size,
+	.relation_needs_toast_table = undoheap_relation_needs_toast_table,
+	.relation_toast_am = undoheap_relation_toast_am,
+
+	.relation_estimate_size = undoheap_estimate_rel_size,
+
+	.scan_bitmap_next_block = undoheap_scan_bitmap_next_block,
+	.scan_bitmap_next_tuple = undoheap_scan_bitmap_next_tuple,
+	.scan_sample_next_block = undoheap_scan_sample_next_block,
+	.scan_sample_next_tuple = undoheap_scan_sample_next_tuple
+};
+
+Datum
+undoheap_tableam_handler(PG_FUNCTION_ARGS)
+{
+	PG_RETURN_POINTER(&undoheap_methods);
+}
@@ -0,0 +1,706 @@
+/*-------------------------------------------------------------------------
+ *
+ * undolog.c
+ *	  Page management and undo log of the undo heap table access method.
+ *
+ * The undo log is a singly linked list of undo pages, from the head (oldest)
+ * to the tail, which new records are added to.  Discarding the head page
+ * puts it on the free list, from which it can be reused as either a data or
+ * an undo page.  Both lists start at the metapage.
+ *
+ * Adding a page to the tail of the undo log, and moving a page between the
+ * lists, happen while holding the metapage exclusively locked.  Only one
+ * backend discards at a time, which is arbitrated by a heavyweight lock on
+ * the metapage's block number.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/undoheap/undolog.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/transam.h"
+#include "access/undoheap.h"
+#include "access/undoheap_xlog.h"
+#include "access/xact.h"
+#include "access/xloginsert.h"
+#include "miscadmin.h"
+#include "storage/lmgr.h"
+#include "storage/procarray.h"
+#include "utils/rel.h"
+#include "utils/snapmgr.h"
+
+static Buffer undoheap_extend(Relation rel);
+static Buffer undoheap_pop_free_page(Relation rel, UndoHeapMetaPageData *meta);
+static void undoheap_extend_undo(Relation rel, BlockNumber old_tail);
+static void undoheap_log_meta(Relation rel, uint8 info, Buffer metabuf,
+							  TransactionId latestRemovedXid,
+							  Buffer initbuf, Buffer linkbuf);
+static void undoheap_discard_page(Relation rel, BlockNumber blkno,
+								  TransactionId latestRemovedXid);
+
+
+/*
+ * Initialize a page of the given type.
+ */
+void
+undoheap_init_page(Page page, uint16 type, BlockNumber next)
+{
+	UndoHeapPageOpaque opaque;
+
+	PageInit(page, BLCKSZ, sizeof(UndoHeapPageOpaqueData));
+
+	opaque = UndoHeapPageGetOpaque(page);
+	opaque->next = next;
+	opaque->type = type;
+	opaque->unused = 0;
+}
+
+/*
+ * Create the metapage of an empty table.  This is done when the table is
+ * first written to, so that creating a table doesn't write anything.
+ */
+void
+undoheap_create_metapage(Relation rel)
+{
+	LockRelationForExtension(rel, ExclusiveLock);
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+	{
+		Buffer		buffer;
+		Page		page;
+		UndoHeapMetaPageData *meta;
+
+		buffer = ReadBufferExtended(rel, MAIN_FORKNUM, P_NEW,
+									RBM_ZERO_AND_LOCK, NULL);
+		Assert(BufferGetBlockNumber(buffer) == UNDOHEAP_METAPAGE_BLKNO);
+		page = BufferGetPage(buffer);
+
+		START_CRIT_SECTION();
+
+		undoheap_init_page(page, UNDOHEAP_PAGE_META, InvalidBlockNumber);
+		meta = UndoHeapPageGetMeta(page);
+		meta->magic = UNDOHEAP_MAGIC;
+		meta->version = UNDOHEAP_VERSION;
+		meta->undo_head = InvalidBlockNumber;
+		meta->undo_tail = InvalidBlockNumber;
+		meta->free_head = InvalidBlockNumber;
+
+		/*
+		 * Set pd_lower just past the end of the metadata.  This is essential,
+		 * because without doing so, metadata will be lost if xlog.c
+		 * compresses the page.
+		 */
+		((PageHeader) page)->pd_lower =
+			((char *) meta + sizeof(UndoHeapMetaPageData)) - (char *) page;
+
+		MarkBufferDirty(buffer);
+
+		if (RelationNeedsWAL(rel))
+			undoheap_log_meta(rel, XLOG_UNDOHEAP_META, buffer,
+							  InvalidTransactionId, InvalidBuffer,
+							  InvalidBuffer);
+
+		END_CRIT_SECTION();
+
+		UnlockReleaseBuffer(buffer);
+	}
+
+	UnlockRelationForExtension(rel, ExclusiveLock);
+}
+
+/*
+ * Read a copy of the metapage contents.
+ */
+void
+undoheap_read_meta(Relation rel, UndoHeapMetaPageData *meta)
+{
+	Buffer		buffer;
+	Page		page;
+
+	buffer = ReadBuffer(rel, UNDOHEAP_METAPAGE_BLKNO);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+	memcpy(meta, UndoHeapPageGetMeta(page), sizeof(UndoHeapMetaPageData));
+	UnlockReleaseBuffer(buffer);
+
+	if (meta->magic != UNDOHEAP_MAGIC)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("metapage of relation \"%s\" is corrupted",
+						RelationGetRelationName(rel))));
+	if (meta->version != UNDOHEAP_VERSION)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("relation \"%s\" has version %u, but the server supports version %u",
+						RelationGetRelationName(rel), meta->version,
+						UNDOHEAP_VERSION)));
+}
+
+/*
+ * Add a new page at the end of the relation, returning it exclusively locked
+ * and zeroed.
+ */
+static Buffer
+undoheap_extend(Relation rel)
+{
+	Buffer		buffer;
+
+	LockRelationForExtension(rel, ExclusiveLock);
+	buffer = ReadBufferExtended(rel, MAIN_FORKNUM, P_NEW, RBM_ZERO_AND_LOCK,
+								NULL);
+	UnlockRelationForExtension(rel, ExclusiveLock);
+
+	return buffer;
+}
+
+/*
+ * Take the first page off the free list, returning it exclusively locked.
+ * The caller holds the metapage exclusively locked, 'meta' points to its
+ * contents, and must WAL-log the change within the same critical section as
+ * reinitializing the page.
+ */
+static Buffer
+undoheap_pop_free_page(Relation rel, UndoHeapMetaPageData *meta)
+{
+	Buffer		buffer;
+	Page		page;
+
+	Assert(BlockNumberIsValid(meta->free_head));
+
+	buffer = ReadBuffer(rel, meta->free_head);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buffer);
+
+	if (PageIsNew(page) ||
+		UndoHeapPageGetOpaque(page)->type != UNDOHEAP_PAGE_FREE)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("free list of relation \"%s\" contains block %u, which is not free",
+						RelationGetRelationName(rel), meta->free_head)));
+
+	return buffer;
+}
+
+/*
+ * Get a new page of the given type, from the free list if there is a page on
+ * it, else by extending the relation.  The page is returned exclusively
+ * locked.
+ */
+Buffer
+undoheap_new_page(Relation rel, uint16 type)
+{
+	Buffer		metabuf;
+	Buffer		buffer;
+	UndoHeapMetaPageData *meta;
+
+	metabuf = ReadBuffer(rel, UNDOHEAP_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+	meta = UndoHeapPageGetMeta(BufferGetPage(metabuf));
+
+	if (BlockNumberIsValid(meta->free_head))
+	{
+		Page		page;
+		BlockNumber next;
+
+		buffer = undoheap_pop_free_page(rel, meta);
+		page = BufferGetPage(buffer);
+		next = UndoHeapPageGetOpaque(page)->next;
+
+		START_CRIT_SECTION();
+
+		meta->free_head = next;
+		undoheap_init_page(page, type, InvalidBlockNumber);
+
+		MarkBufferDirty(metabuf);
+		MarkBufferDirty(buffer);
+
+		if (RelationNeedsWAL(rel))
+			undoheap_log_meta(rel, XLOG_UNDOHEAP_META, metabuf,
+							  InvalidTransactionId, buffer, InvalidBuffer);
+
+		END_CRIT_SECTION();
+
+		UnlockReleaseBuffer(metabuf);
+		return buffer;
+	}
+
+	UnlockReleaseBuffer(metabuf);
+
+	/*
+	 * A new page at the end of the relation isn't WAL-logged until something
+	 * is put on it, like in heap: if we crash before that, it's left zeroed
+	 * and is taken as an empty data page.
+	 */
+	buffer = undoheap_extend(rel);
+	undoheap_init_page(BufferGetPage(buffer), type, InvalidBlockNumber);
+	MarkBufferDirty(buffer);
+
+	return buffer;
+}
+
+/*
+ * Add a page to the end of the undo log, unless someone else has done so
+ * since we found 'old_tail' to be the tail.
+ */
+static void
+undoheap_extend_undo(Relation rel, BlockNumber old_tail)
+{
+	Buffer		metabuf;
+	Buffer		tailbuf = InvalidBuffer;
+	Buffer		buffer;
+	Page		page;
+	UndoHeapMetaPageData *meta;
+	BlockNumber blkno;
+	BlockNumber free_next = InvalidBlockNumber;
+	bool		from_free_list;
+
+	metabuf = ReadBuffer(rel, UNDOHEAP_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+	meta = UndoHeapPageGetMeta(BufferGetPage(metabuf));
+
+	if (meta->undo_tail != old_tail)
+	{
+		UnlockReleaseBuffer(metabuf);
+		return;
+	}
+
+	if (BlockNumberIsValid(old_tail))
+	{
+		tailbuf = ReadBuffer(rel, old_tail);
+		LockBuffer(tailbuf, BUFFER_LOCK_EXCLUSIVE);
+	}
+
+	from_free_list = BlockNumberIsValid(meta->free_head);
+	if (from_free_list)
+	{
+		buffer = undoheap_pop_free_page(rel, meta);
+		free_next = UndoHeapPageGetOpaque(BufferGetPage(buffer))->next;
+	}
+	else
+		buffer = undoheap_extend(rel);
+	page = BufferGetPage(buffer);
+	blkno = BufferGetBlockNumber(buffer);
+
+	START_CRIT_SECTION();
+
+	if (from_free_list)
+		meta->free_head = free_next;
+	undoheap_init_page(page, UNDOHEAP_PAGE_UNDO, InvalidBlockNumber);
+	if (BufferIsValid(tailbuf))
+	{
+		UndoHeapPageGetOpaque(BufferGetPage(tailbuf))->next = blkno;
+		MarkBufferDirty(tailbuf);
+	}
+	else
+		meta->undo_head = blkno;
+	meta->undo_tail = blkno;
+
+	MarkBufferDirty(metabuf);
+	MarkBufferDirty(buffer);
+
+	if (RelationNeedsWAL(rel))
+		undoheap_log_meta(rel, XLOG_UNDOHEAP_META, metabuf,
+						  InvalidTransactionId, buffer, tailbuf);
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(buffer);
+	if (BufferIsValid(tailbuf))
+		UnlockReleaseBuffer(tailbuf);
+	UnlockReleaseBuffer(metabuf);
+}
+
+/*
+ * Return the tail page of the undo log exclusively locked, after making sure
+ * it has room for an undo record of 'len' bytes.  *extended is set if a page
+ * had to be added to the undo log, which is the caller's cue to try
+ * discarding old undo once it is done.
+ *
+ * The caller may hold a data page locked, but no undo page nor the metapage.
+ */
+Buffer
+undoheap_reserve_undo(Relation rel, Size len, bool *extended)
+{
+	Assert(MAXALIGN(len) <= UndoHeapMaxTupleSize);
+
+	for (;;)
+	{
+		UndoHeapMetaPageData meta;
+		Buffer		buffer;
+		Page		page;
+		UndoHeapPageOpaque opaque;
+
+		undoheap_read_meta(rel, &meta);
+
+		if (!BlockNumberIsValid(meta.undo_tail))
+		{
+			undoheap_extend_undo(rel, InvalidBlockNumber);
+			*extended = true;
+			continue;
+		}
+
+		buffer = ReadBuffer(rel, meta.undo_tail);
+		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		page = BufferGetPage(buffer);
+		opaque = UndoHeapPageGetOpaque(page);
+
+		/* If the page is no longer the tail, someone got ahead of us */
+		if (!PageIsNew(page) && opaque->type == UNDOHEAP_PAGE_UNDO &&
+			!BlockNumberIsValid(opaque->next))
+		{
+			if (PageGetFreeSpace(page) >= MAXALIGN(len))
+				return buffer;
+
+			UnlockReleaseBuffer(buffer);
+			undoheap_extend_undo(rel, meta.undo_tail);
+			*extended = true;
+			continue;
+		}
+
+		UnlockReleaseBuffer(buffer);
+	}
+}
+
+/*
+ * Read a copy of the undo record 'undoptr' points to, palloc'd.
+ */
+UndoRecord
+undoheap_read_undo(Relation rel, ItemPointer undoptr, Size *len)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(undoptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(undoptr);
+	Buffer		buffer;
+	Page		page;
+	ItemId		lp;
+	UndoRecord	rec;
+
+	buffer = ReadBuffer(rel, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_SHARE);
+	page = BufferGetPage(buffer);
+
+	if (PageIsNew(page) ||
+		UndoHeapPageGetOpaque(page)->type != UNDOHEAP_PAGE_UNDO ||
+		offnum < FirstOffsetNumber || offnum > PageGetMaxOffsetNumber(page))
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("undo record (%u,%u) of relation \"%s\" does not exist",
+						blkno, offnum, RelationGetRelationName(rel))));
+
+	lp = PageGetItemId(page, offnum);
+	*len = ItemIdGetLength(lp);
+	rec = (UndoRecord) palloc(*len);
+	memcpy(rec, PageGetItem(page, lp), *len);
+
+	UnlockReleaseBuffer(buffer);
+
+	return rec;
+}
+
+/*
+ * Discard undo pages from the head of the undo log whose records are no
+ * longer needed, and put them on the free list.
+ *
+ * A record is no longer needed once its transaction has aborted and the
+ * change has been rolled back, which this does as it goes, or once its
+ * transaction has committed and is older than every snapshot that could
+ * still see the change's previous state.  Committed deletions that old are
+ * pruned while at it, if their pages can be locked without waiting.
+ * Discarding stops at the first record that is still needed; the tail page
+ * is never discarded.
+ *
+ * Only one backend discards at a time.  If 'wait' is false and another one
+ * is at it, return right away.  If 'oldest_xid' isn't NULL, it is set to the
+ * oldest transaction having a record left in the undo log, or to
+ * InvalidTransactionId if there are none.
+ *
+ * Returns the number of pages discarded.
+ */
+BlockNumber
+undoheap_discard(Relation rel, bool wait, TransactionId *oldest_xid)
+{
+	TransactionId oldestXmin;
+	TransactionId cached_xid = InvalidTransactionId;
+	bool		cached_needed = false;
+	bool		cached_committed = false;
+	BlockNumber ndiscarded = 0;
+	bool		stop = false;
+	UndoHeapMetaPageData meta;
+	UndoRecordData *recs;
+
+	if (oldest_xid)
+		*oldest_xid = InvalidTransactionId;
+
+	if (RelationGetNumberOfBlocks(rel) == 0)
+		return 0;
+
+	if (wait)
+		LockPage(rel, UNDOHEAP_METAPAGE_BLKNO, ExclusiveLock);
+	else if (!ConditionalLockPage(rel, UNDOHEAP_METAPAGE_BLKNO, ExclusiveLock))
+		return 0;
+
+	oldestXmin = GetOldestNonRemovableTransactionId(rel);
+	recs = (UndoRecordData *) palloc(sizeof(UndoRecordData) * MaxOffsetNumber);
+
+	while (!stop)
+	{
+		BlockNumber head;
+		Buffer		buffer;
+		Page		page;
+		OffsetNumber maxoff;
+		OffsetNumber offnum;
+		int			nrecs = 0;
+		int			i;
+		BlockNumber last_pruned = InvalidBlockNumber;
+		TransactionId latestRemovedXid = InvalidTransactionId;
+
+		CHECK_FOR_INTERRUPTS();
+
+		undoheap_read_meta(rel, &meta);
+		head = meta.undo_head;
+		if (!BlockNumberIsValid(head) || head == meta.undo_tail)
+			break;
+
+		/* Copy the record headers of the head page */
+		buffer = ReadBuffer(rel, head);
+		LockBuffer(buffer, BUFFER_LOCK_SHARE);
+		page = BufferGetPage(buffer);
+		maxoff = PageGetMaxOffsetNumber(page);
+		for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+		{
+			ItemId		lp = PageGetItemId(page, offnum);
+
+			memcpy(&recs[nrecs++], PageGetItem(page, lp),
+				   sizeof(UndoRecordData));
+		}
+		UnlockReleaseBuffer(buffer);
+
+		for (i = 0; i < nrecs; i++)
+		{
+			UndoRecord	rec = &recs[i];
+			Buffer		databuf;
+
+			/* Consecutive records mostly belong to the same transaction */
+			if (!TransactionIdEquals(rec->ur_xid, cached_xid))
+			{
+				cached_xid = rec->ur_xid;
+				cached_committed = false;
+				if (TransactionIdIsCurrentTransactionId(cached_xid) ||
+					TransactionIdIsInProgress(cached_xid))
+					cached_needed = true;
+				else if (TransactionIdDidCommit(cached_xid))
+				{
+					cached_committed = true;
+					cached_needed = !TransactionIdPrecedes(cached_xid,
+														   oldestXmin);
+				}
+				else
+					cached_needed = false;
+			}
+
+			if (cached_needed)
+			{
+				stop = true;
+				break;
+			}
+
+			if (cached_committed)
+			{
+				if (TransactionIdFollows(rec->ur_xid, latestRemovedXid))
+					latestRemovedXid = rec->ur_xid;
+
+				/* Pruning is only worth it for deletions, and optional */
+				if ((rec->ur_type != UNDO_DELETE && rec->ur_type != UNDO_MOVE) ||
+					rec->ur_blkno == last_pruned)
+					continue;
+				databuf = ReadBuffer(rel, rec->ur_blkno);
+				if (ConditionalLockBuffer(databuf))
+				{
+					if (UndoHeapPageIsData(BufferGetPage(databuf)))
+						undoheap_page_prune(rel, databuf);
+					LockBuffer(databuf, BUFFER_LOCK_UNLOCK);
+				}
+				ReleaseBuffer(databuf);
+				last_pruned = rec->ur_blkno;
+			}
+			else
+			{
+				/* Aborted: roll back the change, if that's not done yet */
+				databuf = ReadBuffer(rel, rec->ur_blkno);
+				LockBuffer(databuf, BUFFER_LOCK_EXCLUSIVE);
+				if (UndoHeapPageIsData(BufferGetPage(databuf)))
+					undoheap_rollback_aborted(rel, databuf, rec->ur_offnum);
+				UnlockReleaseBuffer(databuf);
+			}
+		}
+
+		if (!stop)
+		{
+			undoheap_discard_page(rel, head, latestRemovedXid);
+			ndiscarded++;
+		}
+	}
+
+	pfree(recs);
+
+	/*
+	 * Find the oldest transaction having records left.  The tuple versions
+	 * in the records count too, since rolling back can put them back on the
+	 * page.
+	 */
+	if (oldest_xid)
+	{
+		BlockNumber blkno;
+
+		undoheap_read_meta(rel, &meta);
+		for (blkno = meta.undo_head; BlockNumberIsValid(blkno);)
+		{
+			Buffer		buffer;
+			Page		page;
+			OffsetNumber maxoff;
+			OffsetNumber offnum;
+
+			CHECK_FOR_INTERRUPTS();
+
+			buffer = ReadBuffer(rel, blkno);
+			LockBuffer(buffer, BUFFER_LOCK_SHARE);
+			page = BufferGetPage(buffer);
+			maxoff = PageGetMaxOffsetNumber(page);
+			for (offnum = FirstOffsetNumber; offnum <= maxoff; offnum++)
+			{
+				UndoRecord	rec;
+
+				TransactionId xids[3];
+				int			nxids = 0;
+				int			i;
+
+				rec = (UndoRecord) PageGetItem(page, PageGetItemId(page, offnum));
+				xids[nxids++] = rec->ur_xid;
+				if (rec->ur_type != UNDO_INSERT)
+				{
+					HeapTupleHeader image;
+
+					image = (HeapTupleHeader) UndoRecordGetImage(rec);
+					xids[nxids++] = HeapTupleHeaderGetRawXmin(image);
+					xids[nxids++] = HeapTupleHeaderGetRawXmax(image);
+				}
+
+				for (i = 0; i < nxids; i++)
+				{
+					if (TransactionIdIsNormal(xids[i]) &&
+						(!TransactionIdIsValid(*oldest_xid) ||
+						 TransactionIdPrecedes(xids[i], *oldest_xid)))
+						*oldest_xid = xids[i];
+				}
+			}
+			blkno = UndoHeapPageGetOpaque(page)->next;
+			UnlockReleaseBuffer(buffer);
+		}
+	}
+
+	UnlockPage(rel, UNDOHEAP_METAPAGE_BLKNO, ExclusiveLock);
+
+	return ndiscarded;
+}
+
+/*
+ * Move the head page of the undo log to the free list.
+ */
+static void
+undoheap_discard_page(Relation rel, BlockNumber blkno,
+					  TransactionId latestRemovedXid)
+{
+	Buffer		metabuf;
+	Buffer		buffer;
+	UndoHeapMetaPageData *meta;
+	Page		page;
+
+	metabuf = ReadBuffer(rel, UNDOHEAP_METAPAGE_BLKNO);
+	LockBuffer(metabuf, BUFFER_LOCK_EXCLUSIVE);
+	meta = UndoHeapPageGetMeta(BufferGetPage(metabuf));
+
+	/* We're the only one discarding, so the head can't have moved */
+	if (meta->undo_head != blkno)
+		elog(ERROR, "head of undo log of relation \"%s\" changed during discard",
+			 RelationGetRelationName(rel));
+
+	buffer = ReadBuffer(rel, blkno);
+	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+	page = BufferGetPage(buffer);
+
+	START_CRIT_SECTION();
+
+	meta->undo_head = UndoHeapPageGetOpaque(page)->next;
+	undoheap_init_page(page, UNDOHEAP_PAGE_FREE, meta->free_head);
+	meta->free_head = blkno;
+
+	MarkBufferDirty(metabuf);
+	MarkBufferDirty(buffer);
+
+	if (RelationNeedsWAL(rel))
+		undoheap_log_meta(rel, XLOG_UNDOHEAP_DISCARD, metabuf,
+						  latestRemovedXid, buffer, InvalidBuffer);
+
+	END_CRIT_SECTION();
+
+	UnlockReleaseBuffer(buffer);
+	UnlockReleaseBuffer(metabuf);
+}
+
+/*
+ * WAL-log a change of the metapage, along with the initialization of
+ * 'initbuf' and the next-page link of 'linkbuf', if valid.  Both are taken
+ * from the pages, which the caller has already changed.
+ */
+static void
+undoheap_log_meta(Relation rel, uint8 info, Buffer metabuf,
+				  TransactionId latestRemovedXid,
+				  Buffer initbuf, Buffer linkbuf)
+{
+	xl_undoheap_meta xlrec;
+	XLogRecPtr	recptr;
+
+	xlrec.latestRemovedXid = latestRemovedXid;
+	xlrec.init_next = InvalidBlockNumber;
+	xlrec.link_next = InvalidBlockNumber;
+	xlrec.init_type = 0;
+	xlrec.flags = 0;
+	if (BufferIsValid(initbuf))
+	{
+		UndoHeapPageOpaque opaque = UndoHeapPageGetOpaque(BufferGetPage(initbuf));
+
+		xlrec.flags |= XLU_INIT_PAGE;
+		xlrec.init_next = opaque->next;
+		xlrec.init_type = opaque->type;
+	}
+	if (BufferIsValid(linkbuf))
+	{
+		xlrec.flags |= XLU_LINK_PAGE;
+		xlrec.link_next = UndoHeapPageGetOpaque(BufferGetPage(linkbuf))->next;
+	}
+
+	XLogBeginInsert();
+	XLogRegisterData((char *) &xlrec, SizeOfUndoHeapMeta);
+
+	XLogRegisterBuffer(0, metabuf, REGBUF_WILL_INIT | REGBUF_STANDARD);
+	XLogRegisterBufData(0, (char *) UndoHeapPageGetMeta(BufferGetPage(metabuf)),
+						sizeof(UndoHeapMetaPageData));
+	if (BufferIsValid(initbuf))
+		XLogRegisterBuffer(1, initbuf, REGBUF_WILL_INIT);
+	if (BufferIsValid(linkbuf))
+		XLogRegisterBuffer(2, linkbuf, REGBUF_STANDARD);
+
+	recptr = XLogInsert(RM_UNDOHEAP_ID, info);
+
+	PageSetLSN(BufferGetPage(metabuf), recptr);
+	if (BufferIsValid(initbuf))
+		PageSetLSN(BufferGetPage(initbuf), recptr);
+	if (BufferIsValid(linkbuf))
+		PageSetLSN(BufferGetPage(linkbuf), recptr);
+}
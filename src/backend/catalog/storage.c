@@ -33,6 +33,7 @@
 #include "utils/hsearch.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/spccache.h"
 
 /* GUC variables */
 int			wal_skip_threshold = 2048;	/* in kilobytes */
@@ -113,6 +114,11 @@ AddPendingSync(const RelFileNode *rnode)
  *
  * This function is transactional. The creation is WAL-logged, and if the
  * transaction aborts later on, the storage will be destroyed.
+ *
+ * This is also where we decide whether the relation's pages are stored
+ * compressed, according to its tablespace's page_compression option.  The
+ * decision is made once, and recorded with the storage and in the WAL record,
+ * so it doesn't change if the option is changed later.
  */
 SMgrRelation
 RelationCreateStorage(RelFileNode rnode, char relpersistence)
@@ -121,6 +127,7 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 	SMgrRelation srel;
 	BackendId	backend;
 	bool		needs_wal;
+	bool		compress;
 
 	Assert(!IsInParallelMode());	/* couldn't update pendingSyncHash */
 
@@ -143,11 +150,19 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
 			return NULL;		/* placate compiler */
 	}
 
+	/* The tablespace options can't be looked up while bootstrapping */
+	compress = relpersistence != RELPERSISTENCE_TEMP &&
+		!IsBootstrapProcessingMode() &&
+		get_tablespace_page_compression(rnode.spcNode);
+
 	srel = smgropen(rnode, backend);
 	smgrcreate(srel, MAIN_FORKNUM, false);
+	if (compress)
+		smgrmarkcompressed(srel);
 
 	if (needs_wal)
-		log_smgrcreate(&srel->smgr_rnode.node, MAIN_FORKNUM);
+		log_smgrcreate(&srel->smgr_rnode.node, MAIN_FORKNUM,
+					   compress ? SMGR_CREATE_COMPRESSED : 0);
 
 	/* Add the relation to the list of stuff to delete at abort */
 	pending = (PendingRelDelete *)
@@ -172,7 +187,7 @@ RelationCreateStorage(RelFileNode rnode, char relpersistence)
  * Perform XLogInsert of an XLOG_SMGR_CREATE record to WAL.
  */
 void
-log_smgrcreate(const RelFileNode *rnode, ForkNumber forkNum)
+log_smgrcreate(const RelFileNode *rnode, ForkNumber forkNum, int flags)
 {
 	xl_smgr_create xlrec;
 
@@ -181,6 +196,7 @@ log_smgrcreate(const RelFileNode *rnode, ForkNumber forkNum)
 	 */
 	xlrec.rnode = *rnode;
 	xlrec.forkNum = forkNum;
+	xlrec.flags = flags;
 
 	XLogBeginInsert();
 	XLogRegisterData((char *) &xlrec, sizeof(xlrec));
@@ -916,6 +932,8 @@ smgr_redo(XLogReaderState *record)
 
 		reln = smgropen(xlrec->rnode, InvalidBackendId);
 		smgrcreate(reln, xlrec->forkNum, true);
+		if (xlrec->flags & SMGR_CREATE_COMPRESSED)
+			smgrmarkcompressed(reln);
 	}
 	else if (info == XLOG_SMGR_TRUNCATE)
 	{
@@ -19,6 +19,7 @@
 #include "access/detoast.h"
 #include "access/genam.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
 #include "access/relation.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -33,15 +34,18 @@
 #include "catalog/pg_collation.h"
 #include "catalog/pg_inherits.h"
 #include "catalog/pg_namespace.h"
+#include "catalog/pg_proc.h"
 #include "catalog/pg_statistic_ext.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
 #include "commands/tablecmds.h"
 #include "commands/vacuum.h"
 #include "executor/executor.h"
+#include "executor/instrument.h"
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/paths.h"
 #include "parser/parse_oper.h"
 #include "parser/parse_relation.h"
 #include "pgstat.h"
@@ -52,6 +56,9 @@
 #include "storage/lmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "tcop/tcopprot.h"
 #include "utils/acl.h"
 #include "utils/attoptcache.h"
 #include "utils/builtins.h"
@@ -63,6 +70,7 @@
 #include "utils/pg_rusage.h"
 #include "utils/sampling.h"
 #include "utils/sortsupport.h"
+#include "utils/spccache.h"
 #include "utils/syscache.h"
 #include "utils/timestamp.h"
 
@@ -77,6 +85,140 @@ typedef struct AnlIndexData
 } AnlIndexData;
 
 
+/* State of the reservoir sampling of rows */
+typedef struct AnlSampleState
+{
+	HeapTuple  *rows;			/* the reservoir */
+	int			targrows;		/* size of the reservoir */
+	int			numrows;		/* # rows now in reservoir */
+	double		samplerows;		/* total # rows collected */
+	double		liverows;		/* # live rows seen */
+	double		deadrows;		/* # dead rows seen */
+	double		rowstoskip;		/* -1 means not set yet */
+	ReservoirStateData rstate;
+} AnlSampleState;
+
+/*
+ * Parallel ANALYZE.
+ *
+ * The work of ANALYZE can be divided among parallel workers in two phases,
+ * each of which uses its own parallel context:
+ *
+ * While acquiring the sample, the blocks chosen by the block sampler are
+ * handed out to the participants in chunks.  Each participant builds its own
+ * reservoir sample of the rows in the blocks it read, and the leader then
+ * draws the final sample from the participants' samples, in proportion to
+ * the number of rows each participant saw.
+ *
+ * While computing the per-column statistics, the sample rows are copied into
+ * the DSM segment, and each participant computes the statistics of one column
+ * at a time.  Workers send the results back to the leader through their
+ * message queues.
+ */
+typedef enum AnlParallelPhase
+{
+	ANL_PARALLEL_SAMPLE,
+	ANL_PARALLEL_COMPUTE_STATS
+} AnlParallelPhase;
+
+/* Magic numbers for parallel analyze state sharing */
+#define PARALLEL_ANALYZE_KEY_SHARED			UINT64CONST(0xE000000000000001)
+#define PARALLEL_ANALYZE_KEY_DATA			UINT64CONST(0xE000000000000002)
+#define PARALLEL_ANALYZE_KEY_QUEUES			UINT64CONST(0xE000000000000003)
+#define PARALLEL_ANALYZE_KEY_QUERY_TEXT		UINT64CONST(0xE000000000000004)
+#define PARALLEL_ANALYZE_KEY_BUFFER_USAGE	UINT64CONST(0xE000000000000005)
+#define PARALLEL_ANALYZE_KEY_WAL_USAGE		UINT64CONST(0xE000000000000006)
+
+/* Size of the queue each worker sends its results through */
+#define PARALLEL_ANALYZE_QUEUE_SIZE		65536
+
+/* Number of sample blocks a participant claims at a time */
+#define PARALLEL_ANALYZE_CHUNK_SIZE		32
+
+/*
+ * Shared information among parallel workers.  This is allocated in the DSM
+ * segment, together with the phase-specific data: the block numbers to
+ * sample, or the columns to analyze followed by the sample rows.
+ */
+typedef struct AnlShared
+{
+	Oid			relid;			/* relation being analyzed */
+	AnlParallelPhase phase;		/* what the workers are to do */
+
+	/* Cost-based vacuum delay, see compute_parallel_delay() */
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;
+
+	/* Information used while acquiring the sample */
+	TransactionId OldestXmin;	/* cutoff xmin for HeapTupleSatisfiesVacuum */
+	int			targrows;		/* size of each participant's reservoir */
+	BlockNumber nblocks;		/* number of blocks to sample */
+	pg_atomic_uint32 nextblock; /* index of the next block to claim */
+	pg_atomic_uint32 nblocksdone;	/* for progress reporting */
+
+	/* Information used while computing the statistics */
+	int			numrows;		/* number of sample rows */
+	double		totalrows;		/* estimated total rows in the relation */
+	int			ncolumns;		/* number of columns to analyze */
+	pg_atomic_uint32 nextcolumn;	/* index of the next column to claim */
+} AnlShared;
+
+/* Header of each sample row stored in the DSM segment */
+typedef struct AnlSharedRow
+{
+	uint32		t_len;			/* length of the tuple that follows */
+	ItemPointerData t_self;		/* its position in the relation */
+} AnlSharedRow;
+
+#define SizeOfAnlSharedRow	MAXALIGN(sizeof(AnlSharedRow))
+
+/*
+ * Summary of a participant's sample, sent by each worker ahead of its sample
+ * rows.
+ */
+typedef struct AnlSampleSummary
+{
+	int			numrows;
+	double		samplerows;
+	double		liverows;
+	double		deadrows;
+} AnlSampleSummary;
+
+/*
+ * Fixed-size part of the statistics of one column, sent by a worker to the
+ * leader.  It's followed by the stanumbers arrays of each slot, and then the
+ * stavalues arrays of each slot, serialized with datumSerialize().
+ */
+typedef struct AnlStatsResult
+{
+	int			colidx;			/* index into the shared column list */
+	bool		stats_valid;
+	float4		stanullfrac;
+	int32		stawidth;
+	float4		stadistinct;
+	int16		stakind[STATISTIC_NUM_SLOTS];
+	Oid			staop[STATISTIC_NUM_SLOTS];
+	Oid			stacoll[STATISTIC_NUM_SLOTS];
+	int			numnumbers[STATISTIC_NUM_SLOTS];
+	int			numvalues[STATISTIC_NUM_SLOTS];
+	Oid			statypid[STATISTIC_NUM_SLOTS];
+	int16		statyplen[STATISTIC_NUM_SLOTS];
+	bool		statypbyval[STATISTIC_NUM_SLOTS];
+	char		statypalign[STATISTIC_NUM_SLOTS];
+} AnlStatsResult;
+
+/* Leader's state of a parallel phase */
+typedef struct AnlParallelState
+{
+	ParallelContext *pcxt;
+	AnlShared  *shared;
+	char	   *data;			/* phase-specific data */
+	shm_mq_handle **queues;		/* one per worker, or NULL */
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+} AnlParallelState;
+
+
 /* Default statistics target (GUC parameter) */
 int			default_statistics_target = 100;
 
@@ -98,10 +240,42 @@ static VacAttrStats *examine_attribute(Relation onerel, int attnum,
 static int	acquire_sample_rows(Relation onerel, int elevel,
 								HeapTuple *rows, int targrows,
 								double *totalrows, double *totaldeadrows);
+static void init_sample_state(AnlSampleState *sstate, HeapTuple *rows,
+							  int targrows);
+static void sample_block_rows(TableScanDesc scan, TransactionId OldestXmin,
+							  TupleTableSlot *slot, AnlSampleState *sstate);
 static int	compare_rows(const void *a, const void *b);
 static int	acquire_inherited_sample_rows(Relation onerel, int elevel,
 										  HeapTuple *rows, int targrows,
 										  double *totalrows, double *totaldeadrows);
+static int	compute_parallel_analyze_workers(Relation onerel, int nrequested,
+											 BlockNumber nblocks);
+static AnlParallelState *begin_parallel_analyze(Relation onerel,
+												AnlParallelPhase phase,
+												int nworkers, Size datasize);
+static void launch_parallel_analyze(AnlParallelState *pstate, int elevel);
+static void end_parallel_analyze(AnlParallelState *pstate);
+static int	acquire_sample_rows_parallel(Relation onerel, int elevel,
+										 int nworkers,
+										 HeapTuple *rows, int targrows,
+										 double *totalrows,
+										 double *totaldeadrows);
+static void parallel_analyze_sample(Relation onerel, AnlShared *shared,
+									BlockNumber *blocks,
+									AnlSampleState *sstate);
+static void compute_stats_parallel(Relation onerel, int nworkers, int elevel,
+								   VacAttrStats **vacattrstats, int attr_cnt,
+								   HeapTuple *rows, int numrows,
+								   double totalrows,
+								   MemoryContext col_context);
+static void receive_attr_stats(AnlParallelState *pstate,
+							   VacAttrStats **vacattrstats,
+							   int *colmap, bool *done, bool nowait);
+static void parallel_analyze_compute_stats(Relation onerel, AnlShared *shared,
+										   char *data, shm_mq_handle *mqh);
+static void serialize_attr_stats(VacAttrStats *stats, int colidx,
+								 StringInfo buf);
+static void deserialize_attr_stats(VacAttrStats *stats, char *data);
 static void update_attstats(Oid relid, bool inh,
 							int natts, VacAttrStats **vacattrstats);
 static Datum std_fetch_func(VacAttrStatsP stats, int rownum, bool *isNull);
@@ -306,6 +480,7 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	double		totalrows,
 				totaldeadrows;
 	HeapTuple  *rows;
+	int			nworkers;
 	PGRUsage	ru0;
 	TimestampTz starttime = 0;
 	MemoryContext caller_context;
@@ -496,6 +671,14 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 	if (targrows < minrows)
 		targrows = minrows;
 
+	/*
+	 * Decide how many parallel workers to use, based on the number of blocks
+	 * we are going to sample.
+	 */
+	nworkers = compute_parallel_analyze_workers(onerel, params->nworkers,
+												Min((BlockNumber) targrows,
+													relpages));
+
 	/*
 	 * Acquire the sample rows
 	 */
@@ -507,6 +690,10 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 		numrows = acquire_inherited_sample_rows(onerel, elevel,
 												rows, targrows,
 												&totalrows, &totaldeadrows);
+	else if (nworkers > 0 && acquirefunc == acquire_sample_rows)
+		numrows = acquire_sample_rows_parallel(onerel, elevel, nworkers,
+											   rows, targrows,
+											   &totalrows, &totaldeadrows);
 	else
 		numrows = (*acquirefunc) (onerel, elevel,
 								  rows, targrows,
@@ -531,18 +718,32 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 											ALLOCSET_DEFAULT_SIZES);
 		old_context = MemoryContextSwitchTo(col_context);
 
+		if (nworkers > 0 && attr_cnt > 1)
+			compute_stats_parallel(onerel, Min(nworkers, attr_cnt - 1), elevel,
+								   vacattrstats, attr_cnt,
+								   rows, numrows, totalrows, col_context);
+		else
+		{
+			for (i = 0; i < attr_cnt; i++)
+			{
+				VacAttrStats *stats = vacattrstats[i];
+
+				stats->rows = rows;
+				stats->tupDesc = onerel->rd_att;
+				stats->compute_stats(stats,
+									 std_fetch_func,
+									 numrows,
+									 totalrows);
+
+				MemoryContextResetAndDeleteChildren(col_context);
+			}
+		}
+
 		for (i = 0; i < attr_cnt; i++)
 		{
 			VacAttrStats *stats = vacattrstats[i];
 			AttributeOpts *aopt;
 
-			stats->rows = rows;
-			stats->tupDesc = onerel->rd_att;
-			stats->compute_stats(stats,
-								 std_fetch_func,
-								 numrows,
-								 totalrows);
-
 			/*
 			 * If the appropriate flavor of the n_distinct option is
 			 * specified, override with the corresponding value.
@@ -556,8 +757,6 @@ do_analyze_rel(Relation onerel, VacuumParams *params,
 				if (n_distinct != 0.0)
 					stats->stadistinct = n_distinct;
 			}
-
-			MemoryContextResetAndDeleteChildren(col_context);
 		}
 
 		if (hasindex)
@@ -1026,19 +1225,19 @@ acquire_sample_rows(Relation onerel, int elevel,
 					HeapTuple *rows, int targrows,
 					double *totalrows, double *totaldeadrows)
 {
-	int			numrows = 0;	/* # rows now in reservoir */
-	double		samplerows = 0; /* total # rows collected */
-	double		liverows = 0;	/* # live rows seen */
-	double		deadrows = 0;	/* # dead rows seen */
-	double		rowstoskip = -1;	/* -1 means not set yet */
+	AnlSampleState sstate;
 	BlockNumber totalblocks;
 	TransactionId OldestXmin;
 	BlockSamplerData bs;
-	ReservoirStateData rstate;
 	TupleTableSlot *slot;
 	TableScanDesc scan;
 	BlockNumber nblocks;
 	BlockNumber blksdone = 0;
+	long		randseed;
+#ifdef USE_PREFETCH
+	int			prefetch_maximum = 0;	/* blocks to prefetch if enabled */
+	BlockSamplerData prefetch_bs;
+#endif
 
 	Assert(targrows > 0);
 
@@ -1048,72 +1247,75 @@ acquire_sample_rows(Relation onerel, int elevel,
 	OldestXmin = GetOldestNonRemovableTransactionId(onerel);
 
 	/* Prepare for sampling block numbers */
-	nblocks = BlockSampler_Init(&bs, totalblocks, targrows, random());
+	randseed = random();
+	nblocks = BlockSampler_Init(&bs, totalblocks, targrows, randseed);
+
+#ifdef USE_PREFETCH
+	prefetch_maximum = get_tablespace_maintenance_io_concurrency(onerel->rd_rel->reltablespace);
+	/* Create another BlockSampler, using the same seed, for prefetching */
+	if (prefetch_maximum)
+		(void) BlockSampler_Init(&prefetch_bs, totalblocks, targrows, randseed);
+#endif
 
 	/* Report sampling block numbers */
 	pgstat_progress_update_param(PROGRESS_ANALYZE_BLOCKS_TOTAL,
 								 nblocks);
 
 	/* Prepare for sampling rows */
-	reservoir_init_selection_state(&rstate, targrows);
+	init_sample_state(&sstate, rows, targrows);
 
 	scan = table_beginscan_analyze(onerel);
 	slot = table_slot_create(onerel, NULL);
 
+#ifdef USE_PREFETCH
+
+	/*
+	 * If we are doing prefetching, then go ahead and tell the kernel about
+	 * the first set of pages we are going to want.  This also moves our
+	 * iterator out ahead of the main one being used, where we will keep it
+	 * so that we're always pre-fetching out prefetch_maximum number of blocks
+	 * ahead.
+	 */
+	if (prefetch_maximum)
+	{
+		for (int i = 0; i < prefetch_maximum; i++)
+		{
+			BlockNumber prefetch_block;
+
+			if (!BlockSampler_HasMore(&prefetch_bs))
+				break;
+
+			prefetch_block = BlockSampler_Next(&prefetch_bs);
+			PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, prefetch_block);
+		}
+	}
+#endif
+
 	/* Outer loop over blocks to sample */
 	while (BlockSampler_HasMore(&bs))
 	{
 		BlockNumber targblock = BlockSampler_Next(&bs);
+#ifdef USE_PREFETCH
+
+		/*
+		 * Make sure that every time the main BlockSampler is moved forward
+		 * that our prefetch BlockSampler also gets moved forward, so that we
+		 * always stay out ahead.
+		 */
+		if (prefetch_maximum && BlockSampler_HasMore(&prefetch_bs))
+		{
+			BlockNumber prefetch_targblock = BlockSampler_Next(&prefetch_bs);
+
+			PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, prefetch_targblock);
+		}
+#endif
 
 		vacuum_delay_point();
 
 		if (!table_scan_analyze_next_block(scan, targblock, vac_strategy))
 			continue;
 
-		while (table_scan_analyze_next_tuple(scan, OldestXmin, &liverows, &deadrows, slot))
-		{
-			/*
-			 * The first targrows sample rows are simply copied into the
-			 * reservoir. Then we start replacing tuples in the sample until
-			 * we reach the end of the relation.  This algorithm is from Jeff
-			 * Vitter's paper (see full citation in utils/misc/sampling.c). It
-			 * works by repeatedly computing the number of tuples to skip
-			 * before selecting a tuple, which replaces a randomly chosen
-			 * element of the reservoir (current set of tuples).  At all times
-			 * the reservoir is a true random sample of the tuples we've
-			 * passed over so far, so when we fall off the end of the relation
-			 * we're done.
-			 */
-			if (numrows < targrows)
-				rows[numrows++] = ExecCopySlotHeapTuple(slot);
-			else
-			{
-				/*
-				 * t in Vitter's paper is the number of records already
-				 * processed.  If we need to compute a new S value, we must
-				 * use the not-yet-incremented value of samplerows as t.
-				 */
-				if (rowstoskip < 0)
-					rowstoskip = reservoir_get_next_S(&rstate, samplerows, targrows);
-
-				if (rowstoskip <= 0)
-				{
-					/*
-					 * Found a suitable tuple, so save it, replacing one old
-					 * tuple at random
-					 */
-					int			k = (int) (targrows * sampler_random_fract(rstate.randstate));
-
-					Assert(k >= 0 && k < targrows);
-					heap_freetuple(rows[k]);
-					rows[k] = ExecCopySlotHeapTuple(slot);
-				}
-
-				rowstoskip -= 1;
-			}
-
-			samplerows += 1;
-		}
+		sample_block_rows(scan, OldestXmin, slot, &sstate);
 
 		pgstat_progress_update_param(PROGRESS_ANALYZE_BLOCKS_DONE,
 									 ++blksdone);
@@ -1130,8 +1332,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 	 * (itempointer). It's not worth worrying about corner cases where the
 	 * tuples are already sorted.
 	 */
-	if (numrows == targrows)
-		qsort((void *) rows, numrows, sizeof(HeapTuple), compare_rows);
+	if (sstate.numrows == targrows)
+		qsort((void *) rows, sstate.numrows, sizeof(HeapTuple), compare_rows);
 
 	/*
 	 * Estimate total numbers of live and dead rows in relation, extrapolating
@@ -1142,8 +1344,8 @@ acquire_sample_rows(Relation onerel, int elevel,
 	 */
 	if (bs.m > 0)
 	{
-		*totalrows = floor((liverows / bs.m) * totalblocks + 0.5);
-		*totaldeadrows = floor((deadrows / bs.m) * totalblocks + 0.5);
+		*totalrows = floor((sstate.liverows / bs.m) * totalblocks + 0.5);
+		*totaldeadrows = floor((sstate.deadrows / bs.m) * totalblocks + 0.5);
 	}
 	else
 	{
@@ -1160,10 +1362,82 @@ acquire_sample_rows(Relation onerel, int elevel,
 					"%d rows in sample, %.0f estimated total rows",
 					RelationGetRelationName(onerel),
 					bs.m, totalblocks,
-					liverows, deadrows,
-					numrows, *totalrows)));
+					sstate.liverows, sstate.deadrows,
+					sstate.numrows, *totalrows)));
 
-	return numrows;
+	return sstate.numrows;
+}
+
+/*
+ * init_sample_state -- prepare to collect a sample of targrows rows into rows[]
+ */
+static void
+init_sample_state(AnlSampleState *sstate, HeapTuple *rows, int targrows)
+{
+	sstate->rows = rows;
+	sstate->targrows = targrows;
+	sstate->numrows = 0;
+	sstate->samplerows = 0;
+	sstate->liverows = 0;
+	sstate->deadrows = 0;
+	sstate->rowstoskip = -1;
+	reservoir_init_selection_state(&sstate->rstate, targrows);
+}
+
+/*
+ * sample_block_rows -- add the rows of the block the scan is positioned on
+ * to the sample
+ */
+static void
+sample_block_rows(TableScanDesc scan, TransactionId OldestXmin,
+				  TupleTableSlot *slot, AnlSampleState *sstate)
+{
+	while (table_scan_analyze_next_tuple(scan, OldestXmin, &sstate->liverows,
+										 &sstate->deadrows, slot))
+	{
+		/*
+		 * The first targrows sample rows are simply copied into the
+		 * reservoir. Then we start replacing tuples in the sample until we
+		 * reach the end of the relation.  This algorithm is from Jeff
+		 * Vitter's paper (see full citation in utils/misc/sampling.c). It
+		 * works by repeatedly computing the number of tuples to skip before
+		 * selecting a tuple, which replaces a randomly chosen element of the
+		 * reservoir (current set of tuples).  At all times the reservoir is a
+		 * true random sample of the tuples we've passed over so far, so when
+		 * we fall off the end of the relation we're done.
+		 */
+		if (sstate->numrows < sstate->targrows)
+			sstate->rows[sstate->numrows++] = ExecCopySlotHeapTuple(slot);
+		else
+		{
+			/*
+			 * t in Vitter's paper is the number of records already
+			 * processed.  If we need to compute a new S value, we must use
+			 * the not-yet-incremented value of samplerows as t.
+			 */
+			if (sstate->rowstoskip < 0)
+				sstate->rowstoskip = reservoir_get_next_S(&sstate->rstate,
+														  sstate->samplerows,
+														  sstate->targrows);
+
+			if (sstate->rowstoskip <= 0)
+			{
+				/*
+				 * Found a suitable tuple, so save it, replacing one old tuple
+				 * at random
+				 */
+				int			k = (int) (sstate->targrows * sampler_random_fract(sstate->rstate.randstate));
+
+				Assert(k >= 0 && k < sstate->targrows);
+				heap_freetuple(sstate->rows[k]);
+				sstate->rows[k] = ExecCopySlotHeapTuple(slot);
+			}
+
+			sstate->rowstoskip -= 1;
+		}
+
+		sstate->samplerows += 1;
+	}
 }
 
 /*
@@ -1422,6 +1696,1100 @@ acquire_inherited_sample_rows(Relation onerel, int elevel,
 }
 
 
+/*
+ * compute_parallel_analyze_workers -- decide how many parallel workers to use
+ *
+ * nrequested is the number of workers requested with the PARALLEL option, 0
+ * to decide based on nblocks, the number of blocks we are going to sample, or
+ * -1 if parallel analyze is disabled.  The result is limited by
+ * max_parallel_maintenance_workers.
+ */
+static int
+compute_parallel_analyze_workers(Relation onerel, int nrequested,
+								 BlockNumber nblocks)
+{
+	int			nworkers;
+
+	if (nrequested < 0 || max_parallel_maintenance_workers == 0 ||
+		IsInParallelMode())
+		return 0;
+
+	/*
+	 * Since parallel workers cannot access data in temporary tables, we can't
+	 * analyze them in parallel.
+	 */
+	if (RelationUsesLocalBuffers(onerel))
+	{
+		/*
+		 * Give warning only if the user explicitly tries to perform a
+		 * parallel analyze on the temporary table.
+		 */
+		if (nrequested > 0)
+			ereport(WARNING,
+					(errmsg("disabling parallel option of analyze on \"%s\" --- cannot analyze temporary tables in parallel",
+							RelationGetRelationName(onerel))));
+		return 0;
+	}
+
+	if (nrequested > 0)
+		nworkers = nrequested;
+	else
+	{
+		/* The parallel_workers reloption, if set, takes precedence */
+		nworkers = -1;
+		if (onerel->rd_rel->relkind == RELKIND_RELATION ||
+			onerel->rd_rel->relkind == RELKIND_MATVIEW)
+			nworkers = RelationGetParallelWorkers(onerel, -1);
+
+		if (nworkers < 0)
+		{
+			BlockNumber threshold = Max(min_parallel_table_scan_size, 1);
+
+			/*
+			 * Like a parallel sequential scan, use one worker once the sample
+			 * covers min_parallel_table_scan_size, and another one each time
+			 * it triples.
+			 */
+			nworkers = 0;
+			while (nblocks >= threshold)
+			{
+				nworkers++;
+				if (threshold > MaxBlockNumber / 3)
+					break;
+				threshold *= 3;
+			}
+		}
+	}
+
+	return Min(nworkers, max_parallel_maintenance_workers);
+}
+
+/*
+ * begin_parallel_analyze -- set up a parallel context for one phase
+ *
+ * This creates the DSM segment, with room for datasize bytes of
+ * phase-specific data, but doesn't launch the workers yet: the caller must
+ * first fill in the shared information and the data, and then call
+ * launch_parallel_analyze().  Returns NULL if no DSM segment could be
+ * created, in which case the caller should do the work serially.
+ */
+static AnlParallelState *
+begin_parallel_analyze(Relation onerel, AnlParallelPhase phase,
+					   int nworkers, Size datasize)
+{
+	AnlParallelState *pstate;
+	ParallelContext *pcxt;
+	AnlShared  *shared;
+	char	   *data;
+	char	   *queuespace;
+	shm_mq_handle **queues;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+	int			querylen;
+	int			i;
+
+	Assert(nworkers > 0);
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_analyze_main",
+								 nworkers);
+
+	/* Estimate size for shared information -- PARALLEL_ANALYZE_KEY_SHARED */
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(AnlShared));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for phase-specific data -- PARALLEL_ANALYZE_KEY_DATA */
+	shm_toc_estimate_chunk(&pcxt->estimator, datasize);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Estimate size for the workers' queues -- PARALLEL_ANALYZE_KEY_QUEUES */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(PARALLEL_ANALYZE_QUEUE_SIZE, pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/*
+	 * Estimate space for BufferUsage and WalUsage --
+	 * PARALLEL_ANALYZE_KEY_BUFFER_USAGE and PARALLEL_ANALYZE_KEY_WAL_USAGE.
+	 */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_ANALYZE_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial analyze) */
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	/* Prepare shared information */
+	shared = (AnlShared *) shm_toc_allocate(pcxt->toc, sizeof(AnlShared));
+	MemSet(shared, 0, sizeof(AnlShared));
+	shared->relid = RelationGetRelid(onerel);
+	shared->phase = phase;
+	pg_atomic_init_u32(&(shared->cost_balance), 0);
+	pg_atomic_init_u32(&(shared->active_nworkers), 0);
+	pg_atomic_init_u32(&(shared->nextblock), 0);
+	pg_atomic_init_u32(&(shared->nblocksdone), 0);
+	pg_atomic_init_u32(&(shared->nextcolumn), 0);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_SHARED, shared);
+
+	data = shm_toc_allocate(pcxt->toc, datasize);
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_DATA, data);
+
+	/* Create the workers' queues, and become the receiver for each */
+	queuespace = shm_toc_allocate(pcxt->toc,
+								  mul_size(PARALLEL_ANALYZE_QUEUE_SIZE,
+										   pcxt->nworkers));
+	queues = (shm_mq_handle **)
+		palloc0(pcxt->nworkers * sizeof(shm_mq_handle *));
+	for (i = 0; i < pcxt->nworkers; i++)
+	{
+		shm_mq	   *mq;
+
+		mq = shm_mq_create(queuespace + ((Size) i) * PARALLEL_ANALYZE_QUEUE_SIZE,
+						   (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+		shm_mq_set_receiver(mq, MyProc);
+		queues[i] = shm_mq_attach(mq, pcxt->seg, NULL);
+	}
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUEUES, queuespace);
+
+	/*
+	 * Allocate space for each worker's BufferUsage and WalUsage; no need to
+	 * initialize
+	 */
+	buffer_usage = shm_toc_allocate(pcxt->toc,
+									mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE, buffer_usage);
+	wal_usage = shm_toc_allocate(pcxt->toc,
+								 mul_size(sizeof(WalUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, wal_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		sharedquery[querylen] = '\0';
+		shm_toc_insert(pcxt->toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	pstate = (AnlParallelState *) palloc0(sizeof(AnlParallelState));
+	pstate->pcxt = pcxt;
+	pstate->shared = shared;
+	pstate->data = data;
+	pstate->queues = queues;
+	pstate->buffer_usage = buffer_usage;
+	pstate->wal_usage = wal_usage;
+
+	return pstate;
+}
+
+/*
+ * launch_parallel_analyze -- launch the workers of a parallel phase
+ */
+static void
+launch_parallel_analyze(AnlParallelState *pstate, int elevel)
+{
+	ParallelContext *pcxt = pstate->pcxt;
+	int			i;
+
+	/*
+	 * The workers' cost-based delay starts from the leader's current
+	 * balance.
+	 */
+	pg_atomic_write_u32(&(pstate->shared->cost_balance), VacuumCostBalance);
+
+	LaunchParallelWorkers(pcxt);
+
+	/* Make sure we notice if a worker fails to start */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		shm_mq_set_handle(pstate->queues[i], pcxt->worker[i].bgwhandle);
+
+	if (pcxt->nworkers_launched > 0)
+	{
+		/* Enable shared cost balance for leader backend */
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &(pstate->shared->cost_balance);
+		VacuumActiveNWorkers = &(pstate->shared->active_nworkers);
+	}
+
+	if (pstate->shared->phase == ANL_PARALLEL_SAMPLE)
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel analyze worker for sampling (planned: %d)",
+								 "launched %d parallel analyze workers for sampling (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, pcxt->nworkers)));
+	else
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel analyze worker for computing statistics (planned: %d)",
+								 "launched %d parallel analyze workers for computing statistics (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, pcxt->nworkers)));
+}
+
+/*
+ * end_parallel_analyze -- wait for the workers of a parallel phase to finish,
+ * and tear down the parallel context
+ */
+static void
+end_parallel_analyze(AnlParallelState *pstate)
+{
+	ParallelContext *pcxt = pstate->pcxt;
+	int			i;
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/*
+	 * Next, accumulate buffer and WAL usage.  (This must wait for the workers
+	 * to finish, or we might get incomplete data.)
+	 */
+	for (i = 0; i < pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&pstate->buffer_usage[i], &pstate->wal_usage[i]);
+
+	/* Carry the shared balance value back, and disable shared costing */
+	if (VacuumSharedCostBalance)
+	{
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+
+	DestroyParallelContext(pcxt);
+	ExitParallelMode();
+
+	pfree(pstate->queues);
+	pfree(pstate);
+}
+
+/*
+ * acquire_sample_rows_parallel -- acquire a random sample of rows from the
+ * table, using parallel workers
+ *
+ * This has the same API as acquire_sample_rows, which it falls back to if
+ * parallelism can't be used.
+ *
+ * The blocks to sample are chosen up front, the same way as in
+ * acquire_sample_rows, and shared among the participants, each of which
+ * builds a reservoir sample of targrows rows from the blocks it read.  Since
+ * every participant's sample is a random sample of the rows that participant
+ * saw, we can get a random sample of all the rows by drawing targrows rows
+ * from the union of the rows seen, without replacement, and taking the rows
+ * drawn from each participant out of its sample.
+ */
+static int
+acquire_sample_rows_parallel(Relation onerel, int elevel, int nworkers,
+							 HeapTuple *rows, int targrows,
+							 double *totalrows, double *totaldeadrows)
+{
+	AnlParallelState *pstate;
+	AnlShared  *shared;
+	AnlSampleState sstate;
+	AnlSampleSummary *summaries;
+	BlockNumber totalblocks;
+	BlockSamplerData bs;
+	BlockNumber nblocks;
+	BlockNumber *blocks;
+	SamplerRandomState randstate;
+	int		   *keep;
+	int			nparticipants;
+	int			numrows;
+	double		samplerows = 0;
+	double		liverows = 0;
+	double		deadrows = 0;
+	int			i;
+
+	Assert(targrows > 0);
+
+	totalblocks = RelationGetNumberOfBlocks(onerel);
+
+	/* Choose the blocks to sample, so that they can be handed out */
+	nblocks = BlockSampler_Init(&bs, totalblocks, targrows, random());
+	if (nblocks == 0)
+		return acquire_sample_rows(onerel, elevel, rows, targrows,
+								   totalrows, totaldeadrows);
+
+	pstate = begin_parallel_analyze(onerel, ANL_PARALLEL_SAMPLE, nworkers,
+									mul_size(nblocks, sizeof(BlockNumber)));
+	if (pstate == NULL)
+		return acquire_sample_rows(onerel, elevel, rows, targrows,
+								   totalrows, totaldeadrows);
+
+	shared = pstate->shared;
+	blocks = (BlockNumber *) pstate->data;
+	for (i = 0; BlockSampler_HasMore(&bs); i++)
+		blocks[i] = BlockSampler_Next(&bs);
+	Assert(i == nblocks);
+
+	/* Need a cutoff xmin for HeapTupleSatisfiesVacuum */
+	shared->OldestXmin = GetOldestNonRemovableTransactionId(onerel);
+	shared->targrows = targrows;
+	shared->nblocks = nblocks;
+
+	/* Report sampling block numbers */
+	pgstat_progress_update_param(PROGRESS_ANALYZE_BLOCKS_TOTAL,
+								 nblocks);
+
+	launch_parallel_analyze(pstate, elevel);
+
+	/* Join as a participant, collecting our own sample into rows[] */
+	init_sample_state(&sstate, rows, targrows);
+	parallel_analyze_sample(onerel, shared, blocks, &sstate);
+
+	/*
+	 * Collect the summaries of all the samples.  A worker that failed to
+	 * start, or that errored out, contributes nothing; in the latter case,
+	 * end_parallel_analyze() reports its error.
+	 */
+	nparticipants = pstate->pcxt->nworkers_launched + 1;
+	summaries = (AnlSampleSummary *)
+		palloc0(nparticipants * sizeof(AnlSampleSummary));
+	summaries[0].numrows = sstate.numrows;
+	summaries[0].samplerows = sstate.samplerows;
+	summaries[0].liverows = sstate.liverows;
+	summaries[0].deadrows = sstate.deadrows;
+	for (i = 1; i < nparticipants; i++)
+	{
+		Size		nbytes;
+		void	   *data;
+
+		if (shm_mq_receive(pstate->queues[i - 1], &nbytes, &data,
+						   false) == SHM_MQ_SUCCESS)
+		{
+			Assert(nbytes == sizeof(AnlSampleSummary));
+			memcpy(&summaries[i], data, sizeof(AnlSampleSummary));
+		}
+	}
+
+	for (i = 0; i < nparticipants; i++)
+	{
+		samplerows += summaries[i].samplerows;
+		liverows += summaries[i].liverows;
+		deadrows += summaries[i].deadrows;
+	}
+
+	/*
+	 * Decide how many rows to take from each participant's sample.  If all
+	 * the rows seen fit in the sample, we take them all.
+	 */
+	keep = (int *) palloc0(nparticipants * sizeof(int));
+	sampler_random_init_state(random(), randstate);
+	if (samplerows <= targrows)
+	{
+		for (i = 0; i < nparticipants; i++)
+			keep[i] = summaries[i].numrows;
+	}
+	else
+	{
+		int			j;
+
+		for (j = 0; j < targrows; j++)
+		{
+			double		r;
+
+			/* choose one of the samplerows - j rows not drawn yet */
+			r = floor(sampler_random_fract(randstate) * (samplerows - j));
+			r = Min(r, samplerows - j - 1);
+			for (i = 0; i < nparticipants - 1; i++)
+			{
+				if (r < summaries[i].samplerows - keep[i])
+					break;
+				r -= summaries[i].samplerows - keep[i];
+			}
+			keep[i]++;
+		}
+	}
+
+	/* Thin out our own sample, using Knuth's selection sampling */
+	numrows = 0;
+	for (i = 0; i < sstate.numrows; i++)
+	{
+		if ((sstate.numrows - i) * sampler_random_fract(randstate) <
+			keep[0] - numrows)
+			rows[numrows++] = rows[i];
+		else
+			heap_freetuple(rows[i]);
+	}
+	Assert(numrows == keep[0]);
+
+	/* Then add the selected rows of each worker's sample */
+	for (i = 1; i < nparticipants; i++)
+	{
+		int			seen = 0;
+		int			kept = 0;
+
+		while (kept < keep[i])
+		{
+			Size		nbytes;
+			void	   *data;
+			AnlSharedRow hdr;
+
+			if (shm_mq_receive(pstate->queues[i - 1], &nbytes, &data,
+							   false) != SHM_MQ_SUCCESS)
+				break;
+
+			if ((summaries[i].numrows - seen) * sampler_random_fract(randstate) <
+				keep[i] - kept)
+			{
+				HeapTuple	tuple;
+
+				memcpy(&hdr, data, sizeof(AnlSharedRow));
+				Assert(nbytes == sizeof(AnlSharedRow) + hdr.t_len);
+
+				tuple = (HeapTuple) palloc(HEAPTUPLESIZE + hdr.t_len);
+				tuple->t_len = hdr.t_len;
+				tuple->t_self = hdr.t_self;
+				tuple->t_tableOid = RelationGetRelid(onerel);
+				tuple->t_data = (HeapTupleHeader) ((char *) tuple + HEAPTUPLESIZE);
+				memcpy(tuple->t_data, (char *) data + sizeof(AnlSharedRow),
+					   hdr.t_len);
+
+				rows[numrows++] = tuple;
+				kept++;
+			}
+			seen++;
+		}
+
+		/* We don't need the rest of the worker's sample */
+		shm_mq_detach(pstate->queues[i - 1]);
+		pstate->queues[i - 1] = NULL;
+	}
+
+	end_parallel_analyze(pstate);
+
+	/* Put the rows back in physical order */
+	qsort((void *) rows, numrows, sizeof(HeapTuple), compare_rows);
+
+	/*
+	 * Estimate total numbers of live and dead rows in relation, as in
+	 * acquire_sample_rows.
+	 */
+	*totalrows = floor((liverows / nblocks) * totalblocks + 0.5);
+	*totaldeadrows = floor((deadrows / nblocks) * totalblocks + 0.5);
+
+	/*
+	 * Emit some interesting relation info
+	 */
+	ereport(elevel,
+			(errmsg("\"%s\": scanned %d of %u pages, "
+					"containing %.0f live rows and %.0f dead rows; "
+					"%d rows in sample, %.0f estimated total rows",
+					RelationGetRelationName(onerel),
+					nblocks, totalblocks,
+					liverows, deadrows,
+					numrows, *totalrows)));
+
+	pfree(summaries);
+	pfree(keep);
+
+	return numrows;
+}
+
+/*
+ * parallel_analyze_sample -- sample the blocks claimed by this participant
+ *
+ * Blocks are claimed PARALLEL_ANALYZE_CHUNK_SIZE at a time, and prefetched
+ * within each chunk.
+ */
+static void
+parallel_analyze_sample(Relation onerel, AnlShared *shared,
+						BlockNumber *blocks, AnlSampleState *sstate)
+{
+	TableScanDesc scan;
+	TupleTableSlot *slot;
+#ifdef USE_PREFETCH
+	int			prefetch_maximum;
+
+	prefetch_maximum = get_tablespace_maintenance_io_concurrency(onerel->rd_rel->reltablespace);
+#endif
+
+	scan = table_beginscan_analyze(onerel);
+	slot = table_slot_create(onerel, NULL);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
+	{
+		uint32		start;
+		uint32		end;
+		uint32		i;
+
+		start = pg_atomic_fetch_add_u32(&(shared->nextblock),
+										PARALLEL_ANALYZE_CHUNK_SIZE);
+		if (start >= shared->nblocks)
+			break;
+		end = Min(start + PARALLEL_ANALYZE_CHUNK_SIZE, shared->nblocks);
+
+#ifdef USE_PREFETCH
+		for (i = start; i < Min(start + prefetch_maximum, end); i++)
+			PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM, blocks[i]);
+#endif
+
+		for (i = start; i < end; i++)
+		{
+			uint32		nblocksdone;
+
+#ifdef USE_PREFETCH
+			if (prefetch_maximum && i + prefetch_maximum < end)
+				PrefetchBuffer(scan->rs_rd, MAIN_FORKNUM,
+							   blocks[i + prefetch_maximum]);
+#endif
+
+			vacuum_delay_point();
+
+			if (table_scan_analyze_next_block(scan, blocks[i], vac_strategy))
+				sample_block_rows(scan, shared->OldestXmin, slot, sstate);
+
+			nblocksdone = pg_atomic_add_fetch_u32(&(shared->nblocksdone), 1);
+			if (!IsParallelWorker())
+				pgstat_progress_update_param(PROGRESS_ANALYZE_BLOCKS_DONE,
+											 nblocksdone);
+		}
+	}
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	ExecDropSingleTupleTableSlot(slot);
+	table_endscan(scan);
+}
+
+/*
+ * compute_stats_parallel -- compute the statistics of the columns, using
+ * parallel workers
+ *
+ * This computes the statistics of each column in vacattrstats[], the same as
+ * the serial loop in do_analyze_rel.  The statistics of columns whose
+ * typanalyze function is not parallel safe are computed by the leader, after
+ * the parallel phase.  If the copy of the sample rows wouldn't fit in
+ * maintenance_work_mem, everything is done serially.
+ */
+static void
+compute_stats_parallel(Relation onerel, int nworkers, int elevel,
+					   VacAttrStats **vacattrstats, int attr_cnt,
+					   HeapTuple *rows, int numrows, double totalrows,
+					   MemoryContext col_context)
+{
+	AnlParallelState *pstate = NULL;
+	MemoryContext old_context;
+	int		   *colmap;
+	bool	   *done;
+	int			ncolumns = 0;
+	Size		attnumssize;
+	Size		rowssize = 0;
+	int			i;
+
+	/*
+	 * Our own bookkeeping must survive the resets of col_context between
+	 * columns.
+	 */
+	old_context = MemoryContextSwitchTo(anl_context);
+
+	/* Map the columns that can be processed in parallel to vacattrstats[] */
+	colmap = (int *) palloc(attr_cnt * sizeof(int));
+	done = (bool *) palloc0(attr_cnt * sizeof(bool));
+	for (i = 0; i < attr_cnt; i++)
+	{
+		Oid			typanalyze = vacattrstats[i]->attrtype->typanalyze;
+
+		if (!OidIsValid(typanalyze) ||
+			func_parallel(typanalyze) == PROPARALLEL_SAFE)
+			colmap[ncolumns++] = i;
+	}
+
+	attnumssize = MAXALIGN(ncolumns * sizeof(AttrNumber));
+	for (i = 0; i < numrows; i++)
+		rowssize = add_size(rowssize,
+							SizeOfAnlSharedRow + MAXALIGN(rows[i]->t_len));
+
+	if (ncolumns > 1 && rowssize <= (Size) maintenance_work_mem * 1024L)
+		pstate = begin_parallel_analyze(onerel, ANL_PARALLEL_COMPUTE_STATS,
+										Min(nworkers, ncolumns - 1),
+										add_size(attnumssize, rowssize));
+
+	if (pstate != NULL)
+	{
+		AnlShared  *shared = pstate->shared;
+		AttrNumber *attnums = (AttrNumber *) pstate->data;
+		char	   *ptr = pstate->data + attnumssize;
+
+		shared->numrows = numrows;
+		shared->totalrows = totalrows;
+		shared->ncolumns = ncolumns;
+		for (i = 0; i < ncolumns; i++)
+			attnums[i] = vacattrstats[colmap[i]]->attr->attnum;
+
+		/* Copy the sample rows */
+		for (i = 0; i < numrows; i++)
+		{
+			AnlSharedRow *hdr = (AnlSharedRow *) ptr;
+
+			hdr->t_len = rows[i]->t_len;
+			hdr->t_self = rows[i]->t_self;
+			memcpy(ptr + SizeOfAnlSharedRow, rows[i]->t_data, rows[i]->t_len);
+			ptr += SizeOfAnlSharedRow + MAXALIGN(rows[i]->t_len);
+		}
+
+		launch_parallel_analyze(pstate, elevel);
+		MemoryContextSwitchTo(col_context);
+
+		/*
+		 * Join as a participant.  Between columns, pick up whatever results
+		 * the workers have sent so far, so that they don't block on a full
+		 * queue while we're busy.
+		 */
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+		for (;;)
+		{
+			uint32		colidx;
+			VacAttrStats *stats;
+
+			colidx = pg_atomic_fetch_add_u32(&(shared->nextcolumn), 1);
+			if (colidx >= ncolumns)
+				break;
+
+			stats = vacattrstats[colmap[colidx]];
+			stats->rows = rows;
+			stats->tupDesc = onerel->rd_att;
+			stats->compute_stats(stats,
+								 std_fetch_func,
+								 numrows,
+								 totalrows);
+			done[colmap[colidx]] = true;
+
+			MemoryContextResetAndDeleteChildren(col_context);
+
+			receive_attr_stats(pstate, vacattrstats, colmap, done, true);
+		}
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+		/* Wait for the remaining results */
+		receive_attr_stats(pstate, vacattrstats, colmap, done, false);
+
+		MemoryContextSwitchTo(anl_context);
+		end_parallel_analyze(pstate);
+	}
+
+	MemoryContextSwitchTo(col_context);
+
+	/* Compute the statistics of the remaining columns */
+	for (i = 0; i < attr_cnt; i++)
+	{
+		VacAttrStats *stats = vacattrstats[i];
+
+		if (done[i])
+			continue;
+
+		stats->rows = rows;
+		stats->tupDesc = onerel->rd_att;
+		stats->compute_stats(stats,
+							 std_fetch_func,
+							 numrows,
+							 totalrows);
+
+		MemoryContextResetAndDeleteChildren(col_context);
+	}
+
+	MemoryContextSwitchTo(old_context);
+
+	pfree(colmap);
+	pfree(done);
+}
+
+/*
+ * receive_attr_stats -- read the statistics sent by the workers
+ *
+ * If nowait is true, only read the messages that are already available;
+ * otherwise, read until all the workers have detached from their queues.
+ */
+static void
+receive_attr_stats(AnlParallelState *pstate, VacAttrStats **vacattrstats,
+				   int *colmap, bool *done, bool nowait)
+{
+	int			i;
+
+	for (i = 0; i < pstate->pcxt->nworkers_launched; i++)
+	{
+		while (pstate->queues[i] != NULL)
+		{
+			shm_mq_result res;
+			Size		nbytes;
+			void	   *data;
+			AnlStatsResult result;
+
+			res = shm_mq_receive(pstate->queues[i], &nbytes, &data, nowait);
+			if (res == SHM_MQ_WOULD_BLOCK)
+				break;
+			if (res == SHM_MQ_DETACHED)
+			{
+				/* the worker is done, or it failed */
+				shm_mq_detach(pstate->queues[i]);
+				pstate->queues[i] = NULL;
+				break;
+			}
+
+			Assert(nbytes >= sizeof(AnlStatsResult));
+			memcpy(&result, data, sizeof(AnlStatsResult));
+			deserialize_attr_stats(vacattrstats[colmap[result.colidx]],
+								   (char *) data);
+			done[colmap[result.colidx]] = true;
+		}
+	}
+}
+
+/*
+ * serialize_attr_stats -- flatten the statistics computed for a column into
+ * buf, for sending them to the leader
+ */
+static void
+serialize_attr_stats(VacAttrStats *stats, int colidx, StringInfo buf)
+{
+	AnlStatsResult result;
+	int			k;
+
+	MemSet(&result, 0, sizeof(AnlStatsResult));
+	result.colidx = colidx;
+	result.stats_valid = stats->stats_valid;
+	result.stanullfrac = stats->stanullfrac;
+	result.stawidth = stats->stawidth;
+	result.stadistinct = stats->stadistinct;
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		result.stakind[k] = stats->stakind[k];
+		result.staop[k] = stats->staop[k];
+		result.stacoll[k] = stats->stacoll[k];
+		result.numnumbers[k] = stats->numnumbers[k];
+		result.numvalues[k] = stats->numvalues[k];
+		result.statypid[k] = stats->statypid[k];
+		result.statyplen[k] = stats->statyplen[k];
+		result.statypbyval[k] = stats->statypbyval[k];
+		result.statypalign[k] = stats->statypalign[k];
+	}
+	appendBinaryStringInfo(buf, (char *) &result, sizeof(AnlStatsResult));
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		if (stats->numnumbers[k] > 0)
+			appendBinaryStringInfo(buf, (char *) stats->stanumbers[k],
+								   stats->numnumbers[k] * sizeof(float4));
+	}
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		int			j;
+
+		for (j = 0; j < stats->numvalues[k]; j++)
+		{
+			Datum		value = stats->stavalues[k][j];
+			Size		size;
+			char	   *ptr;
+
+			size = datumEstimateSpace(value, false, stats->statypbyval[k],
+									  stats->statyplen[k]);
+			enlargeStringInfo(buf, size);
+			ptr = buf->data + buf->len;
+			datumSerialize(value, false, stats->statypbyval[k],
+						   stats->statyplen[k], &ptr);
+			buf->len += size;
+			buf->data[buf->len] = '\0';
+		}
+	}
+}
+
+/*
+ * deserialize_attr_stats -- fill in the statistics of a column from the
+ * result sent by a worker
+ */
+static void
+deserialize_attr_stats(VacAttrStats *stats, char *data)
+{
+	AnlStatsResult result;
+	MemoryContext old_context;
+	char	   *ptr;
+	int			k;
+
+	memcpy(&result, data, sizeof(AnlStatsResult));
+	ptr = data + sizeof(AnlStatsResult);
+
+	/* The results must live as long as the VacAttrStats */
+	old_context = MemoryContextSwitchTo(stats->anl_context);
+
+	stats->stats_valid = result.stats_valid;
+	stats->stanullfrac = result.stanullfrac;
+	stats->stawidth = result.stawidth;
+	stats->stadistinct = result.stadistinct;
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		stats->stakind[k] = result.stakind[k];
+		stats->staop[k] = result.staop[k];
+		stats->stacoll[k] = result.stacoll[k];
+		stats->numnumbers[k] = result.numnumbers[k];
+		stats->numvalues[k] = result.numvalues[k];
+		stats->statypid[k] = result.statypid[k];
+		stats->statyplen[k] = result.statyplen[k];
+		stats->statypbyval[k] = result.statypbyval[k];
+		stats->statypalign[k] = result.statypalign[k];
+
+		if (result.numnumbers[k] > 0)
+		{
+			Size		size = result.numnumbers[k] * sizeof(float4);
+
+			stats->stanumbers[k] = (float4 *) palloc(size);
+			memcpy(stats->stanumbers[k], ptr, size);
+			ptr += size;
+		}
+	}
+
+	for (k = 0; k < STATISTIC_NUM_SLOTS; k++)
+	{
+		int			j;
+
+		if (result.numvalues[k] == 0)
+			continue;
+
+		stats->stavalues[k] = (Datum *)
+			palloc(result.numvalues[k] * sizeof(Datum));
+		for (j = 0; j < result.numvalues[k]; j++)
+		{
+			bool		isnull;
+
+			stats->stavalues[k][j] = datumRestore(&ptr, &isnull);
+			Assert(!isnull);
+		}
+	}
+
+	MemoryContextSwitchTo(old_context);
+}
+
+/*
+ * parallel_analyze_compute_stats -- compute the statistics of the columns
+ * claimed by this worker, and send them to the leader
+ */
+static void
+parallel_analyze_compute_stats(Relation onerel, AnlShared *shared,
+							   char *data, shm_mq_handle *mqh)
+{
+	AttrNumber *attnums = (AttrNumber *) data;
+	HeapTupleData *tuples;
+	HeapTuple  *rows;
+	MemoryContext save_anl_context = anl_context;
+	MemoryContext col_context;
+	char	   *ptr;
+	int			i;
+
+	/* Set up the sample rows, pointing into the DSM segment */
+	tuples = (HeapTupleData *) palloc(shared->numrows * sizeof(HeapTupleData));
+	rows = (HeapTuple *) palloc(shared->numrows * sizeof(HeapTuple));
+	ptr = data + MAXALIGN(shared->ncolumns * sizeof(AttrNumber));
+	for (i = 0; i < shared->numrows; i++)
+	{
+		AnlSharedRow *hdr = (AnlSharedRow *) ptr;
+
+		tuples[i].t_len = hdr->t_len;
+		tuples[i].t_self = hdr->t_self;
+		tuples[i].t_tableOid = RelationGetRelid(onerel);
+		tuples[i].t_data = (HeapTupleHeader) (ptr + SizeOfAnlSharedRow);
+		rows[i] = &tuples[i];
+		ptr += SizeOfAnlSharedRow + MAXALIGN(hdr->t_len);
+	}
+
+	/*
+	 * Everything we allocate for a column, including what the typanalyze and
+	 * compute_stats functions put in anl_context, goes away once its
+	 * statistics have been sent.
+	 */
+	col_context = AllocSetContextCreate(CurrentMemoryContext,
+										"Analyze Column",
+										ALLOCSET_DEFAULT_SIZES);
+	anl_context = col_context;
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
+	{
+		uint32		colidx;
+		VacAttrStats *stats;
+		MemoryContext old_context;
+		StringInfoData buf;
+		shm_mq_result res;
+
+		colidx = pg_atomic_fetch_add_u32(&(shared->nextcolumn), 1);
+		if (colidx >= shared->ncolumns)
+			break;
+
+		old_context = MemoryContextSwitchTo(col_context);
+
+		stats = examine_attribute(onerel, attnums[colidx], NULL);
+		if (stats == NULL)
+			elog(ERROR, "column %d of relation \"%s\" cannot be analyzed",
+				 attnums[colidx], RelationGetRelationName(onerel));
+
+		stats->rows = rows;
+		stats->tupDesc = onerel->rd_att;
+		stats->compute_stats(stats,
+							 std_fetch_func,
+							 shared->numrows,
+							 shared->totalrows);
+
+		initStringInfo(&buf);
+		serialize_attr_stats(stats, colidx, &buf);
+		res = shm_mq_send(mqh, buf.len, buf.data, false);
+
+		MemoryContextSwitchTo(old_context);
+		MemoryContextReset(col_context);
+
+		if (res != SHM_MQ_SUCCESS)
+			break;
+	}
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+
+	anl_context = save_anl_context;
+	MemoryContextDelete(col_context);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+parallel_analyze_main(dsm_segment *seg, shm_toc *toc)
+{
+	AnlShared  *shared;
+	char	   *data;
+	char	   *sharedquery;
+	char	   *queuespace;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	Relation	onerel;
+	MemoryContext old_context;
+	BufferUsage *buffer_usage;
+	WalUsage   *wal_usage;
+
+	shared = (AnlShared *) shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_SHARED,
+										  false);
+	data = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_DATA, false);
+
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/*
+	 * Open table.  The lock mode is the same as the leader process.  It's
+	 * okay because the lock mode does not conflict among the parallel
+	 * workers.
+	 */
+	onerel = table_open(shared->relid, ShareUpdateExclusiveLock);
+
+	/* Attach to the queue we send our results through */
+	queuespace = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_QUEUES, false);
+	mq = (shm_mq *) (queuespace +
+					 ParallelWorkerNumber * (Size) PARALLEL_ANALYZE_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+	mqh = shm_mq_attach(mq, seg, NULL);
+
+	/* Set cost-based vacuum delay */
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumSharedCostBalance = &(shared->cost_balance);
+	VacuumActiveNWorkers = &(shared->active_nworkers);
+
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+	anl_context = AllocSetContextCreate(CurrentMemoryContext,
+										"Analyze",
+										ALLOCSET_DEFAULT_SIZES);
+	old_context = MemoryContextSwitchTo(anl_context);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (shared->phase == ANL_PARALLEL_SAMPLE)
+	{
+		AnlSampleState sstate;
+		AnlSampleSummary summary;
+		shm_mq_result res;
+		int			i;
+
+		init_sample_state(&sstate,
+						  (HeapTuple *) palloc(shared->targrows * sizeof(HeapTuple)),
+						  shared->targrows);
+		parallel_analyze_sample(onerel, shared, (BlockNumber *) data, &sstate);
+
+		/*
+		 * Send the summary of our sample, followed by the sample itself.  The
+		 * leader detaches once it has all the rows it wants from us.
+		 */
+		summary.numrows = sstate.numrows;
+		summary.samplerows = sstate.samplerows;
+		summary.liverows = sstate.liverows;
+		summary.deadrows = sstate.deadrows;
+		res = shm_mq_send(mqh, sizeof(AnlSampleSummary), &summary, false);
+
+		for (i = 0; i < sstate.numrows && res == SHM_MQ_SUCCESS; i++)
+		{
+			HeapTuple	tuple = sstate.rows[i];
+			AnlSharedRow hdr;
+			shm_mq_iovec iov[2];
+
+			hdr.t_len = tuple->t_len;
+			hdr.t_self = tuple->t_self;
+			iov[0].data = (char *) &hdr;
+			iov[0].len = sizeof(AnlSharedRow);
+			iov[1].data = (char *) tuple->t_data;
+			iov[1].len = tuple->t_len;
+			res = shm_mq_sendv(mqh, iov, 2, false);
+		}
+	}
+	else
+		parallel_analyze_compute_stats(onerel, shared, data, mqh);
+
+	/* Report buffer/WAL usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_BUFFER_USAGE, false);
+	wal_usage = shm_toc_lookup(toc, PARALLEL_ANALYZE_KEY_WAL_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber],
+						  &wal_usage[ParallelWorkerNumber]);
+
+	shm_mq_detach(mqh);
+
+	MemoryContextSwitchTo(old_context);
+	MemoryContextDelete(anl_context);
+	anl_context = NULL;
+	FreeAccessStrategy(vac_strategy);
+
+	table_close(onerel, ShareUpdateExclusiveLock);
+}
+
+
 /*
  *	update_attstats() -- update attribute statistics for one relation
  *
@@ -26,12 +26,14 @@
 
 #include "access/heapam.h"
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_class.h"
 #include "catalog/toasting.h"
 #include "commands/createas.h"
 #include "commands/matview.h"
@@ -69,6 +71,8 @@ static ObjectAddress create_ctas_nodata(List *tlist, IntoClause *into);
 
 /* DestReceiver routines for collecting data */
 static void intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo);
+static void intorel_worker_startup(DestReceiver *self, int operation,
+								   TupleDesc typeinfo);
 static bool intorel_receive(TupleTableSlot *slot, DestReceiver *self);
 static void intorel_shutdown(DestReceiver *self);
 static void intorel_destroy(DestReceiver *self);
@@ -350,6 +354,9 @@ ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *stmt,
 		/* call ExecutorStart to prepare the plan for execution */
 		ExecutorStart(queryDesc, GetIntoRelEFlags(into));
 
+		/* let parallel workers insert their rows themselves, if possible */
+		SetupParallelIntoRel(queryDesc);
+
 		/* run the plan to completion */
 		ExecutorRun(queryDesc, ForwardScanDirection, 0L, true);
 
@@ -423,6 +430,82 @@ CreateIntoRelDestReceiver(IntoClause *intoClause)
 	return (DestReceiver *) self;
 }
 
+/*
+ * CreateParallelIntoRelDestReceiver -- create a DestReceiver for a worker
+ *
+ * In a parallel worker, the target table has already been created by the
+ * leader, so we just open it and insert into it.
+ */
+DestReceiver *
+CreateParallelIntoRelDestReceiver(Oid relid)
+{
+	DR_intorel *self = (DR_intorel *) CreateIntoRelDestReceiver(NULL);
+
+	self->pub.rStartup = intorel_worker_startup;
+	ObjectAddressSet(self->reladdr, RelationRelationId, relid);
+
+	return (DestReceiver *) self;
+}
+
+/*
+ * GetIntoRelOid -- get the OID of the table a DestReceiver is filling
+ *
+ * Only valid after the receiver has been started up.
+ */
+Oid
+GetIntoRelOid(DestReceiver *self)
+{
+	DR_intorel *myState = (DR_intorel *) self;
+
+	Assert(myState->pub.mydest == DestIntoRel);
+	Assert(myState->rel != NULL);
+
+	return RelationGetRelid(myState->rel);
+}
+
+/*
+ * SetupParallelIntoRel -- let parallel workers fill the target table
+ *
+ * If the top of the plan is a Gather that passes its input through
+ * unchanged, the workers can insert the rows they produce into the new table
+ * themselves rather than sending them to the leader.  Each worker has its
+ * own bulk-insert state and extends the relation separately.  We don't do
+ * this if the new table is temporary, since workers can't access it, or if
+ * WAL is being skipped for it, since we'd rather not depend on the workers
+ * knowing about that.
+ *
+ * Must be called after ExecutorStart and before ExecutorRun.
+ */
+void
+SetupParallelIntoRel(QueryDesc *queryDesc)
+{
+	DR_intorel *myState = (DR_intorel *) queryDesc->dest;
+	GatherState *gatherstate;
+	ListCell   *lc;
+
+	Assert(myState->pub.mydest == DestIntoRel);
+
+	if (!IsA(queryDesc->planstate, GatherState))
+		return;
+	gatherstate = (GatherState *) queryDesc->planstate;
+
+	if (gatherstate->ps.ps_ProjInfo != NULL)
+		return;
+	foreach(lc, gatherstate->ps.plan->targetlist)
+	{
+		TargetEntry *tle = lfirst_node(TargetEntry, lc);
+
+		if (tle->resjunk)
+			return;
+	}
+
+	if (myState->into->rel->relpersistence == RELPERSISTENCE_TEMP ||
+		!XLogIsNeeded())
+		return;
+
+	gatherstate->into_dest = queryDesc->dest;
+}
+
 /*
  * intorel_startup --- executor startup
  */
@@ -561,6 +644,23 @@ intorel_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
 	Assert(RelationGetTargetBlock(intoRelationDesc) == InvalidBlockNumber);
 }
 
+/*
+ * intorel_worker_startup --- executor startup in a parallel worker
+ */
+static void
+intorel_worker_startup(DestReceiver *self, int operation, TupleDesc typeinfo)
+{
+	DR_intorel *myState = (DR_intorel *) self;
+
+	Assert(IsParallelWorker());
+
+	/* The leader holds AccessExclusiveLock, which doesn't conflict with us */
+	myState->rel = table_open(myState->reladdr.objectId, RowExclusiveLock);
+	myState->output_cid = GetCurrentCommandId(true);
+	myState->ti_options = TABLE_INSERT_SKIP_FSM;
+	myState->bistate = GetBulkInsertState();
+}
+
 /*
  * intorel_receive --- receive one tuple
  */
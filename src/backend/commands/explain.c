@@ -567,6 +567,10 @@ ExplainOnePlan(PlannedStmt *plannedstmt, IntoClause *into, ExplainState *es,
 		else
 			dir = ForwardScanDirection;
 
+		/* let parallel workers fill the new table, as CREATE TABLE AS does */
+		if (into && !into->skipData)
+			SetupParallelIntoRel(queryDesc);
+
 		/* run the plan */
 		ExecutorRun(queryDesc, dir, 0L, true);
 
@@ -1926,6 +1930,14 @@ ExplainNode(PlanState *planstate, List *ancestors,
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
 			break;
+		case T_WindowAgg:
+			show_upper_qual(((WindowAgg *) plan)->runCondition,
+							"Run Condition", planstate, ancestors, es);
+			show_upper_qual(plan->qual, "Filter", planstate, ancestors, es);
+			if (plan->qual)
+				show_instrumentation_count("Rows Removed by Filter", 1,
+										   planstate, es);
+			break;
 		case T_Sort:
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
@@ -2985,6 +2997,8 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 											  worker_hi->nbatch_original);
 			hinstrument.space_peak = Max(hinstrument.space_peak,
 										 worker_hi->space_peak);
+			hinstrument.nstripes = Max(hinstrument.nstripes,
+									   worker_hi->nstripes);
 		}
 	}
 
@@ -3004,6 +3018,8 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 								   hinstrument.nbatch_original, es);
 			ExplainPropertyInteger("Peak Memory Usage", "kB",
 								   spacePeakKb, es);
+			ExplainPropertyInteger("Hash Stripes", NULL,
+								   hinstrument.nstripes, es);
 		}
 		else if (hinstrument.nbatch_original != hinstrument.nbatch ||
 				 hinstrument.nbuckets_original != hinstrument.nbuckets)
@@ -3025,6 +3041,14 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 							 hinstrument.nbuckets, hinstrument.nbatch,
 							 spacePeakKb);
 		}
+
+		/* Mention stripes only if some batch had to be joined in stripes. */
+		if (es->format == EXPLAIN_FORMAT_TEXT && hinstrument.nstripes > 1)
+		{
+			ExplainIndentText(es);
+			appendStringInfo(es->str, "Stripes: %d\n",
+							 hinstrument.nstripes);
+		}
 	}
 }
 
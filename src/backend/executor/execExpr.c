@@ -57,12 +57,34 @@ typedef struct LastAttnumInfo
 	AttrNumber	last_scan;
 } LastAttnumInfo;
 
+typedef struct CSECandidates
+{
+	List	   *exprs;			/* distinct candidate subexpressions */
+	List	   *counts;			/* integer list of their occurrence counts */
+} CSECandidates;
+
+/*
+ * Don't look for common subexpressions among more than this many distinct
+ * candidates, to bound the cost of comparing them in huge expressions.
+ */
+#define MAX_CSE_CANDIDATES	256
+
 static void ExecReadyExpr(ExprState *state);
 static void ExecInitExprRec(Expr *node, ExprState *state,
 							Datum *resv, bool *resnull);
 static void ExecInitFunc(ExprEvalStep *scratch, Expr *node, List *args,
 						 Oid funcid, Oid inputcollid,
 						 ExprState *state);
+static bool ExecInitCommonSubexpr(Expr *node, ExprState *state,
+								  Datum *resv, bool *resnull);
+static ExprCSECache *ExecBuildCSECache(Node *node);
+static ExprCSECache *ExecGetPlanCSECache(PlanState *parent);
+static void ExecPushCSEReset(ExprState *state, ExprCSECache *cache,
+							 bool keep_fresh);
+static bool cse_candidates_walker(Node *node, CSECandidates *context);
+static bool cse_unsafe_walker(Node *node, void *context);
+static List *ExecFindDetoastVars(Node *node);
+static bool detoast_vars_walker(Node *node, List **vars);
 static void ExecInitExprSlots(ExprState *state, Node *node);
 static void ExecPushExprSlots(ExprState *state, LastAttnumInfo *info);
 static bool get_last_attnums_walker(Node *node, LastAttnumInfo *info);
@@ -212,6 +234,7 @@ ExecInitQual(List *qual, PlanState *parent)
 	ExprEvalStep scratch = {0};
 	List	   *adjust_jumps = NIL;
 	ListCell   *lc;
+	bool		shared_cse = false;
 
 	/* short-circuit (here and in ExecQual) for empty restriction list */
 	if (qual == NIL)
@@ -230,6 +253,30 @@ ExecInitQual(List *qual, PlanState *parent)
 	/* Insert EEOP_*_FETCHSOME steps as needed */
 	ExecInitExprSlots(state, (Node *) qual);
 
+	/*
+	 * Look for common subexpressions.  A plan node's own qual shares them
+	 * with the node's projection, which is evaluated right after the qual
+	 * passes.
+	 */
+	if (parent != NULL && parent->plan != NULL &&
+		qual == parent->plan->qual)
+	{
+		state->cse_cache = ExecGetPlanCSECache(parent);
+		shared_cse = true;
+	}
+	else
+		state->cse_cache = ExecBuildCSECache((Node *) qual);
+	if (state->cse_cache != NULL)
+		ExecPushCSEReset(state, state->cse_cache, false);
+
+	/* Likewise, look for toasted columns worth detoasting only once */
+	if (shared_cse)
+		state->detoast_vars =
+			ExecFindDetoastVars((Node *) list_make2(parent->plan->qual,
+													parent->plan->targetlist));
+	else
+		state->detoast_vars = ExecFindDetoastVars((Node *) qual);
+
 	/*
 	 * ExecQual() needs to return false for an expression returning NULL. That
 	 * allows us to short-circuit the evaluation the first time a NULL is
@@ -259,6 +306,19 @@ ExecInitQual(List *qual, PlanState *parent)
 								   state->steps_len - 1);
 	}
 
+	/*
+	 * If the qual passes, let the projection know that it can use the values
+	 * of the common subexpressions computed so far.  A failing qual jumps
+	 * past this step.
+	 */
+	if (shared_cse && state->cse_cache != NULL)
+	{
+		scratch.opcode = EEOP_CSE_MARK_FRESH;
+		scratch.d.cse_reset.cache = state->cse_cache;
+		scratch.d.cse_reset.keep_fresh = false;
+		ExprEvalPushStep(state, &scratch);
+	}
+
 	/* adjust jump targets */
 	foreach(lc, adjust_jumps)
 	{
@@ -374,6 +434,29 @@ ExecBuildProjectionInfo(List *targetList,
 	/* Insert EEOP_*_FETCHSOME steps as needed */
 	ExecInitExprSlots(state, (Node *) targetList);
 
+	/*
+	 * Look for common subexpressions.  A plan node's own projection can
+	 * reuse the ones its qual has computed for the same row.
+	 */
+	if (parent != NULL && parent->plan != NULL &&
+		targetList == parent->plan->targetlist)
+	{
+		state->cse_cache = ExecGetPlanCSECache(parent);
+		if (state->cse_cache != NULL)
+			ExecPushCSEReset(state, state->cse_cache,
+							 parent->plan->qual != NIL);
+		state->detoast_vars =
+			ExecFindDetoastVars((Node *) list_make2(parent->plan->qual,
+													targetList));
+	}
+	else
+	{
+		state->cse_cache = ExecBuildCSECache((Node *) targetList);
+		if (state->cse_cache != NULL)
+			ExecPushCSEReset(state, state->cse_cache, false);
+		state->detoast_vars = ExecFindDetoastVars((Node *) targetList);
+	}
+
 	/* Now compile each tlist column */
 	foreach(lc, targetList)
 	{
@@ -656,6 +739,11 @@ ExecInitExprRec(Expr *node, ExprState *state,
 	scratch.resvalue = resv;
 	scratch.resnull = resnull;
 
+	/* Compute common subexpressions only once */
+	if (state->cse_cache != NULL &&
+		ExecInitCommonSubexpr(node, state, resv, resnull))
+		return;
+
 	/* cases should be ordered as they are in enum NodeTag */
 	switch (nodeTag(node))
 	{
@@ -712,6 +800,19 @@ ExecInitExprRec(Expr *node, ExprState *state,
 				}
 
 				ExprEvalPushStep(state, &scratch);
+
+				/*
+				 * If the column's value is needed by several functions, have
+				 * it detoasted only once per row; see ExecFindDetoastVars.
+				 */
+				if (variable->varattno > 0 &&
+					list_member_ptr(state->detoast_vars, variable))
+				{
+					scratch.opcode = EEOP_VAR_DETOAST;
+					scratch.d.var_detoast.attnum = variable->varattno - 1;
+					scratch.d.var_detoast.varno = variable->varno;
+					ExprEvalPushStep(state, &scratch);
+				}
 				break;
 			}
 
@@ -2098,6 +2199,307 @@ ExecInitExprRec(Expr *node, ExprState *state,
 	}
 }
 
+/*
+ * If node is one of the common subexpressions of the expression being
+ * compiled, append the steps to evaluate it only if its value isn't known
+ * yet, and return true.  Otherwise return false, and do nothing.
+ *
+ * Every occurrence of a common subexpression is compiled in full, because we
+ * can't know at compile time which occurrence will be reached first.  At run
+ * time, EEOP_CSE_FETCH skips the evaluation if an earlier occurrence has
+ * already computed the value for the current row, and EEOP_CSE_STORE saves
+ * the value otherwise.
+ */
+static bool
+ExecInitCommonSubexpr(Expr *node, ExprState *state,
+					  Datum *resv, bool *resnull)
+{
+	ExprCSECache *cache = state->cse_cache;
+	ExprEvalStep scratch = {0};
+	int			cseno;
+	int			fetchstep;
+
+	for (cseno = 0; cseno < cache->ncse; cseno++)
+	{
+		if (!cache->compiling[cseno] && equal(node, cache->exprs[cseno]))
+			break;
+	}
+	if (cseno >= cache->ncse)
+		return false;
+
+	scratch.opcode = EEOP_CSE_FETCH;
+	scratch.resvalue = resv;
+	scratch.resnull = resnull;
+	scratch.d.cse.cache = cache;
+	scratch.d.cse.cseno = cseno;
+	scratch.d.cse.typlen = get_typlen(exprType((Node *) node));
+	scratch.d.cse.jumpdone = -1;	/* adjust later */
+	ExprEvalPushStep(state, &scratch);
+	fetchstep = state->steps_len - 1;
+
+	/* compile the subexpression itself, without finding it again */
+	cache->compiling[cseno] = true;
+	ExecInitExprRec(node, state, resv, resnull);
+	cache->compiling[cseno] = false;
+
+	scratch.opcode = EEOP_CSE_STORE;
+	ExprEvalPushStep(state, &scratch);
+
+	state->steps[fetchstep].d.cse.jumpdone = state->steps_len;
+
+	return true;
+}
+
+/*
+ * Find the common subexpressions of an expression tree (or list of them),
+ * and set up a cache for their values.  Returns NULL if there are none.
+ *
+ * Only function and operator calls are considered, and only if they are
+ * immutable, don't return a set, and don't depend on anything but the
+ * current row; see cse_unsafe_walker.
+ */
+static ExprCSECache *
+ExecBuildCSECache(Node *node)
+{
+	CSECandidates context;
+	ExprCSECache *cache;
+	ListCell   *lc1;
+	ListCell   *lc2;
+	int			ncse = 0;
+
+	context.exprs = NIL;
+	context.counts = NIL;
+	(void) cse_candidates_walker(node, &context);
+
+	foreach(lc1, context.counts)
+	{
+		if (lfirst_int(lc1) > 1)
+			ncse++;
+	}
+	if (ncse == 0)
+	{
+		list_free(context.exprs);
+		list_free(context.counts);
+		return NULL;
+	}
+
+	cache = palloc0(sizeof(ExprCSECache));
+	cache->ncse = ncse;
+	cache->exprs = palloc(sizeof(Expr *) * ncse);
+	cache->compiling = palloc0(sizeof(bool) * ncse);
+	cache->values = palloc0(sizeof(Datum) * ncse);
+	cache->nulls = palloc0(sizeof(bool) * ncse);
+	cache->generations = palloc0(sizeof(uint64) * ncse);
+	cache->generation = 1;
+	cache->fresh = false;
+
+	ncse = 0;
+	forboth(lc1, context.exprs, lc2, context.counts)
+	{
+		if (lfirst_int(lc2) > 1)
+			cache->exprs[ncse++] = (Expr *) lfirst(lc1);
+	}
+
+	list_free(context.exprs);
+	list_free(context.counts);
+
+	return cache;
+}
+
+/*
+ * Get the cache of common subexpressions shared by a plan node's qual and
+ * projection, building it on first use.
+ */
+static ExprCSECache *
+ExecGetPlanCSECache(PlanState *parent)
+{
+	Plan	   *plan = parent->plan;
+
+	if (parent->ps_CSECache == NULL)
+		parent->ps_CSECache =
+			ExecBuildCSECache((Node *) list_make2(plan->qual,
+												  plan->targetlist));
+
+	return parent->ps_CSECache;
+}
+
+/*
+ * Append a step that starts a new generation of common subexpression
+ * values, unless keep_fresh is true and a qual sharing the cache has just
+ * passed.
+ */
+static void
+ExecPushCSEReset(ExprState *state, ExprCSECache *cache, bool keep_fresh)
+{
+	ExprEvalStep scratch = {0};
+
+	scratch.opcode = EEOP_CSE_RESET;
+	scratch.d.cse_reset.cache = cache;
+	scratch.d.cse_reset.keep_fresh = keep_fresh;
+	ExprEvalPushStep(state, &scratch);
+}
+
+/*
+ * Count the occurrences of each candidate common subexpression.
+ */
+static bool
+cse_candidates_walker(Node *node, CSECandidates *context)
+{
+	if (node == NULL)
+		return false;
+
+	/* The arguments of these are not evaluated as part of the expression */
+	if (IsA(node, Aggref) ||
+		IsA(node, WindowFunc) ||
+		IsA(node, GroupingFunc) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan))
+		return false;
+
+	if ((IsA(node, FuncExpr) && !((FuncExpr *) node)->funcretset) ||
+		(IsA(node, OpExpr) && !((OpExpr *) node)->opretset))
+	{
+		ListCell   *lc1;
+		ListCell   *lc2;
+		bool		found = false;
+
+		forboth(lc1, context->exprs, lc2, context->counts)
+		{
+			if (equal(node, lfirst(lc1)))
+			{
+				lfirst_int(lc2)++;
+				found = true;
+				break;
+			}
+		}
+
+		if (!found &&
+			list_length(context->exprs) < MAX_CSE_CANDIDATES &&
+			!cse_unsafe_walker(node, NULL) &&
+			!contain_mutable_functions(node))
+		{
+			context->exprs = lappend(context->exprs, node);
+			context->counts = lappend_int(context->counts, 1);
+		}
+	}
+
+	return expression_tree_walker(node, cse_candidates_walker,
+								  (void *) context);
+}
+
+/*
+ * Does the expression depend on anything but the current row, or contain
+ * anything we'd rather not skip?
+ *
+ * The value of a CaseTestExpr or CoerceToDomainValue depends on the
+ * enclosing expression, so two equal subexpressions containing one needn't
+ * have the same value.  We leave subplans alone, because the volatility of
+ * what they contain isn't known here.
+ */
+static bool
+cse_unsafe_walker(Node *node, void *context)
+{
+	if (node == NULL)
+		return false;
+
+	if (IsA(node, CaseTestExpr) ||
+		IsA(node, CoerceToDomainValue) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan))
+		return true;
+
+	return expression_tree_walker(node, cse_unsafe_walker, context);
+}
+
+/*
+ * Find the Vars of varlena type that are passed to functions or operators,
+ * in an expression tree (or list of them), and return those referring to
+ * a column that is passed more than once.
+ *
+ * Each function detoasts its toasted arguments on its own, so if a column
+ * holding a large toasted value is passed to several functions, it would be
+ * fetched and decompressed over and over.  For the Vars returned here,
+ * EEOP_VAR_DETOAST substitutes a detoasted copy that is cached in the source
+ * slot, so that all of them share a single detoasting per row.
+ */
+static List *
+ExecFindDetoastVars(Node *node)
+{
+	List	   *vars = NIL;
+	List	   *result = NIL;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	(void) detoast_vars_walker(node, &vars);
+
+	foreach(lc1, vars)
+	{
+		Var		   *var1 = (Var *) lfirst(lc1);
+
+		foreach(lc2, vars)
+		{
+			Var		   *var2 = (Var *) lfirst(lc2);
+
+			if (var1 != var2 &&
+				var1->varno == var2->varno &&
+				var1->varattno == var2->varattno)
+			{
+				result = lappend(result, var1);
+				break;
+			}
+		}
+	}
+
+	list_free(vars);
+
+	return result;
+}
+
+/*
+ * Collect the Vars of varlena type that are direct arguments of function or
+ * operator calls.
+ */
+static bool
+detoast_vars_walker(Node *node, List **vars)
+{
+	List	   *args = NIL;
+	ListCell   *lc;
+
+	if (node == NULL)
+		return false;
+
+	/* The arguments of these are not evaluated as part of the expression */
+	if (IsA(node, Aggref) ||
+		IsA(node, WindowFunc) ||
+		IsA(node, GroupingFunc) ||
+		IsA(node, SubPlan) ||
+		IsA(node, AlternativeSubPlan))
+		return false;
+
+	if (IsA(node, FuncExpr))
+		args = ((FuncExpr *) node)->args;
+	else if (IsA(node, OpExpr) ||
+			 IsA(node, DistinctExpr) ||
+			 IsA(node, NullIfExpr))
+		args = ((OpExpr *) node)->args;
+	else if (IsA(node, ScalarArrayOpExpr))
+		args = ((ScalarArrayOpExpr *) node)->args;
+
+	foreach(lc, args)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (IsA(var, Var) &&
+			var->varattno > 0 &&
+			var->varlevelsup == 0 &&
+			get_typlen(var->vartype) == -1)
+			*vars = lappend(*vars, var);
+	}
+
+	return expression_tree_walker(node, detoast_vars_walker,
+								  (void *) vars);
+}
+
 /*
  * Add another expression evaluation step to ExprState->steps.
  *
@@ -366,6 +366,7 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_OUTER_SYSVAR,
 		&&CASE_EEOP_SCAN_SYSVAR,
 		&&CASE_EEOP_WHOLEROW,
+		&&CASE_EEOP_VAR_DETOAST,
 		&&CASE_EEOP_ASSIGN_INNER_VAR,
 		&&CASE_EEOP_ASSIGN_OUTER_VAR,
 		&&CASE_EEOP_ASSIGN_SCAN_VAR,
@@ -431,6 +432,10 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 		&&CASE_EEOP_GROUPING_FUNC,
 		&&CASE_EEOP_WINDOW_FUNC,
 		&&CASE_EEOP_SUBPLAN,
+		&&CASE_EEOP_CSE_RESET,
+		&&CASE_EEOP_CSE_MARK_FRESH,
+		&&CASE_EEOP_CSE_FETCH,
+		&&CASE_EEOP_CSE_STORE,
 		&&CASE_EEOP_AGG_STRICT_DESERIALIZE,
 		&&CASE_EEOP_AGG_DESERIALIZE,
 		&&CASE_EEOP_AGG_STRICT_INPUT_CHECK_ARGS,
@@ -570,6 +575,13 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_VAR_DETOAST)
+		{
+			ExecEvalVarDetoast(state, op, econtext);
+
+			EEO_NEXT();
+		}
+
 		EEO_CASE(EEOP_ASSIGN_INNER_VAR)
 		{
 			int			resultnum = op->d.assign_var.resultnum;
@@ -1535,6 +1547,36 @@ ExecInterpExpr(ExprState *state, ExprContext *econtext, bool *isnull)
 			EEO_NEXT();
 		}
 
+		EEO_CASE(EEOP_CSE_RESET)
+		{
+			ExecEvalCSEReset(state, op);
+
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CSE_MARK_FRESH)
+		{
+			ExecEvalCSEMarkFresh(state, op);
+
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CSE_FETCH)
+		{
+			/* skip evaluating the subexpression if its value is known */
+			if (ExecEvalCSEFetch(state, op))
+				EEO_JUMP(op->d.cse.jumpdone);
+
+			EEO_NEXT();
+		}
+
+		EEO_CASE(EEOP_CSE_STORE)
+		{
+			ExecEvalCSEStore(state, op);
+
+			EEO_NEXT();
+		}
+
 		/* evaluate a strict aggregate deserialization function */
 		EEO_CASE(EEOP_AGG_STRICT_DESERIALIZE)
 		{
@@ -3859,6 +3901,110 @@ ExecEvalSubPlan(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
 	*op->resvalue = ExecSubPlan(sstate, econtext, op->resnull);
 }
 
+/*
+ * Start a new generation of common subexpression values, i.e. forget the
+ * values computed for the previous row.
+ *
+ * If keep_fresh is set, a qual sharing the cache may just have computed
+ * values for the current row; in that case keep them.
+ */
+void
+ExecEvalCSEReset(ExprState *state, ExprEvalStep *op)
+{
+	ExprCSECache *cache = op->d.cse_reset.cache;
+
+	if (!op->d.cse_reset.keep_fresh || !cache->fresh)
+		cache->generation++;
+	cache->fresh = false;
+}
+
+/*
+ * Record that a qual sharing its common subexpression values with a
+ * projection has passed.
+ */
+void
+ExecEvalCSEMarkFresh(ExprState *state, ExprEvalStep *op)
+{
+	op->d.cse_reset.cache->fresh = true;
+}
+
+/*
+ * If the value of a common subexpression has been computed for the current
+ * row, return it and return true.  Otherwise return false.
+ */
+bool
+ExecEvalCSEFetch(ExprState *state, ExprEvalStep *op)
+{
+	ExprCSECache *cache = op->d.cse.cache;
+	int			cseno = op->d.cse.cseno;
+
+	if (cache->generations[cseno] != cache->generation)
+		return false;
+
+	*op->resvalue = cache->values[cseno];
+	*op->resnull = cache->nulls[cseno];
+	return true;
+}
+
+/*
+ * Remember the value of a common subexpression for the current row.
+ *
+ * As the value will be used more than once, it must not be a read-write
+ * expanded object that a consumer might modify in place.
+ */
+void
+ExecEvalCSEStore(ExprState *state, ExprEvalStep *op)
+{
+	ExprCSECache *cache = op->d.cse.cache;
+	int			cseno = op->d.cse.cseno;
+
+	*op->resvalue = MakeExpandedObjectReadOnly(*op->resvalue,
+											   *op->resnull,
+											   op->d.cse.typlen);
+	cache->values[cseno] = *op->resvalue;
+	cache->nulls[cseno] = *op->resnull;
+	cache->generations[cseno] = cache->generation;
+}
+
+/*
+ * Replace the value of a Var just fetched from a slot with a detoasted copy
+ * cached in the slot, if the value is stored out of line or compressed.
+ *
+ * The copy is made on first use for the slot's current tuple; other
+ * references to the same column reuse it.
+ */
+void
+ExecEvalVarDetoast(ExprState *state, ExprEvalStep *op, ExprContext *econtext)
+{
+	TupleTableSlot *slot;
+	struct varlena *value;
+
+	if (*op->resnull)
+		return;
+
+	value = (struct varlena *) DatumGetPointer(*op->resvalue);
+	if (!VARATT_IS_EXTERNAL_ONDISK(value) && !VARATT_IS_COMPRESSED(value))
+		return;
+
+	switch (op->d.var_detoast.varno)
+	{
+		case INNER_VAR:
+			slot = econtext->ecxt_innertuple;
+			break;
+		case OUTER_VAR:
+			slot = econtext->ecxt_outertuple;
+			break;
+
+			/* INDEX_VAR is handled by default case */
+
+		default:
+			slot = econtext->ecxt_scantuple;
+			break;
+	}
+
+	*op->resvalue = slot_detoast_attr(slot, op->d.var_detoast.attnum + 1);
+}
+
 /*
  * Evaluate a wholerow Var expression.
  *
@@ -7,7 +7,8 @@
  * ExecInsertIndexTuples() is the main entry point.  It's called after
  * inserting a tuple to the heap, and it inserts corresponding index tuples
  * into all indexes.  At the same time, it enforces any unique and
- * exclusion constraints:
+ * exclusion constraints.  ExecUpdateIndexTuples() is its counterpart for
+ * updated tuples, which may only need entries in some of the indexes:
  *
  * Unique Indexes
  * --------------
@@ -108,6 +109,7 @@
 
 #include "access/genam.h"
 #include "access/relscan.h"
+#include "access/sysattr.h"
 #include "access/tableam.h"
 #include "access/xact.h"
 #include "catalog/index.h"
@@ -136,6 +138,16 @@ static bool check_exclusion_or_unique_constraint(Relation heap, Relation index,
 static bool index_recheck_constraint(Relation index, Oid *constr_procs,
 									 Datum *existing_values, bool *existing_isnull,
 									 Datum *new_values);
+static List *ExecInsertIndexTuplesInternal(ResultRelInfo *resultRelInfo,
+										   TupleTableSlot *slot,
+										   ItemPointer tupleid,
+										   Bitmapset *modifiedAttrs,
+										   EState *estate,
+										   bool noDupErr,
+										   bool *specConflict,
+										   List *arbiterIndexes);
+static bool IndexHasModifiedAttrs(IndexInfo *indexInfo,
+								  Bitmapset *modifiedAttrs);
 
 /* ----------------------------------------------------------------
  *		ExecOpenIndices
@@ -264,9 +276,8 @@ ExecCloseIndices(ResultRelInfo *resultRelInfo)
  *		If 'arbiterIndexes' is nonempty, noDupErr applies only to
  *		those indexes.  NIL means noDupErr applies to all indexes.
  *
- *		CAUTION: this must not be called for a HOT update.
- *		We can't defend against that here for lack of info.
- *		Should we change the API to make it safer?
+ *		CAUTION: this must not be called for a HOT or WARM update;
+ *		use ExecUpdateIndexTuples for updates.
  * ----------------------------------------------------------------
  */
 List *
@@ -277,7 +288,54 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 					  bool *specConflict,
 					  List *arbiterIndexes)
 {
-	ItemPointer tupleid = &slot->tts_tid;
+	return ExecInsertIndexTuplesInternal(resultRelInfo, slot, &slot->tts_tid,
+										 NULL, estate, noDupErr,
+										 specConflict, arbiterIndexes);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecUpdateIndexTuples
+ *
+ *		Inserts the index tuples that table_tuple_update() asked
+ *		for in *update, after updating a tuple of the result
+ *		relation.  Returns a list of index OIDs to recheck, like
+ *		ExecInsertIndexTuples.
+ * ----------------------------------------------------------------
+ */
+List *
+ExecUpdateIndexTuples(ResultRelInfo *resultRelInfo,
+					  TupleTableSlot *slot,
+					  EState *estate,
+					  TU_IndexUpdate *update)
+{
+	Assert(update->required);
+
+	/* A WARM update only needs entries in indexes on modified columns */
+	if (update->modified_attrs != NULL)
+		return ExecInsertIndexTuplesInternal(resultRelInfo, slot,
+											 &update->root_tid,
+											 update->modified_attrs,
+											 estate, false, NULL, NIL);
+
+	return ExecInsertIndexTuplesInternal(resultRelInfo, slot, &slot->tts_tid,
+										 NULL, estate, false, NULL, NIL);
+}
+
+/*
+ * Workhorse of ExecInsertIndexTuples and ExecUpdateIndexTuples: the index
+ * entries point to tupleid, and if modifiedAttrs is not NULL, only indexes
+ * on any of those columns get one.
+ */
+static List *
+ExecInsertIndexTuplesInternal(ResultRelInfo *resultRelInfo,
+							  TupleTableSlot *slot,
+							  ItemPointer tupleid,
+							  Bitmapset *modifiedAttrs,
+							  EState *estate,
+							  bool noDupErr,
+							  bool *specConflict,
+							  List *arbiterIndexes)
+{
 	List	   *result = NIL;
 	int			i;
 	int			numIndices;
@@ -330,6 +388,11 @@ ExecInsertIndexTuples(ResultRelInfo *resultRelInfo,
 		if (!indexInfo->ii_ReadyForInserts)
 			continue;
 
+		/* Skip indexes whose key the update didn't change */
+		if (modifiedAttrs != NULL &&
+			!IndexHasModifiedAttrs(indexInfo, modifiedAttrs))
+			continue;
+
 		/* Check for partial index */
 		if (indexInfo->ii_Predicate != NIL)
 		{
@@ -899,3 +962,27 @@ index_recheck_constraint(Relation index, Oid *constr_procs,
 
 	return true;
 }
+
+/*
+ * Does the index use any of the given columns?
+ *
+ * WARM updates are never done when columns used in index expressions or
+ * predicates change, so looking at the plain columns is enough.
+ */
+static bool
+IndexHasModifiedAttrs(IndexInfo *indexInfo, Bitmapset *modifiedAttrs)
+{
+	int			i;
+
+	for (i = 0; i < indexInfo->ii_NumIndexAttrs; i++)
+	{
+		AttrNumber	attnum = indexInfo->ii_IndexAttrNumbers[i];
+
+		if (attnum != 0 &&
+			bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber,
+						  modifiedAttrs))
+			return true;
+	}
+
+	return false;
+}
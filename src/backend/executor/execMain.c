@@ -38,6 +38,7 @@
 #include "postgres.h"
 
 #include "access/heapam.h"
+#include "access/parallel.h"
 #include "access/htup_details.h"
 #include "access/sysattr.h"
 #include "access/tableam.h"
@@ -53,6 +54,8 @@
 #include "jit/jit.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "optimizer/feedback.h"
+#include "optimizer/optimizer.h"
 #include "parser/parsetree.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
@@ -80,6 +83,8 @@ static void InitPlan(QueryDesc *queryDesc, int eflags);
 static void CheckValidRowMarkRel(Relation rel, RowMarkType markType);
 static void ExecPostprocessPlan(EState *estate);
 static void ExecEndPlan(PlanState *planstate, EState *estate);
+static Bitmapset *find_replan_checkpoints(Plan *plan, Bitmapset *result);
+static void ExecReplan(QueryDesc *queryDesc);
 static void ExecutePlan(EState *estate, PlanState *planstate,
 						bool use_parallel_mode,
 						CmdType operation,
@@ -265,6 +270,15 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	 */
 	InitPlan(queryDesc, eflags);
 
+	/*
+	 * If the planner made it possible, find the places where we may decide to
+	 * re-plan the query.
+	 */
+	if (queryDesc->plannedstmt->reoptQuery != NULL &&
+		!(eflags & EXEC_FLAG_EXPLAIN_ONLY))
+		estate->es_replan_checkpoints =
+			find_replan_checkpoints(queryDesc->plannedstmt->planTree, NULL);
+
 	MemoryContextSwitchTo(oldcontext);
 }
 
@@ -370,6 +384,25 @@ standard_ExecutorRun(QueryDesc *queryDesc,
 					direction,
 					dest,
 					execute_once);
+
+		/*
+		 * If a cardinality checkpoint found the planner's estimates to be far
+		 * off before we returned any row, start over with a new plan.
+		 */
+		if (estate->es_replan_requested)
+		{
+			ExecReplan(queryDesc);
+
+			ExecutePlan(estate,
+						queryDesc->planstate,
+						queryDesc->plannedstmt->parallelModeNeeded,
+						operation,
+						sendTuples,
+						count,
+						direction,
+						dest,
+						execute_once);
+		}
 	}
 
 	/*
@@ -499,6 +532,10 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	UnregisterSnapshot(estate->es_snapshot);
 	UnregisterSnapshot(estate->es_crosscheck_snapshot);
 
+	/* If we re-planned the query, give back the plan we were given */
+	if (estate->es_original_stmt != NULL)
+		queryDesc->plannedstmt = estate->es_original_stmt;
+
 	/*
 	 * Must switch out of context before destroying it
 	 */
@@ -790,6 +827,15 @@ ExecCheckXactReadOnly(PlannedStmt *plannedstmt)
 		PreventCommandIfReadOnly(CreateCommandName((Node *) plannedstmt));
 	}
 
+	/*
+	 * A parallel-aware ModifyTable is what a worker runs to take part in a
+	 * parallel INSERT; the leader has set up the transaction for it.
+	 */
+	if (IsParallelWorker() &&
+		IsA(plannedstmt->planTree, ModifyTable) &&
+		plannedstmt->planTree->parallel_aware)
+		return;
+
 	if (plannedstmt->commandType != CMD_SELECT || plannedstmt->hasModifyingCTE)
 		PreventCommandIfParallelMode(CreateCommandName((Node *) plannedstmt));
 }
@@ -1248,6 +1294,8 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	resultRelInfo->ri_PartitionTupleSlot = NULL;	/* ditto */
 	resultRelInfo->ri_ChildToRootMap = NULL;
 	resultRelInfo->ri_CopyMultiInsertBuffer = NULL;
+	resultRelInfo->ri_Slots = NULL;
+	resultRelInfo->ri_NumSlots = 0;
 }
 
 /*
@@ -1481,6 +1529,166 @@ ExecCloseRangeTableRelations(EState *estate)
 	}
 }
 
+/*
+ * find_replan_checkpoints
+ *		Find the cardinality checkpoints that may cause the query to be
+ *		re-planned, and add their plan_node_ids to 'result'.
+ *
+ * A checkpoint can only ask for that before the first row comes out of the
+ * plan, and re-planning throws away all the work done until then.  So we
+ * only consider checkpoints that are reached from the top of the plan
+ * through nodes that return rows as soon as they get them: the Hash under a
+ * hash join, and the Sort under a merge join.  A checkpoint underneath an
+ * aggregate, say, would only be noticed after the whole input has been
+ * aggregated.
+ */
+static Bitmapset *
+find_replan_checkpoints(Plan *plan, Bitmapset *result)
+{
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return result;
+
+	switch (nodeTag(plan))
+	{
+		case T_HashJoin:
+			result = bms_add_member(result, innerPlan(plan)->plan_node_id);
+			result = find_replan_checkpoints(outerPlan(plan), result);
+			break;
+
+		case T_MergeJoin:
+			if (IsA(outerPlan(plan), Sort))
+				result = bms_add_member(result, outerPlan(plan)->plan_node_id);
+			else
+				result = find_replan_checkpoints(outerPlan(plan), result);
+			if (IsA(innerPlan(plan), Sort))
+				result = bms_add_member(result, innerPlan(plan)->plan_node_id);
+			else
+				result = find_replan_checkpoints(innerPlan(plan), result);
+			break;
+
+		case T_NestLoop:
+			result = find_replan_checkpoints(outerPlan(plan), result);
+			result = find_replan_checkpoints(innerPlan(plan), result);
+			break;
+
+		case T_Result:
+		case T_ProjectSet:
+		case T_Limit:
+		case T_Material:
+		case T_Unique:
+		case T_Gather:
+			result = find_replan_checkpoints(outerPlan(plan), result);
+			break;
+
+		case T_SubqueryScan:
+			result = find_replan_checkpoints(((SubqueryScan *) plan)->subplan,
+											 result);
+			break;
+
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+				result = find_replan_checkpoints((Plan *) lfirst(lc), result);
+			break;
+
+		default:
+			/* scans, and nodes that consume their input before returning */
+			break;
+	}
+
+	return result;
+}
+
+/*
+ * ExecReplan
+ *		Throw away the current plan and plan the query again, using the
+ *		cardinality feedback collected so far.
+ *
+ * This is called when a cardinality checkpoint found the planner's estimates
+ * to be far off before the query returned any row, so the caller can simply
+ * start executing the new plan; nobody can tell the difference, as the
+ * planner only allows this for queries without side-effects.  The new plan
+ * lives in the per-query memory context; the original one is put back into
+ * the QueryDesc by ExecutorEnd.
+ */
+static void
+ExecReplan(QueryDesc *queryDesc)
+{
+	EState	   *estate = queryDesc->estate;
+	PlannedStmt *oldstmt = queryDesc->plannedstmt;
+	PlannedStmt *plannedstmt;
+
+	Assert(oldstmt->reoptQuery != NULL);
+	Assert(query_supports_reoptimization(oldstmt->reoptQuery));
+
+	/* We only do this once per execution */
+	estate->es_replan_requested = false;
+	estate->es_replan_checkpoints = NULL;
+
+	/* Shut down the current plan */
+	ExecEndPlan(queryDesc->planstate, estate);
+	estate->es_subplanstates = NIL;
+	estate->es_junkFilter = NULL;
+
+	/* The planner scribbles on its input, so give it a copy */
+	plannedstmt = planner(copyObject(oldstmt->reoptQuery),
+						  queryDesc->sourceText,
+						  oldstmt->reoptCursorOptions,
+						  queryDesc->params);
+
+	if (estate->es_original_stmt == NULL)
+		estate->es_original_stmt = oldstmt;
+	queryDesc->plannedstmt = plannedstmt;
+
+	/* Allocate workspace for the new plan's internal parameters */
+	estate->es_param_exec_vals = NULL;
+	if (plannedstmt->paramExecTypes != NIL)
+		estate->es_param_exec_vals = (ParamExecData *)
+			palloc0(list_length(plannedstmt->paramExecTypes) *
+					sizeof(ParamExecData));
+	estate->es_jit_flags = plannedstmt->jitFlags;
+
+	/* And set up to execute it */
+	InitPlan(queryDesc, estate->es_top_eflags);
+}
+
+/*
+ * ExecCheckCardinality
+ *		Cardinality checkpoint: compare the number of rows that a node read
+ *		from its input with the planner's estimate.
+ *
+ * Nodes that read all of their input before returning anything call this
+ * once they're done with it, if the planner gave them a feedback target.  If
+ * the estimate was off by more than a factor of reoptimization_threshold,
+ * the actual number of rows is fed back to the planner; and if the node is
+ * one of the query's re-planning checkpoints, we ask for the query to be
+ * re-planned right away.
+ */
+void
+ExecCheckCardinality(PlanState *node, uint64 feedbackKey,
+					 Bitmapset *feedbackRelids, double nrows)
+{
+	EState	   *estate = node->state;
+	double		estimate;
+	double		actual;
+
+	/* Feedback stays local to the backend, so workers needn't bother */
+	if (feedbackKey == 0 || !adaptive_reoptimization || IsParallelWorker())
+		return;
+
+	estimate = Max(outerPlan(node->plan)->plan_rows, 1.0);
+	actual = Max(nrows, 1.0);
+	if (actual / estimate < reoptimization_threshold &&
+		estimate / actual < reoptimization_threshold)
+		return;
+
+	record_cardinality_feedback(feedbackKey, feedbackRelids, nrows);
+
+	if (bms_is_member(node->plan->plan_node_id, estate->es_replan_checkpoints))
+		estate->es_replan_requested = true;
+}
+
 /* ----------------------------------------------------------------
  *		ExecutePlan
  *
@@ -1524,6 +1732,13 @@ ExecutePlan(EState *estate,
 	if (!execute_once)
 		use_parallel_mode = false;
 
+	/*
+	 * Workers taking part in a parallel INSERT can't assign a transaction ID
+	 * themselves, so make sure we have one before entering parallel mode.
+	 */
+	if (use_parallel_mode && operation != CMD_SELECT)
+		(void) GetCurrentTransactionId();
+
 	estate->es_use_parallel_mode = use_parallel_mode;
 	if (use_parallel_mode)
 		EnterParallelMode();
@@ -1546,7 +1761,20 @@ ExecutePlan(EState *estate,
 		 * process so we just end the loop...
 		 */
 		if (TupIsNull(slot))
+		{
+			/* ... and there's no point in re-planning, either */
+			estate->es_replan_requested = false;
+			break;
+		}
+
+		/*
+		 * If we've been asked to re-plan the query, throw the tuple away and
+		 * let our caller start over.  Otherwise, once we return a tuple,
+		 * it's too late for that.
+		 */
+		if (estate->es_replan_requested)
 			break;
+		estate->es_replan_checkpoints = NULL;
 
 		/*
 		 * If we have a junk filter, then project a new tuple with the junk
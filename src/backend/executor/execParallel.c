@@ -23,6 +23,7 @@
 
 #include "postgres.h"
 
+#include "commands/createas.h"
 #include "executor/execParallel.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
@@ -77,6 +78,8 @@ typedef struct FixedParallelExecutorState
 	dsa_pointer param_exec;
 	int			eflags;
 	int			jit_flags;
+	Oid			into_relid;		/* target of a parallel CREATE TABLE AS */
+	pg_atomic_uint64 processed; /* rows inserted by workers */
 } FixedParallelExecutorState;
 
 /*
@@ -186,6 +189,20 @@ ExecSerializePlan(Plan *plan, EState *estate)
 	pstmt->resultRelations = NIL;
 	pstmt->appendRelations = NIL;
 
+	/*
+	 * If the workers are to perform an INSERT themselves, they need to know
+	 * about it; the planner doesn't allow RETURNING in that case.
+	 */
+	if (IsA(plan, ModifyTable))
+	{
+		ModifyTable *node = (ModifyTable *) plan;
+
+		Assert(plan->parallel_aware && node->operation == CMD_INSERT);
+		Assert(node->returningLists == NIL);
+		pstmt->commandType = node->operation;
+		pstmt->resultRelations = node->resultRelations;
+	}
+
 	/*
 	 * Transfer only parallel-safe subplans, leaving a NULL "hole" in the list
 	 * for unsafe ones (so that the list indexes of the safe ones are
@@ -578,7 +595,7 @@ ExecParallelSetupTupleQueues(ParallelContext *pcxt, bool reinitialize)
 ParallelExecutorInfo *
 ExecInitParallelPlan(PlanState *planstate, EState *estate,
 					 Bitmapset *sendParams, int nworkers,
-					 int64 tuples_needed)
+					 int64 tuples_needed, Oid into_relid)
 {
 	ParallelExecutorInfo *pei;
 	ParallelContext *pcxt;
@@ -729,6 +746,8 @@ ExecInitParallelPlan(PlanState *planstate, EState *estate,
 	fpes->param_exec = InvalidDsaPointer;
 	fpes->eflags = estate->es_top_eflags;
 	fpes->jit_flags = estate->es_jit_flags;
+	fpes->into_relid = into_relid;
+	pg_atomic_init_u64(&fpes->processed, 0);
 	shm_toc_insert(pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, fpes);
 
 	/* Store query string */
@@ -909,6 +928,7 @@ ExecParallelReinitialize(PlanState *planstate,
 	pei->finished = false;
 
 	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pg_atomic_write_u64(&fpes->processed, 0);
 
 	/* Free any serialized parameters from the last round. */
 	if (DsaPointerIsValid(fpes->param_exec))
@@ -1106,11 +1126,13 @@ ExecParallelRetrieveJitInstrumentation(PlanState *planstate,
 
 /*
  * Finish parallel execution.  We wait for parallel workers to finish, and
- * accumulate their buffer/WAL usage.
+ * accumulate their buffer/WAL usage, as well as the number of rows they
+ * inserted if they did so themselves.
  */
 void
 ExecParallelFinish(ParallelExecutorInfo *pei)
 {
+	FixedParallelExecutorState *fpes;
 	int			nworkers = pei->pcxt->nworkers_launched;
 	int			i;
 
@@ -1152,6 +1174,9 @@ ExecParallelFinish(ParallelExecutorInfo *pei)
 	for (i = 0; i < nworkers; i++)
 		InstrAccumParallelQuery(&pei->buffer_usage[i], &pei->wal_usage[i]);
 
+	fpes = shm_toc_lookup(pei->pcxt->toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
+	pei->planstate->state->es_processed += pg_atomic_read_u64(&fpes->processed);
+
 	pei->finished = true;
 }
 
@@ -1380,6 +1405,7 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	BufferUsage *buffer_usage;
 	WalUsage   *wal_usage;
 	DestReceiver *receiver;
+	DestReceiver *into_receiver = NULL;
 	QueryDesc  *queryDesc;
 	SharedExecutorInstrumentation *instrumentation;
 	SharedJitInstrumentation *jit_instrumentation;
@@ -1391,14 +1417,23 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Get fixed-size state. */
 	fpes = shm_toc_lookup(toc, PARALLEL_KEY_EXECUTOR_FIXED, false);
 
-	/* Set up DestReceiver, SharedExecutorInstrumentation, and QueryDesc. */
+	/*
+	 * Set up DestReceiver, SharedExecutorInstrumentation, and QueryDesc.  If
+	 * we're to insert our tuples into the target of a CREATE TABLE AS
+	 * ourselves, we still attach to our tuple queue, so that the leader
+	 * notices when we're done.
+	 */
 	receiver = ExecParallelGetReceiver(seg, toc);
+	if (OidIsValid(fpes->into_relid))
+		into_receiver = CreateParallelIntoRelDestReceiver(fpes->into_relid);
 	instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_INSTRUMENTATION, true);
 	if (instrumentation != NULL)
 		instrument_options = instrumentation->instrument_options;
 	jit_instrumentation = shm_toc_lookup(toc, PARALLEL_KEY_JIT_INSTRUMENTATION,
 										 true);
-	queryDesc = ExecParallelGetQueryDesc(toc, receiver, instrument_options);
+	queryDesc = ExecParallelGetQueryDesc(toc,
+										 into_receiver ? into_receiver : receiver,
+										 instrument_options);
 
 	/* Setting debug_query_string for individual workers */
 	debug_query_string = queryDesc->sourceText;
@@ -1452,6 +1487,11 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	/* Shut down the executor */
 	ExecutorFinish(queryDesc);
 
+	/* Report the number of rows we inserted, if any */
+	if (queryDesc->operation != CMD_SELECT || into_receiver != NULL)
+		pg_atomic_add_fetch_u64(&fpes->processed,
+								queryDesc->estate->es_processed);
+
 	/* Report buffer/WAL usage during parallel execution. */
 	buffer_usage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
 	wal_usage = shm_toc_lookup(toc, PARALLEL_KEY_WAL_USAGE, false);
@@ -1478,4 +1518,6 @@ ParallelQueryMain(dsm_segment *seg, shm_toc *toc)
 	dsa_detach(area);
 	FreeQueryDesc(queryDesc);
 	receiver->rDestroy(receiver);
+	if (into_receiver != NULL)
+		into_receiver->rDestroy(into_receiver);
 }
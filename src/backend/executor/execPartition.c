@@ -1598,6 +1598,15 @@ adjust_partition_tlist(List *tlist, TupleConversionMap *map)
  *		expressions.  This function can only be called during execution and
  *		must be called again each time the value of a Param listed in
  *		PartitionPruneState's 'execparamids' changes.
+ *
+ * ExecGetPrunableRelids:
+ *		Returns the RT indexes of the leaf partitions in a PlannedStmt that
+ *		initial pruning might eliminate.
+ *
+ * ExecGetInitiallyPrunedRelids:
+ *		Performs the initial pruning of a PlannedStmt ahead of executor
+ *		startup, and returns the RT indexes of the leaf partitions that it
+ *		eliminates.  This lets the plan cache avoid locking them.
  *-------------------------------------------------------------------------
  */
 
@@ -2126,6 +2135,156 @@ ExecFindMatchingSubPlans(PartitionPruneState *prunestate)
 	return result;
 }
 
+/*
+ * ExecGetPrunableRelids
+ *		Return the RT indexes of the leaf partitions in 'plannedstmt' that
+ *		initial partition pruning might eliminate.
+ *
+ * These are the partitions scanned by the subplans of Append and MergeAppend
+ * nodes that do initial pruning, except for result relations and relations
+ * with row marks, which executor startup opens regardless of pruning.
+ */
+Bitmapset *
+ExecGetPrunableRelids(PlannedStmt *plannedstmt)
+{
+	Bitmapset  *result = NULL;
+	ListCell   *lc;
+
+	foreach(lc, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
+		ListCell   *lc2;
+
+		foreach(lc2, pruneinfo->prune_infos)
+		{
+			List	   *partrelpruneinfos = lfirst_node(List, lc2);
+			ListCell   *lc3;
+
+			foreach(lc3, partrelpruneinfos)
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst_node(PartitionedRelPruneInfo, lc3);
+				int			k;
+
+				for (k = 0; k < pinfo->nparts; k++)
+				{
+					if (pinfo->rti_map[k] > 0)
+						result = bms_add_member(result, pinfo->rti_map[k]);
+				}
+			}
+		}
+	}
+
+	if (result == NULL)
+		return NULL;
+
+	foreach(lc, plannedstmt->resultRelations)
+		result = bms_del_member(result, lfirst_int(lc));
+	foreach(lc, plannedstmt->rowMarks)
+	{
+		PlanRowMark *rc = lfirst_node(PlanRowMark, lc);
+
+		result = bms_del_member(result, rc->rti);
+	}
+
+	return result;
+}
+
+/*
+ * ExecGetInitiallyPrunedRelids
+ *		Perform the initial partition pruning of 'plannedstmt' ahead of
+ *		executor startup, and return the RT indexes of the leaf partitions
+ *		that it eliminates.
+ *
+ * 'params' are the parameter values the plan is going to be executed with.
+ * The partitioned tables in the plan must already be locked.
+ *
+ * The executor repeats the pruning when initializing the Append and
+ * MergeAppend nodes, and must get the same result, since it doesn't expect
+ * to find any of the partitions it scans unlocked.  The planner makes sure
+ * of that by listing only pruning steps free of mutable functions in
+ * partPruneInfos, and the partition descriptors can't change while the
+ * partitioned tables are locked, except for partitions being attached, which
+ * have no subplans in this plan.
+ */
+Bitmapset *
+ExecGetInitiallyPrunedRelids(PlannedStmt *plannedstmt, ParamListInfo params)
+{
+	MemoryContext oldcontext = CurrentMemoryContext;
+	EState	   *estate;
+	PlanState  *planstate;
+	Bitmapset  *result = NULL;
+	ListCell   *lc;
+
+	estate = CreateExecutorState();
+	estate->es_param_list_info = params;
+	MemoryContextSwitchTo(estate->es_query_cxt);
+	ExecInitRangeTable(estate, plannedstmt->rtable);
+
+	/*
+	 * The pruning code evaluates the pruning expressions on behalf of the
+	 * parent plan node, of which it uses just the EState and the ExprContext.
+	 * There's no plan node yet, so make a stand-in.
+	 */
+	planstate = (PlanState *) makeNode(AppendState);
+	planstate->state = estate;
+	ExecAssignExprContext(estate, planstate);
+
+	foreach(lc, plannedstmt->partPruneInfos)
+	{
+		PartitionPruneInfo *pruneinfo = lfirst_node(PartitionPruneInfo, lc);
+		PartitionPruneState *prunestate;
+		Bitmapset  *validsubplans = NULL;
+		ListCell   *lc2;
+		int			i;
+
+		prunestate = ExecCreatePartitionPruneState(planstate, pruneinfo);
+		Assert(prunestate->do_initial_prune);
+
+		for (i = 0; i < prunestate->num_partprunedata; i++)
+		{
+			PartitionPruningData *prunedata = prunestate->partprunedata[i];
+
+			find_matching_subplans_recurse(prunedata,
+										   &prunedata->partrelprunedata[0],
+										   true, &validsubplans);
+		}
+		ResetExprContext(planstate->ps_ExprContext);
+
+		/* Report the leaf partitions whose subplans didn't survive */
+		foreach(lc2, pruneinfo->prune_infos)
+		{
+			List	   *partrelpruneinfos = lfirst_node(List, lc2);
+			ListCell   *lc3;
+
+			foreach(lc3, partrelpruneinfos)
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst_node(PartitionedRelPruneInfo, lc3);
+				int			k;
+
+				for (k = 0; k < pinfo->nparts; k++)
+				{
+					int			subplanidx = pinfo->subplan_map[k];
+
+					if (subplanidx >= 0 &&
+						!bms_is_member(subplanidx, validsubplans))
+					{
+						Assert(pinfo->rti_map[k] > 0);
+						result = bms_add_member(result, pinfo->rti_map[k]);
+					}
+				}
+			}
+		}
+	}
+
+	ExecCloseRangeTableRelations(estate);
+
+	MemoryContextSwitchTo(oldcontext);
+	result = bms_copy(result);
+	FreeExecutorState(estate);
+
+	return result;
+}
+
 /*
  * find_matching_subplans_recurse
  *		Recursive worker function for ExecFindMatchingSubPlans and
@@ -57,6 +57,7 @@
  */
 #include "postgres.h"
 
+#include "access/detoast.h"
 #include "access/heaptoast.h"
 #include "access/htup_details.h"
 #include "access/tupdesc_details.h"
@@ -67,6 +68,7 @@
 #include "utils/builtins.h"
 #include "utils/expandeddatum.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 #include "utils/typcache.h"
 
 static TupleDesc ExecTypeFromTLInternal(List *targetList,
@@ -116,6 +118,7 @@ tts_virtual_clear(TupleTableSlot *slot)
 		slot->tts_flags &= ~TTS_FLAG_SHOULDFREE;
 	}
 
+	slot_reset_detoast_cache(slot);
 	slot->tts_nvalid = 0;
 	slot->tts_flags |= TTS_FLAG_EMPTY;
 	ItemPointerSetInvalid(&slot->tts_tid);
@@ -311,6 +314,7 @@ tts_heap_clear(TupleTableSlot *slot)
 		slot->tts_flags &= ~TTS_FLAG_SHOULDFREE;
 	}
 
+	slot_reset_detoast_cache(slot);
 	slot->tts_nvalid = 0;
 	slot->tts_flags |= TTS_FLAG_EMPTY;
 	ItemPointerSetInvalid(&slot->tts_tid);
@@ -477,6 +481,7 @@ tts_minimal_clear(TupleTableSlot *slot)
 		slot->tts_flags &= ~TTS_FLAG_SHOULDFREE;
 	}
 
+	slot_reset_detoast_cache(slot);
 	slot->tts_nvalid = 0;
 	slot->tts_flags |= TTS_FLAG_EMPTY;
 	ItemPointerSetInvalid(&slot->tts_tid);
@@ -656,6 +661,7 @@ tts_buffer_heap_clear(TupleTableSlot *slot)
 	if (BufferIsValid(bslot->buffer))
 		ReleaseBuffer(bslot->buffer);
 
+	slot_reset_detoast_cache(slot);
 	slot->tts_nvalid = 0;
 	slot->tts_flags |= TTS_FLAG_EMPTY;
 	ItemPointerSetInvalid(&slot->tts_tid);
@@ -840,6 +846,7 @@ tts_buffer_heap_store_tuple(TupleTableSlot *slot, HeapTuple tuple,
 		slot->tts_flags &= ~TTS_FLAG_SHOULDFREE;
 	}
 
+	slot_reset_detoast_cache(slot);
 	slot->tts_flags &= ~TTS_FLAG_EMPTY;
 	slot->tts_nvalid = 0;
 	bslot->base.tuple = tuple;
@@ -1186,6 +1193,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 				if (slot->tts_isnull)
 					pfree(slot->tts_isnull);
 			}
+			if (slot->tts_detoast)
+				MemoryContextDelete(slot->tts_detoast->mcxt);
 			pfree(slot);
 		}
 	}
@@ -1236,6 +1245,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 		if (slot->tts_isnull)
 			pfree(slot->tts_isnull);
 	}
+	if (slot->tts_detoast)
+		MemoryContextDelete(slot->tts_detoast->mcxt);
 	pfree(slot);
 }
 
@@ -1892,6 +1903,77 @@ slot_getsomeattrs_int(TupleTableSlot *slot, int attnum)
 	}
 }
 
+/*
+ * slot_detoast_attr - fetch a fully detoasted copy of an attribute
+ *
+ * The attribute must already have been extracted into tts_values, and must
+ * not be null.  The detoasted value is remembered until the slot's contents
+ * change, so that fetching the same attribute again is cheap; the caller
+ * must not modify or free it.
+ */
+Datum
+slot_detoast_attr(TupleTableSlot *slot, int attnum)
+{
+	SlotDetoastCache *cache = slot->tts_detoast;
+	MemoryContext oldcxt;
+	Datum		value;
+	int			i;
+
+	Assert(attnum > 0 && attnum <= slot->tts_nvalid);
+	Assert(!slot->tts_isnull[attnum - 1]);
+
+	if (cache == NULL)
+	{
+		cache = MemoryContextAllocZero(slot->tts_mcxt,
+									   sizeof(SlotDetoastCache));
+		cache->mcxt = AllocSetContextCreate(slot->tts_mcxt,
+											"detoasted slot values",
+											ALLOCSET_DEFAULT_SIZES);
+		cache->maxcached = 4;
+		cache->attnums = MemoryContextAlloc(slot->tts_mcxt,
+											sizeof(AttrNumber) * cache->maxcached);
+		cache->values = MemoryContextAlloc(slot->tts_mcxt,
+										   sizeof(Datum) * cache->maxcached);
+		slot->tts_detoast = cache;
+	}
+
+	/* usually only a few attributes are cached, so just search linearly */
+	for (i = 0; i < cache->ncached; i++)
+	{
+		if (cache->attnums[i] == attnum)
+			return cache->values[i];
+	}
+
+	oldcxt = MemoryContextSwitchTo(cache->mcxt);
+	value = PointerGetDatum(detoast_attr((struct varlena *)
+										 DatumGetPointer(slot->tts_values[attnum - 1])));
+	MemoryContextSwitchTo(oldcxt);
+
+	if (cache->ncached >= cache->maxcached)
+	{
+		cache->maxcached *= 2;
+		cache->attnums = repalloc(cache->attnums,
+								  sizeof(AttrNumber) * cache->maxcached);
+		cache->values = repalloc(cache->values,
+								 sizeof(Datum) * cache->maxcached);
+	}
+	cache->attnums[cache->ncached] = attnum;
+	cache->values[cache->ncached] = value;
+	cache->ncached++;
+
+	return value;
+}
+
+/*
+ * slot_reset_detoast_cache_int - workhorse for slot_reset_detoast_cache()
+ */
+void
+slot_reset_detoast_cache_int(TupleTableSlot *slot)
+{
+	slot->tts_detoast->ncached = 0;
+	MemoryContextReset(slot->tts_detoast->mcxt);
+}
+
 /* ----------------------------------------------------------------
  *		ExecTypeFromTL
  *
@@ -155,6 +155,10 @@ CreateExecutorState(void)
 
 	estate->es_use_parallel_mode = false;
 
+	estate->es_replan_checkpoints = NULL;
+	estate->es_replan_requested = false;
+	estate->es_original_stmt = NULL;
+
 	estate->es_jit_flags = 0;
 	estate->es_jit = NULL;
 
@@ -138,12 +138,14 @@ MultiExecHash(HashState *node)
 static void
 MultiExecPrivateHash(HashState *node)
 {
+	Hash	   *plannode = (Hash *) node->ps.plan;
 	PlanState  *outerNode;
 	List	   *hashkeys;
 	HashJoinTable hashtable;
 	TupleTableSlot *slot;
 	ExprContext *econtext;
 	uint32		hashvalue;
+	double		ntuples = 0;
 
 	/*
 	 * get state info from node
@@ -166,6 +168,7 @@ MultiExecPrivateHash(HashState *node)
 		slot = ExecProcNode(outerNode);
 		if (TupIsNull(slot))
 			break;
+		ntuples += 1;
 		/* We have to compute the hash value */
 		econtext->ecxt_outertuple = slot;
 		if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
@@ -201,6 +204,14 @@ MultiExecPrivateHash(HashState *node)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
 	hashtable->partialTuples = hashtable->totalTuples;
+
+	/*
+	 * See whether the planner's estimate of the inner relation was way off.
+	 * (This counts tuples with null keys, too, as the estimate does.)
+	 */
+	if (plannode->feedbackKey != 0)
+		ExecCheckCardinality(&node->ps, plannode->feedbackKey,
+							 plannode->feedbackRelids, ntuples);
 }
 
 /* ----------------------------------------------------------------
@@ -317,10 +328,22 @@ MultiExecParallelHash(HashState *node)
 				/*
 				 * Elect one backend to disable any further growth.  Batches
 				 * are now fixed.  While building them we made sure they'd fit
-				 * in our memory budget when we load them back in later (or we
+				 * in our memory budget when we load them back in later, or we
 				 * tried to do that and gave up because we detected extreme
-				 * skew).
+				 * skew.  In that case, mark the batches that are too big so
+				 * that they'll be joined in stripes.  Batch 0 was marked
+				 * already if it overflowed.
 				 */
+				if (pstate->growth == PHJ_GROWTH_STRIPING)
+				{
+					for (i = 1; i < hashtable->nbatch; ++i)
+					{
+						ParallelHashJoinBatch *batch = hashtable->batches[i].shared;
+
+						if (batch->estimated_size > pstate->space_allowed)
+							batch->striped = true;
+					}
+				}
 				pstate->growth = PHJ_GROWTH_DISABLED;
 			}
 	}
@@ -497,6 +520,16 @@ ExecHashTableCreate(HashState *state, List *hashOperators, List *hashCollations,
 	hashtable->nbatch_original = nbatch;
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
+	hashtable->curstripe = 0;
+	hashtable->nstripes = 1;
+	hashtable->innerStripeFile = NULL;
+	hashtable->innerStripeTuples = 0;
+	hashtable->outerTupleNo = -1;
+	hashtable->outerMatchFile = NULL;
+	hashtable->outerMatchChunk = NULL;
+	hashtable->outerMatchChunkNo = -1;
+	hashtable->outerMatchNChunks = 0;
+	hashtable->outerMatchDirty = false;
 	hashtable->totalTuples = 0;
 	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
@@ -856,13 +889,13 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 	int			i;
 
 	/*
-	 * Make sure all the temp files are closed.  We skip batch 0, since it
-	 * can't have any temp files (and the arrays might not even exist if
-	 * nbatch is only 1).  Parallel hash joins don't use these files.
+	 * Make sure all the temp files are closed.  The arrays might not even
+	 * exist if nbatch is only 1.  Parallel hash joins don't use these files,
+	 * but they do use the stripe files.
 	 */
 	if (hashtable->innerBatchFile != NULL)
 	{
-		for (i = 1; i < hashtable->nbatch; i++)
+		for (i = 0; i < hashtable->nbatch; i++)
 		{
 			if (hashtable->innerBatchFile[i])
 				BufFileClose(hashtable->innerBatchFile[i]);
@@ -870,6 +903,10 @@ ExecHashTableDestroy(HashJoinTable hashtable)
 				BufFileClose(hashtable->outerBatchFile[i]);
 		}
 	}
+	if (hashtable->innerStripeFile)
+		BufFileClose(hashtable->innerStripeFile);
+	if (hashtable->outerMatchFile)
+		BufFileClose(hashtable->outerMatchFile);
 
 	/* Release working memory (batchCxt is a child, so it goes away too) */
 	MemoryContextDelete(hashtable->hashCxt);
@@ -900,7 +937,10 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 
 	/* safety check to avoid overflow */
 	if (oldnbatch > Min(INT_MAX / 2, MaxAllocSize / (sizeof(void *) * 2)))
+	{
+		hashtable->growEnabled = false;
 		return;
+	}
 
 	nbatch = oldnbatch * 2;
 	Assert(nbatch > 1);
@@ -1036,8 +1076,9 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	 * further expansion of nbatch.  This situation implies that we have
 	 * enough tuples of identical hashvalues to overflow spaceAllowed.
 	 * Increasing nbatch will not fix it since there's no way to subdivide the
-	 * group any more finely. We have to just gut it out and hope the server
-	 * has enough RAM.
+	 * group any more finely.  From now on, any tuples of the current batch
+	 * that don't fit are set aside to be joined in later stripes; see
+	 * ExecHashTableInsert.
 	 */
 	if (nfreed == 0 || nfreed == ninmemory)
 	{
@@ -1247,9 +1288,12 @@ ExecParallelHashIncreaseNumBatches(HashJoinTable hashtable)
 					}
 				}
 
-				/* Don't keep growing if it's not helping or we'd overflow. */
+				/*
+				 * Don't keep growing if it's not helping or we'd overflow.
+				 * Batches that still don't fit will be joined in stripes.
+				 */
 				if (extreme_skew_detected || hashtable->nbatch >= INT_MAX / 2)
-					pstate->growth = PHJ_GROWTH_DISABLED;
+					pstate->growth = PHJ_GROWTH_STRIPING;
 				else if (space_exhausted)
 					pstate->growth = PHJ_GROWTH_NEED_MORE_BATCHES;
 				else
@@ -1608,7 +1652,26 @@ ExecHashTableInsert(HashJoinTable hashtable,
 	/*
 	 * decide whether to put the tuple in the hash table or a temp file
 	 */
-	if (batchno == hashtable->curbatch)
+	if (batchno == hashtable->curbatch &&
+		!hashtable->growEnabled &&
+		hashtable->curstripe == 0 &&
+		(hashtable->innerStripeTuples > 0 ||
+		 (hashtable->spaceUsed > 0 &&
+		  hashtable->spaceUsed + HJTUPLE_OVERHEAD + tuple->t_len +
+		  hashtable->nbuckets_optimal * sizeof(HashJoinTuple) >
+		  hashtable->spaceAllowed)))
+	{
+		/*
+		 * The current batch doesn't fit and can't be split any further, so
+		 * put the tuple aside for a later stripe.  Once we've started doing
+		 * that, the rest of the batch goes the same way.
+		 */
+		ExecHashJoinSaveTuple(tuple,
+							  hashvalue,
+							  &hashtable->innerStripeFile);
+		hashtable->innerStripeTuples++;
+	}
+	else if (batchno == hashtable->curbatch)
 	{
 		/*
 		 * put the tuple in hash table
@@ -1695,7 +1758,7 @@ ExecParallelHashTableInsert(HashJoinTable hashtable,
 retry:
 	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
 
-	if (batchno == 0)
+	if (batchno == 0 && !hashtable->batches[0].shared->striped)
 	{
 		HashJoinTuple hashTuple;
 
@@ -1716,6 +1779,14 @@ retry:
 		ExecParallelHashPushTuple(&hashtable->buckets.shared[bucketno],
 								  hashTuple, shared);
 	}
+	else if (batchno == 0)
+	{
+		/*
+		 * Batch 0 is full and can't be split any further.  The tuple will be
+		 * loaded in a later stripe.
+		 */
+		sts_puttuple(hashtable->batches[0].inner_tuples, &hashvalue, tuple);
+	}
 	else
 	{
 		size_t		tuple_size = MAXALIGN(HJTUPLE_OVERHEAD + tuple->t_len);
@@ -2162,6 +2233,72 @@ ExecHashTableReset(HashJoinTable hashtable)
 	hashtable->chunks = NULL;
 }
 
+/*
+ * ExecParallelHashTableResetStripe
+ *
+ *		empty the shared hash table of the current batch, to make room for
+ *		its next stripe
+ *
+ * Only the participant that has taken on a striped batch is attached to it,
+ * so no one else can be looking at the hash table.
+ */
+void
+ExecParallelHashTableResetStripe(HashJoinTable hashtable)
+{
+	int			curbatch = hashtable->curbatch;
+	ParallelHashJoinBatch *batch = hashtable->batches[curbatch].shared;
+	int			i;
+
+	Assert(batch->striped);
+
+	/* Remember how much memory the stripe we're done with used. */
+	hashtable->spacePeak =
+		Max(hashtable->spacePeak,
+			batch->size + sizeof(dsa_pointer_atomic) * hashtable->nbuckets);
+
+	/* Free the shared chunks and clear the buckets. */
+	while (DsaPointerIsValid(batch->chunks))
+	{
+		HashMemoryChunk chunk =
+		dsa_get_address(hashtable->area, batch->chunks);
+		dsa_pointer next = chunk->next.shared;
+
+		dsa_free(hashtable->area, batch->chunks);
+		batch->chunks = next;
+	}
+	batch->size = 0;
+	for (i = 0; i < hashtable->nbuckets; ++i)
+		dsa_pointer_atomic_write(&hashtable->buckets.shared[i],
+								 InvalidDsaPointer);
+
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
+	hashtable->batches[curbatch].at_least_one_chunk = false;
+}
+
+/*
+ * ExecHashTableStripeIsFull
+ *
+ *		has the current stripe used up the memory budget?
+ */
+bool
+ExecHashTableStripeIsFull(HashJoinTable hashtable)
+{
+	if (hashtable->parallel_state != NULL)
+	{
+		ParallelHashJoinBatch *batch =
+		hashtable->batches[hashtable->curbatch].shared;
+
+		return batch->size +
+			sizeof(dsa_pointer_atomic) * hashtable->nbuckets >=
+			hashtable->parallel_state->space_allowed;
+	}
+
+	return hashtable->spaceUsed +
+		hashtable->nbuckets_optimal * sizeof(HashJoinTuple) >=
+		hashtable->spaceAllowed;
+}
+
 /*
  * ExecHashTableResetMatchFlags
  *		Clear all the HeapTupleHeaderHasMatch flags in the table
@@ -2701,6 +2838,8 @@ ExecHashAccumInstrumentation(HashInstrumentation *instrument,
 									  hashtable->nbatch_original);
 	instrument->space_peak = Max(instrument->space_peak,
 								 hashtable->spacePeak);
+	instrument->nstripes = Max(instrument->nstripes,
+							   hashtable->nstripes);
 }
 
 /*
@@ -2784,7 +2923,8 @@ dense_alloc(HashJoinTable hashtable, Size size)
  * decide to expand the bucket array, or discover that another participant has
  * commanded us to help do that.  Return NULL if number of buckets or batches
  * has changed, indicating that the caller must retry (considering the
- * possibility that the tuple no longer belongs in the same batch).
+ * possibility that the tuple no longer belongs in the same batch).  We also
+ * return NULL if batch 0 turns out to need stripes, and mark it as striped.
  */
 static HashJoinTuple
 ExecParallelHashTupleAlloc(HashJoinTable hashtable, size_t size,
@@ -2852,7 +2992,7 @@ ExecParallelHashTupleAlloc(HashJoinTable hashtable, size_t size,
 		chunk_size = HASH_CHUNK_SIZE;
 
 	/* Check if it's time to grow batches or buckets. */
-	if (pstate->growth != PHJ_GROWTH_DISABLED)
+	if (pstate->growth == PHJ_GROWTH_OK)
 	{
 		Assert(curbatch == 0);
 		Assert(BarrierPhase(&pstate->build_barrier) == PHJ_BUILD_HASHING_INNER);
@@ -2892,6 +3032,25 @@ ExecParallelHashTupleAlloc(HashJoinTable hashtable, size_t size,
 			}
 		}
 	}
+	else if (pstate->growth == PHJ_GROWTH_STRIPING)
+	{
+		Assert(curbatch == 0);
+		Assert(BarrierPhase(&pstate->build_barrier) == PHJ_BUILD_HASHING_INNER);
+
+		/*
+		 * Repartitioning didn't help, so if batch 0 is full, the caller must
+		 * send the rest of its tuples to a later stripe.
+		 */
+		if (hashtable->batches[0].at_least_one_chunk &&
+			hashtable->batches[0].shared->size +
+			chunk_size > pstate->space_allowed)
+		{
+			hashtable->batches[0].shared->striped = true;
+			LWLockRelease(&pstate->lock);
+
+			return NULL;
+		}
+	}
 
 	/* We are cleared to allocate a new chunk. */
 	chunk_shared = dsa_allocate(hashtable->area, chunk_size);
@@ -3347,7 +3506,7 @@ ExecParallelHashTuplePrealloc(HashJoinTable hashtable, int batchno, size_t size)
 		return false;
 	}
 
-	if (pstate->growth != PHJ_GROWTH_DISABLED &&
+	if (pstate->growth == PHJ_GROWTH_OK &&
 		batch->at_least_one_chunk &&
 		(batch->shared->estimated_size + want + HASH_CHUNK_HEADER_SIZE
 		 > pstate->space_allowed))
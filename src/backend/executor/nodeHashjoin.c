@@ -93,6 +93,13 @@
  * turns out either at planning or execution time to be impossible then we
  * fall back to regular hash_mem sized hash tables.
  *
+ * If a batch can't be split into smaller batches because of extreme skew, it
+ * is marked as striped, and is joined in several memory-sized stripes by a
+ * single participant (see ExecHashJoinNextStripe).  Batch 0 is marked while
+ * it's being built if it overflows; the tuples that didn't fit go to its inner
+ * tuplestore.  Other participants skip striped batches that have already been
+ * claimed, so no one ever needs to wait for a stripe to be finished.
+ *
  * To avoid deadlocks, we never wait for any barrier unless it is known that
  * all other backends attached to it are actively executing the node or have
  * already arrived.  Practically, that means that we never return a tuple
@@ -133,6 +140,22 @@
 /* Returns true if doing null-fill on inner relation */
 #define HJ_FILL_INNER(hjstate)	((hjstate)->hj_NullOuterTupleSlot != NULL)
 
+/* Returns true if the current batch is being joined in stripes */
+#define HJ_STRIPED(hashtable) \
+	((hashtable)->curstripe > 0 || (hashtable)->innerStripeTuples > 0)
+/* Returns true if the current stripe is the last one of its batch */
+#define HJ_LAST_STRIPE(hashtable)	((hashtable)->innerStripeTuples == 0)
+/* Returns true if the current outer tuple is joined against all stripes */
+#define HJ_OUTER_STRIPED(hjstate) \
+	(HJ_STRIPED((hjstate)->hj_HashTable) && \
+	 (hjstate)->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
+/* Returns true if we must remember which outer tuples found a match */
+#define HJ_TRACK_OUTER_MATCHES(hjstate) \
+	(HJ_FILL_OUTER(hjstate) || (hjstate)->js.single_match)
+
+/* Number of outer tuples whose match bits fit in one block */
+#define HJ_MATCH_BITS_PER_CHUNK		((int64) BLCKSZ * BITS_PER_BYTE)
+
 static TupleTableSlot *ExecHashJoinOuterGetTuple(PlanState *outerNode,
 												 HashJoinState *hjstate,
 												 uint32 *hashvalue);
@@ -145,7 +168,19 @@ static TupleTableSlot *ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 												 TupleTableSlot *tupleSlot);
 static bool ExecHashJoinNewBatch(HashJoinState *hjstate);
 static bool ExecParallelHashJoinNewBatch(HashJoinState *hjstate);
+static bool ExecParallelHashJoinClaimBatch(HashJoinTable hashtable,
+										   int batchno);
 static void ExecParallelHashJoinPartitionOuter(HashJoinState *node);
+static bool ExecHashJoinNextStripe(HashJoinState *hjstate);
+static void ExecHashJoinEndStripes(HashJoinTable hashtable);
+static bool ExecHashJoinStripeOuterTuple(HashJoinState *hjstate,
+										 TupleTableSlot *slot,
+										 uint32 hashvalue);
+static bool ExecHashJoinStripeOuterUnmatched(HashJoinState *hjstate);
+static uint8 *ExecHashJoinOuterMatchByte(HashJoinTable hashtable);
+static bool ExecHashJoinOuterMatchedBefore(HashJoinTable hashtable);
+static void ExecHashJoinSetOuterMatched(HashJoinTable hashtable);
+static void ExecHashJoinFlushMatchChunk(HashJoinTable hashtable);
 
 
 /* ----------------------------------------------------------------
@@ -390,26 +425,40 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				if (batchno != hashtable->curbatch &&
 					node->hj_CurSkewBucketNo == INVALID_SKEW_BUCKET_NO)
 				{
-					bool		shouldFree;
-					MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
-																	  &shouldFree);
-
 					/*
 					 * Need to postpone this outer tuple to a later batch.
-					 * Save it in the corresponding outer-batch file.
+					 * Save it in the corresponding outer-batch file, unless
+					 * we did that already while joining an earlier stripe of
+					 * this batch.
 					 */
 					Assert(parallel_state == NULL);
 					Assert(batchno > hashtable->curbatch);
-					ExecHashJoinSaveTuple(mintuple, hashvalue,
-										  &hashtable->outerBatchFile[batchno]);
+					if (hashtable->curstripe == 0)
+					{
+						bool		shouldFree;
+						MinimalTuple mintuple = ExecFetchSlotMinimalTuple(outerTupleSlot,
+																		  &shouldFree);
+
+						ExecHashJoinSaveTuple(mintuple, hashvalue,
+											  &hashtable->outerBatchFile[batchno]);
 
-					if (shouldFree)
-						heap_free_minimal_tuple(mintuple);
+						if (shouldFree)
+							heap_free_minimal_tuple(mintuple);
+					}
 
 					/* Loop around, staying in HJ_NEED_NEW_OUTER state */
 					continue;
 				}
 
+				/*
+				 * If the batch is being joined in stripes, the tuple might
+				 * already be finished with.
+				 */
+				if (HJ_OUTER_STRIPED(node) &&
+					!ExecHashJoinStripeOuterTuple(node, outerTupleSlot,
+												  hashvalue))
+					continue;
+
 				/* OK, let's scan the bucket for matches */
 				node->hj_JoinState = HJ_SCAN_BUCKET;
 
@@ -455,6 +504,12 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				{
 					node->hj_MatchedOuter = true;
 
+					/* Remember the match in the following stripes, too */
+					if (HJ_OUTER_STRIPED(node) &&
+						!HJ_LAST_STRIPE(hashtable) &&
+						HJ_TRACK_OUTER_MATCHES(node))
+						ExecHashJoinSetOuterMatched(hashtable);
+
 					if (parallel)
 					{
 						/*
@@ -504,12 +559,16 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 				/*
 				 * The current outer tuple has run out of matches, so check
 				 * whether to emit a dummy outer-join tuple.  Whether we emit
-				 * one or not, the next state is NEED_NEW_OUTER.
+				 * one or not, the next state is NEED_NEW_OUTER.  If the batch
+				 * is being joined in stripes, that has to wait until we know
+				 * the tuple didn't match in any stripe.
 				 */
 				node->hj_JoinState = HJ_NEED_NEW_OUTER;
 
 				if (!node->hj_MatchedOuter &&
-					HJ_FILL_OUTER(node))
+					HJ_FILL_OUTER(node) &&
+					(!HJ_OUTER_STRIPED(node) ||
+					 ExecHashJoinStripeOuterUnmatched(node)))
 				{
 					/*
 					 * Generate a fake join tuple with nulls for the inner
@@ -527,9 +586,10 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 			case HJ_FILL_INNER_TUPLES:
 
 				/*
-				 * We have finished a batch, but we are doing right/full join,
-				 * so any unmatched inner tuples in the hashtable have to be
-				 * emitted before we continue to the next batch.
+				 * We have finished a batch (or a stripe of one), but we are
+				 * doing right/full join, so any unmatched inner tuples in the
+				 * hashtable have to be emitted before we continue to the next
+				 * batch or stripe.
 				 */
 				if (!ExecScanHashTableForUnmatched(node, econtext))
 				{
@@ -553,9 +613,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 			case HJ_NEED_NEW_BATCH:
 
 				/*
-				 * Try to advance to next batch.  Done if there are no more.
+				 * Try to advance to the next stripe of the current batch, or
+				 * else to the next batch.  Done if there are no more.
 				 */
-				if (parallel)
+				if (ExecHashJoinNextStripe(node))
+				{
+					/* stay on the current batch */
+				}
+				else if (parallel)
 				{
 					if (!ExecParallelHashJoinNewBatch(node))
 						return NULL;	/* end of parallel-aware join */
@@ -813,7 +878,7 @@ ExecHashJoinOuterGetTuple(PlanState *outerNode,
 	int			curbatch = hashtable->curbatch;
 	TupleTableSlot *slot;
 
-	if (curbatch == 0)			/* if it is the first pass */
+	if (curbatch == 0 && hashtable->curstripe == 0) /* if it is the first pass */
 	{
 		/*
 		 * Check to see if first outer tuple was already fetched by
@@ -1123,6 +1188,16 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 		MinimalTuple tuple;
 		TupleTableSlot *slot;
 
+		/*
+		 * A batch that has to be joined in stripes is handled by a single
+		 * participant, because the others couldn't be kept in step with it
+		 * from one stripe to the next without waiting at the batch barrier.
+		 */
+		if (!hashtable->batches[batchno].done &&
+			hashtable->batches[batchno].shared->striped &&
+			!ExecParallelHashJoinClaimBatch(hashtable, batchno))
+			hashtable->batches[batchno].done = true;
+
 		if (!hashtable->batches[batchno].done)
 		{
 			SharedTuplestoreAccessor *inner_tuples;
@@ -1153,6 +1228,20 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 					while ((tuple = sts_parallel_scan_next(inner_tuples,
 														   &hashvalue)))
 					{
+						/*
+						 * If the batch is striped, whatever doesn't fit in
+						 * the first stripe is set aside for later ones.
+						 */
+						if (hashtable->batches[batchno].shared->striped &&
+							(hashtable->innerStripeTuples > 0 ||
+							 ExecHashTableStripeIsFull(hashtable)))
+						{
+							ExecHashJoinSaveTuple(tuple, hashvalue,
+												  &hashtable->innerStripeFile);
+							hashtable->innerStripeTuples++;
+							continue;
+						}
+
 						ExecForceStoreMinimalTuple(tuple,
 												   hjstate->hj_HashTupleSlot,
 												   false);
@@ -1178,6 +1267,27 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 					 * PHJ_BATCH_DONE can be reached.
 					 */
 					ExecParallelHashTableSetCurrentBatch(hashtable, batchno);
+
+					/*
+					 * If batch 0 overflowed while we were building it, the
+					 * tuples that didn't fit are waiting in its inner
+					 * tuplestore.  They'll be loaded in later stripes.
+					 */
+					if (batchno == 0 &&
+						hashtable->batches[batchno].shared->striped)
+					{
+						inner_tuples = hashtable->batches[batchno].inner_tuples;
+						sts_begin_parallel_scan(inner_tuples);
+						while ((tuple = sts_parallel_scan_next(inner_tuples,
+															   &hashvalue)))
+						{
+							ExecHashJoinSaveTuple(tuple, hashvalue,
+												  &hashtable->innerStripeFile);
+							hashtable->innerStripeTuples++;
+						}
+						sts_end_parallel_scan(inner_tuples);
+					}
+
 					sts_begin_parallel_scan(hashtable->batches[batchno].outer_tuples);
 					return true;
 
@@ -1203,6 +1313,347 @@ ExecParallelHashJoinNewBatch(HashJoinState *hjstate)
 	return false;
 }
 
+/*
+ * Try to take on a striped batch.  Returns true if we're the participant
+ * that will join it, false if someone else got there first.
+ */
+static bool
+ExecParallelHashJoinClaimBatch(HashJoinTable hashtable, int batchno)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	ParallelHashJoinBatch *batch = hashtable->batches[batchno].shared;
+	bool		claimed = false;
+
+	LWLockAcquire(&pstate->lock, LW_EXCLUSIVE);
+	if (!batch->striped_claimed)
+	{
+		batch->striped_claimed = true;
+		claimed = true;
+	}
+	LWLockRelease(&pstate->lock);
+
+	return claimed;
+}
+
+/*
+ * ExecHashJoinNextStripe
+ *		load the next stripe of the current batch, if it has one
+ *
+ * A batch that can't be split into smaller batches, because too many of its
+ * tuples share the same hash value, is joined as a block nested loop: the
+ * inner tuples that didn't fit in memory were written to innerStripeFile,
+ * and we load them back one memory-sized stripe at a time, rescanning the
+ * outer batch for each stripe.  The inner stripe file is only read once.
+ *
+ * Returns true if there's a new stripe to probe, false if the current batch
+ * is finished.
+ */
+static bool
+ExecHashJoinNextStripe(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+	int			curbatch = hashtable->curbatch;
+	TupleTableSlot *slot;
+	uint32		hashvalue;
+
+	if (hashtable->innerStripeTuples == 0)
+	{
+		if (hashtable->curstripe > 0)
+			ExecHashJoinEndStripes(hashtable);
+		return false;
+	}
+
+	ExecHashJoinFlushMatchChunk(hashtable);
+
+	if (hashtable->curstripe == 0)
+	{
+		if (curbatch == 0 && hashtable->parallel_state == NULL)
+		{
+			/*
+			 * As in ExecHashJoinNewBatch, we're done with the skew hash
+			 * table once we've finished the first pass over the outer
+			 * relation; any outer tuples that belonged to it were not saved
+			 * for later stripes.
+			 */
+			hashtable->skewEnabled = false;
+			hashtable->skewBucket = NULL;
+			hashtable->skewBucketNums = NULL;
+			hashtable->nSkewBuckets = 0;
+			hashtable->spaceUsedSkew = 0;
+		}
+
+		if (BufFileSeek(hashtable->innerStripeFile, 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-join temporary file")));
+	}
+
+	hashtable->curstripe++;
+	hashtable->nstripes = Max(hashtable->nstripes, hashtable->curstripe + 1);
+
+	/* Load as many of the remaining inner tuples as fit. */
+	if (hashtable->parallel_state != NULL)
+		ExecParallelHashTableResetStripe(hashtable);
+	else
+		ExecHashTableReset(hashtable);
+
+	do
+	{
+		slot = ExecHashJoinGetSavedTuple(hjstate,
+										 hashtable->innerStripeFile,
+										 &hashvalue,
+										 hjstate->hj_HashTupleSlot);
+		if (slot == NULL)
+			elog(ERROR, "unexpected end of hash join stripe file");
+		hashtable->innerStripeTuples--;
+
+		if (hashtable->parallel_state != NULL)
+			ExecParallelHashTableInsertCurrentBatch(hashtable, slot,
+													hashvalue);
+		else
+			ExecHashTableInsert(hashtable, slot, hashvalue);
+	} while (hashtable->innerStripeTuples > 0 &&
+			 !ExecHashTableStripeIsFull(hashtable));
+
+	if (hashtable->innerStripeTuples == 0)
+	{
+		BufFileClose(hashtable->innerStripeFile);
+		hashtable->innerStripeFile = NULL;
+	}
+
+	/* Rewind the outer batch, so that we can probe the new stripe with it. */
+	if (hashtable->parallel_state != NULL)
+	{
+		SharedTuplestoreAccessor *outer_tuples =
+		hashtable->batches[curbatch].outer_tuples;
+
+		sts_end_parallel_scan(outer_tuples);
+		sts_reinitialize(outer_tuples);
+		sts_begin_parallel_scan(outer_tuples);
+	}
+	else if (hashtable->outerBatchFile[curbatch] != NULL)
+	{
+		if (BufFileSeek(hashtable->outerBatchFile[curbatch], 0, 0L, SEEK_SET))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not rewind hash-join temporary file")));
+	}
+	hashtable->outerTupleNo = -1;
+
+	return true;
+}
+
+/*
+ * ExecHashJoinEndStripes
+ *		release the resources used to join the current batch in stripes
+ */
+static void
+ExecHashJoinEndStripes(HashJoinTable hashtable)
+{
+	Assert(hashtable->innerStripeFile == NULL);
+
+	if (hashtable->outerMatchFile != NULL)
+		BufFileClose(hashtable->outerMatchFile);
+	hashtable->outerMatchFile = NULL;
+	hashtable->outerMatchChunkNo = -1;
+	hashtable->outerMatchNChunks = 0;
+	hashtable->outerMatchDirty = false;
+	hashtable->outerTupleNo = -1;
+	hashtable->curstripe = 0;
+
+	/*
+	 * Outer batch 0 was saved only so that it could be rescanned for each
+	 * stripe.
+	 */
+	if (hashtable->curbatch == 0 && hashtable->parallel_state == NULL &&
+		hashtable->outerBatchFile[0] != NULL)
+	{
+		BufFileClose(hashtable->outerBatchFile[0]);
+		hashtable->outerBatchFile[0] = NULL;
+	}
+}
+
+/*
+ * ExecHashJoinStripeOuterTuple
+ *		account for an outer tuple of a batch that is joined in stripes
+ *
+ * Outer tuples are numbered in the order they're read, which is the same for
+ * every stripe.  Returns false if the tuple needn't be probed against the
+ * current stripe, because it already found the one match it needed in an
+ * earlier stripe.
+ */
+static bool
+ExecHashJoinStripeOuterTuple(HashJoinState *hjstate, TupleTableSlot *slot,
+							 uint32 hashvalue)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+
+	hashtable->outerTupleNo++;
+
+	/*
+	 * The outer plan can't be rescanned, so on the first stripe of batch 0
+	 * we keep a copy of its tuples for the following stripes.
+	 */
+	if (hashtable->curbatch == 0 && hashtable->curstripe == 0 &&
+		hashtable->parallel_state == NULL)
+	{
+		bool		shouldFree;
+		MinimalTuple mintuple = ExecFetchSlotMinimalTuple(slot, &shouldFree);
+
+		ExecHashJoinSaveTuple(mintuple, hashvalue,
+							  &hashtable->outerBatchFile[0]);
+
+		if (shouldFree)
+			heap_free_minimal_tuple(mintuple);
+	}
+
+	if (hashtable->curstripe > 0 &&
+		(hjstate->js.jointype == JOIN_ANTI || hjstate->js.single_match) &&
+		ExecHashJoinOuterMatchedBefore(hashtable))
+		return false;
+
+	return true;
+}
+
+/*
+ * ExecHashJoinStripeOuterUnmatched
+ *		is it time to null-fill the current outer tuple?
+ *
+ * When a batch is joined in stripes, that can only be decided on the last
+ * stripe.
+ */
+static bool
+ExecHashJoinStripeOuterUnmatched(HashJoinState *hjstate)
+{
+	HashJoinTable hashtable = hjstate->hj_HashTable;
+
+	return HJ_LAST_STRIPE(hashtable) &&
+		!ExecHashJoinOuterMatchedBefore(hashtable);
+}
+
+/*
+ * ExecHashJoinOuterMatchByte
+ *		find the byte holding the match bit of the current outer tuple
+ *
+ * The match bits of the outer tuples of a striped batch are kept in a
+ * temporary file, one block at a time.  Since the outer batch is always read
+ * sequentially, we rarely need to switch blocks.
+ */
+static uint8 *
+ExecHashJoinOuterMatchByte(HashJoinTable hashtable)
+{
+	long		chunkno;
+	int64		bitno;
+
+	Assert(hashtable->outerTupleNo >= 0);
+	chunkno = hashtable->outerTupleNo / HJ_MATCH_BITS_PER_CHUNK;
+	bitno = hashtable->outerTupleNo % HJ_MATCH_BITS_PER_CHUNK;
+
+	if (chunkno != hashtable->outerMatchChunkNo)
+	{
+		ExecHashJoinFlushMatchChunk(hashtable);
+
+		if (hashtable->outerMatchChunk == NULL)
+			hashtable->outerMatchChunk =
+				MemoryContextAlloc(hashtable->hashCxt, BLCKSZ);
+
+		if (chunkno < hashtable->outerMatchNChunks)
+		{
+			size_t		nread;
+
+			if (BufFileSeekBlock(hashtable->outerMatchFile, chunkno))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not seek in hash-join temporary file: %m")));
+			nread = BufFileRead(hashtable->outerMatchFile,
+								hashtable->outerMatchChunk, BLCKSZ);
+			if (nread != BLCKSZ)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from hash-join temporary file: read only %zu of %zu bytes",
+								nread, (size_t) BLCKSZ)));
+		}
+		else
+			memset(hashtable->outerMatchChunk, 0, BLCKSZ);
+		hashtable->outerMatchChunkNo = chunkno;
+	}
+
+	return &hashtable->outerMatchChunk[bitno / BITS_PER_BYTE];
+}
+
+/*
+ * Did the current outer tuple find a match in an earlier stripe?
+ */
+static bool
+ExecHashJoinOuterMatchedBefore(HashJoinTable hashtable)
+{
+	/* Nothing to remember on the first stripe. */
+	if (hashtable->curstripe == 0)
+		return false;
+
+	return (*ExecHashJoinOuterMatchByte(hashtable) &
+			(1 << (hashtable->outerTupleNo % BITS_PER_BYTE))) != 0;
+}
+
+/*
+ * Record that the current outer tuple has found a match.
+ */
+static void
+ExecHashJoinSetOuterMatched(HashJoinTable hashtable)
+{
+	uint8	   *byte = ExecHashJoinOuterMatchByte(hashtable);
+	uint8		mask = 1 << (hashtable->outerTupleNo % BITS_PER_BYTE);
+
+	if ((*byte & mask) == 0)
+	{
+		*byte |= mask;
+		hashtable->outerMatchDirty = true;
+	}
+}
+
+/*
+ * Write out the block of match bits we have in memory, if it has changed.
+ */
+static void
+ExecHashJoinFlushMatchChunk(HashJoinTable hashtable)
+{
+	if (hashtable->outerMatchDirty)
+	{
+		if (hashtable->outerMatchFile == NULL)
+			hashtable->outerMatchFile = BufFileCreateTemp(false);
+
+		/* Fill in any blocks we skipped over with zeroes. */
+		if (hashtable->outerMatchNChunks < hashtable->outerMatchChunkNo)
+		{
+			PGAlignedBlock zerobuf;
+
+			memset(zerobuf.data, 0, BLCKSZ);
+			if (BufFileSeekBlock(hashtable->outerMatchFile,
+								 hashtable->outerMatchNChunks))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not seek in hash-join temporary file: %m")));
+			while (hashtable->outerMatchNChunks < hashtable->outerMatchChunkNo)
+			{
+				BufFileWrite(hashtable->outerMatchFile, zerobuf.data, BLCKSZ);
+				hashtable->outerMatchNChunks++;
+			}
+		}
+
+		if (BufFileSeekBlock(hashtable->outerMatchFile,
+							 hashtable->outerMatchChunkNo))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek in hash-join temporary file: %m")));
+		BufFileWrite(hashtable->outerMatchFile,
+					 hashtable->outerMatchChunk, BLCKSZ);
+		hashtable->outerMatchNChunks = Max(hashtable->outerMatchNChunks,
+										   hashtable->outerMatchChunkNo + 1);
+		hashtable->outerMatchDirty = false;
+	}
+	hashtable->outerMatchChunkNo = -1;
+}
+
 /*
  * ExecHashJoinSaveTuple
  *		save a tuple to a batch file.
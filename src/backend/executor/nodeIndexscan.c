@@ -38,11 +38,14 @@
 #include "lib/pairingheap.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
+#include "storage/bufmgr.h"
 #include "utils/array.h"
 #include "utils/datum.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
+#include "utils/spccache.h"
 
 /*
  * When an ordering operator is used, tuples fetched from the index that
@@ -56,7 +59,27 @@ typedef struct
 	bool	   *orderbynulls;
 } ReorderTuple;
 
+/*
+ * When heap prefetching is enabled, TIDs returned by the index AM are queued
+ * ahead of the scan position as IndexPrefetchEntries, so that the heap blocks
+ * they point to can be prefetched before we actually need them.  When the
+ * scan must recheck WARM chains, we also keep a copy of each TID's index
+ * tuple, since the AM's one is gone by the time we fetch the TID.
+ */
+typedef struct IndexPrefetchEntry
+{
+	ItemPointerData tid;
+	bool		recheck;
+	IndexTuple	itup;
+} IndexPrefetchEntry;
+
 static TupleTableSlot *IndexNext(IndexScanState *node);
+static bool IndexFetchNextSlot(IndexScanState *node, IndexScanDesc scandesc,
+							   ScanDirection direction, TupleTableSlot *slot);
+static void IndexPrefetchFill(IndexScanState *node, IndexScanDesc scandesc,
+							  ScanDirection direction);
+static inline void IndexAdjustPrefetchTarget(IndexScanState *node);
+static void IndexPrefetchReset(IndexScanState *node);
 static TupleTableSlot *IndexNextWithReorder(IndexScanState *node);
 static void EvalOrderByExpressions(IndexScanState *node, ExprContext *econtext);
 static bool IndexRecheck(IndexScanState *node, TupleTableSlot *slot);
@@ -130,7 +153,7 @@ IndexNext(IndexScanState *node)
 	/*
 	 * ok, now that we have what we need, fetch the next tuple.
 	 */
-	while (index_getnext_slot(scandesc, direction, slot))
+	while (IndexFetchNextSlot(node, scandesc, direction, slot))
 	{
 		CHECK_FOR_INTERRUPTS();
 
@@ -160,6 +183,180 @@ IndexNext(IndexScanState *node)
 	return ExecClearTuple(slot);
 }
 
+/*
+ * IndexFetchNextSlot
+ *		Fetch the next tuple from the index scan into the slot.
+ *
+ * This is index_getnext_slot(), except that when heap prefetching is enabled
+ * for the node we read TIDs from the index ahead of the tuple being returned,
+ * and issue prefetch requests for the heap blocks they point to.
+ */
+static bool
+IndexFetchNextSlot(IndexScanState *node, IndexScanDesc scandesc,
+				   ScanDirection direction, TupleTableSlot *slot)
+{
+	IndexPrefetchEntry *queue = node->iss_PrefetchQueue;
+
+	if (queue == NULL)
+		return index_getnext_slot(scandesc, direction, slot);
+
+	for (;;)
+	{
+		bool		found;
+		IndexTuple	itup = NULL;
+
+		if (!scandesc->xs_heap_continue)
+		{
+			IndexPrefetchEntry *entry;
+
+			/* Top up the queue, then take the TID at its head */
+			IndexPrefetchFill(node, scandesc, direction);
+			if (node->iss_PrefetchCount == 0)
+				break;
+
+			entry = &queue[node->iss_PrefetchHead];
+			node->iss_PrefetchHead =
+				(node->iss_PrefetchHead + 1) % (node->iss_PrefetchMaximum + 1);
+			node->iss_PrefetchCount--;
+
+			scandesc->xs_heaptid = entry->tid;
+			scandesc->xs_recheck = entry->recheck;
+			IndexAdjustPrefetchTarget(node);
+
+			itup = entry->itup;
+			entry->itup = NULL;
+			if (itup != NULL)
+				scandesc->xs_itup = itup;
+		}
+
+		Assert(ItemPointerIsValid(&scandesc->xs_heaptid));
+		found = index_fetch_heap(scandesc, slot);
+
+		/*
+		 * With an MVCC snapshot, a single index_fetch_heap call is all we do
+		 * with a TID, so its index tuple can go.
+		 */
+		if (itup != NULL)
+		{
+			scandesc->xs_itup = NULL;
+			pfree(itup);
+		}
+
+		/*
+		 * index_fetch_heap may have asked the index AM to kill the entry for
+		 * this TID, but that is applied to the AM's current position, which
+		 * is only the TID we just fetched if nothing else is queued behind
+		 * it.  Otherwise we must forgo the hint.
+		 */
+		if (node->iss_PrefetchCount > 0)
+			scandesc->kill_prior_tuple = false;
+
+		if (found)
+			return true;
+	}
+
+	return false;
+}
+
+/*
+ * IndexPrefetchFill
+ *		Read TIDs from the index until the prefetch target is met.
+ *
+ * We keep the next TID to be returned plus iss_PrefetchTarget further TIDs in
+ * the queue, and prefetch the heap block of each TID queued behind the head,
+ * skipping runs of TIDs on the same block.
+ */
+static void
+IndexPrefetchFill(IndexScanState *node, IndexScanDesc scandesc,
+				  ScanDirection direction)
+{
+	int			queuesize = node->iss_PrefetchMaximum + 1;
+
+	while (!node->iss_PrefetchExhausted &&
+		   node->iss_PrefetchCount <= node->iss_PrefetchTarget)
+	{
+		ItemPointer tid;
+		IndexPrefetchEntry *entry;
+		BlockNumber blkno;
+
+		tid = index_getnext_tid(scandesc, direction);
+		if (tid == NULL)
+		{
+			/* Don't call the index AM again until we're rescanned */
+			node->iss_PrefetchExhausted = true;
+			break;
+		}
+
+		entry = &node->iss_PrefetchQueue[(node->iss_PrefetchHead +
+										  node->iss_PrefetchCount) % queuesize];
+		entry->tid = *tid;
+		entry->recheck = scandesc->xs_recheck;
+		entry->itup = scandesc->xs_recheck_warm ?
+			CopyIndexTuple(scandesc->xs_itup) : NULL;
+
+		/*
+		 * There's no point in prefetching the block of a TID we're about to
+		 * fetch right away, but remember it so that we don't prefetch it for
+		 * the TIDs that follow.
+		 */
+		blkno = ItemPointerGetBlockNumber(tid);
+		if (node->iss_PrefetchCount > 0 &&
+			blkno != node->iss_PrefetchLastBlock)
+			PrefetchBuffer(node->ss.ss_currentRelation, MAIN_FORKNUM, blkno);
+		node->iss_PrefetchLastBlock = blkno;
+
+		node->iss_PrefetchCount++;
+	}
+}
+
+/*
+ * IndexAdjustPrefetchTarget
+ *		Adjust the prefetch target
+ *
+ * As in bitmap heap scans, the target ramps up gradually so that scans which
+ * return only a few tuples (e.g., under a LIMIT) don't issue lots of useless
+ * prefetches: it goes from zero to one after the first tuple is returned, and
+ * then doubles until it reaches iss_PrefetchMaximum.
+ */
+static inline void
+IndexAdjustPrefetchTarget(IndexScanState *node)
+{
+	if (node->iss_PrefetchTarget >= node->iss_PrefetchMaximum)
+		 /* don't increase any further */ ;
+	else if (node->iss_PrefetchTarget >= node->iss_PrefetchMaximum / 2)
+		node->iss_PrefetchTarget = node->iss_PrefetchMaximum;
+	else if (node->iss_PrefetchTarget > 0)
+		node->iss_PrefetchTarget *= 2;
+	else
+		node->iss_PrefetchTarget++;
+}
+
+/*
+ * IndexPrefetchReset
+ *		Discard any TIDs read ahead, when the index scan is restarted.
+ */
+static void
+IndexPrefetchReset(IndexScanState *node)
+{
+	int			i;
+
+	for (i = 0; i < node->iss_PrefetchCount; i++)
+	{
+		IndexPrefetchEntry *entry;
+
+		entry = &node->iss_PrefetchQueue[(node->iss_PrefetchHead + i) %
+										 (node->iss_PrefetchMaximum + 1)];
+		if (entry->itup != NULL)
+			pfree(entry->itup);
+	}
+
+	node->iss_PrefetchHead = 0;
+	node->iss_PrefetchCount = 0;
+	node->iss_PrefetchTarget = 0;
+	node->iss_PrefetchLastBlock = InvalidBlockNumber;
+	node->iss_PrefetchExhausted = false;
+}
+
 /* ----------------------------------------------------------------
  *		IndexNextWithReorder
  *
@@ -578,6 +775,9 @@ ExecReScanIndexScan(IndexScanState *node)
 			reorderqueue_pop(node);
 	}
 
+	/* forget any TIDs we read ahead for prefetching */
+	IndexPrefetchReset(node);
+
 	/* reset index scan */
 	if (node->iss_ScanDesc)
 		index_rescan(node->iss_ScanDesc,
@@ -1079,6 +1279,36 @@ ExecInitIndexScan(IndexScan *node, EState *estate, int eflags)
 		indexstate->iss_RuntimeContext = NULL;
 	}
 
+	/*
+	 * Set up for prefetching heap blocks, if effective_io_concurrency (or the
+	 * tablespace's setting) allows it.  Reading TIDs ahead of the returned
+	 * tuple only works for scans that never change direction or restore a
+	 * mark, and we don't bother when tuples must be reordered.  The snapshot
+	 * must also be an MVCC one: the index AM may drop its pin on the index
+	 * page a queued TID came from, after which VACUUM could recycle the TID,
+	 * and only MVCC visibility rules make fetching such a TID harmless.
+	 */
+	indexstate->iss_PrefetchQueue = NULL;
+	indexstate->iss_PrefetchMaximum = 0;
+	IndexPrefetchReset(indexstate);
+#ifdef USE_PREFETCH
+	if (indexstate->iss_NumOrderByKeys == 0 &&
+		(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)) == 0 &&
+		IsMVCCSnapshot(estate->es_snapshot))
+	{
+		int			prefetch_maximum;
+
+		prefetch_maximum =
+			get_tablespace_io_concurrency(currentRelation->rd_rel->reltablespace);
+		if (prefetch_maximum > 0)
+		{
+			indexstate->iss_PrefetchMaximum = prefetch_maximum;
+			indexstate->iss_PrefetchQueue = (IndexPrefetchEntry *)
+				palloc((prefetch_maximum + 1) * sizeof(IndexPrefetchEntry));
+		}
+	}
+#endif							/* USE_PREFETCH */
+
 	/*
 	 * all done.
 	 */
@@ -58,6 +58,25 @@
 #include "utils/rel.h"
 
 
+/*
+ * When an INSERT buffers tuples for table_multi_insert(), the buffers are
+ * flushed once they hold this many tuples or this many bytes in total, over
+ * all result relations.  These are the same limits COPY FROM uses.
+ */
+#define MT_MAX_BUFFERED_TUPLES		1000
+#define MT_MAX_BUFFERED_BYTES		65535
+
+/*
+ * Trim the list of result relations owning multi-insert buffers back down to
+ * this number after flushing, like COPY FROM does.
+ */
+#define MT_MAX_PARTITION_BUFFERS	32
+
+#define HasAfterInsertRowTriggers(rri) \
+	((rri)->ri_TrigDesc != NULL && \
+	 ((rri)->ri_TrigDesc->trig_insert_after_row || \
+	  (rri)->ri_TrigDesc->trig_insert_new_table))
+
 static bool ExecOnConflictUpdate(ModifyTableState *mtstate,
 								 ResultRelInfo *resultRelInfo,
 								 ItemPointer conflictTid,
@@ -72,6 +91,13 @@ static TupleTableSlot *ExecPrepareTupleRouting(ModifyTableState *mtstate,
 											   ResultRelInfo *targetRelInfo,
 											   TupleTableSlot *slot,
 											   ResultRelInfo **partRelInfo);
+static bool ExecMultiInsertAllowed(ModifyTableState *mtstate,
+								   ResultRelInfo *resultRelInfo);
+static void ExecMultiInsertBufferTuple(ModifyTableState *mtstate,
+									   ResultRelInfo *resultRelInfo,
+									   TupleTableSlot *slot);
+static void ExecMultiInsertFlush(ModifyTableState *mtstate);
+static void ExecMultiInsertDropBuffer(ResultRelInfo *resultRelInfo);
 
 /*
  * Verify that the tuples to be produced by INSERT or UPDATE match the
@@ -360,6 +386,228 @@ ExecComputeStoredGenerated(ResultRelInfo *resultRelInfo,
 	MemoryContextSwitchTo(oldContext);
 }
 
+/*
+ * ExecMultiInsertAllowed
+ *
+ * Can the tuples to be inserted into the given result relation be buffered
+ * and inserted in batches with table_multi_insert()?
+ *
+ * BEFORE ROW and INSTEAD OF ROW triggers might query the table and act
+ * differently if the tuples already processed haven't been inserted yet, so
+ * those rule it out, as does a foreign table.
+ */
+static bool
+ExecMultiInsertAllowed(ModifyTableState *mtstate,
+					   ResultRelInfo *resultRelInfo)
+{
+	TriggerDesc *trigDesc = resultRelInfo->ri_TrigDesc;
+
+	if (!mtstate->mt_multi_insert)
+		return false;
+
+	if (resultRelInfo->ri_FdwRoutine != NULL)
+		return false;
+
+	if (trigDesc != NULL &&
+		(trigDesc->trig_insert_before_row ||
+		 trigDesc->trig_insert_instead_row))
+		return false;
+
+	return true;
+}
+
+/*
+ * ExecMultiInsertBufferTuple
+ *
+ * Add a copy of the tuple in 'slot' to the tuples buffered for the result
+ * relation, and flush all the buffers if they are full.
+ */
+static void
+ExecMultiInsertBufferTuple(ModifyTableState *mtstate,
+						   ResultRelInfo *resultRelInfo,
+						   TupleTableSlot *slot)
+{
+	EState	   *estate = mtstate->ps.state;
+	TupleTableSlot *batchslot;
+	MemoryContext oldcontext;
+
+	/*
+	 * AFTER ROW triggers are queued when the buffers are flushed, one result
+	 * relation after another.  To queue them in the order the tuples came
+	 * in, flush the buffers before moving on to another partition if either
+	 * partition has such triggers.
+	 */
+	if (mtstate->mt_buffered_tuples > 0)
+	{
+		ResultRelInfo *lastRelInfo = llast(mtstate->mt_multi_insert_rels);
+
+		if (lastRelInfo != resultRelInfo &&
+			(HasAfterInsertRowTriggers(lastRelInfo) ||
+			 HasAfterInsertRowTriggers(resultRelInfo)))
+			ExecMultiInsertFlush(mtstate);
+	}
+
+	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/*
+	 * mt_multi_insert_rels is kept in least recently used order, so that the
+	 * buffers of the partitions that haven't been used for the longest time
+	 * are the ones dropped when there are too many of them.
+	 */
+	if (resultRelInfo->ri_Slots == NULL)
+	{
+		resultRelInfo->ri_Slots = (TupleTableSlot **)
+			palloc0(sizeof(TupleTableSlot *) * MT_MAX_BUFFERED_TUPLES);
+		mtstate->mt_multi_insert_rels =
+			lappend(mtstate->mt_multi_insert_rels, resultRelInfo);
+	}
+	else if (llast(mtstate->mt_multi_insert_rels) != resultRelInfo)
+	{
+		mtstate->mt_multi_insert_rels =
+			list_delete_ptr(mtstate->mt_multi_insert_rels, resultRelInfo);
+		mtstate->mt_multi_insert_rels =
+			lappend(mtstate->mt_multi_insert_rels, resultRelInfo);
+	}
+
+	/*
+	 * Since slots are only created on demand, the next one may not exist.
+	 * They're not put in the executor's tuple table, so that they can be
+	 * dropped as soon as the buffer is.
+	 */
+	batchslot = resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots];
+	if (batchslot == NULL)
+	{
+		batchslot = table_slot_create(resultRelInfo->ri_RelationDesc, NULL);
+		resultRelInfo->ri_Slots[resultRelInfo->ri_NumSlots] = batchslot;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	ExecCopySlot(batchslot, slot);
+	batchslot->tts_tableOid = slot->tts_tableOid;
+	resultRelInfo->ri_NumSlots++;
+
+	/*
+	 * Keep track of how much data is buffered, by the size the tuple would
+	 * have as a heap tuple.
+	 */
+	slot_getallattrs(slot);
+	mtstate->mt_buffered_tuples++;
+	mtstate->mt_buffered_bytes +=
+		heap_compute_data_size(slot->tts_tupleDescriptor,
+							   slot->tts_values, slot->tts_isnull);
+
+	if (mtstate->mt_buffered_tuples >= MT_MAX_BUFFERED_TUPLES ||
+		mtstate->mt_buffered_bytes >= MT_MAX_BUFFERED_BYTES)
+		ExecMultiInsertFlush(mtstate);
+}
+
+/*
+ * ExecMultiInsertFlush
+ *
+ * Insert all the buffered tuples, and do the work that ExecInsert() does for
+ * each tuple after inserting it: insert index entries, queue AFTER ROW
+ * triggers and check WITH CHECK OPTIONs of parent views.
+ *
+ * Afterwards, the buffers of the least recently used result relations are
+ * dropped if there are more than MT_MAX_PARTITION_BUFFERS of them, so that an
+ * INSERT into many partitions doesn't keep slots for each of them.
+ */
+static void
+ExecMultiInsertFlush(ModifyTableState *mtstate)
+{
+	EState	   *estate = mtstate->ps.state;
+	ListCell   *lc;
+
+	foreach(lc, mtstate->mt_multi_insert_rels)
+	{
+		ResultRelInfo *resultRelInfo = (ResultRelInfo *) lfirst(lc);
+		TupleTableSlot **slots = resultRelInfo->ri_Slots;
+		int			nused = resultRelInfo->ri_NumSlots;
+		MemoryContext oldcontext;
+		int			i;
+
+		if (nused == 0)
+			continue;
+
+		/*
+		 * table_multi_insert may leak memory, so switch to short-lived
+		 * memory context before calling it.
+		 */
+		oldcontext = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+		table_multi_insert(resultRelInfo->ri_RelationDesc,
+						   slots,
+						   nused,
+						   estate->es_output_cid,
+						   0,
+						   mtstate->mt_bistate);
+		MemoryContextSwitchTo(oldcontext);
+
+		for (i = 0; i < nused; i++)
+		{
+			List	   *recheckIndexes = NIL;
+
+			if (resultRelInfo->ri_NumIndices > 0)
+				recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
+													   slots[i], estate,
+													   false, NULL, NIL);
+
+			ExecARInsertTriggers(estate, resultRelInfo, slots[i],
+								 recheckIndexes,
+								 mtstate->mt_transition_capture);
+
+			list_free(recheckIndexes);
+
+			if (resultRelInfo->ri_WithCheckOptions != NIL)
+				ExecWithCheckOptions(WCO_VIEW_CHECK, resultRelInfo,
+									 slots[i], estate);
+
+			if (mtstate->canSetTag)
+				setLastTid(&slots[i]->tts_tid);
+
+			ExecClearTuple(slots[i]);
+		}
+
+		resultRelInfo->ri_NumSlots = 0;
+	}
+
+	mtstate->mt_buffered_tuples = 0;
+	mtstate->mt_buffered_bytes = 0;
+
+	while (list_length(mtstate->mt_multi_insert_rels) > MT_MAX_PARTITION_BUFFERS)
+	{
+		ResultRelInfo *resultRelInfo = linitial(mtstate->mt_multi_insert_rels);
+
+		ExecMultiInsertDropBuffer(resultRelInfo);
+		mtstate->mt_multi_insert_rels =
+			list_delete_first(mtstate->mt_multi_insert_rels);
+	}
+}
+
+/*
+ * ExecMultiInsertDropBuffer
+ *
+ * Drop the slots of the result relation's multi-insert buffer, which must
+ * have been flushed.
+ */
+static void
+ExecMultiInsertDropBuffer(ResultRelInfo *resultRelInfo)
+{
+	int			i;
+
+	Assert(resultRelInfo->ri_NumSlots == 0);
+
+	for (i = 0; i < MT_MAX_BUFFERED_TUPLES; i++)
+	{
+		if (resultRelInfo->ri_Slots[i] == NULL)
+			break;
+		ExecDropSingleTupleTableSlot(resultRelInfo->ri_Slots[i]);
+	}
+
+	pfree(resultRelInfo->ri_Slots);
+	resultRelInfo->ri_Slots = NULL;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInsert
  *
@@ -389,6 +637,7 @@ ExecInsert(ModifyTableState *mtstate,
 	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
 	OnConflictAction onconflict = node->onConflictAction;
 	PartitionTupleRouting *proute = mtstate->mt_partition_tuple_routing;
+	bool		useMultiInsert;
 
 	/*
 	 * If the input result relation is a partitioned table, find the leaf
@@ -404,6 +653,14 @@ ExecInsert(ModifyTableState *mtstate,
 		resultRelInfo = partRelInfo;
 	}
 
+	/*
+	 * If this tuple can't be buffered, insert the tuples buffered so far
+	 * first, so that they are visible to the triggers of this one.
+	 */
+	useMultiInsert = ExecMultiInsertAllowed(mtstate, resultRelInfo);
+	if (!useMultiInsert && mtstate->mt_buffered_tuples > 0)
+		ExecMultiInsertFlush(mtstate);
+
 	ExecMaterializeSlot(slot);
 
 	resultRelationDesc = resultRelInfo->ri_RelationDesc;
@@ -629,12 +886,26 @@ ExecInsert(ModifyTableState *mtstate,
 
 			/* Since there was no insertion conflict, we're done */
 		}
+		else if (useMultiInsert)
+		{
+			/*
+			 * Buffer the tuple.  The rest of the work for it, from inserting
+			 * index entries to checking view WITH CHECK OPTIONs, is done
+			 * once it has been inserted, when the buffers are flushed.
+			 */
+			ExecMultiInsertBufferTuple(mtstate, resultRelInfo, slot);
+
+			if (canSetTag)
+				(estate->es_processed)++;
+
+			return NULL;
+		}
 		else
 		{
 			/* insert the tuple normally */
 			table_tuple_insert(resultRelationDesc, slot,
 							   estate->es_output_cid,
-							   0, NULL);
+							   0, mtstate->mt_bistate);
 
 			/* insert index entries for tuple */
 			if (resultRelInfo->ri_NumIndices > 0)
@@ -1277,7 +1548,7 @@ ExecUpdate(ModifyTableState *mtstate,
 	{
 		LockTupleMode lockmode;
 		bool		partition_constraint_failed;
-		bool		update_indexes;
+		TU_IndexUpdate update_indexes;
 
 		/*
 		 * Constraints might reference the tableoid column, so (re-)initialize
@@ -1512,10 +1783,11 @@ lreplace:;
 		}
 
 		/* insert index entries for tuple if necessary */
-		if (resultRelInfo->ri_NumIndices > 0 && update_indexes)
-			recheckIndexes = ExecInsertIndexTuples(resultRelInfo,
-												   slot, estate, false,
-												   NULL, NIL);
+		if (resultRelInfo->ri_NumIndices > 0 && update_indexes.required)
+			recheckIndexes = ExecUpdateIndexTuples(resultRelInfo,
+												   slot, estate,
+												   &update_indexes);
+		bms_free(update_indexes.modified_attrs);
 	}
 
 	if (canSetTag)
@@ -2155,6 +2427,12 @@ ExecModifyTable(PlanState *pstate)
 			return slot;
 	}
 
+	/*
+	 * Insert any tuples still waiting in the multi-insert buffers.
+	 */
+	if (node->mt_buffered_tuples > 0)
+		ExecMultiInsertFlush(node);
+
 	/*
 	 * We're done, but fire AFTER STATEMENT triggers before exiting.
 	 */
@@ -2198,6 +2476,16 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	mtstate->canSetTag = node->canSetTag;
 	mtstate->mt_done = false;
 
+	/*
+	 * In a parallel INSERT, each participant fills pages of its own rather
+	 * than competing with the others for the same free space.
+	 */
+	if (node->plan.parallel_aware)
+	{
+		Assert(operation == CMD_INSERT);
+		mtstate->mt_bistate = GetBulkInsertState();
+	}
+
 	mtstate->mt_plans = (PlanState **) palloc0(sizeof(PlanState *) * nplans);
 	mtstate->resultRelInfo = (ResultRelInfo *)
 		palloc(nplans * sizeof(ResultRelInfo));
@@ -2359,6 +2647,18 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		mtstate->mt_partition_tuple_routing =
 			ExecSetupPartitionTupleRouting(estate, mtstate, rel);
 
+	/*
+	 * Decide whether the tuples of an INSERT can be buffered and inserted in
+	 * batches; see ExecMultiInsertAllowed() for the per-relation checks.
+	 * When routing tuples to partitions while capturing transition tuples,
+	 * the original tuple is remembered in mt_transition_capture for the AFTER
+	 * ROW triggers of the current row only, so each row must be inserted
+	 * before the next one is routed.
+	 */
+	mtstate->mt_multi_insert = node->multiInsert &&
+		!(mtstate->mt_partition_tuple_routing != NULL &&
+		  mtstate->mt_transition_capture != NULL);
+
 	/*
 	 * For update row movement we'll need a dedicated slot to store the tuples
 	 * that have been converted from partition format to the root table
@@ -2683,6 +2983,7 @@ void
 ExecEndModifyTable(ModifyTableState *node)
 {
 	int			i;
+	ListCell   *lc;
 
 	/*
 	 * Allow any FDWs to shut down
@@ -2698,6 +2999,14 @@ ExecEndModifyTable(ModifyTableState *node)
 														   resultRelInfo);
 	}
 
+	/*
+	 * Drop the multi-insert buffers, which have all been flushed by now.
+	 */
+	foreach(lc, node->mt_multi_insert_rels)
+		ExecMultiInsertDropBuffer((ResultRelInfo *) lfirst(lc));
+	list_free(node->mt_multi_insert_rels);
+	node->mt_multi_insert_rels = NIL;
+
 	/*
 	 * Close all the partitioned tables, leaf partitions, and their indices
 	 * and release the slot used for tuple routing, if set.
@@ -2726,6 +3035,12 @@ ExecEndModifyTable(ModifyTableState *node)
 	 */
 	EvalPlanQualEnd(&node->mt_epqstate);
 
+	/*
+	 * Release the bulk insert state, if any
+	 */
+	if (node->mt_bistate)
+		FreeBulkInsertState(node->mt_bistate);
+
 	/*
 	 * shut down subplans
 	 */
@@ -28,12 +28,19 @@
 #include "postgres.h"
 
 #include "access/relscan.h"
+#include "access/stratnum.h"
+#include "access/sysattr.h"
 #include "access/tableam.h"
 #include "executor/execdebug.h"
 #include "executor/nodeSeqscan.h"
+#include "optimizer/optimizer.h"
+#include "utils/lsyscache.h"
 #include "utils/rel.h"
+#include "utils/typcache.h"
 
 static TupleTableSlot *SeqNext(SeqScanState *node);
+static void SeqScanInitHints(SeqScanState *node);
+static void SeqScanAddHintKey(SeqScanState *node, OpExpr *op);
 
 /* ----------------------------------------------------------------
  *						Scan Support
@@ -72,6 +79,9 @@ SeqNext(SeqScanState *node)
 								   estate->es_snapshot,
 								   0, NULL);
 		node->ss.ss_currentScanDesc = scandesc;
+		if (node->use_hints)
+			table_scan_set_hints(scandesc, node->hint_attrs,
+								 node->hint_nkeys, node->hint_keys);
 	}
 
 	/*
@@ -114,6 +124,138 @@ ExecSeqScan(PlanState *pstate)
 					(ExecScanRecheckMtd) SeqRecheck);
 }
 
+/*
+ * SeqScanInitHints -- work out the hints to pass to the table AM
+ *
+ * The hints are the columns referenced by the target list and the quals,
+ * and those quals that compare a column to a constant with a btree
+ * operator, which an AM keeping per-block value ranges can use to skip
+ * tuples.  Equality is passed as a pair of <= and >= keys, as an AM can use
+ * those without knowing anything about the operator family.
+ */
+static void
+SeqScanInitHints(SeqScanState *node)
+{
+	Scan	   *plan = (Scan *) node->ss.ps.plan;
+	Bitmapset  *attrs = NULL;
+	ListCell   *lc;
+	int			x;
+
+	node->use_hints = true;
+
+	pull_varattnos((Node *) plan->plan.targetlist, plan->scanrelid, &attrs);
+	pull_varattnos((Node *) plan->plan.qual, plan->scanrelid, &attrs);
+
+	/* A whole-row reference needs all columns */
+	if (!bms_is_member(0 - FirstLowInvalidHeapAttributeNumber, attrs))
+	{
+		node->hint_attrs = NULL;
+		x = -1;
+		while ((x = bms_next_member(attrs, x)) >= 0)
+		{
+			AttrNumber	attno = x + FirstLowInvalidHeapAttributeNumber;
+
+			if (attno > 0)
+				node->hint_attrs = bms_add_member(node->hint_attrs, attno);
+		}
+
+		/* A scan that needs no column at all still returns its rows */
+		if (node->hint_attrs == NULL)
+			node->hint_attrs = bms_make_singleton(1);
+	}
+
+	/* Room for two keys per qual, in case they are all equalities */
+	node->hint_keys = (ScanKey) palloc(sizeof(ScanKeyData) *
+									   2 * list_length(plan->plan.qual));
+	node->hint_nkeys = 0;
+	foreach(lc, plan->plan.qual)
+	{
+		Node	   *qual = (Node *) lfirst(lc);
+
+		if (IsA(qual, OpExpr) && list_length(((OpExpr *) qual)->args) == 2)
+			SeqScanAddHintKey(node, (OpExpr *) qual);
+	}
+}
+
+/*
+ * SeqScanAddHintKey -- turn "column op constant" into hint keys, if possible
+ */
+static void
+SeqScanAddHintKey(SeqScanState *node, OpExpr *op)
+{
+	Scan	   *plan = (Scan *) node->ss.ps.plan;
+	Node	   *left = (Node *) linitial(op->args);
+	Node	   *right = (Node *) lsecond(op->args);
+	Oid			opno = op->opno;
+	Var		   *var;
+	Const	   *con;
+	TypeCacheEntry *typentry;
+	Oid			lefttype;
+	Oid			righttype;
+	int			strategy;
+
+	if (IsA(left, Var) && IsA(right, Const))
+	{
+		var = (Var *) left;
+		con = (Const *) right;
+	}
+	else if (IsA(left, Const) && IsA(right, Var))
+	{
+		var = (Var *) right;
+		con = (Const *) left;
+		opno = get_commutator(opno);
+		if (!OidIsValid(opno))
+			return;
+	}
+	else
+		return;
+
+	if (var->varno != plan->scanrelid || var->varattno <= 0 ||
+		var->varlevelsup != 0 || con->constisnull)
+		return;
+
+	/* The AM compares values using the column's collation */
+	if (op->inputcollid != var->varcollid)
+		return;
+
+	typentry = lookup_type_cache(var->vartype, TYPECACHE_BTREE_OPFAMILY);
+	if (!OidIsValid(typentry->btree_opf))
+		return;
+	strategy = get_op_opfamily_strategy(opno, typentry->btree_opf);
+	if (strategy == 0)
+		return;
+	op_input_types(opno, &lefttype, &righttype);
+	if (lefttype != var->vartype)
+		return;
+
+	if (strategy == BTEqualStrategyNumber)
+	{
+		Oid			leop = get_opfamily_member(typentry->btree_opf,
+											   lefttype, righttype,
+											   BTLessEqualStrategyNumber);
+		Oid			geop = get_opfamily_member(typentry->btree_opf,
+											   lefttype, righttype,
+											   BTGreaterEqualStrategyNumber);
+
+		if (!OidIsValid(leop) || !OidIsValid(geop))
+			return;
+
+		ScanKeyEntryInitialize(&node->hint_keys[node->hint_nkeys++], 0,
+							   var->varattno, BTLessEqualStrategyNumber,
+							   righttype, op->inputcollid,
+							   get_opcode(leop), con->constvalue);
+		ScanKeyEntryInitialize(&node->hint_keys[node->hint_nkeys++], 0,
+							   var->varattno, BTGreaterEqualStrategyNumber,
+							   righttype, op->inputcollid,
+							   get_opcode(geop), con->constvalue);
+	}
+	else
+		ScanKeyEntryInitialize(&node->hint_keys[node->hint_nkeys++], 0,
+							   var->varattno, strategy,
+							   righttype, op->inputcollid,
+							   get_opcode(opno), con->constvalue);
+}
+
 
 /* ----------------------------------------------------------------
  *		ExecInitSeqScan
@@ -171,6 +313,13 @@ ExecInitSeqScan(SeqScan *node, EState *estate, int eflags)
 	scanstate->ss.ps.qual =
 		ExecInitQual(node->plan.qual, (PlanState *) scanstate);
 
+	/*
+	 * If the table AM can make use of it, work out what the scan is used
+	 * for.
+	 */
+	if (scanstate->ss.ss_currentRelation->rd_tableam->scan_set_hints != NULL)
+		SeqScanInitHints(scanstate);
+
 	return scanstate;
 }
 
@@ -278,6 +427,9 @@ ExecSeqScanInitializeDSM(SeqScanState *node,
 	shm_toc_insert(pcxt->toc, node->ss.ps.plan->plan_node_id, pscan);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	if (node->use_hints)
+		table_scan_set_hints(node->ss.ss_currentScanDesc, node->hint_attrs,
+							 node->hint_nkeys, node->hint_keys);
 }
 
 /* ----------------------------------------------------------------
@@ -311,4 +463,7 @@ ExecSeqScanInitializeWorker(SeqScanState *node,
 	pscan = shm_toc_lookup(pwcxt->toc, node->ss.ps.plan->plan_node_id, false);
 	node->ss.ss_currentScanDesc =
 		table_beginscan_parallel(node->ss.ss_currentRelation, pscan);
+	if (node->use_hints)
+		table_scan_set_hints(node->ss.ss_currentScanDesc, node->hint_attrs,
+							 node->hint_nkeys, node->hint_keys);
 }
@@ -67,6 +67,7 @@ ExecSort(PlanState *pstate)
 		Sort	   *plannode = (Sort *) node->ss.ps.plan;
 		PlanState  *outerNode;
 		TupleDesc	tupDesc;
+		double		ntuples = 0;
 
 		SO1_printf("ExecSort: %s\n",
 				   "sorting subplan");
@@ -111,8 +112,14 @@ ExecSort(PlanState *pstate)
 				break;
 
 			tuplesort_puttupleslot(tuplesortstate, slot);
+			ntuples += 1;
 		}
 
+		/* See whether the planner's estimate of our input was way off */
+		if (plannode->feedbackKey != 0)
+			ExecCheckCardinality(&node->ss.ps, plannode->feedbackKey,
+								 plannode->feedbackRelids, ntuples);
+
 		/*
 		 * Complete the sort.
 		 */
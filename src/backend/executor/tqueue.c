@@ -8,6 +8,25 @@
  *
  * A TupleQueueReader reads tuples from a shm_mq and returns the tuples.
  *
+ * Sending every tuple as a message of its own makes the leader pay for a
+ * latch handshake per tuple, which limits the throughput of Gather when the
+ * tuples are narrow.  So the sender packs tuples into batches: each message
+ * consists of one or more MinimalTuples, each starting at a MAXALIGN'd
+ * offset, and the reader walks through them without copying.  The first
+ * tuple is sent right away, so that the leader gets going quickly; after
+ * that, the batch size starts out small and doubles with every message sent,
+ * up to TQUEUE_MAX_BATCH_SIZE.
+ *
+ * A partial batch mustn't wait for long, though: the next tuple may be a long
+ * way off, for example in a selective scan, and the leader may need just the
+ * tuples we are holding back to satisfy a LIMIT.  So whenever a batch is
+ * started, a timeout is armed, and when it fires, the next
+ * CHECK_FOR_INTERRUPTS() sends whatever the batch holds by then.  That send
+ * must not wait for room in the queue: the CHECK_FOR_INTERRUPTS() may be in
+ * a barrier wait, and if the leader is waiting at the same barrier, it won't
+ * read the queue until we arrive.  So if the queue is full, the batch is kept
+ * and the timeout armed again.
+ *
  * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
  *
@@ -21,6 +40,21 @@
 
 #include "access/htup_details.h"
 #include "executor/tqueue.h"
+#include "miscadmin.h"
+#include "utils/timeout.h"
+
+/*
+ * Size of the first batch after the first tuple, and the upper limit batches
+ * grow to.  The limit
+ * is small compared to the tuple queues set up by execParallel.c, so that
+ * the sender can keep filling a batch while the leader reads the previous
+ * ones.
+ */
+#define TQUEUE_MIN_BATCH_SIZE	256
+#define TQUEUE_MAX_BATCH_SIZE	8192
+
+/* Longest time, in milliseconds, that a tuple may wait in a partial batch */
+#define TQUEUE_FLUSH_DELAY		10
 
 /*
  * DestReceiver object's private contents
@@ -31,22 +65,102 @@ typedef struct TQueueDestReceiver
 {
 	DestReceiver pub;			/* public fields */
 	shm_mq_handle *queue;		/* shm_mq to send to */
+	char	   *batch;			/* tuples not sent yet */
+	Size		batch_used;		/* bytes used in batch */
+	Size		batch_target;	/* send the batch once it is this full */
+	bool		busy;			/* in tqueueReceiveSlot; don't flush now */
+	bool		partial;		/* batch partly sent; resend it unchanged */
+	bool		detached;		/* reader has detached from the queue */
 } TQueueDestReceiver;
 
 /*
  * TupleQueueReader object's private contents
  *
- * queue is a pointer to data supplied by reader's caller.
+ * queue is a pointer to data supplied by reader's caller.  The message last
+ * received is kept, so that we can return the tuples it holds one by one.
  *
  * "typedef struct TupleQueueReader TupleQueueReader" is in tqueue.h
  */
 struct TupleQueueReader
 {
 	shm_mq_handle *queue;		/* shm_mq to receive from */
+	char	   *data;			/* current message */
+	Size		nbytes;			/* length of current message */
+	Size		offset;			/* offset of next tuple in message */
 };
 
+/* Set by the flush timeout; see HandleTupleQueueFlush */
+volatile bool TupleQueueFlushPending = false;
+
+/* The receiver whose batch the flush timeout is for, if any */
+static TQueueDestReceiver *flush_tqueue = NULL;
+
+static void TupleQueueFlushTimeoutHandler(void);
+
 /*
- * Receive a tuple from a query, and send it to the designated shm_mq.
+ * Send one message to the designated shm_mq.
+ *
+ * Returns SHM_MQ_SUCCESS, SHM_MQ_DETACHED if shm_mq has been detached, or,
+ * with nowait, SHM_MQ_WOULD_BLOCK if there's no room in the queue.
+ */
+static shm_mq_result
+tqueueSend(TQueueDestReceiver *tqueue, Size nbytes, const void *data,
+		   bool nowait)
+{
+	shm_mq_result result;
+
+	result = shm_mq_send(tqueue->queue, nbytes, data, nowait);
+
+	/* Check for failure. */
+	if (result == SHM_MQ_DETACHED)
+	{
+		tqueue->detached = true;
+		return result;
+	}
+	else if (result == SHM_MQ_WOULD_BLOCK && nowait)
+		return result;
+	else if (result != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not send tuple to shared-memory queue")));
+
+	return result;
+}
+
+/*
+ * Send the batch built up so far, if any, and make the next one bigger.
+ *
+ * With nowait, returns SHM_MQ_WOULD_BLOCK if the queue is full.  The batch
+ * may then have been sent in part, and shm_mq requires the rest of the same
+ * message to be sent next, so the batch is kept as it is until it has been
+ * sent.
+ */
+static shm_mq_result
+tqueueFlushBatch(TQueueDestReceiver *tqueue, bool nowait)
+{
+	shm_mq_result result;
+
+	if (tqueue->batch_used == 0)
+		return SHM_MQ_SUCCESS;
+
+	result = tqueueSend(tqueue, tqueue->batch_used, tqueue->batch, nowait);
+	if (result == SHM_MQ_WOULD_BLOCK)
+	{
+		tqueue->partial = true;
+		return result;
+	}
+	tqueue->partial = false;
+	tqueue->batch_used = 0;
+	tqueue->batch_target = Max(tqueue->batch_target * 2,
+							   TQUEUE_MIN_BATCH_SIZE);
+	tqueue->batch_target = Min(tqueue->batch_target, TQUEUE_MAX_BATCH_SIZE);
+
+	return result;
+}
+
+/*
+ * Receive a tuple from a query, and add it to the batch for the designated
+ * shm_mq, sending the batch if it's full enough.
  *
  * Returns true if successful, false if shm_mq has been detached.
  */
@@ -55,25 +169,106 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 	MinimalTuple tuple;
-	shm_mq_result result;
+	Size		len;
 	bool		should_free;
+	bool		result = true;
+
+	/* A flush at CHECK_FOR_INTERRUPTS() time may have found the reader gone */
+	if (tqueue->detached)
+		return false;
+
+	tqueue->busy = true;
+
+	/* Finish sending a batch that a flush got partway through */
+	if (tqueue->partial &&
+		tqueueFlushBatch(tqueue, false) == SHM_MQ_DETACHED)
+	{
+		tqueue->busy = false;
+		return false;
+	}
 
-	/* Send the tuple itself. */
 	tuple = ExecFetchSlotMinimalTuple(slot, &should_free);
-	result = shm_mq_send(tqueue->queue, tuple->t_len, tuple, false);
+	len = MAXALIGN(tuple->t_len);
+
+	/* Make room for the tuple, if necessary. */
+	if (tqueue->batch_used + len > TQUEUE_MAX_BATCH_SIZE &&
+		tqueueFlushBatch(tqueue, false) == SHM_MQ_DETACHED)
+		result = false;
+	else if (len > TQUEUE_MAX_BATCH_SIZE)
+	{
+		/* Too big to be batched, so send it as a message of its own. */
+		result = (tqueueSend(tqueue, tuple->t_len, tuple, false) ==
+				  SHM_MQ_SUCCESS);
+	}
+	else
+	{
+		memcpy(tqueue->batch + tqueue->batch_used, tuple, tuple->t_len);
+		tqueue->batch_used += len;
+		if (tqueue->batch_used >= tqueue->batch_target)
+			result = (tqueueFlushBatch(tqueue, false) == SHM_MQ_SUCCESS);
+		else if (!get_timeout_active(TUPLE_QUEUE_FLUSH_TIMEOUT))
+		{
+			/*
+			 * Make sure the batch gets sent soon.  The timeout is usually
+			 * still armed for an earlier batch, in which case this one will
+			 * just be sent a little sooner than necessary.  If it fired
+			 * while we were busy here, we arm it again.
+			 */
+			enable_timeout_after(TUPLE_QUEUE_FLUSH_TIMEOUT,
+								 TQUEUE_FLUSH_DELAY);
+		}
+	}
 
 	if (should_free)
 		pfree(tuple);
+	tqueue->busy = false;
 
-	/* Check for failure. */
-	if (result == SHM_MQ_DETACHED)
-		return false;
-	else if (result != SHM_MQ_SUCCESS)
-		ereport(ERROR,
-				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
-				 errmsg("could not send tuple to shared-memory queue")));
+	return result;
+}
 
-	return true;
+/*
+ * Timeout handler for TUPLE_QUEUE_FLUSH_TIMEOUT.
+ *
+ * We can't send anything from a signal handler, so just ask for the batch to
+ * be sent at the next CHECK_FOR_INTERRUPTS().
+ */
+static void
+TupleQueueFlushTimeoutHandler(void)
+{
+	TupleQueueFlushPending = true;
+	InterruptPending = true;
+}
+
+/*
+ * Send the partial batch that the flush timeout was armed for.
+ *
+ * Called from ProcessInterrupts() when TupleQueueFlushPending is set.  If we
+ * are in the middle of adding a tuple to the batch, or of sending one, we do
+ * nothing: the batch will be sent when it's full, and if the queue is full,
+ * the reader has plenty to do anyway.
+ *
+ * We may be called from any CHECK_FOR_INTERRUPTS(), including one in a wait
+ * for other processes, so we must not wait for the reader here.  If the
+ * queue is full, we keep the batch and try again after another delay.
+ */
+void
+HandleTupleQueueFlush(void)
+{
+	shm_mq_result result;
+
+	TupleQueueFlushPending = false;
+
+	if (flush_tqueue == NULL || flush_tqueue->busy ||
+		flush_tqueue->detached)
+		return;
+
+	flush_tqueue->busy = true;
+	result = tqueueFlushBatch(flush_tqueue, true);
+	flush_tqueue->busy = false;
+
+	if (result == SHM_MQ_WOULD_BLOCK &&
+		!get_timeout_active(TUPLE_QUEUE_FLUSH_TIMEOUT))
+		enable_timeout_after(TUPLE_QUEUE_FLUSH_TIMEOUT, TQUEUE_FLUSH_DELAY);
 }
 
 /*
@@ -82,7 +277,17 @@ tqueueReceiveSlot(TupleTableSlot *slot, DestReceiver *self)
 static void
 tqueueStartupReceiver(DestReceiver *self, int operation, TupleDesc typeinfo)
 {
-	/* do nothing */
+	static bool timeout_registered = false;
+
+	if (!timeout_registered)
+	{
+		RegisterTimeout(TUPLE_QUEUE_FLUSH_TIMEOUT,
+						TupleQueueFlushTimeoutHandler);
+		timeout_registered = true;
+	}
+
+	Assert(flush_tqueue == NULL);
+	flush_tqueue = (TQueueDestReceiver *) self;
 }
 
 /*
@@ -93,8 +298,19 @@ tqueueShutdownReceiver(DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
+	if (flush_tqueue == tqueue)
+	{
+		flush_tqueue = NULL;
+		if (get_timeout_active(TUPLE_QUEUE_FLUSH_TIMEOUT))
+			disable_timeout(TUPLE_QUEUE_FLUSH_TIMEOUT, false);
+	}
+
 	if (tqueue->queue != NULL)
+	{
+		/* Send what's left; it doesn't matter if the reader is gone */
+		(void) tqueueFlushBatch(tqueue, false);
 		shm_mq_detach(tqueue->queue);
+	}
 	tqueue->queue = NULL;
 }
 
@@ -106,9 +322,13 @@ tqueueDestroyReceiver(DestReceiver *self)
 {
 	TQueueDestReceiver *tqueue = (TQueueDestReceiver *) self;
 
+	if (flush_tqueue == tqueue)
+		flush_tqueue = NULL;
+
 	/* We probably already detached from queue, but let's be sure */
 	if (tqueue->queue != NULL)
 		shm_mq_detach(tqueue->queue);
+	pfree(tqueue->batch);
 	pfree(self);
 }
 
@@ -128,6 +348,12 @@ CreateTupleQueueDestReceiver(shm_mq_handle *handle)
 	self->pub.rDestroy = tqueueDestroyReceiver;
 	self->pub.mydest = DestTupleQueue;
 	self->queue = handle;
+	self->batch = palloc(TQUEUE_MAX_BATCH_SIZE);
+	self->batch_used = 0;
+	self->batch_target = 0;		/* send the first tuple by itself */
+	self->busy = false;
+	self->partial = false;
+	self->detached = false;
 
 	return (DestReceiver *) self;
 }
@@ -166,7 +392,9 @@ DestroyTupleQueueReader(TupleQueueReader *reader)
  *
  * The returned tuple, if any, is either in shared memory or a private buffer
  * and should not be freed.  The pointer is invalid after the next call to
- * TupleQueueReaderNext().
+ * TupleQueueReaderNext().  The tuples of a batch are returned one by one
+ * from the message as received, and the message is consumed only when we
+ * ask for the next one.
  *
  * Even when shm_mq_receive() returns SHM_MQ_WOULD_BLOCK, this can still
  * accumulate bytes from a partially-read message, so it's useful to call
@@ -183,6 +411,17 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 	if (done != NULL)
 		*done = false;
 
+	/* Return the next tuple of the current message, if any. */
+	if (reader->offset < reader->nbytes)
+	{
+		tuple = (MinimalTuple) (reader->data + reader->offset);
+		reader->offset += MAXALIGN(tuple->t_len);
+		Assert(reader->offset <= MAXALIGN(reader->nbytes));
+		return tuple;
+	}
+	reader->data = NULL;
+	reader->nbytes = reader->offset = 0;
+
 	/* Attempt to read a message. */
 	result = shm_mq_receive(reader->queue, &nbytes, &data, nowait);
 
@@ -201,10 +440,17 @@ TupleQueueReaderNext(TupleQueueReader *reader, bool nowait, bool *done)
 
 	/*
 	 * Return a pointer to the queue memory directly (which had better be
-	 * sufficiently aligned).
+	 * sufficiently aligned).  If there's more than one tuple in the message,
+	 * remember where the next one is.
 	 */
 	tuple = (MinimalTuple) data;
-	Assert(tuple->t_len == nbytes);
+	Assert(tuple->t_len <= nbytes);
+	if (MAXALIGN(tuple->t_len) < nbytes)
+	{
+		reader->data = (char *) data;
+		reader->nbytes = nbytes;
+		reader->offset = MAXALIGN(tuple->t_len);
+	}
 
 	return tuple;
 }
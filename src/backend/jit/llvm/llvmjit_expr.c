@@ -421,6 +421,12 @@ llvm_compile_expr(ExprState *state)
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
+			case EEOP_VAR_DETOAST:
+				build_EvalXFunc(b, mod, "ExecEvalVarDetoast",
+								v_state, op, v_econtext);
+				LLVMBuildBr(b, opblocks[opno + 1]);
+				break;
+
 			case EEOP_ASSIGN_INNER_VAR:
 			case EEOP_ASSIGN_OUTER_VAR:
 			case EEOP_ASSIGN_SCAN_VAR:
@@ -1918,6 +1924,41 @@ llvm_compile_expr(ExprState *state)
 				LLVMBuildBr(b, opblocks[opno + 1]);
 				break;
 
+			case EEOP_CSE_RESET:
+				build_EvalXFunc(b, mod, "ExecEvalCSEReset",
+								v_state, op);
+				LLVMBuildBr(b, opblocks[opno + 1]);
+				break;
+
+			case EEOP_CSE_MARK_FRESH:
+				build_EvalXFunc(b, mod, "ExecEvalCSEMarkFresh",
+								v_state, op);
+				LLVMBuildBr(b, opblocks[opno + 1]);
+				break;
+
+			case EEOP_CSE_FETCH:
+				{
+					int			jumpdone = op->d.cse.jumpdone;
+					LLVMValueRef v_ret;
+
+					v_ret = build_EvalXFunc(b, mod, "ExecEvalCSEFetch",
+											v_state, op);
+					v_ret = LLVMBuildZExt(b, v_ret, TypeStorageBool, "");
+
+					LLVMBuildCondBr(b,
+									LLVMBuildICmp(b, LLVMIntEQ, v_ret,
+												  l_sbool_const(1), ""),
+									opblocks[jumpdone],
+									opblocks[opno + 1]);
+					break;
+				}
+
+			case EEOP_CSE_STORE:
+				build_EvalXFunc(b, mod, "ExecEvalCSEStore",
+								v_state, op);
+				LLVMBuildBr(b, opblocks[opno + 1]);
+				break;
+
 			case EEOP_AGG_STRICT_DESERIALIZE:
 			case EEOP_AGG_DESERIALIZE:
 				{
@@ -106,6 +106,10 @@ void	   *referenced_functions[] =
 	ExecEvalArrayExpr,
 	ExecEvalConstraintCheck,
 	ExecEvalConstraintNotNull,
+	ExecEvalCSEFetch,
+	ExecEvalCSEMarkFresh,
+	ExecEvalCSEReset,
+	ExecEvalCSEStore,
 	ExecEvalConvertRowtype,
 	ExecEvalCurrentOfExpr,
 	ExecEvalFieldSelect,
@@ -129,6 +133,7 @@ void	   *referenced_functions[] =
 	ExecEvalSubscriptingRefFetch,
 	ExecEvalSubscriptingRefOld,
 	ExecEvalSysVar,
+	ExecEvalVarDetoast,
 	ExecEvalWholeRowVar,
 	ExecEvalXmlExpr,
 	MakeExpandedObjectReadOnlyInternal,
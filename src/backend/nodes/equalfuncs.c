@@ -2780,6 +2780,7 @@ _equalWindowClause(const WindowClause *a, const WindowClause *b)
 	COMPARE_SCALAR_FIELD(inRangeColl);
 	COMPARE_SCALAR_FIELD(inRangeAsc);
 	COMPARE_SCALAR_FIELD(inRangeNullsFirst);
+	COMPARE_NODE_FIELD(runCondition);
 	COMPARE_SCALAR_FIELD(winref);
 	COMPARE_SCALAR_FIELD(copiedOrder);
 
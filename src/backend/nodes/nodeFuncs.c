@@ -2155,6 +2155,8 @@ expression_tree_walker(Node *node,
 					return true;
 				if (walker(wc->endOffset, context))
 					return true;
+				if (walker(wc->runCondition, context))
+					return true;
 			}
 			break;
 		case T_CommonTableExpr:
@@ -2384,6 +2386,8 @@ query_tree_walker(Query *query,
 				return true;
 			if (walker(wc->endOffset, context))
 				return true;
+			if (walker(wc->runCondition, context))
+				return true;
 		}
 	}
 
@@ -3025,6 +3029,7 @@ expression_tree_mutator(Node *node,
 				MUTATE(newnode->orderClause, wc->orderClause, List *);
 				MUTATE(newnode->startOffset, wc->startOffset, Node *);
 				MUTATE(newnode->endOffset, wc->endOffset, Node *);
+				MUTATE(newnode->runCondition, wc->runCondition, List *);
 				return (Node *) newnode;
 			}
 			break;
@@ -3304,6 +3309,7 @@ query_tree_mutator(Query *query,
 			FLATCOPY(newnode, wc, WindowClause);
 			MUTATE(newnode->startOffset, wc->startOffset, Node *);
 			MUTATE(newnode->endOffset, wc->endOffset, Node *);
+			MUTATE(newnode->runCondition, wc->runCondition, List *);
 
 			resultlist = lappend(resultlist, (Node *) newnode);
 		}
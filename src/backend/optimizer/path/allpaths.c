@@ -18,6 +18,7 @@
 #include <limits.h>
 #include <math.h>
 
+#include "access/nbtree.h"
 #include "access/sysattr.h"
 #include "access/tsmapi.h"
 #include "catalog/pg_class.h"
@@ -30,9 +31,11 @@
 #ifdef OPTIMIZER_DEBUG
 #include "nodes/print.h"
 #endif
+#include "nodes/supportnodes.h"
 #include "optimizer/appendinfo.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
+#include "optimizer/feedback.h"
 #include "optimizer/geqo.h"
 #include "optimizer/inherit.h"
 #include "optimizer/optimizer.h"
@@ -48,6 +51,8 @@
 #include "partitioning/partprune.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/selfuncs.h"
 
 
 /* results of subquery_is_pushdown_safe */
@@ -61,6 +66,7 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+int			join_search_block_size = 0;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -74,6 +80,7 @@ join_search_hook_type join_search_hook = NULL;
 static void set_base_rel_consider_startup(PlannerInfo *root);
 static void set_base_rel_sizes(PlannerInfo *root);
 static void set_base_rel_pathlists(PlannerInfo *root);
+static void set_grouped_rel_pathlist(PlannerInfo *root);
 static void set_rel_size(PlannerInfo *root, RelOptInfo *rel,
 						 Index rti, RangeTblEntry *rte);
 static void set_rel_pathlist(PlannerInfo *root, RelOptInfo *rel,
@@ -125,6 +132,14 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static RelOptInfo *idp_join_search(PlannerInfo *root, int levels_needed,
+								   List *initial_rels);
+static RelOptInfo *idp_join_search_round(PlannerInfo *root, List *items,
+										 int maxlev, int *nlevels);
+static RelOptInfo *idp_join_search_fallback(PlannerInfo *root,
+											int levels_needed,
+											List *initial_rels,
+											int savelength);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -136,11 +151,19 @@ static void compare_tlist_datatypes(List *tlist, List *colTypes,
 static bool targetIsInAllPartitionLists(TargetEntry *tle, Query *query);
 static bool qual_is_pushdown_safe(Query *subquery, Index rti, Node *qual,
 								  pushdown_safety_info *safetyInfo);
+static bool check_and_push_window_quals(Query *subquery, Index rti,
+										Node *clause,
+										pushdown_safety_info *safetyInfo,
+										Bitmapset **run_cond_attrs);
+static bool find_window_run_conditions(Query *subquery, WindowFunc *wfunc,
+									   OpExpr *opexpr, bool wfunc_left,
+									   bool *keep_original);
 static void subquery_push_qual(Query *subquery,
 							   RangeTblEntry *rte, Index rti, Node *qual);
 static void recurse_push_qual(Node *setOp, Query *topquery,
 							  RangeTblEntry *rte, Index rti, Node *qual);
-static void remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel);
+static void remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel,
+										   Bitmapset *extra_used_attrs);
 
 
 /*
@@ -221,6 +244,12 @@ make_one_rel(PlannerInfo *root, List *joinlist)
 	 */
 	set_base_rel_pathlists(root);
 
+	/*
+	 * Generate partially aggregated paths for the relation chosen for eager
+	 * aggregation, if any.
+	 */
+	set_grouped_rel_pathlist(root);
+
 	/*
 	 * Generate access paths for the entire join tree.
 	 */
@@ -353,6 +382,145 @@ set_base_rel_pathlists(PlannerInfo *root)
 	}
 }
 
+/*
+ * set_grouped_rel_pathlist
+ *	  Build paths that partially aggregate the relation selected by
+ *	  setup_eager_aggregation(), so that aggregation can start below the
+ *	  joins.
+ *
+ * The result is stored in the base rel's grouped_rel field, where
+ * make_join_rel() will find it.  We only bother if the partial aggregation
+ * is expected to reduce the number of rows substantially.
+ */
+static void
+set_grouped_rel_pathlist(PlannerInfo *root)
+{
+	RelAggInfo *agg_info = root->agg_info;
+	RelOptInfo *rel;
+	RelOptInfo *grouped_rel;
+	PathTarget *input_target;
+	Path	   *cheapest_path;
+	Path	   *path;
+	List	   *group_pathkeys;
+	double		dNumGroups;
+	ListCell   *lc;
+	int			i;
+
+	if (agg_info == NULL)
+		return;
+
+	/* Nothing to gain unless there is a join to push the aggregation below */
+	if (bms_membership(root->all_baserels) != BMS_MULTIPLE)
+		return;
+
+	rel = find_base_rel(root, agg_info->relid);
+	if (IS_DUMMY_REL(rel) || rel->cheapest_total_path == NULL)
+		return;
+	cheapest_path = rel->cheapest_total_path;
+
+	/*
+	 * Partial aggregation costs an extra pass over the relation's rows, so
+	 * don't consider it unless it at least halves their number.
+	 */
+	dNumGroups = estimate_num_groups(root, agg_info->group_exprs,
+									 cheapest_path->rows, NULL);
+	if (dNumGroups * 2 > cheapest_path->rows)
+		return;
+
+	grouped_rel = build_grouped_rel(root, rel);
+	grouped_rel->rows = dNumGroups;
+
+	/*
+	 * The aggregation's input is the relation's regular output, with the
+	 * grouping Vars labeled by the sortgrouprefs of their SortGroupClauses.
+	 */
+	input_target = copy_pathtarget(rel->reltarget);
+	input_target->sortgrouprefs = (Index *)
+		palloc0(list_length(input_target->exprs) * sizeof(Index));
+	i = 0;
+	foreach(lc, input_target->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+		ListCell   *lcg;
+		ListCell   *lcc;
+
+		forboth(lcg, agg_info->group_exprs, lcc, agg_info->group_clauses)
+		{
+			if (equal(expr, lfirst(lcg)))
+			{
+				input_target->sortgrouprefs[i] =
+					((SortGroupClause *) lfirst(lcc))->tleSortGroupRef;
+				break;
+			}
+		}
+		i++;
+	}
+
+	group_pathkeys =
+		make_pathkeys_for_sortclauses(root, agg_info->group_clauses,
+									  make_tlist_from_pathtarget(input_target));
+
+	/*
+	 * Consider sorted aggregation, using the cheapest path with an explicit
+	 * sort, or any unparameterized path that's already sorted suitably.
+	 */
+	foreach(lc, rel->pathlist)
+	{
+		Path	   *input_path = (Path *) lfirst(lc);
+		bool		is_sorted;
+
+		if (input_path->param_info != NULL)
+			continue;
+
+		is_sorted = pathkeys_contained_in(group_pathkeys,
+										  input_path->pathkeys);
+		if (!is_sorted && input_path != cheapest_path)
+			continue;
+
+		path = (Path *) create_projection_path(root, rel, input_path,
+											   input_target);
+		if (!is_sorted)
+			path = (Path *) create_sort_path(root, rel, path,
+											 group_pathkeys, -1.0);
+
+		add_path(grouped_rel, (Path *)
+				 create_agg_path(root,
+								 grouped_rel,
+								 path,
+								 grouped_rel->reltarget,
+								 AGG_SORTED,
+								 AGGSPLIT_INITIAL_SERIAL,
+								 agg_info->group_clauses,
+								 NIL,
+								 &agg_info->agg_costs,
+								 dNumGroups));
+	}
+
+	/* Consider hashed aggregation of the cheapest path */
+	if (grouping_is_hashable(agg_info->group_clauses))
+	{
+		path = (Path *) create_projection_path(root, rel, cheapest_path,
+											   input_target);
+		add_path(grouped_rel, (Path *)
+				 create_agg_path(root,
+								 grouped_rel,
+								 path,
+								 grouped_rel->reltarget,
+								 AGG_HASHED,
+								 AGGSPLIT_INITIAL_SERIAL,
+								 agg_info->group_clauses,
+								 NIL,
+								 &agg_info->agg_costs,
+								 dNumGroups));
+	}
+
+	if (grouped_rel->pathlist == NIL)
+		return;
+
+	set_cheapest(grouped_rel);
+	rel->grouped_rel = grouped_rel;
+}
+
 /*
  * set_rel_size
  *	  Set size estimates for a base relation
@@ -1193,11 +1361,18 @@ set_append_rel_size(PlannerInfo *root, RelOptInfo *rel,
 		for (i = 0; i < nattrs; i++)
 			rel->attr_widths[i] = rint(parent_attrsizes[i] / parent_rows);
 
+		/*
+		 * Prefer what an earlier execution of the query saw, if anything.
+		 * That is recorded for the appendrel as a whole, since that's what a
+		 * Hash or Sort above the Append reads.
+		 */
+		apply_cardinality_feedback(root, rel);
+
 		/*
 		 * Set "raw tuples" count equal to "rows" for the appendrel; needed
 		 * because some places assume rel->tuples is valid for any baserel.
 		 */
-		rel->tuples = parent_rows;
+		rel->tuples = rel->rows;
 
 		/*
 		 * Note that we leave rel->pages as zero; this is important to avoid
@@ -2194,6 +2369,7 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	pushdown_safety_info safetyInfo;
 	double		tuple_fraction;
 	RelOptInfo *sub_final_rel;
+	Bitmapset  *run_cond_attrs = NULL;
 	ListCell   *lc;
 
 	/*
@@ -2268,9 +2444,17 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 				/* Push it down */
 				subquery_push_qual(subquery, rte, rti, clause);
 			}
-			else
+			else if (rinfo->pseudoconstant || !subquery->hasWindowFuncs ||
+					 check_and_push_window_quals(subquery, rti, clause,
+												 &safetyInfo,
+												 &run_cond_attrs))
 			{
-				/* Keep it in the upper query */
+				/*
+				 * Keep it in the upper query.  (If the qual compares a
+				 * monotonic window function's result, it may also have been
+				 * turned into a run condition for the subquery's WindowAgg,
+				 * but it might still be needed to filter rows.)
+				 */
 				upperrestrictlist = lappend(upperrestrictlist, rinfo);
 			}
 		}
@@ -2284,7 +2468,7 @@ set_subquery_pathlist(PlannerInfo *root, RelOptInfo *rel,
 	 * The upper query might not use all the subquery's output columns; if
 	 * not, we can simplify.
 	 */
-	remove_unused_subquery_outputs(subquery, rel);
+	remove_unused_subquery_outputs(subquery, rel, run_cond_attrs);
 
 	/*
 	 * We can safely pass the outer tuple_fraction down to the subquery if the
@@ -3026,6 +3210,9 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (join_search_block_size > 0 &&
+				 levels_needed > join_search_block_size)
+			return idp_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
@@ -3147,6 +3334,205 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * idp_join_search
+ *	  Find a join order for a large join problem by iterative dynamic
+ *	  programming.
+ *
+ * This is the "IDP-1" algorithm of Kossmann and Stocker: we run the same
+ * dynamic programming as standard_join_search(), but stop it after
+ * join_search_block_size levels.  The cheapest of the joinrels built at the
+ * last level is then kept as a single item replacing its components, and
+ * the search starts over with the reduced list of items, until one item
+ * covers them all.  Each round's work is bounded by the block size rather
+ * than by the total number of items, and unlike GEQO the result doesn't
+ * depend on random choices.
+ *
+ * As in geqo_eval(), each round but the last runs in a temporary memory
+ * context, which is thrown away together with all the joinrels built in it.
+ * The joinrel we keep is then built again in the planner's context, from
+ * just its own components, much as GEQO rebuilds its best tour at the end.
+ *
+ * A round can fail to build any joinrel at all if an earlier round's choice
+ * is incompatible with the query's join order restrictions.  We then fall
+ * back to the search we'd have used without IDP.
+ *
+ * The parameters and result are as for standard_join_search().
+ */
+static RelOptInfo *
+idp_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	int			block_size = Max(join_search_block_size, 2);
+	List	   *items = list_copy(initial_rels);
+	int			savelength = list_length(root->join_rel_list);
+	RelOptInfo *best;
+	int			nlevels;
+
+	Assert(levels_needed == list_length(initial_rels));
+	Assert(root->join_rel_level == NULL);
+
+	while (list_length(items) > block_size)
+	{
+		MemoryContext mycontext;
+		MemoryContext oldcxt;
+		int			roundlength;
+		struct HTAB *roundhash;
+		Relids		best_relids = NULL;
+		List	   *subitems = NIL;
+		List	   *newitems = NIL;
+		ListCell   *lc;
+
+		mycontext = AllocSetContextCreate(CurrentMemoryContext,
+										  "IDP",
+										  ALLOCSET_DEFAULT_SIZES);
+		oldcxt = MemoryContextSwitchTo(mycontext);
+
+		/*
+		 * See geqo_eval() about restoring join_rel_list and join_rel_hash
+		 * after the round.
+		 */
+		roundlength = list_length(root->join_rel_list);
+		roundhash = root->join_rel_hash;
+		root->join_rel_hash = NULL;
+
+		best = idp_join_search_round(root, items, block_size, &nlevels);
+
+		root->join_rel_list = list_truncate(root->join_rel_list, roundlength);
+		root->join_rel_hash = roundhash;
+
+		MemoryContextSwitchTo(oldcxt);
+		if (best != NULL)
+			best_relids = bms_copy(best->relids);
+		MemoryContextDelete(mycontext);
+
+		if (best_relids == NULL)
+			return idp_join_search_fallback(root, levels_needed, initial_rels,
+											savelength);
+
+		/* Build the chosen joinrel again, from just its components */
+		foreach(lc, items)
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			if (bms_is_subset(rel->relids, best_relids))
+				subitems = lappend(subitems, rel);
+			else
+				newitems = lappend(newitems, rel);
+		}
+		Assert(list_length(subitems) == nlevels);
+
+		best = idp_join_search_round(root, subitems, nlevels, &nlevels);
+		if (best == NULL || !bms_equal(best->relids, best_relids))
+		{
+			/* shouldn't happen, but don't fail the query over it */
+			return idp_join_search_fallback(root, levels_needed, initial_rels,
+											savelength);
+		}
+
+		/* It's not the topmost scan/join rel, so consider gathering */
+		generate_useful_gather_paths(root, best, false);
+		set_cheapest(best);
+
+		items = lcons(best, newitems);
+	}
+
+	/* The remaining items fit in one block; their joinrels must survive */
+	best = idp_join_search_round(root, items, list_length(items), &nlevels);
+	if (best == NULL || nlevels < list_length(items))
+		return idp_join_search_fallback(root, levels_needed, initial_rels,
+										savelength);
+
+	return best;
+}
+
+/*
+ * idp_join_search_round
+ *	  Run the dynamic programming of standard_join_search() over the given
+ *	  items, up to joinrels of at most maxlev items.
+ *
+ * Returns the cheapest of the joinrels built at the highest level that could
+ * be reached, and sets *nlevels to that level; or returns NULL if not even a
+ * 2-way join could be built.
+ */
+static RelOptInfo *
+idp_join_search_round(PlannerInfo *root, List *items, int maxlev,
+					  int *nlevels)
+{
+	int			nitems = list_length(items);
+	RelOptInfo *best = NULL;
+	int			lev;
+	ListCell   *lc;
+
+	Assert(maxlev >= 2 && maxlev <= nitems);
+
+	root->initial_rels = items;
+	root->join_rel_level = (List **) palloc0((maxlev + 1) * sizeof(List *));
+	root->join_rel_level[1] = items;
+
+	for (lev = 2; lev <= maxlev; lev++)
+	{
+		join_search_one_level(root, lev);
+
+		foreach(lc, root->join_rel_level[lev])
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			generate_partitionwise_join_paths(root, rel);
+			if (lev < nitems)
+				generate_useful_gather_paths(root, rel, false);
+			set_cheapest(rel);
+		}
+	}
+
+	/*
+	 * Join order restrictions might prevent building any joinrels of the
+	 * largest sizes from these items; settle for smaller ones.
+	 */
+	for (lev = maxlev; lev >= 2; lev--)
+	{
+		if (root->join_rel_level[lev] != NIL)
+			break;
+	}
+
+	/* Pick the cheapest of the largest joinrels we could build */
+	if (lev >= 2)
+	{
+		foreach(lc, root->join_rel_level[lev])
+		{
+			RelOptInfo *rel = (RelOptInfo *) lfirst(lc);
+
+			if (best == NULL ||
+				rel->cheapest_total_path->total_cost <
+				best->cheapest_total_path->total_cost)
+				best = rel;
+		}
+	}
+
+	root->join_rel_level = NULL;
+
+	*nlevels = lev;
+	return best;
+}
+
+/*
+ * idp_join_search_fallback
+ *	  Forget the joinrels idp_join_search() has kept, and plan the join
+ *	  problem the way we would have without IDP.
+ */
+static RelOptInfo *
+idp_join_search_fallback(PlannerInfo *root, int levels_needed,
+						 List *initial_rels, int savelength)
+{
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	root->join_rel_hash = NULL;
+	root->initial_rels = initial_rels;
+
+	if (enable_geqo && levels_needed >= geqo_threshold)
+		return geqo(root, levels_needed, initial_rels);
+	else
+		return standard_join_search(root, levels_needed, initial_rels);
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
@@ -3585,6 +3971,267 @@ qual_is_pushdown_safe(Query *subquery, Index rti, Node *qual,
 	return safe;
 }
 
+/*
+ * find_window_run_conditions
+ *		Determine whether 'opexpr', which compares the result of 'wfunc' with
+ *		some other expression, can be used to short-circuit execution of the
+ *		subquery's WindowAgg, and if so add a suitable run condition to the
+ *		WindowClause.
+ *
+ * A run condition is a qual that the WindowAgg checks against each row of a
+ * partition after computing its window functions.  Once it returns false,
+ * the WindowAgg knows that no further rows of the partition can pass it, so
+ * it need not compute or return them.  That holds when the window function
+ * is monotonic within the partition, as reported by its support function,
+ * and the comparison is in the corresponding direction: "increasing_func <=
+ * x" is true for some prefix of the partition and false for the rest.
+ *
+ * 'wfunc_left' tells whether the window function is the left operand.
+ * Returns true if a run condition was added.  *keep_original is then set to
+ * true if the original qual must still be evaluated in the upper query,
+ * because the run condition does not fully implement it; for example,
+ * "increasing_func = x" becomes the run condition "increasing_func <= x",
+ * which still passes the rows before the equality first holds.
+ */
+static bool
+find_window_run_conditions(Query *subquery, WindowFunc *wfunc,
+						   OpExpr *opexpr, bool wfunc_left,
+						   bool *keep_original)
+{
+	Oid			prosupport;
+	Expr	   *otherexpr;
+	SupportRequestWFuncMonotonic req;
+	SupportRequestWFuncMonotonic *res;
+	WindowClause *wclause = NULL;
+	List	   *opinfos;
+	Oid			runoperator = InvalidOid;
+	ListCell   *lc;
+
+	*keep_original = true;
+
+	/* Can't do anything without a support function */
+	prosupport = get_func_support(wfunc->winfnoid);
+	if (!OidIsValid(prosupport))
+		return false;
+
+	/*
+	 * The other operand must stay the same throughout the scan of the
+	 * subquery.  The caller already rejected volatile functions and
+	 * subplans; we also need it not to reference any Vars.
+	 */
+	otherexpr = wfunc_left ? lsecond(opexpr->args) : linitial(opexpr->args);
+	if (contain_var_clause((Node *) otherexpr))
+		return false;
+
+	/* Find the WindowClause that the window function belongs to */
+	foreach(lc, subquery->windowClause)
+	{
+		WindowClause *wc = lfirst_node(WindowClause, lc);
+
+		if (wc->winref == wfunc->winref)
+		{
+			wclause = wc;
+			break;
+		}
+	}
+	if (wclause == NULL)
+		return false;
+
+	req.type = T_SupportRequestWFuncMonotonic;
+	req.window_func = wfunc;
+	req.window_clause = wclause;
+	req.monotonic = MONOTONICFUNC_NONE;
+
+	res = (SupportRequestWFuncMonotonic *)
+		DatumGetPointer(OidFunctionCall1(prosupport,
+										 PointerGetDatum(&req)));
+
+	if (res == NULL || res->monotonic == MONOTONICFUNC_NONE)
+		return false;
+
+	/*
+	 * Look at the operator's btree interpretations to see whether the
+	 * comparison goes the right way for the function's monotonicity.
+	 */
+	opinfos = get_op_btree_interpretation(opexpr->opno);
+	foreach(lc, opinfos)
+	{
+		OpBtreeInterpretation *opinfo = (OpBtreeInterpretation *) lfirst(lc);
+		int			strategy = opinfo->strategy;
+		int			newstrategy;
+
+		/* Put the strategy in terms of "wfunc <op> otherexpr" */
+		if (!wfunc_left)
+			strategy = BTCommuteStrategyNumber(strategy);
+
+		if ((res->monotonic & MONOTONICFUNC_INCREASING) &&
+			(strategy == BTLessStrategyNumber ||
+			 strategy == BTLessEqualStrategyNumber))
+		{
+			/* The qual itself is the run condition */
+			*keep_original = false;
+			runoperator = opexpr->opno;
+			break;
+		}
+		else if ((res->monotonic & MONOTONICFUNC_DECREASING) &&
+				 (strategy == BTGreaterStrategyNumber ||
+				  strategy == BTGreaterEqualStrategyNumber))
+		{
+			/* The qual itself is the run condition */
+			*keep_original = false;
+			runoperator = opexpr->opno;
+			break;
+		}
+		else if (strategy == BTEqualStrategyNumber)
+		{
+			/*
+			 * If the function's value is constant within the partition, the
+			 * equality itself works.  Otherwise, the equality can't hold
+			 * anymore once the function's value has passed the other
+			 * operand, so use <= or >= as the run condition, and keep the
+			 * original qual to filter out the rows before that.
+			 */
+			if (res->monotonic == MONOTONICFUNC_BOTH)
+			{
+				*keep_original = false;
+				runoperator = opexpr->opno;
+				break;
+			}
+
+			if (res->monotonic & MONOTONICFUNC_INCREASING)
+				newstrategy = BTLessEqualStrategyNumber;
+			else
+				newstrategy = BTGreaterEqualStrategyNumber;
+			if (!wfunc_left)
+				newstrategy = BTCommuteStrategyNumber(newstrategy);
+
+			runoperator = get_opfamily_member(opinfo->opfamily_id,
+											  opinfo->oplefttype,
+											  opinfo->oprighttype,
+											  newstrategy);
+			if (OidIsValid(runoperator) &&
+				func_strict(get_opcode(runoperator)))
+			{
+				*keep_original = true;
+				break;
+			}
+			runoperator = InvalidOid;
+		}
+	}
+
+	if (!OidIsValid(runoperator))
+	{
+		*keep_original = true;
+		return false;
+	}
+
+	/*
+	 * Build the run condition in terms of the subquery's WindowFunc, and
+	 * attach it to the WindowClause.  The planner will later hand it to the
+	 * WindowAgg implementing that clause.
+	 */
+	wclause->runCondition =
+		lappend(wclause->runCondition,
+				make_opclause(runoperator,
+							  opexpr->opresulttype,
+							  opexpr->opretset,
+							  wfunc_left ? copyObject((Expr *) wfunc) : copyObject(otherexpr),
+							  wfunc_left ? copyObject(otherexpr) : copyObject((Expr *) wfunc),
+							  opexpr->opcollid,
+							  opexpr->inputcollid));
+
+	return true;
+}
+
+/*
+ * check_and_push_window_quals
+ *		Check whether an upper-query qual that could not be pushed down into
+ *		the subquery can instead serve as a run condition for one of the
+ *		subquery's WindowAggs; see find_window_run_conditions.
+ *
+ * Returns true if the qual must be kept in the upper query, false if the
+ * run condition makes it redundant.  The subquery output columns referenced
+ * by run conditions are added to *run_cond_attrs, since they must not be
+ * removed from the subquery's targetlist even if the upper query no longer
+ * references them.
+ */
+static bool
+check_and_push_window_quals(Query *subquery, Index rti, Node *clause,
+							pushdown_safety_info *safetyInfo,
+							Bitmapset **run_cond_attrs)
+{
+	OpExpr	   *opexpr = (OpExpr *) clause;
+	bool		keep_original = true;
+	int			i;
+
+	/* We're only able to use binary OpExprs */
+	if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2)
+		return true;
+
+	/*
+	 * Once the run condition fails, the WindowAgg stops computing window
+	 * functions for the rest of the partition, so the qual must not contain
+	 * anything that would behave differently if evaluated fewer times.
+	 */
+	if (contain_volatile_functions(clause) || contain_subplans(clause))
+		return true;
+
+	/* Same security_barrier check as qual_is_pushdown_safe */
+	if (safetyInfo->unsafeLeaky && contain_leaked_vars(clause))
+		return true;
+
+	/*
+	 * Filtering rows at the WindowAgg is only equivalent to filtering the
+	 * subquery's output if nothing between them can change which rows get
+	 * output.
+	 */
+	if (subquery->distinctClause != NIL || subquery->hasTargetSRFs)
+		return true;
+
+	/*
+	 * Rows that fail the run condition of a lower WindowAgg are passed up
+	 * with null window function results, and discarded by the top WindowAgg
+	 * by re-checking the condition.  That requires a strict operator.
+	 */
+	set_opfuncid(opexpr);
+	if (!func_strict(opexpr->opfuncid))
+		return true;
+
+	for (i = 0; i < 2; i++)
+	{
+		Var		   *var = (Var *) list_nth(opexpr->args, i);
+		TargetEntry *tle;
+		WindowFunc *wfunc;
+
+		if (!IsA(var, Var) || var->varno != rti ||
+			var->varlevelsup != 0 || var->varattno <= 0)
+			continue;
+
+		tle = get_tle_by_resno(subquery->targetList, var->varattno);
+		if (tle == NULL || !IsA(tle->expr, WindowFunc))
+			continue;
+		wfunc = (WindowFunc *) tle->expr;
+
+		/*
+		 * The executor evaluates the run condition's WindowFunc together
+		 * with the targetlist's one only if it's not volatile.
+		 */
+		if (contain_volatile_functions((Node *) wfunc))
+			continue;
+
+		if (find_window_run_conditions(subquery, wfunc, opexpr, i == 0,
+									   &keep_original))
+		{
+			*run_cond_attrs =
+				bms_add_member(*run_cond_attrs,
+							   var->varattno - FirstLowInvalidHeapAttributeNumber);
+			return keep_original;
+		}
+	}
+
+	return true;
+}
+
 /*
  * subquery_push_qual - push down a qual that we have determined is safe
  */
@@ -3681,13 +4328,25 @@ recurse_push_qual(Node *setOp, Query *topquery,
  * To avoid affecting column numbering in the targetlist, we don't physically
  * remove unused tlist entries, but rather replace their expressions with NULL
  * constants.  This is implemented by modifying subquery->targetList.
+ *
+ * extra_used_attrs can be passed as non-NULL to mark any columns (offset by
+ * FirstLowInvalidHeapAttributeNumber) that must not be removed even though
+ * the upper query doesn't reference them, such as columns used by window
+ * run conditions.
  */
 static void
-remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel)
+remove_unused_subquery_outputs(Query *subquery, RelOptInfo *rel,
+							   Bitmapset *extra_used_attrs)
 {
-	Bitmapset  *attrs_used = NULL;
+	Bitmapset  *attrs_used;
 	ListCell   *lc;
 
+	/*
+	 * Just point directly to extra_used_attrs.  No need to bms_copy as none
+	 * of the current callers use the Bitmapset after calling this function.
+	 */
+	attrs_used = extra_used_attrs;
+
 	/*
 	 * Do nothing if subquery has UNION/INTERSECT/EXCEPT: in principle we
 	 * could update all the child SELECTs' tlists, but it seems not worth the
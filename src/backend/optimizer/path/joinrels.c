@@ -16,6 +16,7 @@
 
 #include "miscadmin.h"
 #include "optimizer/appendinfo.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -38,6 +39,9 @@ static bool restriction_is_constant_false(List *restrictlist,
 static void populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
 										RelOptInfo *rel2, RelOptInfo *joinrel,
 										SpecialJoinInfo *sjinfo, List *restrictlist);
+static void make_grouped_join_rel(PlannerInfo *root, RelOptInfo *rel1,
+								  RelOptInfo *rel2, RelOptInfo *joinrel,
+								  SpecialJoinInfo *sjinfo, List *restrictlist);
 static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
 								   RelOptInfo *rel2, RelOptInfo *joinrel,
 								   SpecialJoinInfo *parent_sjinfo,
@@ -760,11 +764,70 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 	populate_joinrel_with_paths(root, rel1, rel2, joinrel, sjinfo,
 								restrictlist);
 
+	/* Add paths that join a partially aggregated input, if any. */
+	make_grouped_join_rel(root, rel1, rel2, joinrel, sjinfo, restrictlist);
+
 	bms_free(joinrelids);
 
 	return joinrel;
 }
 
+/*
+ * make_grouped_join_rel
+ *	  Add paths to the partially aggregated counterpart of the given joinrel,
+ *	  if one of the joining relations has been partially aggregated.
+ *
+ * Only one of the inputs can contain the relation chosen for eager
+ * aggregation; its grouped_rel is joined to the other input's plain rel.
+ * setup_eager_aggregation() has made sure that all joins are inner joins.
+ */
+static void
+make_grouped_join_rel(PlannerInfo *root, RelOptInfo *rel1,
+					  RelOptInfo *rel2, RelOptInfo *joinrel,
+					  SpecialJoinInfo *sjinfo, List *restrictlist)
+{
+	RelOptInfo *grouped1 = rel1->grouped_rel;
+	RelOptInfo *grouped2 = rel2->grouped_rel;
+	RelOptInfo *grouped_rel;
+
+	if (root->agg_info == NULL || IS_DUMMY_REL(joinrel))
+		return;
+
+	Assert(sjinfo->jointype == JOIN_INNER);
+
+	/* Exactly one side must have been partially aggregated */
+	if (grouped1 != NULL && grouped1->pathlist == NIL)
+		grouped1 = NULL;
+	if (grouped2 != NULL && grouped2->pathlist == NIL)
+		grouped2 = NULL;
+	if ((grouped1 == NULL) == (grouped2 == NULL))
+		return;
+
+	grouped_rel = joinrel->grouped_rel;
+	if (grouped_rel == NULL)
+	{
+		grouped_rel = build_grouped_rel(root, joinrel);
+		set_joinrel_size_estimates(root, grouped_rel,
+								   grouped1 ? grouped1 : rel1,
+								   grouped2 ? grouped2 : rel2,
+								   sjinfo, restrictlist);
+		joinrel->grouped_rel = grouped_rel;
+	}
+
+	if (grouped1)
+		rel1 = grouped1;
+	else
+		rel2 = grouped2;
+
+	add_paths_to_joinrel(root, grouped_rel, rel1, rel2,
+						 JOIN_INNER, sjinfo, restrictlist);
+	add_paths_to_joinrel(root, grouped_rel, rel2, rel1,
+						 JOIN_INNER, sjinfo, restrictlist);
+
+	if (grouped_rel->pathlist != NIL)
+		set_cheapest(grouped_rel);
+}
+
 /*
  * populate_joinrel_with_paths
  *	  Add paths to the given joinrel for given pair of joining relations. The
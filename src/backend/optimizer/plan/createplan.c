@@ -170,6 +170,9 @@ static void copy_generic_path_info(Plan *dest, Path *src);
 static void copy_plan_costsize(Plan *dest, Plan *src);
 static void label_sort_with_costsize(PlannerInfo *root, Sort *plan,
 									 double limit_tuples);
+static void set_feedback_target(PlannerInfo *root, Path *subpath,
+								uint64 *feedbackKey,
+								Bitmapset **feedbackRelids);
 static SeqScan *make_seqscan(List *qptlist, List *qpqual, Index scanrelid);
 static SampleScan *make_samplescan(List *qptlist, List *qpqual, Index scanrelid,
 								   TableSampleClause *tsc);
@@ -276,6 +279,7 @@ static WindowAgg *make_windowagg(List *tlist, Index winref,
 								 int frameOptions, Node *startOffset, Node *endOffset,
 								 Oid startInRangeFunc, Oid endInRangeFunc,
 								 Oid inRangeColl, bool inRangeAsc, bool inRangeNullsFirst,
+								 List *runCondition, List *qual, bool topWindow,
 								 Plan *lefttree);
 static Group *make_group(List *tlist, List *qual, int numGroupCols,
 						 AttrNumber *grpColIdx, Oid *grpOperators, Oid *grpCollations,
@@ -337,9 +341,11 @@ create_plan(PlannerInfo *root, Path *best_path)
 	 * column names and other decorative info.  Targetlists generated within
 	 * the planner don't bother with that stuff, but we must have it on the
 	 * top-level tlist seen at execution time.  However, ModifyTable plan
-	 * nodes don't have a tlist matching the querytree targetlist.
+	 * nodes don't have a tlist matching the querytree targetlist, and neither
+	 * does a Gather collecting the results of a parallel INSERT.
 	 */
-	if (!IsA(plan, ModifyTable))
+	if (!IsA(plan, ModifyTable) &&
+		!(IsA(plan, Gather) && IsA(outerPlan(plan), ModifyTable)))
 		apply_tlist_labeling(plan->targetlist, root->processed_tlist);
 
 	/*
@@ -855,6 +861,13 @@ use_physical_tlist(PlannerInfo *root, Path *path, int flags)
 	if (IsA(path, CustomPath))
 		return false;
 
+	/*
+	 * If the table AM can skip reading columns that aren't needed, don't
+	 * make it return all of them.
+	 */
+	if (rel->amflags & AMFLAG_HAS_COLUMN_PROJECTION)
+		return false;
+
 	/*
 	 * If a bitmap scan's tlist is empty, keep it as-is.  This may allow the
 	 * executor to skip heap page fetches, and in any case, the benefit of
@@ -2006,6 +2019,9 @@ create_sort_plan(PlannerInfo *root, SortPath *best_path, int flags)
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
 
+	set_feedback_target(root, best_path->subpath,
+						&plan->feedbackKey, &plan->feedbackRelids);
+
 	return plan;
 }
 
@@ -2518,6 +2534,9 @@ create_windowagg_plan(PlannerInfo *root, WindowAggPath *best_path)
 						  wc->inRangeColl,
 						  wc->inRangeAsc,
 						  wc->inRangeNullsFirst,
+						  wc->runCondition,
+						  best_path->qual,
+						  best_path->topwindow,
 						  subplan);
 
 	copy_generic_path_info(&plan->plan, (Path *) best_path);
@@ -4242,6 +4261,8 @@ create_mergejoin_plan(PlannerInfo *root,
 												   outer_relids);
 
 		label_sort_with_costsize(root, sort, -1.0);
+		set_feedback_target(root, outer_path,
+							&sort->feedbackKey, &sort->feedbackRelids);
 		outer_plan = (Plan *) sort;
 		outerpathkeys = best_path->outersortkeys;
 	}
@@ -4256,6 +4277,8 @@ create_mergejoin_plan(PlannerInfo *root,
 												   inner_relids);
 
 		label_sort_with_costsize(root, sort, -1.0);
+		set_feedback_target(root, inner_path,
+							&sort->feedbackKey, &sort->feedbackRelids);
 		inner_plan = (Plan *) sort;
 		innerpathkeys = best_path->innersortkeys;
 	}
@@ -4608,6 +4631,10 @@ create_hashjoin_plan(PlannerInfo *root,
 		hash_plan->plan.parallel_aware = true;
 		hash_plan->rows_total = best_path->inner_rows_total;
 	}
+	else
+		set_feedback_target(root, best_path->jpath.innerjoinpath,
+							&hash_plan->feedbackKey,
+							&hash_plan->feedbackRelids);
 
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
@@ -5184,6 +5211,31 @@ label_sort_with_costsize(PlannerInfo *root, Sort *plan, double limit_tuples)
 	plan->plan.parallel_safe = lefttree->parallel_safe;
 }
 
+/*
+ * set_feedback_target
+ *	  Make a Hash or Sort node report the number of rows it reads from
+ *	  'subpath' back to the planner, if that is useful.
+ *
+ * The executor compares the row count with the subplan's estimate, and on a
+ * large misestimate stores it as the size of the subpath's rel, so that
+ * estimate has to be the rel's own: not that of a parameterized path, nor of
+ * a partial path, which covers only a share of the rel.  Upper rels aren't
+ * subject to cardinality feedback at all.
+ */
+static void
+set_feedback_target(PlannerInfo *root, Path *subpath,
+					uint64 *feedbackKey, Bitmapset **feedbackRelids)
+{
+	RelOptInfo *rel = subpath->parent;
+
+	if (root->feedback_key == 0 || IS_UPPER_REL(rel) ||
+		subpath->param_info != NULL || subpath->rows != rel->rows)
+		return;
+
+	*feedbackKey = root->feedback_key;
+	*feedbackRelids = bms_copy(rel->relids);
+}
+
 /*
  * bitmap_subplan_mark_shared
  *	 Set isshared flag in bitmap subplan so that it will be created in
@@ -6386,6 +6438,7 @@ make_windowagg(List *tlist, Index winref,
 			   int frameOptions, Node *startOffset, Node *endOffset,
 			   Oid startInRangeFunc, Oid endInRangeFunc,
 			   Oid inRangeColl, bool inRangeAsc, bool inRangeNullsFirst,
+			   List *runCondition, List *qual, bool topWindow,
 			   Plan *lefttree)
 {
 	WindowAgg  *node = makeNode(WindowAgg);
@@ -6408,12 +6461,14 @@ make_windowagg(List *tlist, Index winref,
 	node->inRangeColl = inRangeColl;
 	node->inRangeAsc = inRangeAsc;
 	node->inRangeNullsFirst = inRangeNullsFirst;
+	node->runCondition = runCondition;
+	node->topWindow = topWindow;
 
 	plan->targetlist = tlist;
 	plan->lefttree = lefttree;
 	plan->righttree = NULL;
-	/* WindowAgg nodes never have a qual clause */
-	plan->qual = NIL;
+	/* only the top WindowAgg has a qual, made of lower run conditions */
+	plan->qual = qual;
 
 	return node;
 }
@@ -6844,6 +6899,21 @@ make_modifytable(PlannerInfo *root,
 	node->rowMarks = rowMarks;
 	node->epqParam = epqParam;
 
+	/*
+	 * An INSERT may collect the rows to insert and write them out in batches
+	 * using table_multi_insert(), as COPY FROM does.  The executor decides
+	 * that separately for each target table, based on its triggers, but we
+	 * have to rule it out here if RETURNING or ON CONFLICT needs each row to
+	 * be inserted before the next one is processed, or if the statement
+	 * contains volatile functions, which might query the target table and
+	 * see that rows already produced haven't been inserted yet.  nextval()
+	 * is exempt, as it can't look at the table.
+	 */
+	node->multiInsert = (operation == CMD_INSERT &&
+						 onconflict == NULL &&
+						 returningLists == NIL &&
+						 !contain_volatile_functions_not_nextval((Node *) root->parse));
+
 	/*
 	 * For each result relation that is a foreign table, allow the FDW to
 	 * construct private plan data, and accumulate it all into a list.
@@ -14,8 +14,11 @@
  */
 #include "postgres.h"
 
+#include "access/nbtree.h"
+#include "catalog/pg_am.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_type.h"
+#include "commands/defrem.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -31,6 +34,7 @@
 #include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
 #include "parser/analyze.h"
+#include "parser/parse_oper.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
 
@@ -76,6 +80,7 @@ static bool check_equivalence_delay(PlannerInfo *root,
 static bool check_redundant_nullability_qual(PlannerInfo *root, Node *clause);
 static void check_mergejoinable(RestrictInfo *restrictinfo);
 static void check_hashjoinable(RestrictInfo *restrictinfo);
+static bool type_is_equal_image(Oid typid, Oid collation);
 
 
 /*****************************************************************************
@@ -2692,3 +2697,236 @@ check_hashjoinable(RestrictInfo *restrictinfo)
 		!contain_volatile_functions((Node *) clause))
 		restrictinfo->hashjoinoperator = opno;
 }
+
+
+/*****************************************************************************
+ *
+ *	 EAGER AGGREGATION
+ *
+ *****************************************************************************/
+
+/*
+ * setup_eager_aggregation
+ *	  Determine whether the query's aggregation can be partially performed
+ *	  below its joins, and if so set up root->agg_info to describe it.
+ *
+ * This requires that every aggregate take its input from just one base
+ * relation, that all the aggregates support partial aggregation with
+ * serialized transition states, and that all joins be inner joins.  The
+ * partial aggregation groups the relation's rows by each of its Vars that is
+ * needed above the relation for anything except the aggregates' arguments.
+ * A partial group may then be duplicated by the joins, but combining a
+ * transition state more than once has the same effect as aggregating the
+ * duplicated input rows, so the finalized aggregates come out the same.
+ *
+ * We must be called after the relation's attr_needed sets and reltarget are
+ * complete; whether it actually pays off is left to the path-building code.
+ */
+void
+setup_eager_aggregation(PlannerInfo *root)
+{
+	Query	   *parse = root->parse;
+	List	   *tlist_vars;
+	Bitmapset  *outer_attnos = NULL;
+	Index		relid = 0;
+	RelOptInfo *rel;
+	RelAggInfo *agg_info;
+	Index		sortref = 0;
+	ListCell   *lc;
+
+	root->agg_info = NULL;
+
+	if (!enable_eager_aggregate)
+		return;
+
+	/* We need plain aggregation, perhaps with GROUP BY */
+	if (!parse->hasAggs || parse->groupingSets)
+		return;
+
+	/*
+	 * Outer joins, semijoins and antijoins could change the number of times
+	 * a partial group is emitted in ways that don't correspond to its input
+	 * rows, so insist on inner joins only.  We also punt if there are any
+	 * PlaceHolderVars, which only arise with outer joins or flattened
+	 * subqueries anyway.
+	 */
+	if (root->join_info_list != NIL || root->placeholder_list != NIL)
+		return;
+
+	agg_info = makeNode(RelAggInfo);
+
+	/*
+	 * Collect the Aggrefs of the targetlist and HAVING qual, together with
+	 * any Vars appearing outside of aggregates.
+	 */
+	tlist_vars = pull_var_clause((Node *) root->processed_tlist,
+								 PVC_INCLUDE_AGGREGATES |
+								 PVC_RECURSE_WINDOWFUNCS |
+								 PVC_INCLUDE_PLACEHOLDERS);
+	tlist_vars = list_concat(tlist_vars,
+							 pull_var_clause(parse->havingQual,
+											 PVC_INCLUDE_AGGREGATES |
+											 PVC_RECURSE_WINDOWFUNCS |
+											 PVC_INCLUDE_PLACEHOLDERS));
+
+	foreach(lc, tlist_vars)
+	{
+		Node	   *node = (Node *) lfirst(lc);
+
+		if (IsA(node, Aggref))
+		{
+			Aggref	   *aggref = (Aggref *) node;
+			Aggref	   *newaggref;
+			Relids		varnos;
+
+			if (contain_volatile_functions(node) || contain_subplans(node))
+				return;
+
+			/* All aggregates must take their input from the same relation */
+			varnos = pull_varnos(node);
+			if (!bms_is_empty(varnos))
+			{
+				int			varno;
+
+				if (!bms_get_singleton_member(varnos, &varno))
+					return;
+				if (relid == 0)
+					relid = varno;
+				else if (relid != varno)
+					return;
+			}
+
+			/* Make a partial-mode copy, as make_partial_grouping_target does */
+			newaggref = makeNode(Aggref);
+			memcpy(newaggref, aggref, sizeof(Aggref));
+			mark_partial_aggref(newaggref, AGGSPLIT_INITIAL_SERIAL);
+			agg_info->agg_exprs = list_append_unique(agg_info->agg_exprs,
+													 newaggref);
+		}
+		else if (!IsA(node, Var))
+			return;				/* PlaceHolderVar, shouldn't happen */
+	}
+
+	/* Aggregates that don't read any relation give us nothing to go on */
+	if (relid == 0)
+		return;
+	agg_info->relid = relid;
+
+	rel = find_base_rel(root, relid);
+	if (rel->reloptkind != RELOPT_BASEREL ||
+		rel->rtekind != RTE_RELATION ||
+		!bms_is_empty(rel->lateral_relids) ||
+		!bms_is_empty(rel->lateral_referencers))
+		return;
+
+	/* Note which of the relation's columns are needed outside aggregates */
+	foreach(lc, tlist_vars)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+
+		if (IsA(var, Var) && var->varno == relid)
+		{
+			/* Whole-row and system-column references are too hard */
+			if (var->varattno <= 0)
+				return;
+			outer_attnos = bms_add_member(outer_attnos, var->varattno);
+		}
+	}
+
+	/*
+	 * Choose the grouping keys: every Var of the relation that is needed by
+	 * another relation (for a join clause) or above the joins outside of an
+	 * aggregate.  Vars needed only by the aggregates' arguments are consumed
+	 * by the partial aggregation.
+	 */
+	foreach(lc, rel->reltarget->exprs)
+	{
+		Var		   *var = (Var *) lfirst(lc);
+		Relids		needed_by;
+		Oid			sortop;
+		Oid			eqop;
+		bool		hashable;
+		SortGroupClause *sgc;
+
+		/* Same restriction as above */
+		if (!IsA(var, Var) || var->varattno <= 0)
+			return;
+
+		needed_by = bms_difference(rel->attr_needed[var->varattno - rel->min_attr],
+								   rel->relids);
+		needed_by = bms_del_member(needed_by, 0);
+		if (bms_is_empty(needed_by) &&
+			!bms_is_member(var->varattno, outer_attnos))
+			continue;
+
+		/*
+		 * Values that the grouping operator considers equal will be merged
+		 * into one group, of which only one representative value survives;
+		 * so insist that equal values be indistinguishable, which we check
+		 * the same way nbtree deduplication does.
+		 */
+		get_sort_group_operators(var->vartype,
+								 false, false, false,
+								 &sortop, &eqop, NULL,
+								 &hashable);
+		if (!OidIsValid(sortop) || !OidIsValid(eqop) ||
+			!type_is_equal_image(var->vartype, var->varcollid))
+			return;
+
+		sgc = makeNode(SortGroupClause);
+		sgc->tleSortGroupRef = ++sortref;
+		sgc->eqop = eqop;
+		sgc->sortop = sortop;
+		sgc->nulls_first = false;
+		sgc->hashable = hashable;
+
+		agg_info->group_clauses = lappend(agg_info->group_clauses, sgc);
+		agg_info->group_exprs = lappend(agg_info->group_exprs, var);
+		agg_info->group_attnos = bms_add_member(agg_info->group_attnos,
+												var->varattno);
+	}
+
+	/*
+	 * Without any grouping keys the partial aggregation would produce a row
+	 * even for empty input, which is wrong if the query has a GROUP BY.  Such
+	 * cases (cross joins, basically) aren't worth the trouble anyway.
+	 */
+	if (agg_info->group_clauses == NIL)
+		return;
+
+	/* Finally, check that partial aggregation is possible at all */
+	get_agg_clause_costs(root, (Node *) agg_info->agg_exprs,
+						 AGGSPLIT_INITIAL_SERIAL, &agg_info->agg_costs);
+	if (agg_info->agg_costs.hasNonPartial || agg_info->agg_costs.hasNonSerial)
+		return;
+
+	root->agg_info = agg_info;
+}
+
+/*
+ * type_is_equal_image
+ *	  Can values of the given type and collation be considered equal by its
+ *	  default btree opclass only when they're also bitwise identical?
+ */
+static bool
+type_is_equal_image(Oid typid, Oid collation)
+{
+	Oid			opclass;
+	Oid			opfamily;
+	Oid			opcintype;
+	Oid			equalimageproc;
+
+	opclass = GetDefaultOpClass(typid, BTREE_AM_OID);
+	if (!OidIsValid(opclass))
+		return false;
+
+	opfamily = get_opclass_family(opclass);
+	opcintype = get_opclass_input_type(opclass);
+	equalimageproc = get_opfamily_proc(opfamily, opcintype, opcintype,
+									   BTEQUALIMAGE_PROC);
+	if (!OidIsValid(equalimageproc))
+		return false;
+
+	return DatumGetBool(OidFunctionCall1Coll(equalimageproc, collation,
+											 ObjectIdGetDatum(opcintype)));
+}
@@ -263,6 +263,12 @@ query_planner(PlannerInfo *root,
 	 */
 	add_other_rels_to_query(root);
 
+	/*
+	 * Check whether the query's aggregates could be partially computed
+	 * below its joins.  This needs the final attr_needed sets.
+	 */
+	setup_eager_aggregation(root);
+
 	/*
 	 * Ready to do the primary planning.
 	 */
@@ -43,6 +43,7 @@
 #include "optimizer/appendinfo.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
+#include "optimizer/feedback.h"
 #include "optimizer/inherit.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/paramassign.h"
@@ -287,9 +288,18 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	RelOptInfo *final_rel;
 	Path	   *best_path;
 	Plan	   *top_plan;
+	Query	   *reoptQuery = NULL;
 	ListCell   *lp,
 			   *lr;
 
+	/*
+	 * If the executor might want to re-plan the query once it has seen how
+	 * many rows it really gets, keep an unplanned copy of it around.  This
+	 * must be done before we start scribbling on the parse tree.
+	 */
+	if (adaptive_reoptimization && query_supports_reoptimization(parse))
+		reoptQuery = copyObject(parse);
+
 	/*
 	 * Set up global state for this planner invocation.  This data is needed
 	 * across all levels of sub-Query that might exist in the given command,
@@ -306,6 +316,7 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	glob->finalrowmarks = NIL;
 	glob->resultRelations = NIL;
 	glob->appendRelations = NIL;
+	glob->partPruneInfos = NIL;
 	glob->relationOids = NIL;
 	glob->invalItems = NIL;
 	glob->paramExecTypes = NIL;
@@ -318,14 +329,14 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	/*
 	 * Assess whether it's feasible to use parallel mode for this query. We
 	 * can't do this in a standalone backend, or if the command will try to
-	 * modify any data, or if this is a cursor operation, or if GUCs are set
-	 * to values that don't permit parallelism, or if parallel-unsafe
-	 * functions are present in the query tree.
+	 * modify any data other than by INSERT, or if this is a cursor operation,
+	 * or if GUCs are set to values that don't permit parallelism, or if
+	 * parallel-unsafe functions are present in the query tree.
 	 *
 	 * (Note that we do allow CREATE TABLE AS, SELECT INTO, and CREATE
-	 * MATERIALIZED VIEW to use parallel plans, but as of now, only the leader
-	 * backend writes into a completely new table.  In the future, we can
-	 * extend it to allow workers to write into the table.  However, to allow
+	 * MATERIALIZED VIEW to use parallel plans; the workers may even write
+	 * into the new table, see SetupParallelIntoRel.  An INSERT can be done
+	 * by the workers too, if the target table permits it.  However, to allow
 	 * parallel updates and deletes, we have to solve other problems,
 	 * especially around combo CIDs.)
 	 *
@@ -336,7 +347,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	 */
 	if ((cursorOptions & CURSOR_OPT_PARALLEL_OK) != 0 &&
 		IsUnderPostmaster &&
-		parse->commandType == CMD_SELECT &&
+		(parse->commandType == CMD_SELECT ||
+		 parse->commandType == CMD_INSERT) &&
 		!parse->hasModifyingCTE &&
 		max_parallel_workers_per_gather > 0 &&
 		!IsParallelWorker())
@@ -519,6 +531,7 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->rtable = glob->finalrtable;
 	result->resultRelations = glob->resultRelations;
 	result->appendRelations = glob->appendRelations;
+	result->partPruneInfos = glob->partPruneInfos;
 	result->subplans = glob->subplans;
 	result->rewindPlanIDs = glob->rewindPlanIDs;
 	result->rowMarks = glob->finalrowmarks;
@@ -527,6 +540,8 @@ standard_planner(Query *parse, const char *query_string, int cursorOptions,
 	result->paramExecTypes = glob->paramExecTypes;
 	/* utilityStmt should be null, but we might as well copy it */
 	result->utilityStmt = parse->utilityStmt;
+	result->reoptQuery = reoptQuery;
+	result->reoptCursorOptions = cursorOptions;
 	result->stmt_location = parse->stmt_location;
 	result->stmt_len = parse->stmt_len;
 
@@ -636,6 +651,13 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 	root->non_recursive_path = NULL;
 	root->partColsUpdated = false;
 
+	/*
+	 * Identify this query level for cardinality feedback.  As above, this has
+	 * to look at the parse tree before we modify it.
+	 */
+	root->feedback_key = adaptive_reoptimization ?
+		feedback_query_key(parse, glob->boundParams) : 0;
+
 	/*
 	 * If there is a WITH list, process each WITH query and either convert it
 	 * to RTE_SUBQUERY RTE(s) or build an initplan SubPlan structure for it.
@@ -802,6 +824,10 @@ subquery_planner(PlannerGlobal *glob, Query *parse,
 												EXPRKIND_LIMIT);
 		wc->endOffset = preprocess_expression(root, wc->endOffset,
 											  EXPRKIND_LIMIT);
+		/* runCondition must be processed just like the targetlist */
+		wc->runCondition = (List *) preprocess_expression(root,
+														  (Node *) wc->runCondition,
+														  EXPRKIND_TARGET);
 	}
 
 	parse->limitOffset = preprocess_expression(root, parse->limitOffset,
@@ -2269,8 +2295,8 @@ grouping_planner(PlannerInfo *root, bool inheritance_update,
 	 * If the input rel is marked consider_parallel and there's nothing that's
 	 * not parallel-safe in the LIMIT clause, then the final_rel can be marked
 	 * consider_parallel as well.  Note that if the query has rowMarks or is
-	 * not a SELECT, consider_parallel will be false for every relation in the
-	 * query.
+	 * neither a SELECT nor an INSERT, consider_parallel will be false for
+	 * every relation in the query.
 	 */
 	if (current_rel->consider_parallel &&
 		is_parallel_safe(root, parse->limitOffset) &&
@@ -2385,6 +2411,51 @@ grouping_planner(PlannerInfo *root, bool inheritance_update,
 		add_path(final_rel, path);
 	}
 
+	/*
+	 * If this is an INSERT and everything about it is parallel-safe, including
+	 * the target table (cf. max_parallel_hazard), consider letting each
+	 * worker insert the rows it produces itself rather than sending them to
+	 * the leader: Gather on top of a parallel-aware ModifyTable on top of the
+	 * cheapest partial path.  We don't try this with RETURNING, since we'd
+	 * have to send the rows to the leader anyway.
+	 */
+	if (parse->commandType == CMD_INSERT && !inheritance_update &&
+		final_rel->consider_parallel &&
+		root->glob->maxParallelHazard == PROPARALLEL_SAFE &&
+		parse->returningList == NIL && !parse->rowMarks &&
+		!limit_needed(parse) &&
+		current_rel->partial_pathlist != NIL)
+	{
+		Path	   *partial_path = (Path *) linitial(current_rel->partial_pathlist);
+		ModifyTablePath *mtpath;
+		double		rows = 0;
+		Path	   *path;
+
+		mtpath = create_modifytable_path(root, final_rel,
+										 parse->commandType,
+										 parse->canSetTag,
+										 parse->resultRelation,
+										 0,
+										 false,
+										 list_make1_int(parse->resultRelation),
+										 list_make1(partial_path),
+										 list_make1(root),
+										 parse->withCheckOptions ?
+										 list_make1(parse->withCheckOptions) : NIL,
+										 NIL,
+										 NIL,
+										 NULL,
+										 assign_special_exec_param(root));
+		mtpath->path.parallel_aware = true;
+		mtpath->path.parallel_safe = true;
+		mtpath->path.parallel_workers = partial_path->parallel_workers;
+
+		path = (Path *) create_gather_path(root, final_rel, &mtpath->path,
+										   mtpath->path.pathtarget,
+										   NULL, &rows);
+		add_path(final_rel, path);
+	}
+
 	/*
 	 * Generate partial paths for final_rel, too, if outer query levels might
 	 * be able to make use of them.
@@ -4102,6 +4173,13 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 		 */
 		force_rel_creation = (patype == PARTITIONWISE_AGGREGATE_PARTIAL);
 
+		/*
+		 * Likewise if the scan/join search produced eagerly aggregated paths,
+		 * which we add to the partially_grouped_rel below.
+		 */
+		if (input_rel->grouped_rel && input_rel->grouped_rel->pathlist)
+			force_rel_creation = true;
+
 		partially_grouped_rel =
 			create_partial_grouping_paths(root,
 										  grouped_rel,
@@ -4109,6 +4187,29 @@ create_ordinary_grouping_paths(PlannerInfo *root, RelOptInfo *input_rel,
 										  gd,
 										  extra,
 										  force_rel_creation);
+
+		/*
+		 * The eagerly aggregated paths emit the partial aggregates and any
+		 * grouping expressions' inputs, so they need only be projected to the
+		 * partially grouped target to be finalized like any other partially
+		 * grouped path.
+		 */
+		if (input_rel->grouped_rel && input_rel->grouped_rel->pathlist)
+		{
+			ListCell   *lc;
+
+			foreach(lc, input_rel->grouped_rel->pathlist)
+			{
+				Path	   *path = (Path *) lfirst(lc);
+
+				add_path(partially_grouped_rel, (Path *)
+						 create_projection_path(root,
+												partially_grouped_rel,
+												path,
+												partially_grouped_rel->reltarget));
+			}
+			set_cheapest(partially_grouped_rel);
+		}
 	}
 
 	/* Set out parameter. */
@@ -4641,6 +4742,7 @@ create_one_window_path(PlannerInfo *root,
 {
 	PathTarget *window_target;
 	ListCell   *l;
+	List	   *topqual = NIL;
 
 	/*
 	 * Since each window clause could require a different sort order, we stack
@@ -4665,6 +4767,7 @@ create_one_window_path(PlannerInfo *root,
 		List	   *window_pathkeys;
 		int			presorted_keys;
 		bool		is_sorted;
+		bool		topwindow;
 
 		window_pathkeys = make_pathkeys_for_window(root,
 												   wc,
@@ -4701,7 +4804,9 @@ create_one_window_path(PlannerInfo *root,
 			}
 		}
 
-		if (lnext(activeWindows, l))
+		topwindow = (lnext(activeWindows, l) == NULL);
+
+		if (!topwindow)
 		{
 			/*
 			 * Add the current WindowFuncs to the output target for this
@@ -4728,10 +4833,21 @@ create_one_window_path(PlannerInfo *root,
 			window_target = output_target;
 		}
 
+		/*
+		 * An intermediate WindowAgg whose run condition fails keeps returning
+		 * the rest of the partition (upper WindowAggs still need the rows),
+		 * with its window functions' results set to NULL.  Since the run
+		 * condition may have replaced a qual of the outer query, the top
+		 * WindowAgg must filter those rows out, so accumulate the
+		 * intermediate run conditions into a qual for it.
+		 */
+		if (!topwindow)
+			topqual = list_concat(topqual, wc->runCondition);
+
 		path = (Path *)
 			create_windowagg_path(root, window_rel, path, window_target,
 								  wflists->windowFuncs[wc->winref],
-								  wc);
+								  wc, topwindow ? topqual : NIL, topwindow);
 	}
 
 	add_path(window_rel, path);
@@ -6358,7 +6474,8 @@ plan_cluster_use_sort(Oid tableOid, Oid indexOid)
  *		CREATE INDEX should request for use
  *
  * tableOid is the table on which the index is to be built.  indexOid is the
- * OID of an index to be created or reindexed (which must be a btree index).
+ * OID of an index to be created or reindexed (which must be an index whose
+ * access method supports parallel builds).
  *
  * Return value is the number of parallel worker processes to request.  It
  * may be unsafe to proceed if this is 0.  Note that this does not include the
@@ -129,6 +129,9 @@ static Plan *set_append_references(PlannerInfo *root,
 static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
+static void set_part_prune_info_references(PlannerInfo *root,
+										   PartitionPruneInfo *pruneinfo,
+										   int rtoffset);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
 static Relids offset_relid_set(Relids relids, int rtoffset);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node,
@@ -825,6 +828,23 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 		case T_WindowAgg:
 			{
 				WindowAgg  *wplan = (WindowAgg *) plan;
+				indexed_tlist *subplan_itlist;
+
+				/*
+				 * The run condition references the WindowAgg's own window
+				 * functions, whose arguments must be fixed up just as in the
+				 * targetlist, so that the executor recognizes them as the
+				 * same functions and computes them only once.
+				 */
+				subplan_itlist = build_tlist_index(plan->lefttree->targetlist);
+				wplan->runCondition = (List *)
+					fix_upper_expr(root,
+								   (Node *) wplan->runCondition,
+								   subplan_itlist,
+								   OUTER_VAR,
+								   rtoffset,
+								   NUM_EXEC_TLIST(plan));
+				pfree(subplan_itlist);
 
 				set_upper_references(root, plan, rtoffset);
 
@@ -1428,20 +1448,7 @@ set_append_references(PlannerInfo *root,
 	aplan->apprelids = offset_relid_set(aplan->apprelids, rtoffset);
 
 	if (aplan->part_prune_info)
-	{
-		foreach(l, aplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
-
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
-			}
-		}
-	}
+		set_part_prune_info_references(root, aplan->part_prune_info, rtoffset);
 
 	/* We don't need to recurse to lefttree or righttree ... */
 	Assert(aplan->plan.lefttree == NULL);
@@ -1492,20 +1499,7 @@ set_mergeappend_references(PlannerInfo *root,
 	mplan->apprelids = offset_relid_set(mplan->apprelids, rtoffset);
 
 	if (mplan->part_prune_info)
-	{
-		foreach(l, mplan->part_prune_info->prune_infos)
-		{
-			List	   *prune_infos = lfirst(l);
-			ListCell   *l2;
-
-			foreach(l2, prune_infos)
-			{
-				PartitionedRelPruneInfo *pinfo = lfirst(l2);
-
-				pinfo->rtindex += rtoffset;
-			}
-		}
-	}
+		set_part_prune_info_references(root, mplan->part_prune_info, rtoffset);
 
 	/* We don't need to recurse to lefttree or righttree ... */
 	Assert(mplan->plan.lefttree == NULL);
@@ -1546,6 +1540,70 @@ set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset)
 	Assert(plan->qual == NIL);
 }
 
+/*
+ * set_part_prune_info_references
+ *		Do set_plan_references processing on the PartitionPruneInfo of an
+ *		Append or MergeAppend node.
+ *
+ * Besides adjusting its RT indexes, we remember the PartitionPruneInfo in
+ * root->glob->partPruneInfos if it does initial pruning, so that
+ * AcquireExecutorLocks() can prune partitions before locking them.  That
+ * relies on the executor's own initial pruning reaching the same result
+ * later, so we don't do it if the pruning steps contain mutable functions,
+ * whose values could change in between; that leaves steps that compare
+ * against external Params.
+ */
+static void
+set_part_prune_info_references(PlannerInfo *root,
+							   PartitionPruneInfo *pruneinfo,
+							   int rtoffset)
+{
+	bool		has_initial_steps = false;
+	bool		has_mutable_steps = false;
+	ListCell   *l;
+
+	foreach(l, pruneinfo->prune_infos)
+	{
+		List	   *prune_infos = lfirst(l);
+		ListCell   *l2;
+
+		foreach(l2, prune_infos)
+		{
+			PartitionedRelPruneInfo *pinfo = lfirst(l2);
+			int			i;
+
+			pinfo->rtindex += rtoffset;
+			for (i = 0; i < pinfo->nparts; i++)
+			{
+				if (pinfo->rti_map[i] > 0)
+					pinfo->rti_map[i] += rtoffset;
+			}
+
+			if (pinfo->initial_pruning_steps != NIL)
+			{
+				ListCell   *l3;
+
+				has_initial_steps = true;
+				foreach(l3, pinfo->initial_pruning_steps)
+				{
+					PartitionPruneStep *step = lfirst(l3);
+					List	   *exprs;
+
+					if (!IsA(step, PartitionPruneStepOp))
+						continue;
+					exprs = ((PartitionPruneStepOp *) step)->exprs;
+					if (contain_mutable_functions((Node *) exprs))
+						has_mutable_steps = true;
+				}
+			}
+		}
+	}
+
+	if (has_initial_steps && !has_mutable_steps)
+		root->glob->partPruneInfos = lappend(root->glob->partPruneInfos,
+											 pruneinfo);
+}
+
 /*
  * offset_relid_set
  *		Apply rtoffset to the members of a Relids set.
@@ -2706,6 +2706,8 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 							  &context);
 			finalize_primnode(((WindowAgg *) plan)->endOffset,
 							  &context);
+			finalize_primnode((Node *) ((WindowAgg *) plan)->runCondition,
+							  &context);
 			break;
 
 		case T_Gather:
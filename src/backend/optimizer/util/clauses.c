@@ -19,13 +19,16 @@
 
 #include "postgres.h"
 
+#include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/table.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_class.h"
 #include "catalog/pg_language.h"
 #include "catalog/pg_operator.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "commands/trigger.h"
 #include "executor/executor.h"
 #include "executor/functions.h"
 #include "funcapi.h"
@@ -42,6 +45,8 @@
 #include "parser/parse_agg.h"
 #include "parser/parse_coerce.h"
 #include "parser/parse_func.h"
+#include "parser/parsetree.h"
+#include "rewrite/rewriteHandler.h"
 #include "rewrite/rewriteManip.h"
 #include "tcop/tcopprot.h"
 #include "utils/acl.h"
@@ -50,6 +55,7 @@
 #include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
+#include "utils/rel.h"
 #include "utils/syscache.h"
 #include "utils/typcache.h"
 
@@ -107,6 +113,10 @@ static bool contain_volatile_functions_walker(Node *node, void *context);
 static bool contain_volatile_functions_not_nextval_walker(Node *node, void *context);
 static bool max_parallel_hazard_walker(Node *node,
 									   max_parallel_hazard_context *context);
+static bool max_parallel_hazard_test(char proparallel,
+									 max_parallel_hazard_context *context);
+static bool target_rel_max_parallel_hazard(Query *parse,
+										   max_parallel_hazard_context *context);
 static bool contain_nonstrict_functions_walker(Node *node, void *context);
 static bool contain_exec_param_walker(Node *node, List *param_ids);
 static bool contain_context_dependent_node(Node *clause);
@@ -839,10 +849,145 @@ max_parallel_hazard(Query *parse)
 	context.max_hazard = PROPARALLEL_SAFE;
 	context.max_interesting = PROPARALLEL_UNSAFE;
 	context.safe_param_ids = NIL;
-	(void) max_parallel_hazard_walker((Node *) parse, &context);
+	if (!max_parallel_hazard_walker((Node *) parse, &context) &&
+		parse->commandType == CMD_INSERT)
+		(void) target_rel_max_parallel_hazard(parse, &context);
 	return context.max_hazard;
 }
 
+/*
+ * target_rel_max_parallel_hazard
+ *		Find the worst parallel hazard of inserting into the target of an
+ *		INSERT
+ *
+ * Inserting into a plain table can be done by parallel workers, but only if
+ * everything evaluated on the way is parallel-safe: check constraints,
+ * stored generated columns, and index expressions and predicates.  Tables
+ * that can't be handled by workers at all, such as temporary tables or
+ * tables with triggers, make the insert parallel-restricted, so that at
+ * least the SELECT part of the query can still use parallelism.
+ *
+ * Returns true if the caller should stop looking, like the walker.
+ */
+static bool
+target_rel_max_parallel_hazard(Query *parse,
+							   max_parallel_hazard_context *context)
+{
+	RangeTblEntry *rte = rt_fetch(parse->resultRelation, parse->rtable);
+	Relation	rel;
+	TupleConstr *constr;
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		result = false;
+
+	/*
+	 * ON CONFLICT DO UPDATE might need to update tuples, which isn't allowed
+	 * in parallel mode; we don't bother to distinguish DO NOTHING.  Other
+	 * kinds of relations need tuple routing or an FDW, which we don't try to
+	 * support either.
+	 */
+	if (parse->onConflict != NULL || rte->relkind != RELKIND_RELATION)
+		return max_parallel_hazard_test(PROPARALLEL_UNSAFE, context);
+
+	/* The rewriter has locked the relation already */
+	rel = table_open(rte->relid, NoLock);
+
+	/*
+	 * Workers can't see our temporary buffers, and don't know whether we've
+	 * skipped WAL for a table created in this transaction.
+	 */
+	if (rel->rd_rel->relpersistence == RELPERSISTENCE_TEMP ||
+		(rel->rd_rel->relpersistence == RELPERSISTENCE_PERMANENT &&
+		 !RelationNeedsWAL(rel)))
+	{
+		if (max_parallel_hazard_test(PROPARALLEL_RESTRICTED, context))
+			goto done;
+	}
+
+	/*
+	 * Trigger events queued by a worker would be lost, so the leader has to
+	 * do the inserting if there are any triggers.  The trigger functions run
+	 * in parallel mode regardless, so check them too.  Foreign key checks
+	 * run once parallel mode has been exited again.
+	 */
+	if (rel->trigdesc != NULL)
+	{
+		int			i;
+
+		if (max_parallel_hazard_test(PROPARALLEL_RESTRICTED, context))
+			goto done;
+		for (i = 0; i < rel->trigdesc->numtriggers; i++)
+		{
+			Oid			tgfoid = rel->trigdesc->triggers[i].tgfoid;
+
+			if (RI_FKey_trigger_type(tgfoid) != RI_TRIGGER_NONE)
+				continue;
+			if (max_parallel_hazard_test(func_parallel(tgfoid), context))
+			{
+				result = true;
+				goto done;
+			}
+		}
+	}
+
+	constr = RelationGetDescr(rel)->constr;
+	if (constr != NULL)
+	{
+		int			i;
+
+		for (i = 0; i < constr->num_check; i++)
+		{
+			Node	   *check_expr = stringToNode(constr->check[i].ccbin);
+
+			if (max_parallel_hazard_walker(check_expr, context))
+			{
+				result = true;
+				goto done;
+			}
+		}
+
+		if (constr->has_generated_stored)
+		{
+			for (i = 0; i < RelationGetNumberOfAttributes(rel); i++)
+			{
+				Form_pg_attribute att = TupleDescAttr(RelationGetDescr(rel), i);
+
+				if (att->attgenerated != ATTRIBUTE_GENERATED_STORED)
+					continue;
+				if (max_parallel_hazard_walker(build_column_default(rel, i + 1),
+											   context))
+				{
+					result = true;
+					goto done;
+				}
+			}
+		}
+	}
+
+	indexoidlist = RelationGetIndexList(rel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	indexRel = index_open(lfirst_oid(lc), rte->rellockmode);
+		bool		found;
+
+		found = max_parallel_hazard_walker((Node *) RelationGetIndexExpressions(indexRel),
+										   context) ||
+			max_parallel_hazard_walker((Node *) RelationGetIndexPredicate(indexRel),
+									   context);
+		index_close(indexRel, NoLock);
+		if (found)
+		{
+			result = true;
+			break;
+		}
+	}
+	list_free(indexoidlist);
+
+done:
+	table_close(rel, NoLock);
+	return result;
+}
+
 /*
  * is_parallel_safe
  *		Detect whether the given expr contains only parallel-safe functions
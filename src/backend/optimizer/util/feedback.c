@@ -0,0 +1,284 @@
+/*-------------------------------------------------------------------------
+ *
+ * feedback.c
+ *	  Cardinality feedback from the executor to the planner
+ *
+ * When adaptive_reoptimization is enabled, the executor compares the number
+ * of rows it actually sees at certain checkpoints (the input of a Hash or
+ * Sort node, which must be read completely before the node can return
+ * anything) with the planner's estimate.  If the two differ by more than a
+ * factor of reoptimization_threshold, the observed row count is remembered
+ * here, and the planner uses it in place of its own estimate whenever it
+ * plans the same query again in this backend.  If no row has been returned
+ * yet, the executor also re-plans the query on the spot; see ExecReplan().
+ *
+ * Feedback is keyed by the query, and by the set of relations whose join
+ * (or scan) produced the rows.  A query is identified by a hash of its
+ * parse tree, computed before planning starts; subqueries that are planned
+ * separately are identified by their own parse tree, since their relids are
+ * only meaningful within their own range table.  Row counts depend on the
+ * values of the query's parameters, too, so those are part of the key; if
+ * the planner doesn't get to see them, as for a generic plan, there is no
+ * feedback at all.
+ *
+ * The feedback is kept in backend-local memory, and is simply thrown away
+ * if it grows beyond MAX_FEEDBACK_ENTRIES entries.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/feedback.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "common/hashfn.h"
+#include "fmgr.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/cost.h"
+#include "optimizer/feedback.h"
+#include "optimizer/optimizer.h"
+#include "utils/datum.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+
+/* GUC parameters */
+bool		adaptive_reoptimization = false;
+double		reoptimization_threshold = DEFAULT_REOPTIMIZATION_THRESHOLD;
+
+/* Maximum number of entries in the feedback table */
+#define MAX_FEEDBACK_ENTRIES	4096
+
+typedef struct CardinalityFeedbackKey
+{
+	uint64		querykey;		/* see feedback_query_key() */
+	uint32		relidshash;		/* bms_hash_value() of the relids */
+} CardinalityFeedbackKey;
+
+typedef struct CardinalityFeedbackEntry
+{
+	CardinalityFeedbackKey key; /* hash key (must be first) */
+	double		rows;			/* observed number of rows */
+} CardinalityFeedbackEntry;
+
+static HTAB *CardinalityFeedback = NULL;
+
+typedef struct
+{
+	ParamListInfo boundParams;	/* parameter values available to planner */
+	uint64		hash;			/* hash of the values seen so far */
+} feedback_params_context;
+
+static bool feedback_params_walker(Node *node,
+								   feedback_params_context *context);
+static void make_feedback_key(CardinalityFeedbackKey *key,
+							  uint64 querykey, Relids relids);
+
+
+/*
+ * feedback_query_key
+ *		Compute the key identifying a query in the feedback table.
+ *
+ * This must be called before the planner starts scribbling on the parse
+ * tree.  The values of any external parameters the query refers to are
+ * taken from 'boundParams'.  Returns zero, meaning "no feedback", if some of
+ * them aren't available to the planner; otherwise the result is never zero.
+ */
+uint64
+feedback_query_key(Query *parse, ParamListInfo boundParams)
+{
+	feedback_params_context context;
+	char	   *str;
+	uint64		result;
+
+	context.boundParams = boundParams;
+	context.hash = 0;
+	if (feedback_params_walker((Node *) parse, &context))
+		return 0;
+
+	str = nodeToString(parse);
+	result = hash_bytes_extended((const unsigned char *) str,
+								 strlen(str), context.hash);
+	pfree(str);
+
+	return result != 0 ? result : 1;
+}
+
+/*
+ * Fold the values of the external parameters in a query into context->hash.
+ *
+ * Returns true, to abort the walk, on finding a parameter whose value the
+ * planner won't treat as a constant; an estimate that was far off for one
+ * value says nothing about another.  We look up parameters the same way
+ * eval_const_expressions() does.
+ */
+static bool
+feedback_params_walker(Node *node, feedback_params_context *context)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+		ParamListInfo paramLI = context->boundParams;
+		ParamExternData *prm;
+		ParamExternData prmdata;
+		int16		typLen;
+		bool		typByVal;
+
+		if (param->paramkind != PARAM_EXTERN)
+			return false;
+
+		if (paramLI == NULL || param->paramid <= 0 ||
+			param->paramid > paramLI->numParams)
+			return true;
+		if (paramLI->paramFetch != NULL)
+			prm = paramLI->paramFetch(paramLI, param->paramid,
+									  true, &prmdata);
+		else
+			prm = &paramLI->params[param->paramid - 1];
+		if (!(prm->pflags & PARAM_FLAG_CONST) ||
+			prm->ptype != param->paramtype)
+			return true;
+
+		context->hash = hash_combine64(context->hash, param->paramid);
+		if (prm->isnull)
+			return false;
+
+		get_typlenbyval(prm->ptype, &typLen, &typByVal);
+		if (typByVal)
+			context->hash = hash_combine64(context->hash,
+										   (uint64) prm->value);
+		else
+		{
+			Datum		value = prm->value;
+			Size		len;
+
+			if (typLen == -1)
+				value = PointerGetDatum(PG_DETOAST_DATUM_PACKED(value));
+			len = datumGetSize(value, false, typLen);
+			context->hash =
+				hash_bytes_extended((const unsigned char *) DatumGetPointer(value),
+									len, context->hash);
+		}
+		return false;
+	}
+	if (IsA(node, Query))
+		return query_tree_walker((Query *) node, feedback_params_walker,
+								 (void *) context, 0);
+	return expression_tree_walker(node, feedback_params_walker,
+								  (void *) context);
+}
+
+/*
+ * query_supports_reoptimization
+ *		Can the executor re-plan this query in the middle of running it?
+ *
+ * Re-planning means starting over, so that must not be visible: only plain
+ * SELECTs qualify, and only if they contain nothing volatile whose
+ * side-effects or results could differ on a second evaluation.  Stable
+ * functions may be evaluated again, which is allowed for them anyway.
+ */
+bool
+query_supports_reoptimization(Query *parse)
+{
+	return parse->commandType == CMD_SELECT &&
+		parse->utilityStmt == NULL &&
+		parse->rowMarks == NIL &&
+		!parse->hasModifyingCTE &&
+		!contain_volatile_functions((Node *) parse);
+}
+
+/*
+ * record_cardinality_feedback
+ *		Remember the number of rows observed for a relation or join.
+ */
+void
+record_cardinality_feedback(uint64 querykey, Relids relids, double rows)
+{
+	CardinalityFeedbackKey key;
+	CardinalityFeedbackEntry *entry;
+	bool		found;
+
+	Assert(querykey != 0);
+
+	if (CardinalityFeedback != NULL &&
+		hash_get_num_entries(CardinalityFeedback) >= MAX_FEEDBACK_ENTRIES)
+	{
+		hash_destroy(CardinalityFeedback);
+		CardinalityFeedback = NULL;
+	}
+
+	if (CardinalityFeedback == NULL)
+	{
+		HASHCTL		ctl;
+
+		ctl.keysize = sizeof(CardinalityFeedbackKey);
+		ctl.entrysize = sizeof(CardinalityFeedbackEntry);
+		ctl.hcxt = TopMemoryContext;
+		CardinalityFeedback = hash_create("Cardinality feedback", 256, &ctl,
+										  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	make_feedback_key(&key, querykey, relids);
+	entry = (CardinalityFeedbackEntry *)
+		hash_search(CardinalityFeedback, &key, HASH_ENTER, &found);
+	entry->rows = rows;
+}
+
+/*
+ * lookup_cardinality_feedback
+ *		Look up the number of rows observed for a relation or join.
+ *
+ * Returns true and sets *rows if there is any feedback.
+ */
+bool
+lookup_cardinality_feedback(uint64 querykey, Relids relids, double *rows)
+{
+	CardinalityFeedbackKey key;
+	CardinalityFeedbackEntry *entry;
+
+	if (CardinalityFeedback == NULL || querykey == 0)
+		return false;
+
+	make_feedback_key(&key, querykey, relids);
+	entry = (CardinalityFeedbackEntry *)
+		hash_search(CardinalityFeedback, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+		return false;
+
+	*rows = entry->rows;
+	return true;
+}
+
+/*
+ * apply_cardinality_feedback
+ *		Replace the estimated size of a base or join relation by the size
+ *		observed during an earlier execution of the query, if known.
+ */
+void
+apply_cardinality_feedback(PlannerInfo *root, RelOptInfo *rel)
+{
+	double		rows;
+
+	if (root->feedback_key != 0 &&
+		lookup_cardinality_feedback(root->feedback_key, rel->relids, &rows))
+		rel->rows = clamp_row_est(rows);
+}
+
+/*
+ * Build a hash key for the given query and relids.
+ */
+static void
+make_feedback_key(CardinalityFeedbackKey *key, uint64 querykey, Relids relids)
+{
+	/* zero the padding, since we use HASH_BLOBS */
+	memset(key, 0, sizeof(CardinalityFeedbackKey));
+	key->querykey = querykey;
+	key->relidshash = bms_hash_value(relids);
+}
@@ -153,6 +153,11 @@ get_relation_info(PlannerInfo *root, Oid relationObjectId, bool inhparent,
 	/* Retrieve the parallel_workers reloption, or -1 if not set. */
 	rel->rel_parallel_workers = RelationGetParallelWorkers(relation, -1);
 
+	/* Note which optional features the table AM supports */
+	if (relation->rd_tableam != NULL &&
+		relation->rd_tableam->scan_set_hints != NULL)
+		rel->amflags |= AMFLAG_HAS_COLUMN_PROJECTION;
+
 	/*
 	 * Make list of indexes.  Ignore indexes on system catalogs if told to.
 	 * Don't bother with indexes for an inheritance parent, either.
@@ -234,6 +234,7 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptInfo *parent)
 	rel->subroot = NULL;
 	rel->subplan_params = NIL;
 	rel->rel_parallel_workers = -1; /* set up in get_relation_info */
+	rel->amflags = 0;
 	rel->serverid = InvalidOid;
 	rel->userid = rte->checkAsUser;
 	rel->useridiscurrent = false;
@@ -648,6 +649,7 @@ build_join_rel(PlannerInfo *root,
 	joinrel->subroot = NULL;
 	joinrel->subplan_params = NIL;
 	joinrel->rel_parallel_workers = -1;
+	joinrel->amflags = 0;
 	joinrel->serverid = InvalidOid;
 	joinrel->userid = InvalidOid;
 	joinrel->useridiscurrent = false;
@@ -1231,6 +1233,73 @@ fetch_upper_rel(PlannerInfo *root, UpperRelationKind kind, Relids relids)
 }
 
 
+/*
+ * build_grouped_rel
+ *		Build the partially aggregated counterpart of a base or join relation
+ *		that includes the relation being eagerly aggregated.
+ *
+ * The result is a flat copy of 'rel', except that its reltarget omits the
+ * aggregated relation's Vars that are needed only by the aggregates, and
+ * emits the partial aggregates instead.  It has no paths yet, and the caller
+ * must set its size estimate.  Parallelism, partitionwise techniques and
+ * foreign-join pushdown are not considered for grouped relations.
+ */
+RelOptInfo *
+build_grouped_rel(PlannerInfo *root, RelOptInfo *rel)
+{
+	RelAggInfo *agg_info = root->agg_info;
+	RelOptInfo *grouped_rel;
+	PathTarget *target;
+	ListCell   *lc;
+
+	Assert(agg_info != NULL);
+	Assert(bms_is_member(agg_info->relid, rel->relids));
+
+	target = create_empty_pathtarget();
+	foreach(lc, rel->reltarget->exprs)
+	{
+		Expr	   *expr = (Expr *) lfirst(lc);
+
+		if (IsA(expr, Var) &&
+			((Var *) expr)->varno == agg_info->relid &&
+			!bms_is_member(((Var *) expr)->varattno, agg_info->group_attnos))
+			continue;
+		add_column_to_pathtarget(target, expr, 0);
+	}
+	foreach(lc, agg_info->agg_exprs)
+		add_column_to_pathtarget(target, (Expr *) lfirst(lc), 0);
+	set_pathtarget_cost_width(root, target);
+
+	grouped_rel = makeNode(RelOptInfo);
+	memcpy(grouped_rel, rel, sizeof(RelOptInfo));
+
+	grouped_rel->reltarget = target;
+	grouped_rel->consider_parallel = false;
+	grouped_rel->pathlist = NIL;
+	grouped_rel->ppilist = NIL;
+	grouped_rel->partial_pathlist = NIL;
+	grouped_rel->cheapest_startup_path = NULL;
+	grouped_rel->cheapest_total_path = NULL;
+	grouped_rel->cheapest_unique_path = NULL;
+	grouped_rel->cheapest_parameterized_paths = NIL;
+	grouped_rel->serverid = InvalidOid;
+	grouped_rel->fdwroutine = NULL;
+	grouped_rel->fdw_private = NULL;
+	grouped_rel->unique_for_rels = NIL;
+	grouped_rel->non_unique_for_rels = NIL;
+	grouped_rel->consider_partitionwise_join = false;
+	grouped_rel->part_scheme = NULL;
+	grouped_rel->nparts = 0;
+	grouped_rel->boundinfo = NULL;
+	grouped_rel->part_rels = NULL;
+	grouped_rel->partexprs = NULL;
+	grouped_rel->nullable_partexprs = NULL;
+	grouped_rel->grouped_rel = NULL;
+
+	return grouped_rel;
+}
+
+
 /*
  * find_childrel_parents
  *		Compute the set of parent relids of an appendrel child rel.
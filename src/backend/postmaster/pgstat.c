@@ -4137,6 +4137,15 @@ pgstat_get_wait_io(WaitEventIO w)
 		case WAIT_EVENT_DSM_FILL_ZERO_WRITE:
 			event_name = "DSMFillZeroWrite";
 			break;
+		case WAIT_EVENT_DOUBLE_WRITE_READ:
+			event_name = "DoubleWriteRead";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_SYNC:
+			event_name = "DoubleWriteSync";
+			break;
+		case WAIT_EVENT_DOUBLE_WRITE_WRITE:
+			event_name = "DoubleWriteWrite";
+			break;
 		case WAIT_EVENT_LOCK_FILE_ADDTODATADIR_READ:
 			event_name = "LockFileAddToDataDirRead";
 			break;
@@ -19,6 +19,7 @@
 #include "access/xlog_internal.h"	/* for pg_start/stop_backup */
 #include "catalog/pg_type.h"
 #include "common/file_perm.h"
+#include "common/pagecompress.h"
 #include "commands/progress.h"
 #include "lib/stringinfo.h"
 #include "libpq/libpq.h"
@@ -181,6 +182,9 @@ static const char *const excludeDirContents[] =
 	/* Contents removed on startup, see DeleteAllExportedSnapshotFiles(). */
 	"pg_snapshots",
 
+	/* Contents removed on startup, see StartupDoubleWrite(). */
+	"pg_dblwr",
+
 	/* Contents zeroed on startup, see StartupSUBTRANS(). */
 	"pg_subtrans",
 
@@ -1577,6 +1581,9 @@ sendFile(const char *readfilename, const char *tarfilename,
 	int			i;
 	pgoff_t		len = 0;
 	char	   *page;
+	char	   *checkpage;
+	bool		damaged;
+	PGAlignedBlock decompressed;
 	size_t		pad;
 	PageHeader	phdr;
 	int			segmentno = 0;
@@ -1674,6 +1681,21 @@ sendFile(const char *readfilename, const char *tarfilename,
 			{
 				page = buf + BLCKSZ * i;
 
+				/*
+				 * A compressed page is checked after decompressing it.  If
+				 * that fails, we may have read it while it was being
+				 * written, so it's retried like a checksum failure.
+				 */
+				checkpage = page;
+				damaged = false;
+				if (page_is_compressed(page))
+				{
+					if (page_decompress(page, decompressed.data))
+						checkpage = decompressed.data;
+					else
+						damaged = true;
+				}
+
 				/*
 				 * Only check pages which have not been modified since the
 				 * start of the base backup. Otherwise, they might have been
@@ -1682,11 +1704,13 @@ sendFile(const char *readfilename, const char *tarfilename,
 				 * this case. We also skip completely new pages, since they
 				 * don't have a checksum yet.
 				 */
-				if (!PageIsNew(page) && PageGetLSN(page) < startptr)
+				if (damaged ||
+					(!PageIsNew(checkpage) && PageGetLSN(checkpage) < startptr))
 				{
-					checksum = pg_checksum_page((char *) page, blkno + segmentno * RELSEG_SIZE);
-					phdr = (PageHeader) page;
-					if (phdr->pd_checksum != checksum)
+					checksum = damaged ? 0 :
+						pg_checksum_page(checkpage, blkno + segmentno * RELSEG_SIZE);
+					phdr = (PageHeader) checkpage;
+					if (damaged || phdr->pd_checksum != checksum)
 					{
 						/*
 						 * Retry the block on the first failure.  It's
@@ -1732,7 +1756,12 @@ sendFile(const char *readfilename, const char *tarfilename,
 
 						checksum_failures++;
 
-						if (checksum_failures <= 5)
+						if (checksum_failures <= 5 && damaged)
+							ereport(WARNING,
+									(errmsg("invalid compressed block in "
+											"file \"%s\", block %d",
+											readfilename, blkno)));
+						else if (checksum_failures <= 5)
 							ereport(WARNING,
 									(errmsg("checksum verification failed in "
 											"file \"%s\", block %d: calculated "
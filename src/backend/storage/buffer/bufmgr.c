@@ -45,6 +45,7 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
@@ -192,6 +193,18 @@ static int32 PrivateRefCountOverflowed = 0;
 static uint32 PrivateRefCountClock = 0;
 static PrivateRefCountEntry *ReservedRefCountEntry = NULL;
 
+/*
+ * With double_write_buffer, SyncOneBuffer collects the pages it would write
+ * into a batch, and FlushWriteBatch writes them out together.  We don't keep
+ * the buffers pinned in between, lest we hold up a cleanup lock while the
+ * checkpointer naps; a buffer whose tag has changed when the batch is written
+ * has been written out by whoever replaced it.
+ */
+static int	WriteBatchBufs[DOUBLE_WRITE_BATCH_SIZE];
+static BufferTag WriteBatchTags[DOUBLE_WRITE_BATCH_SIZE];
+static char *WriteBatchCopies[DOUBLE_WRITE_BATCH_SIZE];
+static int	WriteBatchCount = 0;
+
 static void ReservePrivateRefCountEntry(void);
 static PrivateRefCountEntry *NewPrivateRefCountEntry(Buffer buffer);
 static PrivateRefCountEntry *GetPrivateRefCountEntry(Buffer buffer, bool do_move);
@@ -460,6 +473,7 @@ static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used,
 						  WritebackContext *wb_context);
+static void FlushWriteBatch(WritebackContext *wb_context);
 static void WaitIO(BufferDesc *buf);
 static bool StartBufferIO(BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
@@ -472,7 +486,7 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 							   BlockNumber blockNum,
 							   BufferAccessStrategy strategy,
 							   bool *foundPtr);
-static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static void FlushBuffer(BufferDesc *buf, SMgrRelation reln, char *dwcopy);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
@@ -1108,6 +1122,22 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 */
 		if (oldFlags & BM_DIRTY)
 		{
+			/*
+			 * With double_write_buffer, writing the buffer ourselves would
+			 * cost an fsync of our double-write file.  Rather hand it to the
+			 * background writer, which writes buffers in batches, and look
+			 * for another victim.  A buffer access strategy recycles its own
+			 * small ring of buffers, so it has to write them itself.
+			 */
+			if (double_write_buffer && strategy == NULL &&
+				(oldFlags & BM_PERMANENT) &&
+				IsUnderPostmaster && !AmBackgroundWriterProcess() &&
+				DoubleWriteHandOff(buf->buf_id))
+			{
+				UnpinBuffer(buf, true);
+				continue;
+			}
+
 			/*
 			 * We need a share-lock on the buffer contents to write it out
 			 * (else we might write invalid data, eg because someone else is
@@ -1158,7 +1188,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 														  smgr->smgr_rnode.node.dbNode,
 														  smgr->smgr_rnode.node.relNode);
 
-				FlushBuffer(buf, NULL);
+				FlushBuffer(buf, NULL, NULL);
 				LWLockRelease(BufferDescriptorGetContentLock(buf));
 
 				ScheduleBufferTagForWriteback(&BackendWritebackContext,
@@ -2079,7 +2109,8 @@ BufferSync(int flags)
 		CheckpointWriteDelay(flags, (double) num_processed / num_to_scan);
 	}
 
-	/* issue all pending flushes */
+	/* write out the last double-write batch, and issue all pending flushes */
+	FlushWriteBatch(&wb_context);
 	IssuePendingWritebacks(&wb_context);
 
 	pfree(per_ts_stat);
@@ -2114,6 +2145,10 @@ BgBufferSync(WritebackContext *wb_context)
 	uint32		strategy_passes;
 	uint32		recent_alloc;
 
+	/* buffers handed to us by backends */
+	int			handed_off[DOUBLE_WRITE_QUEUE_SIZE];
+	int			num_handed_off;
+
 	/*
 	 * Information saved between calls so we can determine the strategy
 	 * point's advance rate and avoid scanning already-cleaned buffers.
@@ -2159,6 +2194,24 @@ BgBufferSync(WritebackContext *wb_context)
 	/* Report buffer alloc counts to pgstat */
 	BgWriterStats.m_buf_alloc += recent_alloc;
 
+	/*
+	 * Write out the buffers that backends handed to us rather than writing
+	 * them with double_write_buffer themselves, see BufferAlloc.  They were
+	 * chosen for replacement, so write them even if they've been used since.
+	 */
+	num_handed_off = DoubleWriteTakeHandedOff(handed_off);
+	if (num_handed_off > 0)
+	{
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+
+		for (int i = 0; i < num_handed_off; i++)
+		{
+			if (SyncOneBuffer(handed_off[i], false, wb_context) & BUF_WRITTEN)
+				BgWriterStats.m_buf_written_clean++;
+		}
+		FlushWriteBatch(wb_context);
+	}
+
 	/*
 	 * If we're not running the LRU scan, just stop after doing the stats
 	 * stuff.  We mark the saved state invalid so that we can recover sanely
@@ -2355,6 +2408,8 @@ BgBufferSync(WritebackContext *wb_context)
 			reusable_buffers++;
 	}
 
+	FlushWriteBatch(wb_context);
+
 	BgWriterStats.m_buf_written_clean += num_written;
 
 #ifdef BGW_DEBUG
@@ -2456,7 +2511,35 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	PinBuffer_Locked(bufHdr);
 	LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
 
-	FlushBuffer(bufHdr, NULL);
+	/*
+	 * With double_write_buffer, only copy the page into the double-write
+	 * batch for now.  FlushWriteBatch writes it out along with the rest of
+	 * the batch.  Unlogged relations are reset after a crash anyway.
+	 */
+	if (double_write_buffer && (buf_state & BM_PERMANENT))
+	{
+		char	   *page;
+
+		page = PageSetChecksumCopy((Page) BufHdrGetBlock(bufHdr),
+								   bufHdr->tag.blockNum);
+
+		WriteBatchBufs[WriteBatchCount] = buf_id;
+		WriteBatchTags[WriteBatchCount] = bufHdr->tag;
+		WriteBatchCopies[WriteBatchCount] =
+			DoubleWriteBatchAdd(bufHdr->tag.rnode, bufHdr->tag.forkNum,
+								bufHdr->tag.blockNum, page);
+		WriteBatchCount++;
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr, true);
+
+		if (WriteBatchCount == DOUBLE_WRITE_BATCH_SIZE)
+			FlushWriteBatch(wb_context);
+
+		return result | BUF_WRITTEN;
+	}
+
+	FlushBuffer(bufHdr, NULL, NULL);
 
 	LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 
@@ -2469,6 +2552,53 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * FlushWriteBatch -- write out the buffers collected by SyncOneBuffer.
+ *
+ * The pages go to the double-write file first, with a single fsync for the
+ * whole batch, and then each one is written in place.  Buffers that have been
+ * replaced or cleaned in the meantime are skipped.
+ *
+ * Note: caller must have done ResourceOwnerEnlargeBuffers.
+ */
+static void
+FlushWriteBatch(WritebackContext *wb_context)
+{
+	if (WriteBatchCount == 0)
+		return;
+
+	DoubleWriteBatchFlush();
+
+	for (int i = 0; i < WriteBatchCount; i++)
+	{
+		BufferDesc *bufHdr = GetBufferDescriptor(WriteBatchBufs[i]);
+		uint32		buf_state;
+
+		ReservePrivateRefCountEntry();
+
+		buf_state = LockBufHdr(bufHdr);
+		if (!BUFFERTAGS_EQUAL(bufHdr->tag, WriteBatchTags[i]) ||
+			!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+		{
+			UnlockBufHdr(bufHdr, buf_state);
+			continue;
+		}
+
+		PinBuffer_Locked(bufHdr);
+		LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
+
+		FlushBuffer(bufHdr, NULL, WriteBatchCopies[i]);
+
+		LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
+		UnpinBuffer(bufHdr, true);
+
+		ScheduleBufferTagForWriteback(wb_context, &WriteBatchTags[i]);
+	}
+
+	WriteBatchCount = 0;
+	DoubleWriteBatchDone();
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2481,6 +2611,13 @@ AtEOXact_Buffers(bool isCommit)
 {
 	CheckForBufferLeaks();
 
+	/* Forget a double-write batch that an error interrupted */
+	if (WriteBatchCount > 0)
+	{
+		WriteBatchCount = 0;
+		DoubleWriteBatchDone();
+	}
+
 	AtEOXact_LocalBuffers(isCommit);
 
 	Assert(PrivateRefCountOverflowed == 0);
@@ -2717,10 +2854,12 @@ BufferGetTag(Buffer buffer, RelFileNode *rnode, ForkNumber *forknum,
  * written.)
  *
  * If the caller has an smgr reference for the buffer's relation, pass it
- * as the second parameter.  If not, pass NULL.
+ * as the second parameter.  If not, pass NULL.  If the caller has saved the
+ * page in the double-write file already, dwcopy is the copy it saved, see
+ * FlushWriteBatch; otherwise NULL.
  */
 static void
-FlushBuffer(BufferDesc *buf, SMgrRelation reln)
+FlushBuffer(BufferDesc *buf, SMgrRelation reln, char *dwcopy)
 {
 	XLogRecPtr	recptr;
 	ErrorContextCallback errcallback;
@@ -2803,6 +2942,19 @@ FlushBuffer(BufferDesc *buf, SMgrRelation reln)
 	if (track_io_timing)
 		INSTR_TIME_SET_CURRENT(io_start);
 
+	/*
+	 * With double_write_buffer, save the page in the double-write file
+	 * before writing it in place, so that crash recovery can repair it if
+	 * the write is torn.  Unlogged relations are reset after a crash anyway.
+	 * If the caller already saved the page with a double-write batch, and it
+	 * hasn't changed since, write the saved copy instead.
+	 */
+	if (dwcopy != NULL && memcmp(bufToWrite, dwcopy, BLCKSZ) == 0)
+		bufToWrite = dwcopy;
+	else if (double_write_buffer && (buf_state & BM_PERMANENT))
+		bufToWrite = DoubleWritePage(buf->tag.rnode, buf->tag.forkNum,
+									 buf->tag.blockNum, bufToWrite);
+
 	/*
 	 * bufToWrite is either the shared buffer or a copy, as appropriate.
 	 */
@@ -3324,7 +3476,7 @@ FlushRelationBuffers(Relation rel)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, rel->rd_smgr);
+			FlushBuffer(bufHdr, rel->rd_smgr, NULL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3420,7 +3572,7 @@ FlushRelationsAllBuffers(SMgrRelation *smgrs, int nrels)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, srelent->srel);
+			FlushBuffer(bufHdr, srelent->srel, NULL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3476,7 +3628,7 @@ FlushDatabaseBuffers(Oid dbid)
 		{
 			PinBuffer_Locked(bufHdr);
 			LWLockAcquire(BufferDescriptorGetContentLock(bufHdr), LW_SHARED);
-			FlushBuffer(bufHdr, NULL);
+			FlushBuffer(bufHdr, NULL, NULL);
 			LWLockRelease(BufferDescriptorGetContentLock(bufHdr));
 			UnpinBuffer(bufHdr, true);
 		}
@@ -3503,7 +3655,7 @@ FlushOneBuffer(Buffer buffer)
 
 	Assert(LWLockHeldByMe(BufferDescriptorGetContentLock(bufHdr)));
 
-	FlushBuffer(bufHdr, NULL);
+	FlushBuffer(bufHdr, NULL, NULL);
 }
 
 /*
@@ -0,0 +1,710 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.c
+ *	  Torn page protection by writing pages to a double-write file first
+ *
+ * If the operating system crashes while a page is being written, only part
+ * of the write may reach disk.  Normally full_page_writes protects against
+ * such torn pages, by putting an image of every page into WAL when it is
+ * first modified after a checkpoint.  With double_write_buffer, the buffer
+ * manager instead writes each page to a double-write file, and fsyncs that,
+ * before writing it in place.  If the in-place write is torn, the copy in the
+ * double-write file is intact, and StartupDoubleWrite puts it back before
+ * crash recovery starts replaying WAL.  full_page_writes can then be turned
+ * off, which saves a lot of WAL.
+ *
+ * An fsync per page would be far too slow, so the checkpointer and the
+ * background writer collect the pages they write into batches of up to
+ * DOUBLE_WRITE_BATCH_SIZE: DoubleWriteBatchAdd copies a page into the batch,
+ * DoubleWriteBatchFlush writes the whole batch with one write and one fsync,
+ * and the caller then writes the pages in place and calls
+ * DoubleWriteBatchDone.  Backends that need to evict a dirty buffer hand it
+ * to the background writer with DoubleWriteHandOff, and look for another
+ * victim, rather than writing it themselves.  Only when the hand-off queue
+ * is full, or in processes that write pages outside of those paths, does
+ * DoubleWritePage write and fsync a single page.
+ *
+ * Every process has a double-write file of its own, named after its
+ * pgprocno, so the writes don't contend with each other.  The file has
+ * DW_SLOTS slots that the process fills in turn.  A slot may only be reused
+ * once the page last written through it has reached disk in place, so before
+ * wrapping around, the process fsyncs the data files it wrote to since the
+ * last time.  The checkpointer fsyncs the data files too, so in crash
+ * recovery we only need the pages written after the redo point.
+ *
+ * Only writes of permanent relations' shared buffers go through here.
+ * Pages written directly with smgrwrite() or smgrextend() are WAL-logged
+ * in full, or synced before commit, by their callers.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/storage/buffer/doublewrite.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/xlog.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_crc32c.h"
+#include "storage/bufpage.h"
+#include "storage/doublewrite.h"
+#include "storage/fd.h"
+#include "storage/md.h"
+#include "storage/proc.h"
+#include "storage/shmem.h"
+#include "storage/smgr.h"
+#include "storage/spin.h"
+#include "storage/sync.h"
+#include "utils/memutils.h"
+
+/* GUC variable */
+bool		double_write_buffer = false;
+
+/*
+ * Each slot of a double-write file is a header, padded to one sector so that
+ * the page that follows it stays aligned, and a page.
+ */
+typedef struct DoubleWriteSlotHeader
+{
+	uint32		magic;			/* DW_MAGIC */
+	RelFileNode rnode;			/* the page's relation, fork and block */
+	ForkNumber	forknum;
+	BlockNumber blocknum;
+	XLogRecPtr	written_at;		/* WAL insert or replay position at write */
+	pg_crc32c	crc;			/* CRC of all of the above, and the page */
+} DoubleWriteSlotHeader;
+
+#define DW_MAGIC		0x44574231	/* "DWB1" */
+#define DW_HEADER_SIZE	512
+#define DW_SLOT_SIZE	(DW_HEADER_SIZE + BLCKSZ)
+#define DW_SLOTS		128
+
+StaticAssertDecl(sizeof(DoubleWriteSlotHeader) <= DW_HEADER_SIZE,
+				 "DoubleWriteSlotHeader doesn't fit in DW_HEADER_SIZE");
+
+StaticAssertDecl(DOUBLE_WRITE_BATCH_SIZE <= DW_SLOTS,
+				 "DOUBLE_WRITE_BATCH_SIZE is larger than DW_SLOTS");
+
+/*
+ * Dirty buffers that backends want evicted, for the background writer to
+ * write out.
+ */
+typedef struct DoubleWriteQueue
+{
+	slock_t		mutex;			/* protects the rest */
+	int			nbufs;			/* number of valid entries in buf_ids */
+	int			buf_ids[DOUBLE_WRITE_QUEUE_SIZE];
+} DoubleWriteQueue;
+
+static DoubleWriteQueue *DWQueue = NULL;
+
+/* A page found in a double-write file during crash recovery */
+typedef struct DoubleWriteEntry
+{
+	DoubleWriteSlotHeader hdr;
+	char	   *page;
+} DoubleWriteEntry;
+
+/* State of this process's double-write file */
+static File dwfile = -1;
+static int	dwnext = 0;			/* next slot to fill */
+static char *dwslot = NULL;		/* buffer for a slot */
+static FileTag dwtags[DW_SLOTS];	/* data file segments written through */
+static bool dwtagvalid[DW_SLOTS];	/* ... each slot, if still unsynced */
+static bool dwpending[DW_SLOTS];	/* not yet written in place */
+
+/* The batch being collected, see DoubleWriteBatchAdd */
+static char *dwbatch = NULL;	/* DOUBLE_WRITE_BATCH_SIZE slots */
+static int	dwnbatch = 0;		/* slots used in dwbatch */
+static XLogRecPtr dwbatchlsn = InvalidXLogRecPtr;	/* max. LSN of the pages */
+
+static void DoubleWriteSlots(char *slots, int nslots, bool pending);
+static void DoubleWriteOpen(void);
+static void DoubleWriteRemember(int slotno, RelFileNode rnode,
+								ForkNumber forknum, BlockNumber blocknum);
+static void DoubleWriteSyncSlots(void);
+static pg_crc32c DoubleWriteChecksum(DoubleWriteSlotHeader *hdr, char *page);
+static void DoubleWriteReadFile(const char *path, XLogRecPtr redo,
+								DoubleWriteEntry **entries, int *nentries,
+								int *maxentries);
+static int	DoubleWriteEntryCmp(const void *a, const void *b);
+
+/*
+ * DoubleWritePage -- write a page to this process's double-write file, and
+ *		make sure it's on disk.
+ *
+ * The caller is about to write the page to the given block in place.  It
+ * should write the returned copy of the page, which is what we saved, in
+ * case the caller's page is being hinted concurrently.  The copy stays valid
+ * until the next call.
+ */
+char *
+DoubleWritePage(RelFileNode rnode, ForkNumber forknum, BlockNumber blocknum,
+				char *page)
+{
+	DoubleWriteSlotHeader *hdr;
+	char	   *copy;
+
+	/* there's no double-write file for processes without a PGPROC */
+	if (MyProc == NULL)
+		return page;
+
+	if (dwslot == NULL)
+		dwslot = MemoryContextAlloc(TopMemoryContext, DW_SLOT_SIZE);
+
+	hdr = (DoubleWriteSlotHeader *) dwslot;
+	copy = dwslot + DW_HEADER_SIZE;
+
+	memset(dwslot, 0, DW_HEADER_SIZE);
+	memcpy(copy, page, BLCKSZ);
+	hdr->magic = DW_MAGIC;
+	hdr->rnode = rnode;
+	hdr->forknum = forknum;
+	hdr->blocknum = blocknum;
+
+	DoubleWriteSlots(dwslot, 1, false);
+
+	return copy;
+}
+
+/*
+ * DoubleWriteBatchAdd -- add a page to the batch being collected.
+ *
+ * The caller must have flushed WAL up to the page's LSN, or leave that to
+ * DoubleWriteBatchFlush, and must flush the batch before it holds more than
+ * DOUBLE_WRITE_BATCH_SIZE pages.  Like DoubleWritePage, we return the copy
+ * of the page that we saved, which is what the caller should write in place.
+ * It stays valid until DoubleWriteBatchDone.
+ */
+char *
+DoubleWriteBatchAdd(RelFileNode rnode, ForkNumber forknum,
+					BlockNumber blocknum, char *page)
+{
+	DoubleWriteSlotHeader *hdr;
+	char	   *copy;
+
+	Assert(dwnbatch < DOUBLE_WRITE_BATCH_SIZE);
+
+	if (dwbatch == NULL)
+		dwbatch = MemoryContextAlloc(TopMemoryContext,
+									 DOUBLE_WRITE_BATCH_SIZE * DW_SLOT_SIZE);
+
+	hdr = (DoubleWriteSlotHeader *) (dwbatch + dwnbatch * DW_SLOT_SIZE);
+	copy = (char *) hdr + DW_HEADER_SIZE;
+
+	memset(hdr, 0, DW_HEADER_SIZE);
+	memcpy(copy, page, BLCKSZ);
+	hdr->magic = DW_MAGIC;
+	hdr->rnode = rnode;
+	hdr->forknum = forknum;
+	hdr->blocknum = blocknum;
+
+	if (PageGetLSN(copy) > dwbatchlsn)
+		dwbatchlsn = PageGetLSN(copy);
+	dwnbatch++;
+
+	return copy;
+}
+
+/*
+ * DoubleWriteBatchFlush -- write the batch to this process's double-write
+ *		file, and make sure it's on disk.
+ *
+ * After this, the caller writes the pages in place and calls
+ * DoubleWriteBatchDone.  Until then, the slots holding the batch won't be
+ * reused.
+ */
+void
+DoubleWriteBatchFlush(void)
+{
+	if (dwnbatch == 0)
+		return;
+
+	/* The copies mustn't reach disk before the WAL describing them */
+	XLogFlush(dwbatchlsn);
+
+	/* there's no double-write file for processes without a PGPROC */
+	if (MyProc != NULL)
+		DoubleWriteSlots(dwbatch, dwnbatch, true);
+
+	dwnbatch = 0;
+	dwbatchlsn = InvalidXLogRecPtr;
+}
+
+/*
+ * DoubleWriteBatchDone -- the pages of the last batch have been written in
+ *		place, or given up on.
+ *
+ * Also called during error recovery, to throw away a batch that was being
+ * collected.
+ */
+void
+DoubleWriteBatchDone(void)
+{
+	dwnbatch = 0;
+	dwbatchlsn = InvalidXLogRecPtr;
+	memset(dwpending, 0, sizeof(dwpending));
+}
+
+/*
+ * Write consecutive slots, whose headers are filled in up to written_at, to
+ * the double-write file, and fsync it.  If "pending" is true, the pages
+ * haven't been written in place when we return, so their slots mustn't be
+ * considered synced until DoubleWriteBatchDone.
+ */
+static void
+DoubleWriteSlots(char *slots, int nslots, bool pending)
+{
+	XLogRecPtr	written_at;
+	int			nbytes;
+	int			size = nslots * DW_SLOT_SIZE;
+
+	Assert(nslots > 0 && nslots <= DOUBLE_WRITE_BATCH_SIZE);
+
+	if (dwfile < 0)
+		DoubleWriteOpen();
+
+	/* a batch is never split across the end of the file */
+	if (dwnext + nslots > DW_SLOTS)
+		dwnext = 0;
+
+	/* Before reusing the slots, make sure their pages are on disk in place */
+	if (dwnext == 0)
+		DoubleWriteSyncSlots();
+
+	written_at = RecoveryInProgress() ?
+		GetXLogReplayRecPtr(NULL) : GetXLogInsertRecPtr();
+
+	for (int i = 0; i < nslots; i++)
+	{
+		DoubleWriteSlotHeader *hdr;
+
+		hdr = (DoubleWriteSlotHeader *) (slots + i * DW_SLOT_SIZE);
+		hdr->written_at = written_at;
+		hdr->crc = DoubleWriteChecksum(hdr, (char *) hdr + DW_HEADER_SIZE);
+	}
+
+	nbytes = FileWrite(dwfile, slots, size, (off_t) dwnext * DW_SLOT_SIZE,
+					   WAIT_EVENT_DOUBLE_WRITE_WRITE);
+	if (nbytes != size)
+	{
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not write to file \"%s\": %m",
+							FilePathName(dwfile))));
+		ereport(ERROR,
+				(errcode(ERRCODE_DISK_FULL),
+				 errmsg("could not write to file \"%s\": wrote only %d of %d bytes",
+						FilePathName(dwfile), nbytes, size),
+				 errhint("Check free disk space.")));
+	}
+
+	if (FileSync(dwfile, WAIT_EVENT_DOUBLE_WRITE_SYNC) < 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m",
+						FilePathName(dwfile))));
+
+	for (int i = 0; i < nslots; i++)
+	{
+		DoubleWriteSlotHeader *hdr;
+
+		hdr = (DoubleWriteSlotHeader *) (slots + i * DW_SLOT_SIZE);
+		DoubleWriteRemember(dwnext, hdr->rnode, hdr->forknum, hdr->blocknum);
+		dwpending[dwnext] = pending;
+		dwnext = (dwnext + 1) % DW_SLOTS;
+	}
+}
+
+/*
+ * DoubleWriteHandOff -- ask the background writer to write out a buffer.
+ *
+ * Returns false if the queue is full, in which case the caller has to write
+ * the buffer itself.
+ */
+bool
+DoubleWriteHandOff(int buf_id)
+{
+	bool		queued = false;
+
+	SpinLockAcquire(&DWQueue->mutex);
+	if (DWQueue->nbufs < DOUBLE_WRITE_QUEUE_SIZE)
+	{
+		DWQueue->buf_ids[DWQueue->nbufs++] = buf_id;
+		queued = true;
+	}
+	SpinLockRelease(&DWQueue->mutex);
+
+	return queued;
+}
+
+/*
+ * DoubleWriteTakeHandedOff -- empty the queue of handed-off buffers.
+ *
+ * Copies the queued buffer IDs to buf_ids, which must have room for
+ * DOUBLE_WRITE_QUEUE_SIZE entries, and returns their number.  The same
+ * buffer may be listed more than once.
+ */
+int
+DoubleWriteTakeHandedOff(int *buf_ids)
+{
+	int			nbufs;
+
+	SpinLockAcquire(&DWQueue->mutex);
+	nbufs = DWQueue->nbufs;
+	memcpy(buf_ids, DWQueue->buf_ids, nbufs * sizeof(int));
+	DWQueue->nbufs = 0;
+	SpinLockRelease(&DWQueue->mutex);
+
+	return nbufs;
+}
+
+/*
+ * Shared memory size for the hand-off queue.
+ */
+Size
+DoubleWriteShmemSize(void)
+{
+	return sizeof(DoubleWriteQueue);
+}
+
+/*
+ * Allocate and initialize the hand-off queue in shared memory.
+ */
+void
+DoubleWriteShmemInit(void)
+{
+	bool		found;
+
+	DWQueue = (DoubleWriteQueue *)
+		ShmemInitStruct("Double-Write Queue", DoubleWriteShmemSize(), &found);
+
+	if (!found)
+	{
+		SpinLockInit(&DWQueue->mutex);
+		DWQueue->nbufs = 0;
+	}
+}
+
+/*
+ * Open this process's double-write file, creating it if needed.
+ */
+static void
+DoubleWriteOpen(void)
+{
+	char		path[MAXPGPATH];
+
+	snprintf(path, sizeof(path), "%s/%d", DOUBLE_WRITE_DIR, MyProc->pgprocno);
+
+	dwfile = PathNameOpenFile(path, O_RDWR | O_CREAT | PG_BINARY);
+	if (dwfile < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	/* the file is no use if it's gone after a crash */
+	fsync_fname(DOUBLE_WRITE_DIR, true);
+
+	/*
+	 * A process that used the same file before us may have exited before the
+	 * pages it wrote in place reached disk.  Remember them, so that they get
+	 * synced before we overwrite their slots.
+	 */
+	for (int i = 0; i < DW_SLOTS; i++)
+	{
+		DoubleWriteSlotHeader hdr;
+
+		if (FileRead(dwfile, (char *) &hdr, sizeof(hdr),
+					 (off_t) i * DW_SLOT_SIZE,
+					 WAIT_EVENT_DOUBLE_WRITE_READ) != sizeof(hdr))
+			break;
+		if (hdr.magic == DW_MAGIC)
+			DoubleWriteRemember(i, hdr.rnode, hdr.forknum, hdr.blocknum);
+	}
+	dwnext = 0;
+}
+
+/*
+ * Remember which data file segment the page in a slot was written to.
+ */
+static void
+DoubleWriteRemember(int slotno, RelFileNode rnode, ForkNumber forknum,
+					BlockNumber blocknum)
+{
+	FileTag    *tag = &dwtags[slotno];
+
+	/* zero padding bytes, so that tags can be compared with memcmp() */
+	memset(tag, 0, sizeof(FileTag));
+	tag->handler = SYNC_HANDLER_MD;
+	tag->forknum = forknum;
+	tag->rnode = rnode;
+	tag->segno = blocknum / ((BlockNumber) RELSEG_SIZE);
+	dwtagvalid[slotno] = true;
+}
+
+/*
+ * Fsync all the data file segments written through our slots, except those
+ * of a batch whose pages haven't been written in place yet.
+ */
+static void
+DoubleWriteSyncSlots(void)
+{
+	for (int i = 0; i < DW_SLOTS; i++)
+	{
+		char		path[MAXPGPATH];
+		bool		done = false;
+
+		if (!dwtagvalid[i] || dwpending[i])
+			continue;
+
+		/* each segment only once */
+		for (int j = 0; j < i && !done; j++)
+			done = dwtagvalid[j] && !dwpending[j] &&
+				memcmp(&dwtags[i], &dwtags[j], sizeof(FileTag)) == 0;
+		if (done)
+			continue;
+
+		/* a file that's gone has no pages to protect */
+		if (mdsyncfiletag(&dwtags[i], path) < 0 && errno != ENOENT)
+			ereport(data_sync_elevel(ERROR),
+					(errcode_for_file_access(),
+					 errmsg("could not fsync file \"%s\": %m", path)));
+	}
+
+	for (int i = 0; i < DW_SLOTS; i++)
+	{
+		if (!dwpending[i])
+			dwtagvalid[i] = false;
+	}
+}
+
+static pg_crc32c
+DoubleWriteChecksum(DoubleWriteSlotHeader *hdr, char *page)
+{
+	pg_crc32c	crc;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, hdr, offsetof(DoubleWriteSlotHeader, crc));
+	COMP_CRC32C(crc, page, BLCKSZ);
+	FIN_CRC32C(crc);
+
+	return crc;
+}
+
+/*
+ * StartupDoubleWrite -- repair torn pages, and remove the double-write files.
+ *
+ * Called by the startup process before WAL replay begins.  In crash
+ * recovery, every page written after the redo point may have been torn, so
+ * we put the latest intact copy of each of them from the double-write files
+ * back in place, unless the page on disk is newer or the same.  Copies whose
+ * own write was torn fail their CRC check and are ignored; their in-place
+ * write never started.  Pages of relations that were dropped or truncated
+ * since are skipped, WAL replay will do that again.
+ */
+void
+StartupDoubleWrite(XLogRecPtr redo)
+{
+	DIR		   *dir;
+	struct dirent *de;
+	DoubleWriteEntry *entries = NULL;
+	int			nentries = 0;
+	int			maxentries = 0;
+	int			nrestored = 0;
+
+	dir = AllocateDir(DOUBLE_WRITE_DIR);
+	if (dir == NULL && errno == ENOENT)
+	{
+		/* a data directory from before double-write files existed */
+		if (MakePGDirectory(DOUBLE_WRITE_DIR) < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not create directory \"%s\": %m",
+							DOUBLE_WRITE_DIR)));
+		return;
+	}
+
+	if (InRecovery)
+	{
+		while ((de = ReadDir(dir, DOUBLE_WRITE_DIR)) != NULL)
+		{
+			char		path[MAXPGPATH];
+
+			if (strspn(de->d_name, "0123456789") != strlen(de->d_name))
+				continue;
+
+			snprintf(path, sizeof(path), "%s/%s", DOUBLE_WRITE_DIR, de->d_name);
+			DoubleWriteReadFile(path, redo, &entries, &nentries, &maxentries);
+		}
+		rewinddir(dir);
+	}
+
+	if (nentries > 0)
+	{
+		PGAlignedBlock diskpage;
+
+		/* newest copy of each block first */
+		qsort(entries, nentries, sizeof(DoubleWriteEntry), DoubleWriteEntryCmp);
+
+		for (int i = 0; i < nentries; i++)
+		{
+			DoubleWriteSlotHeader *hdr = &entries[i].hdr;
+			char	   *page = entries[i].page;
+			SMgrRelation reln;
+
+			if (i > 0 &&
+				RelFileNodeEquals(hdr->rnode, entries[i - 1].hdr.rnode) &&
+				hdr->forknum == entries[i - 1].hdr.forknum &&
+				hdr->blocknum == entries[i - 1].hdr.blocknum)
+				continue;
+
+			reln = smgropen(hdr->rnode, InvalidBackendId);
+			if (!smgrexists(reln, hdr->forknum) ||
+				hdr->blocknum >= smgrnblocks(reln, hdr->forknum))
+				continue;
+
+			/*
+			 * A compressed block that can't be decompressed was torn, and
+			 * has no LSN to compare.
+			 */
+			if (smgrtryread(reln, hdr->forknum, hdr->blocknum, diskpage.data) &&
+				(PageGetLSN(diskpage.data) > PageGetLSN(page) ||
+				 memcmp(diskpage.data, page, BLCKSZ) == 0))
+				continue;
+
+			smgrwrite(reln, hdr->forknum, hdr->blocknum, page, true);
+			smgrimmedsync(reln, hdr->forknum);
+			nrestored++;
+
+			ereport(DEBUG1,
+					(errmsg_internal("restored block %u of %s from the double-write buffer",
+									 hdr->blocknum,
+									 relpathperm(hdr->rnode, hdr->forknum))));
+		}
+
+		if (nrestored > 0)
+			ereport(LOG,
+					(errmsg("restored %d torn pages from the double-write buffer",
+							nrestored)));
+
+		for (int i = 0; i < nentries; i++)
+			pfree(entries[i].page);
+		pfree(entries);
+	}
+
+	/* The pages are all good now, so the copies aren't needed anymore */
+	while ((de = ReadDir(dir, DOUBLE_WRITE_DIR)) != NULL)
+	{
+		char		path[MAXPGPATH];
+
+		if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%s", DOUBLE_WRITE_DIR, de->d_name);
+		if (unlink(path) < 0)
+			ereport(LOG,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", path)));
+	}
+	FreeDir(dir);
+}
+
+/*
+ * Collect the intact pages of one double-write file that were written after
+ * the redo point.
+ */
+static void
+DoubleWriteReadFile(const char *path, XLogRecPtr redo,
+					DoubleWriteEntry **entries, int *nentries, int *maxentries)
+{
+	char	   *slot = palloc(DW_SLOT_SIZE);
+	int			fd;
+
+	fd = OpenTransientFile(path, O_RDONLY | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not open file \"%s\": %m", path)));
+
+	for (int i = 0; i < DW_SLOTS; i++)
+	{
+		DoubleWriteSlotHeader *hdr = (DoubleWriteSlotHeader *) slot;
+		char	   *page = slot + DW_HEADER_SIZE;
+		int			nbytes;
+
+		pgstat_report_wait_start(WAIT_EVENT_DOUBLE_WRITE_READ);
+		nbytes = pg_pread(fd, slot, DW_SLOT_SIZE, (off_t) i * DW_SLOT_SIZE);
+		pgstat_report_wait_end();
+
+		if (nbytes < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read file \"%s\": %m", path)));
+		if (nbytes != DW_SLOT_SIZE)
+			break;
+
+		if (hdr->magic != DW_MAGIC ||
+			hdr->crc != DoubleWriteChecksum(hdr, page) ||
+			hdr->written_at < redo)
+			continue;
+
+		if (*nentries >= *maxentries)
+		{
+			*maxentries = Max(*maxentries * 2, DW_SLOTS);
+			if (*entries == NULL)
+				*entries = palloc(*maxentries * sizeof(DoubleWriteEntry));
+			else
+				*entries = repalloc(*entries,
+									*maxentries * sizeof(DoubleWriteEntry));
+		}
+
+		(*entries)[*nentries].hdr = *hdr;
+		(*entries)[*nentries].page = palloc(BLCKSZ);
+		memcpy((*entries)[*nentries].page, page, BLCKSZ);
+		(*nentries)++;
+	}
+
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", path)));
+	pfree(slot);
+}
+
+/*
+ * qsort comparator: by block, and newest page first for the same block.
+ */
+static int
+DoubleWriteEntryCmp(const void *a, const void *b)
+{
+	const DoubleWriteEntry *ea = (const DoubleWriteEntry *) a;
+	const DoubleWriteEntry *eb = (const DoubleWriteEntry *) b;
+	XLogRecPtr	lsna,
+				lsnb;
+
+	if (ea->hdr.rnode.spcNode != eb->hdr.rnode.spcNode)
+		return ea->hdr.rnode.spcNode < eb->hdr.rnode.spcNode ? -1 : 1;
+	if (ea->hdr.rnode.dbNode != eb->hdr.rnode.dbNode)
+		return ea->hdr.rnode.dbNode < eb->hdr.rnode.dbNode ? -1 : 1;
+	if (ea->hdr.rnode.relNode != eb->hdr.rnode.relNode)
+		return ea->hdr.rnode.relNode < eb->hdr.rnode.relNode ? -1 : 1;
+	if (ea->hdr.forknum != eb->hdr.forknum)
+		return ea->hdr.forknum < eb->hdr.forknum ? -1 : 1;
+	if (ea->hdr.blocknum != eb->hdr.blocknum)
+		return ea->hdr.blocknum < eb->hdr.blocknum ? -1 : 1;
+
+	lsna = PageGetLSN(ea->page);
+	lsnb = PageGetLSN(eb->page);
+	if (lsna != lsnb)
+		return lsna > lsnb ? -1 : 1;
+	return 0;
+}
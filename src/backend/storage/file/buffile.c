@@ -766,6 +766,40 @@ BufFileSeekBlock(BufFile *file, long blknum)
 					   SEEK_SET);
 }
 
+/*
+ * BufFilePrefetchBlock --- initiate asynchronous read of a range of blocks
+ *
+ * Asks the kernel to start reading nblocks BLCKSZ-sized blocks, starting with
+ * the blknum'th block of the file, so that a later BufFileRead of them will
+ * not have to wait for the I/O.  The range may extend past the end of the
+ * file; the part beyond it is ignored.  This is only a hint, so errors are
+ * ignored, too.  The logical position of the file is not moved.
+ */
+void
+BufFilePrefetchBlock(BufFile *file, long blknum, int nblocks)
+{
+#ifdef USE_PREFETCH
+	while (nblocks > 0)
+	{
+		int			fileno = (int) (blknum / BUFFILE_SEG_SIZE);
+		long		segblock = blknum % BUFFILE_SEG_SIZE;
+		int			n;
+
+		if (fileno >= file->numFiles)
+			break;
+
+		/* Don't cross a segment boundary in one request */
+		n = Min(nblocks, BUFFILE_SEG_SIZE - segblock);
+		(void) FilePrefetch(file->files[fileno],
+							(off_t) segblock * BLCKSZ,
+							n * BLCKSZ,
+							WAIT_EVENT_BUFFILE_READ);
+		blknum += n;
+		nblocks -= n;
+	}
+#endif							/* USE_PREFETCH */
+}
+
 #ifdef NOT_USED
 /*
  * BufFileTellBlock --- block-oriented tell
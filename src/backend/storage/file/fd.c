@@ -2190,6 +2190,97 @@ FileTruncate(File file, off_t offset, uint32 wait_event_info)
 	return returnCode;
 }
 
+/*
+ * Allocate disk space for the given range of the file, extending it if
+ * needed.  The new space reads as zeroes.
+ *
+ * Returns 0 on success, or -1 with errno set.  EOPNOTSUPP means that the
+ * platform or file system can't do this, and the caller should write zeroes
+ * instead.
+ */
+int
+FileFallocate(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FileFallocate: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	/* temp files don't come through here, so no temp_file_limit check */
+	Assert(!(VfdCache[file].fdstate & FD_TEMP_FILE_LIMIT));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = posix_fallocate(VfdCache[file].fd, offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	if (returnCode == EINTR)
+		goto retry;
+
+	/* posix_fallocate returns the error instead of setting errno */
+	errno = returnCode;
+	if (returnCode == EINVAL)
+		errno = EOPNOTSUPP;
+	return -1;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
+/*
+ * Deallocate the given range of a file, so that it reads back as zeroes
+ * but takes up no space, without changing the size of the file.
+ *
+ * Returns 0 on success, or -1 with errno set.  errno is EOPNOTSUPP if the
+ * platform or the file system doesn't support this.
+ */
+int
+FilePunchHole(File file, off_t offset, off_t amount, uint32 wait_event_info)
+{
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+	int			returnCode;
+
+	Assert(FileIsValid(file));
+
+	DO_DB(elog(LOG, "FilePunchHole: %d (%s) " INT64_FORMAT " " INT64_FORMAT,
+			   file, VfdCache[file].fileName,
+			   (int64) offset, (int64) amount));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+	returnCode = fallocate(VfdCache[file].fd,
+						   FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+						   offset, amount);
+	pgstat_report_wait_end();
+
+	if (returnCode == 0)
+		return 0;
+	if (errno == EINTR)
+		goto retry;
+	if (errno == ENOSYS)
+		errno = EOPNOTSUPP;
+	return -1;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 /*
  * Return the pathname associated with an open file.
  *
@@ -35,6 +35,7 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
 #include "storage/pg_shmem.h"
@@ -122,6 +123,7 @@ CreateSharedMemoryAndSemaphores(void)
 												 sizeof(ShmemIndexEnt)));
 		size = add_size(size, dsm_estimate_size());
 		size = add_size(size, BufferShmemSize());
+		size = add_size(size, DoubleWriteShmemSize());
 		size = add_size(size, LockShmemSize());
 		size = add_size(size, PredicateLockShmemSize());
 		size = add_size(size, ProcGlobalShmemSize());
@@ -221,6 +223,7 @@ CreateSharedMemoryAndSemaphores(void)
 	SUBTRANSShmemInit();
 	MultiXactShmemInit();
 	InitBufferPool();
+	DoubleWriteShmemInit();
 
 	/*
 	 * Set up lock manager
@@ -24,10 +24,12 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/file.h>
+#include <sys/stat.h>
 
 #include "access/xlog.h"
 #include "access/xlogutils.h"
 #include "commands/tablespace.h"
+#include "common/pagecompress.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
 #include "pgstat.h"
@@ -77,6 +79,17 @@
  *	segment, we assume that any subsequent segments are inactive.
  *
  *	The entire MdfdVec array is palloc'd in the MdCxt memory context.
+ *
+ *	A relation created in a tablespace with the page_compression option set
+ *	is marked by an empty file next to its main fork, whose name ends with
+ *	MD_COMPRESS_MARKER_SUFFIX.  All forks of such a relation compress their
+ *	blocks when writing them, in the format described in
+ *	common/pagecompress.h.  Compressed blocks are recognized by their header
+ *	when they are read, whether or not the marker exists, so the marker only
+ *	decides how blocks are written.  Whether to compress is decided by
+ *	RelationCreateStorage(), which calls mdmarkcompressed(), and recorded in
+ *	the WAL record of the relation's creation, so that WAL replay creates the
+ *	marker too.
  */
 
 typedef struct _MdfdVec
@@ -87,6 +100,12 @@ typedef struct _MdfdVec
 
 static MemoryContext MdCxt;		/* context for all MdfdVec objects */
 
+/* suffix of the file that marks a relation's blocks for compression */
+#define MD_COMPRESS_MARKER_SUFFIX	"_compressed"
+
+/* output buffer for compressing a block */
+static char md_compress_buf[PAGE_COMPRESS_BUFSIZE];
+
 
 /* Populate a file tag describing an md.c segment file. */
 #define INIT_MD_FILETAG(a,xx_rnode,xx_forknum,xx_segno) \
@@ -117,6 +136,13 @@ static MemoryContext MdCxt;		/* context for all MdfdVec objects */
  */
 #define EXTENSION_DONT_CHECK_SIZE	(1 << 4)
 
+/*
+ * mdzeroextend() asks the file system to allocate more than this many blocks
+ * at once, and writes zeroes for fewer, or when the file system can't.  It
+ * also writes at most this many blocks per write() call.
+ */
+#define MD_ZEROEXTEND_WRITE_BLOCKS	8
+
 
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
@@ -139,6 +165,14 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 							 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 							  MdfdVec *seg);
+static bool mdread_internal(SMgrRelation reln, ForkNumber forknum,
+							BlockNumber blocknum, char *buffer,
+							bool undecodable_ok);
+static char *_mdcompress_markerpath(RelFileNodeBackend rnode);
+static bool _mdcompress_enabled(RelFileNodeBackend rnode);
+static int	_mdwrite_compressed(SMgrRelation reln, ForkNumber forknum,
+								MdfdVec *v, char *buffer, off_t seekpos,
+								bool extend, uint32 wait_event_info);
 
 
 /*
@@ -225,6 +259,52 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 	mdfd = &reln->md_seg_fds[forkNum][0];
 	mdfd->mdfd_vfd = fd;
 	mdfd->mdfd_segno = 0;
+
+	reln->md_compress[forkNum] = _mdcompress_enabled(reln->smgr_rnode);
+}
+
+/*
+ *	mdmarkcompressed() -- Mark a relation's blocks to be written compressed.
+ *
+ * The caller, RelationCreateStorage() or WAL replay of the relation's
+ * creation, has just created the main fork.  The marker is fsynced along
+ * with its directory right away: the checkpointer only syncs segments, and
+ * a marker lost in a crash would silently turn compression off.  During
+ * replay, the marker may exist already.
+ */
+void
+mdmarkcompressed(SMgrRelation reln)
+{
+	char	   *markerpath;
+	char		dirpath[MAXPGPATH];
+	int			fd;
+
+	Assert(!RelFileNodeBackendIsTemp(reln->smgr_rnode));
+
+	markerpath = _mdcompress_markerpath(reln->smgr_rnode);
+
+	fd = OpenTransientFile(markerpath, O_RDWR | O_CREAT | PG_BINARY);
+	if (fd < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not create file \"%s\": %m", markerpath)));
+	if (pg_fsync(fd) != 0)
+		ereport(data_sync_elevel(ERROR),
+				(errcode_for_file_access(),
+				 errmsg("could not fsync file \"%s\": %m", markerpath)));
+	if (CloseTransientFile(fd) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not close file \"%s\": %m", markerpath)));
+
+	strlcpy(dirpath, markerpath, MAXPGPATH);
+	get_parent_directory(dirpath);
+	fsync_fname(dirpath, true);
+
+	pfree(markerpath);
+
+	for (int forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		reln->md_compress[forknum] = true;
 }
 
 /*
@@ -371,6 +451,22 @@ mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum, bool isRedo)
 		pfree(segpath);
 	}
 
+	/*
+	 * Remove the compression marker with the main fork.  Unlike the first
+	 * segment, it needn't stay until the next checkpoint, since it doesn't
+	 * keep the relfilenode from being reused.
+	 */
+	if (forkNum == MAIN_FORKNUM && !RelFileNodeBackendIsTemp(rnode))
+	{
+		char	   *markerpath = _mdcompress_markerpath(rnode);
+
+		if (unlink(markerpath) < 0 && errno != ENOENT)
+			ereport(WARNING,
+					(errcode_for_file_access(),
+					 errmsg("could not remove file \"%s\": %m", markerpath)));
+		pfree(markerpath);
+	}
+
 	pfree(path);
 }
 
@@ -414,7 +510,14 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
+	if (reln->md_compress[forknum])
+		nbytes = _mdwrite_compressed(reln, forknum, v, buffer, seekpos, true,
+									 WAIT_EVENT_DATA_FILE_EXTEND);
+	else
+		nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos,
+						   WAIT_EVENT_DATA_FILE_EXTEND);
+
+	if (nbytes != BLCKSZ)
 	{
 		if (nbytes < 0)
 			ereport(ERROR,
@@ -437,6 +540,127 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add new zeroed-out blocks to the specified relation.
+ *
+ *		Like mdextend(), but adds nblocks blocks starting at blocknum at
+ *		once, with a single posix_fallocate() call per segment where
+ *		possible, instead of writing every block separately.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum,
+			 BlockNumber blocknum, int nblocks, bool skipFsync)
+{
+	BlockNumber curblocknum = blocknum;
+	int			remblocks = nblocks;
+	char	   *zerobuf = NULL;
+
+	Assert(nblocks > 0);
+
+	/* This assert is too expensive to have on normally ... */
+#ifdef CHECK_WRITE_VS_EXTEND
+	Assert(blocknum >= mdnblocks(reln, forknum));
+#endif
+
+	/* see mdextend() */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	while (remblocks > 0)
+	{
+		BlockNumber segstartblock = curblocknum % ((BlockNumber) RELSEG_SIZE);
+		off_t		seekpos = (off_t) BLCKSZ * segstartblock;
+		int			numblocks;
+		bool		allocated;
+		MdfdVec    *v;
+
+		/* don't cross a segment boundary */
+		if (segstartblock + remblocks > RELSEG_SIZE)
+			numblocks = RELSEG_SIZE - segstartblock;
+		else
+			numblocks = remblocks;
+
+		v = _mdfd_getseg(reln, forknum, curblocknum, skipFsync, EXTENSION_CREATE);
+
+		Assert(segstartblock < RELSEG_SIZE);
+		Assert(segstartblock + numblocks <= RELSEG_SIZE);
+
+		/*
+		 * For more than a few blocks, letting the file system allocate the
+		 * space is much cheaper than writing zeroes through the kernel's page
+		 * cache.  For just a few, writing is as cheap, and doesn't risk
+		 * fragmenting the file on file systems where posix_fallocate()
+		 * doesn't extend the file contiguously.
+		 */
+		allocated = false;
+		if (numblocks > MD_ZEROEXTEND_WRITE_BLOCKS)
+		{
+			if (FileFallocate(v->mdfd_vfd, seekpos, (off_t) BLCKSZ * numblocks,
+							  WAIT_EVENT_DATA_FILE_EXTEND) == 0)
+				allocated = true;
+			else if (errno != EOPNOTSUPP)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\": %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+		}
+
+		if (!allocated)
+		{
+			int			doneblocks = 0;
+
+			if (zerobuf == NULL)
+				zerobuf = palloc0(BLCKSZ * MD_ZEROEXTEND_WRITE_BLOCKS);
+
+			while (doneblocks < numblocks)
+			{
+				int			nbytes;
+				int			amount;
+
+				amount = BLCKSZ * Min(numblocks - doneblocks,
+									  MD_ZEROEXTEND_WRITE_BLOCKS);
+				nbytes = FileWrite(v->mdfd_vfd, zerobuf, amount,
+								   seekpos + (off_t) BLCKSZ * doneblocks,
+								   WAIT_EVENT_DATA_FILE_EXTEND);
+				if (nbytes != amount)
+				{
+					if (nbytes < 0)
+						ereport(ERROR,
+								(errcode_for_file_access(),
+								 errmsg("could not extend file \"%s\": %m",
+										FilePathName(v->mdfd_vfd)),
+								 errhint("Check free disk space.")));
+					/* short write: complain appropriately */
+					ereport(ERROR,
+							(errcode(ERRCODE_DISK_FULL),
+							 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+									FilePathName(v->mdfd_vfd),
+									nbytes, amount,
+									curblocknum + doneblocks),
+							 errhint("Check free disk space.")));
+				}
+				doneblocks += amount / BLCKSZ;
+			}
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		remblocks -= numblocks;
+		curblocknum += numblocks;
+	}
+
+	if (zerobuf)
+		pfree(zerobuf);
+}
+
 /*
  *	mdopenfork() -- Open one fork of the specified relation.
  *
@@ -482,6 +706,8 @@ mdopenfork(SMgrRelation reln, ForkNumber forknum, int behavior)
 	mdfd->mdfd_vfd = fd;
 	mdfd->mdfd_segno = 0;
 
+	reln->md_compress[forknum] = _mdcompress_enabled(reln->smgr_rnode);
+
 	Assert(_mdnblocks(reln, forknum, mdfd) <= ((BlockNumber) RELSEG_SIZE));
 
 	return mdfd;
@@ -495,7 +721,10 @@ mdopen(SMgrRelation reln)
 {
 	/* mark it not open */
 	for (int forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+	{
 		reln->md_num_open_segs[forknum] = 0;
+		reln->md_compress[forknum] = false;
+	}
 }
 
 /*
@@ -604,6 +833,29 @@ mdwriteback(SMgrRelation reln, ForkNumber forknum,
 void
 mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	   char *buffer)
+{
+	(void) mdread_internal(reln, forknum, blocknum, buffer, false);
+}
+
+/*
+ *	mdtryread() -- Read the specified block from a relation, returning false
+ *		if it's a compressed block that can't be decompressed.
+ */
+bool
+mdtryread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char *buffer)
+{
+	return mdread_internal(reln, forknum, blocknum, buffer, true);
+}
+
+/*
+ * Guts of mdread() and mdtryread().  If undecodable_ok is true, a compressed
+ * block that fails to decompress is left in the buffer as is, and we return
+ * false, instead of raising an error.
+ */
+static bool
+mdread_internal(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+				char *buffer, bool undecodable_ok)
 {
 	off_t		seekpos;
 	int			nbytes;
@@ -657,6 +909,30 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 							blocknum, FilePathName(v->mdfd_vfd),
 							nbytes, BLCKSZ)));
 	}
+	else if (page_is_compressed(buffer))
+	{
+		PGAlignedBlock page;
+
+		if (page_decompress(buffer, page.data))
+			memcpy(buffer, page.data, BLCKSZ);
+		else if (undecodable_ok)
+			return false;
+		else if (zero_damaged_pages)
+		{
+			ereport(WARNING,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid compressed block %u in file \"%s\"; zeroing out page",
+							blocknum, FilePathName(v->mdfd_vfd))));
+			MemSet(buffer, 0, BLCKSZ);
+		}
+		else
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_CORRUPTED),
+					 errmsg("invalid compressed block %u in file \"%s\"",
+							blocknum, FilePathName(v->mdfd_vfd))));
+	}
+
+	return true;
 }
 
 /*
@@ -692,7 +968,12 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 
 	Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
 
-	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, WAIT_EVENT_DATA_FILE_WRITE);
+	if (reln->md_compress[forknum])
+		nbytes = _mdwrite_compressed(reln, forknum, v, buffer, seekpos, false,
+									 WAIT_EVENT_DATA_FILE_WRITE);
+	else
+		nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos,
+						   WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
 										reln->smgr_rnode.node.spcNode,
@@ -1296,6 +1577,90 @@ _mdnblocks(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 	return (BlockNumber) (len / BLCKSZ);
 }
 
+/*
+ * Get the path of the file that marks a relation for compression.  The
+ * result is palloc'd.
+ */
+static char *
+_mdcompress_markerpath(RelFileNodeBackend rnode)
+{
+	char	   *path;
+	char	   *markerpath;
+
+	path = relpath(rnode, MAIN_FORKNUM);
+	markerpath = psprintf("%s%s", path, MD_COMPRESS_MARKER_SUFFIX);
+	pfree(path);
+
+	return markerpath;
+}
+
+/*
+ * Should blocks of the relation be compressed when they are written?
+ */
+static bool
+_mdcompress_enabled(RelFileNodeBackend rnode)
+{
+	char	   *markerpath;
+	struct stat st;
+	bool		result;
+
+	/* temp relations are never marked */
+	if (RelFileNodeBackendIsTemp(rnode))
+		return false;
+
+	markerpath = _mdcompress_markerpath(rnode);
+	result = (stat(markerpath, &st) == 0);
+	pfree(markerpath);
+
+	return result;
+}
+
+/*
+ * Write a block of a fork whose blocks are compressed.
+ *
+ * If the block compresses well enough, the compressed image is written at
+ * the start of the block's slot and the rest of the slot is turned into a
+ * hole.  When extending, the whole slot is written first, so that the file
+ * grows to cover it.  Blocks that don't compress well enough are written as
+ * is.  If the file system can't make holes, we stop compressing blocks of
+ * this fork, since that would save nothing.
+ *
+ * Returns the number of bytes written like FileWrite(), except that BLCKSZ
+ * is returned on success even if less was written.
+ */
+static int
+_mdwrite_compressed(SMgrRelation reln, ForkNumber forknum, MdfdVec *v,
+					char *buffer, off_t seekpos, bool extend,
+					uint32 wait_event_info)
+{
+	int			len;
+	int			amount;
+	int			nbytes;
+
+	len = page_compress(buffer, md_compress_buf);
+	if (len < 0)
+		return FileWrite(v->mdfd_vfd, buffer, BLCKSZ, seekpos, wait_event_info);
+
+	amount = extend ? BLCKSZ : len;
+	nbytes = FileWrite(v->mdfd_vfd, md_compress_buf, amount, seekpos,
+					   wait_event_info);
+	if (nbytes != amount)
+		return (nbytes < 0) ? nbytes : Min(nbytes, len);
+
+	if (FilePunchHole(v->mdfd_vfd, seekpos + len, BLCKSZ - len,
+					  wait_event_info) < 0)
+	{
+		if (errno != EOPNOTSUPP)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not deallocate space in file \"%s\": %m",
+							FilePathName(v->mdfd_vfd))));
+		reln->md_compress[forknum] = false;
+	}
+
+	return BLCKSZ;
+}
+
 /*
  * Sync a file to disk, given a file tag.  Write the path into an output
  * buffer so the caller can use it in error messages.
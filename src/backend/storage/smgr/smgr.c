@@ -50,10 +50,16 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	bool		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
+	bool		(*smgr_tryread) (SMgrRelation reln, ForkNumber forknum,
+								 BlockNumber blocknum, char *buffer);
+	void		(*smgr_markcompressed) (SMgrRelation reln);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
@@ -75,8 +81,11 @@ static const f_smgr smgrsw[] = {
 		.smgr_exists = mdexists,
 		.smgr_unlink = mdunlink,
 		.smgr_extend = mdextend,
+		.smgr_zeroextend = mdzeroextend,
 		.smgr_prefetch = mdprefetch,
 		.smgr_read = mdread,
+		.smgr_tryread = mdtryread,
+		.smgr_markcompressed = mdmarkcompressed,
 		.smgr_write = mdwrite,
 		.smgr_writeback = mdwriteback,
 		.smgr_nblocks = mdnblocks,
@@ -336,6 +345,18 @@ smgrcreate(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	smgrsw[reln->smgr_which].smgr_create(reln, forknum, isRedo);
 }
 
+/*
+ *	smgrmarkcompressed() -- Store a new relation's blocks compressed.
+ *
+ *		Called right after creating the relation's main fork.  The decision
+ *		is kept with the relation's storage, and applies to all its forks.
+ */
+void
+smgrmarkcompressed(SMgrRelation reln)
+{
+	smgrsw[reln->smgr_which].smgr_markcompressed(reln);
+}
+
 /*
  *	smgrdosyncall() -- Immediately sync all forks of all given relations
  *
@@ -477,6 +498,28 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 }
 
+/*
+ *	smgrzeroextend() -- Add new zeroed-out blocks to a file.
+ *
+ *		Like smgrextend(), but adds nblocks blocks starting at blocknum
+ *		without writing them through the buffer manager, which lets the
+ *		storage manager do it with far fewer system calls.  The new blocks
+ *		read back as all-zero pages.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	smgrsw[reln->smgr_which].smgr_zeroextend(reln, forknum, blocknum,
+											 nblocks, skipFsync);
+
+	/* as in smgrextend() */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+}
+
 /*
  *	smgrprefetch() -- Initiate asynchronous read of the specified block of a relation.
  *
@@ -505,6 +548,24 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	smgrsw[reln->smgr_which].smgr_read(reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrtryread() -- like smgrread(), but don't complain about a block that
+ *					 can't be decoded.
+ *
+ *		Returns false if the block is stored in a form that the storage
+ *		manager can't turn back into a page, for example a compressed block
+ *		whose write was torn.  The buffer then holds the raw block.  Other
+ *		failures are reported as in smgrread().  Crash recovery uses this to
+ *		tell whether a page needs to be restored from the double-write files.
+ */
+bool
+smgrtryread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			char *buffer)
+{
+	return smgrsw[reln->smgr_which].smgr_tryread(reln, forknum, blocknum,
+												 buffer);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -21,6 +21,7 @@
 #include "funcapi.h"
 #include "libpq/pqformat.h"
 #include "nodes/nodeFuncs.h"
+#include "nodes/parsenodes.h"
 #include "nodes/supportnodes.h"
 #include "optimizer/optimizer.h"
 #include "utils/builtins.h"
@@ -898,6 +899,59 @@ int8inc_float8_float8(PG_FUNCTION_ARGS)
 	return int8inc(fcinfo);
 }
 
+/*
+ * int8inc_support
+ *		prosupport function for the count() aggregates
+ *
+ * When count() is used as a window aggregate, its value within a partition
+ * can only grow as the frame end advances, and only shrink as the frame
+ * start advances.
+ */
+Datum
+int8inc_support(PG_FUNCTION_ARGS)
+{
+	Node	   *rawreq = (Node *) PG_GETARG_POINTER(0);
+
+	if (IsA(rawreq, SupportRequestWFuncMonotonic))
+	{
+		SupportRequestWFuncMonotonic *req = (SupportRequestWFuncMonotonic *) rawreq;
+		MonotonicFunction monotonic = MONOTONICFUNC_NONE;
+		int			frameOptions = req->window_clause->frameOptions;
+
+		/* No ORDER BY clause means all rows are peers, so the value is fixed */
+		if (req->window_clause->orderClause == NIL)
+			monotonic = MONOTONICFUNC_BOTH;
+		else
+		{
+			/*
+			 * If the frame always starts at the partition start, rows can
+			 * only be added to it as we go, so count() can't go down.
+			 */
+			if (frameOptions & FRAMEOPTION_START_UNBOUNDED_PRECEDING)
+				monotonic |= MONOTONICFUNC_INCREASING;
+
+			/*
+			 * Likewise, if the frame always ends at the partition end, rows
+			 * can only be removed from it, so count() can't go up.
+			 */
+			if (frameOptions & FRAMEOPTION_END_UNBOUNDED_FOLLOWING)
+				monotonic |= MONOTONICFUNC_DECREASING;
+		}
+
+		/*
+		 * Frame exclusion can remove the current row or its peers from the
+		 * frame, which breaks the above reasoning.
+		 */
+		if (frameOptions & FRAMEOPTION_EXCLUSION)
+			monotonic = MONOTONICFUNC_NONE;
+
+		req->monotonic = monotonic;
+		PG_RETURN_POINTER(req);
+	}
+
+	PG_RETURN_POINTER(NULL);
+}
+
 Datum
 int8dec_any(PG_FUNCTION_ARGS)
 {
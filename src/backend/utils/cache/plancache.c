@@ -58,6 +58,7 @@
 
 #include "access/transam.h"
 #include "catalog/namespace.h"
+#include "executor/execPartition.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
@@ -99,14 +100,17 @@ static dlist_head cached_expression_list = DLIST_STATIC_INIT(cached_expression_l
 static void ReleaseGenericPlan(CachedPlanSource *plansource);
 static List *RevalidateCachedQuery(CachedPlanSource *plansource,
 								   QueryEnvironment *queryEnv);
-static bool CheckCachedPlan(CachedPlanSource *plansource);
+static bool CheckCachedPlan(CachedPlanSource *plansource,
+							ParamListInfo boundParams);
 static CachedPlan *BuildCachedPlan(CachedPlanSource *plansource, List *qlist,
 								   ParamListInfo boundParams, QueryEnvironment *queryEnv);
 static bool choose_custom_plan(CachedPlanSource *plansource,
 							   ParamListInfo boundParams);
 static double cached_plan_cost(CachedPlan *plan, bool include_planner);
 static Query *QueryListGetPrimaryStmt(List *stmts);
-static void AcquireExecutorLocks(List *stmt_list, bool acquire);
+static bool AcquireExecutorLocks(CachedPlan *plan, bool acquire,
+								 ParamListInfo boundParams,
+								 List **unlocked_relids);
 static void AcquirePlannerLocks(List *stmt_list, bool acquire);
 static void ScanQueryForLocks(Query *parsetree, bool acquire);
 static bool ScanQueryWalker(Node *node, bool *acquire);
@@ -790,11 +794,15 @@ RevalidateCachedQuery(CachedPlanSource *plansource,
  *
  * On a "true" return, we have acquired the locks needed to run the plan.
  * (We must do this for the "true" result to be race-condition-free.)
+ * boundParams are the parameter values that the plan will be executed with;
+ * they allow leaving partitions eliminated by initial pruning unlocked.
  */
 static bool
-CheckCachedPlan(CachedPlanSource *plansource)
+CheckCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams)
 {
 	CachedPlan *plan = plansource->gplan;
+	List	   *unlocked_relids;
+	bool		deferred;
 
 	/* Assert that caller checked the querytree */
 	Assert(plansource->is_valid);
@@ -826,7 +834,20 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		 */
 		Assert(plan->refcount > 0);
 
-		AcquireExecutorLocks(plan->stmt_list, true);
+		deferred = AcquireExecutorLocks(plan, true, boundParams,
+										&unlocked_relids);
+
+		/*
+		 * If some partitions were locked only after initial pruning, the
+		 * invalidations processed while locking them arrived after pruning
+		 * had already looked at the catalogs.  Those that concern the plan's
+		 * own relations mark the plan invalid, which is checked below.  To
+		 * be safe, also refuse to run the plan if the querytree has been
+		 * invalidated meanwhile; a new generic plan will be built, from a
+		 * revalidated querytree, instead.
+		 */
+		if (deferred && !plansource->is_valid)
+			plan->is_valid = false;
 
 		/*
 		 * If plan was transient, check to see if TransactionXmin has
@@ -848,7 +869,7 @@ CheckCachedPlan(CachedPlanSource *plansource)
 		}
 
 		/* Oops, the race case happened.  Release useless locks. */
-		AcquireExecutorLocks(plan->stmt_list, false);
+		AcquireExecutorLocks(plan, false, NULL, &unlocked_relids);
 	}
 
 	/*
@@ -1160,7 +1181,7 @@ GetCachedPlan(CachedPlanSource *plansource, ParamListInfo boundParams,
 
 	if (!customplan)
 	{
-		if (CheckCachedPlan(plansource))
+		if (CheckCachedPlan(plansource, boundParams))
 		{
 			/* We want a generic plan, and we already have a valid one */
 			plan = plansource->gplan;
@@ -1738,16 +1759,35 @@ QueryListGetPrimaryStmt(List *stmts)
 /*
  * AcquireExecutorLocks: acquire locks needed for execution of a cached plan;
  * or release them if acquire is false.
+ *
+ * When acquiring, we don't lock leaf partitions that the executor's initial
+ * partition pruning is going to eliminate, since the executor won't touch
+ * them.  With many partitions, that saves a great deal of lock manager
+ * traffic.  We find those partitions by running the pruning ahead of time,
+ * using the given boundParams, after locking everything else (in particular
+ * the partitioned tables whose partition descriptors pruning consults).
+ * The RT indexes of the relations left unlocked are returned in
+ * *unlocked_relids, as a list of Bitmapsets parallel to the plan's
+ * stmt_list, which must be passed back when releasing the locks.
+ *
+ * Returns true if any locks were taken only after pruning.
  */
-static void
-AcquireExecutorLocks(List *stmt_list, bool acquire)
+static bool
+AcquireExecutorLocks(CachedPlan *plan, bool acquire,
+					 ParamListInfo boundParams, List **unlocked_relids)
 {
+	bool		deferred = false;
 	ListCell   *lc1;
 
-	foreach(lc1, stmt_list)
+	if (acquire)
+		*unlocked_relids = NIL;
+
+	foreach(lc1, plan->stmt_list)
 	{
 		PlannedStmt *plannedstmt = lfirst_node(PlannedStmt, lc1);
+		Bitmapset  *skip_relids;
 		ListCell   *lc2;
+		Index		rti;
 
 		if (plannedstmt->commandType == CMD_UTILITY)
 		{
@@ -1762,16 +1802,34 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 
 			if (query)
 				ScanQueryForLocks(query, acquire);
+			if (acquire)
+				*unlocked_relids = lappend(*unlocked_relids, NULL);
 			continue;
 		}
 
+		/*
+		 * When acquiring, hold off on the partitions that initial pruning
+		 * might eliminate; when releasing, skip the ones we didn't lock.
+		 */
+		if (acquire)
+			skip_relids = ExecGetPrunableRelids(plannedstmt);
+		else
+			skip_relids = (Bitmapset *) list_nth(*unlocked_relids,
+												 foreach_current_index(lc1));
+
+		rti = 0;
 		foreach(lc2, plannedstmt->rtable)
 		{
 			RangeTblEntry *rte = (RangeTblEntry *) lfirst(lc2);
 
+			rti++;
+
 			if (rte->rtekind != RTE_RELATION)
 				continue;
 
+			if (bms_is_member(rti, skip_relids))
+				continue;
+
 			/*
 			 * Acquire the appropriate type of lock on each relation OID. Note
 			 * that we don't actually try to open the rel, and hence will not
@@ -1783,7 +1841,55 @@ AcquireExecutorLocks(List *stmt_list, bool acquire)
 			else
 				UnlockRelationOid(rte->relid, rte->rellockmode);
 		}
+
+		if (acquire && skip_relids != NULL)
+		{
+			Bitmapset  *pruned_relids = NULL;
+			int			i;
+
+			/*
+			 * Now do the pruning, unless an invalidation has arrived, in
+			 * which case the plan will be thrown away anyway.  Make sure
+			 * there's a snapshot while evaluating the pruning expressions,
+			 * as BuildCachedPlan does for planning.
+			 */
+			if (plan->is_valid)
+			{
+				bool		snapshot_set = false;
+
+				if (!ActiveSnapshotSet())
+				{
+					PushActiveSnapshot(GetTransactionSnapshot());
+					snapshot_set = true;
+				}
+
+				pruned_relids = ExecGetInitiallyPrunedRelids(plannedstmt,
+															 boundParams);
+				pruned_relids = bms_int_members(pruned_relids, skip_relids);
+
+				if (snapshot_set)
+					PopActiveSnapshot();
+			}
+
+			/* Lock the partitions that survived */
+			i = -1;
+			while ((i = bms_next_member(skip_relids, i)) >= 0)
+			{
+				RangeTblEntry *rte = rt_fetch(i, plannedstmt->rtable);
+
+				if (!bms_is_member(i, pruned_relids))
+					LockRelationOid(rte->relid, rte->rellockmode);
+			}
+
+			skip_relids = pruned_relids;
+			deferred = true;
+		}
+
+		if (acquire)
+			*unlocked_relids = lappend(*unlocked_relids, skip_relids);
 	}
+
+	return deferred;
 }
 
 /*
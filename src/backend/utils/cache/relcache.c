@@ -2383,6 +2383,7 @@ RelationDestroyRelation(Relation relation, bool remember_tupdesc)
 	bms_free(relation->rd_keyattr);
 	bms_free(relation->rd_pkattr);
 	bms_free(relation->rd_idattr);
+	bms_free(relation->rd_warmblockattr);
 	if (relation->rd_pubactions)
 		pfree(relation->rd_pubactions);
 	if (relation->rd_options)
@@ -4947,6 +4948,7 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 	Bitmapset  *uindexattrs;	/* columns in unique indexes */
 	Bitmapset  *pkindexattrs;	/* columns in the primary index */
 	Bitmapset  *idindexattrs;	/* columns in the replica identity */
+	Bitmapset  *warmblockattrs; /* columns in indexes not allowing WARM */
 	List	   *indexoidlist;
 	List	   *newindexoidlist;
 	Oid			relpkindex;
@@ -4967,6 +4969,8 @@ RelationGetIndexAttrBitmap(Relation relation, IndexAttrBitmapKind attrKind)
 				return bms_copy(relation->rd_pkattr);
 			case INDEX_ATTR_BITMAP_IDENTITY_KEY:
 				return bms_copy(relation->rd_idattr);
+			case INDEX_ATTR_BITMAP_WARM_BLOCKING:
+				return bms_copy(relation->rd_warmblockattr);
 			default:
 				elog(ERROR, "unknown attrKind %u", attrKind);
 		}
@@ -5010,6 +5014,7 @@ restart:
 	uindexattrs = NULL;
 	pkindexattrs = NULL;
 	idindexattrs = NULL;
+	warmblockattrs = NULL;
 	foreach(l, indexoidlist)
 	{
 		Oid			indexOid = lfirst_oid(l);
@@ -5022,6 +5027,7 @@ restart:
 		bool		isKey;		/* candidate key */
 		bool		isPK;		/* primary key */
 		bool		isIDKey;	/* replica identity index */
+		bool		isWarm;		/* can take WARM updates */
 
 		indexDesc = index_open(indexOid, AccessShareLock);
 
@@ -5059,6 +5065,9 @@ restart:
 		/* Is this index the configured (or default) replica identity? */
 		isIDKey = (indexOid == relreplindex);
 
+		/* Can its entries be rechecked after a WARM update? */
+		isWarm = RelationIndexIsWarmCapable(relation, indexDesc);
+
 		/* Collect simple attribute references */
 		for (i = 0; i < indexDesc->rd_index->indnatts; i++)
 		{
@@ -5088,6 +5097,10 @@ restart:
 				if (isIDKey && i < indexDesc->rd_index->indnkeyatts)
 					idindexattrs = bms_add_member(idindexattrs,
 												  attrnum - FirstLowInvalidHeapAttributeNumber);
+
+				if (!isWarm)
+					warmblockattrs = bms_add_member(warmblockattrs,
+													attrnum - FirstLowInvalidHeapAttributeNumber);
 			}
 		}
 
@@ -5097,6 +5110,13 @@ restart:
 		/* Collect all attributes in the index predicate, too */
 		pull_varattnos(indexPredicate, 1, &indexattrs);
 
+		/* WARM-capable indexes have neither */
+		if (!isWarm)
+		{
+			pull_varattnos(indexExpressions, 1, &warmblockattrs);
+			pull_varattnos(indexPredicate, 1, &warmblockattrs);
+		}
+
 		index_close(indexDesc, AccessShareLock);
 	}
 
@@ -5123,6 +5143,7 @@ restart:
 		bms_free(uindexattrs);
 		bms_free(pkindexattrs);
 		bms_free(idindexattrs);
+		bms_free(warmblockattrs);
 		bms_free(indexattrs);
 
 		goto restart;
@@ -5137,6 +5158,8 @@ restart:
 	relation->rd_pkattr = NULL;
 	bms_free(relation->rd_idattr);
 	relation->rd_idattr = NULL;
+	bms_free(relation->rd_warmblockattr);
+	relation->rd_warmblockattr = NULL;
 
 	/*
 	 * Now save copies of the bitmaps in the relcache entry.  We intentionally
@@ -5149,6 +5172,7 @@ restart:
 	relation->rd_keyattr = bms_copy(uindexattrs);
 	relation->rd_pkattr = bms_copy(pkindexattrs);
 	relation->rd_idattr = bms_copy(idindexattrs);
+	relation->rd_warmblockattr = bms_copy(warmblockattrs);
 	relation->rd_indexattr = bms_copy(indexattrs);
 	MemoryContextSwitchTo(oldcxt);
 
@@ -5163,12 +5187,55 @@ restart:
 			return pkindexattrs;
 		case INDEX_ATTR_BITMAP_IDENTITY_KEY:
 			return idindexattrs;
+		case INDEX_ATTR_BITMAP_WARM_BLOCKING:
+			return warmblockattrs;
 		default:
 			elog(ERROR, "unknown attrKind %u", attrKind);
 			return NULL;
 	}
 }
 
+/*
+ * RelationIndexIsWarmCapable -- can an index of the relation take WARM updates?
+ *
+ * After a WARM update, an index on a modified column has entries with
+ * different keys pointing to the root of the same HOT chain, and scans must
+ * recheck the key of the entry they followed against the tuple they found
+ * (see README.HOT).  That's only done for plain btree columns whose stored
+ * values have the type of the table column.  Unique and exclusion indexes
+ * can't have an entry for a value that no longer exists either, since
+ * uniqueness checks would see it as a conflict.
+ *
+ * Indexes that are not ready or valid yet rule out WARM too, since the
+ * build of a concurrently created index relies on no update of its columns
+ * being HOT.
+ */
+bool
+RelationIndexIsWarmCapable(Relation relation, Relation indexDesc)
+{
+	Form_pg_index index = indexDesc->rd_index;
+	int			i;
+
+	if (indexDesc->rd_rel->relam != BTREE_AM_OID ||
+		index->indisunique || index->indisexclusion ||
+		!index->indisvalid || !index->indisready ||
+		!heap_attisnull(indexDesc->rd_indextuple, Anum_pg_index_indexprs, NULL) ||
+		!heap_attisnull(indexDesc->rd_indextuple, Anum_pg_index_indpred, NULL))
+		return false;
+
+	for (i = 0; i < index->indnatts; i++)
+	{
+		AttrNumber	attrnum = index->indkey.values[i];
+
+		if (attrnum <= 0 ||
+			TupleDescAttr(RelationGetDescr(indexDesc), i)->atttypid !=
+			TupleDescAttr(RelationGetDescr(relation), attrnum - 1)->atttypid)
+			return false;
+	}
+
+	return true;
+}
+
 /*
  * RelationGetExclusionInfo -- get info about index's exclusion constraint
  *
@@ -5932,6 +5999,7 @@ load_relcache_init_file(bool shared)
 		rel->rd_keyattr = NULL;
 		rel->rd_pkattr = NULL;
 		rel->rd_idattr = NULL;
+		rel->rd_warmblockattr = NULL;
 		rel->rd_pubactions = NULL;
 		rel->rd_statvalid = false;
 		rel->rd_statlist = NIL;
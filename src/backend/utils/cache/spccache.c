@@ -235,3 +235,16 @@ get_tablespace_maintenance_io_concurrency(Oid spcid)
 	else
 		return spc->opts->maintenance_io_concurrency;
 }
+
+/*
+ * get_tablespace_page_compression
+ *
+ *		Should relations created in this tablespace be stored compressed?
+ */
+bool
+get_tablespace_page_compression(Oid spcid)
+{
+	TableSpaceCacheEntry *spc = get_tablespace(spcid);
+
+	return spc->opts && spc->opts->page_compression;
+}
@@ -54,6 +54,7 @@
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
 #include "optimizer/cost.h"
+#include "optimizer/feedback.h"
 #include "optimizer/geqo.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/paths.h"
@@ -76,6 +77,7 @@
 #include "replication/walreceiver.h"
 #include "replication/walsender.h"
 #include "storage/bufmgr.h"
+#include "storage/doublewrite.h"
 #include "storage/dsm_impl.h"
 #include "storage/fd.h"
 #include "storage/large_object.h"
@@ -130,6 +132,7 @@ extern char *temp_tablespaces;
 extern bool ignore_checksum_failure;
 extern bool ignore_invalid_pages;
 extern bool synchronize_seqscans;
+extern bool sort_specialization;
 
 #ifdef TRACE_SYNCSCAN
 extern bool trace_syncscan;
@@ -1076,6 +1079,16 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_eager_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partial aggregation of a relation before it is joined."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_eager_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of parallel append plans."),
@@ -1249,6 +1262,19 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"double_write_buffer", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Writes pages to a double-write buffer before writing them in place."),
+			gettext_noop("A page write in process during an operating system crash might be "
+						 "only partially written to disk.  This option saves a copy of each "
+						 "page before writing it, so that recovery can repair such pages "
+						 "without full_page_writes.")
+		},
+		&double_write_buffer,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_log_hints", PGC_POSTMASTER, WAL_SETTINGS,
 			gettext_noop("Writes full pages to WAL when first modified after a checkpoint, even for a non-critical modifications."),
@@ -1720,6 +1746,17 @@ static struct config_bool ConfigureNamesBool[] =
 	},
 #endif
 
+	{
+		{"sort_specialization", PGC_USERSET, DEVELOPER_OPTIONS,
+			gettext_noop("Enables sort routines specialized for the type of the leading sort key."),
+			gettext_noop("When off, all in-memory sorts use the generic quicksort."),
+			GUC_NOT_IN_SAMPLE
+		},
+		&sort_specialization,
+		true,
+		NULL, NULL, NULL
+	},
+
 #ifdef TRACE_SYNCSCAN
 	/* this is undocumented because not exposed in a standard build */
 	{
@@ -1951,6 +1988,18 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"adaptive_reoptimization", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Re-plans queries whose row count estimates turn out to be far off."),
+			gettext_noop("The row counts observed during execution are also used "
+						 "when the same query is planned again in the session."),
+			GUC_EXPLAIN
+		},
+		&adaptive_reoptimization,
+		false,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"jit_debugging_support", PGC_SU_BACKEND, DEVELOPER_OPTIONS,
 			gettext_noop("Register JIT compiled function with debugger."),
@@ -2102,6 +2151,20 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"join_search_block_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the number of FROM items that are ordered "
+						 "together by iterative dynamic programming."),
+			gettext_noop("Join problems with more FROM items than this are "
+						 "planned in rounds of at most this many items each, "
+						 "instead of using exhaustive search or GEQO. "
+						 "Zero disables this."),
+			GUC_EXPLAIN
+		},
+		&join_search_block_size,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2718,6 +2781,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks used for concurrent WAL insertion."),
+			NULL
+		},
+		&NumXLogInsertLocks,
+		8, 1, 128,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -3531,6 +3604,18 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"reoptimization_threshold", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the factor by which a row count estimate must be "
+						 "off to trigger adaptive re-optimization."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&reoptimization_threshold,
+		DEFAULT_REOPTIMIZATION_THRESHOLD, 2.0, 1.0e10,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -54,6 +54,38 @@ print <<'EOM';
 EOM
 emit_qsort_implementation();
 
+# Variants of qsort_tuple for leading keys whose comparator is one of the
+# standard datum comparators in sortsupport.h.  The comparison of datum1 is
+# inlined; the full comparator is consulted only to break ties.  The
+# qsort_tuple_*_compare() functions are defined in tuplesort.c.
+foreach my $kind ('unsigned', 'signed', 'int32')
+{
+	$SUFFIX      = "tuple_$kind";
+	$EXTRAARGS   = ', Tuplesortstate *state';
+	$EXTRAPARAMS = ', state';
+	$CMPPARAMS   = ', state';
+	if ($kind eq 'signed')
+	{
+		print <<'EOM';
+
+#if SIZEOF_DATUM >= 8
+EOM
+	}
+	print <<EOM;
+
+#define cmp_tuple_$kind(a, b, state) \\
+	qsort_tuple_${kind}_compare(a, b, state)
+
+EOM
+	emit_qsort_implementation();
+	if ($kind eq 'signed')
+	{
+		print <<'EOM';
+#endif							/* SIZEOF_DATUM >= 8 */
+EOM
+	}
+}
+
 sub emit_qsort_boilerplate
 {
 	print <<'EOM';
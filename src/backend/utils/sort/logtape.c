@@ -34,8 +34,9 @@
  * The blocks in each logical tape form a chain, with a prev- and next-
  * pointer in each block.
  *
- * The initial write pass is guaranteed to fill the underlying file
- * perfectly sequentially, no matter how data is divided into logical tapes.
+ * The initial write pass fills the underlying file sequentially, no matter
+ * how data is divided into logical tapes, except that preallocation (see
+ * below) may leave holes that are filled in later.
  * Once we begin merge passes, the access pattern becomes considerably
  * less predictable --- but the seeking involved should be comparable to
  * what would happen if we kept each logical tape in a separate file,
@@ -47,7 +48,12 @@
  *
  * To further make the I/Os more sequential, we can use a larger buffer
  * when reading, and read multiple blocks from the same tape in one go,
- * whenever the buffer becomes empty.
+ * whenever the buffer becomes empty.  Tapes are written in extents of
+ * contiguous blocks (see TAPE_WRITE_PREALLOC_MIN), so each refill of the
+ * buffer is mostly a sequential read.  While the caller consumes the buffer,
+ * we ask the kernel to read ahead the blocks that the next refill will need,
+ * so that a merge reading from many tapes at once doesn't have to wait for a
+ * seek every time one of its input buffers runs dry.
  *
  * To support the above policy of writing to the lowest free block, the
  * freelist is a min heap.
@@ -113,17 +119,21 @@ typedef struct TapeBlockTrailer
 	(TapeBlockGetTrailer(buf)->next = -(nbytes))
 
 /*
- * When multiple tapes are being written to concurrently (as in HashAgg),
- * avoid excessive fragmentation by preallocating block numbers to individual
- * tapes. Each preallocation doubles in size starting at
- * TAPE_WRITE_PREALLOC_MIN blocks up to TAPE_WRITE_PREALLOC_MAX blocks.
+ * When multiple tapes are being written to concurrently (as in HashAgg, or in
+ * the merge passes of a sort), avoid excessive fragmentation by preallocating
+ * block numbers to individual tapes. Each preallocation doubles in size
+ * starting at TAPE_WRITE_PREALLOC_MIN blocks up to TAPE_WRITE_PREALLOC_MAX
+ * blocks.  To bound the number of blocks held in preallocation lists, the
+ * limit is lowered when there are many tapes, so that all the tapes together
+ * hold no more than about TAPE_WRITE_PREALLOC_TOTAL blocks.
  *
  * No filesystem operations are performed for preallocation; only the block
  * numbers are reserved. This may lead to sparse writes, which will cause
  * ltsWriteBlock() to fill in holes with zeros.
  */
 #define TAPE_WRITE_PREALLOC_MIN 8
-#define TAPE_WRITE_PREALLOC_MAX 128
+#define TAPE_WRITE_PREALLOC_MAX 1024
+#define TAPE_WRITE_PREALLOC_TOTAL 16384
 
 /*
  * This data structure represents a single "logical tape" within the set
@@ -229,6 +239,8 @@ static void ltsConcatWorkerTapes(LogicalTapeSet *lts, TapeShare *shared,
 								 SharedFileSet *fileset);
 static void ltsInitTape(LogicalTape *lt);
 static void ltsInitReadBuffer(LogicalTapeSet *lts, LogicalTape *lt);
+static void ltsPrefetchNextBlocks(LogicalTapeSet *lts, LogicalTape *lt,
+								  int ncontiguous, int nread);
 
 
 /*
@@ -306,6 +318,9 @@ ltsReadBlock(LogicalTapeSet *lts, long blocknum, void *buffer)
 static bool
 ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 {
+	int			nread = 0;
+	int			ncontiguous = 0;
+
 	lt->pos = 0;
 	lt->nbytes = 0;
 
@@ -324,6 +339,9 @@ ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 		ltsReadBlock(lts, datablocknum, (void *) thisbuf);
 		if (!lt->frozen)
 			ltsReleaseBlock(lts, datablocknum);
+		if (nread > 0 && lt->nextBlockNumber == lt->curBlockNumber + 1)
+			ncontiguous++;
+		nread++;
 		lt->curBlockNumber = lt->nextBlockNumber;
 
 		lt->nbytes += TapeBlockGetNBytes(thisbuf);
@@ -339,9 +357,45 @@ ltsReadFillBuffer(LogicalTapeSet *lts, LogicalTape *lt)
 		/* Advance to next block, if we have buffer space left */
 	} while (lt->buffer_size - lt->nbytes > BLCKSZ);
 
+	if (!lt->frozen && lt->nextBlockNumber != -1L)
+		ltsPrefetchNextBlocks(lts, lt, ncontiguous, nread);
+
 	return (lt->nbytes > 0);
 }
 
+/*
+ * Start reading ahead the blocks for the next refill of the tape's buffer.
+ *
+ * The tape's blocks form a chain, and we only learn where a block's successor
+ * is by reading the block.  But the blocks were written in preallocated
+ * extents, so usually they just follow each other.  If that was the case for
+ * the blocks we just read, assume that the next refill will read the next
+ * block and the blocks physically following it, and prefetch as many blocks
+ * as the buffer can hold, starting with the next block itself (that's the
+ * first one the refill reads).  If the tape looks fragmented, don't bother;
+ * we'd mostly be reading blocks of other tapes.
+ *
+ * 'ncontiguous' is the number of blocks just read that immediately followed
+ * the previous one, out of 'nread' blocks.
+ */
+static void
+ltsPrefetchNextBlocks(LogicalTapeSet *lts, LogicalTape *lt,
+					  int ncontiguous, int nread)
+{
+	int			nblocks = lt->buffer_size / BLCKSZ;
+
+	/* A single-block buffer gets nothing out of read-ahead */
+	if (nblocks <= 1)
+		return;
+
+	if (ncontiguous * 2 < nread - 1)
+		return;
+
+	BufFilePrefetchBlock(lts->pfile,
+						 lt->nextBlockNumber + lt->offsetBlockNumber,
+						 nblocks);
+}
+
 static inline void
 swap_nodes(long *heap, unsigned long a, unsigned long b)
 {
@@ -455,14 +509,21 @@ ltsGetPreallocBlock(LogicalTapeSet *lts, LogicalTape *lt)
 		lt->prealloc_size = TAPE_WRITE_PREALLOC_MIN;
 		lt->prealloc = (long *) palloc(sizeof(long) * lt->prealloc_size);
 	}
-	else if (lt->prealloc_size < TAPE_WRITE_PREALLOC_MAX)
+	else
 	{
+		int			max_size;
+
+		max_size = Min(TAPE_WRITE_PREALLOC_MAX,
+					   TAPE_WRITE_PREALLOC_TOTAL / lts->nTapes);
+		max_size = Max(max_size, TAPE_WRITE_PREALLOC_MIN);
+
 		/* when the preallocation list runs out, double the size */
-		lt->prealloc_size *= 2;
-		if (lt->prealloc_size > TAPE_WRITE_PREALLOC_MAX)
-			lt->prealloc_size = TAPE_WRITE_PREALLOC_MAX;
-		lt->prealloc = (long *) repalloc(lt->prealloc,
-										 sizeof(long) * lt->prealloc_size);
+		if (lt->prealloc_size < max_size)
+		{
+			lt->prealloc_size = Min(lt->prealloc_size * 2, max_size);
+			lt->prealloc = (long *) repalloc(lt->prealloc,
+											 sizeof(long) * lt->prealloc_size);
+		}
 	}
 
 	/* refill preallocation list */
@@ -96,15 +96,18 @@
 
 #include <limits.h>
 
+#include "access/gin.h"
 #include "access/hash.h"
 #include "access/htup_details.h"
 #include "access/nbtree.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_collation.h"
 #include "commands/tablespace.h"
 #include "executor/executor.h"
 #include "miscadmin.h"
 #include "pg_trace.h"
+#include "utils/builtins.h"
 #include "utils/datum.h"
 #include "utils/logtape.h"
 #include "utils/lsyscache.h"
@@ -113,6 +116,7 @@
 #include "utils/rel.h"
 #include "utils/sortsupport.h"
 #include "utils/tuplesort.h"
+#include "utils/typcache.h"
 
 
 /* sort-type codes for sort__start probes */
@@ -135,6 +139,15 @@
 #define INITIAL_MEMTUPSIZE Max(1024, \
 	ALLOCSET_SEPARATE_THRESHOLD / sizeof(SortTuple) + 1)
 
+/*
+ * In-memory sorts of at least RADIX_SORT_MIN_TUPLES tuples whose leading key
+ * can be radix sorted use radix sort rather than quicksort.  Radix sort
+ * partitions smaller than RADIX_SORT_QSORT_THRESHOLD are finished off with
+ * quicksort.
+ */
+#define RADIX_SORT_MIN_TUPLES		4096
+#define RADIX_SORT_QSORT_THRESHOLD	64
+
 /* GUC variables */
 #ifdef TRACE_SORT
 bool		trace_sort = false;
@@ -144,6 +157,8 @@ bool		trace_sort = false;
 bool		optimize_bounded_sort = true;
 #endif
 
+bool		sort_specialization = true;
+
 
 /*
  * The objects we actually sort are SortTuple structs.  These contain
@@ -234,6 +249,45 @@ typedef enum
 typedef int (*SortTupleComparator) (const SortTuple *a, const SortTuple *b,
 									Tuplesortstate *state);
 
+/*
+ * Kinds of leading sort key, as far as choosing a sort routine is concerned.
+ * All but SORTKEY_GENERIC correspond to one of the standard datum comparators
+ * in sortsupport.h, which lets us inline the comparison of datum1 and radix
+ * sort on it.
+ */
+typedef enum
+{
+	SORTKEY_GENERIC,			/* call the comparator through SortSupport */
+	SORTKEY_UNSIGNED,			/* ssup_datum_unsigned_cmp */
+	SORTKEY_SIGNED,				/* ssup_datum_signed_cmp */
+	SORTKEY_INT32				/* ssup_datum_int32_cmp */
+} SortKeyKind;
+
+/*
+ * How radix sort turns datum1 into an unsigned key of nbytes bytes, see
+ * radix_sort_key().
+ */
+typedef struct RadixSortKey
+{
+	SortKeyKind kind;			/* kind of the leading sort key */
+	Datum		mask;			/* bits of datum1 that make up the key */
+	Datum		flip;			/* bits of the key to invert */
+	int			nbytes;			/* width of the key */
+} RadixSortKey;
+
+/*
+ * BRIN tuples are stored along with their length, because BrinTuple doesn't
+ * carry it.
+ */
+typedef struct BrinSortTuple
+{
+	Size		tuplen;
+	BrinTuple	tuple;
+} BrinSortTuple;
+
+/* Size of the BrinSortTuple, given length of the BrinTuple. */
+#define BRINSORTTUPLE_SIZE(len)		(offsetof(BrinSortTuple, tuple) + (len))
+
 /*
  * Private state of a Tuplesort operation.
  */
@@ -423,7 +477,7 @@ struct Tuplesortstate
 
 	/*
 	 * The sortKeys variable is used by every case other than the hash index
-	 * case; it is set by tuplesort_begin_xxx.  tupDesc is only used by the
+	 * and BRIN cases; it is set by tuplesort_begin_xxx.  tupDesc is only used by the
 	 * MinimalTuple and CLUSTER routines, though.
 	 */
 	TupleDesc	tupDesc;
@@ -654,6 +708,18 @@ static void writetup_index(Tuplesortstate *state, int tapenum,
 						   SortTuple *stup);
 static void readtup_index(Tuplesortstate *state, SortTuple *stup,
 						  int tapenum, unsigned int len);
+static int	comparetup_index_brin(const SortTuple *a, const SortTuple *b,
+								  Tuplesortstate *state);
+static void writetup_index_brin(Tuplesortstate *state, int tapenum,
+								SortTuple *stup);
+static void readtup_index_brin(Tuplesortstate *state, SortTuple *stup,
+							   int tapenum, unsigned int len);
+static int	comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+								 Tuplesortstate *state);
+static void writetup_index_gin(Tuplesortstate *state, int tapenum,
+							   SortTuple *stup);
+static void readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+							  int tapenum, unsigned int len);
 static int	comparetup_datum(const SortTuple *a, const SortTuple *b,
 							 Tuplesortstate *state);
 static void copytup_datum(Tuplesortstate *state, SortTuple *stup, void *tup);
@@ -669,12 +735,73 @@ static void free_sort_tuple(Tuplesortstate *state, SortTuple *stup);
 static void tuplesort_free(Tuplesortstate *state);
 static void tuplesort_updatemax(Tuplesortstate *state);
 
+/*
+ * Comparators for the qsort_tuple_unsigned(), qsort_tuple_signed() and
+ * qsort_tuple_int32() variants of qsort_tuple().  These are used when the
+ * leading key's comparator is one of the standard datum comparators, so the
+ * comparison of datum1 can be inlined.  The comparetup routine is called only
+ * to break ties, and not at all if the leading key is the only one.
+ */
+static pg_attribute_always_inline int
+qsort_tuple_unsigned_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyUnsignedSortComparator(a->datum1, a->isnull1,
+										  b->datum1, b->isnull1,
+										  &state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
+#if SIZEOF_DATUM >= 8
+static pg_attribute_always_inline int
+qsort_tuple_signed_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplySignedSortComparator(a->datum1, a->isnull1,
+										b->datum1, b->isnull1,
+										&state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+#endif
+
+static pg_attribute_always_inline int
+qsort_tuple_int32_compare(SortTuple *a, SortTuple *b, Tuplesortstate *state)
+{
+	int			compare;
+
+	compare = ApplyInt32SortComparator(a->datum1, a->isnull1,
+									   b->datum1, b->isnull1,
+									   &state->sortKeys[0]);
+	if (compare != 0)
+		return compare;
+
+	if (state->onlyKey != NULL)
+		return 0;
+
+	return state->comparetup(a, b, state);
+}
+
 /*
  * Special versions of qsort just for SortTuple objects.  qsort_tuple() sorts
  * any variant of SortTuples, using the appropriate comparetup function.
  * qsort_ssup() is specialized for the case where the comparetup function
  * reduces to ApplySortComparator(), that is single-key MinimalTuple sorts
- * and Datum sorts.
+ * and Datum sorts.  qsort_tuple_unsigned(), qsort_tuple_signed() and
+ * qsort_tuple_int32() inline the comparison of the leading key, see above.
  */
 #include "qsort_tuple.c"
 
@@ -1224,6 +1351,111 @@ tuplesort_begin_index_gist(Relation heapRel,
 	return state;
 }
 
+Tuplesortstate *
+tuplesort_begin_index_brin(int workMem,
+						   SortCoordinate coordinate,
+						   bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: workMem = %d, randomAccess = %c",
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = 1;			/* Only one sort column, the block number */
+
+	state->comparetup = comparetup_index_brin;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index_brin;
+	state->readtup = readtup_index_brin;
+
+	return state;
+}
+
+Tuplesortstate *
+tuplesort_begin_index_gin(Relation heapRel,
+						  Relation indexRel,
+						  int workMem, SortCoordinate coordinate,
+						  bool randomAccess)
+{
+	Tuplesortstate *state = tuplesort_begin_common(workMem, coordinate,
+												   randomAccess);
+	TupleDesc	desc = RelationGetDescr(indexRel);
+	MemoryContext oldcontext;
+	int			i;
+
+	oldcontext = MemoryContextSwitchTo(state->maincontext);
+
+#ifdef TRACE_SORT
+	if (trace_sort)
+		elog(LOG,
+			 "begin index sort: nkeys = %d, workMem = %d, randomAccess = %c",
+			 IndexRelationGetNumberOfKeyAttributes(indexRel),
+			 workMem, randomAccess ? 't' : 'f');
+#endif
+
+	state->nKeys = IndexRelationGetNumberOfKeyAttributes(indexRel);
+
+	state->comparetup = comparetup_index_gin;
+	state->copytup = copytup_index;
+	state->writetup = writetup_index_gin;
+	state->readtup = readtup_index_gin;
+
+	state->heapRel = heapRel;
+	state->indexRel = indexRel;
+
+	/*
+	 * Prepare SortSupport data for the key of each index column.  This must
+	 * match the comparison rules of initGinState().
+	 */
+	state->sortKeys = (SortSupport) palloc0(state->nKeys *
+											sizeof(SortSupportData));
+
+	for (i = 0; i < state->nKeys; i++)
+	{
+		SortSupport sortKey = state->sortKeys + i;
+		Form_pg_attribute att = TupleDescAttr(desc, i);
+		Oid			cmpFunc;
+
+		sortKey->ssup_cxt = CurrentMemoryContext;
+		sortKey->ssup_collation = indexRel->rd_indcollation[i];
+		sortKey->ssup_nulls_first = false;
+		sortKey->ssup_attno = i + 1;
+		sortKey->abbreviate = false;
+
+		if (!OidIsValid(sortKey->ssup_collation))
+			sortKey->ssup_collation = DEFAULT_COLLATION_OID;
+
+		/*
+		 * If the compare proc isn't specified in the opclass definition, use
+		 * the index key type's default btree comparator.
+		 */
+		cmpFunc = index_getprocid(indexRel, i + 1, GIN_COMPARE_PROC);
+		if (!OidIsValid(cmpFunc))
+		{
+			TypeCacheEntry *typentry;
+
+			typentry = lookup_type_cache(att->atttypid, TYPECACHE_CMP_PROC);
+			if (!OidIsValid(typentry->cmp_proc))
+				ereport(ERROR,
+						(errcode(ERRCODE_UNDEFINED_FUNCTION),
+						 errmsg("could not identify a comparison function for type %s",
+								format_type_be(att->atttypid))));
+			cmpFunc = typentry->cmp_proc;
+		}
+
+		PrepareSortSupportComparisonShim(cmpFunc, sortKey);
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return state;
+}
+
 Tuplesortstate *
 tuplesort_begin_datum(Oid datumType, Oid sortOperator, Oid sortCollation,
 					  bool nullsFirstFlag, int workMem,
@@ -1777,6 +2009,61 @@ tuplesort_putindextuplevalues(Tuplesortstate *state, Relation rel,
 	MemoryContextSwitchTo(oldcontext);
 }
 
+/*
+ * Collect one BRIN tuple while collecting input data for sort.
+ */
+void
+tuplesort_putbrintuple(Tuplesortstate *state, BrinTuple *tuple, Size size)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	SortTuple	stup;
+	BrinSortTuple *bstup;
+
+	/* copy the BrinTuple into the right memory context */
+	bstup = palloc(BRINSORTTUPLE_SIZE(size));
+	bstup->tuplen = size;
+	memcpy(&bstup->tuple, tuple, size);
+
+	stup.tuple = bstup;
+	stup.datum1 = UInt32GetDatum(tuple->bt_blkno);
+	stup.isnull1 = false;
+
+	USEMEM(state, GetMemoryChunkSpace(bstup));
+
+	MemoryContextSwitchTo(state->sortcontext);
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Collect one GIN tuple while collecting input data for sort.
+ */
+void
+tuplesort_putgintuple(Tuplesortstate *state, GinTuple *tuple, Size size)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->tuplecontext);
+	SortTuple	stup;
+	GinTuple   *ctup;
+
+	/* copy the GinTuple into the right memory context */
+	ctup = palloc(size);
+	memcpy(ctup, tuple, size);
+
+	stup.tuple = ctup;
+	stup.datum1 = (Datum) 0;
+	stup.isnull1 = false;
+
+	USEMEM(state, GetMemoryChunkSpace(ctup));
+
+	MemoryContextSwitchTo(state->sortcontext);
+
+	puttuple_common(state, &stup);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
 /*
  * Accept one Datum while collecting input data for sort.
  *
@@ -2456,6 +2743,62 @@ tuplesort_getindextuple(Tuplesortstate *state, bool forward)
 	return (IndexTuple) stup.tuple;
 }
 
+/*
+ * Fetch the next BRIN tuple in either forward or back direction.
+ * Returns NULL if no more tuples.  Returned tuple belongs to tuplesort memory
+ * context, and must not be freed by caller.  Caller may not rely on tuple
+ * remaining valid after any further manipulation of tuplesort.
+ */
+BrinTuple *
+tuplesort_getbrintuple(Tuplesortstate *state, Size *len, bool forward)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+	BrinSortTuple *btup;
+
+	if (!tuplesort_gettuple_common(state, forward, &stup))
+		stup.tuple = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (!stup.tuple)
+		return NULL;
+
+	btup = (BrinSortTuple *) stup.tuple;
+
+	*len = btup->tuplen;
+
+	return &btup->tuple;
+}
+
+/*
+ * Fetch the next GIN tuple in either forward or back direction.
+ * Returns NULL if no more tuples.  Returned tuple belongs to tuplesort memory
+ * context, and must not be freed by caller.  Caller may not rely on tuple
+ * remaining valid after any further manipulation of tuplesort.
+ */
+GinTuple *
+tuplesort_getgintuple(Tuplesortstate *state, Size *len, bool forward)
+{
+	MemoryContext oldcontext = MemoryContextSwitchTo(state->sortcontext);
+	SortTuple	stup;
+	GinTuple   *tup;
+
+	if (!tuplesort_gettuple_common(state, forward, &stup))
+		stup.tuple = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (!stup.tuple)
+		return NULL;
+
+	tup = (GinTuple *) stup.tuple;
+
+	*len = tup->tuplen;
+
+	return tup;
+}
+
 /*
  * Fetch the next Datum in either forward or back direction.
  * Returns false if no more datums.
@@ -2645,10 +2988,16 @@ inittapes(Tuplesortstate *state, bool mergeruns)
 			 state->worker, maxTapes, pg_rusage_show(&state->ru_start));
 #endif
 
-	/* Create the tape set and allocate the per-tape data arrays */
+	/*
+	 * Create the tape set and allocate the per-tape data arrays.  Have the
+	 * tapes preallocate their blocks in extents: merge passes write the
+	 * output tape while reading all the input tapes, and without extents the
+	 * blocks of all of them would be interleaved in the file, so that reading
+	 * them back in the next pass would be dominated by seeks.
+	 */
 	inittapestate(state, maxTapes);
 	state->tapeset =
-		LogicalTapeSetCreate(maxTapes, false, NULL,
+		LogicalTapeSetCreate(maxTapes, true, NULL,
 							 state->shared ? &state->shared->fileset : NULL,
 							 state->worker);
 
@@ -3527,10 +3876,283 @@ sort_bounded_heap(Tuplesortstate *state)
 	state->boundUsed = true;
 }
 
+/*
+ * Determine which of the specialized sort routines, if any, can be used for
+ * the leading sort key.
+ */
+static SortKeyKind
+tuplesort_sortkey_kind(Tuplesortstate *state)
+{
+	SortSupport sortKey = state->sortKeys;
+
+	if (!sort_specialization || sortKey == NULL)
+		return SORTKEY_GENERIC;
+
+	if (sortKey->comparator == ssup_datum_unsigned_cmp)
+		return SORTKEY_UNSIGNED;
+#if SIZEOF_DATUM >= 8
+	if (sortKey->comparator == ssup_datum_signed_cmp)
+		return SORTKEY_SIGNED;
+#endif
+	if (sortKey->comparator == ssup_datum_int32_cmp)
+		return SORTKEY_INT32;
+
+	return SORTKEY_GENERIC;
+}
+
+/*
+ * Quicksort SortTuples with the qsort variant matching the leading key.
+ */
+static void
+qsort_tuple_specialized(SortTuple *data, size_t n, SortKeyKind kind,
+						Tuplesortstate *state)
+{
+	switch (kind)
+	{
+		case SORTKEY_UNSIGNED:
+			qsort_tuple_unsigned(data, n, state);
+			break;
+#if SIZEOF_DATUM >= 8
+		case SORTKEY_SIGNED:
+			qsort_tuple_signed(data, n, state);
+			break;
+#endif
+		case SORTKEY_INT32:
+			qsort_tuple_int32(data, n, state);
+			break;
+		default:
+			elog(ERROR, "unexpected sort key kind: %d", (int) kind);
+			break;
+	}
+}
+
+/*
+ * Map a non-null datum1 to an unsigned radix key that sorts in the requested
+ * order.  Signed keys get their sign bit flipped, and descending sorts invert
+ * all the bits of the key.
+ */
+static inline Datum
+radix_sort_key(Datum datum, const RadixSortKey *key)
+{
+	return (datum & key->mask) ^ key->flip;
+}
+
+static inline int
+radix_sort_byte(Datum datum, const RadixSortKey *key, int level)
+{
+	Datum		k = radix_sort_key(datum, key);
+
+	return (int) ((k >> (level * BITS_PER_BYTE)) & 0xFF);
+}
+
+/*
+ * In-place MSD radix sort ("American flag sort") of non-null SortTuples on
+ * datum1, starting at the given byte of the radix key.
+ *
+ * Each pass distributes the tuples into 256 buckets by one byte of the key,
+ * and then recurses into every bucket on the next less significant byte.  The
+ * recursion depth is therefore bounded by the width of the key.  Buckets that
+ * become small are handed over to quicksort, and so are tuples whose datum1
+ * values are identical, since they might still need to be ordered by
+ * comparetup (when there are more sort keys, or datum1 is an abbreviated
+ * key).
+ */
+static void
+radix_sort_tuple(SortTuple *data, size_t n, int level,
+				 const RadixSortKey *key, Tuplesortstate *state)
+{
+	size_t		counts[256];
+	size_t		next[256];
+	size_t		ends[256];
+	size_t		offset;
+	size_t		i;
+	int			b;
+
+	CHECK_FOR_INTERRUPTS();
+
+	for (;;)
+	{
+		if (n < RADIX_SORT_QSORT_THRESHOLD)
+		{
+			if (n > 1)
+				qsort_tuple_specialized(data, n, key->kind, state);
+			return;
+		}
+
+		if (level < 0)
+		{
+			/* datum1 is equal for all tuples; break ties if necessary */
+			if (state->onlyKey == NULL)
+				qsort_tuple_specialized(data, n, key->kind, state);
+			return;
+		}
+
+		memset(counts, 0, sizeof(counts));
+		for (i = 0; i < n; i++)
+			counts[radix_sort_byte(data[i].datum1, key, level)]++;
+
+		/* Skip over bytes that are the same for every tuple */
+		if (counts[radix_sort_byte(data[0].datum1, key, level)] < n)
+			break;
+		level--;
+	}
+
+	offset = 0;
+	for (b = 0; b < 256; b++)
+	{
+		next[b] = offset;
+		offset += counts[b];
+		ends[b] = offset;
+	}
+
+	/*
+	 * Permute the tuples into their buckets.  Each tuple taken out of a
+	 * bucket that doesn't belong there is swapped into the next free slot of
+	 * its own bucket, until a tuple that belongs in the current bucket turns
+	 * up.
+	 */
+	for (b = 0; b < 256; b++)
+	{
+		while (next[b] < ends[b])
+		{
+			SortTuple	tup = data[next[b]];
+			int			dest = radix_sort_byte(tup.datum1, key, level);
+
+			while (dest != b)
+			{
+				SortTuple	tmp = data[next[dest]];
+
+				data[next[dest]++] = tup;
+				tup = tmp;
+				dest = radix_sort_byte(tup.datum1, key, level);
+			}
+			data[next[b]++] = tup;
+		}
+	}
+
+	offset = 0;
+	for (b = 0; b < 256; b++)
+	{
+		if (counts[b] > 1)
+			radix_sort_tuple(data + offset, counts[b], level - 1, key, state);
+		offset += counts[b];
+	}
+}
+
+/*
+ * Sort all memtuples with radix sort on the leading key.
+ *
+ * NULLs are moved to the front or the back first, as the leading key asks.
+ * They're equal as far as the leading key is concerned, so only comparetup
+ * can order them.
+ */
+static void
+radix_sort_memtuples(Tuplesortstate *state, SortKeyKind kind)
+{
+	SortSupport sortKey = state->sortKeys;
+	SortTuple  *memtuples = state->memtuples;
+	size_t		n = state->memtupcount;
+	SortTuple  *nulls;
+	SortTuple  *notnulls;
+	size_t		nnulls;
+	size_t		i;
+	size_t		j;
+	RadixSortKey key;
+
+	/* Nothing to do for presorted input, which is common enough to check */
+	for (i = 1; i < n; i++)
+	{
+		int			compare;
+
+		switch (kind)
+		{
+			case SORTKEY_UNSIGNED:
+				compare = qsort_tuple_unsigned_compare(&memtuples[i - 1],
+													   &memtuples[i], state);
+				break;
+#if SIZEOF_DATUM >= 8
+			case SORTKEY_SIGNED:
+				compare = qsort_tuple_signed_compare(&memtuples[i - 1],
+													 &memtuples[i], state);
+				break;
+#endif
+			default:
+				compare = qsort_tuple_int32_compare(&memtuples[i - 1],
+													&memtuples[i], state);
+				break;
+		}
+		if (compare > 0)
+			break;
+	}
+	if (i >= n)
+		return;
+
+	/* Partition NULLs from non-NULLs */
+	j = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (memtuples[i].isnull1 == sortKey->ssup_nulls_first)
+		{
+			if (i != j)
+			{
+				SortTuple	tmp = memtuples[i];
+
+				memtuples[i] = memtuples[j];
+				memtuples[j] = tmp;
+			}
+			j++;
+		}
+	}
+	if (sortKey->ssup_nulls_first)
+	{
+		nulls = memtuples;
+		nnulls = j;
+		notnulls = memtuples + j;
+	}
+	else
+	{
+		notnulls = memtuples;
+		nulls = memtuples + j;
+		nnulls = n - j;
+	}
+
+	if (nnulls > 1 && state->onlyKey == NULL)
+		qsort_tuple(nulls, nnulls, state->comparetup, state);
+
+	key.kind = kind;
+	switch (kind)
+	{
+		case SORTKEY_UNSIGNED:
+			key.mask = ~(Datum) 0;
+			key.flip = 0;
+			key.nbytes = SIZEOF_DATUM;
+			break;
+#if SIZEOF_DATUM >= 8
+		case SORTKEY_SIGNED:
+			key.mask = ~(Datum) 0;
+			key.flip = (Datum) 1 << (SIZEOF_DATUM * BITS_PER_BYTE - 1);
+			key.nbytes = SIZEOF_DATUM;
+			break;
+#endif
+		default:
+			key.mask = (Datum) PG_UINT32_MAX;
+			key.flip = (Datum) 1 << 31;
+			key.nbytes = sizeof(int32);
+			break;
+	}
+	if (sortKey->ssup_reverse)
+		key.flip ^= key.mask;
+
+	radix_sort_tuple(notnulls, n - nnulls, key.nbytes - 1, &key, state);
+}
+
 /*
  * Sort all memtuples using specialized qsort() routines.
  *
- * Quicksort is used for small in-memory sorts, and external sort runs.
+ * Quicksort is used for small in-memory sorts, and external sort runs.  When
+ * the leading key's comparator is one of the standard datum comparators,
+ * variants of quicksort that inline the comparison are used instead, and
+ * radix sort for large inputs.
  */
 static void
 tuplesort_sort_memtuples(Tuplesortstate *state)
@@ -3539,8 +4161,19 @@ tuplesort_sort_memtuples(Tuplesortstate *state)
 
 	if (state->memtupcount > 1)
 	{
+		SortKeyKind kind = tuplesort_sortkey_kind(state);
+
+		if (kind != SORTKEY_GENERIC)
+		{
+			if (state->memtupcount >= RADIX_SORT_MIN_TUPLES)
+				radix_sort_memtuples(state, kind);
+			else
+				qsort_tuple_specialized(state->memtuples,
+										state->memtupcount,
+										kind, state);
+		}
 		/* Can we use the single-key sort function? */
-		if (state->onlyKey != NULL)
+		else if (state->onlyKey != NULL)
 			qsort_ssup(state->memtuples, state->memtupcount,
 					   state->onlyKey);
 		else
@@ -4414,6 +5047,141 @@ readtup_index(Tuplesortstate *state, SortTuple *stup,
 								 &stup->isnull1);
 }
 
+/*
+ * Routines specialized for BrinTuple case
+ *
+ * BRIN tuples are sorted by the first block of the page range they
+ * summarize.  Ties are harmless; the caller merges tuples for the same
+ * range.
+ */
+
+static int
+comparetup_index_brin(const SortTuple *a, const SortTuple *b,
+					  Tuplesortstate *state)
+{
+	Assert(!a->isnull1 && !b->isnull1);
+
+	if (DatumGetUInt32(a->datum1) > DatumGetUInt32(b->datum1))
+		return 1;
+
+	if (DatumGetUInt32(a->datum1) < DatumGetUInt32(b->datum1))
+		return -1;
+
+	/* silence compilers */
+	return 0;
+}
+
+static void
+writetup_index_brin(Tuplesortstate *state, int tapenum, SortTuple *stup)
+{
+	BrinSortTuple *tuple = (BrinSortTuple *) stup->tuple;
+	unsigned int tuplen = tuple->tuplen;
+
+	tuplen = tuplen + sizeof(tuplen);
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuplen, sizeof(tuplen));
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuple->tuple, tuple->tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeWrite(state->tapeset, tapenum,
+						 (void *) &tuplen, sizeof(tuplen));
+
+	if (!state->slabAllocatorUsed)
+	{
+		FREEMEM(state, GetMemoryChunkSpace(tuple));
+		pfree(tuple);
+	}
+}
+
+static void
+readtup_index_brin(Tuplesortstate *state, SortTuple *stup,
+				   int tapenum, unsigned int len)
+{
+	BrinSortTuple *tuple;
+	unsigned int tuplen = len - sizeof(unsigned int);
+
+	/*
+	 * Allocate space for the BRIN sort tuple, which is BrinTuple with an
+	 * extra length field.
+	 */
+	tuple = (BrinSortTuple *) readtup_alloc(state,
+											BRINSORTTUPLE_SIZE(tuplen));
+
+	tuple->tuplen = tuplen;
+
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 &tuple->tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) tuple;
+
+	/* set up first-column key value, which is block number */
+	stup->datum1 = UInt32GetDatum(tuple->tuple.bt_blkno);
+	stup->isnull1 = false;
+}
+
+/*
+ * Routines specialized for GinTuple case
+ *
+ * The comparison of GIN tuples is left to gininsert.c, which knows how the
+ * key is stored in them.
+ */
+
+static int
+comparetup_index_gin(const SortTuple *a, const SortTuple *b,
+					 Tuplesortstate *state)
+{
+	Assert(!a->isnull1 && !b->isnull1);
+
+	return _gin_compare_tuples((GinTuple *) a->tuple,
+							   (GinTuple *) b->tuple,
+							   state->sortKeys);
+}
+
+static void
+writetup_index_gin(Tuplesortstate *state, int tapenum, SortTuple *stup)
+{
+	GinTuple   *tuple = (GinTuple *) stup->tuple;
+	unsigned int tuplen = tuple->tuplen;
+
+	tuplen = tuplen + sizeof(tuplen);
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) &tuplen, sizeof(tuplen));
+	LogicalTapeWrite(state->tapeset, tapenum,
+					 (void *) tuple, tuple->tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeWrite(state->tapeset, tapenum,
+						 (void *) &tuplen, sizeof(tuplen));
+
+	if (!state->slabAllocatorUsed)
+	{
+		FREEMEM(state, GetMemoryChunkSpace(tuple));
+		pfree(tuple);
+	}
+}
+
+static void
+readtup_index_gin(Tuplesortstate *state, SortTuple *stup,
+				  int tapenum, unsigned int len)
+{
+	GinTuple   *tuple;
+	unsigned int tuplen = len - sizeof(unsigned int);
+
+	tuple = (GinTuple *) readtup_alloc(state, tuplen);
+
+	LogicalTapeReadExact(state->tapeset, tapenum,
+						 tuple, tuplen);
+	if (state->randomAccess)	/* need trailing length word? */
+		LogicalTapeReadExact(state->tapeset, tapenum,
+							 &tuplen, sizeof(tuplen));
+	stup->tuple = (void *) tuple;
+
+	/* GIN tuples don't have a leading key value */
+	stup->datum1 = (Datum) 0;
+	stup->isnull1 = false;
+}
+
 /*
  * Routines specialized for DatumTuple case
  */
@@ -4757,3 +5525,48 @@ free_sort_tuple(Tuplesortstate *state, SortTuple *stup)
 	FREEMEM(state, GetMemoryChunkSpace(stup->tuple));
 	pfree(stup->tuple);
 }
+
+/*
+ * Standard comparators for datums that can be compared as integers.  See the
+ * comments above qsort_tuple_unsigned_compare().
+ */
+int
+ssup_datum_unsigned_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	if (x < y)
+		return -1;
+	else if (x > y)
+		return 1;
+	else
+		return 0;
+}
+
+#if SIZEOF_DATUM >= 8
+int
+ssup_datum_signed_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int64		xx = DatumGetInt64(x);
+	int64		yy = DatumGetInt64(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
+#endif
+
+int
+ssup_datum_int32_cmp(Datum x, Datum y, SortSupport ssup)
+{
+	int32		xx = DatumGetInt32(x);
+	int32		yy = DatumGetInt32(y);
+
+	if (xx < yy)
+		return -1;
+	else if (xx > yy)
+		return 1;
+	else
+		return 0;
+}
@@ -203,6 +203,7 @@ static const char *const subdirs[] = {
 	"global",
 	"pg_wal/archive_status",
 	"pg_commit_ts",
+	"pg_dblwr",
 	"pg_dynshmem",
 	"pg_notify",
 	"pg_serial",
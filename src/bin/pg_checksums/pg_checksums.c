@@ -24,6 +24,7 @@
 #include "common/file_perm.h"
 #include "common/file_utils.h"
 #include "common/logging.h"
+#include "common/pagecompress.h"
 #include "getopt_long.h"
 #include "pg_getopt.h"
 #include "storage/bufpage.h"
@@ -191,10 +192,13 @@ static void
 scan_file(const char *fn, BlockNumber segmentno)
 {
 	PGAlignedBlock buf;
-	PageHeader	header = (PageHeader) buf.data;
+	PGAlignedBlock decompressed;
+	static char compressbuf[PAGE_COMPRESS_BUFSIZE];
+	PageHeader	header;
 	int			f;
 	BlockNumber blockno;
 	int			flags;
+	bool		compressed;
 
 	Assert(mode == PG_MODE_ENABLE ||
 		   mode == PG_MODE_CHECK);
@@ -229,11 +233,29 @@ scan_file(const char *fn, BlockNumber segmentno)
 		}
 		blocks++;
 
+		/* A compressed page is checked after decompressing it */
+		compressed = page_is_compressed(buf.data);
+		if (compressed)
+		{
+			if (!page_decompress(buf.data, decompressed.data))
+			{
+				pg_log_error("invalid compressed block %u in file \"%s\"",
+							 blockno, fn);
+				if (mode == PG_MODE_ENABLE)
+					exit(1);
+				badblocks++;
+				continue;
+			}
+			header = (PageHeader) decompressed.data;
+		}
+		else
+			header = (PageHeader) buf.data;
+
 		/* New pages have no checksum yet */
 		if (PageIsNew(header))
 			continue;
 
-		csum = pg_checksum_page(buf.data, blockno + segmentno * RELSEG_SIZE);
+		csum = pg_checksum_page((char *) header, blockno + segmentno * RELSEG_SIZE);
 		current_size += r;
 		if (mode == PG_MODE_CHECK)
 		{
@@ -247,11 +269,28 @@ scan_file(const char *fn, BlockNumber segmentno)
 		}
 		else if (mode == PG_MODE_ENABLE)
 		{
+			char	   *data = (char *) header;
+			int			amount = BLCKSZ;
 			int			w;
 
 			/* Set checksum in page header */
 			header->pd_checksum = csum;
 
+			/*
+			 * Compress a compressed page again, and rewrite only the start of
+			 * its slot, so that the rest of it stays a hole.
+			 */
+			if (compressed)
+			{
+				int			len = page_compress(data, compressbuf);
+
+				if (len > 0)
+				{
+					data = compressbuf;
+					amount = len;
+				}
+			}
+
 			/* Seek back to beginning of block */
 			if (lseek(f, -BLCKSZ, SEEK_CUR) < 0)
 			{
@@ -260,15 +299,22 @@ scan_file(const char *fn, BlockNumber segmentno)
 			}
 
 			/* Write block with checksum */
-			w = write(f, buf.data, BLCKSZ);
-			if (w != BLCKSZ)
+			w = write(f, data, amount);
+			if (w != amount)
 			{
 				if (w < 0)
 					pg_log_error("could not write block %u in file \"%s\": %m",
 								 blockno, fn);
 				else
 					pg_log_error("could not write block %u in file \"%s\": wrote %d of %d",
-								 blockno, fn, w, BLCKSZ);
+								 blockno, fn, w, amount);
+				exit(1);
+			}
+
+			/* Skip the rest of the slot */
+			if (amount < BLCKSZ && lseek(f, BLCKSZ - amount, SEEK_CUR) < 0)
+			{
+				pg_log_error("seek failed for block %u in file \"%s\": %m", blockno, fn);
 				exit(1);
 			}
 		}
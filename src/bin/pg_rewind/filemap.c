@@ -82,6 +82,9 @@ static const char *excludeDirContents[] =
 	/* Contents removed on startup, see DeleteAllExportedSnapshotFiles(). */
 	"pg_snapshots",
 
+	/* Contents removed on startup, see StartupDoubleWrite(). */
+	"pg_dblwr",
+
 	/* Contents zeroed on startup, see StartupSUBTRANS(). */
 	"pg_subtrans",
 
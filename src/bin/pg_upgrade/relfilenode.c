@@ -10,13 +10,16 @@
 #include "postgres_fe.h"
 
 #include <sys/stat.h>
+#include <fcntl.h>
 
 #include "access/transam.h"
 #include "catalog/pg_class_d.h"
+#include "common/file_perm.h"
 #include "pg_upgrade.h"
 
 static void transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace);
 static void transfer_relfile(FileNameMap *map, const char *suffix, bool vm_must_add_frozenbit);
+static void transfer_compress_marker(FileNameMap *map);
 
 
 /*
@@ -169,6 +172,8 @@ transfer_single_new_db(FileNameMap *maps, int size, char *old_tablespace)
 			transfer_relfile(&maps[mapnum], "_fsm", vm_must_add_frozenbit);
 			if (vm_crashsafe_match)
 				transfer_relfile(&maps[mapnum], "_vm", vm_must_add_frozenbit);
+
+			transfer_compress_marker(&maps[mapnum]);
 		}
 	}
 }
@@ -269,3 +274,55 @@ transfer_relfile(FileNameMap *map, const char *type_suffix, bool vm_must_add_fro
 			}
 	}
 }
+
+
+/*
+ * transfer_compress_marker()
+ *
+ * Mark the new relation for page compression if, and only if, the old one
+ * was.  Restoring the schema marked the new relation according to its
+ * tablespace's current page_compression option, which needn't be what it
+ * was when the old relation was created.  The marker is an empty file, so
+ * we just create it.
+ */
+static void
+transfer_compress_marker(FileNameMap *map)
+{
+	char		old_file[MAXPGPATH];
+	char		new_file[MAXPGPATH];
+	struct stat statbuf;
+	int			fd;
+
+	snprintf(old_file, sizeof(old_file), "%s%s/%u/%u_compressed",
+			 map->old_tablespace,
+			 map->old_tablespace_suffix,
+			 map->old_db_oid,
+			 map->old_relfilenode);
+	snprintf(new_file, sizeof(new_file), "%s%s/%u/%u_compressed",
+			 map->new_tablespace,
+			 map->new_tablespace_suffix,
+			 map->new_db_oid,
+			 map->new_relfilenode);
+
+	if (unlink(new_file) != 0 && errno != ENOENT)
+		pg_fatal("error while removing file \"%s\" for \"%s.%s\": %s\n",
+				 new_file, map->nspname, map->relname, strerror(errno));
+
+	if (stat(old_file, &statbuf) != 0)
+	{
+		/* Not marked?  That's OK, just return */
+		if (errno == ENOENT)
+			return;
+		pg_fatal("error while checking for file existence \"%s.%s\" (\"%s\" to \"%s\"): %s\n",
+				 map->nspname, map->relname, old_file, new_file,
+				 strerror(errno));
+	}
+
+	pg_log(PG_VERBOSE, "creating \"%s\"\n", new_file);
+
+	if ((fd = open(new_file, O_RDWR | O_CREAT | O_EXCL | PG_BINARY,
+				   pg_file_create_mode)) < 0)
+		pg_fatal("error while creating file \"%s\" for \"%s.%s\": %s\n",
+				 new_file, map->nspname, map->relname, strerror(errno));
+	close(fd);
+}
@@ -0,0 +1 @@
+../../../src/backend/access/rmgrdesc/undoheapdesc.c
\ No newline at end of file
@@ -0,0 +1,103 @@
+/*-------------------------------------------------------------------------
+ *
+ * pagecompress.c
+ *		Shared frontend/backend code to compress and decompress relation
+ *		pages
+ *
+ * See common/pagecompress.h for a description of the on-disk format.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/common/pagecompress.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FRONTEND
+#include "postgres.h"
+#else
+#include "postgres_fe.h"
+#endif
+
+#include "common/pagecompress.h"
+
+/*
+ * page_compress
+ *
+ * Compresses the BLCKSZ bytes at 'page' into 'dest', which must have room
+ * for PAGE_COMPRESS_BUFSIZE bytes.  Returns the number of bytes at the start
+ * of 'dest' to write in place of the page, which is a multiple of
+ * PAGE_COMPRESS_GRANULE, or -1 if compressing doesn't save at least one
+ * granule.  'dest' is zero-filled after the compressed data up to BLCKSZ,
+ * so that the whole slot can be written too.
+ */
+int
+page_compress(const char *page, char *dest)
+{
+	PageCompressHeader *hdr = (PageCompressHeader *) dest;
+	int32		len;
+	int			total;
+
+	if (BLCKSZ <= PAGE_COMPRESS_GRANULE)
+		return -1;
+
+	len = pglz_compress(page, BLCKSZ, dest + SizeOfPageCompressHeader,
+						PGLZ_strategy_always);
+	if (len < 0)
+		return -1;
+
+	total = TYPEALIGN(PAGE_COMPRESS_GRANULE, SizeOfPageCompressHeader + len);
+	if (total >= BLCKSZ)
+		return -1;
+
+	hdr->magic = PAGE_COMPRESS_MAGIC;
+	hdr->length = len;
+	INIT_CRC32C(hdr->crc);
+	COMP_CRC32C(hdr->crc, dest + SizeOfPageCompressHeader, len);
+	FIN_CRC32C(hdr->crc);
+
+	memset(dest + SizeOfPageCompressHeader + len, 0,
+		   BLCKSZ - (SizeOfPageCompressHeader + len));
+
+	return total;
+}
+
+/*
+ * page_is_compressed
+ *
+ * Does the BLCKSZ bytes read from a block's slot hold a compressed page?
+ */
+bool
+page_is_compressed(const char *block)
+{
+	return ((const PageCompressHeader *) block)->magic == PAGE_COMPRESS_MAGIC;
+}
+
+/*
+ * page_decompress
+ *
+ * Decompresses the block read from a slot that page_is_compressed() accepted
+ * into 'page'.  Returns false if the compressed data is damaged, for example
+ * because its write was interrupted.
+ */
+bool
+page_decompress(const char *block, char *page)
+{
+	const PageCompressHeader *hdr = (const PageCompressHeader *) block;
+	pg_crc32c	crc;
+
+	Assert(page_is_compressed(block));
+
+	if (hdr->length > BLCKSZ - SizeOfPageCompressHeader)
+		return false;
+
+	INIT_CRC32C(crc);
+	COMP_CRC32C(crc, block + SizeOfPageCompressHeader, hdr->length);
+	FIN_CRC32C(crc);
+	if (!EQ_CRC32C(crc, hdr->crc))
+		return false;
+
+	return pglz_decompress(block + SizeOfPageCompressHeader, hdr->length,
+						   page, BLCKSZ, true) == BLCKSZ;
+}
@@ -0,0 +1,256 @@
+/*-------------------------------------------------------------------------
+ *
+ * columnar.h
+ *	  Internal declarations for the columnar table access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/columnar.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/skey.h"
+#include "access/tupdesc.h"
+#include "executor/tuptable.h"
+#include "nodes/bitmapset.h"
+#include "port/atomics.h"
+#include "storage/block.h"
+#include "storage/bufmgr.h"
+#include "storage/itemptr.h"
+#include "storage/relfilenode.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/*
+ * A columnar table consists of a metapage followed by stripes.  A stripe
+ * holds the rows written by one command of one (sub)transaction, up to
+ * COLUMNAR_STRIPE_ROWS of them, and occupies a range of consecutive blocks.
+ * Its contents are a byte stream, laid out over the data area of its pages:
+ * a ColumnarStripeHeader, then a ColumnarChunk for each column of each chunk
+ * group, then the serialized minimum and maximum values of the chunks, then
+ * the chunk data.  A chunk group holds COLUMNAR_CHUNK_ROWS consecutive rows of
+ * the stripe, and each of its chunks holds the values of one column for those
+ * rows, compressed with pglz if that makes them smaller.
+ *
+ * Stripes are never modified once written, except that VACUUM may replace
+ * the inserting transaction's XID in the header by FrozenTransactionId, or by
+ * InvalidTransactionId if the transaction aborted.  The metapage records how
+ * many blocks are in use; blocks beyond that may be left over from a stripe
+ * that was being written at a crash, and are overwritten by the next one.
+ */
+#define COLUMNAR_MAGIC				0x434F4C31	/* "COL1" */
+#define COLUMNAR_VERSION			1
+#define COLUMNAR_METAPAGE_BLKNO		0
+
+#define COLUMNAR_STRIPE_ROWS		150000
+#define COLUMNAR_CHUNK_ROWS			10000
+
+/* Stripes are cut short if their values take more memory than this */
+#define COLUMNAR_STRIPE_MAX_BYTES	(64 * 1024 * 1024)
+
+/* Data area of each page holding stripe data */
+#define COLUMNAR_PAGE_DATA_OFFSET	MAXALIGN(SizeOfPageHeaderData)
+#define COLUMNAR_PAGE_DATA_SIZE		(BLCKSZ - COLUMNAR_PAGE_DATA_OFFSET)
+
+/*
+ * Rows are numbered consecutively over the table, and row number N gets TID
+ * (N / COLUMNAR_ROWS_PER_TID_BLOCK, N % COLUMNAR_ROWS_PER_TID_BLOCK + 1).
+ * These TIDs have nothing to do with physical blocks.
+ */
+#define COLUMNAR_ROWS_PER_TID_BLOCK	MaxHeapTuplesPerPage
+
+typedef struct ColumnarMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	BlockNumber nblocks;		/* blocks in use, including the metapage */
+	uint32		nstripes;		/* number of stripes written */
+	uint64		next_row_number;	/* first row number not yet reserved */
+	uint64		nrows;			/* rows in all stripes, visible or not */
+} ColumnarMetaPageData;
+
+typedef ColumnarMetaPageData *ColumnarMetaPage;
+
+#define ColumnarPageGetMeta(page) \
+	((ColumnarMetaPage) PageGetContents(page))
+
+typedef struct ColumnarStripeHeader
+{
+	uint32		magic;
+	uint32		nblocks;		/* number of blocks the stripe occupies */
+	uint32		size;			/* length of the stripe's byte stream */
+	TransactionId xmin;			/* inserting transaction */
+	CommandId	cid;			/* inserting command */
+	uint32		nrows;			/* number of rows */
+	uint64		first_row;		/* row number of the first row */
+	uint32		nchunks;		/* number of chunk groups */
+	uint32		natts;			/* number of columns stored */
+	uint32		minmax_start;	/* start of serialized minimum and maximum */
+	uint32		data_start;		/* start of chunk data */
+} ColumnarStripeHeader;
+
+/* The chunk directory follows the header */
+#define COLUMNAR_CHUNK_DIR_OFFSET	MAXALIGN(sizeof(ColumnarStripeHeader))
+
+/*
+ * A chunk of column data.  A chunk with size 0 holds only NULLs.  If rawsize
+ * is larger than size, the data is compressed.
+ */
+typedef struct ColumnarChunk
+{
+	uint32		offset;			/* start of data within the stripe */
+	uint32		size;			/* length of stored data */
+	uint32		rawsize;		/* length of uncompressed data */
+	uint32		minmax_offset;	/* start of serialized min and max, or 0 */
+} ColumnarChunk;
+
+#define ColumnarChunkIndex(header, chunkno, attno) \
+	((chunkno) * (header)->natts + (attno) - 1)
+
+/* Number of rows in a chunk group */
+#define columnar_chunk_group_rows(header, chunkno) \
+	Min((header)->nrows - (uint32) (chunkno) * COLUMNAR_CHUNK_ROWS, \
+		COLUMNAR_CHUNK_ROWS)
+
+/* A stripe, as seen by a reader */
+typedef struct ColumnarStripe
+{
+	BlockNumber start;			/* first block */
+	ColumnarStripeHeader header;
+	ColumnarChunk *chunks;		/* chunk directory, or NULL if not read yet */
+	char	   *minmax;			/* minimum and maximum values, or NULL */
+} ColumnarStripe;
+
+/*
+ * State of a scan.  Rows are returned from one chunk group at a time, after
+ * decoding the chunks of the columns that are needed.
+ */
+typedef struct ColumnarScanDescData
+{
+	TableScanDescData rs_base;
+
+	Bitmapset  *cs_attrs;		/* columns to return, or NULL for all */
+	int			cs_nskipkeys;	/* keys for skipping chunk groups */
+	ScanKey		cs_skipkeys;
+
+	BufferAccessStrategy cs_strategy;
+	MemoryContext cs_chunkcxt;	/* holds decoded chunk group */
+
+	List	   *cs_stripes;		/* ColumnarStripes of the table */
+	int			cs_stripeno;	/* index of current stripe in cs_stripes */
+	ColumnarStripe *cs_stripe;	/* current stripe, or NULL */
+	int			cs_chunkno;		/* current chunk group */
+	int			cs_chunkrows;	/* rows in current chunk group */
+	int			cs_rowno;		/* current row within chunk group */
+	Datum	  **cs_values;		/* decoded values, per column */
+	bool	  **cs_isnull;
+
+	uint64		cs_nrows;		/* row numbers in use when scan started */
+
+	/* ANALYZE: range of row numbers mapped to the current block */
+	BlockNumber cs_nblocks;		/* blocks in relation when scan started */
+	uint64		cs_sample_row;
+	uint64		cs_sample_end;
+	ColumnarStripe *cs_sample_stripe;	/* stripe last looked at */
+	int			cs_sample_status;	/* its HTSV_Result, more or less */
+} ColumnarScanDescData;
+
+typedef ColumnarScanDescData *ColumnarScanDesc;
+
+/* Shared state of a parallel scan: stripes are handed out one at a time */
+typedef struct ParallelColumnarScanDescData
+{
+	ParallelTableScanDescData base;
+
+	BlockNumber nblocks;		/* blocks in use when scan started */
+	pg_atomic_uint32 next_stripe;	/* next stripe to hand out */
+} ParallelColumnarScanDescData;
+
+typedef ParallelColumnarScanDescData *ParallelColumnarScanDesc;
+
+/* Rows collected for a stripe, not written out yet */
+typedef struct ColumnarWriteState
+{
+	Oid			relid;
+	RelFileNode relnode;
+	TupleDesc	tupdesc;
+	TransactionId xid;			/* inserting transaction */
+	CommandId	cid;			/* inserting command */
+	SubTransactionId subxid;	/* subtransaction to discard the rows with */
+	uint64		first_row;		/* row number of the first row */
+	uint32		nreserved;		/* row numbers reserved from first_row */
+	uint32		nrows;			/* rows collected */
+	uint32		capacity;		/* size of values/isnull arrays */
+	Datum	  **values;			/* values, per column */
+	bool	  **isnull;
+	MemoryContext cxt;			/* holds this struct and the arrays */
+	MemoryContext rowcxt;		/* holds copies of pass-by-reference values */
+} ColumnarWriteState;
+
+/* columnar_storage.c */
+extern void columnar_read_meta(Relation rel, ColumnarMetaPageData *meta);
+extern uint64 columnar_reserve_rows(Relation rel, uint32 nrows);
+extern void columnar_write_stripe(Relation rel, char *data);
+extern void columnar_read_bytes(Relation rel, BlockNumber start,
+								uint32 offset, char *dest, uint32 len,
+								BufferAccessStrategy strategy);
+extern List *columnar_read_stripes(Relation rel, BlockNumber nblocks,
+								   BufferAccessStrategy strategy);
+extern void columnar_read_chunk_directory(Relation rel, ColumnarStripe *stripe,
+										  bool minmax,
+										  BufferAccessStrategy strategy);
+extern void columnar_set_stripe_xmin(Relation rel, BlockNumber start,
+									 TransactionId xmin);
+extern bool columnar_stripe_visible(ColumnarStripeHeader *header,
+									Snapshot snapshot);
+
+static inline void
+columnar_row_to_tid(uint64 rownum, ItemPointer tid)
+{
+	ItemPointerSet(tid, (BlockNumber) (rownum / COLUMNAR_ROWS_PER_TID_BLOCK),
+				   (OffsetNumber) (rownum % COLUMNAR_ROWS_PER_TID_BLOCK + 1));
+}
+
+static inline uint64
+columnar_tid_to_row(ItemPointer tid)
+{
+	return (uint64) ItemPointerGetBlockNumber(tid) * COLUMNAR_ROWS_PER_TID_BLOCK +
+		ItemPointerGetOffsetNumber(tid) - 1;
+}
+
+/* columnar_write.c */
+extern ColumnarWriteState *columnar_begin_write(Relation rel,
+												TransactionId xid,
+												CommandId cid);
+extern uint64 columnar_append_row(Relation rel, ColumnarWriteState *state,
+								  Datum *values, bool *isnull);
+extern void columnar_flush_write(Relation rel, ColumnarWriteState *state);
+extern void columnar_end_write(ColumnarWriteState *state);
+extern void columnar_insert_row(Relation rel, TupleTableSlot *slot,
+								CommandId cid);
+extern void columnar_flush_pending(Relation rel);
+extern void columnar_discard_pending(Relation rel);
+extern ColumnarWriteState *columnar_find_pending(Relation rel);
+
+/* columnar_read.c */
+extern bool columnar_chunk_group_matches(ColumnarStripe *stripe, int chunkno,
+										 TupleDesc tupdesc, int nkeys,
+										 ScanKey keys);
+extern void columnar_decode_chunk_group(Relation rel, ColumnarStripe *stripe,
+										int chunkno, Bitmapset *attrs,
+										Datum **values, bool **isnull,
+										BufferAccessStrategy strategy);
+extern void columnar_store_row(TupleTableSlot *slot, ColumnarStripe *stripe,
+							   int chunkno, int rowno,
+							   Datum **values, bool **isnull);
+extern ColumnarStripe *columnar_find_stripe(List *stripes, uint64 rownum);
+extern int	columnar_stripe_cmp(const ListCell *a, const ListCell *b);
+
+#endif							/* COLUMNAR_H */
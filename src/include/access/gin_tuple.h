@@ -0,0 +1,53 @@
+/*--------------------------------------------------------------------------
+ * gin_tuple.h
+ *	  Definitions of the tuples GIN passes through tuplesort during a
+ *	  parallel index build.
+ *
+ *	Copyright (c) 2006-2020, PostgreSQL Global Development Group
+ *
+ *	src/include/access/gin_tuple.h
+ *--------------------------------------------------------------------------
+ */
+#ifndef GIN_TUPLE_H
+#define GIN_TUPLE_H
+
+#include "access/ginblock.h"
+#include "storage/itemptr.h"
+#include "utils/sortsupport.h"
+
+/*
+ * Each participant of a parallel GIN build turns its accumulated entries into
+ * GinTuples: one key of one index column (or a NULL category), plus a sorted
+ * array of heap TIDs containing that key.  The key value is stored at the
+ * first MAXALIGN'd offset after the header, so that pass-by-reference keys
+ * can be used in place, and the TIDs follow at the next SHORTALIGN'd offset.
+ */
+typedef struct GinTuple
+{
+	int			tuplen;			/* length of the whole tuple */
+	OffsetNumber attrnum;		/* attnum of index key */
+	int16		typlen;			/* typlen of the key */
+	bool		typbyval;		/* typbyval of the key */
+	signed char category;		/* category: normal or NULL? */
+	int			keylen;			/* bytes in data for the key value */
+	int			nitems;			/* number of TIDs in the data */
+	char		data[FLEXIBLE_ARRAY_MEMBER];
+} GinTuple;
+
+#define SizeOfGinTupleHeader	MAXALIGN(offsetof(GinTuple, data))
+
+static inline char *
+GinTupleGetKey(GinTuple *tup)
+{
+	return (char *) tup + SizeOfGinTupleHeader;
+}
+
+static inline ItemPointer
+GinTupleGetFirst(GinTuple *tup)
+{
+	return (ItemPointer) (GinTupleGetKey(tup) + SHORTALIGN(tup->keylen));
+}
+
+extern int	_gin_compare_tuples(GinTuple *a, GinTuple *b, SortSupport ssup);
+
+#endif							/* GIN_TUPLE_H */
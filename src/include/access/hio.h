@@ -30,6 +30,17 @@ typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+
+	/*
+	 * Pages of reserved_rel reserved for this bulk insert when it last
+	 * extended that relation, next_free to last_free inclusive, and the
+	 * number of pages it has added to the relation so far.  See
+	 * RelationAddBlocks.
+	 */
+	Relation	reserved_rel;
+	BlockNumber next_free;
+	BlockNumber last_free;
+	uint32		already_extended_by;
 } BulkInsertStateData;
 
 
@@ -39,5 +50,6 @@ extern Buffer RelationGetBufferForTuple(Relation relation, Size len,
 										Buffer otherBuffer, int options,
 										BulkInsertStateData *bistate,
 										Buffer *vmbuffer, Buffer *vmbuffer_other);
+extern void BulkInsertStateReleaseReserved(BulkInsertStateData *bistate);
 
 #endif							/* HIO_H */
@@ -128,6 +128,24 @@ typedef struct TM_FailureData
 	bool		traversed;
 } TM_FailureData;
 
+/*
+ * On success, table_tuple_update fills in this struct to tell the caller
+ * which index entries the new tuple version needs.
+ *
+ * If required is false, the indexes need no new entries at all (a HOT
+ * update).  Otherwise, if modified_attrs is NULL, all indexes need one,
+ * pointing to the new tuple's TID.  If modified_attrs is not NULL (a WARM
+ * update), only the indexes on any of those columns need one (attribute
+ * numbers are offset by FirstLowInvalidHeapAttributeNumber), and it must
+ * point to root_tid instead.  The caller should bms_free modified_attrs.
+ */
+typedef struct TU_IndexUpdate
+{
+	bool		required;
+	Bitmapset  *modified_attrs;
+	ItemPointerData root_tid;
+} TU_IndexUpdate;
+
 /* "options" flag bits for table_tuple_insert */
 /* TABLE_INSERT_SKIP_WAL was 0x0001; RelationNeedsWAL() now governs */
 #define TABLE_INSERT_SKIP_FSM		0x0002
@@ -225,6 +243,23 @@ typedef struct TableAmRoutine
 									 ScanDirection direction,
 									 TupleTableSlot *slot);
 
+	/*
+	 * Optional callback, for AMs that can do less work when they know more
+	 * about what a scan is used for.  Called right after scan_begin, before
+	 * any tuples are fetched.
+	 *
+	 * `attrs` holds the numbers of the columns the caller will look at, or
+	 * is NULL if it may look at any of them; the AM may return NULL for the
+	 * other columns.  Tuples failing any of the `nkeys` keys in `keys` will
+	 * be thrown away by the caller, so the AM may skip them, but it doesn't
+	 * need to check the keys itself.  The keys compare a column to a
+	 * constant with an operator of the column type's default btree operator
+	 * family, with the key's sk_strategy set to the operator's strategy
+	 * number, which is never BTEqualStrategyNumber.
+	 */
+	void		(*scan_set_hints) (TableScanDesc scan, Bitmapset *attrs,
+								   int nkeys, struct ScanKeyData *keys);
+
 
 	/* ------------------------------------------------------------------------
 	 * Parallel table scan related functions.
@@ -396,7 +431,7 @@ typedef struct TableAmRoutine
 								 bool wait,
 								 TM_FailureData *tmfd,
 								 LockTupleMode *lockmode,
-								 bool *update_indexes);
+								 TU_IndexUpdate *update_indexes);
 
 	/* see table_tuple_lock() for reference about parameters */
 	TM_Result	(*tuple_lock) (Relation rel,
@@ -892,6 +927,18 @@ table_rescan_set_params(TableScanDesc scan, struct ScanKeyData *key,
 										 allow_pagemode);
 }
 
+/*
+ * Tell the scan which columns and tuples the caller is interested in, see
+ * scan_set_hints.  Does nothing if the AM doesn't make use of that.
+ */
+static inline void
+table_scan_set_hints(TableScanDesc scan, Bitmapset *attrs,
+					 int nkeys, struct ScanKeyData *keys)
+{
+	if (scan->rs_rd->rd_tableam->scan_set_hints != NULL)
+		scan->rs_rd->rd_tableam->scan_set_hints(scan, attrs, nkeys, keys);
+}
+
 /*
  * Update snapshot used by the scan.
  */
@@ -1019,6 +1066,10 @@ table_index_fetch_end(struct IndexFetchTableData *scan)
  * entry (like heap's HOT). Whereas table_tuple_fetch_row_version() only
  * evaluates the tuple exactly at `tid`. Outside of index entry ->table tuple
  * lookups, table_tuple_fetch_row_version() is what's usually needed.
+ *
+ * If those row versions need not all have the same index keys (like after
+ * heap's WARM updates), the AM sets scan->recheck_key when returning a
+ * tuple, and the caller must check that the tuple matches the index entry.
  */
 static inline bool
 table_index_fetch_tuple(struct IndexFetchTableData *scan,
@@ -1290,8 +1341,8 @@ table_tuple_delete(Relation rel, ItemPointer tid, CommandId cid,
  * Output parameters:
  *	tmfd - filled in failure cases (see below)
  *	lockmode - filled with lock mode acquired on tuple
- *  update_indexes - in success cases this is set to true if new index entries
- *		are required for this tuple
+ *	update_indexes - in success cases this is filled with the index entries
+ *		required for this tuple, see TU_IndexUpdate
  *
  * Normal, successful return value is TM_Ok, which means we did actually
  * update it.  Failure return codes are TM_SelfModified, TM_Updated, and
@@ -1311,7 +1362,7 @@ static inline TM_Result
 table_tuple_update(Relation rel, ItemPointer otid, TupleTableSlot *slot,
 				   CommandId cid, Snapshot snapshot, Snapshot crosscheck,
 				   bool wait, TM_FailureData *tmfd, LockTupleMode *lockmode,
-				   bool *update_indexes)
+				   TU_IndexUpdate *update_indexes)
 {
 	return rel->rd_tableam->tuple_update(rel, otid, slot,
 										 cid, snapshot, crosscheck,
@@ -1834,7 +1885,7 @@ extern void simple_table_tuple_delete(Relation rel, ItemPointer tid,
 									  Snapshot snapshot);
 extern void simple_table_tuple_update(Relation rel, ItemPointer otid,
 									  TupleTableSlot *slot, Snapshot snapshot,
-									  bool *update_indexes);
+									  TU_IndexUpdate *update_indexes);
 
 
 /* ----------------------------------------------------------------------------
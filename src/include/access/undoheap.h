@@ -0,0 +1,237 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheap.h
+ *	  Internal declarations for the undo heap table access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/undoheap.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef UNDOHEAP_H
+#define UNDOHEAP_H
+
+#include "access/htup_details.h"
+#include "access/relscan.h"
+#include "access/tableam.h"
+#include "commands/vacuum.h"
+#include "lib/stringinfo.h"
+#include "storage/bufmgr.h"
+#include "storage/bufpage.h"
+#include "storage/itemptr.h"
+#include "utils/relcache.h"
+#include "utils/snapshot.h"
+
+/*
+ * An undo heap relation's main fork holds four kinds of pages, told apart by
+ * the type in their special space: the metapage (always block 0), data pages
+ * holding the current version of each tuple, undo pages holding the undo log,
+ * and free pages that were released by undo discard and can be reused as
+ * either of the last two.  See src/backend/access/undoheap/README.
+ */
+#define UNDOHEAP_METAPAGE_BLKNO		0
+#define UNDOHEAP_MAGIC				0x554E4431	/* "UND1" */
+#define UNDOHEAP_VERSION			1
+
+#define UNDOHEAP_PAGE_META			1
+#define UNDOHEAP_PAGE_DATA			2
+#define UNDOHEAP_PAGE_UNDO			3
+#define UNDOHEAP_PAGE_FREE			4
+
+typedef struct UndoHeapPageOpaqueData
+{
+	BlockNumber next;			/* undo pages: next page of the undo log;
+								 * free pages: next page of the free list */
+	uint16		type;			/* UNDOHEAP_PAGE_* */
+	uint16		unused;
+} UndoHeapPageOpaqueData;
+
+typedef UndoHeapPageOpaqueData *UndoHeapPageOpaque;
+
+#define UndoHeapPageGetOpaque(page) \
+	((UndoHeapPageOpaque) PageGetSpecialPointer(page))
+
+/*
+ * An all-zeroes page can be left behind by a crash just after the relation
+ * was extended; it is treated as an empty data page.
+ */
+#define UndoHeapPageIsData(page) \
+	(PageIsNew(page) || UndoHeapPageGetOpaque(page)->type == UNDOHEAP_PAGE_DATA)
+
+typedef struct UndoHeapMetaPageData
+{
+	uint32		magic;
+	uint32		version;
+	BlockNumber undo_head;		/* oldest page of the undo log */
+	BlockNumber undo_tail;		/* page new undo records are added to */
+	BlockNumber free_head;		/* first page of the free list */
+} UndoHeapMetaPageData;
+
+#define UndoHeapPageGetMeta(page) \
+	((UndoHeapMetaPageData *) PageGetContents(page))
+
+/*
+ * Tuples use the heap tuple format, but some header fields mean something
+ * different:
+ *
+ * t_xmin is the transaction that inserted the tuple or last updated it in
+ * place, and t_cid is that transaction's command ID.  t_xmax is set by a
+ * deletion, or by a row lock if UNDOHEAP_XMAX_LOCK_ONLY is also set.  A
+ * deletion overwrites t_cid with the deleting command's ID, a row lock
+ * doesn't.  UNDOHEAP_XMAX_MOVED marks a deletion done by an UPDATE that
+ * stored the new version elsewhere.
+ *
+ * t_ctid doesn't point to a newer version; it points to the undo record that
+ * holds the tuple's state before the last insert, update or deletion (row
+ * locks don't write undo).  Following those pointers gives the chain of older
+ * versions that readers use when the last change isn't visible to them.
+ */
+#define UNDOHEAP_XMAX_LOCK_ONLY		HEAP_XMAX_LOCK_ONLY
+#define UNDOHEAP_XMAX_MOVED			HEAP_UPDATED
+
+#define UndoHeapTupleIsDeleted(tup) \
+	(TransactionIdIsValid(HeapTupleHeaderGetRawXmax(tup)) && \
+	 ((tup)->t_infomask & UNDOHEAP_XMAX_LOCK_ONLY) == 0)
+
+#define UndoHeapTupleIsLocked(tup) \
+	(TransactionIdIsValid(HeapTupleHeaderGetRawXmax(tup)) && \
+	 ((tup)->t_infomask & UNDOHEAP_XMAX_LOCK_ONLY) != 0)
+
+/* The transaction that made the change the tuple's undo pointer undoes */
+#define UndoHeapTupleGetLastXid(tup) \
+	(UndoHeapTupleIsDeleted(tup) ? \
+	 HeapTupleHeaderGetRawXmax(tup) : HeapTupleHeaderGetRawXmin(tup))
+
+/*
+ * Undo records are items on undo pages, and are addressed by an item pointer.
+ * The record header is followed by the tuple's previous contents: the whole
+ * tuple for UNDO_UPDATE, only the fixed-size tuple header for UNDO_DELETE and
+ * UNDO_MOVE, and nothing for UNDO_INSERT.
+ */
+#define UNDO_INSERT					1
+#define UNDO_UPDATE					2
+#define UNDO_DELETE					3
+#define UNDO_MOVE					4
+
+typedef struct UndoRecordData
+{
+	TransactionId ur_xid;		/* transaction that made the change */
+	BlockNumber ur_blkno;		/* the tuple that was changed */
+	OffsetNumber ur_offnum;
+	uint8		ur_type;		/* UNDO_* */
+	ItemPointerData ur_newtid;	/* UNDO_MOVE: where the new version is */
+} UndoRecordData;
+
+typedef UndoRecordData *UndoRecord;
+
+#define SizeOfUndoRecord			MAXALIGN(sizeof(UndoRecordData))
+#define UndoRecordGetImage(rec)		((char *) (rec) + SizeOfUndoRecord)
+
+/* The largest tuple that fits on a data page */
+#define UndoHeapMaxTupleSize \
+	(BLCKSZ - MAXALIGN(SizeOfPageHeaderData + sizeof(ItemIdData)) - \
+	 MAXALIGN(sizeof(UndoHeapPageOpaqueData)))
+
+/* Larger tuples are not updated in place, their old version wouldn't fit */
+#define UndoHeapMaxInPlaceSize		(UndoHeapMaxTupleSize - SizeOfUndoRecord)
+
+/* Operations on a data page line pointer, applied in do and redo alike */
+#define UNDOHEAP_OP_SET_TUPLE		1	/* replace or add the whole tuple */
+#define UNDOHEAP_OP_SET_HEADER		2	/* replace the fixed-size header */
+#define UNDOHEAP_OP_SET_DEAD		3
+#define UNDOHEAP_OP_SET_UNUSED		4
+
+typedef struct UndoHeapScanDescData
+{
+	TableScanDescData rs_base;
+
+	BlockNumber rs_nblocks;		/* total number of blocks in rel */
+	BlockNumber rs_startblock;	/* block # to start at */
+	BlockNumber rs_numblocks;	/* max number of blocks to scan */
+	BufferAccessStrategy rs_strategy;	/* access strategy for reads */
+
+	bool		rs_inited;		/* false = scan not init'd yet */
+	BlockNumber rs_cblock;		/* current block # in scan, if any */
+
+	/* parallel scan information, if any */
+	ParallelBlockTableScanWorkerData *rs_parallelworkerdata;
+
+	/*
+	 * Copies of the tuples of the current page that the scan returns, kept in
+	 * rs_pagecxt.  Tuples are copied out while holding the buffer lock,
+	 * because in-place updates may overwrite them as soon as it's released.
+	 */
+	MemoryContext rs_pagecxt;
+	int			rs_cindex;		/* current tuple's index in rs_tuples */
+	int			rs_ntuples;		/* number of tuples on page */
+	int			rs_ndead;		/* dead tuples on page, for ANALYZE */
+	OffsetNumber rs_maxoff;		/* max offset on page, for sample scans */
+	HeapTuple	rs_tuples[MaxHeapTuplesPerPage];
+	bool		rs_alive[MaxHeapTuplesPerPage]; /* tuple isn't being deleted */
+
+	/* set if an old version differs from the current one, for index builds */
+	bool		rs_recently_updated;
+} UndoHeapScanDescData;
+
+typedef UndoHeapScanDescData *UndoHeapScanDesc;
+
+typedef struct IndexFetchUndoHeapData
+{
+	IndexFetchTableData xs_base;	/* AM independent part of the descriptor */
+
+	Buffer		xs_cbuf;		/* current data buffer in scan, if any */
+} IndexFetchUndoHeapData;
+
+/* in undoheap/undoheapam.c */
+extern HeapTuple undoheap_get_version(Relation rel, Buffer buffer,
+									  OffsetNumber offnum, Snapshot snapshot);
+extern bool undoheap_xid_aborted(TransactionId xid);
+extern void undoheap_rollback_aborted(Relation rel, Buffer buffer,
+									  OffsetNumber offnum);
+extern void undoheap_add_op(StringInfo ops, OffsetNumber offnum, uint16 op,
+							char *data, uint32 len);
+extern void undoheap_page_apply_ops(Page page, char *ops, Size len);
+extern OffsetNumber undoheap_apply_ops(Relation rel, uint8 info, Buffer buffer,
+									   StringInfo ops, int nops,
+									   TransactionId latestRemovedXid,
+									   Buffer undobuf, UndoRecord rec,
+									   Size reclen);
+extern uint16 undoheap_dead_op(Relation rel);
+extern Buffer undoheap_get_buffer_for_tuple(Relation rel, Size len);
+extern void undoheap_insert(Relation rel, HeapTuple tup, CommandId cid,
+							int options);
+extern void undoheap_insert_raw(Relation rel, HeapTuple tup);
+extern TM_Result undoheap_delete(Relation rel, ItemPointer tid, CommandId cid,
+								 Snapshot snapshot, Snapshot crosscheck,
+								 bool wait, TM_FailureData *tmfd);
+extern TM_Result undoheap_update(Relation rel, ItemPointer otid,
+								 HeapTuple newtup, CommandId cid,
+								 Snapshot snapshot, Snapshot crosscheck,
+								 bool wait, TM_FailureData *tmfd,
+								 bool *update_indexes);
+extern TM_Result undoheap_lock_tuple(Relation rel, ItemPointer tid,
+									 Snapshot snapshot, CommandId cid,
+									 LockWaitPolicy wait_policy, uint8 flags,
+									 HeapTuple *tuple, TM_FailureData *tmfd);
+extern void undoheap_kill_tuple(Relation rel, ItemPointer tid);
+extern void undoheap_page_prune(Relation rel, Buffer buffer);
+
+/* in undoheap/undolog.c */
+extern void undoheap_init_page(Page page, uint16 type, BlockNumber next);
+extern void undoheap_create_metapage(Relation rel);
+extern void undoheap_read_meta(Relation rel, UndoHeapMetaPageData *meta);
+extern Buffer undoheap_new_page(Relation rel, uint16 type);
+extern Buffer undoheap_reserve_undo(Relation rel, Size len, bool *extended);
+extern UndoRecord undoheap_read_undo(Relation rel, ItemPointer undoptr,
+									 Size *len);
+extern BlockNumber undoheap_discard(Relation rel, bool wait,
+									TransactionId *oldest_xid);
+
+/* in undoheap/undoheap_vacuum.c */
+extern void undoheap_vacuum_rel(Relation rel, VacuumParams *params,
+								BufferAccessStrategy bstrategy);
+
+#endif							/* UNDOHEAP_H */
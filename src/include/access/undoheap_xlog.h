@@ -0,0 +1,90 @@
+/*-------------------------------------------------------------------------
+ *
+ * undoheap_xlog.h
+ *	  WAL record definitions for the undo heap table access method.
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/undoheap_xlog.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef UNDOHEAP_XLOG_H
+#define UNDOHEAP_XLOG_H
+
+#include "access/xlogreader.h"
+#include "lib/stringinfo.h"
+#include "storage/block.h"
+#include "storage/off.h"
+
+/*
+ * XLOG allows to store some information in high 4 bits of log record xl_info
+ * field.  We use 3 for the opcode and one for the init bit.
+ */
+#define XLOG_UNDOHEAP_INSERT		0x00
+#define XLOG_UNDOHEAP_UPDATE		0x10
+#define XLOG_UNDOHEAP_DELETE		0x20
+#define XLOG_UNDOHEAP_LOCK			0x30
+#define XLOG_UNDOHEAP_ROLLBACK		0x40
+#define XLOG_UNDOHEAP_CLEAN			0x50
+#define XLOG_UNDOHEAP_META			0x60
+#define XLOG_UNDOHEAP_DISCARD		0x70
+
+#define XLOG_UNDOHEAP_OPMASK		0x70
+
+/*
+ * When we insert 1st item on new page in INSERT, we can (and we do) restore
+ * entire page in redo.
+ */
+#define XLOG_UNDOHEAP_INIT_PAGE		0x80
+
+/*
+ * All records but XLOG_UNDOHEAP_META and XLOG_UNDOHEAP_DISCARD change line
+ * pointers of one data page, registered as block 0.  Its data is a series of
+ * xl_undoheap_op, each followed by 'len' bytes.  If the change wrote an undo
+ * record, the undo page is registered as block 1, with the record as data.
+ */
+typedef struct xl_undoheap_modify
+{
+	TransactionId latestRemovedXid; /* for recovery conflicts, or invalid */
+	OffsetNumber undo_offnum;	/* offset of the new undo record */
+	uint16		nops;			/* number of xl_undoheap_op in block 0 */
+} xl_undoheap_modify;
+
+#define SizeOfUndoHeapModify	(offsetof(xl_undoheap_modify, nops) + sizeof(uint16))
+
+typedef struct xl_undoheap_op
+{
+	OffsetNumber offnum;
+	uint16		op;				/* UNDOHEAP_OP_* */
+	uint32		len;
+} xl_undoheap_op;
+
+/*
+ * XLOG_UNDOHEAP_META and XLOG_UNDOHEAP_DISCARD rewrite the metapage, which is
+ * block 0 with the new UndoHeapMetaPageData as data.  They can also
+ * initialize a page (block 1), and set the next-page link of another one
+ * (block 2).
+ */
+#define XLU_INIT_PAGE			0x01
+#define XLU_LINK_PAGE			0x02
+
+typedef struct xl_undoheap_meta
+{
+	TransactionId latestRemovedXid; /* for recovery conflicts, or invalid */
+	BlockNumber init_next;		/* next-page link of the initialized page */
+	BlockNumber link_next;		/* new next-page link of block 2 */
+	uint16		init_type;		/* page type of the initialized page */
+	uint8		flags;
+} xl_undoheap_meta;
+
+#define SizeOfUndoHeapMeta	(offsetof(xl_undoheap_meta, flags) + sizeof(uint8))
+
+extern void undoheap_redo(XLogReaderState *record);
+extern void undoheap_desc(StringInfo buf, XLogReaderState *record);
+extern const char *undoheap_identify(uint8 info);
+extern void undoheap_mask(char *pagedata, BlockNumber blkno);
+
+#endif							/* UNDOHEAP_XLOG_H */
@@ -30,10 +30,14 @@
 #define XLOG_SMGR_CREATE	0x10
 #define XLOG_SMGR_TRUNCATE	0x20
 
+/* flags for xl_smgr_create */
+#define SMGR_CREATE_COMPRESSED	0x0001	/* mark for page compression */
+
 typedef struct xl_smgr_create
 {
 	RelFileNode rnode;
 	ForkNumber	forkNum;
+	int			flags;
 } xl_smgr_create;
 
 /* flags for xl_smgr_truncate */
@@ -50,7 +54,8 @@ typedef struct xl_smgr_truncate
 	int			flags;
 } xl_smgr_truncate;
 
-extern void log_smgrcreate(const RelFileNode *rnode, ForkNumber forkNum);
+extern void log_smgrcreate(const RelFileNode *rnode, ForkNumber forkNum,
+						   int flags);
 
 extern void smgr_redo(XLogReaderState *record);
 extern void smgr_desc(StringInfo buf, XLogReaderState *record);
@@ -15,6 +15,7 @@
 #define CREATEAS_H
 
 #include "catalog/objectaddress.h"
+#include "executor/execdesc.h"
 #include "nodes/params.h"
 #include "parser/parse_node.h"
 #include "tcop/dest.h"
@@ -28,5 +29,8 @@ extern ObjectAddress ExecCreateTableAs(ParseState *pstate, CreateTableAsStmt *st
 extern int	GetIntoRelEFlags(IntoClause *intoClause);
 
 extern DestReceiver *CreateIntoRelDestReceiver(IntoClause *intoClause);
+extern DestReceiver *CreateParallelIntoRelDestReceiver(Oid relid);
+extern Oid	GetIntoRelOid(DestReceiver *self);
+extern void SetupParallelIntoRel(QueryDesc *queryDesc);
 
 #endif							/* CREATEAS_H */
@@ -20,7 +20,9 @@
 #include "catalog/pg_type.h"
 #include "parser/parse_node.h"
 #include "storage/buf.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
+#include "storage/shm_toc.h"
 #include "utils/relcache.h"
 
 /*
@@ -225,8 +227,8 @@ typedef struct VacuumParams
 
 	/*
 	 * The number of parallel vacuum workers.  0 by default which means choose
-	 * based on the number of indexes.  -1 indicates parallel vacuum is
-	 * disabled.
+	 * based on the number of indexes (for ANALYZE, based on the size of the
+	 * sample).  -1 indicates parallel vacuum is disabled.
 	 */
 	int			nworkers;
 } VacuumParams;
@@ -284,6 +286,7 @@ extern void analyze_rel(Oid relid, RangeVar *relation,
 						VacuumParams *params, List *va_cols, bool in_outer_xact,
 						BufferAccessStrategy bstrategy);
 extern bool std_typanalyze(VacAttrStats *stats);
+extern void parallel_analyze_main(dsm_segment *seg, shm_toc *toc);
 
 /* in utils/misc/sampling.c --- duplicate of declarations in utils/sampling.h */
 extern double anl_random_fract(void);
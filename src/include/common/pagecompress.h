@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * pagecompress.h
+ *		On-disk format of compressed relation pages
+ *
+ * A relation stored with page compression keeps the usual layout of one
+ * BLCKSZ slot per block in its segment files, but a block whose contents
+ * compress well enough is stored as a PageCompressHeader followed by the
+ * compressed page at the start of its slot.  The rest of the slot is left
+ * as a hole in the file, so the file system doesn't need to store it.
+ * Blocks that don't compress well are stored as is, so a reader tells the
+ * two apart by the header.
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/common/pagecompress.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef PAGECOMPRESS_H
+#define PAGECOMPRESS_H
+
+#include "common/pg_lzcompress.h"
+#include "port/pg_crc32c.h"
+
+/*
+ * The magic number overlays the high half of pd_lsn of an uncompressed
+ * page, which no real WAL position will reach.
+ */
+#define PAGE_COMPRESS_MAGIC		0x9E7A5C01
+
+typedef struct PageCompressHeader
+{
+	uint32		magic;			/* PAGE_COMPRESS_MAGIC */
+	uint32		length;			/* length of the compressed data */
+	pg_crc32c	crc;			/* CRC of the compressed data */
+} PageCompressHeader;
+
+#define SizeOfPageCompressHeader	sizeof(PageCompressHeader)
+
+/*
+ * Space is only given back to the file system in units of its block size.
+ * We assume it's this much, and compress a page only if that frees at least
+ * one such unit.
+ */
+#define PAGE_COMPRESS_GRANULE	4096
+
+/* size of the output buffer that page_compress() needs */
+#define PAGE_COMPRESS_BUFSIZE	(SizeOfPageCompressHeader + PGLZ_MAX_OUTPUT(BLCKSZ))
+
+extern int	page_compress(const char *page, char *dest);
+extern bool page_is_compressed(const char *block);
+extern bool page_decompress(const char *block, char *page);
+
+#endif							/* PAGECOMPRESS_H */
@@ -64,6 +64,9 @@ typedef enum ExprEvalOp
 	/* compute wholerow Var */
 	EEOP_WHOLEROW,
 
+	/* replace a just-fetched toasted Var value by a detoasted copy */
+	EEOP_VAR_DETOAST,
+
 	/*
 	 * Compute non-system Var value, assign it into ExprState's resultslot.
 	 * These are not used if a CheckVarSlotCompatibility() check would be
@@ -219,6 +222,18 @@ typedef enum ExprEvalOp
 	EEOP_WINDOW_FUNC,
 	EEOP_SUBPLAN,
 
+	/* start a new row for the common subexpression values */
+	EEOP_CSE_RESET,
+
+	/* note that the qual sharing common subexpression values has passed */
+	EEOP_CSE_MARK_FRESH,
+
+	/* return a common subexpression's value, if already computed */
+	EEOP_CSE_FETCH,
+
+	/* remember a common subexpression's value */
+	EEOP_CSE_STORE,
+
 	/* aggregation related nodes */
 	EEOP_AGG_STRICT_DESERIALIZE,
 	EEOP_AGG_DESERIALIZE,
@@ -588,6 +603,33 @@ typedef struct ExprEvalStep
 			SubPlanState *sstate;
 		}			subplan;
 
+		/* for EEOP_VAR_DETOAST */
+		struct
+		{
+			/* attnum is attr number - 1 for regular VAR */
+			int			attnum;
+			/* INNER_VAR, OUTER_VAR, or anything else for the scan tuple */
+			int			varno;
+		}			var_detoast;
+
+		/* for EEOP_CSE_RESET / CSE_MARK_FRESH */
+		struct
+		{
+			struct ExprCSECache *cache;
+			/* RESET: keep values computed by a qual that just passed? */
+			bool		keep_fresh;
+		}			cse_reset;
+
+		/* for EEOP_CSE_FETCH / CSE_STORE */
+		struct
+		{
+			struct ExprCSECache *cache;
+			int			cseno;	/* index of subexpression in cache */
+			int16		typlen; /* typlen of its result type */
+			/* FETCH: jump here if the value is available */
+			int			jumpdone;
+		}			cse;
+
 		/* for EEOP_AGG_*DESERIALIZE */
 		struct
 		{
@@ -672,6 +714,31 @@ typedef struct SubscriptingRefState
 } SubscriptingRefState;
 
 
+/*
+ * Values of the common subexpressions of an expression, that is, identical
+ * immutable subexpressions that occur more than once.  The first occurrence
+ * evaluated for a row computes the value and stores it here; the other
+ * occurrences just fetch it.  A value is valid only if it was computed in the
+ * current generation, which is advanced once per row by EEOP_CSE_RESET.
+ *
+ * A plan node's qual and projection share a cache, so that subexpressions of
+ * the targetlist that the qual has already computed needn't be computed
+ * again.  The projection only keeps the qual's values if "fresh" says that
+ * the qual has just passed, i.e. for the same row.
+ */
+typedef struct ExprCSECache
+{
+	int			ncse;			/* number of common subexpressions */
+	Expr	  **exprs;			/* the subexpressions */
+	bool	   *compiling;		/* is subexpression being compiled? */
+	Datum	   *values;			/* their values ... */
+	bool	   *nulls;			/* ... and null flags */
+	uint64	   *generations;	/* generation each value was computed in */
+	uint64		generation;		/* current generation */
+	bool		fresh;			/* has a sharing qual just passed? */
+} ExprCSECache;
+
+
 /* functions in execExpr.c */
 extern void ExprEvalPushStep(ExprState *es, const ExprEvalStep *s);
 
@@ -726,8 +793,14 @@ extern void ExecEvalXmlExpr(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalGroupingFunc(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalSubPlan(ExprState *state, ExprEvalStep *op,
 							ExprContext *econtext);
+extern void ExecEvalCSEReset(ExprState *state, ExprEvalStep *op);
+extern void ExecEvalCSEMarkFresh(ExprState *state, ExprEvalStep *op);
+extern bool ExecEvalCSEFetch(ExprState *state, ExprEvalStep *op);
+extern void ExecEvalCSEStore(ExprState *state, ExprEvalStep *op);
 extern void ExecEvalWholeRowVar(ExprState *state, ExprEvalStep *op,
 								ExprContext *econtext);
+extern void ExecEvalVarDetoast(ExprState *state, ExprEvalStep *op,
+							   ExprContext *econtext);
 extern void ExecEvalSysVar(ExprState *state, ExprEvalStep *op,
 						   ExprContext *econtext, TupleTableSlot *slot);
 
@@ -125,5 +125,8 @@ extern PartitionPruneState *ExecCreatePartitionPruneState(PlanState *planstate,
 extern Bitmapset *ExecFindMatchingSubPlans(PartitionPruneState *prunestate);
 extern Bitmapset *ExecFindInitialMatchingSubPlans(PartitionPruneState *prunestate,
 												  int nsubplans);
+extern Bitmapset *ExecGetPrunableRelids(PlannedStmt *plannedstmt);
+extern Bitmapset *ExecGetInitiallyPrunedRelids(PlannedStmt *plannedstmt,
+											   ParamListInfo params);
 
 #endif							/* EXECPARTITION_H */
@@ -57,6 +57,18 @@
  * inner batch file.  Subsequently, while reading either inner or outer batch
  * files, we might find tuples that no longer belong to the current batch;
  * if so, we just dump them out to the correct batch file.
+ *
+ * Increasing nbatch doesn't help if a batch is too big because of many
+ * tuples with the same hash value, since those can never be separated.  When
+ * that happens we stop increasing nbatch, and join the batch in "stripes"
+ * instead: as many of its inner tuples as fit in memory are loaded and the
+ * whole outer batch is scanned against them, then the hash table is emptied
+ * and loaded with the next stripe, and so on, like a block nested loop.  The
+ * inner tuples waiting for a later stripe are kept in a temp file.  Outer
+ * joins, semijoins and antijoins need to know whether each outer tuple found
+ * a match in any of the stripes, so we keep a bitmap of that in another temp
+ * file, which works because the outer batch is read in the same order for
+ * each stripe.
  * ----------------------------------------------------------------
  */
 
@@ -159,6 +171,8 @@ typedef struct ParallelHashJoinBatch
 	size_t		ntuples;		/* number of tuples loaded */
 	size_t		old_ntuples;	/* number of tuples before repartitioning */
 	bool		space_exhausted;
+	bool		striped;		/* too big to load, must be joined in stripes */
+	bool		striped_claimed;	/* has a participant taken it on? */
 
 	/*
 	 * Variable-sized SharedTuplestore objects follow this struct in memory.
@@ -223,7 +237,9 @@ typedef enum ParallelHashGrowth
 	PHJ_GROWTH_NEED_MORE_BUCKETS,
 	/* The memory budget would be exhausted, so we need to repartition. */
 	PHJ_GROWTH_NEED_MORE_BATCHES,
-	/* Repartitioning didn't help last time, so don't try to do that again. */
+	/* Repartitioning didn't help last time, so overflow into stripes. */
+	PHJ_GROWTH_STRIPING,
+	/* Growth is underway, or hashing is finished. */
 	PHJ_GROWTH_DISABLED
 } ParallelHashGrowth;
 
@@ -315,6 +331,22 @@ typedef struct HashJoinTableData
 
 	bool		growEnabled;	/* flag to shut off nbatch increases */
 
+	/*
+	 * State for joining a batch in stripes, once growEnabled is off (or, for
+	 * Parallel Hash, for a batch marked as striped).  We are working on the
+	 * last stripe of the batch when innerStripeTuples is zero.
+	 */
+	int			curstripe;		/* current stripe #; 0 for the first */
+	int			nstripes;		/* largest number of stripes in a batch */
+	BufFile    *innerStripeFile;	/* inner tuples for later stripes */
+	int64		innerStripeTuples;	/* # tuples in it not yet loaded */
+	int64		outerTupleNo;	/* # of current outer tuple in batch */
+	BufFile    *outerMatchFile; /* one match bit per outer tuple */
+	uint8	   *outerMatchChunk;	/* the block of bits being accessed */
+	long		outerMatchChunkNo;	/* its block #, or -1 if none */
+	long		outerMatchNChunks;	/* # blocks written to outerMatchFile */
+	bool		outerMatchDirty;	/* does outerMatchChunk need writing? */
+
 	double		totalTuples;	/* # tuples obtained from inner plan */
 	double		partialTuples;	/* # tuples obtained from inner plan by me */
 	double		skewTuples;		/* # tuples inserted into skew tuples */
@@ -323,8 +355,9 @@ typedef struct HashJoinTableData
 	 * These arrays are allocated for the life of the hash join, but only if
 	 * nbatch > 1.  A file is opened only when we first write a tuple into it
 	 * (otherwise its pointer remains NULL).  Note that the zero'th array
-	 * elements never get used, since we will process rather than dump out any
-	 * tuples of batch zero.
+	 * elements are normally not used, since we will process rather than dump
+	 * out any tuples of batch zero.  The exception is outerBatchFile[0],
+	 * which holds the outer tuples of batch zero if it is joined in stripes.
 	 */
 	BufFile   **innerBatchFile; /* buffered virtual temp file per batch */
 	BufFile   **outerBatchFile; /* buffered virtual temp file per batch */
@@ -23,6 +23,10 @@ typedef struct TupleQueueReader TupleQueueReader;
 /* Use this to send tuples to a shm_mq. */
 extern DestReceiver *CreateTupleQueueDestReceiver(shm_mq_handle *handle);
 
+/* Flushing of partial batches, from ProcessInterrupts() */
+extern volatile bool TupleQueueFlushPending;
+extern void HandleTupleQueueFlush(void);
+
 /* Use these to receive tuples from a shm_mq. */
 extern TupleQueueReader *CreateTupleQueueReader(shm_mq_handle *handle);
 extern void DestroyTupleQueueReader(TupleQueueReader *reader);
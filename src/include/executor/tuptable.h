@@ -89,6 +89,13 @@
  *
  * The TTS_FLAG_SLOW flag is saved state for
  * slot_deform_heap_tuple, and should not be touched by any other code.
+ *
+ * tts_detoast, if not NULL, holds detoasted copies of toasted attributes of
+ * the current tuple, so that an attribute referenced by several expressions
+ * needs to be detoasted only once; see slot_detoast_attr().  The values in
+ * tts_values are not replaced, so that the tuple can still be passed on or
+ * stored with its toast pointers.  The cache is emptied whenever the slot's
+ * contents change.
  *----------
  */
 
@@ -111,6 +118,16 @@
 struct TupleTableSlotOps;
 typedef struct TupleTableSlotOps TupleTableSlotOps;
 
+/* detoasted attribute values of a slot's current tuple */
+typedef struct SlotDetoastCache
+{
+	MemoryContext mcxt;			/* holds the detoasted values */
+	int			ncached;		/* # of valid entries in the arrays below */
+	int			maxcached;		/* allocated length of the arrays */
+	AttrNumber *attnums;		/* attribute numbers of cached values */
+	Datum	   *values;			/* detoasted values */
+} SlotDetoastCache;
+
 /* base tuple table slot type */
 typedef struct TupleTableSlot
 {
@@ -129,6 +146,7 @@ typedef struct TupleTableSlot
 	MemoryContext tts_mcxt;		/* slot itself is in this context */
 	ItemPointerData tts_tid;	/* stored tuple's tid */
 	Oid			tts_tableOid;	/* table oid of tuple */
+	SlotDetoastCache *tts_detoast;	/* detoasted values, or NULL */
 } TupleTableSlot;
 
 /* routines for a TupleTableSlot implementation */
@@ -147,7 +165,9 @@ struct TupleTableSlotOps
 	 * Clear the contents of the slot. Only the contents are expected to be
 	 * cleared and not the tuple descriptor. Typically an implementation of
 	 * this callback should free the memory allocated for the tuple contained
-	 * in the slot.
+	 * in the slot.  It must also call slot_reset_detoast_cache(), as must any
+	 * other callback that replaces the slot's contents without clearing it
+	 * first.
 	 */
 	void		(*clear) (TupleTableSlot *slot);
 
@@ -329,6 +349,8 @@ extern Datum ExecFetchSlotHeapTupleDatum(TupleTableSlot *slot);
 extern void slot_getmissingattrs(TupleTableSlot *slot, int startAttNum,
 								 int lastAttNum);
 extern void slot_getsomeattrs_int(TupleTableSlot *slot, int attnum);
+extern Datum slot_detoast_attr(TupleTableSlot *slot, int attnum);
+extern void slot_reset_detoast_cache_int(TupleTableSlot *slot);
 
 
 #ifndef FRONTEND
@@ -391,6 +413,17 @@ slot_getattr(TupleTableSlot *slot, int attnum,
 	return slot->tts_values[attnum - 1];
 }
 
+/*
+ * slot_reset_detoast_cache - forget the detoasted values of the slot's
+ * current tuple.
+ */
+static inline void
+slot_reset_detoast_cache(TupleTableSlot *slot)
+{
+	if (slot->tts_detoast != NULL && slot->tts_detoast->ncached > 0)
+		slot_reset_detoast_cache_int(slot);
+}
+
 /*
  * slot_getsysattr - fetch a system attribute of the slot's current tuple.
  *
@@ -112,6 +112,12 @@ typedef struct ExprState
 
 	Datum	   *innermost_domainval;
 	bool	   *innermost_domainnull;
+
+	/* common subexpressions, if any; see ExecInitCommonSubexpr() */
+	struct ExprCSECache *cse_cache;
+
+	/* Vars to detoast only once per row; see ExecFindDetoastVars() */
+	List	   *detoast_vars;
 } ExprState;
 
 
@@ -500,6 +506,10 @@ typedef struct ResultRelInfo
 
 	/* for use by copy.c when performing multi-inserts */
 	struct CopyMultiInsertBuffer *ri_CopyMultiInsertBuffer;
+
+	/* for use by nodeModifyTable.c when performing multi-inserts */
+	TupleTableSlot **ri_Slots;	/* slots holding buffered tuples, or NULL */
+	int			ri_NumSlots;	/* number of buffered tuples */
 } ResultRelInfo;
 
 /* ----------------
@@ -589,6 +599,17 @@ typedef struct EState
 
 	bool		es_use_parallel_mode;	/* can we use parallel workers? */
 
+	/*
+	 * Adaptive re-optimization: es_replan_checkpoints holds the plan_node_ids
+	 * of the cardinality checkpoints that may still ask for the query to be
+	 * re-planned, which they do by setting es_replan_requested.  If the query
+	 * has been re-planned, es_original_stmt is the plan we were originally
+	 * given.  See ExecReplan().
+	 */
+	Bitmapset  *es_replan_checkpoints;
+	bool		es_replan_requested;
+	PlannedStmt *es_original_stmt;
+
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
 
@@ -977,6 +998,8 @@ typedef struct PlanState
 	TupleTableSlot *ps_ResultTupleSlot; /* slot for my result tuples */
 	ExprContext *ps_ExprContext;	/* node's expression-evaluation context */
 	ProjectionInfo *ps_ProjInfo;	/* info for doing tuple projection */
+	struct ExprCSECache *ps_CSECache;	/* common subexpressions of qual and
+										 * projection, if any */
 
 	/*
 	 * Scanslot's descriptor if known. This is a bit of a hack, but otherwise
@@ -1191,6 +1214,19 @@ typedef struct ModifyTableState
 
 	/* controls transition table population for INSERT...ON CONFLICT UPDATE */
 	struct TransitionCaptureState *mt_oc_transition_capture;
+
+	/* bulk insert state, used by each participant in a parallel INSERT */
+	struct BulkInsertStateData *mt_bistate;
+
+	/*
+	 * Tuples buffered for insertion with table_multi_insert(), if the INSERT
+	 * can be done in batches.  mt_multi_insert_rels lists the result
+	 * relations owning ri_Slots, least recently used first.
+	 */
+	bool		mt_multi_insert;	/* can tuples be buffered? */
+	List	   *mt_multi_insert_rels;
+	int			mt_buffered_tuples; /* total number of buffered tuples */
+	Size		mt_buffered_bytes;	/* approximate size of buffered tuples */
 } ModifyTableState;
 
 /* ----------------
@@ -1339,6 +1375,10 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	bool		use_hints;		/* pass hints to the table AM? */
+	Bitmapset  *hint_attrs;		/* columns used, or NULL for all */
+	int			hint_nkeys;		/* number of keys in hint_keys */
+	struct ScanKeyData *hint_keys;	/* quals usable to skip tuples */
 } SeqScanState;
 
 /* ----------------
@@ -1408,6 +1448,14 @@ typedef struct
  *		OrderByTypByVals   is the datatype of order by expression pass-by-value?
  *		OrderByTypLens	   typlens of the datatypes of order by expressions
  *		PscanLen		   size of parallel index scan descriptor
+ *
+ *		PrefetchQueue	   ring of TIDs read ahead of the scan, or NULL
+ *		PrefetchHead	   position of next entry to return in PrefetchQueue
+ *		PrefetchCount	   number of entries in PrefetchQueue
+ *		PrefetchTarget	   current target prefetch distance
+ *		PrefetchMaximum    maximum value for PrefetchTarget
+ *		PrefetchLastBlock  heap block most recently prefetched
+ *		PrefetchExhausted  has the index AM returned all its TIDs?
  * ----------------
  */
 typedef struct IndexScanState
@@ -1435,6 +1483,15 @@ typedef struct IndexScanState
 	bool	   *iss_OrderByTypByVals;
 	int16	   *iss_OrderByTypLens;
 	Size		iss_PscanLen;
+
+	/* These are needed for prefetching heap blocks */
+	struct IndexPrefetchEntry *iss_PrefetchQueue;
+	int			iss_PrefetchHead;
+	int			iss_PrefetchCount;
+	int			iss_PrefetchTarget;
+	int			iss_PrefetchMaximum;
+	BlockNumber iss_PrefetchLastBlock;
+	bool		iss_PrefetchExhausted;
 } IndexScanState;
 
 /* ----------------
@@ -2223,12 +2280,25 @@ typedef struct AggState
 typedef struct WindowStatePerFuncData *WindowStatePerFunc;
 typedef struct WindowStatePerAggData *WindowStatePerAgg;
 
+/*
+ * WindowAggStatus -- Used to track the status of WindowAggState
+ */
+typedef enum WindowAggStatus
+{
+	WINDOWAGG_DONE,				/* No more processing to do */
+	WINDOWAGG_RUN,				/* Normal processing of window funcs */
+	WINDOWAGG_PASSTHROUGH,		/* Don't eval window funcs */
+	WINDOWAGG_PASSTHROUGH_STRICT	/* Pass-through plus don't store new
+									 * tuples during spool */
+} WindowAggStatus;
+
 typedef struct WindowAggState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 
 	/* these fields are filled in by ExecInitExpr: */
-	List	   *funcs;			/* all WindowFunc nodes in targetlist */
+	List	   *funcs;			/* all WindowFunc nodes in targetlist and
+								 * run condition */
 	int			numfuncs;		/* total number of window functions */
 	int			numaggs;		/* number that are plain aggregates */
 
@@ -2275,8 +2345,18 @@ typedef struct WindowAggState
 	MemoryContext curaggcontext;	/* current aggregate's working data */
 	ExprContext *tmpcontext;	/* short-term evaluation context */
 
+	ExprState  *runcondition;	/* Condition which must remain true otherwise
+								 * execution of the WindowAgg will finish or
+								 * go into pass-through mode.  NULL when there
+								 * is no such condition. */
+
+	bool		use_pass_through;	/* When false, stop execution when
+									 * runcondition is no longer true.  Else
+									 * just stop evaluating window funcs. */
+	bool		top_window;		/* true if this is the top-most WindowAgg or
+								 * the only WindowAgg in this query level */
+	WindowAggStatus status;		/* run status of WindowAggState */
 	bool		all_first;		/* true if the scan is starting */
-	bool		all_done;		/* true if the scan is finished */
 	bool		partition_spooled;	/* true if all tuples in current partition
 									 * have been spooled into tuplestore */
 	bool		more_partitions;	/* true if there's more partitions after
@@ -2332,6 +2412,7 @@ typedef struct GatherState
 	/* these fields are set up once: */
 	TupleTableSlot *funnel_slot;
 	struct ParallelExecutorInfo *pei;
+	struct _DestReceiver *into_dest;	/* workers insert into this CTAS target */
 	/* all remaining fields are reinitialized during a rescan: */
 	int			nworkers_launched;	/* original number of workers */
 	int			nreaders;		/* number of still-active workers */
@@ -2382,6 +2463,7 @@ typedef struct HashInstrumentation
 	int			nbatch;			/* number of batches at end of execution */
 	int			nbatch_original;	/* planned number of batches */
 	Size		space_peak;		/* peak memory usage in bytes */
+	int			nstripes;		/* largest number of stripes in a batch */
 } HashInstrumentation;
 
 /* ----------------
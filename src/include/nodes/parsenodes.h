@@ -1365,6 +1365,8 @@ typedef struct WindowClause
 	Oid			inRangeColl;	/* collation for in_range tests */
 	bool		inRangeAsc;		/* use ASC sort order for in_range tests? */
 	bool		inRangeNullsFirst;	/* nulls sort first for in_range tests? */
+	List	   *runCondition;	/* quals to short-circuit execution, see
+								 * find_window_run_conditions */
 	Index		winref;			/* ID referenced by window functions */
 	bool		copiedOrder;	/* did we copy orderClause from refname? */
 } WindowClause;
@@ -122,6 +122,8 @@ typedef struct PlannerGlobal
 
 	List	   *appendRelations;	/* "flat" list of AppendRelInfos */
 
+	List	   *partPruneInfos; /* PartitionPruneInfos with initial pruning */
+
 	List	   *relationOids;	/* OIDs of relations the plan depends on */
 
 	List	   *invalItems;		/* other dependencies, as PlanInvalItems */
@@ -326,6 +328,9 @@ struct PlannerInfo
 	AttrNumber *grouping_map;	/* for GroupingFunc fixup */
 	List	   *minmax_aggs;	/* List of MinMaxAggInfos */
 
+	/* Eager aggregation info, or NULL if not applicable to this query */
+	struct RelAggInfo *agg_info;
+
 	MemoryContext planner_cxt;	/* context holding PlannerInfo */
 
 	double		total_table_pages;	/* # of pages in all non-dummy tables of
@@ -361,6 +366,9 @@ struct PlannerInfo
 
 	/* Does this query modify any partition key columns? */
 	bool		partColsUpdated;
+
+	/* key of this query in the cardinality feedback table, or 0 if none */
+	uint64		feedback_key;
 };
 
 
@@ -617,6 +625,17 @@ typedef struct PartitionSchemeData *PartitionScheme;
  * Furthermore, FULL JOINs add extra nullable_partexprs expressions
  * corresponding to COALESCE expressions of the left and right join columns,
  * to simplify matching join clauses to those lists.
+ *
+ * If the query is a candidate for eager aggregation (see RelAggInfo), each
+ * base or join relation that includes the relation to be aggregated may have
+ * a partially aggregated counterpart:
+ *
+ *		grouped_rel - RelOptInfo whose paths produce the same rows as this
+ *					relation's, except that the aggregated relation's rows
+ *					have been partially aggregated before being joined
+ *
+ * The grouped_rel is not entered into the planner's join-relation lists, since
+ * it has the same relids as the relation it belongs to.
  *----------
  */
 typedef enum RelOptKind
@@ -708,6 +727,8 @@ typedef struct RelOptInfo
 	PlannerInfo *subroot;		/* if subquery */
 	List	   *subplan_params; /* if subquery */
 	int			rel_parallel_workers;	/* wanted number of parallel workers */
+	uint32		amflags;		/* bitmask of optional features supported by
+								 * the table AM */
 
 	/* Information about foreign tables and foreign joins */
 	Oid			serverid;		/* identifies server for the table or join */
@@ -752,8 +773,20 @@ typedef struct RelOptInfo
 	List	  **partexprs;		/* Non-nullable partition key expressions */
 	List	  **nullable_partexprs; /* Nullable partition key expressions */
 	List	   *partitioned_child_rels; /* List of RT indexes */
+
+	/* used by eager aggregation: */
+	struct RelOptInfo *grouped_rel; /* partially aggregated counterpart */
 } RelOptInfo;
 
+/*
+ * Flags for RelOptInfo.amflags
+ *
+ * AMFLAG_HAS_COLUMN_PROJECTION means that the table AM can avoid reading
+ * columns that a scan doesn't need, so it pays to tell it which ones those
+ * are by emitting an exact target list.
+ */
+#define AMFLAG_HAS_COLUMN_PROJECTION	0x0001
+
 /*
  * Is given relation partitioned?
  *
@@ -1761,6 +1794,9 @@ typedef struct WindowAggPath
 	Path		path;
 	Path	   *subpath;		/* path representing input source */
 	WindowClause *winclause;	/* WindowClause we'll be using */
+	List	   *qual;			/* lower-level WindowAgg runconditions */
+	bool		topwindow;		/* false for all apart from the WindowAgg
+								 * that's closest to the root of the plan */
 } WindowAggPath;
 
 /*
@@ -2331,6 +2367,32 @@ typedef struct MinMaxAggInfo
 	Param	   *param;			/* param for subplan's output */
 } MinMaxAggInfo;
 
+/*
+ * RelAggInfo describes how to perform "eager aggregation" for a query: when
+ * every aggregate's arguments come from a single base relation and all joins
+ * are inner joins, we can partially aggregate that relation's rows, grouped by
+ * whichever of its columns are needed above it, before joining it to the other
+ * relations, and then finalize the aggregates on top of the join.  That can
+ * reduce the number of rows to be joined by a large factor.
+ *
+ * group_clauses and group_exprs describe the grouping keys of the partial
+ * aggregation; each group_exprs member is a Var of the aggregated relation,
+ * and group_attnos holds their attribute numbers.  agg_exprs holds the
+ * query's Aggrefs in AGGSPLIT_INITIAL_SERIAL mode, and agg_costs holds the
+ * cost of computing them.
+ */
+typedef struct RelAggInfo
+{
+	NodeTag		type;
+
+	Index		relid;			/* RT index of the relation to aggregate */
+	List	   *group_clauses;	/* SortGroupClauses for the grouping keys */
+	List	   *group_exprs;	/* Vars, in same order as group_clauses */
+	Bitmapset  *group_attnos;	/* attribute numbers of group_exprs */
+	List	   *agg_exprs;		/* partial-mode Aggrefs */
+	AggClauseCosts agg_costs;	/* costs of partially aggregating */
+} RelAggInfo;
+
 /*
  * At runtime, PARAM_EXEC slots are used to pass values around from one plan
  * node to another.  They can be used to pass values down into subqueries (for
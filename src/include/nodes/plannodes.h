@@ -70,6 +70,10 @@ typedef struct PlannedStmt
 
 	List	   *appendRelations;	/* list of AppendRelInfo nodes */
 
+	List	   *partPruneInfos; /* PartitionPruneInfos of Append/MergeAppend
+								 * nodes whose initial pruning can be done
+								 * before executor startup */
+
 	List	   *subplans;		/* Plan trees for SubPlan expressions; note
 								 * that some could be NULL */
 
@@ -85,6 +89,13 @@ typedef struct PlannedStmt
 
 	Node	   *utilityStmt;	/* non-null if this is utility stmt */
 
+	/*
+	 * If the executor may re-plan this statement while running it (see
+	 * ExecReplan), the original query and the options it was planned with.
+	 */
+	struct Query *reoptQuery;	/* unplanned copy of the query, or NULL */
+	int			reoptCursorOptions; /* cursorOptions passed to planner() */
+
 	/* statement location in source string (copied from Query) */
 	int			stmt_location;	/* start location, or -1 if unknown */
 	int			stmt_len;		/* length in bytes; 0 means "rest of string" */
@@ -231,6 +242,7 @@ typedef struct ModifyTable
 	Node	   *onConflictWhere;	/* WHERE for ON CONFLICT UPDATE */
 	Index		exclRelRTI;		/* RTI of the EXCLUDED pseudo relation */
 	List	   *exclRelTlist;	/* tlist of the EXCLUDED pseudo relation */
+	bool		multiInsert;	/* may rows be inserted in batches? */
 } ModifyTable;
 
 struct PartitionPruneInfo;		/* forward reference to struct below */
@@ -772,6 +784,9 @@ typedef struct Sort
 	Oid		   *sortOperators;	/* OIDs of operators to sort them by */
 	Oid		   *collations;		/* OIDs of collations */
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
+	/* cardinality feedback target for the input, see optimizer/feedback.c */
+	uint64		feedbackKey;	/* query's feedback key, or 0 if none */
+	Bitmapset  *feedbackRelids; /* relids of the rel being sorted */
 } Sort;
 
 /* ----------------
@@ -855,6 +870,17 @@ typedef struct WindowAgg
 	Oid			inRangeColl;	/* collation for in_range tests */
 	bool		inRangeAsc;		/* use ASC sort order for in_range tests? */
 	bool		inRangeNullsFirst;	/* nulls sort first for in_range tests? */
+
+	/*
+	 * runCondition: quals that, once they return false for a row, will
+	 * return false for all remaining rows of the partition; execution can
+	 * then skip ahead to the next partition.  plan.qual holds the run
+	 * conditions of lower-level WindowAggs, which only the top-level
+	 * WindowAgg (topWindow) applies; see create_one_window_path.
+	 */
+	List	   *runCondition;
+	bool		topWindow;		/* false for all apart from the WindowAgg
+								 * that's closest to the root of the plan */
 } WindowAgg;
 
 /* ----------------
@@ -933,6 +959,9 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	/* all other info is in the parent HashJoin node */
 	double		rows_total;		/* estimate total rows if parallel_aware */
+	/* cardinality feedback target for the inner rel, see optimizer/feedback.c */
+	uint64		feedbackKey;	/* query's feedback key, or 0 if none */
+	Bitmapset  *feedbackRelids; /* relids of the rel being hashed */
 } Hash;
 
 /* ----------------
@@ -1138,6 +1167,8 @@ typedef struct PartitionPruneInfo
  * indexes, as stored in 'subplan_map', are global across the parent plan
  * node, but partition indexes are valid only within a particular hierarchy.
  * relid_map[p] contains the partition's OID, or 0 if the partition was pruned.
+ * rti_map[p] contains the range table index of a leaf partition that has a
+ * subplan, or 0 otherwise.
  */
 typedef struct PartitionedRelPruneInfo
 {
@@ -1149,6 +1180,7 @@ typedef struct PartitionedRelPruneInfo
 	int		   *subplan_map;	/* subplan index by partition index, or -1 */
 	int		   *subpart_map;	/* subpart index by partition index, or -1 */
 	Oid		   *relid_map;		/* relation OID by partition index, or 0 */
+	Index	   *rti_map;		/* leaf RT index by partition index, or 0 */
 
 	/*
 	 * initial_pruning_steps shows how to prune during executor startup (i.e.,
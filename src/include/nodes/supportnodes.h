@@ -38,6 +38,7 @@
 struct PlannerInfo;				/* avoid including pathnodes.h here */
 struct IndexOptInfo;
 struct SpecialJoinInfo;
+struct WindowClause;
 
 
 /*
@@ -239,4 +240,47 @@ typedef struct SupportRequestIndexCondition
 								 * equivalent of the function call */
 } SupportRequestIndexCondition;
 
+/*
+ * The WFuncMonotonic request allows the support function to tell the planner
+ * how the value of a window function changes as successive rows of a window
+ * partition are processed.  If the result can only stay the same or go up,
+ * the function is "monotonically increasing"; if it can only stay the same
+ * or go down, it is "monotonically decreasing"; if it is the same for every
+ * row of the partition, it is both.  Knowing this lets the planner turn a
+ * qual such as "row_number() OVER (...) <= 10" in an outer query into a
+ * "run condition" that allows the WindowAgg node to stop processing the
+ * current partition as soon as the condition stops holding, since it can
+ * never become true again for later rows of the same partition.
+ *
+ * "window_func" is the WindowFunc being inquired about, and "window_clause"
+ * is the WindowClause it belongs to; its frame options typically matter for
+ * window aggregates.  The support function should set "monotonic" to the
+ * appropriate MonotonicFunction value and return the request node, or
+ * return NULL (or leave "monotonic" as MONOTONICFUNC_NONE) if it cannot
+ * say anything.
+ *
+ * Monotonicity is judged for rows of a single partition, in the order in
+ * which the WindowAgg processes them; NULL results are not a concern, since
+ * the planner only uses strict comparison operators for run conditions.
+ */
+typedef enum MonotonicFunction
+{
+	MONOTONICFUNC_NONE = 0,
+	MONOTONICFUNC_INCREASING = (1 << 0),
+	MONOTONICFUNC_DECREASING = (1 << 1),
+	MONOTONICFUNC_BOTH = MONOTONICFUNC_INCREASING | MONOTONICFUNC_DECREASING
+} MonotonicFunction;
+
+typedef struct SupportRequestWFuncMonotonic
+{
+	NodeTag		type;
+
+	/* Input fields: */
+	WindowFunc *window_func;	/* window function to inquire about */
+	struct WindowClause *window_clause; /* window clause it belongs to */
+
+	/* Output fields: */
+	MonotonicFunction monotonic;
+} SupportRequestWFuncMonotonic;
+
 #endif							/* SUPPORTNODES_H */
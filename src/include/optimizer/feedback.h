@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * feedback.h
+ *	  prototypes for optimizer/util/feedback.c
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/optimizer/feedback.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef FEEDBACK_H
+#define FEEDBACK_H
+
+#include "nodes/params.h"
+#include "nodes/pathnodes.h"
+
+/* GUC parameters */
+#define DEFAULT_REOPTIMIZATION_THRESHOLD 100.0
+extern PGDLLIMPORT bool adaptive_reoptimization;
+extern PGDLLIMPORT double reoptimization_threshold;
+
+extern uint64 feedback_query_key(Query *parse, ParamListInfo boundParams);
+extern bool query_supports_reoptimization(Query *parse);
+extern void record_cardinality_feedback(uint64 querykey, Relids relids,
+										double rows);
+extern bool lookup_cardinality_feedback(uint64 querykey, Relids relids,
+										double *rows);
+extern void apply_cardinality_feedback(PlannerInfo *root, RelOptInfo *rel);
+
+#endif							/* FEEDBACK_H */
@@ -0,0 +1,46 @@
+/*-------------------------------------------------------------------------
+ *
+ * doublewrite.h
+ *	  Torn page protection by writing pages to a double-write file first
+ *
+ *
+ * Portions Copyright (c) 1996-2020, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/storage/doublewrite.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOUBLEWRITE_H
+#define DOUBLEWRITE_H
+
+#include "access/xlogdefs.h"
+#include "common/relpath.h"
+#include "storage/block.h"
+#include "storage/relfilenode.h"
+
+/* directory of the double-write files, relative to the data directory */
+#define DOUBLE_WRITE_DIR	"pg_dblwr"
+
+/* max. number of pages in a batch, see DoubleWriteBatchAdd */
+#define DOUBLE_WRITE_BATCH_SIZE		32
+
+/* max. number of buffers DoubleWriteTakeHandedOff returns */
+#define DOUBLE_WRITE_QUEUE_SIZE		256
+
+/* GUC variable */
+extern bool double_write_buffer;
+
+extern char *DoubleWritePage(RelFileNode rnode, ForkNumber forknum,
+							 BlockNumber blocknum, char *page);
+extern char *DoubleWriteBatchAdd(RelFileNode rnode, ForkNumber forknum,
+								 BlockNumber blocknum, char *page);
+extern void DoubleWriteBatchFlush(void);
+extern void DoubleWriteBatchDone(void);
+extern bool DoubleWriteHandOff(int buf_id);
+extern int	DoubleWriteTakeHandedOff(int *buf_ids);
+extern Size DoubleWriteShmemSize(void);
+extern void DoubleWriteShmemInit(void);
+extern void StartupDoubleWrite(XLogRecPtr redo);
+
+#endif							/* DOUBLEWRITE_H */
@@ -146,6 +146,7 @@ typedef struct RelationData
 	Bitmapset  *rd_keyattr;		/* cols that can be ref'd by foreign keys */
 	Bitmapset  *rd_pkattr;		/* cols included in primary key */
 	Bitmapset  *rd_idattr;		/* included in replica identity index */
+	Bitmapset  *rd_warmblockattr;	/* used by indexes that rule out WARM */
 
 	PublicationActions *rd_pubactions;	/* publication actions */
 
@@ -0,0 +1,45 @@
+# Cached generic plans and initial partition pruning
+#
+# When a generic plan is reused, the partitions that initial pruning
+# eliminates are never locked, and the partitions that survive are locked
+# only after pruning.  Check that a session holding a lock on a pruned
+# partition doesn't block us, and that an invalidation arriving while we
+# wait for the lock on a surviving partition makes us build a new plan
+# rather than run the stale one, which would use the dropped index.
+
+setup
+{
+  CREATE TABLE lp (a int, b int) PARTITION BY LIST (a);
+  CREATE TABLE lp_1 PARTITION OF lp FOR VALUES IN (1);
+  CREATE TABLE lp_2 PARTITION OF lp FOR VALUES IN (2);
+  CREATE INDEX lp_1_b ON lp_1 (b);
+  CREATE INDEX lp_2_b ON lp_2 (b);
+  INSERT INTO lp SELECT i % 2 + 1, i FROM generate_series(1, 100) i;
+}
+
+teardown
+{
+  DROP TABLE lp;
+}
+
+session "s1"
+setup
+{
+  SET plan_cache_mode = force_generic_plan;
+  SET enable_seqscan = off;
+  SET enable_bitmapscan = off;
+  PREPARE q (int) AS SELECT * FROM lp WHERE a = $1 AND b = 11;
+}
+step "s1exec"	{ EXECUTE q(2); }
+teardown	{ DEALLOCATE q; }
+
+session "s2"
+step "s2lock1"	{ BEGIN; LOCK TABLE lp_1 IN ACCESS EXCLUSIVE MODE; }
+step "s2drop2"	{ BEGIN; DROP INDEX lp_2_b; }
+step "s2commit"	{ COMMIT; }
+
+# lp_1 is pruned, so its lock doesn't matter
+permutation "s1exec" "s2lock1" "s1exec" "s2commit"
+
+# lp_2 survives pruning, so we wait for it, then notice the dropped index
+permutation "s1exec" "s2drop2" "s1exec" "s2commit"
@@ -0,0 +1,30 @@
+# Test that VACUUM sets relfrozenxid to the oldest XID it leaves in the
+# table, rather than to its freeze cutoff.  The rows aren't frozen, since
+# they are far younger than vacuum_freeze_min_age, so the oldest row's xmin
+# holds relfrozenxid back.  Once that row is deleted and removed,
+# relfrozenxid advances to the xmin of the remaining row.
+
+setup
+{
+	CREATE TABLE frz_tab (id int) WITH (autovacuum_enabled = off);
+}
+
+teardown
+{
+	DROP TABLE frz_tab;
+}
+
+session "s1"
+step "s1_begin"		{ BEGIN; SELECT txid_current() > 0 AS has_xid; }
+step "s1_commit"	{ COMMIT; }
+
+session "s2"
+step "s2_insert1"	{ INSERT INTO frz_tab VALUES (1); }
+step "s2_insert2"	{ INSERT INTO frz_tab VALUES (2); }
+step "s2_delete1"	{ DELETE FROM frz_tab WHERE id = 1; }
+step "s2_vacuum"	{ VACUUM frz_tab; }
+step "s2_check"		{ SELECT id, xmin = (SELECT relfrozenxid FROM pg_class WHERE oid = 'frz_tab'::regclass) AS is_frozenxid FROM frz_tab ORDER BY id; }
+
+# While s1 is running, the second row's xmin is newer than the oldest XID
+# VACUUM considers running, yet relfrozenxid still becomes the first row's.
+permutation "s2_insert1" "s1_begin" "s2_insert2" "s2_vacuum" "s2_check" "s1_commit" "s2_delete1" "s2_vacuum" "s2_check"
@@ -0,0 +1,39 @@
+CREATE EXTENSION test_join_search;
+
+--
+-- The timings and memory usage depend on the machine, but the plan costs
+-- don't.  The exhaustive search finds the cheapest plan, so compare the
+-- plans that the other join search strategies find for the same join
+-- graphs with it.
+--
+SET from_collapse_limit = 100;
+
+-- exhaustive search
+CREATE TEMP TABLE exhaustive AS
+SELECT shape, plan_cost
+FROM unnest(ARRAY['chain', 'cycle', 'star', 'clique']) AS shape,
+     LATERAL test_join_search(shape, 8);
+
+-- GEQO
+SET geqo_threshold = 2;
+SET geqo_seed = 0;
+SELECT shape, j.plan_cost >= e.plan_cost AS not_cheaper
+FROM exhaustive e, LATERAL test_join_search(shape, 8) j;
+RESET geqo_threshold;
+RESET geqo_seed;
+
+-- iterative dynamic programming, with blocks too small for the whole join
+SET join_search_block_size = 3;
+SELECT shape, j.plan_cost >= e.plan_cost AS not_cheaper
+FROM exhaustive e, LATERAL test_join_search(shape, 8, 2) j;
+
+-- with a block as big as the whole join, it is the exhaustive search
+SET join_search_block_size = 8;
+SELECT shape, j.plan_cost = e.plan_cost AS same_cost
+FROM exhaustive e, LATERAL test_join_search(shape, 8) j;
+RESET join_search_block_size;
+
+-- error cases
+SELECT * FROM test_join_search('ring', 4);
+SELECT * FROM test_join_search('chain', 1);
+SELECT * FROM test_join_search('chain', 4, 0);
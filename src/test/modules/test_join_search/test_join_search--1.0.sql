@@ -0,0 +1,11 @@
+/* src/test/modules/test_join_search/test_join_search--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_join_search" to load this file. \quit
+
+CREATE FUNCTION test_join_search(shape text, nrels int4, loops int4 DEFAULT 1,
+								 OUT planning_time float8,
+								 OUT memory_used int8,
+								 OUT plan_cost float8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
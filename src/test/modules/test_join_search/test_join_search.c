@@ -0,0 +1,164 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_join_search.c
+ *		Planning-time benchmark for the planner's join search.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_join_search/test_join_search.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "lib/stringinfo.h"
+#include "miscadmin.h"
+#include "nodes/plannodes.h"
+#include "portability/instr_time.h"
+#include "tcop/tcopprot.h"
+#include "utils/builtins.h"
+#include "utils/memutils.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_join_search);
+
+static char *build_join_query(const char *shape, int nrels);
+
+/*
+ * Build a query joining 'nrels' relations along a join graph of the given
+ * shape.
+ *
+ * Each relation is a two-column function RTE.  Except for the clique, the
+ * join clauses are written so that no two of them fall into the same
+ * equivalence class; otherwise the planner would deduce additional join
+ * clauses and the join graph wouldn't have the intended shape.
+ */
+static char *
+build_join_query(const char *shape, int nrels)
+{
+	StringInfoData buf;
+	int			i;
+
+	initStringInfo(&buf);
+	appendStringInfoString(&buf, "SELECT 1 FROM ");
+	for (i = 1; i <= nrels; i++)
+		appendStringInfo(&buf,
+						 "%sROWS FROM (generate_series(1, 1000), generate_series(1, 1000)) AS t%d(a, b)",
+						 i > 1 ? ", " : "", i);
+
+	appendStringInfoString(&buf, " WHERE true");
+	if (strcmp(shape, "chain") == 0 || strcmp(shape, "cycle") == 0)
+	{
+		for (i = 1; i < nrels; i++)
+			appendStringInfo(&buf, " AND t%d.b = t%d.a", i, i + 1);
+		if (strcmp(shape, "cycle") == 0 && nrels > 2)
+			appendStringInfo(&buf, " AND t%d.b = t1.a", nrels);
+	}
+	else if (strcmp(shape, "star") == 0)
+	{
+		for (i = 2; i <= nrels; i++)
+			appendStringInfo(&buf, " AND t1.a + %d = t%d.b", i, i);
+	}
+	else if (strcmp(shape, "clique") == 0)
+	{
+		for (i = 2; i <= nrels; i++)
+			appendStringInfo(&buf, " AND t1.a = t%d.a", i);
+	}
+	else
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("unrecognized join graph shape \"%s\"", shape),
+				 errhint("Valid shapes are \"chain\", \"cycle\", \"star\" and \"clique\".")));
+
+	return buf.data;
+}
+
+/*
+ * SQL-callable entry point.
+ *
+ * Plans the query 'loops' times, each time in a fresh memory context, and
+ * reports the average planning time, the memory used by the last planning
+ * run, and the estimated cost of the plan.
+ */
+Datum
+test_join_search(PG_FUNCTION_ARGS)
+{
+	char	   *shape = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32		nrels = PG_GETARG_INT32(1);
+	int32		loops = PG_GETARG_INT32(2);
+	char	   *query_string;
+	List	   *raw_parsetree_list;
+	RawStmt    *parsetree;
+	TupleDesc	tupdesc;
+	Datum		values[3];
+	bool		nulls[3] = {false, false, false};
+	instr_time	total;
+	Size		memory_used = 0;
+	Cost		plan_cost = 0;
+	int			i;
+
+	if (nrels < 2)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of relations must be at least 2")));
+	if (loops < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of loops must be at least 1")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	query_string = build_join_query(shape, nrels);
+	raw_parsetree_list = pg_parse_query(query_string);
+	Assert(list_length(raw_parsetree_list) == 1);
+	parsetree = linitial_node(RawStmt, raw_parsetree_list);
+
+	INSTR_TIME_SET_ZERO(total);
+
+	for (i = 0; i < loops; i++)
+	{
+		MemoryContext plancxt;
+		MemoryContext oldcxt;
+		List	   *querytree_list;
+		PlannedStmt *plan;
+		instr_time	start;
+		instr_time	duration;
+
+		CHECK_FOR_INTERRUPTS();
+
+		plancxt = AllocSetContextCreate(CurrentMemoryContext,
+										"test_join_search",
+										ALLOCSET_DEFAULT_SIZES);
+		oldcxt = MemoryContextSwitchTo(plancxt);
+
+		querytree_list = pg_analyze_and_rewrite(copyObject(parsetree),
+												query_string,
+												NULL, 0, NULL);
+		Assert(list_length(querytree_list) == 1);
+
+		INSTR_TIME_SET_CURRENT(start);
+		plan = pg_plan_query(linitial_node(Query, querytree_list),
+							 query_string, CURSOR_OPT_PARALLEL_OK, NULL);
+		INSTR_TIME_SET_CURRENT(duration);
+		INSTR_TIME_SUBTRACT(duration, start);
+		INSTR_TIME_ADD(total, duration);
+
+		plan_cost = plan->planTree->total_cost;
+		memory_used = MemoryContextMemAllocated(plancxt, true);
+
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(plancxt);
+	}
+
+	values[0] = Float8GetDatum(INSTR_TIME_GET_MILLISEC(total) / loops);
+	values[1] = Int64GetDatum((int64) memory_used);
+	values[2] = Float8GetDatum(plan_cost);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -0,0 +1,31 @@
+CREATE EXTENSION test_sort_perf;
+
+--
+-- The timings depend on the machine, so only look at the number of rows
+-- each query returned, which the function checks is the same whichever
+-- sort routines were used.  CREATE INDEX returns no rows.
+--
+CREATE TABLE sort_perf AS
+    SELECT (i * 7919) % 100003 AS i4, ((i * 7919) % 100003)::int8 * -65537 AS i8,
+           md5(i::text) AS t
+    FROM generate_series(1, 20000) i;
+
+-- ORDER BY
+SELECT rows FROM test_sort_perf('SELECT i4 FROM sort_perf ORDER BY i4');
+SELECT rows FROM test_sort_perf('SELECT * FROM sort_perf ORDER BY i8 DESC, t', 2);
+SELECT rows FROM test_sort_perf('SELECT t FROM sort_perf ORDER BY i4 LIMIT 100', 2);
+
+-- CREATE INDEX
+SELECT rows FROM test_sort_perf('CREATE INDEX sort_perf_idx ON sort_perf (t COLLATE "C")',
+                                2, 'DROP INDEX sort_perf_idx');
+
+-- the setting is restored afterwards
+SHOW sort_specialization;
+
+-- error cases
+SELECT * FROM test_sort_perf('SELECT 1', 0);
+-- the cleanup command changes what the query returns
+SELECT rows FROM test_sort_perf('SELECT i4 FROM sort_perf ORDER BY i4', 1,
+                                'INSERT INTO sort_perf VALUES (0, 0, '''')');
+
+DROP TABLE sort_perf;
@@ -0,0 +1,12 @@
+/* src/test/modules/test_sort_perf/test_sort_perf--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_sort_perf" to load this file. \quit
+
+CREATE FUNCTION test_sort_perf(query text, loops int4 DEFAULT 1,
+							   cleanup text DEFAULT '',
+							   OUT generic_time float8,
+							   OUT specialized_time float8,
+							   OUT rows int8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
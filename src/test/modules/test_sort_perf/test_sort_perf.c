@@ -0,0 +1,171 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_sort_perf.c
+ *		Benchmark for the sort routines specialized by key type.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_sort_perf/test_sort_perf.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "executor/spi.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+#include "utils/builtins.h"
+#include "utils/guc.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_sort_perf);
+
+static double run_query(SPIPlanPtr plan, bool specialized, uint64 *processed);
+
+/*
+ * Execute the prepared query once with sort_specialization set as requested,
+ * and return the elapsed time in milliseconds.  The number of rows that the
+ * query returned or processed is stored in *processed.
+ *
+ * Rows returned by the query are fetched through a cursor and thrown away,
+ * so that they don't pile up in memory.
+ */
+static double
+run_query(SPIPlanPtr plan, bool specialized, uint64 *processed)
+{
+	int			save_nestlevel;
+	instr_time	start;
+	instr_time	duration;
+
+	save_nestlevel = NewGUCNestLevel();
+	(void) set_config_option("sort_specialization",
+							 specialized ? "on" : "off",
+							 PGC_USERSET, PGC_S_SESSION,
+							 GUC_ACTION_SAVE, true, 0, false);
+
+	INSTR_TIME_SET_CURRENT(start);
+
+	*processed = 0;
+	if (SPI_is_cursor_plan(plan))
+	{
+		Portal		portal;
+
+		portal = SPI_cursor_open(NULL, plan, NULL, NULL, false);
+		for (;;)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			SPI_cursor_fetch(portal, true, 1000);
+			if (SPI_processed == 0)
+				break;
+			*processed += SPI_processed;
+			SPI_freetuptable(SPI_tuptable);
+		}
+		SPI_freetuptable(SPI_tuptable);
+		SPI_cursor_close(portal);
+	}
+	else
+	{
+		int			ret;
+
+		ret = SPI_execute_plan(plan, NULL, NULL, false, 0);
+		if (ret < 0)
+			elog(ERROR, "SPI_execute_plan failed: %s",
+				 SPI_result_code_string(ret));
+		*processed = SPI_processed;
+		SPI_freetuptable(SPI_tuptable);
+	}
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+
+	AtEOXact_GUC(true, save_nestlevel);
+
+	return INSTR_TIME_GET_MILLISEC(duration);
+}
+
+/*
+ * SQL-callable entry point.
+ *
+ * Runs the query 'loops' times with the generic sort routines and 'loops'
+ * times with the specialized ones, alternating between the two, and reports
+ * the average execution time for each, along with the number of rows the
+ * query returned or processed.  That has to be the same in every execution,
+ * whichever sort routines were used.  The cleanup command, if any, is run
+ * after every execution of the query and is not timed.
+ */
+Datum
+test_sort_perf(PG_FUNCTION_ARGS)
+{
+	char	   *query = text_to_cstring(PG_GETARG_TEXT_PP(0));
+	int32		loops = PG_GETARG_INT32(1);
+	char	   *cleanup = text_to_cstring(PG_GETARG_TEXT_PP(2));
+	TupleDesc	tupdesc;
+	Datum		values[3];
+	bool		nulls[3] = {false, false, false};
+	SPIPlanPtr	plan;
+	double		generic_time = 0;
+	double		specialized_time = 0;
+	uint64		rows = 0;
+	int			i;
+
+	if (loops < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of loops must be at least 1")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	if (SPI_connect() != SPI_OK_CONNECT)
+		elog(ERROR, "SPI_connect failed");
+
+	plan = SPI_prepare(query, 0, NULL);
+	if (plan == NULL)
+		elog(ERROR, "SPI_prepare failed: %s",
+			 SPI_result_code_string(SPI_result));
+
+	for (i = 0; i < 2 * loops; i++)
+	{
+		bool		specialized = (i % 2 == 1);
+		double		elapsed;
+		uint64		processed;
+
+		elapsed = run_query(plan, specialized, &processed);
+		if (i == 0)
+			rows = processed;
+		else if (processed != rows)
+			ereport(ERROR,
+					(errcode(ERRCODE_DATA_EXCEPTION),
+					 errmsg("query processed " UINT64_FORMAT " rows with sort_specialization %s, but " UINT64_FORMAT " rows before",
+							processed, specialized ? "on" : "off", rows)));
+		if (specialized)
+			specialized_time += elapsed;
+		else
+			generic_time += elapsed;
+
+		if (cleanup[0] != '\0')
+		{
+			int			ret;
+
+			ret = SPI_execute(cleanup, false, 0);
+			if (ret < 0)
+				elog(ERROR, "SPI_execute failed: %s",
+					 SPI_result_code_string(ret));
+			SPI_freetuptable(SPI_tuptable);
+		}
+	}
+
+	SPI_finish();
+
+	values[0] = Float8GetDatum(generic_time / loops);
+	values[1] = Float8GetDatum(specialized_time / loops);
+	values[2] = Int64GetDatum((int64) rows);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -0,0 +1,17 @@
+CREATE EXTENSION test_xlog_insert;
+
+--
+-- The timings depend on the machine, but every record the workers insert
+-- takes up at least a record header plus its payload in the WAL, so check
+-- that the record count is right and that the WAL insert position advanced
+-- at least that far.
+--
+SELECT records, wal_bytes >= records * (24 + 100) AS wal_ok
+FROM test_xlog_insert(1, 100);
+SELECT records, wal_bytes >= records * (24 + 8000) AS wal_ok
+FROM test_xlog_insert(2, 100, 8000);
+
+-- error cases
+SELECT * FROM test_xlog_insert(0, 100);
+SELECT * FROM test_xlog_insert(1, 0);
+SELECT * FROM test_xlog_insert(1, 100, 0);
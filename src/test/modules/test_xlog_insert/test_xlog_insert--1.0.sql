@@ -0,0 +1,13 @@
+/* src/test/modules/test_xlog_insert/test_xlog_insert--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_xlog_insert" to load this file. \quit
+
+CREATE FUNCTION test_xlog_insert(nworkers int4, nrecords int4,
+								 record_size int4 DEFAULT 100,
+								 OUT elapsed_time float8,
+								 OUT records_per_sec float8,
+								 OUT records int8,
+								 OUT wal_bytes int8)
+RETURNS record STRICT
+AS 'MODULE_PATHNAME' LANGUAGE C;
@@ -0,0 +1,385 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_xlog_insert.c
+ *		Benchmark for concurrent WAL insertion.
+ *
+ * Copyright (c) 2020, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_xlog_insert/test_xlog_insert.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/xlog.h"
+#include "access/xloginsert.h"
+#include "catalog/pg_control.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "portability/instr_time.h"
+#include "postmaster/bgworker.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/procarray.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/memutils.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(test_xlog_insert);
+
+/* Largest payload we are willing to put into a single record */
+#define MAX_RECORD_SIZE		(1024 * 1024)
+
+/*
+ * State shared between the backend running the benchmark and its workers,
+ * stored at the start of a dynamic shared memory segment.
+ */
+typedef struct
+{
+	slock_t		mutex;			/* protects the fields below */
+	int			nworkers;
+	int			workers_attached;
+	int			workers_ready;
+	int			workers_done;
+	int64		records_inserted;	/* by the workers that are done */
+	bool		start;			/* set once all workers are ready */
+
+	/* read-only after setup */
+	int32		nrecords;
+	int32		record_size;
+
+	ConditionVariable start_cv; /* signaled when start is set */
+} test_xlog_insert_shared;
+
+typedef struct
+{
+	int			nworkers;
+	BackgroundWorkerHandle *handle[FLEXIBLE_ARRAY_MEMBER];
+} worker_state;
+
+PGDLLEXPORT void test_xlog_insert_main(Datum main_arg);
+
+static worker_state *setup_background_workers(int nworkers,
+											  dsm_segment *seg);
+static void cleanup_background_workers(dsm_segment *seg, Datum arg);
+static void wait_for_workers(worker_state *wstate,
+							 volatile test_xlog_insert_shared *shared,
+							 bool until_done);
+static void report_to_registrant(void);
+
+/*
+ * Register the background workers that will do the insertions.
+ */
+static worker_state *
+setup_background_workers(int nworkers, dsm_segment *seg)
+{
+	MemoryContext oldcontext;
+	BackgroundWorker worker;
+	worker_state *wstate;
+	int			i;
+
+	/*
+	 * The handles must survive until the on_dsm_detach callback runs, which
+	 * may be at transaction abort.
+	 */
+	oldcontext = MemoryContextSwitchTo(CurTransactionContext);
+
+	wstate = MemoryContextAlloc(TopTransactionContext,
+								offsetof(worker_state, handle) +
+								sizeof(BackgroundWorkerHandle *) * nworkers);
+	wstate->nworkers = 0;
+
+	/* Kill any workers we have started if we error out. */
+	on_dsm_detach(seg, cleanup_background_workers, PointerGetDatum(wstate));
+
+	memset(&worker, 0, sizeof(worker));
+	worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+	worker.bgw_start_time = BgWorkerStart_ConsistentState;
+	worker.bgw_restart_time = BGW_NEVER_RESTART;
+	sprintf(worker.bgw_library_name, "test_xlog_insert");
+	sprintf(worker.bgw_function_name, "test_xlog_insert_main");
+	snprintf(worker.bgw_type, BGW_MAXLEN, "test_xlog_insert");
+	snprintf(worker.bgw_name, BGW_MAXLEN, "test_xlog_insert worker");
+	worker.bgw_main_arg = UInt32GetDatum(dsm_segment_handle(seg));
+	/* set bgw_notify_pid, so we can detect if the worker stops */
+	worker.bgw_notify_pid = MyProcPid;
+
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &wstate->handle[i]))
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("could not register background process"),
+					 errhint("You may need to increase max_worker_processes.")));
+		wstate->nworkers++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+	return wstate;
+}
+
+static void
+cleanup_background_workers(dsm_segment *seg, Datum arg)
+{
+	worker_state *wstate = (worker_state *) DatumGetPointer(arg);
+
+	while (wstate->nworkers > 0)
+	{
+		wstate->nworkers--;
+		TerminateBackgroundWorker(wstate->handle[wstate->nworkers]);
+	}
+}
+
+/*
+ * Wait until all workers have reported that they are ready to start, or,
+ * if until_done is true, that they have finished their insertions.
+ *
+ * A worker always reports before it exits, so a worker that has stopped
+ * without being counted must have failed.
+ */
+static void
+wait_for_workers(worker_state *wstate,
+				 volatile test_xlog_insert_shared *shared, bool until_done)
+{
+	for (;;)
+	{
+		int			nstopped = 0;
+		int			nreported;
+		int			n;
+
+		for (n = 0; n < wstate->nworkers; n++)
+		{
+			BgwHandleStatus status;
+			pid_t		pid;
+
+			status = GetBackgroundWorkerPid(wstate->handle[n], &pid);
+			if (status == BGWH_POSTMASTER_DIED)
+				ereport(ERROR,
+						(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+						 errmsg("postmaster exited during WAL insertion benchmark")));
+			if (status == BGWH_STOPPED)
+				nstopped++;
+		}
+
+		SpinLockAcquire(&shared->mutex);
+		nreported = until_done ? shared->workers_done : shared->workers_ready;
+		SpinLockRelease(&shared->mutex);
+
+		if (nreported >= wstate->nworkers)
+			break;
+		if (nstopped > nreported)
+			ereport(ERROR,
+					(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
+					 errmsg("one or more background workers failed")));
+
+		(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_EXIT_ON_PM_DEATH, 0,
+						 PG_WAIT_EXTENSION);
+		ResetLatch(MyLatch);
+		CHECK_FOR_INTERRUPTS();
+	}
+}
+
+/*
+ * Wake up the backend that registered us, after updating a counter.
+ */
+static void
+report_to_registrant(void)
+{
+	PGPROC	   *registrant;
+
+	registrant = BackendPidGetProc(MyBgworkerEntry->bgw_notify_pid);
+	if (registrant == NULL)
+	{
+		elog(DEBUG1, "registrant backend has exited prematurely");
+		proc_exit(1);
+	}
+	SetLatch(&registrant->procLatch);
+}
+
+/*
+ * Background worker entry point.
+ *
+ * Attaches to the shared state, waits for the start signal, and then
+ * inserts the requested number of XLOG_NOOP records as fast as it can.
+ */
+void
+test_xlog_insert_main(Datum main_arg)
+{
+	dsm_segment *seg;
+	volatile test_xlog_insert_shared *shared;
+	int			workernumber;
+	char	   *payload;
+	int32		i;
+
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	seg = dsm_attach(DatumGetUInt32(main_arg));
+	if (seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+	shared = (test_xlog_insert_shared *) dsm_segment_address(seg);
+
+	SpinLockAcquire(&shared->mutex);
+	workernumber = ++shared->workers_attached;
+	SpinLockRelease(&shared->mutex);
+	if (workernumber > shared->nworkers)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("too many WAL insertion benchmark workers already")));
+
+	/*
+	 * Do the one-time setup of the WAL insertion machinery now, so that it's
+	 * not included in the measured time.
+	 */
+	if (!XLogInsertAllowed())
+		elog(ERROR, "cannot make new WAL entries during recovery");
+	payload = palloc0(shared->record_size);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->workers_ready++;
+	SpinLockRelease(&shared->mutex);
+	report_to_registrant();
+
+	/* Wait for the go-ahead, so that all workers insert at the same time. */
+	ConditionVariablePrepareToSleep((ConditionVariable *) &shared->start_cv);
+	for (;;)
+	{
+		bool		start;
+
+		SpinLockAcquire(&shared->mutex);
+		start = shared->start;
+		SpinLockRelease(&shared->mutex);
+		if (start)
+			break;
+		ConditionVariableSleep((ConditionVariable *) &shared->start_cv,
+							   PG_WAIT_EXTENSION);
+	}
+	ConditionVariableCancelSleep();
+
+	for (i = 0; i < shared->nrecords; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		XLogBeginInsert();
+		XLogRegisterData(payload, shared->record_size);
+		(void) XLogInsert(RM_XLOG_ID, XLOG_NOOP);
+	}
+
+	SpinLockAcquire(&shared->mutex);
+	shared->workers_done++;
+	shared->records_inserted += i;
+	SpinLockRelease(&shared->mutex);
+	report_to_registrant();
+
+	dsm_detach(seg);
+	proc_exit(0);
+}
+
+/*
+ * SQL-callable entry point.
+ *
+ * Starts nworkers background workers that each insert nrecords WAL records
+ * carrying record_size bytes of payload, and reports the elapsed time in
+ * milliseconds, the total insertion rate, the number of records the workers
+ * inserted and how far the WAL insert position advanced meanwhile.  The clock
+ * starts when the workers are told to go, so their startup is not included.
+ */
+Datum
+test_xlog_insert(PG_FUNCTION_ARGS)
+{
+	int32		nworkers = PG_GETARG_INT32(0);
+	int32		nrecords = PG_GETARG_INT32(1);
+	int32		record_size = PG_GETARG_INT32(2);
+	TupleDesc	tupdesc;
+	Datum		values[4];
+	bool		nulls[4] = {false, false, false, false};
+	dsm_segment *seg;
+	test_xlog_insert_shared *shared;
+	worker_state *wstate;
+	instr_time	start;
+	instr_time	duration;
+	double		elapsed;
+	XLogRecPtr	start_lsn;
+	XLogRecPtr	end_lsn;
+	int64		records;
+
+	if (nworkers < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of workers must be at least 1")));
+	if (nrecords < 1)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of records must be at least 1")));
+	if (record_size < 1 || record_size > MAX_RECORD_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("record size must be between 1 and %d bytes",
+						MAX_RECORD_SIZE)));
+
+	if (RecoveryInProgress())
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("recovery is in progress"),
+				 errhint("WAL control functions cannot be executed during recovery.")));
+
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	seg = dsm_create(sizeof(test_xlog_insert_shared), 0);
+	shared = (test_xlog_insert_shared *) dsm_segment_address(seg);
+	SpinLockInit(&shared->mutex);
+	shared->nworkers = nworkers;
+	shared->workers_attached = 0;
+	shared->workers_ready = 0;
+	shared->workers_done = 0;
+	shared->records_inserted = 0;
+	shared->start = false;
+	shared->nrecords = nrecords;
+	shared->record_size = record_size;
+	ConditionVariableInit(&shared->start_cv);
+
+	wstate = setup_background_workers(nworkers, seg);
+	wait_for_workers(wstate, shared, false);
+
+	start_lsn = GetXLogInsertRecPtr();
+	INSTR_TIME_SET_CURRENT(start);
+
+	SpinLockAcquire(&shared->mutex);
+	shared->start = true;
+	SpinLockRelease(&shared->mutex);
+	ConditionVariableBroadcast(&shared->start_cv);
+
+	wait_for_workers(wstate, shared, true);
+
+	INSTR_TIME_SET_CURRENT(duration);
+	INSTR_TIME_SUBTRACT(duration, start);
+	elapsed = INSTR_TIME_GET_MILLISEC(duration);
+	end_lsn = GetXLogInsertRecPtr();
+	records = shared->records_inserted;
+
+	/* The workers are done; don't try to terminate them on detach. */
+	cancel_on_dsm_detach(seg, cleanup_background_workers,
+						 PointerGetDatum(wstate));
+	dsm_detach(seg);
+
+	values[0] = Float8GetDatum(elapsed);
+	if (elapsed > 0)
+		values[1] = Float8GetDatum((double) records * 1000.0 / elapsed);
+	else
+		nulls[1] = true;
+	values[2] = Int64GetDatum(records);
+	values[3] = Int64GetDatum((int64) (end_lsn - start_lsn));
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
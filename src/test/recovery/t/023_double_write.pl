@@ -0,0 +1,145 @@
+# Test that crash recovery repairs torn pages from the double-write files,
+# with full_page_writes off.
+
+use strict;
+use warnings;
+
+use PostgresNode;
+use TestLib;
+use Test::More tests => 8;
+
+# Overwrite part of a block in a relation file with zeros.
+sub tear_block
+{
+	my ($path, $offset, $length) = @_;
+
+	open(my $file, '+<', $path) or die "could not open $path: $!";
+	binmode($file);
+	sysseek($file, $offset, 0) or die "sysseek failed: $!";
+	my $nb = syswrite($file, "\0" x $length);
+	die "could not write $path: $!" if !defined($nb) || $nb != $length;
+	close($file);
+	return;
+}
+
+my $node = get_new_node('primary');
+$node->init;
+
+# Keep shared_buffers small, so that backends have to evict dirty buffers
+# and hand them to the background writer.  The LRU scan of the background
+# writer is off, so that the checkpoint is what writes the page we tear.
+$node->append_conf(
+	'postgresql.conf', qq(
+double_write_buffer = on
+full_page_writes = off
+shared_buffers = 1MB
+bgwriter_lru_maxpages = 0
+autovacuum = off
+checkpoint_timeout = 1h
+));
+$node->start;
+
+# A tablespace whose relations have their pages compressed, where a torn
+# write leaves a block that can't be decompressed at all.
+my $tablespace_dir = TestLib::tempdir;
+my $real_tablespace_dir = TestLib::perl2host($tablespace_dir);
+
+$node->safe_psql('postgres',
+	"CREATE TABLESPACE dw_ts LOCATION '$real_tablespace_dir' WITH (page_compression = true)"
+);
+$node->safe_psql(
+	'postgres', q{
+CREATE TABLE dw_test (id int, v text);
+INSERT INTO dw_test SELECT g, repeat('x', 100) FROM generate_series(1, 20000) g;
+CREATE TABLE dw_comp (id int, v text) TABLESPACE dw_ts;
+INSERT INTO dw_comp SELECT g, repeat('x', 100) FROM generate_series(1, 2000) g;
+CHECKPOINT;
+});
+
+is( $node->safe_psql('postgres', 'SELECT count(*), sum(id) FROM dw_test'),
+	'20000|200010000',
+	'rows written through evictions and the checkpoint');
+
+# Modify the first pages, and have the checkpoint write them through the
+# double-write file after its redo point.
+$node->safe_psql(
+	'postgres', q{
+UPDATE dw_test SET v = repeat('y', 100) WHERE id = 1;
+UPDATE dw_comp SET v = repeat('y', 100) WHERE id = 1;
+CHECKPOINT;
+});
+
+my $blocksize = $node->safe_psql('postgres', 'SHOW block_size');
+my $relpath = $node->data_dir . '/'
+  . $node->safe_psql('postgres', "SELECT pg_relation_filepath('dw_test')");
+my $comppath = $node->data_dir . '/'
+  . $node->safe_psql('postgres', "SELECT pg_relation_filepath('dw_comp')");
+
+# A relation created after the checkpoint, whose compression marker the
+# crash loses.  Replaying its creation must mark it again.
+$node->safe_psql('postgres',
+	'CREATE TABLE dw_comp_late (id int) TABLESPACE dw_ts');
+my $latepath = $node->data_dir . '/'
+  . $node->safe_psql('postgres',
+	"SELECT pg_relation_filepath('dw_comp_late')");
+
+$node->stop('immediate');
+
+unlink("${latepath}_compressed")
+  or die "could not remove ${latepath}_compressed: $!";
+
+# Tear the first page: only its first half made it to disk, and the tuple
+# data at its end is gone.
+tear_block($relpath, $blocksize / 2, $blocksize / 2);
+
+# Tear the first page of the compressed table the same way.  If it was
+# stored compressed, which needs a file system that can punch holes, its
+# data is all in the first few hundred bytes, so damage those instead.
+open(my $file, '<', $comppath) or die "could not open $comppath: $!";
+binmode($file);
+my $header;
+sysread($file, $header, 4) == 4 or die "could not read $comppath: $!";
+close($file);
+if (unpack('L', $header) == 0x9E7A5C01)
+{
+	tear_block($comppath, 16, 48);
+}
+else
+{
+	tear_block($comppath, $blocksize / 2, $blocksize / 2);
+}
+
+my $log_offset = -s $node->logfile;
+$node->start;
+
+like(
+	substr(slurp_file($node->logfile), $log_offset),
+	qr/restored 2 torn pages from the double-write buffer/,
+	'torn pages restored from the double-write buffer');
+
+is( $node->safe_psql('postgres', 'SELECT count(*), sum(id) FROM dw_test'),
+	'20000|200010000',
+	'all rows intact after crash recovery');
+
+is( $node->safe_psql('postgres', 'SELECT v FROM dw_test WHERE id = 1'),
+	'y' x 100,
+	'update on the torn page survived');
+
+is( $node->safe_psql('postgres',
+		"SELECT count(*) FROM dw_test WHERE v <> repeat('x', 100)"),
+	'1',
+	'no other rows changed');
+
+is( $node->safe_psql('postgres',
+		'SELECT count(*), sum(id), sum(length(v)) FROM dw_comp'),
+	'2000|2001000|200000',
+	'rows in the compressed tablespace intact after crash recovery');
+
+is( $node->safe_psql('postgres', 'SELECT v FROM dw_comp WHERE id = 1'),
+	'y' x 100,
+	'update on the torn compressed page survived');
+
+ok(-f "${latepath}_compressed",
+	'compression marker recreated by WAL replay');
+
+$node->stop;
@@ -1224,3 +1224,42 @@ drop table agg_hash_1;
 drop table agg_hash_2;
 drop table agg_hash_3;
 drop table agg_hash_4;
+
+--
+-- Test eager aggregation
+--
+CREATE TABLE eager_fact (dim_id int, val int);
+CREATE TABLE eager_dim (id int, name text);
+INSERT INTO eager_fact SELECT i % 10 + 1, i FROM generate_series(1, 10000) i;
+INSERT INTO eager_dim SELECT i, 'dim ' || i FROM generate_series(1, 1000) i;
+ANALYZE eager_fact;
+ANALYZE eager_dim;
+
+SET enable_eager_aggregate = on;
+SET max_parallel_workers_per_gather = 0;
+
+-- the fact table is partially aggregated by the join key below the join
+EXPLAIN (COSTS OFF)
+SELECT count(*), sum(f.val) FROM eager_fact f JOIN eager_dim d ON f.dim_id = d.id;
+SELECT count(*), sum(f.val) FROM eager_fact f JOIN eager_dim d ON f.dim_id = d.id;
+
+SELECT d.id, count(*), sum(f.val)
+FROM eager_fact f JOIN eager_dim d ON f.dim_id = d.id
+GROUP BY d.id ORDER BY d.id;
+
+-- an aggregate without a combine function can't be partially aggregated
+CREATE AGGREGATE eager_nocombine_sum (int4) (sfunc = int4pl, stype = int4);
+EXPLAIN (COSTS OFF)
+SELECT eager_nocombine_sum(f.val) FROM eager_fact f JOIN eager_dim d ON f.dim_id = d.id;
+SELECT eager_nocombine_sum(f.val) FROM eager_fact f JOIN eager_dim d ON f.dim_id = d.id;
+
+-- nor can aggregation be pushed below an outer join
+EXPLAIN (COSTS OFF)
+SELECT count(f.val), sum(f.val) FROM eager_dim d LEFT JOIN eager_fact f ON f.dim_id = d.id;
+SELECT count(f.val), sum(f.val) FROM eager_dim d LEFT JOIN eager_fact f ON f.dim_id = d.id;
+
+RESET enable_eager_aggregate;
+RESET max_parallel_workers_per_gather;
+DROP AGGREGATE eager_nocombine_sum (int4);
+DROP TABLE eager_fact;
+DROP TABLE eager_dim;
@@ -470,3 +470,18 @@ VACUUM ANALYZE brin_test;
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE a = 1;
 -- Ensure brin index is not used when values are not correlated
 EXPLAIN (COSTS OFF) SELECT * FROM brin_test WHERE b = 1;
+
+-- test parallel index build
+CREATE TABLE brin_parallel_test (a INT) WITH (parallel_workers = 2);
+INSERT INTO brin_parallel_test SELECT x FROM generate_series(1, 10000) x;
+
+SET max_parallel_maintenance_workers = 2;
+CREATE INDEX brin_parallel_test_idx ON brin_parallel_test USING brin (a)
+  WITH (pages_per_range = 1);
+RESET max_parallel_maintenance_workers;
+
+SET enable_seqscan = off;
+SELECT count(*) FROM brin_parallel_test WHERE a BETWEEN 1000 AND 1999;
+RESET enable_seqscan;
+
+DROP TABLE brin_parallel_test;
@@ -191,3 +191,49 @@ INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
 
 -- Test unsupported btree opclass parameters
 create index on btree_tall_tbl (id int4_ops(foo=1));
+
+--
+-- Test heap prefetching in plain index scans.  The heap order of the rows
+-- is scattered relative to the index order, so that the scans below visit
+-- heap blocks out of order and issue prefetches.
+--
+CREATE TABLE btree_prefetch (a int, b int);
+INSERT INTO btree_prefetch
+  SELECT (i * 7919) % 10000, i FROM generate_series(1, 10000) i;
+CREATE INDEX btree_prefetch_a_idx ON btree_prefetch (a);
+VACUUM ANALYZE btree_prefetch;
+
+set effective_io_concurrency to 10;
+set enable_seqscan to false;
+set enable_bitmapscan to false;
+set enable_hashjoin to false;
+set enable_mergejoin to false;
+
+explain (costs off)
+select count(*), sum(b) from btree_prefetch where a < 5000;
+select count(*), sum(b) from btree_prefetch where a < 5000;
+
+-- the prefetch distance must ramp up from zero under a LIMIT
+explain (costs off)
+select a, b from btree_prefetch where a >= 100 order by a limit 5;
+select a, b from btree_prefetch where a >= 100 order by a limit 5;
+
+-- rescans must forget the TIDs read ahead
+explain (costs off)
+select count(*), sum(p.b) from generate_series(0, 9999, 1000) g(x)
+  join btree_prefetch p on p.a between g.x and g.x + 99;
+select count(*), sum(p.b) from generate_series(0, 9999, 1000) g(x)
+  join btree_prefetch p on p.a between g.x and g.x + 99;
+
+-- dead tuples queued behind the scan position
+DELETE FROM btree_prefetch WHERE b % 2 = 0;
+select count(*), sum(b) from btree_prefetch where a < 5000;
+-- index entries killed by the previous scan
+select count(*), sum(b) from btree_prefetch where a < 5000;
+
+reset effective_io_concurrency;
+reset enable_seqscan;
+reset enable_bitmapscan;
+reset enable_hashjoin;
+reset enable_mergejoin;
+DROP TABLE btree_prefetch;
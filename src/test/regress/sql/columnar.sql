@@ -0,0 +1,157 @@
+--
+-- Tests for the columnar table access method
+--
+
+CREATE TABLE col_tab (a int, b text, c numeric, d bool) USING columnar;
+
+SELECT amname FROM pg_class c JOIN pg_am am ON am.oid = c.relam
+  WHERE c.relname = 'col_tab';
+
+-- empty table
+SELECT count(*) FROM col_tab;
+
+INSERT INTO col_tab
+  SELECT i, 'row ' || i, i / 7.0, i % 3 = 0
+  FROM generate_series(1, 25000) i;
+INSERT INTO col_tab VALUES (NULL, NULL, NULL, NULL), (0, '', 0, false);
+
+SELECT count(*), count(a), count(b), sum(a), round(sum(c), 2),
+       count(*) FILTER (WHERE d)
+  FROM col_tab;
+
+-- scans reading a subset of the columns, with conditions that allow
+-- skipping chunk groups
+SELECT count(*), min(b), max(b) FROM col_tab WHERE a < 100;
+SELECT a, b, round(c, 3), d FROM col_tab WHERE a = 12345;
+SELECT a, b FROM col_tab WHERE 24998 <= a ORDER BY a;
+SELECT count(*) FROM col_tab WHERE a BETWEEN 9990 AND 10010;
+SELECT * FROM col_tab WHERE a IS NULL;
+SELECT count(*) FROM col_tab WHERE c > 3500;
+
+-- rows inserted earlier in the transaction are visible to later commands,
+-- those of aborted subtransactions are not
+BEGIN;
+INSERT INTO col_tab VALUES (-1, 'first', 1, true);
+SELECT * FROM col_tab WHERE a < 0;
+SAVEPOINT s1;
+INSERT INTO col_tab VALUES (-2, 'second', 2, true);
+ROLLBACK TO s1;
+INSERT INTO col_tab VALUES (-3, 'third', 3, true);
+SELECT * FROM col_tab WHERE a < 0 ORDER BY a;
+COMMIT;
+SELECT * FROM col_tab WHERE a < 0 ORDER BY a;
+
+BEGIN;
+INSERT INTO col_tab VALUES (-4, 'aborted', 4, true);
+ROLLBACK;
+SELECT count(*) FROM col_tab WHERE a < 0;
+
+-- values that don't fit in a page, and compress well
+CREATE TABLE col_wide (id int, t text) USING columnar;
+INSERT INTO col_wide SELECT i, repeat(chr(64 + i), 10000 * i) FROM generate_series(1, 5) i;
+SELECT id, length(t), left(t, 3) FROM col_wide ORDER BY id;
+SELECT pg_relation_size('col_wide') < 100000 AS compressed;
+
+-- adding and dropping columns
+ALTER TABLE col_wide ADD COLUMN n int DEFAULT 7;
+ALTER TABLE col_wide DROP COLUMN t;
+INSERT INTO col_wide VALUES (6, 8);
+SELECT * FROM col_wide ORDER BY id;
+SELECT * FROM col_wide WHERE n = 8;
+-- whole-row references need all columns
+SELECT w FROM col_wide w WHERE id = 3;
+
+-- AFTER ROW triggers fetch the inserted rows by TID
+CREATE FUNCTION col_trig() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+  RAISE NOTICE 'inserted %', NEW;
+  RETURN NULL;
+END $$;
+CREATE TRIGGER col_trig AFTER INSERT ON col_wide
+  FOR EACH ROW EXECUTE FUNCTION col_trig();
+INSERT INTO col_wide VALUES (7, 9), (8, 10);
+DROP TRIGGER col_trig ON col_wide;
+DROP FUNCTION col_trig();
+
+-- COPY
+COPY col_wide FROM stdin;
+9	11
+10	\N
+\.
+SELECT count(*), sum(n) FROM col_wide;
+
+-- unsupported operations
+UPDATE col_tab SET b = 'x' WHERE a = 1;
+DELETE FROM col_tab WHERE a = 1;
+SELECT * FROM col_tab WHERE a = 1 FOR UPDATE;
+CREATE INDEX ON col_tab (a);
+SELECT count(*) FROM col_tab TABLESAMPLE SYSTEM (10);
+
+-- maintenance commands
+VACUUM col_tab;
+SELECT relfrozenxid <> 0 AS has_frozenxid FROM pg_class WHERE relname = 'col_tab';
+ANALYZE col_tab;
+SELECT reltuples FROM pg_class WHERE relname = 'col_tab';
+SELECT n_distinct, most_common_vals FROM pg_stats
+  WHERE tablename = 'col_tab' AND attname = 'd';
+VACUUM FULL col_tab;
+SELECT count(*), sum(a) FROM col_tab;
+ALTER TABLE col_tab ALTER COLUMN a TYPE bigint;
+SELECT count(*), sum(a) FROM col_tab;
+TRUNCATE col_tab;
+SELECT count(*) FROM col_tab;
+INSERT INTO col_tab VALUES (1, 'one', 1, true);
+SELECT * FROM col_tab;
+
+-- truncating a table created in the same transaction
+BEGIN;
+CREATE TABLE col_trunc (a int) USING columnar;
+INSERT INTO col_trunc SELECT generate_series(1, 10);
+TRUNCATE col_trunc;
+INSERT INTO col_trunc VALUES (42);
+SELECT * FROM col_trunc;
+COMMIT;
+SELECT * FROM col_trunc;
+
+-- parallel scans
+CREATE TABLE col_par (a int, b int) USING columnar;
+INSERT INTO col_par SELECT i, i % 10 FROM generate_series(1, 200000) i;
+SET parallel_setup_cost = 0;
+SET parallel_tuple_cost = 0;
+SET min_parallel_table_scan_size = 0;
+SET max_parallel_workers_per_gather = 2;
+SELECT count(*), sum(a), sum(b) FROM col_par WHERE b < 5;
+RESET parallel_setup_cost;
+RESET parallel_tuple_cost;
+RESET min_parallel_table_scan_size;
+RESET max_parallel_workers_per_gather;
+
+-- backward scans, in a scroll cursor without a Materialize node
+CREATE TABLE col_scroll (a int) USING columnar;
+INSERT INTO col_scroll SELECT generate_series(1, 25000);
+INSERT INTO col_scroll SELECT generate_series(25001, 25005);
+BEGIN;
+EXPLAIN (COSTS OFF) DECLARE c SCROLL CURSOR FOR SELECT a FROM col_scroll;
+DECLARE c SCROLL CURSOR FOR SELECT a FROM col_scroll;
+FETCH 2 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH NEXT FROM c;
+-- across chunk groups and stripes
+FETCH ABSOLUTE 10001 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH ABSOLUTE 25001 FROM c;
+FETCH BACKWARD 2 FROM c;
+FETCH LAST FROM c;
+FETCH NEXT FROM c;
+FETCH PRIOR FROM c;
+MOVE BACKWARD ALL IN c;
+FETCH NEXT FROM c;
+CLOSE c;
+-- skipping chunk groups
+DECLARE c SCROLL CURSOR FOR SELECT a FROM col_scroll WHERE a BETWEEN 9999 AND 10002;
+FETCH ALL FROM c;
+FETCH BACKWARD ALL FROM c;
+CLOSE c;
+COMMIT;
+
+DROP TABLE col_tab, col_wide, col_trunc, col_par, col_scroll;
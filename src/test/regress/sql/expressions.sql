@@ -65,3 +65,56 @@ select count(*) from date_tbl
   where f1 not between symmetric '1997-01-01' and '1998-01-01';
 select count(*) from date_tbl
   where f1 not between symmetric '1997-01-01' and '1998-01-01';
+
+
+--
+-- Tests for common subexpressions
+--
+
+-- an immutable function used several times is evaluated once per row,
+-- even when it's used in both the qual and the targetlist
+create function cse_noisy(int) returns int immutable language plpgsql as
+$$ begin raise notice 'cse_noisy(%)', $1; return $1 * 10; end $$;
+create function cse_volatile(int) returns int volatile language plpgsql as
+$$ begin raise notice 'cse_volatile(%)', $1; return $1 * 10; end $$;
+create temp table cse_tbl (a int);
+insert into cse_tbl values (1), (2), (3);
+
+select cse_noisy(a), cse_noisy(a) + 1 as plus1 from cse_tbl
+  where cse_noisy(a) > 10;
+
+-- but a volatile one is evaluated every time
+select cse_volatile(a), cse_volatile(a) + 1 as plus1 from cse_tbl
+  where a > 2;
+
+-- occurrences that aren't always evaluated are handled correctly
+select a, case when a > 1 then cse_noisy(a) else 0 end as c, cse_noisy(a)
+  from cse_tbl;
+
+drop table cse_tbl;
+drop function cse_noisy(int);
+drop function cse_volatile(int);
+
+
+--
+-- Tests for toasted columns passed to several functions
+--
+
+-- such columns are detoasted only once per row, which mustn't affect the
+-- results, nor what's stored by an UPDATE
+create temp table detoast_tbl (id int, t text);
+insert into detoast_tbl values
+  (1, repeat('abcdefghij', 100000)),
+  (2, (select string_agg(md5(i::text), '') from generate_series(1, 1000) i)),
+  (3, null);
+
+select id, length(t), substr(t, 1, 5), t like 'abc%' as like_abc
+  from detoast_tbl order by id;
+
+update detoast_tbl set id = id + 10
+  where length(t) > 10 and substr(t, 1, 3) = 'abc';
+
+select id, length(t), md5(t) = md5(repeat('abcdefghij', 100000)) as same
+  from detoast_tbl order by id;
+
+drop table detoast_tbl;
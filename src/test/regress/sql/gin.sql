@@ -171,3 +171,24 @@ reset enable_seqscan;
 reset enable_bitmapscan;
 
 drop table t_gin_test_tbl;
+
+-- test parallel index build
+create table t_gin_parallel (i int4, a int4[]) with (parallel_workers = 2);
+insert into t_gin_parallel
+  select g, array[g % 10, g % 100, 1000] from generate_series(1, 10000) g;
+insert into t_gin_parallel values (0, null), (0, '{}');
+
+set max_parallel_maintenance_workers = 2;
+create index t_gin_parallel_idx on t_gin_parallel using gin (a);
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+
+select count(*) from t_gin_parallel where a @> array[5];
+select count(*) from t_gin_parallel where a @> array[42];
+select count(*) from t_gin_parallel where a @> array[1000];
+select count(*) from t_gin_parallel where a @> '{}'::int4[];
+
+reset enable_seqscan;
+
+drop table t_gin_parallel;
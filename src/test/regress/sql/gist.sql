@@ -148,3 +148,21 @@ reset enable_bitmapscan;
 reset enable_indexonlyscan;
 
 drop table gist_tbl;
+
+-- test parallel sorted build
+create table gist_parallel_tbl (p point) with (parallel_workers = 2);
+insert into gist_parallel_tbl
+  select point(i % 100, i / 100) from generate_series(0, 9999) i;
+
+set max_parallel_maintenance_workers = 2;
+create index gist_parallel_idx on gist_parallel_tbl using gist (p);
+reset max_parallel_maintenance_workers;
+
+set enable_seqscan = off;
+
+select count(*) from gist_parallel_tbl
+where p <@ box(point(10, 10), point(19, 19));
+
+reset enable_seqscan;
+
+drop table gist_parallel_tbl;
@@ -602,3 +602,52 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- multi-row inserts are done in batches, where possible
+create table mi_tab (a int primary key, b text);
+create function mi_tab_count() returns trigger language plpgsql as $$
+begin
+  raise notice 'inserted % rows', (select count(*) from new_rows);
+  return null;
+end$$;
+create trigger mi_tab_after after insert on mi_tab
+  referencing new table as new_rows
+  for each statement execute function mi_tab_count();
+insert into mi_tab select g, 'x' || g from generate_series(1, 2500) g;
+select count(*), count(distinct b), min(a), max(a) from mi_tab;
+-- a unique violation is still detected, within a batch too
+insert into mi_tab select g from generate_series(2501, 2600) g
+  union all select 2550;
+insert into mi_tab select g from generate_series(2500, 2600) g;
+drop table mi_tab;
+drop function mi_tab_count();
+
+-- rows already buffered are inserted before a partition with BEFORE ROW
+-- triggers gets its row, so that the trigger sees them
+create table mi_parted (a int, b text) partition by list (a);
+create table mi_parted1 partition of mi_parted for values in (1);
+create table mi_parted2 partition of mi_parted for values in (2);
+create function mi_parted_count() returns trigger language plpgsql as $$
+begin
+  raise notice 'mi_parted1 has % rows', (select count(*) from mi_parted1);
+  return new;
+end$$;
+create trigger mi_parted2_before before insert on mi_parted2
+  for each row execute function mi_parted_count();
+insert into mi_parted values (1, 'a'), (1, 'b'), (2, 'c'), (1, 'd'), (2, 'e');
+select tableoid::regclass, * from mi_parted order by b;
+drop table mi_parted;
+drop function mi_parted_count();
+
+-- an insert into more partitions than keep their buffers between flushes
+create table mi_many (a int) partition by hash (a);
+do $$
+begin
+  for i in 0..39 loop
+    execute format('create table mi_many%s partition of mi_many
+                    for values with (modulus 40, remainder %s)', i, i);
+  end loop;
+end$$;
+insert into mi_many select g from generate_series(1, 5000) g;
+select count(*), count(distinct tableoid), sum(a) from mi_many;
+drop table mi_many;
@@ -2200,3 +2200,111 @@ where exists (select 1 from j3
       and t1.unique1 < 1;
 
 drop table j3;
+
+--
+-- adaptive re-optimization
+--
+create function explain_reopt(query text) returns setof text
+language plpgsql as
+$$
+declare
+  ln text;
+begin
+  for ln in
+    execute 'explain (analyze, timing off, summary off) ' || query
+  loop
+    -- keep the row estimates, but not the costs, widths or memory usage
+    continue when ln ~ 'Buckets:';
+    ln := regexp_replace(ln, 'cost=\S+ ', '');
+    ln := regexp_replace(ln, ' width=\d+', '');
+    return next ln;
+  end loop;
+end;
+$$;
+
+set enable_nestloop = off;
+set enable_mergejoin = off;
+set enable_indexscan = off;
+set enable_bitmapscan = off;
+
+-- the planner takes the conditions on b to be independent, and so
+-- underestimates its size by a factor of 100
+select explain_reopt($$
+select a.unique1 from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where b.two = 0 and b.four = 0 and b.ten = 0 and b.twenty = 0 and b.hundred = 0
+$$);
+
+-- with adaptive re-optimization, that is noticed once the hash table has
+-- been built, and the query is planned again before it returns a row
+set adaptive_reoptimization = on;
+set reoptimization_threshold = 10;
+select explain_reopt($$
+select a.unique1 from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where b.two = 0 and b.four = 0 and b.ten = 0 and b.twenty = 0 and b.hundred = 0
+$$);
+
+-- under an aggregate, the misestimate only helps the next time around
+select explain_reopt($$
+select count(*) from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where b.two = 0 and b.four = 0 and b.ten = 0 and b.twenty = 0 and b.hundred = 0
+$$);
+select explain_reopt($$
+select count(*) from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where b.two = 0 and b.four = 0 and b.ten = 0 and b.twenty = 0 and b.hundred = 0
+$$);
+
+-- what was observed for one parameter value isn't used for another
+prepare reopt_q(int) as
+select a.unique1 from tenk1 a join tenk1 b on a.unique1 = b.unique2
+where b.two = 0 and b.four = 0 and b.ten = 0 and b.twenty = 0 and b.hundred = $1;
+set plan_cache_mode = force_custom_plan;
+select explain_reopt('execute reopt_q(0)');
+select explain_reopt('execute reopt_q(2)');
+-- and a generic plan, which can't know the value, gets no feedback at all
+set plan_cache_mode = force_generic_plan;
+select explain_reopt('execute reopt_q(0)');
+
+deallocate reopt_q;
+reset plan_cache_mode;
+reset reoptimization_threshold;
+reset adaptive_reoptimization;
+reset enable_nestloop;
+reset enable_mergejoin;
+reset enable_indexscan;
+reset enable_bitmapscan;
+drop function explain_reopt(text);
+
+--
+-- Test iterative dynamic programming join search
+--
+set join_search_block_size = 2;
+
+-- each round adds one more rel to the join driven by the selective qual
+explain (costs off)
+select a.unique1, b.unique1, c.unique1, d.unique1, e.unique1, e.unique2
+from tenk1 a, tenk1 b, tenk1 c, tenk1 d, tenk1 e
+where a.unique1 = 42 and b.unique1 = a.unique2 and c.unique1 = b.unique2
+  and d.unique1 = c.unique2 and e.unique1 = d.unique2;
+select a.unique1, b.unique1, c.unique1, d.unique1, e.unique1, e.unique2
+from tenk1 a, tenk1 b, tenk1 c, tenk1 d, tenk1 e
+where a.unique1 = 42 and b.unique1 = a.unique2 and c.unique1 = b.unique2
+  and d.unique1 = c.unique2 and e.unique1 = d.unique2;
+
+-- the same, with the rels listed in a different order and bigger rounds
+set join_search_block_size = 3;
+explain (costs off)
+select a.unique1, b.unique1, c.unique1, d.unique1, e.unique1, e.unique2
+from tenk1 e, tenk1 d, tenk1 c, tenk1 b, tenk1 a
+where a.unique1 = 42 and b.unique1 = a.unique2 and c.unique1 = b.unique2
+  and d.unique1 = c.unique2 and e.unique1 = d.unique2;
+
+-- outer joins restrict the joinrels each round can build
+select count(*), count(c.unique2), count(e.unique2)
+from tenk1 a
+  left join tenk1 b on b.unique1 = a.unique2
+  left join tenk1 c on c.unique1 = b.unique2
+  join tenk1 d on d.unique1 = a.unique1
+  left join tenk1 e on e.unique1 = d.unique2
+where a.unique1 < 10;
+
+reset join_search_block_size;
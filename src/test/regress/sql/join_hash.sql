@@ -52,6 +52,24 @@ begin
   end loop;
 end;
 $$;
+create or replace function hash_join_stripes(query text)
+returns table (stripes int, peak_kb int) language plpgsql
+as
+$$
+declare
+  whole_plan json;
+  hash_node json;
+begin
+  for whole_plan in
+    execute 'explain (analyze, format ''json'') ' || query
+  loop
+    hash_node := find_hash(json_extract_path(whole_plan, '0', 'Plan'));
+    stripes := hash_node->>'Hash Stripes';
+    peak_kb := hash_node->>'Peak Memory Usage';
+    return next;
+  end loop;
+end;
+$$;
 
 -- Make a simple relation with well distributed keys and correctly
 -- estimated size.
@@ -233,10 +251,10 @@ $$);
 rollback to settings;
 
 -- The "ugly" case: increasing the number of batches during execution
--- doesn't help, so stop trying to fit in work_mem and hope for the
--- best; in this case we plan for 1 batch, increases just once and
--- then stop increasing because that didn't help at all, so we blow
--- right through the work_mem budget and hope for the best...
+-- doesn't help; in this case we plan for 1 batch, increase just once
+-- and then stop increasing because that didn't help at all.  Instead
+-- of blowing through the work_mem budget, the batch that doesn't fit
+-- is joined in several stripes, each of which does fit.
 
 -- non-parallel
 savepoint settings;
@@ -249,6 +267,18 @@ select * from hash_join_batches(
 $$
   select count(*) from simple r join extremely_skewed s using (id);
 $$);
+select stripes > 1 as striped, peak_kb < 1024 as bounded
+  from hash_join_stripes(
+$$
+  select count(*) from simple r join extremely_skewed s using (id);
+$$);
+-- other join types must get the same answers when joined in stripes
+select count(*) from simple r left join extremely_skewed s using (id);
+select count(*) from simple r
+  where exists (select 1 from extremely_skewed s where s.id = r.id);
+select count(*) from simple r
+  where not exists (select 1 from extremely_skewed s where s.id = r.id);
+select count(*) from simple r full join extremely_skewed s using (id);
 rollback to settings;
 
 -- parallel with parallel-oblivious hash join
@@ -263,6 +293,11 @@ select * from hash_join_batches(
 $$
   select count(*) from simple r join extremely_skewed s using (id);
 $$);
+select stripes > 1 as striped, peak_kb < 1024 as bounded
+  from hash_join_stripes(
+$$
+  select count(*) from simple r join extremely_skewed s using (id);
+$$);
 rollback to settings;
 
 -- parallel with parallel-aware hash join
@@ -277,6 +312,11 @@ select * from hash_join_batches(
 $$
   select count(*) from simple r join extremely_skewed s using (id);
 $$);
+select stripes > 1 as striped, peak_kb < 1024 as bounded
+  from hash_join_stripes(
+$$
+  select count(*) from simple r join extremely_skewed s using (id);
+$$);
 rollback to settings;
 
 -- A couple of other hash join tests unrelated to work_mem management.
@@ -223,3 +223,48 @@ select name, generic_plans, custom_plans from pg_prepared_statements
   where  name = 'test_mode_pp';
 
 drop table test_mode;
+
+-- Partitions that initial pruning eliminates aren't locked when a generic
+-- plan is reused
+create table plc_lp (a int) partition by list (a);
+create table plc_lp1 partition of plc_lp for values in (1);
+create table plc_lp2 partition of plc_lp for values in (2);
+create table plc_lp3 partition of plc_lp for values in (3);
+insert into plc_lp values (1), (2), (3);
+set plan_cache_mode to force_generic_plan;
+prepare plc_q (int) as select * from plc_lp where a = $1;
+execute plc_q(2);
+begin;
+execute plc_q(2);
+select relation::regclass, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'plc_lp%'
+  order by relation::regclass::text;
+commit;
+begin;
+execute plc_q(4);
+select relation::regclass, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'plc_lp%'
+  order by relation::regclass::text;
+commit;
+
+-- but not if pruning depends on a stable function, whose value might change
+-- before executor startup
+create function plc_stable(int) returns int stable language plpgsql
+  as $$ begin return $1; end $$;
+prepare plc_q2 (int) as select * from plc_lp where a = plc_stable($1);
+execute plc_q2(2);
+begin;
+execute plc_q2(2);
+select relation::regclass, mode from pg_locks
+  where locktype = 'relation' and pid = pg_backend_pid()
+    and relation::regclass::text like 'plc_lp%'
+  order by relation::regclass::text;
+commit;
+
+reset plan_cache_mode;
+deallocate plc_q;
+deallocate plc_q2;
+drop function plc_stable(int);
+drop table plc_lp;
@@ -328,6 +328,25 @@ explain (costs off)
 
 select fivethous from tenk1 order by fivethous limit 4;
 
+-- gather test with a LIMIT over a selective scan: the workers find rows only
+-- now and then, and mustn't hold them back until the end of the scan
+explain (costs off)
+  select count(*) from
+    (select unique1 from tenk1 where unique1 % 1000 = 7 limit 5) ss;
+select count(*) from
+  (select unique1 from tenk1 where unique1 % 1000 = 7 limit 5) ss;
+select unique1 from
+  (select unique1 from tenk1 where unique1 % 1000 = 7 limit 10) ss
+  order by unique1;
+
+-- cursors don't get parallel plans, since they may be run in pieces; make
+-- sure that fetching the same rows through one does work
+declare tenk1_sel cursor for
+  select unique1 from tenk1 where unique1 % 1000 = 7 order by unique1;
+fetch 3 from tenk1_sel;
+fetch all from tenk1_sel;
+close tenk1_sel;
+
 -- gather merge test with 0 worker
 set max_parallel_workers = 0;
 explain (costs off)
@@ -453,4 +472,32 @@ EXPLAIN (COSTS OFF)
 SELECT 1 FROM tenk1_vw_sec
   WHERE (SELECT sum(f1) FROM int4_tbl WHERE f1 < unique1) < 100;
 
+-- test parallel INSERT ... SELECT, where the workers do the inserting
+SAVEPOINT settings;
+SET LOCAL parallel_tuple_cost = 0.1;
+EXPLAIN (COSTS OFF)
+INSERT INTO tenk1 SELECT * FROM tenk1;
+INSERT INTO tenk1 SELECT * FROM tenk1;
+SELECT count(*), count(DISTINCT unique1) FROM tenk1;
+ROLLBACK TO SAVEPOINT settings;
+-- without the leader, all rows are inserted by the workers
+SAVEPOINT settings;
+SET LOCAL parallel_tuple_cost = 0.1;
+SET LOCAL parallel_leader_participation = off;
+EXPLAIN (analyze, costs off, timing off, summary off)
+INSERT INTO tenk1 SELECT * FROM tenk1;
+SELECT count(*), count(DISTINCT unique1) FROM tenk1;
+ROLLBACK TO SAVEPOINT settings;
+
+-- and parallel CREATE TABLE AS
+CREATE TABLE parallel_ctas AS SELECT * FROM tenk1;
+SELECT count(*), sum(unique1) FROM parallel_ctas;
+DROP TABLE parallel_ctas;
+SAVEPOINT settings;
+SET LOCAL parallel_leader_participation = off;
+EXPLAIN (analyze, costs off, timing off, summary off)
+CREATE TABLE parallel_ctas AS SELECT * FROM tenk1;
+SELECT count(*), sum(unique1) FROM parallel_ctas;
+ROLLBACK TO SAVEPOINT settings;
+
 rollback;
@@ -296,3 +296,79 @@ EXPLAIN (COSTS OFF) :qry;
 :qry;
 
 COMMIT;
+
+----
+-- Check the sort routines specialized for the leading key's type, including
+-- radix sort, against the generic quicksort
+----
+
+CREATE TEMP TABLE specialized_sort AS
+    SELECT g.i AS id,
+        CASE WHEN g.i % 997 = 0 THEN NULL ELSE (g.i * 7919) % 10007 - 5000 END AS i4,
+        CASE WHEN g.i % 991 = 0 THEN NULL ELSE ((g.i * 7919) % 10007 - 5000)::int8 * 4294967311 END AS i8,
+        timestamp '2000-01-01' + ((g.i * 104729) % 20011 - 10000) * interval '1 hour' AS ts,
+        md5((g.i % 5003)::text) AS t
+    FROM generate_series(1, 20000) g(i);
+
+SELECT $$
+    SELECT
+        (SELECT md5(array_agg(i4)::text) FROM (SELECT i4 FROM specialized_sort ORDER BY i4) s) AS i4_asc,
+        (SELECT md5(array_agg(id)::text) FROM (SELECT id FROM specialized_sort ORDER BY i4 DESC NULLS LAST, id) s) AS i4_desc,
+        (SELECT md5(array_agg(id)::text) FROM (SELECT id FROM specialized_sort ORDER BY i8 NULLS FIRST, id DESC) s) AS i8_asc,
+        (SELECT md5(array_agg(i8 ORDER BY i8 DESC)::text) FROM specialized_sort) AS i8_desc,
+        (SELECT md5(array_agg(id)::text) FROM (SELECT id FROM specialized_sort ORDER BY ts, id) s) AS ts_asc,
+        (SELECT md5(array_agg(id)::text) FROM (SELECT id FROM specialized_sort ORDER BY t COLLATE "C" DESC, id) s) AS text_desc,
+        (SELECT md5(array_agg(id)::text) FROM (SELECT id FROM abbrev_abort_uuids ORDER BY noabort_decreasing, id) s) AS uuid_asc
+$$ AS qry \gset
+
+SET sort_specialization = off;
+:qry \gset generic_
+
+SET sort_specialization = on;
+SELECT i4_asc = :'generic_i4_asc' AS i4_asc,
+    i4_desc = :'generic_i4_desc' AS i4_desc,
+    i8_asc = :'generic_i8_asc' AS i8_asc,
+    i8_desc = :'generic_i8_desc' AS i8_desc,
+    ts_asc = :'generic_ts_asc' AS ts_asc,
+    text_desc = :'generic_text_desc' AS text_desc,
+    uuid_asc = :'generic_uuid_asc' AS uuid_asc
+FROM (:qry) q;
+
+-- an index built with radix sort must return the same order
+CREATE INDEX specialized_sort_i8_id_idx ON specialized_sort (i8 NULLS FIRST, id DESC);
+BEGIN;
+SET LOCAL enable_seqscan = off;
+SET LOCAL enable_bitmapscan = off;
+SELECT md5(array_agg(id)::text) = :'generic_i8_asc' AS index_order
+FROM (SELECT id FROM specialized_sort ORDER BY i8 NULLS FIRST, id DESC) s;
+COMMIT;
+
+DROP TABLE specialized_sort;
+
+----
+-- Check multi-pass external sorts, whose merges read ahead on the tapes,
+-- against in-memory sorts
+----
+
+CREATE TEMP TABLE external_sort AS
+    SELECT (g.i * 7919) % 100003 AS a, md5(g.i::text) AS b
+    FROM generate_series(1, 100000) g(i);
+
+SELECT $$
+    SELECT
+        (SELECT md5(array_agg(a)::text) FROM (SELECT a FROM external_sort ORDER BY a) s) AS a_asc,
+        (SELECT md5(string_agg(b, ',')) FROM (SELECT b FROM external_sort ORDER BY b COLLATE "C" DESC) s) AS b_desc
+$$ AS qry \gset
+
+BEGIN;
+SET LOCAL work_mem = '64MB';
+:qry \gset memory_
+-- small enough for several runs and merge passes, but leaving more than one
+-- block of read buffer per input tape
+SET LOCAL work_mem = '256kB';
+SELECT a_asc = :'memory_a_asc' AS a_asc,
+    b_desc = :'memory_b_desc' AS b_desc
+FROM (:qry) q;
+COMMIT;
+
+DROP TABLE external_sort;
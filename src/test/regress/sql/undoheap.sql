@@ -0,0 +1,106 @@
+--
+-- Tests for the undo heap table access method
+--
+
+CREATE TABLE undo_tab (id int PRIMARY KEY, val int, note text) USING undoheap;
+
+SELECT amname FROM pg_class c JOIN pg_am am ON am.oid = c.relam
+  WHERE c.relname = 'undo_tab';
+
+-- empty table
+SELECT count(*) FROM undo_tab;
+
+INSERT INTO undo_tab SELECT i, i * 10, 'row ' || i FROM generate_series(1, 1000) i;
+SELECT count(*), sum(val) FROM undo_tab;
+
+-- updates that don't change an indexed column stay in place
+UPDATE undo_tab SET val = val + 1, note = 'updated' WHERE id <= 10;
+SELECT ctid, id, val, note FROM undo_tab WHERE id <= 3 ORDER BY id;
+
+-- changing an indexed column moves the row
+UPDATE undo_tab SET id = id + 2000 WHERE id = 5;
+SELECT id, val, note FROM undo_tab WHERE id IN (5, 2005);
+SELECT ctid = '(1,5)' AS same_place FROM undo_tab WHERE id = 2005;
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF) SELECT id, val FROM undo_tab WHERE id BETWEEN 1 AND 6;
+SELECT id, val FROM undo_tab WHERE id BETWEEN 1 AND 6 ORDER BY id;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+
+INSERT INTO undo_tab VALUES (1, 0, 'dup');
+
+-- aborted changes are undone
+BEGIN;
+UPDATE undo_tab SET val = -1 WHERE id <= 100;
+DELETE FROM undo_tab WHERE id > 900;
+INSERT INTO undo_tab VALUES (5000, 5000, 'new');
+SELECT count(*), sum(val) FROM undo_tab;
+ROLLBACK;
+SELECT count(*), sum(val) FROM undo_tab;
+
+BEGIN;
+UPDATE undo_tab SET note = 'first' WHERE id = 1;
+SAVEPOINT s1;
+UPDATE undo_tab SET note = 'second' WHERE id = 1;
+DELETE FROM undo_tab WHERE id = 2;
+ROLLBACK TO s1;
+SELECT id, note FROM undo_tab WHERE id IN (1, 2) ORDER BY id;
+COMMIT;
+SELECT id, note FROM undo_tab WHERE id IN (1, 2) ORDER BY id;
+
+-- a cursor keeps seeing the rows as they were when it was opened
+BEGIN;
+DECLARE c CURSOR FOR
+  SELECT id, val FROM undo_tab WHERE id BETWEEN 1 AND 4 ORDER BY id;
+UPDATE undo_tab SET val = 0 WHERE id BETWEEN 1 AND 4;
+FETCH ALL FROM c;
+SELECT id, val FROM undo_tab WHERE id BETWEEN 1 AND 4 ORDER BY id;
+ROLLBACK;
+
+-- backward scan
+BEGIN;
+SET LOCAL enable_indexscan = off;
+SET LOCAL enable_bitmapscan = off;
+DECLARE c SCROLL CURSOR FOR SELECT id FROM undo_tab WHERE id <= 3;
+FETCH ALL FROM c;
+FETCH BACKWARD ALL FROM c;
+COMMIT;
+
+SELECT id, val FROM undo_tab WHERE id = 3 FOR UPDATE;
+
+INSERT INTO undo_tab VALUES (1, 100, 'upsert')
+  ON CONFLICT (id) DO UPDATE SET note = excluded.note;
+INSERT INTO undo_tab VALUES (600, 600, 'new') ON CONFLICT (id) DO NOTHING;
+SELECT id, val, note FROM undo_tab WHERE id IN (1, 600) ORDER BY id;
+
+-- tuples that grow, and large values
+UPDATE undo_tab SET note = repeat('y', 500) WHERE id BETWEEN 11 AND 20;
+SELECT count(*), min(length(note)) FROM undo_tab WHERE id BETWEEN 11 AND 20;
+INSERT INTO undo_tab VALUES (3000, 0, repeat('x', 100000));
+UPDATE undo_tab SET val = 1 WHERE id = 3000;
+SELECT id, val, length(note) FROM undo_tab WHERE id = 3000;
+
+-- maintenance
+DELETE FROM undo_tab WHERE id > 500;
+VACUUM undo_tab;
+SELECT count(*), sum(val) FROM undo_tab;
+VACUUM FULL undo_tab;
+SELECT count(*), sum(val) FROM undo_tab;
+CLUSTER undo_tab USING undo_tab_pkey;
+SELECT id, val, note FROM undo_tab WHERE id < 4 ORDER BY id;
+ANALYZE undo_tab;
+SELECT reltuples FROM pg_class WHERE relname = 'undo_tab';
+
+CREATE INDEX CONCURRENTLY undo_tab_val ON undo_tab (val);
+SET enable_seqscan = off;
+SELECT id FROM undo_tab WHERE val = 31;
+UPDATE undo_tab SET val = 32 WHERE id = 3;
+SELECT id FROM undo_tab WHERE val IN (31, 32);
+RESET enable_seqscan;
+
+SELECT count(*) FROM undo_tab TABLESAMPLE BERNOULLI (100);
+SELECT count(*) FROM undo_tab TABLESAMPLE SYSTEM (100);
+
+DROP TABLE undo_tab;
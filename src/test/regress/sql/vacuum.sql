@@ -106,6 +106,12 @@ CREATE TEMPORARY TABLE tmp (a int PRIMARY KEY);
 CREATE INDEX tmp_idx1 ON tmp (a);
 VACUUM (PARALLEL 1, FULL FALSE) tmp; -- parallel vacuum disabled for temp tables
 VACUUM (PARALLEL 0, FULL TRUE) tmp; -- can specify parallel disabled (even though that's implied by FULL)
+ANALYZE (PARALLEL 2) pvactst;
+SELECT attname, n_distinct FROM pg_stats
+  WHERE tablename = 'pvactst' AND attname IN ('i', 'a') ORDER BY attname;
+ANALYZE (PARALLEL 0) pvactst; -- disable parallel analyze
+ANALYZE (PARALLEL -1) pvactst; -- error
+ANALYZE (PARALLEL 1) tmp; -- parallel analyze disabled for temp tables
 RESET min_parallel_index_scan_size;
 DROP TABLE pvactst;
 
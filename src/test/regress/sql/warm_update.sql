@@ -0,0 +1,111 @@
+--
+-- Tests for WARM updates, which change indexed columns but stay in the
+-- HOT chain
+--
+
+CREATE TABLE warm_tab (id int, a int, b int, c text) WITH (fillfactor = 50);
+CREATE UNIQUE INDEX warm_tab_id ON warm_tab (id);
+CREATE INDEX warm_tab_a ON warm_tab (a);
+CREATE INDEX warm_tab_b ON warm_tab (b);
+INSERT INTO warm_tab SELECT i, i, i, 'row ' || i FROM generate_series(1, 100) i;
+
+-- change a column that only non-unique btree indexes use
+UPDATE warm_tab SET a = a + 1000 WHERE id <= 10;
+
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF) SELECT id, a FROM warm_tab WHERE a BETWEEN 1 AND 12 ORDER BY a;
+SELECT id, a FROM warm_tab WHERE a BETWEEN 1 AND 12 ORDER BY a;
+SELECT id, a FROM warm_tab WHERE a BETWEEN 1000 AND 1012 ORDER BY a;
+SELECT id, a, b FROM warm_tab WHERE b <= 3 ORDER BY b;
+SELECT a FROM warm_tab WHERE a < 15 ORDER BY a;
+SELECT count(*), count(DISTINCT id) FROM warm_tab WHERE a > 0;
+RESET enable_bitmapscan;
+
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF) SELECT id, a FROM warm_tab WHERE a IN (1, 1001);
+SELECT id, a FROM warm_tab WHERE a IN (1, 1001);
+SELECT id, a FROM warm_tab WHERE a < 15 ORDER BY id;
+RESET enable_indexscan;
+
+-- only one WARM update per chain; the next ones are regular updates
+UPDATE warm_tab SET a = a + 1000 WHERE id = 1;
+UPDATE warm_tab SET b = -2 WHERE id = 2;
+UPDATE warm_tab SET c = 'hot' WHERE id = 3;
+SELECT id, a, b, c FROM warm_tab WHERE a IN (1, 1001, 2001) ORDER BY a;
+SELECT id, a, b, c FROM warm_tab WHERE b IN (-2, 2) ORDER BY b;
+SELECT id, a, b, c FROM warm_tab WHERE a IN (3, 1003) ORDER BY a;
+
+-- an aborted WARM update uses up the chain's one too
+BEGIN;
+UPDATE warm_tab SET a = 5000 WHERE id = 20;
+SELECT id, a FROM warm_tab WHERE a IN (20, 5000);
+ROLLBACK;
+SELECT id, a FROM warm_tab WHERE a IN (20, 5000);
+UPDATE warm_tab SET a = 5000 WHERE id = 20;
+SELECT id, a FROM warm_tab WHERE a IN (20, 5000);
+
+-- a cursor keeps seeing the old version, through its own entry
+BEGIN;
+DECLARE c CURSOR FOR SELECT id, a FROM warm_tab WHERE a IN (30, 3000) ORDER BY a;
+UPDATE warm_tab SET a = 3000 WHERE id = 30;
+FETCH ALL FROM c;
+SELECT id, a FROM warm_tab WHERE a IN (30, 3000) ORDER BY a;
+COMMIT;
+
+-- columns of unique indexes are never changed by WARM updates
+UPDATE warm_tab SET id = id + 1000, a = a + 1000 WHERE id = 50;
+SELECT id, a FROM warm_tab WHERE id IN (50, 1050) ORDER BY id;
+SELECT id, a FROM warm_tab WHERE a IN (50, 1050) ORDER BY id;
+
+-- maintenance keeps all of it right
+VACUUM warm_tab;
+SELECT id, a FROM warm_tab WHERE a BETWEEN 1 AND 12 ORDER BY a;
+SELECT count(*), count(DISTINCT id) FROM warm_tab WHERE a > 0;
+CLUSTER warm_tab USING warm_tab_a;
+SELECT count(*), count(DISTINCT id) FROM warm_tab;
+SELECT id, a FROM warm_tab WHERE a BETWEEN 1000 AND 1012 ORDER BY a;
+UPDATE warm_tab SET a = a - 1000 WHERE id BETWEEN 4 AND 6;
+REINDEX TABLE warm_tab;
+SELECT id, a, b FROM warm_tab WHERE a BETWEEN 1 AND 12 ORDER BY a;
+SELECT count(*), count(DISTINCT id) FROM warm_tab WHERE a > 0;
+RESET enable_seqscan;
+
+DROP TABLE warm_tab;
+
+-- a WARM update keeps the new version on the page and adds no entries to
+-- the indexes on unchanged columns
+CREATE TABLE warm_size (id int, a int, b int) WITH (fillfactor = 40);
+CREATE UNIQUE INDEX warm_size_id ON warm_size (id);
+CREATE INDEX warm_size_a ON warm_size (a);
+CREATE INDEX warm_size_b ON warm_size (b);
+INSERT INTO warm_size SELECT i, i, i FROM generate_series(1, 2000) i;
+CREATE TEMP TABLE warm_size_ctid AS SELECT id, ctid FROM warm_size;
+SELECT pg_relation_size('warm_size') AS heap_size,
+       pg_relation_size('warm_size_id') AS id_size,
+       pg_relation_size('warm_size_a') AS a_size,
+       pg_relation_size('warm_size_b') AS b_size \gset
+UPDATE warm_size SET a = a + 10000;
+SELECT count(*) FROM warm_size w JOIN warm_size_ctid o USING (id)
+  WHERE (w.ctid::text::point)[0] <> (o.ctid::text::point)[0];
+SELECT pg_relation_size('warm_size') = :heap_size AS heap_same,
+       pg_relation_size('warm_size_id') = :id_size AS id_same,
+       pg_relation_size('warm_size_b') = :b_size AS b_same,
+       pg_relation_size('warm_size_a') > :a_size AS a_grew;
+-- index and bitmap scans recheck the chains: the old entries in warm_size_a
+-- find nothing, and the entries in warm_size_b lead to the new versions
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+EXPLAIN (COSTS OFF) SELECT count(b) FROM warm_size WHERE a <= 2000;
+SELECT count(b) FROM warm_size WHERE a <= 2000;
+SELECT count(b) FROM warm_size WHERE a > 10000;
+SELECT count(*) FROM warm_size WHERE b <= 2000 AND a = b + 10000;
+RESET enable_bitmapscan;
+SET enable_indexscan = off;
+EXPLAIN (COSTS OFF) SELECT count(b) FROM warm_size WHERE a <= 2000;
+SELECT count(b) FROM warm_size WHERE a <= 2000;
+SELECT count(b) FROM warm_size WHERE a > 10000;
+SELECT count(*) FROM warm_size WHERE b <= 2000 AND a = b + 10000;
+RESET enable_indexscan;
+RESET enable_seqscan;
+DROP TABLE warm_size, warm_size_ctid;